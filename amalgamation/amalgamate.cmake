@@ -0,0 +1,92 @@
+# Generates single header 'sc_all.h' from module sources.
+#
+# cmake -DSC_ROOT=<repo dir> -DSC_OUT=<output file> -P amalgamate.cmake
+#
+# Headers come first, sources are wrapped in '#ifdef SC_IMPLEMENTATION'.
+# Modules are ordered so a header comes after the headers it includes.
+
+if (NOT SC_ROOT)
+    get_filename_component(SC_ROOT "${CMAKE_CURRENT_LIST_DIR}/.." ABSOLUTE)
+endif ()
+
+if (NOT SC_OUT)
+    set(SC_OUT "${CMAKE_CURRENT_BINARY_DIR}/sc_all.h")
+endif ()
+
+set(SC_MODULES
+        crc32/sc_crc32
+        scan/sc_scan
+        time/sc_time
+        arena/sc_arena
+        array/sc_array
+        buffer/sc_buf
+        heap/sc_heap
+        histogram/sc_hist
+        linked-list/sc_list
+        map/sc_map
+        ini/sc_ini
+        option/sc_option
+        queue/sc_queue
+        ring/sc_ring
+        string/sc_str
+        timer/sc_timer
+        uri/sc_uri)
+
+# Includes of the modules above are removed, others are kept, e.g sc_pool.h
+# when SC_ARRAY_HAVE_POOL is defined.
+set(names "")
+foreach (module ${SC_MODULES})
+    get_filename_component(name ${module} NAME)
+    list(APPEND names ${name})
+endforeach ()
+string(REPLACE ";" "|" names "${names}")
+set(include_re "\n[ ]*#include \"(${names})\\.h\"")
+
+set(license "/*\n * MIT License\n")
+
+function(sc_read path out)
+    file(READ "${SC_ROOT}/${path}" content)
+
+    # Drop the license header, it's written once at the top.
+    string(FIND "${content}" "${license}" pos)
+    if (pos EQUAL 0)
+        string(FIND "${content}" "*/\n" end)
+        math(EXPR end "${end} + 3")
+        string(SUBSTRING "${content}" ${end} -1 content)
+    endif ()
+
+    string(REGEX REPLACE "${include_re}" "\n" content "${content}")
+    set(${out} "// ${path}\n${content}" PARENT_SCOPE)
+endfunction()
+
+file(READ "${SC_ROOT}/array/sc_array.h" out)
+string(FIND "${out}" "*/\n" end)
+math(EXPR end "${end} + 3")
+string(SUBSTRING "${out}" 0 ${end} out)
+string(APPEND out "\n")
+string(APPEND out "// Generated by amalgamation/amalgamate.cmake, do not edit.\n\n")
+string(APPEND out "#ifndef SC_ALL_H\n#define SC_ALL_H\n\n")
+
+# Feature macros of the sources must come before any system header.
+string(APPEND out "#ifdef SC_IMPLEMENTATION\n")
+string(APPEND out "    #if defined(__linux__) && !defined(_GNU_SOURCE)\n")
+string(APPEND out "        #define _GNU_SOURCE\n")
+string(APPEND out "    #elif defined(__APPLE__) && !defined(_DARWIN_C_SOURCE)\n")
+string(APPEND out "        #define _DARWIN_C_SOURCE\n")
+string(APPEND out "    #endif\n")
+string(APPEND out "#endif\n\n")
+
+foreach (module ${SC_MODULES})
+    sc_read(${module}.h content)
+    string(APPEND out "${content}\n")
+endforeach ()
+
+string(APPEND out "#ifdef SC_IMPLEMENTATION\n\n")
+foreach (module ${SC_MODULES})
+    sc_read(${module}.c content)
+    # Defaults differ between modules, e.g 'SC_SIZE_MAX' is a test knob.
+    string(APPEND out "${content}\n#undef SC_SIZE_MAX\n\n")
+endforeach ()
+string(APPEND out "#endif\n#endif\n")
+
+file(WRITE "${SC_OUT}" "${out}")
@@ -0,0 +1,23 @@
+#include "sc_all.h"
+
+#include <stdio.h>
+
+int main()
+{
+    char *str;
+    struct sc_map_str map;
+    const char *val;
+
+    sc_map_init_str(&map, 0, 0);
+    sc_map_put_str(&map, "jack", "chicago");
+    sc_map_put_str(&map, "jane", "new york");
+
+    sc_map_get_str(&map, "jane", &val);
+    str = sc_str_create_fmt("jane lives in %s", val);
+    printf("%s, map size : %u \n", str, sc_map_size_str(&map));
+
+    sc_str_destroy(str);
+    sc_map_term_str(&map);
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "sc_all.h"
+
+#include <assert.h>
+#include <string.h>
+
+static int on_item(void *arg, int line, const char *section, const char *key,
+                   const char *value)
+{
+    int *count = arg;
+
+    (void) line;
+    (void) section;
+    (void) key;
+    (void) value;
+
+    (*count)++;
+    return 0;
+}
+
+void test_containers(void)
+{
+    int *arr, *queue;
+    int64_t key;
+    void *data;
+    struct sc_heap heap;
+    struct sc_list list, a, b;
+    struct sc_buf buf;
+    struct sc_map_64 map;
+    uint64_t val;
+
+    sc_array_create(arr, 0);
+    for (int i = 0; i < 100; i++) {
+        assert(sc_array_add(arr, i));
+    }
+    assert(sc_array_size(arr) == 100);
+    sc_array_destroy(arr);
+
+    sc_queue_create(queue, 0);
+    assert(sc_queue_add_last(queue, 1));
+    assert(sc_queue_add_first(queue, 0));
+    assert(sc_queue_del_first(queue) == 0);
+    sc_queue_destroy(queue);
+
+    assert(sc_heap_init(&heap, 0));
+    assert(sc_heap_add(&heap, 2, NULL));
+    assert(sc_heap_add(&heap, 1, NULL));
+    assert(sc_heap_peek(&heap, &key, &data) && key == 1);
+    assert(sc_heap_size(&heap) == 2);
+    sc_heap_term(&heap);
+
+    sc_list_init(&list);
+    sc_list_init(&a);
+    sc_list_init(&b);
+    assert(sc_list_head(&list) == NULL);
+    sc_list_add_tail(&list, &a);
+    sc_list_add_tail(&list, &b);
+    assert(sc_list_head(&list) == &a);
+    assert(sc_list_tail(&list) == &b);
+
+    assert(sc_buf_init(&buf, 16));
+    sc_buf_put_32(&buf, 0xdeadbeef);
+    assert(sc_buf_size(&buf) == 4);
+    assert(sc_buf_get_32(&buf) == 0xdeadbeef);
+    assert(sc_buf_get_32(&buf) == 0);
+    assert(!sc_buf_valid(&buf));
+    sc_buf_term(&buf);
+
+    assert(sc_map_init_64(&map, 0, 0));
+    assert(sc_map_put_64(&map, 1, 100));
+    assert(sc_map_get_64(&map, 1, &val) && val == 100);
+    assert(sc_map_size_64(&map) == 1);
+    sc_map_term_64(&map);
+}
+
+void test_text(void)
+{
+    int count = 0;
+    char *str;
+    struct sc_uri *uri;
+    const char *ini = "[section]\nkey=value\nname=sc\n";
+
+    str = sc_str_create("sc");
+    assert(sc_str_append(&str, "-lib"));
+    assert(strcmp(str, "sc-lib") == 0);
+    sc_str_destroy(str);
+
+    uri = sc_uri_create("http://user@host:8080/path?q=1#frag");
+    assert(uri != NULL);
+    assert(strcmp(uri->host, "host") == 0);
+    assert(strcmp(uri->port, "8080") == 0);
+    sc_uri_destroy(uri);
+
+    assert(sc_ini_parse_string(&count, on_item, ini) == 0);
+    assert(count == 2);
+
+    sc_crc32_init();
+    assert(sc_crc32(0, (const uint8_t *) "123456789", 9) == 0xe3069283);
+}
+
+void test_timer(void)
+{
+    struct sc_timer timer;
+    uint64_t now = sc_time_mono_ms();
+
+    assert(sc_timer_init(&timer, now));
+    assert(sc_timer_add(&timer, 10, 0, NULL) != SC_TIMER_INVALID);
+    sc_timer_term(&timer);
+}
+
+int main(void)
+{
+    test_containers();
+    test_text();
+    test_timer();
+
+    return 0;
+}
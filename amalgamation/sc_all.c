@@ -0,0 +1,4 @@
+// Implementation of the single header, compile this file or define
+// SC_IMPLEMENTATION in one of your source files before including sc_all.h.
+#define SC_IMPLEMENTATION
+#include "sc_all.h"
@@ -0,0 +1,31 @@
+#include "sc_arena.h"
+
+#include <stdio.h>
+#include <string.h>
+
+int main()
+{
+    char *name, *tmp;
+    struct sc_arena arena;
+    struct sc_arena_mark mark;
+
+    sc_arena_init(&arena, 0);
+
+    for (int i = 0; i < 3; i++) {
+        // Request scope, everything is released at once with reset.
+        name = sc_arena_alloc(&arena, 64);
+        snprintf(name, 64, "request-%d", i);
+
+        mark = sc_arena_mark(&arena);
+        tmp = sc_arena_calloc(&arena, 1, 1024);
+        strcpy(tmp, name);
+        sc_arena_rewind(&arena, mark); // Releases 'tmp' only.
+
+        printf("%s \n", name);
+        sc_arena_reset(&arena);
+    }
+
+    sc_arena_term(&arena);
+
+    return 0;
+}
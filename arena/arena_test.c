@@ -0,0 +1,356 @@
+#include "sc_arena.h"
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "sc_map.h"
+    #include "sc_str.h"
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#ifdef SC_HAVE_WRAP
+
+bool fail_malloc = false;
+void *__real_malloc(size_t n);
+void *__wrap_malloc(size_t n)
+{
+    if (fail_malloc) {
+        return NULL;
+    }
+
+    return __real_malloc(n);
+}
+
+bool fail_realloc = false;
+void *__real_realloc(void *p, size_t size);
+void *__wrap_realloc(void *p, size_t n)
+{
+    if (fail_realloc) {
+        return NULL;
+    }
+
+    return __real_realloc(p, n);
+}
+
+void fail_test(void)
+{
+    void *p;
+    struct sc_arena a;
+    struct sc_slab s;
+
+    sc_arena_init(&a, 128);
+    fail_malloc = true;
+    assert(sc_arena_alloc(&a, 10) == NULL);
+    assert(sc_arena_calloc(&a, 10, 10) == NULL);
+    fail_malloc = false;
+    assert(sc_arena_mem(&a) == 0);
+    assert(sc_arena_alloc(&a, 10) != NULL);
+    assert(sc_arena_mem(&a) == 128);
+    sc_arena_term(&a);
+
+    sc_slab_init(&s);
+    fail_malloc = true;
+    assert(sc_slab_alloc(&s, 10) == NULL);
+    assert(sc_slab_alloc(&s, SC_SLAB_MAX + 1) == NULL);
+    fail_malloc = false;
+    p = sc_slab_alloc(&s, 10);
+    assert(p != NULL);
+    sc_slab_free(&s, p, 10);
+    sc_slab_term(&s);
+
+    fail_malloc = true;
+    assert(sc_arena_hook_malloc(10) == NULL);
+    assert(sc_arena_hook_calloc(10, 10) == NULL);
+    fail_malloc = false;
+
+    p = sc_arena_hook_malloc(10);
+    assert(p != NULL);
+    fail_realloc = true;
+    assert(sc_arena_hook_realloc(p, 100) == NULL);
+    fail_realloc = false;
+    sc_arena_hook_free(p);
+
+    sc_arena_init(&a, 128);
+    sc_arena_use(&a);
+    p = sc_arena_hook_malloc(10);
+    assert(p != NULL);
+    fail_malloc = true;
+    assert(sc_arena_hook_realloc(p, 1000) == NULL);
+    fail_malloc = false;
+    sc_arena_use(NULL);
+    sc_arena_term(&a);
+}
+
+#else
+void fail_test(void)
+{
+}
+#endif
+
+void test_arena(void)
+{
+    char *p, *q, *r;
+    size_t mem;
+    struct sc_arena a;
+    struct sc_arena_mark m;
+
+    sc_arena_init(&a, 0);
+    sc_arena_term(&a);
+
+    sc_arena_init(&a, 256);
+    assert(sc_arena_mem(&a) == 0);
+    assert(sc_arena_alloc(&a, SIZE_MAX) == NULL);
+    assert(sc_arena_calloc(&a, SIZE_MAX / 2, 4) == NULL);
+
+    p = sc_arena_alloc(&a, 1);
+    q = sc_arena_alloc(&a, 0);
+    r = sc_arena_alloc(&a, 17);
+    assert(p != NULL && q != NULL && r != NULL);
+    assert(((uintptr_t) p % SC_ARENA_ALIGN) == 0);
+    assert(((uintptr_t) q % SC_ARENA_ALIGN) == 0);
+    assert(((uintptr_t) r % SC_ARENA_ALIGN) == 0);
+    assert(q == p + SC_ARENA_ALIGN);
+    assert(r == q + SC_ARENA_ALIGN);
+    memset(r, 'r', 17);
+
+    // Chunks grow geometrically.
+    for (int i = 0; i < 100; i++) {
+        p = sc_arena_alloc(&a, 100);
+        assert(p != NULL);
+        memset(p, i, 100);
+    }
+    assert(sc_arena_mem(&a) >= 100 * 112);
+    assert(sc_arena_mem(&a) < 4 * 100 * 112);
+
+    // Larger than chunk size.
+    p = sc_arena_alloc(&a, 100000);
+    assert(p != NULL);
+    memset(p, 'x', 100000);
+
+    p = sc_arena_calloc(&a, 10, 10);
+    for (int i = 0; i < 100; i++) {
+        assert(p[i] == 0);
+    }
+
+    // Rewind releases the memory allocated after the mark.
+    m = sc_arena_mark(&a);
+    p = sc_arena_alloc(&a, 64);
+    mem = sc_arena_mem(&a);
+    for (int i = 0; i < 100; i++) {
+        assert(sc_arena_alloc(&a, 1000) != NULL);
+    }
+    sc_arena_rewind(&a, m);
+    assert(sc_arena_alloc(&a, 64) == p);
+
+    // Released chunks are reused.
+    mem = sc_arena_mem(&a);
+    for (int i = 0; i < 100; i++) {
+        assert(sc_arena_alloc(&a, 1000) != NULL);
+    }
+    assert(sc_arena_mem(&a) == mem);
+
+    sc_arena_reset(&a);
+    for (int j = 0; j < 10; j++) {
+        for (int i = 0; i < 100; i++) {
+            assert(sc_arena_alloc(&a, 1000) != NULL);
+        }
+        sc_arena_reset(&a);
+    }
+    assert(sc_arena_mem(&a) == mem);
+
+    sc_arena_term(&a);
+    assert(sc_arena_mem(&a) == 0);
+
+    // Mark of an empty arena.
+    sc_arena_init(&a, 64);
+    m = sc_arena_mark(&a);
+    assert(sc_arena_alloc(&a, 10) != NULL);
+    sc_arena_rewind(&a, m);
+    assert(a.chunk == NULL);
+    sc_arena_term(&a);
+}
+
+void test_slab(void)
+{
+    void *p[1000];
+    void *big, *q;
+    struct sc_slab s;
+
+    sc_slab_init(&s);
+    sc_slab_term(&s);
+
+    sc_slab_init(&s);
+    sc_slab_free(&s, NULL, 10);
+
+    for (int i = 0; i < 1000; i++) {
+        size_t size = (size_t) (i * 7) % (SC_SLAB_MAX + 1);
+
+        p[i] = sc_slab_alloc(&s, size);
+        assert(p[i] != NULL);
+        assert(((uintptr_t) p[i] % SC_ARENA_ALIGN) == 0);
+        memset(p[i], i, size);
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        size_t size = (size_t) (i * 7) % (SC_SLAB_MAX + 1);
+        unsigned char *c = p[i];
+
+        for (size_t j = 0; j < size; j++) {
+            assert(c[j] == (unsigned char) i);
+        }
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        sc_slab_free(&s, p[i], (size_t) (i * 7) % (SC_SLAB_MAX + 1));
+    }
+
+    // Same class is reused, LIFO.
+    q = sc_slab_alloc(&s, 20);
+    sc_slab_free(&s, q, 20);
+    assert(sc_slab_alloc(&s, 32) == q);
+    assert(sc_slab_alloc(&s, 33) != q);
+
+    big = sc_slab_alloc(&s, SC_SLAB_MAX + 1);
+    assert(big != NULL);
+    memset(big, 0, SC_SLAB_MAX + 1);
+    sc_slab_free(&s, big, SC_SLAB_MAX + 1);
+
+    sc_slab_term(&s);
+}
+
+void test_hook(void)
+{
+    char *p, *q, *r;
+    struct sc_arena a;
+    struct sc_slab s;
+
+    assert(sc_arena_use(NULL) == NULL);
+    assert(sc_slab_use(NULL) == NULL);
+
+    // Heap
+    assert(sc_arena_hook_malloc(SIZE_MAX) == NULL);
+    assert(sc_arena_hook_calloc(SIZE_MAX / 2, 4) == NULL);
+    sc_arena_hook_free(NULL);
+    p = sc_arena_hook_realloc(NULL, 10);
+    strcpy(p, "test");
+    p = sc_arena_hook_realloc(p, 1000);
+    assert(strcmp(p, "test") == 0);
+    assert(sc_arena_hook_realloc(p, SIZE_MAX) == NULL);
+    sc_arena_hook_free(p);
+
+    // Arena
+    sc_arena_init(&a, 1024);
+    assert(sc_arena_use(&a) == NULL);
+    p = sc_arena_hook_calloc(1, 10);
+    assert(p[9] == 0);
+    strcpy(p, "test");
+
+    // Last allocation grows in place.
+    q = sc_arena_hook_realloc(p, 100);
+    assert(q == p);
+    assert(strcmp(q, "test") == 0);
+    q = sc_arena_hook_realloc(p, 50);
+    assert(q == p);
+
+    r = sc_arena_hook_malloc(10);
+    assert(r != NULL);
+    q = sc_arena_hook_realloc(p, 200);
+    assert(q != p);
+    assert(strcmp(q, "test") == 0);
+
+    // Free of the last allocation releases memory.
+    sc_arena_hook_free(q);
+    assert(sc_arena_hook_malloc(200) == q);
+    sc_arena_hook_free(r);
+
+    // Grows into a new chunk.
+    p = sc_arena_hook_realloc(q, 5000);
+    assert(p != q);
+    assert(strcmp(p, "test") == 0);
+
+    // Slab, arena has priority.
+    sc_slab_init(&s);
+    assert(sc_slab_use(&s) == NULL);
+    assert(sc_arena_use(NULL) == &a);
+
+    q = sc_arena_hook_malloc(10);
+    strcpy(q, "slab");
+    r = sc_arena_hook_realloc(q, 15);
+    assert(r == q);
+    r = sc_arena_hook_realloc(q, 1000);
+    assert(r != q);
+    assert(strcmp(r, "slab") == 0);
+    q = sc_arena_hook_malloc(1000);
+    sc_arena_hook_free(r);
+    sc_arena_hook_free(q);
+    assert(sc_arena_hook_malloc(1000) == q);
+    sc_arena_hook_free(q);
+
+    // Free/realloc work after switching allocator.
+    sc_slab_use(NULL);
+    q = sc_arena_hook_malloc(10);
+    assert(sc_arena_use(&a) == NULL);
+    sc_arena_hook_free(q);
+    q = sc_arena_hook_realloc(p, 6000);
+    assert(strcmp(q, "test") == 0);
+    sc_arena_hook_free(q);
+
+    sc_slab_use(&s);
+    q = sc_arena_hook_malloc(SC_SLAB_MAX * 2);
+    assert(q != NULL);
+    sc_arena_use(NULL);
+    sc_arena_hook_free(q);
+
+    sc_slab_use(NULL);
+    sc_slab_term(&s);
+    sc_arena_term(&a);
+}
+
+#ifdef SC_HAVE_CONFIG_H
+void test_config(void)
+{
+    char *str;
+    struct sc_arena a;
+    struct sc_map_str map;
+    const char *val;
+
+    sc_arena_init(&a, 0);
+    sc_arena_use(&a);
+
+    str = sc_str_create("request");
+    assert(str != NULL);
+    for (int i = 0; i < 1000; i++) {
+        assert(sc_str_append_fmt(&str, "-%d", i));
+    }
+    assert(strncmp(str, "request-0-1-2", 13) == 0);
+
+    assert(sc_map_init_str(&map, 0, 0));
+    assert(sc_map_put_str(&map, "key", str));
+    for (int i = 0; i < 1000; i++) {
+        assert(sc_map_put_str(&map, str + i, "v"));
+    }
+    assert(sc_map_get_str(&map, "key", &val) && val == str);
+    sc_map_term_str(&map);
+    sc_str_destroy(str);
+
+    assert(sc_arena_mem(&a) > 0);
+    sc_arena_use(NULL);
+    sc_arena_reset(&a);
+    sc_arena_term(&a);
+}
+#else
+void test_config(void)
+{
+}
+#endif
+
+int main(void)
+{
+    fail_test();
+    test_arena();
+    test_slab();
+    test_hook();
+    test_config();
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/**
+ * Routes allocations of all modules to sc_arena hooks.
+ *
+ * Compile with -DSC_HAVE_CONFIG_H and add this folder to the include path,
+ * e.g. gcc -DSC_HAVE_CONFIG_H -Iarena arena/sc_arena.c string/sc_str.c ...
+ *
+ * Then select an arena or a slab per thread with sc_arena_use() or
+ * sc_slab_use(), allocations fall back to malloc() when nothing is selected.
+ * Remove the lines of the modules that should keep using malloc(), e.g.
+ * long lived maps while request scoped strings come from an arena.
+ *
+ * sc_arena_malloc/realloc/free are the backing allocator of the arena itself,
+ * don't route them to the hooks.
+ */
+
+#include "sc_arena.h"
+
+#define sc_array_realloc sc_arena_hook_realloc
+#define sc_array_free    sc_arena_hook_free
+
+#define sc_buf_malloc  sc_arena_hook_malloc
+#define sc_buf_realloc sc_arena_hook_realloc
+#define sc_buf_free    sc_arena_hook_free
+
+#define sc_cmap_calloc sc_arena_hook_calloc
+#define sc_cmap_free   sc_arena_hook_free
+
+#define sc_heap_malloc  sc_arena_hook_malloc
+#define sc_heap_realloc sc_arena_hook_realloc
+#define sc_heap_free    sc_arena_hook_free
+
+#define sc_ini_malloc  sc_arena_hook_malloc
+#define sc_ini_realloc sc_arena_hook_realloc
+#define sc_ini_free    sc_arena_hook_free
+
+#define sc_list_malloc sc_arena_hook_malloc
+#define sc_list_free   sc_arena_hook_free
+
+#define sc_map_calloc sc_arena_hook_calloc
+#define sc_map_free   sc_arena_hook_free
+
+#define sc_pool_malloc sc_arena_hook_malloc
+#define sc_pool_free   sc_arena_hook_free
+
+#define sc_queue_realloc sc_arena_hook_realloc
+#define sc_queue_free    sc_arena_hook_free
+
+#define sc_reactor_malloc sc_arena_hook_malloc
+#define sc_reactor_calloc sc_arena_hook_calloc
+#define sc_reactor_free   sc_arena_hook_free
+
+#define sc_ring_malloc sc_arena_hook_malloc
+#define sc_ring_free   sc_arena_hook_free
+
+#define sc_sock_malloc  sc_arena_hook_malloc
+#define sc_sock_realloc sc_arena_hook_realloc
+#define sc_sock_free    sc_arena_hook_free
+
+#define sc_str_malloc  sc_arena_hook_malloc
+#define sc_str_realloc sc_arena_hook_realloc
+#define sc_str_free    sc_arena_hook_free
+
+#define sc_timer_malloc sc_arena_hook_malloc
+#define sc_timer_free   sc_arena_hook_free
+
+#define sc_timer_service_malloc sc_arena_hook_malloc
+#define sc_timer_service_free   sc_arena_hook_free
+
+#define sc_uri_malloc sc_arena_hook_malloc
+#define sc_uri_free   sc_arena_hook_free
+
+#endif
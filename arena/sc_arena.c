@@ -0,0 +1,505 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sc_arena.h"
+
+#include <string.h>
+
+#ifndef thread_local
+    #if __STDC_VERSION__ >= 201112 && !defined __STDC_NO_THREADS__
+        #define thread_local _Thread_local
+    #elif defined _WIN32 && (defined _MSC_VER || defined __ICL ||              \
+                             defined __DMC__ || defined __BORLANDC__)
+        #define thread_local __declspec(thread)
+    #elif defined __GNUC__ || defined __SUNPRO_C || defined __xlC__
+        #define thread_local __thread
+    #else
+        #error "Cannot define  thread_local"
+    #endif
+#endif
+
+#define sc_arena_align(n)                                                      \
+    (((n) + (SC_ARENA_ALIGN - 1)) & ~((size_t) SC_ARENA_ALIGN - 1))
+
+#define sc_arena_max(a, b) ((a) > (b) ? (a) : (b))
+
+// Largest size accepted, leaves room for the headers and alignment.
+#define SC_ARENA_SIZE_MAX (SIZE_MAX / 2)
+
+struct sc_arena_chunk
+{
+    struct sc_arena_chunk *next;
+    size_t cap;
+    size_t used;
+};
+
+#define SC_ARENA_CHUNK_HDR    sc_arena_align(sizeof(struct sc_arena_chunk))
+#define sc_arena_chunk_mem(c) ((char *) (c) + SC_ARENA_CHUNK_HDR)
+
+void sc_arena_init(struct sc_arena *a, size_t chunk_size)
+{
+    *a = (struct sc_arena){
+            .next = chunk_size != 0 ? chunk_size : SC_ARENA_CHUNK,
+    };
+}
+
+static void sc_arena_free_list(struct sc_arena_chunk *c)
+{
+    struct sc_arena_chunk *next;
+
+    while (c != NULL) {
+        next = c->next;
+        sc_arena_free(c);
+        c = next;
+    }
+}
+
+void sc_arena_term(struct sc_arena *a)
+{
+    sc_arena_free_list(a->chunk);
+    sc_arena_free_list(a->spare);
+
+    a->chunk = NULL;
+    a->spare = NULL;
+    a->mem = 0;
+}
+
+static struct sc_arena_chunk *sc_arena_grow(struct sc_arena *a, size_t size)
+{
+    size_t cap;
+    struct sc_arena_chunk *c, **prev = &a->spare;
+
+    // First fit from the released chunks.
+    for (c = a->spare; c != NULL; prev = &c->next, c = c->next) {
+        if (c->cap >= size) {
+            *prev = c->next;
+            goto out;
+        }
+    }
+
+    cap = sc_arena_max(a->next, size);
+
+    c = sc_arena_malloc(SC_ARENA_CHUNK_HDR + cap);
+    if (c == NULL) {
+        return NULL;
+    }
+
+    c->cap = cap;
+    a->mem += cap;
+
+    if (a->next < SC_ARENA_CHUNK_MAX) {
+        a->next *= 2;
+    }
+
+out:
+    c->used = 0;
+    c->next = a->chunk;
+    a->chunk = c;
+
+    return c;
+}
+
+void *sc_arena_alloc(struct sc_arena *a, size_t size)
+{
+    void *p;
+    struct sc_arena_chunk *c = a->chunk;
+
+    if (size > SC_ARENA_SIZE_MAX) {
+        return NULL;
+    }
+
+    size = sc_arena_align(size != 0 ? size : 1);
+
+    if (c == NULL || c->cap - c->used < size) {
+        c = sc_arena_grow(a, size);
+        if (c == NULL) {
+            return NULL;
+        }
+    }
+
+    p = sc_arena_chunk_mem(c) + c->used;
+    c->used += size;
+
+    return p;
+}
+
+void *sc_arena_calloc(struct sc_arena *a, size_t n, size_t size)
+{
+    void *p;
+
+    if (size != 0 && n > SC_ARENA_SIZE_MAX / size) {
+        return NULL;
+    }
+
+    p = sc_arena_alloc(a, n * size);
+    if (p != NULL) {
+        memset(p, 0, n * size);
+    }
+
+    return p;
+}
+
+struct sc_arena_mark sc_arena_mark(struct sc_arena *a)
+{
+    struct sc_arena_mark mark = {a->chunk, 0};
+
+    if (a->chunk != NULL) {
+        mark.used = a->chunk->used;
+    }
+
+    return mark;
+}
+
+void sc_arena_rewind(struct sc_arena *a, struct sc_arena_mark mark)
+{
+    struct sc_arena_chunk *c;
+
+    while (a->chunk != mark.chunk) {
+        c = a->chunk;
+        a->chunk = c->next;
+        c->next = a->spare;
+        a->spare = c;
+    }
+
+    if (a->chunk != NULL) {
+        a->chunk->used = mark.used;
+    }
+}
+
+void sc_arena_reset(struct sc_arena *a)
+{
+    struct sc_arena_mark mark = {NULL, 0};
+    sc_arena_rewind(a, mark);
+}
+
+size_t sc_arena_mem(struct sc_arena *a)
+{
+    return a->mem;
+}
+
+struct sc_slab_page
+{
+    struct sc_slab_page *next;
+};
+
+#define SC_SLAB_PAGE_HDR sc_arena_align(sizeof(struct sc_slab_page))
+
+static uint32_t sc_slab_class(size_t size)
+{
+    uint32_t c = 0;
+
+    if (size <= SC_SLAB_MIN) {
+        return 0;
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+    c = (uint32_t) (sizeof(unsigned long long) * 8) -
+        (uint32_t) __builtin_clzll((unsigned long long) size - 1) - 4;
+#else
+    while (((size_t) SC_SLAB_MIN << c) < size) {
+        c++;
+    }
+#endif
+
+    return c;
+}
+
+static void sc_slab_push(struct sc_slab *s, void *p, uint32_t c)
+{
+    *(void **) p = s->free[c];
+    s->free[c] = p;
+}
+
+static bool sc_slab_grow(struct sc_slab *s)
+{
+    size_t n;
+    uint32_t c;
+    struct sc_slab_page *page;
+
+    page = sc_arena_malloc(SC_SLAB_PAGE_HDR + SC_SLAB_PAGE);
+    if (page == NULL) {
+        return false;
+    }
+
+    // Put the tail of the previous page to free lists of smaller classes.
+    while (s->pos != NULL && s->end - s->pos >= SC_SLAB_MIN) {
+        n = (size_t) (s->end - s->pos);
+        c = sc_slab_class(n);
+        if (((size_t) SC_SLAB_MIN << c) > n) {
+            c--;
+        }
+
+        sc_slab_push(s, s->pos, c);
+        s->pos += (size_t) SC_SLAB_MIN << c;
+    }
+
+    page->next = s->pages;
+    s->pages = page;
+    s->pos = (char *) page + SC_SLAB_PAGE_HDR;
+    s->end = s->pos + SC_SLAB_PAGE;
+
+    return true;
+}
+
+void sc_slab_init(struct sc_slab *s)
+{
+    *s = (struct sc_slab){0};
+}
+
+void sc_slab_term(struct sc_slab *s)
+{
+    struct sc_slab_page *page = s->pages, *next;
+
+    while (page != NULL) {
+        next = page->next;
+        sc_arena_free(page);
+        page = next;
+    }
+
+    sc_slab_init(s);
+}
+
+void *sc_slab_alloc(struct sc_slab *s, size_t size)
+{
+    void *p;
+    size_t n;
+    uint32_t c;
+
+    if (size > SC_SLAB_MAX) {
+        return size > SC_ARENA_SIZE_MAX ? NULL : sc_arena_malloc(size);
+    }
+
+    c = sc_slab_class(size);
+
+    p = s->free[c];
+    if (p != NULL) {
+        s->free[c] = *(void **) p;
+        return p;
+    }
+
+    n = (size_t) SC_SLAB_MIN << c;
+
+    if (s->pos == NULL || (size_t) (s->end - s->pos) < n) {
+        if (!sc_slab_grow(s)) {
+            return NULL;
+        }
+    }
+
+    p = s->pos;
+    s->pos += n;
+
+    return p;
+}
+
+void sc_slab_free(struct sc_slab *s, void *p, size_t size)
+{
+    if (p == NULL) {
+        return;
+    }
+
+    if (size > SC_SLAB_MAX) {
+        sc_arena_free(p);
+        return;
+    }
+
+    sc_slab_push(s, p, sc_slab_class(size));
+}
+
+/**
+ * Hook allocations have a header, 'owner' is the arena or the slab pointer,
+ * slab pointers are tagged with the lowest bit. Zero is sc_arena_malloc().
+ */
+struct sc_arena_hdr
+{
+    uintptr_t owner;
+    size_t size;
+};
+
+#define SC_ARENA_HDR  sc_arena_align(sizeof(struct sc_arena_hdr))
+#define SC_ARENA_SLAB ((uintptr_t) 1u)
+
+#define sc_arena_hdr(p) ((struct sc_arena_hdr *) ((char *) (p) -SC_ARENA_HDR))
+
+static thread_local struct sc_arena *sc_arena_tl;
+static thread_local struct sc_slab *sc_slab_tl;
+
+struct sc_arena *sc_arena_use(struct sc_arena *a)
+{
+    struct sc_arena *prev = sc_arena_tl;
+
+    sc_arena_tl = a;
+    return prev;
+}
+
+struct sc_slab *sc_slab_use(struct sc_slab *s)
+{
+    struct sc_slab *prev = sc_slab_tl;
+
+    sc_slab_tl = s;
+    return prev;
+}
+
+void *sc_arena_hook_malloc(size_t size)
+{
+    uintptr_t owner;
+    struct sc_arena_hdr *hdr;
+
+    if (size > SC_ARENA_SIZE_MAX) {
+        return NULL;
+    }
+
+    if (sc_arena_tl != NULL) {
+        hdr = sc_arena_alloc(sc_arena_tl, SC_ARENA_HDR + size);
+        owner = (uintptr_t) sc_arena_tl;
+    } else if (sc_slab_tl != NULL) {
+        hdr = sc_slab_alloc(sc_slab_tl, SC_ARENA_HDR + size);
+        owner = (uintptr_t) sc_slab_tl | SC_ARENA_SLAB;
+    } else {
+        hdr = sc_arena_malloc(SC_ARENA_HDR + size);
+        owner = 0;
+    }
+
+    if (hdr == NULL) {
+        return NULL;
+    }
+
+    hdr->owner = owner;
+    hdr->size = size;
+
+    return (char *) hdr + SC_ARENA_HDR;
+}
+
+void *sc_arena_hook_calloc(size_t n, size_t size)
+{
+    void *p;
+
+    if (size != 0 && n > SC_ARENA_SIZE_MAX / size) {
+        return NULL;
+    }
+
+    p = sc_arena_hook_malloc(n * size);
+    if (p != NULL) {
+        memset(p, 0, n * size);
+    }
+
+    return p;
+}
+
+/**
+ * Returns true if 'hdr' is the last allocation of the arena.
+ */
+static bool sc_arena_is_last(struct sc_arena *a, struct sc_arena_hdr *hdr)
+{
+    struct sc_arena_chunk *c = a->chunk;
+    size_t size = sc_arena_align(SC_ARENA_HDR + hdr->size);
+
+    return c != NULL && (char *) hdr + size == sc_arena_chunk_mem(c) + c->used;
+}
+
+void sc_arena_hook_free(void *p)
+{
+    struct sc_arena *a;
+    struct sc_arena_hdr *hdr;
+
+    if (p == NULL) {
+        return;
+    }
+
+    hdr = sc_arena_hdr(p);
+
+    if (hdr->owner == 0) {
+        sc_arena_free(hdr);
+    } else if (hdr->owner & SC_ARENA_SLAB) {
+        sc_slab_free((struct sc_slab *) (hdr->owner & ~SC_ARENA_SLAB), hdr,
+                     SC_ARENA_HDR + hdr->size);
+    } else {
+        a = (struct sc_arena *) hdr->owner;
+        if (sc_arena_is_last(a, hdr)) {
+            a->chunk->used -= sc_arena_align(SC_ARENA_HDR + hdr->size);
+        }
+    }
+}
+
+void *sc_arena_hook_realloc(void *p, size_t size)
+{
+    void *n;
+    size_t old, new, cap;
+    struct sc_arena *a;
+    struct sc_arena_hdr *hdr;
+
+    if (p == NULL) {
+        return sc_arena_hook_malloc(size);
+    }
+
+    if (size > SC_ARENA_SIZE_MAX) {
+        return NULL;
+    }
+
+    hdr = sc_arena_hdr(p);
+    old = SC_ARENA_HDR + hdr->size;
+    new = SC_ARENA_HDR + size;
+
+    if (hdr->owner == 0) {
+        hdr = sc_arena_realloc(hdr, new);
+        if (hdr == NULL) {
+            return NULL;
+        }
+
+        hdr->size = size;
+        return (char *) hdr + SC_ARENA_HDR;
+    }
+
+    if (hdr->owner & SC_ARENA_SLAB) {
+        // Fits in the same size class.
+        if (old <= SC_SLAB_MAX && new <= SC_SLAB_MAX &&
+            sc_slab_class(old) == sc_slab_class(new)) {
+            hdr->size = size;
+            return p;
+        }
+    } else {
+        // Last allocation of the arena grows or shrinks in place.
+        a = (struct sc_arena *) hdr->owner;
+        if (sc_arena_is_last(a, hdr)) {
+            old = sc_arena_align(old);
+            new = sc_arena_align(new);
+            cap = a->chunk->cap - a->chunk->used + old;
+
+            if (new <= cap) {
+                a->chunk->used = a->chunk->used - old + new;
+                hdr->size = size;
+                return p;
+            }
+        }
+    }
+
+    n = sc_arena_hook_malloc(size);
+    if (n == NULL) {
+        return NULL;
+    }
+
+    memcpy(n, p, hdr->size < size ? hdr->size : size);
+    sc_arena_hook_free(p);
+
+    return n;
+}
@@ -0,0 +1,228 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_ARENA_H
+#define SC_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#endif
+
+// Backing allocator for chunks/pages, config.h must not route these to the
+// arena hooks.
+#ifndef sc_arena_malloc
+    #define sc_arena_malloc  malloc
+    #define sc_arena_realloc realloc
+    #define sc_arena_free    free
+#endif
+
+// Alignment of returned memory.
+#ifndef SC_ARENA_ALIGN
+    #define SC_ARENA_ALIGN 16
+#endif
+
+// Initial chunk size, chunks grow geometrically up to SC_ARENA_CHUNK_MAX.
+#ifndef SC_ARENA_CHUNK
+    #define SC_ARENA_CHUNK (64 * 1024)
+#endif
+
+#ifndef SC_ARENA_CHUNK_MAX
+    #define SC_ARENA_CHUNK_MAX (1024 * 1024)
+#endif
+
+/**
+ * Bump allocator. Allocation is a pointer increment inside the current chunk,
+ * a new chunk is allocated when it is full. Memory is released all at once
+ * with sc_arena_reset(), or back to a point with sc_arena_rewind(). Released
+ * chunks are kept for reuse until sc_arena_term().
+ *
+ * Not thread-safe, use an arena per thread.
+ */
+struct sc_arena
+{
+    struct sc_arena_chunk *chunk;
+    struct sc_arena_chunk *spare;
+    size_t next;
+    size_t mem;
+};
+
+struct sc_arena_mark
+{
+    struct sc_arena_chunk *chunk;
+    size_t used;
+};
+
+/**
+ * @param a          arena
+ * @param chunk_size initial chunk size, pass 0 for SC_ARENA_CHUNK.
+ */
+void sc_arena_init(struct sc_arena *a, size_t chunk_size);
+
+/**
+ * Release all memory.
+ * @param a arena
+ */
+void sc_arena_term(struct sc_arena *a);
+
+/**
+ * @param a    arena
+ * @param size size
+ * @return     SC_ARENA_ALIGN aligned memory, NULL on out of memory.
+ */
+void *sc_arena_alloc(struct sc_arena *a, size_t size);
+
+/**
+ * @param a    arena
+ * @param n    element count
+ * @param size element size
+ * @return     zeroed memory, NULL on out of memory.
+ */
+void *sc_arena_calloc(struct sc_arena *a, size_t n, size_t size);
+
+/**
+ * @param a arena
+ * @return  current position, pass to sc_arena_rewind() to release memory
+ *          allocated after this call.
+ */
+struct sc_arena_mark sc_arena_mark(struct sc_arena *a);
+
+/**
+ * Release memory allocated after 'mark'.
+ *
+ * @param a    arena
+ * @param mark mark
+ */
+void sc_arena_rewind(struct sc_arena *a, struct sc_arena_mark mark);
+
+/**
+ * Release all allocations, chunks are kept for reuse.
+ * @param a arena
+ */
+void sc_arena_reset(struct sc_arena *a);
+
+/**
+ * @param a arena
+ * @return  total bytes of chunks, including spare chunks.
+ */
+size_t sc_arena_mem(struct sc_arena *a);
+
+/**
+ * Size class allocator. Sizes are rounded up to a power of two between
+ * SC_SLAB_MIN and SC_SLAB_MAX, each class has a free list. Objects are carved
+ * from SC_SLAB_PAGE sized pages. Larger sizes go to sc_arena_malloc().
+ *
+ * Unlike the arena, memory can be freed one by one and it is reused by the
+ * same size class. Pages are released on sc_slab_term(). Not thread-safe, use
+ * a slab per thread.
+ */
+#ifndef SC_SLAB_PAGE
+    #define SC_SLAB_PAGE (64 * 1024)
+#endif
+
+#define SC_SLAB_MIN     16
+#define SC_SLAB_MAX     4096
+#define SC_SLAB_CLASSES 9
+
+struct sc_slab
+{
+    void *free[SC_SLAB_CLASSES];
+    struct sc_slab_page *pages;
+    char *pos;
+    char *end;
+};
+
+/**
+ * @param s slab
+ */
+void sc_slab_init(struct sc_slab *s);
+
+/**
+ * Release all memory. Large allocations must be freed before.
+ * @param s slab
+ */
+void sc_slab_term(struct sc_slab *s);
+
+/**
+ * @param s    slab
+ * @param size size
+ * @return     SC_ARENA_ALIGN aligned memory, NULL on out of memory.
+ */
+void *sc_slab_alloc(struct sc_slab *s, size_t size);
+
+/**
+ * @param s    slab
+ * @param p    memory returned from sc_slab_alloc(), NULL is accepted.
+ * @param size size passed to sc_slab_alloc()
+ */
+void sc_slab_free(struct sc_slab *s, void *p, size_t size);
+
+/**
+ * Allocator hooks, malloc() compatible functions to plug into modules with
+ * SC_HAVE_CONFIG_H, see config.h in this folder.
+ *
+ * Each thread selects an arena or a slab with sc_arena_use()/sc_slab_use(),
+ * hooks allocate from the arena if one is selected, otherwise from the slab,
+ * otherwise from sc_arena_malloc(). Each allocation has a small header that
+ * records its owner, so free and realloc work no matter which allocator is
+ * selected at the time of the call.
+ *
+ * Memory must be freed on the thread that owns the arena/slab. Hook
+ * allocations from an arena are invalid after sc_arena_reset()/rewind(), free
+ * is a no-op unless it is the last allocation of the arena, realloc of the
+ * last allocation grows in place.
+ *
+ * struct sc_arena arena;
+ *
+ * sc_arena_init(&arena, 0);
+ * sc_arena_use(&arena);
+ *
+ * // Handle request, e.g. sc_str, sc_buf, sc_map allocations come from arena.
+ *
+ * sc_arena_use(NULL);
+ * sc_arena_reset(&arena);
+ */
+
+/**
+ * @param a arena for this thread, NULL to unset.
+ * @return  previous arena of this thread.
+ */
+struct sc_arena *sc_arena_use(struct sc_arena *a);
+
+/**
+ * @param s slab for this thread, NULL to unset.
+ * @return  previous slab of this thread.
+ */
+struct sc_slab *sc_slab_use(struct sc_slab *s);
+
+void *sc_arena_hook_malloc(size_t size);
+void *sc_arena_hook_calloc(size_t n, size_t size);
+void *sc_arena_hook_realloc(void *p, size_t size);
+void sc_arena_hook_free(void *p);
+
+#endif
@@ -1,8 +1,10 @@
 #include "sc_array.h"
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 int example()
 {
@@ -181,6 +183,83 @@ void bounds_test()
     sc_array_destroy(arr);
 }
 
+void test_bulk()
+{
+    int *arr, vals[100];
+    double *d, src[10];
+
+    for (int i = 0; i < 100; i++) {
+        vals[i] = i;
+    }
+
+    assert(sc_array_create(arr, 0));
+    assert(sc_array_reserve(arr, 100));
+    assert(sc_array_cap(arr) == 100);
+    assert(sc_array_reserve(arr, 10));
+    assert(sc_array_cap(arr) == 100);
+
+    assert(sc_array_add_n(arr, vals, 10));
+    assert(sc_array_size(arr) == 10);
+    assert(sc_array_add_n(arr, vals + 90, 10));
+    assert(sc_array_insert_n(arr, 10, vals + 10, 80));
+    assert(sc_array_insert_n(arr, 0, vals, 0));
+    assert(sc_array_size(arr) == 100);
+    for (int i = 0; i < 100; i++) {
+        assert(arr[i] == i);
+    }
+
+    // Grows past reserved capacity.
+    assert(sc_array_insert_n(arr, 0, vals, 100));
+    assert(sc_array_size(arr) == 200);
+    assert(arr[0] == 0 && arr[99] == 99 && arr[100] == 0 && arr[199] == 99);
+    assert(sc_array_cap(arr) >= 200);
+
+    assert(sc_array_shrink(arr));
+    assert(sc_array_cap(arr) == 200);
+    assert(sc_array_shrink(arr));
+    assert(arr[199] == 99);
+    sc_array_clear(arr);
+    assert(sc_array_shrink(arr));
+    assert(sc_array_cap(arr) == 0);
+    assert(sc_array_add(arr, 5));
+    assert(arr[0] == 5);
+    sc_array_destroy(arr);
+
+    assert(sc_array_create(arr, 0));
+    assert(sc_array_shrink(arr));
+    assert(sc_array_add_n(arr, vals, 3));
+    sc_array_destroy(arr);
+
+    assert(!sc_array_create_aligned(arr, 0, 48));
+    assert(arr == NULL);
+
+    for (size_t align = 1; align <= 256; align *= 2) {
+        assert(sc_array_create_aligned(d, 0, align));
+        assert(((uintptr_t) d % align) == 0);
+
+        for (int i = 0; i < 1000; i++) {
+            assert(sc_array_add(d, i * 0.5));
+            assert(((uintptr_t) d % align) == 0);
+        }
+
+        assert(sc_array_reserve(d, 5000));
+        assert(((uintptr_t) d % align) == 0);
+        assert(sc_array_shrink(d));
+        assert(((uintptr_t) d % align) == 0);
+        assert(sc_array_cap(d) == 1000);
+        memcpy(src, d, sizeof(src));
+        assert(sc_array_insert_n(d, 500, src, 10));
+        for (int i = 0; i < 10; i++) {
+            assert(d[500 + i] == i * 0.5);
+        }
+        assert(d[1009] == 999 * 0.5);
+        sc_array_clear(d);
+        assert(sc_array_shrink(d));
+        assert(((uintptr_t) d % align) == 0);
+        sc_array_destroy(d);
+    }
+}
+
 #ifdef SC_HAVE_WRAP
 
 bool fail_realloc = false;
@@ -284,6 +363,52 @@ void fail_test()
     assert(arr[0] == 10);
 
     sc_array_destroy(arr);
+
+    int vals[4] = {1, 2, 3, 4};
+    double *d;
+
+    assert(sc_array_create(arr, 0));
+    fail_realloc = true;
+    assert(!sc_array_reserve(arr, 10));
+    assert(!sc_array_add_n(arr, vals, 4));
+    fail_realloc = false;
+    assert(!sc_array_reserve(arr, SIZE_MAX / 8));
+    assert(!sc_array_add_n(arr, vals, SIZE_MAX));
+    assert(sc_array_add_n(arr, vals, 4));
+    assert(sc_array_reserve(arr, 100));
+    fail_realloc = true;
+    assert(!sc_array_shrink(arr));
+    fail_realloc = false;
+    assert(sc_array_size(arr) == 4 && arr[3] == 4);
+    sc_array_destroy(arr);
+
+    fail_realloc = true;
+    assert(!sc_array_create_aligned(d, 10, 64));
+    assert(d == NULL);
+    fail_realloc = false;
+    assert(!sc_array_create_aligned(d, SIZE_MAX, 64));
+    assert(sc_array_create_aligned(d, 2, 64));
+    assert(sc_array_add(d, 1));
+    assert(sc_array_add(d, 2));
+    fail_realloc = true;
+    assert(!sc_array_add(d, 3));
+    fail_realloc = false;
+    assert(sc_array_size(d) == 2 && d[1] == 2);
+    sc_array_destroy(d);
+
+    uint64_t *u;
+
+    assert(sc_array_create(u, 0));
+    for (uint64_t i = 0; i < 100; i++) {
+        assert(sc_array_add(u, 100 - i));
+    }
+    fail_realloc = true;
+    assert(!sc_array_radix_u64(u));
+    fail_realloc = false;
+    assert(u[0] == 100);
+    assert(sc_array_radix_u64(u));
+    assert(u[0] == 1 && u[99] == 100);
+    sc_array_destroy(u);
 }
 
 #else
@@ -292,6 +417,275 @@ void fail_test(void)
 }
 #endif
 
+struct item {
+    int key;
+    int seq;
+};
+
+#define item_less(a, b) ((a).key < (b).key)
+sc_array_of_sort(item, struct item, item_less)
+
+int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+void test_sort(void)
+{
+    size_t idx;
+    uint64_t *u, *ref, mask;
+    int64_t *s, *sref;
+    int32_t *s32;
+    struct item *items, it;
+    size_t sizes[] = {0, 1, 2, 15, 16, 17, 63, 64, 65, 1000, 10000};
+    uint64_t seed = 88172645463325252ull;
+
+    for (size_t t = 0; t < sizeof(sizes) / sizeof(sizes[0]); t++) {
+        const size_t n = sizes[t];
+
+        // Random, few distinct values, sorted, reversed.
+        for (int pattern = 0; pattern < 4; pattern++) {
+            mask = pattern == 1 ? 7 : UINT64_MAX;
+
+            assert(sc_array_create(u, n));
+            assert(sc_array_create(ref, n));
+            assert(sc_array_create(s, n));
+            assert(sc_array_create(sref, n));
+
+            for (size_t i = 0; i < n; i++) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+
+                uint64_t v = pattern == 2 ? i : pattern == 3 ? n - i : seed;
+
+                v &= mask;
+                assert(sc_array_add(u, v));
+                assert(sc_array_add(ref, v));
+                assert(sc_array_add(s, (int64_t) v));
+            }
+
+            qsort(ref, n, sizeof(*ref), cmp_u64);
+            sc_array_sort_u64(u);
+            assert(n == 0 || memcmp(u, ref, n * sizeof(*u)) == 0);
+
+            for (size_t i = 0; i < n; i++) {
+                u[i] = ref[n - i - 1];
+            }
+            assert(sc_array_radix_u64(u));
+            assert(n == 0 || memcmp(u, ref, n * sizeof(*u)) == 0);
+
+            assert(sc_array_add_n(sref, s, n));
+            qsort(sref, n, sizeof(*sref), cmp_i64);
+            sc_array_sort_i64(s);
+            assert(n == 0 || memcmp(s, sref, n * sizeof(*s)) == 0);
+            for (size_t i = 0; i < n; i++) {
+                s[i] = sref[n - i - 1];
+            }
+            assert(sc_array_radix_i64(s));
+            assert(n == 0 || memcmp(s, sref, n * sizeof(*s)) == 0);
+
+            for (size_t i = 0; i < n; i++) {
+                assert(sc_array_bsearch_u64(u, u[i], &idx));
+                assert(u[idx] == u[i] && (idx == 0 || u[idx - 1] < u[i]));
+            }
+            if (n > 0 && u[n - 1] != UINT64_MAX) {
+                assert(!sc_array_bsearch_u64(u, u[n - 1] + 1, &idx));
+                assert(idx == n);
+            }
+
+            sc_array_destroy(u);
+            sc_array_destroy(ref);
+            sc_array_destroy(s);
+            sc_array_destroy(sref);
+        }
+    }
+
+    assert(sc_array_create(u, 0));
+    assert(!sc_array_bsearch_u64(u, 1, &idx));
+    assert(idx == 0);
+    assert(sc_array_add(u, 10));
+    assert(sc_array_add(u, 20));
+    assert(sc_array_add(u, 20));
+    assert(sc_array_add(u, 30));
+    assert(sc_array_lower_bound_u64(u, 5) == 0);
+    assert(sc_array_lower_bound_u64(u, 10) == 0);
+    assert(sc_array_lower_bound_u64(u, 15) == 1);
+    assert(sc_array_lower_bound_u64(u, 20) == 1);
+    assert(sc_array_lower_bound_u64(u, 30) == 3);
+    assert(sc_array_lower_bound_u64(u, 31) == 4);
+    assert(!sc_array_bsearch_u64(u, 25, &idx));
+    assert(idx == 3);
+    sc_array_destroy(u);
+
+    // Negative values sort first.
+    assert(sc_array_create(s32, 0));
+    for (int32_t i = -100; i < 100; i++) {
+        assert(sc_array_add(s32, i * 7919 % 201));
+    }
+    assert(sc_array_radix_i32(s32));
+    for (size_t i = 1; i < sc_array_size(s32); i++) {
+        assert(s32[i - 1] <= s32[i]);
+    }
+    assert(s32[0] < 0);
+    sc_array_destroy(s32);
+
+    // Custom type and comparison, many equal keys.
+    assert(sc_array_create(items, 0));
+    for (int i = 0; i < 10000; i++) {
+        it = (struct item){.key = (i * 31) % 3, .seq = i};
+        assert(sc_array_add(items, it));
+    }
+    sc_array_sort_item(items);
+    for (size_t i = 1; i < sc_array_size(items); i++) {
+        assert(items[i - 1].key <= items[i].key);
+    }
+    assert(sc_array_bsearch_item(items, (struct item){.key = 1}, &idx));
+    assert(items[idx].key == 1 && items[idx - 1].key == 0);
+
+    // Heapsort fallback when the depth limit is hit.
+    for (int i = 0; i < 10000; i++) {
+        items[i].key = (i * 7919) % 10007;
+    }
+    sc_array_qsort_item(items, sc_array_size(items), 0);
+    for (size_t i = 1; i < sc_array_size(items); i++) {
+        assert(items[i - 1].key <= items[i].key);
+    }
+    sc_array_destroy(items);
+}
+
+#ifdef SC_ARRAY_HAVE_POOL
+static void par_square(void *arg, size_t begin, size_t end)
+{
+    uint64_t *arr = arg;
+
+    for (size_t i = begin; i < end; i++) {
+        arr[i] = arr[i] * arr[i];
+    }
+}
+
+void test_par(void)
+{
+    uint64_t *u, *ref;
+    int *v;
+    uint64_t seed = 88172645463325252ull;
+    size_t sizes[] = {0, 1, SC_ARRAY_PAR_GRAIN, SC_ARRAY_PAR_GRAIN + 1,
+                      SC_ARRAY_PAR_GRAIN * 5 + 3, 10000};
+    struct sc_pool pool;
+
+    for (uint32_t threads = 1; threads <= 4; threads *= 4) {
+        assert(sc_pool_init(&pool, threads, false) == 0);
+
+        for (size_t t = 0; t < sizeof(sizes) / sizeof(sizes[0]); t++) {
+            const size_t n = sizes[t];
+
+            assert(sc_array_create(u, n));
+            assert(sc_array_create(ref, n));
+            for (size_t i = 0; i < n; i++) {
+                seed ^= seed << 13;
+                seed ^= seed >> 7;
+                seed ^= seed << 17;
+                assert(sc_array_add(u, (seed % 1000) * (i % 3)));
+            }
+            assert(sc_array_add_n(ref, u, n));
+
+            assert(sc_array_par_sort_u64(&pool, u));
+            sc_array_sort_u64(ref);
+            assert(n == 0 || memcmp(u, ref, n * sizeof(*u)) == 0);
+
+            sc_array_par_for(&pool, u, 0, par_square, u);
+            for (size_t i = 0; i < n; i++) {
+                assert(u[i] == ref[i] * ref[i]);
+            }
+
+            sc_array_destroy(u);
+            sc_array_destroy(ref);
+        }
+
+        // Sorted and reversed input.
+        assert(sc_array_create(v, 0));
+        for (int i = 0; i < 20000; i++) {
+            assert(sc_array_add(v, 20000 - i));
+        }
+        assert(sc_array_par_sort_int(&pool, v));
+        for (int i = 0; i < 20000; i++) {
+            assert(v[i] == i + 1);
+        }
+        assert(sc_array_par_sort_int(&pool, v));
+        for (int i = 0; i < 20000; i++) {
+            assert(v[i] == i + 1);
+        }
+        sc_array_destroy(v);
+
+        assert(sc_pool_term(&pool) == 0);
+    }
+}
+#else
+void test_par(void)
+{
+}
+#endif
+
+void test_wrap(void)
+{
+    int *arr, vals[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint64_t *u;
+    unsigned char mem[sc_array_mem_size(int, 4)];
+    unsigned char mem64[sc_array_mem_size(uint64_t, 16) + 1];
+
+    assert(!sc_array_wrap(arr, mem, sizeof(struct sc_array)));
+    assert(arr == NULL);
+
+    assert(sc_array_wrap(arr, mem, sizeof(mem)));
+    assert(sc_array_cap(arr) >= 4);
+    assert(((uintptr_t) arr % SC_ARRAY_MEM_ALIGN) == 0);
+
+    for (int i = 0; sc_array_size(arr) < sc_array_cap(arr); i++) {
+        assert(sc_array_add(arr, i));
+    }
+
+    // Full, nothing is allocated.
+    assert(!sc_array_add(arr, 100));
+    assert(!sc_array_add_n(arr, vals, 2));
+    assert(!sc_array_reserve(arr, sc_array_cap(arr) + 1));
+    assert(sc_array_reserve(arr, 2));
+    for (size_t i = 0; i < sc_array_size(arr); i++) {
+        assert(arr[i] == (int) i);
+    }
+
+    sc_array_del(arr, 0);
+    assert(sc_array_insert_n(arr, 0, vals, 1));
+    assert(arr[0] == 1);
+    assert(sc_array_shrink(arr));
+    assert(sc_array_cap(arr) >= 4);
+
+    sc_array_clear(arr);
+    assert(sc_array_add_n(arr, vals, 4));
+    sc_array_destroy(arr);
+    assert(arr == NULL);
+
+    // Unaligned memory.
+    assert(sc_array_wrap(u, mem64 + 1, sizeof(mem64) - 1));
+    assert(((uintptr_t) u % SC_ARRAY_MEM_ALIGN) == 0);
+    assert(sc_array_cap(u) == 16);
+    for (uint64_t i = 0; i < 16; i++) {
+        assert(sc_array_add(u, 16 - i));
+    }
+    assert(!sc_array_add(u, 0));
+    sc_array_sort_u64(u);
+    assert(u[0] == 1 && u[15] == 16);
+    sc_array_destroy(u);
+}
+
 int main(int argc, char *argv[])
 {
     (void) argc;
@@ -302,6 +696,10 @@ int main(int argc, char *argv[])
     test2();
     fail_test();
     bounds_test();
+    test_bulk();
+    test_wrap();
+    test_sort();
+    test_par();
 
     return 0;
 }
@@ -24,10 +24,18 @@
 
 #include "sc_array.h"
 
+#include <string.h>
+
 #ifndef SC_SIZE_MAX
     #define SC_SIZE_MAX SIZE_MAX
 #endif
 
+#ifdef SC_STATS
+    #include "sc_stats.h"
+#elif !defined(SC_STATS_ADD)
+    #define SC_STATS_ADD(name, n) ((void) (n))
+    #define SC_STATS_MAX(name, v) ((void) (v))
+#endif
 
 /**
  * Empty array instance.
@@ -36,78 +44,273 @@
  */
 static const struct sc_array sc_empty = {.size = 0, .cap = 0};
 
-bool sc_array_init(void *arr, size_t elem_size, size_t cap)
+// 'off' of arrays in caller memory, they never allocate or free.
+#define SC_ARRAY_REF SIZE_MAX
+
+/**
+ * Allocates an array with 'elems' aligned to 'align'. Memory before the
+ * header is padding, 'off' is the distance to the start of the allocation.
+ */
+static struct sc_array *sc_array_alloc(size_t elem_size, size_t cap,
+                                       size_t align)
+{
+    size_t bytes, pad;
+    char *mem;
+    struct sc_array *meta;
+
+    bytes = sizeof(*meta) + (elem_size * cap) + (align - 1);
+    mem = sc_array_realloc(NULL, bytes);
+    if (mem == NULL) {
+        return NULL;
+    }
+
+    pad = (align - ((uintptr_t) (mem + sizeof(*meta)) & (align - 1))) &
+          (align - 1);
+
+    meta = (struct sc_array *) (void *) (mem + pad);
+    meta->size = 0;
+    meta->cap = cap;
+    meta->align = align;
+    meta->off = pad;
+
+    return meta;
+}
+
+static void sc_array_release(struct sc_array *meta)
+{
+    if (meta != &sc_empty && meta->off != SC_ARRAY_REF) {
+        sc_array_free((char *) meta - meta->off);
+    }
+}
+
+/**
+ * Sets capacity to 'cap', 'cap' must not be less than the element count.
+ */
+static bool sc_array_resize(void *arr, size_t elem_size, size_t cap)
 {
     const size_t max = SC_SIZE_MAX / elem_size;
     size_t bytes;
     void **p = arr;
-    struct sc_array *meta;
+    struct sc_array *prev = sc_array_meta(*p), *meta;
+
+    // Check overflow
+    if (cap > max) {
+        return false;
+    }
+
+    // Fixed capacity, only requests that already fit succeed.
+    if (prev->off == SC_ARRAY_REF) {
+        return cap <= prev->cap;
+    }
+
+    if (prev->align != 0) {
+        // Aligned arrays are copied, realloc() may change the alignment.
+        meta = sc_array_alloc(elem_size, cap, prev->align);
+        if (meta == NULL) {
+            return false;
+        }
+
+        memcpy(meta->elems, prev->elems, prev->size * elem_size);
+        meta->size = prev->size;
+        sc_array_release(prev);
+        *p = meta->elems;
+        return true;
+    }
 
     if (cap == 0) {
+        sc_array_release(prev);
         *p = (void *) sc_empty.elems;
         return true;
     }
 
+    bytes = sizeof(*meta) + (elem_size * cap);
+    meta = sc_array_realloc(prev != &sc_empty ? prev : NULL, bytes);
+    if (meta == NULL) {
+        return false;
+    }
+
+    if (prev == &sc_empty) {
+        meta->size = 0;
+        meta->align = 0;
+        meta->off = 0;
+    }
+
+    meta->cap = cap;
+    *p = meta->elems;
+
+    return true;
+}
+
+/**
+ * Grows capacity geometrically to hold at least 'need' elements.
+ */
+static bool sc_array_grow(void *arr, size_t elem_size, size_t need)
+{
+    const size_t max = SC_SIZE_MAX / elem_size;
+    size_t cap;
+    void **p = arr;
+    struct sc_array *meta = sc_array_meta(*p);
+
+    if (need <= meta->cap) {
+        return true;
+    }
+
     // Check overflow
-    if (cap > max) {
-        *p = NULL;
+    if (need > max) {
         return false;
     }
 
-    bytes = sizeof(*meta) + (elem_size * cap);
-    meta = sc_array_realloc(NULL, bytes);
+    cap = meta->cap != 0 ? meta->cap : 1;
+    cap = cap > max / 2 ? max : cap * 2;
+
+    return sc_array_resize(arr, elem_size, cap > need ? cap : need);
+}
+
+bool sc_array_init(void *arr, size_t elem_size, size_t cap)
+{
+    return sc_array_init_aligned(arr, elem_size, cap, 0);
+}
+
+bool sc_array_init_aligned(void *arr, size_t elem_size, size_t cap,
+                           size_t align)
+{
+    const size_t max = SC_SIZE_MAX / elem_size;
+    void **p = arr;
+    struct sc_array *meta;
+
+    *p = NULL;
+
+    // Check overflow and alignment
+    if (cap > max || (align & (align - 1)) != 0) {
+        return false;
+    }
+
+    if (align == 0) {
+        *p = (void *) sc_empty.elems;
+        if (!sc_array_resize(arr, elem_size, cap)) {
+            *p = NULL;
+            return false;
+        }
+
+        return true;
+    }
+
+    // Header is placed right before 'elems', it needs size_t alignment.
+    if (align < sizeof(size_t)) {
+        align = sizeof(size_t);
+    }
+
+    meta = sc_array_alloc(elem_size, cap, align);
     if (meta == NULL) {
-        *p = NULL;
         return false;
     }
 
+    *p = meta->elems;
+
+    return true;
+}
+
+bool sc_array_init_mem(void *arr, size_t elem_size, void *mem, size_t len)
+{
+    size_t pad;
+    void **p = arr;
+    struct sc_array *meta;
+
+    *p = NULL;
+
+    pad = (SC_ARRAY_MEM_ALIGN - ((uintptr_t) mem & (SC_ARRAY_MEM_ALIGN - 1))) &
+          (SC_ARRAY_MEM_ALIGN - 1);
+
+    if (len < pad + sizeof(*meta) + elem_size) {
+        return false;
+    }
+
+    meta = (struct sc_array *) (void *) ((char *) mem + pad);
     meta->size = 0;
-    meta->cap = cap;
+    meta->cap = (len - pad - sizeof(*meta)) / elem_size;
+    meta->align = 0;
+    meta->off = SC_ARRAY_REF;
     *p = meta->elems;
 
     return true;
 }
 
 void sc_array_term(void *arr)
+{
+    void **p = arr;
+
+    sc_array_release(sc_array_meta(*p));
+    *p = NULL;
+}
+
+bool sc_array_expand(void *arr, size_t elem_size)
 {
     void **p = arr;
     struct sc_array *meta = sc_array_meta(*p);
 
-    if (meta != &sc_empty) {
-        sc_array_free(meta);
+    if (meta->size < meta->cap) {
+        return true;
     }
 
-    *p = NULL;
+    // Check overflow, array only doubles
+    if (meta->off == SC_ARRAY_REF ||
+        meta->cap > (SC_SIZE_MAX / elem_size) / 2) {
+        return false;
+    }
+
+    SC_STATS_ADD("array.expand", 1);
+
+    return sc_array_resize(arr, elem_size, meta->cap != 0 ? meta->cap * 2 : 2);
 }
 
-bool sc_array_expand(void *arr, size_t elem_size)
+bool sc_array_reserve_cap(void *arr, size_t elem_size, size_t cap)
 {
-    const size_t max = SC_SIZE_MAX / elem_size;
-    size_t size, cap, bytes;
     void **p = arr;
-    struct sc_array *prev, *meta = sc_array_meta(*p);
+
+    if (cap <= sc_array_meta(*p)->cap) {
+        return true;
+    }
+
+    return sc_array_resize(arr, elem_size, cap);
+}
+
+bool sc_array_shrink_cap(void *arr, size_t elem_size)
+{
+    void **p = arr;
+    struct sc_array *meta = sc_array_meta(*p);
 
     if (meta->size == meta->cap) {
+        return true;
+    }
 
-        // Check overflow
-        if (meta->cap > max / 2) {
-            return false;
-        }
+    return sc_array_resize(arr, elem_size, meta->size);
+}
 
-        size = meta->size;
-        cap = (meta != &sc_empty) ? meta->cap * 2 : 2;
-        prev = (meta != &sc_empty) ? meta : NULL;
+bool sc_array_insert_mem(void *arr, size_t elem_size, size_t i,
+                         const void *elems, size_t n)
+{
+    void **p = arr;
+    unsigned char *e;
+    struct sc_array *meta = sc_array_meta(*p);
 
-        bytes = sizeof(*meta) + (elem_size * cap);
-        meta = sc_array_realloc(prev, bytes);
-        if (meta == NULL) {
-            return false;
-        }
+    assert(i <= meta->size);
 
-        meta->size = size;
-        meta->cap = cap;
-        *p = meta->elems;
+    if (n == 0) {
+        return true;
     }
 
+    if (n > SIZE_MAX - meta->size ||
+        !sc_array_grow(arr, elem_size, meta->size + n)) {
+        return false;
+    }
+
+    meta = sc_array_meta(*p);
+    e = meta->elems;
+
+    memmove(e + (i + n) * elem_size, e + i * elem_size,
+            (meta->size - i) * elem_size);
+    memcpy(e + i * elem_size, elems, n * elem_size);
+    meta->size += n;
+
     return true;
 }
@@ -44,15 +44,27 @@ struct sc_array
 {
     size_t size;
     size_t cap;
+    size_t align;
+    size_t off;
     unsigned char elems[];
 };
 
+// Alignment of the header and elements in sc_array_wrap() memory.
+#define SC_ARRAY_MEM_ALIGN 16
+
 #define sc_array_meta(arr)                                                     \
     ((struct sc_array *) ((char *) (arr) -offsetof(struct sc_array, elems)))
 
 bool sc_array_init(void *arr, size_t elem_size, size_t cap);
+bool sc_array_init_aligned(void *arr, size_t elem_size, size_t cap,
+                           size_t align);
+bool sc_array_init_mem(void *arr, size_t elem_size, void *mem, size_t len);
 void sc_array_term(void *arr);
 bool sc_array_expand(void *arr, size_t elem_size);
+bool sc_array_reserve_cap(void *arr, size_t elem_size, size_t cap);
+bool sc_array_shrink_cap(void *arr, size_t elem_size);
+bool sc_array_insert_mem(void *arr, size_t elem_size, size_t i,
+                         const void *elems, size_t n);
 // Internals end
 
 /**
@@ -62,6 +74,47 @@ bool sc_array_expand(void *arr, size_t elem_size);
  */
 #define sc_array_create(arr, cap) sc_array_init(&(arr), sizeof(*(arr)), cap)
 
+/**
+ *   Create array, 'elems' is aligned to 'align' bytes and stays aligned as
+ *   the array grows, e.g for SIMD loads.
+ *
+ *   @param arr   array
+ *   @param cap   initial capacity. '0' is a valid initial capacity.
+ *   @param align alignment, power of two, e.g 32 or 64.
+ *   @return      'true' on success, 'false' on out of memory or if 'align' is
+ *                not a power of two.
+ */
+#define sc_array_create_aligned(arr, cap, align)                               \
+    sc_array_init_aligned(&(arr), sizeof(*(arr)), cap, align)
+
+/**
+ *   Bytes of memory for a fixed capacity array of 'cap' elements of type 'T',
+ *   header and alignment padding included, e.g for a stack buffer :
+ *
+ *   int *arr;
+ *   unsigned char mem[sc_array_mem_size(int, 64)];
+ *
+ *   sc_array_wrap(arr, mem, sizeof(mem));
+ */
+#define sc_array_mem_size(T, cap)                                              \
+    (sizeof(struct sc_array) + SC_ARRAY_MEM_ALIGN - 1 + sizeof(T) * (cap))
+
+/**
+ *   Create a fixed capacity array in caller provided memory, e.g stack or
+ *   memory allocated at startup. Array never allocates : adding elements
+ *   fails when it is full, capacity does not change with reserve or shrink,
+ *   sc_array_destroy() does not free 'mem'. Sort functions do not allocate
+ *   either, except sc_array_radix_<name>().
+ *
+ *   @param arr array
+ *   @param mem memory, must outlive the array.
+ *   @param len length of 'mem', capacity is what fits after the header.
+ *   @return    'true' on success, 'false' if 'mem' is too small for one
+ *              element.
+ */
+#define sc_array_wrap(arr, mem, len)                                           \
+    sc_array_init_mem(&(arr), sizeof(*(arr)), mem, len)
+
 /**
  *   @param arr array to be destroyed
  */
@@ -85,15 +138,59 @@ bool sc_array_expand(void *arr, size_t elem_size);
  */
 #define sc_array_clear(arr) (sc_array_meta((arr))->size = 0)
 
+/**
+ *   Reserve capacity for at least 'cap' elements.
+ *
+ *   @param arr array
+ *   @param cap capacity
+ *   @return    'true' on success, 'false' on out of memory.
+ */
+#define sc_array_reserve(arr, cap)                                             \
+    sc_array_reserve_cap(&(arr), sizeof(*(arr)), cap)
+
+/**
+ *   Shrink capacity to current element count.
+ *
+ *   @param arr array
+ *   @return    'true' on success, 'false' on out of memory.
+ */
+#define sc_array_shrink(arr) sc_array_shrink_cap(&(arr), sizeof(*(arr)))
+
+/**
+ *   Insert 'n' elements at index 'i', elements after 'i' are moved once.
+ *
+ *   @param arr   array
+ *   @param i     index, must be less than or equal to the element count.
+ *   @param elems elements to copy, pointer to the same type as 'arr', must
+ *                not point into 'arr'.
+ *   @param n     element count
+ *   @return      'true' on success, 'false' on out of memory.
+ */
+#define sc_array_insert_n(arr, i, elems, n)                                    \
+    ((void) sizeof((arr)[0] = (elems)[0]),                                     \
+     sc_array_insert_mem(&(arr), sizeof(*(arr)), i, elems, n))
+
+/**
+ *   Append 'n' elements.
+ *
+ *   @param arr   array
+ *   @param elems elements to copy, pointer to the same type as 'arr', must
+ *                not point into 'arr'.
+ *   @param n     element count
+ *   @return      'true' on success, 'false' on out of memory.
+ */
+#define sc_array_add_n(arr, elems, n)                                          \
+    sc_array_insert_n(arr, sc_array_size(arr), elems, n)
+
 /**
  *   @param arr  array
  *   @param elem element to be appended
  *   @return     'true' on success, 'false' on out of memory.
  */
 #define sc_array_add(arr, elem)                                                \
-    sc_array_expand(&((arr)), sizeof(*(arr))) == true ?                        \
-            (arr)[sc_array_meta(arr)->size++] = (elem),                        \
-            true : false
+    (sc_array_expand(&((arr)), sizeof(*(arr))) == true ?                       \
+             (arr)[sc_array_meta(arr)->size++] = (elem),                       \
+             true : false)
 
 /**
  *   @param arr array
@@ -143,6 +240,474 @@ bool sc_array_expand(void *arr, size_t elem_size);
 #define sc_array_sort(arr, cmp)                                                \
     (qsort((arr), sc_array_size((arr)), sizeof(*(arr)), cmp))
 
+/**
+ *   Type specialized sort and binary search. Unlike sc_array_sort(), the
+ *   comparison is inlined, there is no function call per comparison.
+ *
+ *   sc_array_of_sort(name, T, less) generates for 'T *' arrays :
+ *
+ *   void sc_array_sort_<name>(T *arr);
+ *       Introsort, not stable. 'less(a, b)' is a macro or a function that
+ *       returns non-zero if 'a' is ordered before 'b'.
+ *
+ *   size_t sc_array_lower_bound_<name>(T *arr, T key);
+ *       Index of the first element which is not less than 'key', array size
+ *       if there is no such element. Array must be sorted.
+ *
+ *   bool sc_array_bsearch_<name>(T *arr, T key, size_t *idx);
+ *       'true' if 'key' is found. 'idx' is set to the lower bound.
+ *
+ *   sc_array_of_radix(name, T) generates for integer types :
+ *
+ *   bool sc_array_radix_<name>(T *arr);
+ *       LSD radix sort, stable. Allocates a temporary copy of the array,
+ *       returns 'false' on out of memory. Faster than comparison sort for
+ *       large arrays.
+ *
+ *   Predefined : int, u32, u64, i64, double sorts and u32, u64, i32, i64
+ *   radix sorts, e.g.
+ *
+ *   uint64_t *arr;
+ *   sc_array_create(arr, 0);
+ *   ...
+ *   sc_array_sort_u64(arr);
+ *   found = sc_array_bsearch_u64(arr, 100, &idx);
+ *
+ *   struct item *items; // Sort by item->id
+ *   #define item_less(a, b) ((a).id < (b).id)
+ *   sc_array_of_sort(item, struct item, item_less)
+ */
+#define sc_array_less(a, b) ((a) < (b))
+
+#define sc_array_of_sort(name, T, less)                                        \
+                                                                               \
+    static inline void sc_array_isort_##name(T *a, size_t n)                   \
+    {                                                                          \
+        for (size_t i = 1; i < n; i++) {                                       \
+            T x = a[i];                                                        \
+            size_t j = i;                                                      \
+                                                                               \
+            for (; j > 0 && less(x, a[j - 1]); j--) {                          \
+                a[j] = a[j - 1];                                               \
+            }                                                                  \
+            a[j] = x;                                                          \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static inline void sc_array_sift_##name(T *a, size_t i, size_t n)          \
+    {                                                                          \
+        T x = a[i];                                                            \
+        size_t c;                                                              \
+                                                                               \
+        while ((c = 2 * i + 1) < n) {                                          \
+            if (c + 1 < n && less(a[c], a[c + 1])) {                           \
+                c++;                                                           \
+            }                                                                  \
+            if (!less(x, a[c])) {                                              \
+                break;                                                         \
+            }                                                                  \
+            a[i] = a[c];                                                       \
+            i = c;                                                             \
+        }                                                                      \
+        a[i] = x;                                                              \
+    }                                                                          \
+                                                                               \
+    static inline void sc_array_hsort_##name(T *a, size_t n)                   \
+    {                                                                          \
+        T tmp;                                                                 \
+                                                                               \
+        for (size_t i = n / 2; i > 0; i--) {                                   \
+            sc_array_sift_##name(a, i - 1, n);                                 \
+        }                                                                      \
+        for (size_t i = n - 1; i > 0; i--) {                                   \
+            tmp = a[0];                                                        \
+            a[0] = a[i];                                                       \
+            a[i] = tmp;                                                        \
+            sc_array_sift_##name(a, 0, i);                                     \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static inline void sc_array_qsort_##name(T *a, size_t n, int depth)        \
+    {                                                                          \
+        T pivot, tmp;                                                          \
+        size_t i, j, m;                                                        \
+                                                                               \
+        while (n > 16) {                                                       \
+            if (depth-- == 0) {                                                \
+                sc_array_hsort_##name(a, n);                                   \
+                return;                                                        \
+            }                                                                  \
+                                                                               \
+            /* Median of three, first and last become sentinels. */            \
+            m = n / 2;                                                         \
+            if (less(a[m], a[0])) {                                            \
+                tmp = a[m], a[m] = a[0], a[0] = tmp;                           \
+            }                                                                  \
+            if (less(a[n - 1], a[m])) {                                        \
+                tmp = a[m], a[m] = a[n - 1], a[n - 1] = tmp;                   \
+                if (less(a[m], a[0])) {                                        \
+                    tmp = a[m], a[m] = a[0], a[0] = tmp;                       \
+                }                                                              \
+            }                                                                  \
+                                                                               \
+            pivot = a[m];                                                      \
+            i = 0;                                                             \
+            j = n - 1;                                                         \
+            for (;;) {                                                         \
+                while (less(a[++i], pivot)) {                                  \
+                }                                                              \
+                while (less(pivot, a[--j])) {                                  \
+                }                                                              \
+                if (i >= j) {                                                  \
+                    break;                                                     \
+                }                                                              \
+                tmp = a[i], a[i] = a[j], a[j] = tmp;                           \
+            }                                                                  \
+                                                                               \
+            /* Recurse into the smaller part, loop on the larger one. */       \
+            if (i < n - i) {                                                   \
+                sc_array_qsort_##name(a, i, depth);                            \
+                a += i;                                                        \
+                n -= i;                                                        \
+            } else {                                                           \
+                sc_array_qsort_##name(a + i, n - i, depth);                    \
+                n = i;                                                         \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        sc_array_isort_##name(a, n);                                           \
+    }                                                                          \
+                                                                               \
+    static inline void sc_array_sort_n_##name(T *a, size_t n)                  \
+    {                                                                          \
+        int depth = 0;                                                         \
+                                                                               \
+        for (size_t k = n; k > 1; k >>= 1) {                                   \
+            depth += 2;                                                        \
+        }                                                                      \
+        sc_array_qsort_##name(a, n, depth);                                    \
+    }                                                                          \
+                                                                               \
+    static inline void sc_array_sort_##name(T *arr)                            \
+    {                                                                          \
+        sc_array_sort_n_##name(arr, sc_array_size(arr));                       \
+    }                                                                          \
+                                                                               \
+    static inline size_t sc_array_lower_bound_n_##name(const T *a, size_t n,   \
+                                                        T key)                 \
+    {                                                                          \
+        size_t len = n, half;                                                  \
+        const T *base = a;                                                     \
+                                                                               \
+        if (len == 0) {                                                        \
+            return 0;                                                          \
+        }                                                                      \
+                                                                               \
+        /* Branchless, the compiler emits a conditional move. */               \
+        while (len > 1) {                                                      \
+            half = len / 2;                                                    \
+            base = less(base[half - 1], key) ? base + half : base;             \
+            len -= half;                                                       \
+        }                                                                      \
+                                                                               \
+        return (size_t) (base - a) + (less(*base, key) ? 1 : 0);               \
+    }                                                                          \
+                                                                               \
+    static inline size_t sc_array_lower_bound_##name(T *arr, T key)            \
+    {                                                                          \
+        return sc_array_lower_bound_n_##name(arr, sc_array_size(arr), key);    \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_array_bsearch_##name(T *arr, T key, size_t *idx)     \
+    {                                                                          \
+        size_t i = sc_array_lower_bound_##name(arr, key);                      \
+                                                                               \
+        *idx = i;                                                              \
+        return i < sc_array_size(arr) && !less(key, arr[i]);                   \
+    }
+
+#define sc_array_of_radix(name, T)                                             \
+                                                                               \
+    static inline uint64_t sc_array_key_##name(T x)                            \
+    {                                                                          \
+        /* Flip the sign bit of signed types, negatives sort first. */         \
+        const uint64_t flip = ((T) -1 < (T) 1) ?                               \
+                                      (uint64_t) 1 << (sizeof(T) * 8 - 1) :    \
+                                      0;                                       \
+        const uint64_t mask = ~(uint64_t) 0 >> (64 - sizeof(T) * 8);           \
+                                                                               \
+        return ((uint64_t) x ^ flip) & mask;                                   \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_array_radix_##name(T *arr)                           \
+    {                                                                          \
+        size_t count[sizeof(T)][256] = {{0}};                                  \
+        size_t n = sc_array_size(arr), pos, c;                                 \
+        T *src = arr, *dst, *tmp, x;                                           \
+        uint64_t k;                                                            \
+                                                                               \
+        if (n < 64) {                                                          \
+            for (size_t i = 1; i < n; i++) {                                   \
+                size_t j = i;                                                  \
+                                                                               \
+                x = arr[i];                                                    \
+                k = sc_array_key_##name(x);                                    \
+                for (; j > 0 && k < sc_array_key_##name(arr[j - 1]); j--) {    \
+                    arr[j] = arr[j - 1];                                       \
+                }                                                              \
+                arr[j] = x;                                                    \
+            }                                                                  \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        tmp = sc_array_realloc(NULL, n * sizeof(T));                           \
+        if (tmp == NULL) {                                                     \
+            return false;                                                      \
+        }                                                                      \
+        dst = tmp;                                                             \
+                                                                               \
+        /* Histograms of all digits in a single pass. */                       \
+        for (size_t i = 0; i < n; i++) {                                       \
+            k = sc_array_key_##name(arr[i]);                                   \
+            for (size_t d = 0; d < sizeof(T); d++) {                           \
+                count[d][(k >> (d * 8)) & 0xff]++;                             \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        for (size_t d = 0; d < sizeof(T); d++) {                               \
+            /* Skip the digit if all keys have the same value. */              \
+            if (count[d][(sc_array_key_##name(src[0]) >> (d * 8)) & 0xff] ==   \
+                n) {                                                           \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            pos = 0;                                                           \
+            for (size_t b = 0; b < 256; b++) {                                 \
+                c = count[d][b];                                               \
+                count[d][b] = pos;                                             \
+                pos += c;                                                      \
+            }                                                                  \
+                                                                               \
+            for (size_t i = 0; i < n; i++) {                                   \
+                k = sc_array_key_##name(src[i]);                               \
+                dst[count[d][(k >> (d * 8)) & 0xff]++] = src[i];               \
+            }                                                                  \
+                                                                               \
+            T *swap = src;                                                     \
+            src = dst;                                                         \
+            dst = swap;                                                        \
+        }                                                                      \
+                                                                               \
+        if (src != arr) {                                                      \
+            memcpy(arr, src, n * sizeof(T));                                   \
+        }                                                                      \
+        sc_array_free(tmp);                                                    \
+                                                                               \
+        return true;                                                           \
+    }
+
+sc_array_of_sort(int, int, sc_array_less)
+sc_array_of_sort(u32, uint32_t, sc_array_less)
+sc_array_of_sort(u64, uint64_t, sc_array_less)
+sc_array_of_sort(i64, int64_t, sc_array_less)
+sc_array_of_sort(double, double, sc_array_less)
+
+sc_array_of_radix(u32, uint32_t)
+sc_array_of_radix(u64, uint64_t)
+sc_array_of_radix(i32, int32_t)
+sc_array_of_radix(i64, int64_t)
+
+#ifdef SC_ARRAY_HAVE_POOL
+    #include "sc_pool.h"
+
+// Ranges smaller than this are sorted/merged on a single thread.
+    #ifndef SC_ARRAY_PAR_GRAIN
+        #define SC_ARRAY_PAR_GRAIN 16384
+    #endif
+
+/**
+ *   Parallel sort and parallel for on a sc_pool, compile with
+ *   -DSC_ARRAY_HAVE_POOL and thread-pool sources.
+ *
+ *   sc_array_of_par_sort(name, T, less) generates :
+ *
+ *   bool sc_array_par_sort_<name>(struct sc_pool *pool, T *arr);
+ *       Parallel merge sort, not stable. Halves are sorted on the pool with
+ *       sc_array_sort_<name>(), then merged in parallel by splitting each
+ *       merge at the median of the larger half. Allocates a temporary copy
+ *       of the array, returns 'false' on out of memory. sc_array_of_sort()
+ *       with the same 'name' must be defined before.
+ *
+ *   Predefined for int, u32, u64, i64 and double.
+ */
+
+// Internals, do not use
+struct sc_array_par
+{
+    struct sc_pool *pool;
+    void *a;
+    void *b;
+    void *out;
+    size_t na;
+    size_t nb;
+    size_t grain;
+    bool to_tmp;
+};
+// Internals end
+
+    #define sc_array_of_par_sort(name, T, less)                                \
+                                                                               \
+        static inline void sc_array_pmerge_##name(struct sc_pool *p, T *a,     \
+                                                  size_t na, T *b, size_t nb,  \
+                                                  T *out, size_t grain);       \
+                                                                               \
+        static inline void sc_array_pmerge_task_##name(void *arg)              \
+        {                                                                      \
+            struct sc_array_par *x = arg;                                      \
+            sc_array_pmerge_##name(x->pool, x->a, x->na, x->b, x->nb, x->out,  \
+                                   x->grain);                                  \
+        }                                                                      \
+                                                                               \
+        static inline void sc_array_pmerge_##name(struct sc_pool *p, T *a,     \
+                                                  size_t na, T *b, size_t nb,  \
+                                                  T *out, size_t grain)        \
+        {                                                                      \
+            size_t ma, mb;                                                     \
+            T *swap;                                                           \
+            struct sc_array_par x;                                             \
+            struct sc_pool_task task;                                          \
+            struct sc_pool_wait wait;                                          \
+                                                                               \
+            if (na < nb) {                                                     \
+                swap = a, a = b, b = swap;                                     \
+                ma = na, na = nb, nb = ma;                                     \
+            }                                                                  \
+                                                                               \
+            if (na + nb <= grain || sc_pool_wait_init(&wait) != 0) {           \
+                T *ea = a + na, *eb = b + nb;                                  \
+                                                                               \
+                while (a != ea && b != eb) {                                   \
+                    *out++ = less(*b, *a) ? *b++ : *a++;                       \
+                }                                                              \
+                while (a != ea) {                                              \
+                    *out++ = *a++;                                             \
+                }                                                              \
+                while (b != eb) {                                              \
+                    *out++ = *b++;                                             \
+                }                                                              \
+                return;                                                        \
+            }                                                                  \
+                                                                               \
+            /* Elements before a[ma] and b[mb] go to the left of a[ma]. */     \
+            ma = na / 2;                                                       \
+            mb = sc_array_lower_bound_n_##name(b, nb, a[ma]);                  \
+            out[ma + mb] = a[ma];                                              \
+                                                                               \
+            x = (struct sc_array_par){.pool = p,                               \
+                                      .a = a + ma + 1,                         \
+                                      .na = na - ma - 1,                       \
+                                      .b = b + mb,                             \
+                                      .nb = nb - mb,                           \
+                                      .out = out + ma + mb + 1,                \
+                                      .grain = grain};                         \
+            sc_pool_task_init(&task, sc_array_pmerge_task_##name, &x);         \
+            sc_pool_submit(p, &task, &wait);                                   \
+            sc_array_pmerge_##name(p, a, ma, b, mb, out, grain);               \
+            sc_pool_wait(p, &wait);                                            \
+            sc_pool_wait_term(&wait);                                          \
+        }                                                                      \
+                                                                               \
+        static inline void sc_array_psort_##name(struct sc_pool *p, T *a,      \
+                                                 T *tmp, size_t n,             \
+                                                 size_t grain, bool to_tmp);   \
+                                                                               \
+        static inline void sc_array_psort_task_##name(void *arg)               \
+        {                                                                      \
+            struct sc_array_par *x = arg;                                      \
+            sc_array_psort_##name(x->pool, x->a, x->b, x->na, x->grain,        \
+                                  x->to_tmp);                                  \
+        }                                                                      \
+                                                                               \
+        /* Sorts 'a', result is in 'tmp' if 'to_tmp' is true. */               \
+        static inline void sc_array_psort_##name(struct sc_pool *p, T *a,      \
+                                                 T *tmp, size_t n,             \
+                                                 size_t grain, bool to_tmp)    \
+        {                                                                      \
+            size_t h = n / 2;                                                  \
+            T *src = to_tmp ? a : tmp, *dst = to_tmp ? tmp : a;                \
+            struct sc_array_par x;                                             \
+            struct sc_pool_task task;                                          \
+            struct sc_pool_wait wait;                                          \
+                                                                               \
+            if (n <= grain || sc_pool_wait_init(&wait) != 0) {                 \
+                sc_array_sort_n_##name(a, n);                                  \
+                if (to_tmp) {                                                  \
+                    memcpy(tmp, a, n * sizeof(T));                             \
+                }                                                              \
+                return;                                                        \
+            }                                                                  \
+                                                                               \
+            /* Sort halves into 'src', then merge into 'dst'. */               \
+            x = (struct sc_array_par){.pool = p,                               \
+                                      .a = a + h,                              \
+                                      .b = tmp + h,                            \
+                                      .na = n - h,                             \
+                                      .grain = grain,                          \
+                                      .to_tmp = !to_tmp};                      \
+            sc_pool_task_init(&task, sc_array_psort_task_##name, &x);          \
+            sc_pool_submit(p, &task, &wait);                                   \
+            sc_array_psort_##name(p, a, tmp, h, grain, !to_tmp);               \
+            sc_pool_wait(p, &wait);                                            \
+            sc_pool_wait_term(&wait);                                          \
+                                                                               \
+            sc_array_pmerge_##name(p, src, h, src + h, n - h, dst, grain);     \
+        }                                                                      \
+                                                                               \
+        static inline bool sc_array_par_sort_##name(struct sc_pool *p,         \
+                                                    T *arr)                    \
+        {                                                                      \
+            size_t n = sc_array_size(arr), grain;                              \
+            T *tmp;                                                            \
+                                                                               \
+            if (n <= SC_ARRAY_PAR_GRAIN) {                                     \
+                sc_array_sort_n_##name(arr, n);                                \
+                return true;                                                   \
+            }                                                                  \
+                                                                               \
+            tmp = sc_array_realloc(NULL, n * sizeof(T));                       \
+            if (tmp == NULL) {                                                 \
+                return false;                                                  \
+            }                                                                  \
+                                                                               \
+            /* Bound the task count, see sc_pool_for(). */                     \
+            grain = n / ((size_t) sc_pool_threads(p) * 64);                    \
+            grain = grain > SC_ARRAY_PAR_GRAIN ? grain : SC_ARRAY_PAR_GRAIN;   \
+            sc_array_psort_##name(p, arr, tmp, n, grain, false);               \
+            sc_array_free(tmp);                                                \
+                                                                               \
+            return true;                                                       \
+        }
+
+/**
+ *   Parallel for over array indexes, see sc_pool_for().
+ *
+ *   @param pool  pool
+ *   @param arr   array
+ *   @param grain max index range per call, '0' for default.
+ *   @param fn    void (*fn)(void *arg, size_t begin, size_t end)
+ *   @param arg   argument to pass 'fn'
+ */
+    #define sc_array_par_for(pool, arr, grain, fn, arg)                        \
+        sc_pool_for(pool, sc_array_size(arr), grain, fn, arg)
+
+sc_array_of_par_sort(int, int, sc_array_less)
+sc_array_of_par_sort(u32, uint32_t, sc_array_less)
+sc_array_of_par_sort(u64, uint64_t, sc_array_less)
+sc_array_of_par_sort(i64, int64_t, sc_array_less)
+sc_array_of_par_sort(double, double, sc_array_less)
+
+#endif
+
 /**
  *  @param arr  array
  *  @param elem elem
@@ -0,0 +1,43 @@
+#include "sc_bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void bench_memcpy(void *arg, uint64_t ops)
+{
+    char src[64] = {1}, dst[64];
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        memcpy(dst, src, sizeof(dst));
+        src[i % sizeof(src)] = dst[(i + 1) % sizeof(dst)];
+    }
+
+    sc_bench_keep(dst[0]);
+}
+
+static void bench_rand(void *arg, uint64_t ops)
+{
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_bench_keep(rand());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct sc_bench b;
+    struct sc_bench_result r;
+
+    if (sc_bench_init(&b, argc, argv) != 0) {
+        return 1;
+    }
+
+    sc_bench_run(&b, "memcpy/64", 10000000, bench_memcpy, NULL, NULL);
+    sc_bench_run(&b, "rand", 10000000, bench_rand, NULL, &r);
+    sc_bench_term(&b);
+
+    return r.median > 0 ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+#ifndef _XOPEN_SOURCE
+    #define _XOPEN_SOURCE 700
+#endif
+
+#include "sc_bench.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t calls;
+static uint64_t total;
+
+static void bench_count(void *arg, uint64_t ops)
+{
+    (void) arg;
+
+    calls++;
+    total += ops;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_bench_keep(i);
+    }
+}
+
+#ifdef SC_HAVE_WRAP
+
+// Fake clock, benchmarks advance it, so timings are deterministic.
+static bool fake_clock;
+static uint64_t fake_ns;
+
+int __real_clock_gettime(clockid_t id, struct timespec *ts);
+int __wrap_clock_gettime(clockid_t id, struct timespec *ts)
+{
+    if (!fake_clock) {
+        return __real_clock_gettime(id, ts);
+    }
+
+    ts->tv_sec = (time_t) (fake_ns / 1000000000);
+    ts->tv_nsec = (long) (fake_ns % 1000000000);
+
+    return 0;
+}
+
+static void bench_fake(void *arg, uint64_t ops)
+{
+    uint64_t *rep = arg;
+
+    (void) ops;
+    fake_ns += (*rep)++ * 100000;
+}
+
+#endif
+
+static void bench_sleep(void *arg, uint64_t ops)
+{
+    uint64_t *rep = arg;
+    uint64_t end = sc_bench_time_ns() + (*rep)++ * 100000;
+
+    (void) ops;
+
+    while (sc_bench_time_ns() < end) {
+    }
+}
+
+void test_options(void)
+{
+    struct sc_bench b;
+    char *empty[] = {"bench"};
+    char *args[] = {"bench", "-w", "2", "-r", "5", "-f", "map", "-j"};
+    char *quick[] = {"bench", "-q"};
+    char *bad1[] = {"bench", "-r", "0"};
+    char *bad2[] = {"bench", "-r"};
+    char *bad3[] = {"bench", "-x"};
+    char *bad4[] = {"bench", "-w", "12a"};
+    char *bad5[] = {"bench", "-r", "100000"};
+
+    assert(sc_bench_init(&b, 1, empty) == 0);
+    assert(b.warmup == 1 && b.reps == 10 && !b.quick && !b.json);
+    assert(b.filter == NULL);
+    sc_bench_term(&b);
+
+    assert(sc_bench_init(&b, 8, args) == 0);
+    assert(b.warmup == 2 && b.reps == 5 && b.json);
+    assert(strcmp(b.filter, "map") == 0);
+    sc_bench_term(&b);
+
+    assert(sc_bench_init(&b, 2, quick) == 0);
+    assert(b.quick && b.reps == 3 && b.warmup == 1);
+    sc_bench_term(&b);
+
+    assert(sc_bench_init(&b, 3, bad1) == -1);
+    assert(sc_bench_init(&b, 2, bad2) == -1);
+    assert(sc_bench_init(&b, 2, bad3) == -1);
+    assert(sc_bench_init(&b, 3, bad4) == -1);
+    assert(sc_bench_init(&b, 3, bad5) == -1);
+}
+
+void test_run(void)
+{
+    uint64_t rep = 0;
+    struct sc_bench b;
+    struct sc_bench_result r;
+    char *args[] = {"bench", "-w", "2", "-r", "7", "-f", "count"};
+    char *json[] = {"bench", "-w", "0", "-r", "100", "-j"};
+    char *quick[] = {"bench", "-q"};
+
+    assert(sc_bench_init(&b, 7, args) == 0);
+
+    calls = total = 0;
+    assert(sc_bench_run(&b, "count", 1000, bench_count, NULL, &r));
+    assert(calls == 9);
+    assert(total == 9000);
+    assert(strcmp(r.name, "count") == 0);
+    assert(r.ops == 1000 && r.reps == 7);
+    assert(r.min <= r.median && r.median <= r.p99);
+    assert(r.min <= r.mean && r.mean <= r.p99);
+
+    // Filtered out
+    assert(!sc_bench_run(&b, "other", 1000, bench_count, NULL, &r));
+    assert(calls == 9);
+    sc_bench_term(&b);
+
+    // Repetition n takes n * 100 us, p99 of 100 repetitions is the 99th one.
+    // Timings of the real clock depend on the load, only check the ordering.
+    assert(sc_bench_init(&b, 6, json) == 0);
+    assert(sc_bench_run(&b, "sleep", 1, bench_sleep, &rep, &r));
+    assert(rep == 100 && r.reps == 100);
+    assert(r.min <= r.median && r.median <= r.p99);
+    assert(r.min <= r.mean && r.mean <= r.p99);
+
+#ifdef SC_HAVE_WRAP
+    rep = 0;
+    fake_clock = true;
+    assert(sc_bench_run(&b, "fake", 1, bench_fake, &rep, &r));
+    fake_clock = false;
+    assert(rep == 100);
+    assert(r.min == 0);
+    assert(r.median == 50 * 100000);
+    assert(r.p99 == 98 * 100000);
+    assert(r.mean == 49.5 * 100000);
+#endif
+    sc_bench_term(&b);
+
+    assert(sc_bench_init(&b, 2, quick) == 0);
+    calls = total = 0;
+    assert(sc_bench_run(&b, "count", 1000, bench_count, NULL, &r));
+    assert(r.ops == 100 && calls == 4 && total == 400);
+    assert(sc_bench_run(&b, "count", 5, bench_count, NULL, &r));
+    assert(r.ops == 1);
+    sc_bench_term(&b);
+}
+
+int main(void)
+{
+    test_options();
+    test_run();
+
+    return 0;
+}
@@ -0,0 +1,604 @@
+#ifndef _XOPEN_SOURCE
+    #define _XOPEN_SOURCE 700
+#endif
+
+#include "sc_bench.h"
+
+#include "sc.h"
+#include "sc_buf.h"
+#include "sc_crc32.h"
+#include "sc_heap.h"
+#include "sc_ini.h"
+#include "sc_log.h"
+#include "sc_map.h"
+#include "sc_queue.h"
+#include "sc_sock.h"
+#include "sc_str.h"
+#include "sc_timer.h"
+#include "sc_uri.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Benchmarks of the modules, run with 'make bench' or ./sc_benchmarks, see
+ * sc_bench.h for options, e.g ./sc_benchmarks -f map -r 20 -j
+ */
+
+#define KEYS 65536 // power of two
+
+static uint64_t keys[KEYS];
+static char *str_keys[KEYS];
+
+static uint64_t rand_next(uint64_t *s)
+{
+    uint64_t x = *s;
+
+    x ^= x << 13u;
+    x ^= x >> 7u;
+    x ^= x << 17u;
+    *s = x;
+
+    return x;
+}
+
+static void init_keys(void)
+{
+    uint64_t seed = 0x9e3779b97f4a7c15ull;
+
+    for (int i = 0; i < KEYS; i++) {
+        keys[i] = rand_next(&seed);
+        str_keys[i] = sc_str_create_fmt("key-%llu",
+                                        (unsigned long long) keys[i]);
+    }
+}
+
+static void term_keys(void)
+{
+    for (int i = 0; i < KEYS; i++) {
+        sc_str_destroy(str_keys[i]);
+    }
+}
+
+// --------------------------------- map ------------------------------------ //
+
+static struct sc_map_64 map_64;
+static struct sc_map_str map_str;
+
+static void bench_map_put(void *arg, uint64_t ops)
+{
+    (void) arg;
+
+    sc_map_clear_64(&map_64);
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_map_put_64(&map_64, keys[i & (KEYS - 1)], i);
+    }
+}
+
+static void bench_map_get(void *arg, uint64_t ops)
+{
+    uint64_t val;
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        if (sc_map_get_64(&map_64, keys[i & (KEYS - 1)], &val)) {
+            sc_bench_keep(val);
+        }
+    }
+}
+
+static void bench_map_get_str(void *arg, uint64_t ops)
+{
+    const char *val;
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        if (sc_map_get_str(&map_str, str_keys[i & (KEYS - 1)], &val)) {
+            sc_bench_keep(val[0]);
+        }
+    }
+}
+
+static void bench_map(struct sc_bench *b)
+{
+    sc_map_init_64(&map_64, 0, 0);
+    sc_map_init_str(&map_str, 0, 0);
+
+    for (int i = 0; i < KEYS; i++) {
+        sc_map_put_64(&map_64, keys[i], (uint64_t) i);
+        sc_map_put_str(&map_str, str_keys[i], str_keys[i]);
+    }
+
+    sc_bench_run(b, "map/get_64", 10000000, bench_map_get, NULL, NULL);
+    sc_bench_run(b, "map/get_str", 10000000, bench_map_get_str, NULL, NULL);
+    sc_bench_run(b, "map/put_64", KEYS, bench_map_put, NULL, NULL);
+
+    sc_map_term_str(&map_str);
+    sc_map_term_64(&map_64);
+}
+
+// --------------------------------- buf ------------------------------------ //
+
+static struct sc_buf buf;
+
+static void bench_buf_put_get(void *arg, uint64_t ops)
+{
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i += 1024) {
+        sc_buf_clear(&buf);
+        for (int j = 0; j < 1024; j++) {
+            sc_buf_put_32(&buf, (uint32_t) j);
+        }
+        for (int j = 0; j < 1024; j++) {
+            sc_bench_keep(sc_buf_get_32(&buf));
+        }
+    }
+}
+
+static void bench_buf_str(void *arg, uint64_t ops)
+{
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i += 256) {
+        sc_buf_clear(&buf);
+        for (int j = 0; j < 256; j++) {
+            sc_buf_put_str(&buf, str_keys[j]);
+        }
+        for (int j = 0; j < 256; j++) {
+            sc_bench_keep(sc_buf_get_str(&buf)[0]);
+        }
+    }
+}
+
+static void bench_buffer(struct sc_bench *b)
+{
+    sc_buf_init(&buf, 64 * 1024);
+    sc_bench_run(b, "buf/put_get_32", 10000000, bench_buf_put_get, NULL, NULL);
+    sc_bench_run(b, "buf/put_get_str", 2000000, bench_buf_str, NULL, NULL);
+    sc_buf_term(&buf);
+}
+
+// -------------------------------- queue ----------------------------------- //
+
+static uint64_t *queue;
+
+static void bench_queue_add_del(void *arg, uint64_t ops)
+{
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i += 64) {
+        for (int j = 0; j < 64; j++) {
+            sc_queue_add_last(queue, i + (uint64_t) j);
+        }
+        for (int j = 0; j < 64; j++) {
+            sc_bench_keep(sc_queue_del_first(queue));
+        }
+    }
+}
+
+static void bench_queue(struct sc_bench *b)
+{
+    sc_queue_create(queue, 128);
+    sc_bench_run(b, "queue/add_del", 10000000, bench_queue_add_del, NULL, NULL);
+    sc_queue_destroy(queue);
+}
+
+// --------------------------------- heap ----------------------------------- //
+
+static struct sc_heap heap;
+
+static void bench_heap_add_pop(void *arg, uint64_t ops)
+{
+    int64_t key;
+    void *data;
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i += 1024) {
+        for (uint64_t j = 0; j < 1024; j++) {
+            sc_heap_add(&heap, (int64_t) keys[(i + j) & (KEYS - 1)], NULL);
+        }
+        while (sc_heap_pop(&heap, &key, &data)) {
+            sc_bench_keep(key);
+        }
+    }
+}
+
+static void bench_heap(struct sc_bench *b)
+{
+    sc_heap_init(&heap, 1024);
+    sc_bench_run(b, "heap/add_pop", 2000000, bench_heap_add_pop, NULL, NULL);
+    sc_heap_term(&heap);
+}
+
+// -------------------------------- timer ----------------------------------- //
+
+static struct sc_timer timer;
+
+static void timer_cb(void *arg, uint64_t timeout, uint64_t type, void *data)
+{
+    (void) arg;
+    (void) type;
+    (void) data;
+
+    sc_bench_keep(timeout);
+}
+
+static void bench_timer_add_cancel(void *arg, uint64_t ops)
+{
+    uint64_t ids[256];
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i += 256) {
+        for (int j = 0; j < 256; j++) {
+            ids[j] = sc_timer_add(&timer, keys[j] % 100000, 0, NULL);
+        }
+        for (int j = 0; j < 256; j++) {
+            sc_timer_cancel(&timer, &ids[j]);
+        }
+    }
+}
+
+static void bench_timer_expire(void *arg, uint64_t ops)
+{
+    uint64_t now = timer.timestamp;
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i += 256) {
+        for (int j = 0; j < 256; j++) {
+            sc_timer_add(&timer, keys[j] % 1000, 0, NULL);
+        }
+        now += 1000;
+        sc_timer_timeout(&timer, now, NULL, timer_cb);
+    }
+}
+
+static void bench_timer(struct sc_bench *b)
+{
+    sc_timer_init(&timer, 0);
+    sc_bench_run(b, "timer/add_cancel", 5000000, bench_timer_add_cancel, NULL,
+                 NULL);
+    sc_bench_run(b, "timer/add_expire", 5000000, bench_timer_expire, NULL,
+                 NULL);
+    sc_timer_term(&timer);
+}
+
+// -------------------------------- crc32 ----------------------------------- //
+
+static uint8_t crc_data[64 * 1024];
+
+static void bench_crc32_64(void *arg, uint64_t ops)
+{
+    uint32_t crc = 0;
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        crc = sc_crc32(crc, crc_data, 64);
+    }
+
+    sc_bench_keep(crc);
+}
+
+// One op is one 64 KB buffer.
+static void bench_crc32_64k(void *arg, uint64_t ops)
+{
+    uint32_t crc = 0;
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        crc = sc_crc32(crc, crc_data, sizeof(crc_data));
+    }
+
+    sc_bench_keep(crc);
+}
+
+static void bench_crc32(struct sc_bench *b)
+{
+    for (size_t i = 0; i < sizeof(crc_data); i++) {
+        crc_data[i] = (uint8_t) keys[i & (KEYS - 1)];
+    }
+
+    sc_crc32_init();
+    sc_bench_run(b, "crc32/64b", 10000000, bench_crc32_64, NULL, NULL);
+    sc_bench_run(b, "crc32/64kb", 20000, bench_crc32_64k, NULL, NULL);
+}
+
+// --------------------------------- rand ----------------------------------- //
+
+// One op is one 64 bit number.
+static void bench_rand_rc4(void *arg, uint64_t ops)
+{
+    uint64_t val;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_rand_read(arg, &val, sizeof(val));
+        sc_bench_keep(val);
+    }
+}
+
+static void bench_rand_xoshiro(void *arg, uint64_t ops)
+{
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_bench_keep(sc_rng_next(arg));
+    }
+}
+
+static void bench_rand_range(void *arg, uint64_t ops)
+{
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_bench_keep(sc_rng_range(arg, 1000));
+    }
+}
+
+static void bench_rand_wyrand(void *arg, uint64_t ops)
+{
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_bench_keep(sc_wyrand(arg));
+    }
+}
+
+static void bench_rand(struct sc_bench *b)
+{
+    uint64_t seed = 1;
+    unsigned char init[256];
+    struct sc_rand rc4;
+    struct sc_rng rng;
+
+    for (int i = 0; i < 256; i++) {
+        init[i] = (unsigned char) keys[i];
+    }
+
+    sc_rand_init(&rc4, init);
+    sc_rng_init(&rng, 1);
+
+    sc_bench_run(b, "rand/rc4_u64", 5000000, bench_rand_rc4, &rc4, NULL);
+    sc_bench_run(b, "rand/xoshiro_u64", 50000000, bench_rand_xoshiro, &rng,
+                 NULL);
+    sc_bench_run(b, "rand/xoshiro_range", 50000000, bench_rand_range, &rng,
+                 NULL);
+    sc_bench_run(b, "rand/wyrand_u64", 50000000, bench_rand_wyrand, &seed,
+                 NULL);
+}
+
+// --------------------------------- str ------------------------------------ //
+
+static void bench_str_create(void *arg, uint64_t ops)
+{
+    char *s;
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        s = sc_str_create(str_keys[i & (KEYS - 1)]);
+        sc_bench_keep(sc_str_len(s));
+        sc_str_destroy(s);
+    }
+}
+
+static void bench_str_append_fmt(void *arg, uint64_t ops)
+{
+    char *s = sc_str_create("");
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        if (i % 1024 == 0) {
+            sc_str_set(&s, "");
+        }
+        sc_str_append_fmt(&s, "%llu,", (unsigned long long) i);
+    }
+
+    sc_bench_keep(sc_str_len(s));
+    sc_str_destroy(s);
+}
+
+static void bench_str(struct sc_bench *b)
+{
+    sc_bench_run(b, "str/create_destroy", 5000000, bench_str_create, NULL,
+                 NULL);
+    sc_bench_run(b, "str/append_fmt", 5000000, bench_str_append_fmt, NULL,
+                 NULL);
+}
+
+// --------------------------------- log ------------------------------------ //
+
+static void bench_log_file(void *arg, uint64_t ops)
+{
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_log_info("request %llu done, status : %d \n",
+                    (unsigned long long) i, 200);
+    }
+}
+
+static void bench_log_disabled(void *arg, uint64_t ops)
+{
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_log_debug("request %llu done, status : %d \n",
+                     (unsigned long long) i, 200);
+    }
+}
+
+static void bench_log(struct sc_bench *b)
+{
+    sc_log_init();
+    sc_log_set_stdout(false);
+    sc_log_set_level("INFO");
+
+    if (sc_log_set_file("bench-prev.log", "bench.log") != 0) {
+        fprintf(stderr, "log : failed to open bench.log \n");
+        sc_log_term();
+        return;
+    }
+
+    sc_bench_run(b, "log/file", 500000, bench_log_file, NULL, NULL);
+    sc_bench_run(b, "log/disabled", 50000000, bench_log_disabled, NULL, NULL);
+
+    sc_log_term();
+    remove("bench-prev.log");
+    remove("bench.log");
+}
+
+// --------------------------------- ini ------------------------------------ //
+
+static int ini_on_item(void *arg, int line, const char *section,
+                       const char *key, const char *value)
+{
+    (void) arg;
+    (void) section;
+    (void) key;
+
+    sc_bench_keep((uintptr_t) line + (uintptr_t) *value);
+    return 0;
+}
+
+static int ini_on_span(void *arg, int line, struct sc_ini_span section,
+                       struct sc_ini_span key, struct sc_ini_span value)
+{
+    (void) arg;
+    (void) section;
+    (void) key;
+
+    sc_bench_keep((uintptr_t) line + value.len);
+    return 0;
+}
+
+static void bench_ini_string(void *arg, uint64_t ops)
+{
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_ini_parse_string(NULL, ini_on_item, arg);
+    }
+}
+
+static void bench_ini_buf(void *arg, uint64_t ops)
+{
+    size_t len = strlen(arg);
+
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_ini_parse_buf(NULL, ini_on_span, arg, len);
+    }
+}
+
+static void bench_ini(struct sc_bench *b)
+{
+    char *str = NULL;
+
+    // 10k lines, an op is a parse of the whole config.
+    sc_str_set(&str, "");
+    for (int i = 0; i < 1000; i++) {
+        sc_str_append_fmt(&str, "[section%d] ; comment\n", i);
+        for (int j = 0; j < 9; j++) {
+            sc_str_append_fmt(&str, "key%d = value%d # comment\n", j, i);
+        }
+    }
+
+    sc_bench_run(b, "ini/parse_string_10k", 200, bench_ini_string, str, NULL);
+    sc_bench_run(b, "ini/parse_buf_10k", 200, bench_ini_buf, str, NULL);
+    sc_str_destroy(str);
+}
+
+// --------------------------------- uri ------------------------------------ //
+
+static const char *uri_str =
+        "https://user@www.example.com:8443/forum/questions/?tag=net&order=new";
+
+static void bench_uri_parse(void *arg, uint64_t ops)
+{
+    size_t len = strlen(uri_str);
+    struct sc_uri_view v;
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_uri_parse(&v, uri_str, len);
+        sc_bench_keep(v.port_num);
+    }
+}
+
+static void bench_uri_create(void *arg, uint64_t ops)
+{
+    struct sc_uri *uri;
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        uri = sc_uri_create(uri_str);
+        sc_bench_keep((uintptr_t) uri->host);
+        sc_uri_destroy(uri);
+    }
+}
+
+static void bench_uri(struct sc_bench *b)
+{
+    sc_bench_run(b, "uri/parse", 5000000, bench_uri_parse, NULL, NULL);
+    sc_bench_run(b, "uri/create_destroy", 2000000, bench_uri_create, NULL,
+                 NULL);
+}
+
+// ------------------------------ sock pipe --------------------------------- //
+
+static void bench_pipe_ping(void *arg, uint64_t ops)
+{
+    uint64_t val;
+    struct sc_sock_pipe *pipe = arg;
+
+    for (uint64_t i = 0; i < ops; i++) {
+        sc_sock_pipe_write(pipe, &i, sizeof(i));
+        sc_sock_pipe_read(pipe, &val, sizeof(val));
+        sc_bench_keep(val);
+    }
+}
+
+static void bench_sock(struct sc_bench *b)
+{
+    struct sc_sock_pipe pipe;
+
+    if (sc_sock_pipe_init(&pipe, 0) != 0) {
+        fprintf(stderr, "sock_pipe : %s \n", sc_sock_pipe_err(&pipe));
+        return;
+    }
+
+    sc_bench_run(b, "sock_pipe/write_read", 500000, bench_pipe_ping, &pipe,
+                 NULL);
+    sc_sock_pipe_term(&pipe);
+}
+
+int main(int argc, char *argv[])
+{
+    struct sc_bench b;
+
+    if (sc_bench_init(&b, argc, argv) != 0) {
+        return 1;
+    }
+
+    init_keys();
+
+    bench_map(&b);
+    bench_buffer(&b);
+    bench_queue(&b);
+    bench_heap(&b);
+    bench_timer(&b);
+    bench_crc32(&b);
+    bench_rand(&b);
+    bench_str(&b);
+    bench_log(&b);
+    bench_ini(&b);
+    bench_uri(&b);
+    bench_sock(&b);
+
+    term_keys();
+    sc_bench_term(&b);
+
+    return 0;
+}
@@ -0,0 +1,295 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef _XOPEN_SOURCE
+    #define _XOPEN_SOURCE 700
+#endif
+
+#include "sc_bench.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+volatile uint64_t sc_bench_sink;
+
+uint64_t sc_bench_time_ns(void)
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+
+    QueryPerformanceCounter(&now);
+    return (uint64_t) ((double) now.QuadPart * 1e9 / (double) freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static void sc_bench_usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage : %s [-w warmup] [-r reps] [-f filter] [-q] [-j] [-p] \n"
+            "  -w : warmup repetitions, default is 1 \n"
+            "  -r : measured repetitions, default is 10, max is %d \n"
+            "  -f : run benchmarks whose name contains 'filter' \n"
+            "  -q : quick run \n"
+            "  -j : JSON output \n"
+            "  -p : perf counters \n",
+            prog, SC_BENCH_MAX_REPS);
+}
+
+static int sc_bench_count(const char *str, uint32_t min, uint32_t *val)
+{
+    char *end;
+    unsigned long n;
+
+    if (str == NULL) {
+        return -1;
+    }
+
+    n = strtoul(str, &end, 10);
+    if (*str == '\0' || *end != '\0' || n < min || n > SC_BENCH_MAX_REPS) {
+        return -1;
+    }
+
+    *val = (uint32_t) n;
+    return 0;
+}
+
+int sc_bench_init(struct sc_bench *b, int argc, char *argv[])
+{
+    int rc = 0;
+    bool perf = false;
+
+    *b = (struct sc_bench){
+            .warmup = 1,
+            .reps = 10,
+            .out = stdout,
+    };
+
+    for (int i = 1; i < argc && rc == 0; i++) {
+        const char *next = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(argv[i], "-w") == 0) {
+            rc = sc_bench_count(next, 0, &b->warmup);
+            i++;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            rc = sc_bench_count(next, 1, &b->reps);
+            i++;
+        } else if (strcmp(argv[i], "-f") == 0 && next != NULL) {
+            b->filter = next;
+            i++;
+        } else if (strcmp(argv[i], "-q") == 0) {
+            b->quick = true;
+        } else if (strcmp(argv[i], "-j") == 0) {
+            b->json = true;
+        } else if (strcmp(argv[i], "-p") == 0) {
+            perf = true;
+        } else {
+            rc = -1;
+        }
+    }
+
+    if (rc != 0) {
+        sc_bench_usage(argc > 0 ? argv[0] : "bench");
+        return -1;
+    }
+
+    if (b->quick) {
+        b->warmup = b->warmup < 1 ? b->warmup : 1;
+        b->reps = b->reps < 3 ? b->reps : 3;
+    }
+
+    if (perf) {
+#ifdef SC_BENCH_HAVE_PERF
+        const char *events = getenv("SC_PERF_EVENTS");
+
+        rc = events ? sc_perf_init_names(&b->counters, events) :
+                      sc_perf_init(&b->counters, NULL, 0);
+        if (rc != 0) {
+            fprintf(stderr, "perf : %s \n", sc_perf_err(&b->counters));
+            return -1;
+        }
+        b->perf = true;
+#else
+        fprintf(stderr, "perf counters are not supported in this build \n");
+        return -1;
+#endif
+    }
+
+    if (!b->json) {
+        fprintf(b->out, "%-32s %12s %12s %12s %12s \n", "benchmark", "ops",
+                "min ns/op", "median", "p99");
+    }
+
+    return 0;
+}
+
+void sc_bench_term(struct sc_bench *b)
+{
+#ifdef SC_BENCH_HAVE_PERF
+    if (b->perf) {
+        sc_perf_term(&b->counters);
+        b->perf = false;
+    }
+#else
+    (void) b;
+#endif
+}
+
+static int sc_bench_cmp(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+static void sc_bench_print(struct sc_bench *b, struct sc_bench_result *r)
+{
+    if (b->json) {
+        fprintf(b->out,
+                "{\"name\": \"%s\", \"ops\": %llu, \"reps\": %u, "
+                "\"min_ns\": %.3f, \"median_ns\": %.3f, \"p99_ns\": %.3f, "
+                "\"mean_ns\": %.3f",
+                r->name, (unsigned long long) r->ops, r->reps, r->min,
+                r->median, r->p99, r->mean);
+    } else {
+        fprintf(b->out, "%-32s %12llu %12.2f %12.2f %12.2f \n", r->name,
+                (unsigned long long) r->ops, r->min, r->median, r->p99);
+    }
+
+#ifdef SC_BENCH_HAVE_PERF
+    if (b->perf) {
+        const struct sc_perf_region *reg;
+        const double ops = (double) r->ops * r->reps;
+
+        reg = sc_perf_region(&b->counters, r->name);
+
+        if (b->json) {
+            fprintf(b->out, ", \"events\": {");
+        }
+
+        for (size_t i = 0; reg != NULL && i < b->counters.count; i++) {
+            const char *event = b->counters.events[i].name;
+
+            if (b->json) {
+                fprintf(b->out, "%s\"%s\": %.3f", i == 0 ? "" : ", ", event,
+                        reg->values[i] / ops);
+            } else {
+                fprintf(b->out, "%-32s %12s %12.2f per op \n", "", event,
+                        reg->values[i] / ops);
+            }
+        }
+
+        if (b->json) {
+            fprintf(b->out, "}");
+        }
+    }
+#endif
+
+    if (b->json) {
+        fprintf(b->out, "}\n");
+    }
+
+    fflush(b->out);
+}
+
+bool sc_bench_run(struct sc_bench *b, const char *name, uint64_t ops,
+                  void (*fn)(void *arg, uint64_t ops), void *arg,
+                  struct sc_bench_result *r)
+{
+    uint64_t start;
+    double sum = 0;
+    size_t p99;
+    struct sc_bench_result res;
+
+    if (b->filter != NULL && strstr(name, b->filter) == NULL) {
+        return false;
+    }
+
+    if (b->quick) {
+        ops = ops / 10 > 0 ? ops / 10 : 1;
+    }
+
+    for (uint32_t i = 0; i < b->warmup; i++) {
+        fn(arg, ops);
+    }
+
+    for (uint32_t i = 0; i < b->reps; i++) {
+#ifdef SC_BENCH_HAVE_PERF
+        if (b->perf) {
+            sc_perf_enter(&b->counters, name);
+        }
+#endif
+        start = sc_bench_time_ns();
+        fn(arg, ops);
+        b->samples[i] = (double) (sc_bench_time_ns() - start) / (double) ops;
+
+#ifdef SC_BENCH_HAVE_PERF
+        if (b->perf) {
+            sc_perf_leave_ops(&b->counters, ops);
+        }
+#endif
+        sum += b->samples[i];
+    }
+
+    qsort(b->samples, b->reps, sizeof(b->samples[0]), sc_bench_cmp);
+
+    // Nearest rank
+    p99 = (size_t) ceil(0.99 * b->reps) - 1;
+
+    res = (struct sc_bench_result){
+            .name = name,
+            .ops = ops,
+            .reps = b->reps,
+            .min = b->samples[0],
+            .median = b->samples[b->reps / 2],
+            .p99 = b->samples[p99],
+            .mean = sum / b->reps,
+    };
+
+    sc_bench_print(b, &res);
+
+    if (r != NULL) {
+        *r = res;
+    }
+
+    return true;
+}
@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SC_BENCH_H
+#define SC_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef SC_BENCH_HAVE_PERF
+    #include "sc_perf.h"
+#endif
+
+/**
+ * Micro benchmark harness.
+ *
+ * A benchmark is a function which runs 'ops' operations. Each benchmark is
+ * run 'warmup' times without measurement, then 'reps' times, and the result
+ * is min, median and p99 of the repetitions, in nanoseconds per operation.
+ * With SC_BENCH_HAVE_PERF and '-p', counters of ../perf are recorded for the
+ * measured repetitions and reported per operation, e.g instructions per op.
+ *
+ * static void bench_add(void *arg, uint64_t ops)
+ * {
+ *     for (uint64_t i = 0; i < ops; i++) {
+ *         sc_bench_keep(ops * i);
+ *     }
+ * }
+ *
+ * int main(int argc, char *argv[])
+ * {
+ *     struct sc_bench b;
+ *
+ *     if (sc_bench_init(&b, argc, argv) != 0) {
+ *         return 1;
+ *     }
+ *
+ *     sc_bench_run(&b, "add", 1000000, bench_add, NULL, NULL);
+ *     sc_bench_term(&b);
+ *     return 0;
+ * }
+ *
+ * Options :
+ *  -w <count> : warmup repetitions, default is 1
+ *  -r <count> : measured repetitions, default is 10
+ *  -f <text>  : run benchmarks whose name contains 'text'
+ *  -q         : quick, ops are divided by 10 and 3 repetitions, smoke test
+ *  -j         : JSON output, one object per line
+ *  -p         : perf counters, with SC_BENCH_HAVE_PERF only
+ */
+
+#ifndef SC_BENCH_MAX_REPS
+    #define SC_BENCH_MAX_REPS 1000
+#endif
+
+struct sc_bench_result
+{
+    const char *name;
+    uint64_t ops;  // operations per repetition
+    uint32_t reps;
+    double min;    // nanoseconds per operation
+    double median;
+    double p99;
+    double mean;
+};
+
+struct sc_bench
+{
+    uint32_t warmup;
+    uint32_t reps;
+    const char *filter;
+    bool quick;
+    bool json;
+    FILE *out;
+    double samples[SC_BENCH_MAX_REPS];
+
+#ifdef SC_BENCH_HAVE_PERF
+    bool perf;
+    struct sc_perf counters;
+#endif
+};
+
+// Sink for benchmark results, so the compiler can't remove the measured code.
+extern volatile uint64_t sc_bench_sink;
+
+#define sc_bench_keep(val) (sc_bench_sink += (uint64_t) (val))
+
+/**
+ * @param b    bench
+ * @param argc argc of main(), options are described above.
+ * @param argv argv of main()
+ * @return     '0' on success, negative on invalid options or if perf
+ *             counters can't be opened, usage is printed to stderr.
+ */
+int sc_bench_init(struct sc_bench *b, int argc, char *argv[]);
+
+/**
+ * @param b bench
+ */
+void sc_bench_term(struct sc_bench *b);
+
+/**
+ * Run a benchmark and print the result.
+ *
+ * @param b    bench
+ * @param name name
+ * @param ops  operations per repetition, divided by 10 in quick mode.
+ * @param fn   benchmark, runs 'ops' operations
+ * @param arg  user data for fn
+ * @param r    result, NULL if not needed
+ * @return     'false' if the benchmark is filtered out.
+ */
+bool sc_bench_run(struct sc_bench *b, const char *name, uint64_t ops,
+                  void (*fn)(void *arg, uint64_t ops), void *arg,
+                  struct sc_bench_result *r);
+
+/**
+ * @return monotonic time in nanoseconds
+ */
+uint64_t sc_bench_time_ns(void);
+
+#endif
@@ -1,9 +1,18 @@
 #include "sc_buf.h"
 
+#ifdef SC_BUF_HAVE_CRC32
+    #include "sc_crc32.h"
+#endif
+
+#ifdef SC_BUF_HAVE_SCAN
+    #include "sc_scan.h"
+#endif
+
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
 
+static unsigned char tmp_data[4096];
 
 void test1()
 {
@@ -128,14 +137,14 @@ void test1()
     sc_buf_term(&buf);
 
     sc_buf_init(&buf, 100);
-    sc_buf_limit(&buf, 128);
+    sc_buf_limit(&buf, 64);
     sc_buf_put_str(&buf, tmp);
     assert(sc_buf_valid(&buf) == false);
     assert(sc_buf_get_64(&buf) == 0);
     sc_buf_term(&buf);
 
     sc_buf_init(&buf, 100);
-    sc_buf_limit(&buf, 128);
+    sc_buf_limit(&buf, 64);
     sc_buf_put_fmt(&buf, tmp);
     assert(sc_buf_valid(&buf) == false);
     assert(sc_buf_get_64(&buf) == 0);
@@ -227,6 +236,575 @@ void test2()
 
 }
 
+void test3()
+{
+    uint32_t cap;
+    unsigned char tmp[4096] = {0};
+    struct sc_buf buf;
+
+    // Geometric growth
+    sc_buf_init(&buf, 0);
+    sc_buf_reserve(&buf, 1);
+    assert(sc_buf_cap(&buf) == 4096);
+    for (int i = 0; i < 64; i++) {
+        sc_buf_put_raw(&buf, tmp, sizeof(tmp));
+    }
+    assert(sc_buf_valid(&buf));
+    assert(sc_buf_size(&buf) == 64 * 4096);
+    assert(sc_buf_cap(&buf) == 64 * 4096);
+    sc_buf_put_8(&buf, 1);
+    assert(sc_buf_cap(&buf) == 128 * 4096);
+    sc_buf_term(&buf);
+
+    // Linear growth
+    sc_buf_init(&buf, 0);
+    sc_buf_policy(&buf, 1, 100);
+    for (int i = 0; i < 4; i++) {
+        sc_buf_put_raw(&buf, tmp, sizeof(tmp));
+        assert(sc_buf_cap(&buf) == (uint32_t) (i + 1) * 4096);
+    }
+    sc_buf_put_8(&buf, 1);
+    assert(sc_buf_cap(&buf) == 5 * 4096);
+    sc_buf_term(&buf);
+
+    // Large unread region, buffer grows instead of compacting
+    sc_buf_init(&buf, 4096);
+    sc_buf_put_raw(&buf, tmp, 4000);
+    sc_buf_mark_read(&buf, 100);
+    sc_buf_reserve(&buf, 200);
+    assert(sc_buf_rpos(&buf) == 100);
+    assert(sc_buf_cap(&buf) == 8192);
+
+    // Small unread region, buffer is compacted
+    cap = sc_buf_cap(&buf);
+    while (sc_buf_quota(&buf) > 0) {
+        sc_buf_put_8(&buf, 0);
+    }
+    sc_buf_mark_read(&buf, sc_buf_size(&buf) - 10);
+    sc_buf_reserve(&buf, 1000);
+    assert(sc_buf_rpos(&buf) == 0);
+    assert(sc_buf_size(&buf) == 10);
+    assert(sc_buf_cap(&buf) == cap);
+    sc_buf_term(&buf);
+
+    // Never compact unless growing exceeds the limit
+    sc_buf_init(&buf, 4096);
+    sc_buf_policy(&buf, 2, 0);
+    sc_buf_put_raw(&buf, tmp, 4096);
+    sc_buf_mark_read(&buf, 4000);
+    sc_buf_reserve(&buf, 1);
+    assert(sc_buf_rpos(&buf) == 4000);
+    assert(sc_buf_cap(&buf) == 8192);
+    sc_buf_term(&buf);
+
+    // Growth is clamped to the limit, compacts when growing is not possible
+    sc_buf_init(&buf, 4096);
+    sc_buf_limit(&buf, 6000);
+    sc_buf_put_raw(&buf, tmp, 4000);
+    sc_buf_mark_read(&buf, 2000);
+    sc_buf_put_raw(&buf, tmp, 1000);
+    assert(sc_buf_cap(&buf) == 6000);
+    assert(sc_buf_rpos(&buf) == 2000);
+    sc_buf_put_raw(&buf, tmp, 2000);
+    assert(sc_buf_valid(&buf));
+    assert(sc_buf_cap(&buf) == 6000);
+    assert(sc_buf_rpos(&buf) == 0);
+    assert(sc_buf_size(&buf) == 5000);
+    sc_buf_put_raw(&buf, tmp, 1001);
+    assert(sc_buf_valid(&buf) == false);
+    sc_buf_term(&buf);
+}
+
+void test_chain()
+{
+    char tmp[300];
+    const char *str;
+    unsigned char *p;
+    struct sc_buf_seg_pool pool;
+    struct sc_buf_chain chain, frame;
+
+    sc_buf_seg_pool_init(&pool, 64, 4);
+    sc_buf_chain_init(&chain, &pool);
+    sc_buf_chain_init(&frame, &pool);
+
+    // Values span segment boundaries
+    for (int i = 0; i < 100; i++) {
+        sc_buf_chain_put_8(&chain, (uint8_t) i);
+        sc_buf_chain_put_16(&chain, (uint16_t) i);
+        sc_buf_chain_put_32(&chain, (uint32_t) i);
+        sc_buf_chain_put_64(&chain, (uint64_t) i);
+        sc_buf_chain_put_double(&chain, i + 0.5);
+        sc_buf_chain_put_bool(&chain, i % 2);
+    }
+    assert(sc_buf_chain_size(&chain) == 100 * 24);
+
+    for (int i = 0; i < 100; i++) {
+        assert(sc_buf_chain_get_8(&chain) == (uint8_t) i);
+        assert(sc_buf_chain_get_16(&chain) == (uint16_t) i);
+        assert(sc_buf_chain_get_32(&chain) == (uint32_t) i);
+        assert(sc_buf_chain_get_64(&chain) == (uint64_t) i);
+        assert(sc_buf_chain_get_double(&chain) == i + 0.5);
+        assert(sc_buf_chain_get_bool(&chain) == i % 2);
+    }
+    assert(sc_buf_chain_size(&chain) == 0);
+    assert(sc_buf_chain_valid(&chain));
+
+    // Released blocks are cached up to the pool limit
+    assert(pool.count == 4);
+
+    // Strings and blobs are kept in a single segment
+    sc_buf_chain_put_8(&chain, 1);
+    sc_buf_chain_put_str(&chain, "test");
+    sc_buf_chain_put_str(&chain, NULL);
+    memset(tmp, 'x', sizeof(tmp));
+    tmp[sizeof(tmp) - 1] = '\0';
+    sc_buf_chain_put_str(&chain, tmp);
+    sc_buf_chain_put_blob(&chain, "blob", 4);
+    assert(sc_buf_chain_get_8(&chain) == 1);
+    assert(strcmp(sc_buf_chain_get_str(&chain), "test") == 0);
+    assert(sc_buf_chain_get_str(&chain) == NULL);
+    assert(strcmp(sc_buf_chain_get_str(&chain), tmp) == 0);
+    assert(sc_buf_chain_get_32(&chain) == 4);
+    assert(memcmp(sc_buf_chain_get_blob(&chain, 4), "blob", 4) == 0);
+    assert(sc_buf_chain_get_blob(&chain, 0) == NULL);
+    assert(sc_buf_chain_size(&chain) == 0);
+
+    // Raw data written across segments is pulled up on read
+    sc_buf_chain_put_raw(&chain, "abc", 3);
+    sc_buf_chain_put_raw(&chain, tmp, 60);
+    sc_buf_chain_put_32(&chain, 5);
+    sc_buf_chain_put_raw(&chain, "hello", 6);
+    sc_buf_chain_mark_read(&chain, 63);
+    str = sc_buf_chain_get_str(&chain);
+    assert(strcmp(str, "hello") == 0);
+
+    sc_buf_chain_put_raw(&chain, tmp, 100);
+    sc_buf_chain_put_raw(&chain, "0123456789", 10);
+    sc_buf_chain_mark_read(&chain, 90);
+    p = sc_buf_chain_pullup(&chain, 20);
+    assert(memcmp(p, "xxxxxxxxxx0123456789", 20) == 0);
+    p = sc_buf_chain_pullup(&chain, 20);
+    assert(memcmp(p, "xxxxxxxxxx0123456789", 20) == 0);
+    sc_buf_chain_get_data(&chain, tmp, 20);
+    assert(memcmp(tmp, "xxxxxxxxxx0123456789", 20) == 0);
+    assert(sc_buf_chain_size(&chain) == 0);
+
+    // Pullup larger than segment size
+    memset(tmp, 'y', sizeof(tmp));
+    sc_buf_chain_put_raw(&chain, tmp, 200);
+    p = sc_buf_chain_pullup(&chain, 200);
+    assert(p != NULL && p[0] == 'y' && p[199] == 'y');
+    sc_buf_chain_mark_read(&chain, 200);
+
+    // Split shares the boundary segment
+    sc_buf_chain_put_32(&chain, 100);
+    sc_buf_chain_put_raw(&chain, tmp, 100);
+    sc_buf_chain_put_str(&chain, "next");
+    assert(sc_buf_chain_get_32(&chain) == 100);
+    assert(sc_buf_chain_split(&chain, &frame, 100));
+    assert(sc_buf_chain_size(&frame) == 100);
+    assert(strcmp(sc_buf_chain_get_str(&chain), "next") == 0);
+
+    sc_buf_chain_put_str(&chain, "after");
+    sc_buf_chain_put_raw(&frame, "zz", 2);
+    sc_buf_chain_get_data(&frame, tmp, 100);
+    for (int i = 0; i < 100; i++) {
+        assert(tmp[i] == 'y');
+    }
+    assert(sc_buf_chain_get_8(&frame) == 'z');
+    assert(sc_buf_chain_get_8(&frame) == 'z');
+    assert(strcmp(sc_buf_chain_get_str(&chain), "after") == 0);
+    assert(sc_buf_chain_valid(&frame));
+
+    // Split whole chain and underflow
+    sc_buf_chain_put_64(&chain, 7);
+    assert(sc_buf_chain_split(&chain, &frame, 8));
+    assert(sc_buf_chain_size(&chain) == 0);
+    assert(sc_buf_chain_get_64(&frame) == 7);
+    sc_buf_chain_put_64(&chain, 7);
+    assert(sc_buf_chain_split(&chain, &frame, 9) == false);
+    assert(sc_buf_chain_valid(&chain) == false);
+    sc_buf_chain_clear(&chain);
+    assert(sc_buf_chain_valid(&chain));
+
+    // Write api
+    assert(sc_buf_chain_quota(&chain) == 0);
+    assert(sc_buf_chain_wbuf(&chain) == NULL);
+    assert(sc_buf_chain_reserve(&chain, 8));
+    assert(sc_buf_chain_quota(&chain) == 64);
+    memcpy(sc_buf_chain_wbuf(&chain), "test", 4);
+    sc_buf_chain_mark_write(&chain, 4);
+    assert(sc_buf_chain_size(&chain) == 4);
+    assert(memcmp(sc_buf_chain_pullup(&chain, 4), "test", 4) == 0);
+
+    // Underflow
+    assert(sc_buf_chain_pullup(&chain, 5) == NULL);
+    assert(sc_buf_chain_valid(&chain) == false);
+    sc_buf_chain_clear(&chain);
+    assert(sc_buf_chain_get_64(&chain) == 0);
+    assert(sc_buf_chain_get_str(&chain) == NULL);
+    assert(sc_buf_chain_valid(&chain) == false);
+
+    sc_buf_chain_term(&chain);
+    sc_buf_chain_term(&frame);
+    sc_buf_seg_pool_term(&pool);
+}
+
+void test_varint()
+{
+    uint32_t len;
+    unsigned char bad[11];
+    struct sc_buf buf;
+    const uint64_t uvals[] = {0, 1, 127, 128, 16383, 16384, UINT32_MAX,
+                              UINT64_MAX >> 1, UINT64_MAX};
+    const uint32_t ulens[] = {1, 1, 1, 2, 2, 3, 5, 9, 10};
+    const int64_t svals[] = {0, -1, 1, -64, 63, -65, 64, INT64_MIN, INT64_MAX};
+    const uint32_t slens[] = {1, 1, 1, 1, 1, 2, 2, 10, 10};
+
+    sc_buf_init(&buf, 0);
+
+    for (size_t i = 0; i < sizeof(uvals) / sizeof(uvals[0]); i++) {
+        assert(sc_buf_varint_len(uvals[i]) == ulens[i]);
+        sc_buf_put_varint(&buf, uvals[i]);
+        assert(sc_buf_size(&buf) == ulens[i]);
+        assert(sc_buf_get_varint(&buf) == uvals[i]);
+        assert(sc_buf_size(&buf) == 0);
+    }
+
+    for (size_t i = 0; i < sizeof(svals) / sizeof(svals[0]); i++) {
+        assert(sc_buf_unzigzag(sc_buf_zigzag(svals[i])) == svals[i]);
+        assert(sc_buf_svarint_len(svals[i]) == slens[i]);
+        sc_buf_put_svarint(&buf, svals[i]);
+        assert(sc_buf_size(&buf) == slens[i]);
+        assert(sc_buf_get_svarint(&buf) == svals[i]);
+    }
+    assert(sc_buf_zigzag(-1) == 1);
+    assert(sc_buf_zigzag(1) == 2);
+
+    sc_buf_put_vstr(&buf, "test");
+    sc_buf_put_vstr(&buf, NULL);
+    sc_buf_put_vstr(&buf, "");
+    sc_buf_put_vblob(&buf, "blob", 4);
+    sc_buf_put_vblob(&buf, NULL, 0);
+    assert(sc_buf_size(&buf) == sc_buf_vstr_len("test") + sc_buf_vstr_len(NULL) +
+                                sc_buf_vstr_len("") +
+                                sc_buf_vblob_len("blob", 4) +
+                                sc_buf_vblob_len(NULL, 0));
+    assert(sc_buf_vstr_len("test") == 6);
+    assert(sc_buf_vstr_len(NULL) == 1);
+    assert(strcmp(sc_buf_get_vstr(&buf), "test") == 0);
+    assert(sc_buf_get_vstr(&buf) == NULL);
+    assert(strcmp(sc_buf_get_vstr(&buf), "") == 0);
+    assert(memcmp(sc_buf_get_vblob(&buf, &len), "blob", 4) == 0);
+    assert(len == 4);
+    assert(sc_buf_get_vblob(&buf, &len) == NULL);
+    assert(len == 0);
+    assert(sc_buf_valid(&buf));
+    sc_buf_term(&buf);
+
+    // Truncated
+    sc_buf_init(&buf, 0);
+    sc_buf_put_8(&buf, 0x80);
+    assert(sc_buf_get_varint(&buf) == 0);
+    assert(sc_buf_valid(&buf) == false);
+    sc_buf_term(&buf);
+
+    // Too long
+    memset(bad, 0x80, sizeof(bad));
+    buf = sc_buf_wrap(bad, sizeof(bad), SC_BUF_READ);
+    assert(sc_buf_get_varint(&buf) == 0);
+    assert(sc_buf_valid(&buf) == false);
+
+    // 10th byte overflows 64 bits
+    bad[9] = 0x02;
+    buf = sc_buf_wrap(bad, 10, SC_BUF_READ);
+    assert(sc_buf_get_varint(&buf) == 0);
+    assert(sc_buf_valid(&buf) == false);
+
+    // Length exceeds data or string is not terminated
+    sc_buf_init(&buf, 0);
+    sc_buf_put_varint(&buf, 10);
+    sc_buf_put_raw(&buf, "abc", 3);
+    assert(sc_buf_get_vstr(&buf) == NULL);
+    assert(sc_buf_valid(&buf) == false);
+    sc_buf_clear(&buf);
+    sc_buf_put_varint(&buf, 10);
+    assert(sc_buf_get_vblob(&buf, &len) == NULL);
+    assert(sc_buf_valid(&buf) == false);
+    sc_buf_clear(&buf);
+    sc_buf_put_varint(&buf, 3);
+    sc_buf_put_raw(&buf, "abc", 3);
+    assert(sc_buf_get_vstr(&buf) == NULL);
+    assert(sc_buf_valid(&buf) == false);
+    sc_buf_clear(&buf);
+    sc_buf_put_vblob(&buf, "a", UINT32_MAX);
+    assert(sc_buf_valid(&buf) == false);
+    sc_buf_term(&buf);
+
+    // Put on invalid buffer is no-op
+    buf = sc_buf_wrap(bad, 4, SC_BUF_REF);
+    sc_buf_get_8(&buf);
+    assert(sc_buf_valid(&buf) == false);
+    sc_buf_put_varint(&buf, 1);
+    assert(sc_buf_wpos(&buf) == 0);
+}
+
+void test_cursor()
+{
+    char tmp[8];
+    struct sc_buf buf;
+    struct sc_buf_cursor c;
+
+    sc_buf_init(&buf, 0);
+
+    assert(sc_buf_wcursor(&buf, &c, 64));
+    sc_buf_cursor_put_8(&c, 8);
+    sc_buf_cursor_put_16(&c, 65111);
+    sc_buf_cursor_put_32(&c, 2132132131);
+    sc_buf_cursor_put_64(&c, UINT64_C(2132132213122131));
+    sc_buf_cursor_put_bool(&c, true);
+    sc_buf_cursor_put_double(&c, 123211.323321);
+    sc_buf_cursor_put_raw(&c, "test", 4);
+    assert(sc_buf_size(&buf) == 0);
+    sc_buf_wcommit(&buf, &c);
+    assert(sc_buf_size(&buf) == 1 + 2 + 4 + 8 + 1 + 8 + 4);
+
+    // Same encoding as put/get functions
+    assert(sc_buf_get_8(&buf) == 8);
+    assert(sc_buf_get_16(&buf) == 65111);
+    assert(sc_buf_get_32(&buf) == 2132132131);
+    assert(sc_buf_get_64(&buf) == UINT64_C(2132132213122131));
+    assert(sc_buf_get_bool(&buf) == true);
+    assert(sc_buf_get_double(&buf) == 123211.323321);
+    sc_buf_get_data(&buf, tmp, 4);
+    assert(memcmp(tmp, "test", 4) == 0);
+
+    sc_buf_put_8(&buf, 8);
+    sc_buf_put_16(&buf, 65111);
+    sc_buf_put_32(&buf, 2132132131);
+    sc_buf_put_64(&buf, UINT64_C(2132132213122131));
+    sc_buf_put_bool(&buf, false);
+    sc_buf_put_double(&buf, -1.5);
+    sc_buf_put_raw(&buf, "test", 4);
+
+    assert(sc_buf_rcursor(&buf, &c, sc_buf_size(&buf)));
+    assert(sc_buf_cursor_get_8(&c) == 8);
+    assert(sc_buf_cursor_get_16(&c) == 65111);
+    assert(sc_buf_cursor_get_32(&c) == 2132132131);
+    assert(sc_buf_cursor_get_64(&c) == UINT64_C(2132132213122131));
+    assert(sc_buf_cursor_get_bool(&c) == false);
+    assert(sc_buf_cursor_get_double(&c) == -1.5);
+    sc_buf_rcommit(&buf, &c);
+    assert(sc_buf_size(&buf) == 4);
+    assert(sc_buf_rcursor(&buf, &c, 4));
+    sc_buf_cursor_get_data(&c, tmp, 4);
+    assert(memcmp(tmp, "test", 4) == 0);
+    sc_buf_rcommit(&buf, &c);
+    assert(sc_buf_size(&buf) == 0);
+    assert(sc_buf_valid(&buf));
+
+    // Underflow
+    assert(sc_buf_rcursor(&buf, &c, 1) == false);
+    assert(sc_buf_valid(&buf) == false);
+    assert(sc_buf_wcursor(&buf, &c, 1) == false);
+    sc_buf_term(&buf);
+
+    buf = sc_buf_wrap(tmp, sizeof(tmp), SC_BUF_REF);
+    assert(sc_buf_wcursor(&buf, &c, sizeof(tmp) + 1) == false);
+    assert(sc_buf_wcursor(&buf, &c, sizeof(tmp)));
+    sc_buf_cursor_put_64(&c, 1);
+    sc_buf_wcommit(&buf, &c);
+    assert(sc_buf_get_64(&buf) == 1);
+}
+
+void test_pool()
+{
+    void *mem;
+    struct sc_buf a, b, c;
+    struct sc_buf_pool pool, pool2;
+
+    sc_buf_pool_init(&pool, 1024, 4096, 2048);
+
+    assert(sc_buf_pool_get(&pool, &a));
+    assert(sc_buf_cap(&a) == 1024);
+    mem = a.mem;
+    sc_buf_put_32(&a, 10);
+    sc_buf_term(&a);
+
+    // Memory is reused, buffer is reset
+    assert(sc_buf_pool_get(&pool, &a));
+    assert(a.mem == mem);
+    assert(sc_buf_size(&a) == 0);
+    assert(sc_buf_valid(&a));
+
+    // Pool limit is applied to buffers
+    sc_buf_put_raw(&a, tmp_data, 4000);
+    assert(sc_buf_valid(&a));
+    assert(sc_buf_cap(&a) == 4096);
+    sc_buf_put_raw(&a, tmp_data, 100);
+    assert(sc_buf_valid(&a) == false);
+
+    // Expanded buffers are not cached
+    sc_buf_term(&a);
+    assert(pool.bytes == 0);
+
+    // Max bytes
+    assert(sc_buf_pool_get(&pool, &a));
+    assert(sc_buf_pool_get(&pool, &b));
+    assert(sc_buf_pool_get(&pool, &c));
+    sc_buf_term(&a);
+    sc_buf_term(&b);
+    sc_buf_term(&c);
+    assert(pool.bytes == 2048);
+
+    // Global list
+    sc_buf_pool_flush(&pool);
+    assert(pool.free != NULL);
+    assert(sc_buf_pool_get(&pool, &a));
+    assert(pool.bytes == 1024);
+    sc_buf_term(&a);
+    sc_buf_pool_term(&pool);
+
+    // Thread caches up to SC_BUF_POOL_TLS pools, others use the global list
+    struct sc_buf_pool pools[SC_BUF_POOL_TLS + 1];
+    for (int i = 0; i < SC_BUF_POOL_TLS + 1; i++) {
+        sc_buf_pool_init(&pools[i], 64, 64, 1024);
+        assert(sc_buf_pool_get(&pools[i], &a));
+        sc_buf_term(&a);
+    }
+    assert(pools[SC_BUF_POOL_TLS].caches == NULL);
+    assert(pools[SC_BUF_POOL_TLS].free != NULL);
+    for (int i = 0; i < SC_BUF_POOL_TLS + 1; i++) {
+        sc_buf_pool_term(&pools[i]);
+    }
+
+    // Re-init at the same address
+    sc_buf_pool_init(&pool, 64, 64, 1024);
+    sc_buf_pool_init(&pool2, 64, 64, 1024);
+    assert(sc_buf_pool_get(&pool, &a));
+    sc_buf_term(&a);
+    sc_buf_pool_term(&pool2);
+    sc_buf_pool_term(&pool);
+    sc_buf_pool_init(&pool, 64, 64, 1024);
+    assert(sc_buf_pool_get(&pool, &a));
+    sc_buf_term(&a);
+    sc_buf_pool_term(&pool);
+}
+
+#if defined(__linux__)
+    #include <pthread.h>
+
+static void *pool_worker(void *arg)
+{
+    struct sc_buf bufs[8];
+    struct sc_buf_pool *pool = arg;
+
+    for (int i = 0; i < 20000; i++) {
+        int n = i % 8 + 1;
+
+        for (int j = 0; j < n; j++) {
+            assert(sc_buf_pool_get(pool, &bufs[j]));
+            sc_buf_put_32(&bufs[j], (uint32_t) i);
+        }
+
+        for (int j = 0; j < n; j++) {
+            assert(sc_buf_get_32(&bufs[j]) == (uint32_t) i);
+            sc_buf_term(&bufs[j]);
+        }
+    }
+
+    sc_buf_pool_flush(pool);
+
+    return NULL;
+}
+
+void test_pool_threads()
+{
+    pthread_t threads[4];
+    struct sc_buf_pool pool;
+
+    sc_buf_pool_init(&pool, 128, 128, 128 * 64);
+
+    for (int i = 0; i < 4; i++) {
+        assert(pthread_create(&threads[i], NULL, pool_worker, &pool) == 0);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+
+    assert(pool.bytes <= 128 * 64);
+    sc_buf_pool_term(&pool);
+}
+#else
+void test_pool_threads()
+{
+}
+#endif
+
+void test_array()
+{
+    uint32_t a32[1000], b32[1000];
+    uint64_t a64[1000], b64[1000];
+    double ad[1000], bd[1000];
+    struct sc_buf buf;
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        a32[i] = i * 2654435761u;
+        a64[i] = (uint64_t) i * UINT64_C(11400714819323198485);
+        ad[i] = i * -1.25;
+    }
+
+    sc_buf_init(&buf, 0);
+
+    // Same encoding with single value put/get
+    sc_buf_put_array_32(&buf, a32, 1000);
+    sc_buf_put_array_64(&buf, a64, 1000);
+    sc_buf_put_array_double(&buf, ad, 1000);
+    assert(sc_buf_size(&buf) == 1000 * (4 + 8 + 8));
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        assert(sc_buf_get_32(&buf) == a32[i]);
+    }
+    for (uint32_t i = 0; i < 1000; i++) {
+        assert(sc_buf_get_64(&buf) == a64[i]);
+    }
+    for (uint32_t i = 0; i < 1000; i++) {
+        assert(sc_buf_get_double(&buf) == ad[i]);
+    }
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        sc_buf_put_32(&buf, a32[i]);
+        sc_buf_put_64(&buf, a64[i]);
+        sc_buf_put_double(&buf, ad[i]);
+    }
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        sc_buf_get_array_32(&buf, &b32[i], 1);
+        sc_buf_get_array_64(&buf, &b64[i], 1);
+        sc_buf_get_array_double(&buf, &bd[i], 1);
+    }
+    assert(memcmp(a32, b32, sizeof(a32)) == 0);
+    assert(memcmp(a64, b64, sizeof(a64)) == 0);
+    assert(memcmp(ad, bd, sizeof(ad)) == 0);
+
+    sc_buf_put_array_32(&buf, a32, 0);
+    assert(sc_buf_size(&buf) == 0);
+    assert(sc_buf_valid(&buf));
+
+    // Underflow
+    sc_buf_put_array_32(&buf, a32, 3);
+    sc_buf_get_array_64(&buf, b64, 2);
+    assert(b64[0] == 0 && b64[1] == 0);
+    assert(sc_buf_valid(&buf) == false);
+    sc_buf_clear(&buf);
+
+    // Overflow
+    sc_buf_put_array_64(&buf, a64, UINT32_MAX);
+    assert(sc_buf_valid(&buf) == false);
+    sc_buf_term(&buf);
+}
+
 #ifdef SC_HAVE_WRAP
 
 bool fail_malloc = false;
@@ -280,6 +858,7 @@ void fail_test()
 {
     int tmp;
     unsigned char* p;
+    unsigned char p64[64] = {0};
     struct sc_buf buf;
 
     fail_malloc = true;
@@ -307,14 +886,14 @@ void fail_test()
 
     sc_buf_init(&buf, 10);
     fail_vsnprintf = true;
-    sc_buf_put_fmt(&buf, "test");
+    sc_buf_put_fmt(&buf, "%4s", "test");
     assert(sc_buf_valid(&buf) == false);
     fail_vsnprintf = false;
     sc_buf_term(&buf);
 
     sc_buf_init(&buf, 3);
     fail_vsnprintf_at = 2;
-    sc_buf_put_fmt(&buf, "test");
+    sc_buf_put_fmt(&buf, "%4s", "test");
     assert(sc_buf_valid(&buf) == false);
     sc_buf_term(&buf);
 
@@ -325,25 +904,58 @@ void fail_test()
     assert(sc_buf_valid(&buf) == false);
     sc_buf_term(&buf);
 
+    sc_buf_init(&buf, 100);
+    mock_strlen = true;
+    sc_buf_put_vstr(&buf, "t");
+    mock_strlen = false;
+    assert(sc_buf_valid(&buf) == false);
+    sc_buf_term(&buf);
+
+    sc_buf_init(&buf, 0);
+    fail_realloc = true;
+    sc_buf_put_vstr(&buf, "test");
+    sc_buf_put_vblob(&buf, "test", 4);
+    fail_realloc = false;
+    assert(sc_buf_valid(&buf) == false);
+    assert(sc_buf_size(&buf) == 0);
+    sc_buf_term(&buf);
+
     sc_buf_init(&buf, 10);
     fail_vsnprintf = true;
-    sc_buf_put_text(&buf, "test");
+    sc_buf_put_text(&buf, "%4s", "test");
     assert(sc_buf_valid(&buf) == false);
     fail_vsnprintf = false;
     sc_buf_term(&buf);
 
     sc_buf_init(&buf, 3);
     fail_vsnprintf_at = 2;
-    sc_buf_put_text(&buf, "test");
+    sc_buf_put_text(&buf, "%4s", "test");
     assert(sc_buf_valid(&buf) == false);
     sc_buf_term(&buf);
 
     sc_buf_init(&buf, 3);
     fail_vsnprintf_at = 2;
     fail_realloc = true;
-    sc_buf_put_text(&buf, "test");
+    sc_buf_put_text(&buf, "%4s", "test");
     assert(sc_buf_valid(&buf) == false);
     sc_buf_term(&buf);
+    fail_realloc = false;
+
+    // Size hint from the previous call, vsnprintf() is called once.
+    sc_buf_init(&buf, 0);
+    fail_vsnprintf_at = 100;
+    sc_buf_put_fmt(&buf, "%100s", "test");
+    assert(fail_vsnprintf_at == 98);
+    sc_buf_put_fmt(&buf, "%90s", "test");
+    assert(fail_vsnprintf_at == 97);
+    sc_buf_put_fmt(&buf, "%d", 1);
+    assert(fail_vsnprintf_at == 97);
+    fail_vsnprintf_at = -1;
+    assert(strlen(sc_buf_get_str(&buf)) == 100);
+    assert(strlen(sc_buf_get_str(&buf)) == 90);
+    assert(strcmp(sc_buf_get_str(&buf), "1") == 0);
+    assert(sc_buf_valid(&buf));
+    sc_buf_term(&buf);
 
     sc_buf_init(&buf, 0);
     sc_buf_peek_8(&buf);
@@ -437,6 +1049,54 @@ void fail_test()
     buf = sc_buf_wrap(&p, 8, SC_BUF_REF);
     assert(sc_buf_reserve(&buf, 100) == false);
 
+    struct sc_buf_pool bpool;
+
+    sc_buf_pool_init(&bpool, 64, 64, 1024);
+    fail_malloc = true;
+    assert(sc_buf_pool_get(&bpool, &buf) == false);
+    fail_malloc = false;
+    assert(sc_buf_pool_get(&bpool, &buf));
+    sc_buf_term(&buf);
+    sc_buf_pool_term(&bpool);
+
+    struct sc_buf_seg_pool pool;
+    struct sc_buf_chain chain, frame;
+
+    sc_buf_seg_pool_init(&pool, 64, 4);
+    sc_buf_chain_init(&chain, &pool);
+    sc_buf_chain_init(&frame, &pool);
+
+    fail_malloc = true;
+    sc_buf_chain_put_32(&chain, 1);
+    assert(sc_buf_chain_valid(&chain) == false);
+    assert(sc_buf_chain_reserve(&chain, 1) == false);
+    sc_buf_chain_put_str(&chain, "test");
+    sc_buf_chain_put_blob(&chain, "test", 4);
+    assert(sc_buf_chain_size(&chain) == 0);
+    fail_malloc = false;
+    sc_buf_chain_clear(&chain);
+
+    sc_buf_chain_put_raw(&chain, "abcdefgh", 8);
+    fail_malloc = true;
+    assert(sc_buf_chain_split(&chain, &frame, 4) == false);
+    assert(sc_buf_chain_valid(&chain) == false);
+    assert(sc_buf_chain_size(&chain) == 8);
+    fail_malloc = false;
+    sc_buf_chain_clear(&chain);
+
+    sc_buf_chain_put_raw(&chain, p64, 60);
+    sc_buf_chain_put_raw(&chain, p64, 8);
+    sc_buf_chain_put_8(&chain, 1);
+    assert(sc_buf_chain_split(&chain, &frame, 2));
+    fail_malloc = true;
+    assert(sc_buf_chain_pullup(&chain, 64) == NULL);
+    assert(sc_buf_chain_valid(&chain) == false);
+    fail_malloc = false;
+
+    sc_buf_chain_term(&chain);
+    sc_buf_chain_term(&frame);
+    sc_buf_seg_pool_term(&pool);
+
     fail_vsnprintf_at = -1;
     fail_realloc = false;
 
@@ -448,10 +1108,229 @@ void fail_test()
 }
 #endif
 
+void test_fmt()
+{
+    char tmp[1400];
+    uint64_t seed = 0x9e3779b97f4a7c15ull;
+    const double vals[] = {0.0,      -0.0,     0.5,       1.5,       2.5,
+                           0.125,    0.0625,   1.005,     2.675,     -1.25,
+                           123.456,  1e-7,     -1e-7,     1e15,      1e300,
+                           -1e300,   3.14159,  999.9999,  0.045,     1e-300};
+    struct sc_buf buf;
+
+    sc_buf_init(&buf, 0);
+
+    sc_buf_put_fmt(&buf, "%d %i %u %x %%", -1, INT32_MIN, UINT32_MAX, 255u);
+    assert(strcmp(sc_buf_get_str(&buf), "-1 -2147483648 4294967295 ff %") == 0);
+
+    sc_buf_put_fmt(&buf, "%ld %lld %lu %llx %zu", -100l, (long long) INT64_MIN,
+                   100ul, (unsigned long long) UINT64_MAX, (size_t) 42);
+    snprintf(tmp, sizeof(tmp), "%ld %lld %lu %llx %zu", -100l,
+             (long long) INT64_MIN, 100ul, (unsigned long long) UINT64_MAX,
+             (size_t) 42);
+    assert(strcmp(sc_buf_get_str(&buf), tmp) == 0);
+
+    sc_buf_put_fmt(&buf, "%c%s%c", '[', "text", ']');
+    assert(strcmp(sc_buf_get_str(&buf), "[text]") == 0);
+
+    sc_buf_put_fmt(&buf, "%-5d|%5s|%e", 3, "a", 1.5);
+    snprintf(tmp, sizeof(tmp), "%-5d|%5s|%e", 3, "a", 1.5);
+    assert(strcmp(sc_buf_get_str(&buf), tmp) == 0);
+
+    for (size_t i = 0; i < sizeof(vals) / sizeof(vals[0]); i++) {
+        sc_buf_put_fmt(&buf, "%f %.0f %.2f %.9f", vals[i], vals[i], vals[i],
+                       vals[i]);
+        snprintf(tmp, sizeof(tmp), "%f %.0f %.2f %.9f", vals[i], vals[i],
+                 vals[i], vals[i]);
+        assert(strcmp(sc_buf_get_str(&buf), tmp) == 0);
+    }
+
+    for (int i = 0; i < 100000; i++) {
+        uint64_t r;
+        double d;
+
+        seed ^= seed << 13u;
+        seed ^= seed >> 7u;
+        seed ^= seed << 17u;
+        r = seed;
+
+        d = (double) (int64_t) r / (double) (1ull << (r % 63));
+        sc_buf_put_fmt(&buf, "%d:%llu:%.3f:%f", (int) r, (unsigned long long) r,
+                       d, d / 1000);
+        snprintf(tmp, sizeof(tmp), "%d:%llu:%.3f:%f", (int) r,
+                 (unsigned long long) r, d, d / 1000);
+        assert(strcmp(sc_buf_get_str(&buf), tmp) == 0);
+    }
+
+    assert(sc_buf_valid(&buf));
+    assert(sc_buf_size(&buf) == 0);
+
+    sc_buf_clear(&buf);
+    sc_buf_put_text(&buf, "%s=%d", "a", 1);
+    sc_buf_put_text(&buf, ",%s=%.1f", "b", 2.25);
+    sc_buf_put_text(&buf, ",%3s", "c");
+    assert(strcmp(sc_buf_rbuf(&buf), "a=1,b=2.2,  c") == 0);
+
+    sc_buf_term(&buf);
+}
+
+#ifdef SC_BUF_HAVE_CRC32
+void test_crc()
+{
+    uint32_t crc, start;
+    unsigned char *data, *out;
+    struct sc_buf buf;
+    struct sc_buf_crc ctx;
+    const uint32_t len = 3 * SC_BUF_CRC_CHUNK + 100;
+
+    sc_crc32_init();
+
+    data = malloc(len);
+    out = malloc(len);
+    assert(data != NULL && out != NULL);
+
+    for (uint32_t i = 0; i < len; i++) {
+        data[i] = (unsigned char) (i * 31);
+    }
+
+    sc_buf_init(&buf, 0);
+    sc_buf_put_32(&buf, 1);
+
+    sc_buf_crc_wbegin(&buf, &ctx);
+    sc_buf_put_32(&buf, 100);
+    sc_buf_put_str(&buf, "test");
+    sc_buf_put_raw(&buf, data, len);
+    sc_buf_put_64(&buf, 200);
+    sc_buf_put_crc(&buf);
+    assert(sc_buf_valid(&buf));
+
+    crc = sc_crc32(0, (uint8_t *) sc_buf_rbuf(&buf) + 4, sc_buf_size(&buf) - 8);
+    assert(sc_buf_peek_32_at(&buf, sc_buf_size(&buf) - 4) == crc);
+
+    assert(sc_buf_get_32(&buf) == 1);
+    sc_buf_crc_rbegin(&buf, &ctx);
+    assert(sc_buf_get_32(&buf) == 100);
+    assert(strcmp(sc_buf_get_str(&buf), "test") == 0);
+    sc_buf_get_data(&buf, out, len);
+    assert(memcmp(data, out, len) == 0);
+    assert(sc_buf_get_64(&buf) == 200);
+    assert(sc_buf_get_crc(&buf) == true);
+    assert(sc_buf_size(&buf) == 0);
+
+    // Blob is checksummed in place.
+    sc_buf_clear(&buf);
+    sc_buf_crc_wbegin(&buf, &ctx);
+    sc_buf_put_blob(&buf, data, len);
+    sc_buf_put_crc(&buf);
+    sc_buf_crc_rbegin(&buf, &ctx);
+    assert(memcmp(sc_buf_get_blob(&buf, sc_buf_get_32(&buf)), data, len) == 0);
+    assert(sc_buf_get_crc(&buf) == true);
+
+    // Corrupted byte.
+    sc_buf_clear(&buf);
+    sc_buf_crc_wbegin(&buf, &ctx);
+    sc_buf_put_raw(&buf, data, 100);
+    sc_buf_put_crc(&buf);
+    sc_buf_set_8_at(&buf, 50, 0xff);
+    sc_buf_crc_rbegin(&buf, &ctx);
+    sc_buf_get_data(&buf, out, 100);
+    assert(sc_buf_get_crc(&buf) == false);
+    assert(sc_buf_valid(&buf) == false);
+
+    // Frame is moved by compaction while it is being written.
+    sc_buf_term(&buf);
+    sc_buf_init(&buf, 4096);
+    sc_buf_policy(&buf, 2, 100);
+    sc_buf_put_raw(&buf, data, sc_buf_cap(&buf) - 100);
+    sc_buf_mark_read(&buf, sc_buf_size(&buf) - 10);
+    start = sc_buf_wpos(&buf);
+    sc_buf_crc_wbegin(&buf, &ctx);
+    sc_buf_put_64(&buf, 300);
+    sc_buf_put_raw(&buf, data, 200);
+    assert(sc_buf_wpos(&buf) < start);
+    start = sc_buf_wpos(&buf) - 208;
+    crc = sc_buf_crc_end(&buf);
+    assert(crc == sc_crc32(0, (uint8_t *) sc_buf_at(&buf, start), 208));
+
+    // Frame is read before a compaction.
+    sc_buf_clear(&buf);
+    sc_buf_put_raw(&buf, data, sc_buf_cap(&buf) - 100);
+    crc = sc_crc32(0, data, 50);
+    sc_buf_crc_rbegin(&buf, &ctx);
+    sc_buf_get_data(&buf, out, 40);
+    sc_buf_get_64(&buf);
+    sc_buf_get_16(&buf);
+    sc_buf_put_raw(&buf, data, 1000);
+    assert(sc_buf_rpos(&buf) == 0);
+    assert(sc_buf_crc_end(&buf) == crc);
+    assert(sc_buf_valid(&buf));
+
+    sc_buf_term(&buf);
+    free(data);
+    free(out);
+}
+#else
+void test_crc()
+{
+}
+#endif
+
+#ifdef SC_BUF_HAVE_SCAN
+void test_find()
+{
+    uint32_t n;
+    struct sc_buf buf;
+    struct sc_scan_set set;
+    const char *line;
+
+    sc_scan_set_init(&set, "\r\n", 2);
+    sc_buf_init(&buf, 100);
+
+    assert(sc_buf_find(&buf, 0, &set) == 0);
+
+    sc_buf_put_raw(&buf, "GET / HTTP/1.1", 14);
+    n = sc_buf_find(&buf, 0, &set);
+    assert(n == 14);
+
+    // Continue from where the previous search stopped.
+    sc_buf_put_raw(&buf, "\r\nHost: a\r\n", 11);
+    n = sc_buf_find(&buf, n, &set);
+    assert(n == 14);
+    line = sc_buf_get_blob(&buf, n + 2);
+    assert(strncmp(line, "GET / HTTP/1.1\r\n", 16) == 0);
+
+    assert(sc_buf_find(&buf, 0, &set) == 7);
+    assert(sc_buf_find(&buf, 8, &set) == 8);
+    assert(sc_buf_find(&buf, 9, &set) == 9);
+    assert(sc_buf_find(&buf, 100, &set) == 9);
+
+    sc_buf_get_32(&buf);
+    sc_buf_get_64(&buf);
+    assert(!sc_buf_valid(&buf));
+    assert(sc_buf_find(&buf, 0, &set) == sc_buf_size(&buf));
+
+    sc_buf_term(&buf);
+}
+#else
+void test_find()
+{
+}
+#endif
+
 int main()
 {
     test1();
     test2();
+    test3();
+    test_chain();
+    test_varint();
+    test_cursor();
+    test_pool();
+    test_pool_threads();
+    test_array();
+    test_fmt();
+    test_crc();
+    test_find();
     fail_test();
     return 0;
 }
@@ -27,8 +27,64 @@
 #include <assert.h>
 #include <stdio.h>
 
+#if defined(_MSC_VER)
+    #include <windows.h>
+#endif
+
+#ifdef SC_BUF_HAVE_CRC32
+    #include "sc_crc32.h"
+#endif
+
+#ifdef SC_STATS
+    #include "sc_stats.h"
+#elif !defined(SC_STATS_ADD)
+    #define SC_STATS_ADD(name, n) ((void) (n))
+    #define SC_STATS_MAX(name, v) ((void) (v))
+#endif
+
 #define sc_buf_min(a, b) ((a) > (b) ? (b) : (a))
 
+#ifndef thread_local
+    #if __STDC_VERSION__ >= 201112 && !defined __STDC_NO_THREADS__
+        #define thread_local _Thread_local
+    #elif defined _WIN32 && (defined _MSC_VER || defined __ICL ||              \
+                             defined __DMC__ || defined __BORLANDC__)
+        #define thread_local __declspec(thread)
+    #elif defined __GNUC__ || defined __SUNPRO_C || defined __xlC__
+        #define thread_local __thread
+    #else
+        #error "Cannot define  thread_local"
+    #endif
+#endif
+
+#if defined(_MSC_VER)
+    #define sc_buf_load(p)     InterlockedOr((LONG *) (p), 0)
+    #define sc_buf_xchg(p, v)  InterlockedExchange((LONG *) (p), (LONG) (v))
+    #define sc_buf_store(p, v) InterlockedExchange((LONG *) (p), (LONG) (v))
+    #define sc_buf_add(p, v)                                                   \
+        ((uint64_t) InterlockedExchangeAdd64((LONG64 *) (p), (LONG64) (v)) +   \
+         (v))
+    #define sc_buf_sub(p, v)                                                   \
+        InterlockedExchangeAdd64((LONG64 *) (p), -(LONG64) (v))
+    #define sc_buf_inc(p)  ((uint64_t) InterlockedIncrement64((LONG64 *) (p)))
+    #define sc_buf_pause() YieldProcessor()
+#else
+    #define sc_buf_load(p)     __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_buf_xchg(p, v)  __atomic_exchange_n(p, v, __ATOMIC_ACQUIRE)
+    #define sc_buf_store(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+    #define sc_buf_add(p, v)   __atomic_add_fetch(p, v, __ATOMIC_RELAXED)
+    #define sc_buf_sub(p, v)   __atomic_sub_fetch(p, v, __ATOMIC_RELAXED)
+    #define sc_buf_inc(p)      __atomic_add_fetch(p, 1, __ATOMIC_RELAXED)
+
+    #if defined(__x86_64__) || defined(__i386__)
+        #define sc_buf_pause() __builtin_ia32_pause()
+    #elif defined(__aarch64__)
+        #define sc_buf_pause() __asm__ __volatile__("yield")
+    #else
+        #define sc_buf_pause()
+    #endif
+#endif
+
 bool sc_buf_init(struct sc_buf *buf, uint32_t cap)
 {
     void *mem = NULL;
@@ -49,85 +105,313 @@ bool sc_buf_init(struct sc_buf *buf, uint32_t cap)
 
 struct sc_buf sc_buf_wrap(void *data, uint32_t len, int flags)
 {
-    struct sc_buf buf = {.mem = data,
+    struct sc_buf buf = {.pool = NULL,
+                         .crc = NULL,
+                         .mem = data,
                          .cap = len,
                          .limit = flags & SC_BUF_REF ? len : UINT32_MAX,
                          .wpos = flags & SC_BUF_DATA ? len : 0,
                          .rpos = 0,
                          .ref = (bool) (flags & SC_BUF_REF),
+                         .factor = SC_BUF_GROW_FACTOR,
+                         .compact = SC_BUF_COMPACT_PCT,
+                         .hint = 0,
                          .error = 0};
 
     return buf;
 }
 
+static void sc_buf_pool_put(struct sc_buf_pool *pool, void *mem,
+                            uint32_t cap);
+
 void sc_buf_term(struct sc_buf *buf)
 {
+    if (buf->pool != NULL) {
+        sc_buf_pool_put(buf->pool, buf->mem, buf->cap);
+        buf->pool = NULL;
+        return;
+    }
+
     if (!buf->ref) {
         sc_buf_free(buf->mem);
     }
 }
 
-void sc_buf_limit(struct sc_buf *buf, uint32_t limit)
+// Thread's cache for a pool, 'id' detects a new pool at the same address.
+struct sc_buf_pool_tls
 {
-    buf->limit = limit;
+    struct sc_buf_pool *pool;
+    uint64_t id;
+    struct sc_buf_pool_cache *cache;
+};
+
+static uint64_t sc_buf_pool_ids;
+static thread_local struct sc_buf_pool_tls sc_buf_pool_tls[SC_BUF_POOL_TLS];
+
+void sc_buf_pool_init(struct sc_buf_pool *pool, uint32_t size, uint32_t limit,
+                      uint64_t max)
+{
+    assert(size >= sizeof(void *));
+    assert(limit >= size);
+
+    *pool = (struct sc_buf_pool){
+            .id = sc_buf_inc(&sc_buf_pool_ids),
+            .max = max,
+            .size = size,
+            .limit = limit,
+    };
 }
 
-void *sc_buf_at(struct sc_buf *buf, uint32_t pos)
+static struct sc_buf_pool_tls *sc_buf_pool_slot(struct sc_buf_pool *pool)
 {
-    return buf->mem + pos;
+    for (int i = 0; i < SC_BUF_POOL_TLS; i++) {
+        if (sc_buf_pool_tls[i].pool == pool) {
+            return &sc_buf_pool_tls[i];
+        }
+    }
+
+    return NULL;
 }
 
-uint32_t sc_buf_cap(struct sc_buf *buf)
+void sc_buf_pool_term(struct sc_buf_pool *pool)
 {
-    return buf->cap;
+    void *mem;
+    struct sc_buf_pool_tls *slot;
+    struct sc_buf_pool_cache *cache;
+
+    while ((mem = pool->free) != NULL) {
+        pool->free = *(void **) mem;
+        sc_buf_free(mem);
+    }
+
+    while ((cache = pool->caches) != NULL) {
+        pool->caches = cache->next;
+
+        for (uint32_t i = 0; i < cache->count; i++) {
+            sc_buf_free(cache->mem[i]);
+        }
+
+        sc_buf_free(cache);
+    }
+
+    slot = sc_buf_pool_slot(pool);
+    if (slot != NULL) {
+        *slot = (struct sc_buf_pool_tls){0};
+    }
+
+    pool->bytes = 0;
 }
 
-bool sc_buf_reserve(struct sc_buf *buf, uint32_t len)
+static void sc_buf_pool_lock(struct sc_buf_pool *pool)
 {
-    uint32_t size;
-    void *tmp;
+    while (sc_buf_xchg(&pool->lock, 1) != 0) {
+        while (sc_buf_load(&pool->lock) != 0) {
+            sc_buf_pause();
+        }
+    }
+}
 
-    if (buf->wpos + len > buf->cap) {
-        if (buf->ref) {
-            return false;
+static void sc_buf_pool_unlock(struct sc_buf_pool *pool)
+{
+    sc_buf_store(&pool->lock, 0);
+}
+
+// Returns calling thread's cache, creates one if there is a free slot.
+static struct sc_buf_pool_cache *sc_buf_pool_cache(struct sc_buf_pool *pool)
+{
+    struct sc_buf_pool_cache *cache;
+    struct sc_buf_pool_tls *slot = sc_buf_pool_slot(pool);
+
+    if (slot != NULL && slot->id == pool->id) {
+        return slot->cache;
+    }
+
+    // Stale slot of a terminated pool at the same address is reused.
+    if (slot == NULL) {
+        slot = sc_buf_pool_slot(NULL);
+        if (slot == NULL) {
+            return NULL;
         }
+    }
 
-        sc_buf_compact(buf);
+    cache = sc_buf_malloc(sizeof(*cache));
+    if (cache == NULL) {
+        return NULL;
+    }
 
-        if (buf->wpos + len > buf->cap) {
-            size = ((buf->cap + len + 4095) / 4096) * 4096;
-            if (size > buf->limit) {
-                buf->error |= SC_BUF_OOM;
-                return false;
-            }
+    cache->count = 0;
 
-            tmp = sc_buf_realloc(buf->mem, size);
-            if (tmp == NULL) {
-                buf->error |= SC_BUF_OOM;
-                return false;
-            }
+    sc_buf_pool_lock(pool);
+    cache->next = pool->caches;
+    pool->caches = cache;
+    sc_buf_pool_unlock(pool);
 
-            buf->cap = size;
-            buf->mem = tmp;
+    *slot = (struct sc_buf_pool_tls){
+            .pool = pool,
+            .id = pool->id,
+            .cache = cache,
+    };
+
+    return cache;
+}
+
+bool sc_buf_pool_get(struct sc_buf_pool *pool, struct sc_buf *buf)
+{
+    void *mem = NULL;
+    struct sc_buf_pool_cache *cache = sc_buf_pool_cache(pool);
+
+    if (cache != NULL && cache->count > 0) {
+        mem = cache->mem[--cache->count];
+    } else {
+        sc_buf_pool_lock(pool);
+        mem = pool->free;
+        if (mem != NULL) {
+            pool->free = *(void **) mem;
+        }
+        sc_buf_pool_unlock(pool);
+    }
+
+    if (mem != NULL) {
+        sc_buf_sub(&pool->bytes, pool->size);
+    } else {
+        mem = sc_buf_malloc(pool->size);
+        if (mem == NULL) {
+            return false;
         }
     }
 
+    *buf = sc_buf_wrap(mem, pool->size, 0);
+    buf->limit = pool->limit;
+    buf->pool = pool;
+
     return true;
 }
 
-bool sc_buf_valid(struct sc_buf *buf)
+static void sc_buf_pool_put(struct sc_buf_pool *pool, void *mem, uint32_t cap)
 {
-    return buf->error == 0;
+    struct sc_buf_pool_cache *cache;
+
+    if (cap != pool->size) {
+        sc_buf_free(mem);
+        return;
+    }
+
+    if (sc_buf_add(&pool->bytes, pool->size) > pool->max) {
+        sc_buf_sub(&pool->bytes, pool->size);
+        sc_buf_free(mem);
+        return;
+    }
+
+    cache = sc_buf_pool_cache(pool);
+    if (cache != NULL && cache->count < SC_BUF_POOL_CACHE) {
+        cache->mem[cache->count++] = mem;
+        return;
+    }
+
+    sc_buf_pool_lock(pool);
+    *(void **) mem = pool->free;
+    pool->free = mem;
+    sc_buf_pool_unlock(pool);
+}
+
+void sc_buf_pool_flush(struct sc_buf_pool *pool)
+{
+    void *mem;
+    struct sc_buf_pool_cache *cache;
+    struct sc_buf_pool_tls *slot = sc_buf_pool_slot(pool);
+
+    if (slot == NULL || slot->id != pool->id) {
+        return;
+    }
+
+    cache = slot->cache;
+
+    sc_buf_pool_lock(pool);
+    while (cache->count > 0) {
+        mem = cache->mem[--cache->count];
+        *(void **) mem = pool->free;
+        pool->free = mem;
+    }
+    sc_buf_pool_unlock(pool);
+}
+
+void sc_buf_limit(struct sc_buf *buf, uint32_t limit)
+{
+    buf->limit = limit;
+}
+
+void *sc_buf_at(struct sc_buf *buf, uint32_t pos)
+{
+    return buf->mem + pos;
 }
 
-uint32_t sc_buf_quota(struct sc_buf *buf)
+void sc_buf_policy(struct sc_buf *buf, uint32_t factor, uint32_t compact)
 {
-    return buf->cap - buf->wpos;
+    assert(factor >= 1 && factor <= 16);
+    assert(compact <= 100);
+
+    buf->factor = (uint8_t) factor;
+    buf->compact = (uint8_t) compact;
 }
 
-uint32_t sc_buf_size(struct sc_buf *buf)
+bool sc_buf_reserve(struct sc_buf *buf, uint32_t len)
 {
-    return buf->wpos - buf->rpos;
+    uint32_t unread;
+    uint64_t need, size;
+    void *tmp;
+
+    if ((uint64_t) buf->wpos + len <= buf->cap) {
+        return true;
+    }
+
+    if (buf->ref) {
+        return false;
+    }
+
+    // Moving unread data is cheap only if there is not much of it, otherwise
+    // growing is preferred and the memmove is deferred.
+    unread = buf->wpos - buf->rpos;
+    if ((uint64_t) unread * 100 <= (uint64_t) buf->cap * buf->compact) {
+        SC_STATS_ADD("buf.compact", 1);
+        sc_buf_compact(buf);
+    }
+
+    need = (uint64_t) buf->wpos + len;
+    if (need <= buf->cap) {
+        return true;
+    }
+
+    if (need > buf->limit) {
+        if ((uint64_t) unread + len > buf->limit) {
+            buf->error |= SC_BUF_OOM;
+            return false;
+        }
+
+        // Growing would exceed the limit, compacting is the only option.
+        SC_STATS_ADD("buf.compact", 1);
+        sc_buf_compact(buf);
+        need = (uint64_t) buf->wpos + len;
+        if (need <= buf->cap) {
+            return true;
+        }
+    }
+
+    size = (uint64_t) buf->cap * buf->factor;
+    size = size > need ? size : need;
+    size = ((size + 4095) / 4096) * 4096;
+    size = size > buf->limit ? buf->limit : size;
+
+    tmp = sc_buf_realloc(buf->mem, (size_t) size);
+    if (tmp == NULL) {
+        buf->error |= SC_BUF_OOM;
+        return false;
+    }
+
+    SC_STATS_ADD("buf.realloc", 1);
+    buf->cap = (uint32_t) size;
+    buf->mem = tmp;
+
+    return true;
 }
 
 void sc_buf_clear(struct sc_buf *buf)
@@ -179,10 +463,33 @@ void *sc_buf_wbuf(struct sc_buf *buf)
     return buf->mem + buf->wpos;
 }
 
+#ifdef SC_BUF_HAVE_CRC32
+// Folds bytes written/read since the last fold into the attached checksum.
+static void sc_buf_crc_fold(struct sc_buf *buf)
+{
+    struct sc_buf_crc *c = buf->crc;
+    uint32_t end = c->read ? buf->rpos : buf->wpos;
+
+    if (end > c->pos) {
+        c->crc = sc_crc32(c->crc, buf->mem + c->pos, end - c->pos);
+    }
+
+    c->pos = end;
+}
+#endif
+
 void sc_buf_compact(struct sc_buf *buf)
 {
     uint32_t copy;
 
+#ifdef SC_BUF_HAVE_CRC32
+    // Data is about to move, fold it while it is in cache and rebase.
+    if (buf->crc != NULL && buf->rpos != 0) {
+        sc_buf_crc_fold(buf);
+        buf->crc->pos -= buf->rpos;
+    }
+#endif
+
     if (buf->rpos == buf->wpos) {
         buf->rpos = 0;
         buf->wpos = 0;
@@ -204,78 +511,6 @@ void sc_buf_move(struct sc_buf *dest, struct sc_buf *src)
     src->rpos += size;
 }
 
-static uint16_t sc_buf_peek_8_pos(struct sc_buf *buf, uint32_t pos,
-                                  uint8_t *val)
-{
-    if (pos + sizeof(*val) > buf->wpos) {
-        buf->error |= SC_BUF_CORRUPT;
-        *val = 0;
-        return 0;
-    }
-
-    *val = buf->mem[pos];
-
-    return sizeof(*val);
-}
-
-static uint16_t sc_buf_peek_16_pos(struct sc_buf *buf, uint32_t pos,
-                                   uint16_t *val)
-{
-    unsigned char *p;
-
-    if (pos + sizeof(*val) > buf->wpos) {
-        buf->error |= SC_BUF_CORRUPT;
-        *val = 0;
-        return 0;
-    }
-
-    p = &buf->mem[pos];
-
-    *val = (uint16_t) p[0] << 0 | (uint16_t) p[1] << 8;
-
-    return sizeof(*val);
-}
-
-static uint32_t sc_buf_peek_32_pos(struct sc_buf *buf, uint32_t pos,
-                                   uint32_t *val)
-{
-    unsigned char *p;
-
-    if (pos + sizeof(*val) > buf->wpos) {
-        buf->error |= SC_BUF_CORRUPT;
-        *val = 0;
-        return 0;
-    }
-
-    p = &buf->mem[pos];
-
-    *val = (uint32_t) p[0] << 0 | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 |
-           (uint32_t) p[3] << 24;
-
-    return sizeof(*val);
-}
-
-static uint32_t sc_buf_peek_64_pos(struct sc_buf *buf, uint32_t pos,
-                                   uint64_t *val)
-{
-    unsigned char *p;
-
-    if (pos + sizeof(*val) > buf->wpos) {
-        buf->error |= SC_BUF_CORRUPT;
-        *val = 0;
-        return 0;
-    }
-
-    p = &buf->mem[pos];
-
-    *val = (uint64_t) p[0] << 0 | (uint64_t) p[1] << 8 | (uint64_t) p[2] << 16 |
-           (uint64_t) p[3] << 24 | (uint64_t) p[4] << 32 |
-           (uint64_t) p[5] << 40 | (uint64_t) p[6] << 48 |
-           (uint64_t) p[7] << 56;
-
-    return sizeof(*val);
-}
-
 static uint32_t sc_buf_set_8_pos(struct sc_buf *buf, uint32_t pos,
                                  const uint8_t *val)
 {
@@ -417,6 +652,21 @@ uint32_t sc_buf_peek_data(struct sc_buf *buf, uint32_t pos, unsigned char *dest,
     return len;
 }
 
+#ifdef SC_BUF_HAVE_SCAN
+uint32_t sc_buf_find(struct sc_buf *buf, uint32_t off,
+                     const struct sc_scan_set *set)
+{
+    uint32_t size = buf->wpos - buf->rpos;
+
+    if (buf->error != 0 || off >= size) {
+        return size;
+    }
+
+    return off + (uint32_t) sc_scan_find(set, &buf->mem[buf->rpos + off],
+                                         size - off);
+}
+#endif
+
 void sc_buf_set_8_at(struct sc_buf *buf, uint32_t pos, uint8_t val)
 {
     sc_buf_set_8_pos(buf, pos, &val);
@@ -474,42 +724,6 @@ bool sc_buf_get_bool(struct sc_buf *buf)
     return sc_buf_get_8(buf);
 }
 
-uint8_t sc_buf_get_8(struct sc_buf *buf)
-{
-    uint8_t val;
-
-    buf->rpos += sc_buf_peek_8_pos(buf, buf->rpos, &val);
-
-    return val;
-}
-
-uint16_t sc_buf_get_16(struct sc_buf *buf)
-{
-    uint16_t val;
-
-    buf->rpos += sc_buf_peek_16_pos(buf, buf->rpos, &val);
-
-    return val;
-}
-
-uint32_t sc_buf_get_32(struct sc_buf *buf)
-{
-    uint32_t val;
-
-    buf->rpos += sc_buf_peek_32_pos(buf, buf->rpos, &val);
-
-    return val;
-}
-
-uint64_t sc_buf_get_64(struct sc_buf *buf)
-{
-    uint64_t val;
-
-    buf->rpos += sc_buf_peek_64_pos(buf, buf->rpos, &val);
-
-    return val;
-}
-
 double sc_buf_get_double(struct sc_buf *buf)
 {
     double d;
@@ -553,6 +767,13 @@ void *sc_buf_get_blob(struct sc_buf *buf, uint32_t len)
     blob = buf->mem + buf->rpos;
     buf->rpos += len;
 
+#ifdef SC_BUF_HAVE_CRC32
+    if (buf->crc != NULL && buf->crc->read &&
+        buf->rpos - buf->crc->pos >= SC_BUF_CRC_CHUNK) {
+        sc_buf_crc_fold(buf);
+    }
+#endif
+
     return blob;
 }
 
@@ -564,6 +785,28 @@ void sc_buf_get_data(struct sc_buf *buf, void *dest, uint32_t len)
         return;
     }
 
+#ifdef SC_BUF_HAVE_CRC32
+    if (buf->crc != NULL && buf->crc->read) {
+        uint32_t n;
+        unsigned char *p = dest;
+
+        sc_buf_crc_fold(buf);
+
+        while (len > 0) {
+            n = sc_buf_min(len, SC_BUF_CRC_CHUNK);
+            buf->crc->crc = sc_crc32(buf->crc->crc, buf->mem + buf->rpos, n);
+            memcpy(p, buf->mem + buf->rpos, n);
+
+            buf->rpos += n;
+            p += n;
+            len -= n;
+        }
+
+        buf->crc->pos = buf->rpos;
+        return;
+    }
+#endif
+
     buf->rpos += sc_buf_peek_data(buf, buf->rpos, dest, len);
 }
 
@@ -573,6 +816,28 @@ void sc_buf_put_raw(struct sc_buf *buf, const void *ptr, uint32_t len)
         return;
     }
 
+#ifdef SC_BUF_HAVE_CRC32
+    if (buf->crc != NULL && !buf->crc->read) {
+        uint32_t n;
+        const unsigned char *p = ptr;
+
+        sc_buf_crc_fold(buf);
+
+        while (len > 0) {
+            n = sc_buf_min(len, SC_BUF_CRC_CHUNK);
+            memcpy(buf->mem + buf->wpos, p, n);
+            buf->crc->crc = sc_crc32(buf->crc->crc, p, n);
+
+            buf->wpos += n;
+            p += n;
+            len -= n;
+        }
+
+        buf->crc->pos = buf->wpos;
+        return;
+    }
+#endif
+
     buf->wpos += sc_buf_set_data(buf, buf->wpos, ptr, len);
 }
 
@@ -659,94 +924,376 @@ void sc_buf_put_str_len(struct sc_buf *buf, const char *str, int len)
     sc_buf_put_8(buf, '\0');
 }
 
-void sc_buf_put_fmt(struct sc_buf *buf, const char *fmt, ...)
+// Conversion spec for the fast formatting subset.
+struct sc_buf_spec
 {
-    int rc;
-    va_list args;
-    void *mem = (char *) sc_buf_wbuf(buf) + sc_buf_32_len(0);
-    uint32_t wr;
-    uint32_t pos = sc_buf_wpos(buf);
-    uint32_t quota = sc_buf_quota(buf);
+    char conv;
+    int len;
+    int prec;
+};
 
-    if (quota > sc_buf_32_len(0)) {
-        quota -= sc_buf_32_len(0);
-    } else {
-        quota = 0;
-    }
+/**
+ * Parses conversion spec after '%'. Supported subset is %%, %c, %s, %d, %i,
+ * %u, %x with 'l', 'll' and 'z' (only unsigned) length modifiers and %f with
+ * an optional single digit precision. Flags and width are not supported.
+ *
+ * @return pointer after the spec, NULL if spec is not supported.
+ */
+static const char *sc_buf_spec(const char *fmt, struct sc_buf_spec *spec)
+{
+    spec->len = 0;
+    spec->prec = -1;
 
-    va_start(args, fmt);
-    rc = vsnprintf(mem, quota, fmt, args);
-    va_end(args);
+    if (*fmt == '.') {
+        fmt++;
+        if (*fmt < '0' || *fmt > '9') {
+            return NULL;
+        }
 
-    if (rc < 0) {
-        buf->error |= SC_BUF_CORRUPT;
-        return;
+        spec->prec = *fmt++ - '0';
     }
 
-    wr = (uint32_t) rc;
-
-    if (wr >= quota) {
-        if (!sc_buf_reserve(buf, wr + sc_buf_32_len(0))) {
-            return;
+    if (*fmt == 'l') {
+        spec->len = 1;
+        if (*++fmt == 'l') {
+            spec->len = 2;
+            fmt++;
         }
+    } else if (*fmt == 'z') {
+        spec->len = 3;
+        fmt++;
+    }
 
-        mem = (char *) sc_buf_wbuf(buf) + sc_buf_32_len(0);
-        quota = sc_buf_quota(buf) - sc_buf_32_len(0);
-
-        va_start(args, fmt);
-        rc = vsnprintf(mem, quota, fmt, args);
-        va_end(args);
-
-        if (rc < 0 || (uint32_t) rc >= quota) {
-            buf->error |= SC_BUF_OOM;
-            return;
+    switch (*fmt) {
+    case 'd':
+    case 'i':
+        if (spec->prec != -1 || spec->len == 3) {
+            return NULL;
         }
-
-        wr = (uint32_t) rc;
+        break;
+    case 'u':
+    case 'x':
+        if (spec->prec != -1) {
+            return NULL;
+        }
+        break;
+    case 'f':
+        if (spec->len > 1) {
+            return NULL;
+        }
+        break;
+    case 'c':
+    case 's':
+    case '%':
+        if (spec->prec != -1 || spec->len != 0) {
+            return NULL;
+        }
+        break;
+    default:
+        return NULL;
     }
 
-    sc_buf_set_32_at(buf, pos, wr);
-    sc_buf_mark_write(buf, wr + sc_buf_32_len(0) + sc_buf_8_len('\0'));
+    spec->conv = *fmt;
+
+    return fmt + 1;
 }
 
-void sc_buf_put_text(struct sc_buf *buf, const char *fmt, ...)
+// Writes digits backwards from 'end', returns pointer to the first digit.
+static char *sc_buf_utoa(char *end, uint64_t val, unsigned int base)
 {
-    int rc;
-    uint32_t written;
-    va_list args;
-    int offset = sc_buf_size(buf) > 0 ? 1 : 0;
-    uint32_t quota = sc_buf_quota(buf);
+    static const char digits[] = "0123456789abcdef";
 
-    va_start(args, fmt);
-    rc = vsnprintf((char *) sc_buf_wbuf(buf) - offset, quota, fmt, args);
-    va_end(args);
+    do {
+        *--end = digits[val % base];
+        val /= base;
+    } while (val != 0);
+
+    return end;
+}
+
+/**
+ * Formats 'val' with 'prec' digits after the decimal point like "%.*f".
+ * Only values that can be rounded exactly with 53-bit integer arithmetic are
+ * handled, e.g. NaN, infinity, large values and values near to a rounding
+ * boundary are left to vsnprintf().
+ *
+ * @return pointer to the first char, NULL if value is not supported.
+ */
+static char *sc_buf_ftoa(char *end, double val, int prec)
+{
+    static const uint64_t pow10[] = {1,      10,      100,      1000,
+                                     10000,  100000,  1000000,  10000000,
+                                     100000000, 1000000000};
+    char *p;
+    bool neg;
+    uint64_t bits, n;
+    double r, frac;
+
+    memcpy(&bits, &val, sizeof(bits));
+    neg = (bits >> 63u) != 0;
+
+    r = (neg ? -val : val) * (double) pow10[prec];
+    if (!(r < 9007199254740992.0)) {
+        return NULL;
+    }
+
+    n = (uint64_t) r;
+    frac = r - (double) n;
+
+    // Multiplication error is at most a few ulps, ties are ambiguous.
+    if (frac - 0.5 <= r * 1e-15 && 0.5 - frac <= r * 1e-15) {
+        return NULL;
+    }
+
+    n += frac > 0.5;
+    p = end;
+
+    if (prec > 0) {
+        for (int i = 0; i < prec; i++) {
+            *--p = (char) ('0' + n % 10);
+            n /= 10;
+        }
+        *--p = '.';
+    }
+
+    p = sc_buf_utoa(p, n, 10);
+    if (neg) {
+        *--p = '-';
+    }
+
+    return p;
+}
+
+/**
+ * Fast formatting for a subset of printf() conversions. If 'dst' is NULL,
+ * only output length is calculated.
+ *
+ * @return output length excluding '\0', -1 if format or an argument is not
+ *         supported.
+ */
+static int64_t sc_buf_fmt_fast(char *dst, const char *fmt, va_list args)
+{
+    char tmp[64];
+    char *end = tmp + sizeof(tmp);
+    char *p;
+    const char *s;
+    size_t n;
+    int64_t i;
+    uint64_t u;
+    struct sc_buf_spec spec;
+    uint64_t len = 0;
+
+    while (*fmt != '\0') {
+        if (*fmt != '%') {
+            s = fmt;
+            while (*fmt != '\0' && *fmt != '%') {
+                fmt++;
+            }
+
+            n = (size_t) (fmt - s);
+            goto emit;
+        }
+
+        fmt = sc_buf_spec(fmt + 1, &spec);
+        if (fmt == NULL) {
+            return -1;
+        }
+
+        switch (spec.conv) {
+        case '%':
+            s = "%";
+            n = 1;
+            break;
+        case 'c':
+            tmp[0] = (char) va_arg(args, int);
+            s = tmp;
+            n = 1;
+            break;
+        case 's':
+            s = va_arg(args, const char *);
+            if (s == NULL) {
+                return -1;
+            }
+            n = strlen(s);
+            break;
+        case 'd':
+        case 'i':
+            i = spec.len == 0 ? va_arg(args, int) :
+                spec.len == 1 ? va_arg(args, long) :
+                                va_arg(args, long long);
+
+            u = i < 0 ? 0 - (uint64_t) i : (uint64_t) i;
+            p = sc_buf_utoa(end, u, 10);
+            if (i < 0) {
+                *--p = '-';
+            }
+            s = p;
+            n = (size_t) (end - s);
+            break;
+        case 'u':
+        case 'x':
+            u = spec.len == 0 ? va_arg(args, unsigned int) :
+                spec.len == 1 ? va_arg(args, unsigned long) :
+                spec.len == 2 ? va_arg(args, unsigned long long) :
+                                va_arg(args, size_t);
+
+            s = sc_buf_utoa(end, u, spec.conv == 'u' ? 10 : 16);
+            n = (size_t) (end - s);
+            break;
+        default:
+            s = sc_buf_ftoa(end, va_arg(args, double),
+                            spec.prec == -1 ? 6 : spec.prec);
+            if (s == NULL) {
+                return -1;
+            }
+            n = (size_t) (end - s);
+            break;
+        }
+
+emit:
+        if (n > INT32_MAX - len) {
+            return -1;
+        }
+
+        if (dst != NULL) {
+            memcpy(dst + len, s, n);
+        }
+
+        len += n;
+    }
+
+    return (int64_t) len;
+}
+
+/**
+ * Formats at 'skip' bytes after write position and puts '\0' at the end.
+ * Write position is not advanced. Tries the fast formatting subset first,
+ * falls back to vsnprintf() with a size hint from previous calls, so
+ * formatting twice is rare.
+ *
+ * @return 'false' on error, error flags are set.
+ */
+static bool sc_buf_format(struct sc_buf *buf, uint32_t skip, uint32_t *out,
+                          const char *fmt, va_list args)
+{
+    int rc;
+    int64_t len;
+    char *mem;
+    uint32_t quota;
+    va_list copy;
+
+    if (buf->error != 0) {
+        return false;
+    }
+
+    va_copy(copy, args);
+    len = sc_buf_fmt_fast(NULL, fmt, copy);
+    va_end(copy);
+
+    if (len >= 0) {
+        if (!sc_buf_reserve(buf, skip + (uint32_t) len + 1)) {
+            return false;
+        }
+
+        mem = (char *) sc_buf_wbuf(buf) + skip;
+
+        va_copy(copy, args);
+        sc_buf_fmt_fast(mem, fmt, copy);
+        va_end(copy);
+
+        mem[len] = '\0';
+        *out = (uint32_t) len;
+
+        return true;
+    }
+
+    if (buf->hint != 0 && sc_buf_quota(buf) < skip + buf->hint &&
+        (uint64_t) sc_buf_size(buf) + skip + buf->hint <= buf->limit) {
+        if (!sc_buf_reserve(buf, skip + buf->hint)) {
+            return false;
+        }
+    }
+
+    quota = sc_buf_quota(buf) > skip ? sc_buf_quota(buf) - skip : 0;
+    mem = quota > 0 ? (char *) sc_buf_wbuf(buf) + skip : NULL;
+
+    va_copy(copy, args);
+    rc = vsnprintf(mem, quota, fmt, copy);
+    va_end(copy);
 
     if (rc < 0) {
         buf->error |= SC_BUF_CORRUPT;
-        sc_buf_set_wpos(buf, 0);
-        return;
+        return false;
     }
 
-    written = (uint32_t) rc;
-
-    if (written >= quota) {
-        if (!sc_buf_reserve(buf, written + 1)) {
-            sc_buf_set_wpos(buf, 0);
-            return;
+    if ((uint32_t) rc >= quota) {
+        if ((uint32_t) rc > UINT32_MAX - skip - 1 ||
+            !sc_buf_reserve(buf, skip + (uint32_t) rc + 1)) {
+            buf->error |= SC_BUF_OOM;
+            return false;
         }
 
-        va_start(args, fmt);
-        rc = vsnprintf((char *) sc_buf_wbuf(buf) - offset, quota, fmt, args);
-        va_end(args);
+        mem = (char *) sc_buf_wbuf(buf) + skip;
+        quota = sc_buf_quota(buf) - skip;
+
+        va_copy(copy, args);
+        rc = vsnprintf(mem, quota, fmt, copy);
+        va_end(copy);
 
         if (rc < 0 || (uint32_t) rc >= quota) {
-            sc_buf_set_wpos(buf, 0);
-            buf->error = SC_BUF_OOM;
-            return;
+            buf->error |= SC_BUF_OOM;
+            return false;
         }
     }
 
-    sc_buf_mark_write(buf, rc + sc_buf_8_len('\0') - offset);
+    // Keep hint close to recent sizes, grows immediately, shrinks slowly.
+    quota = (uint32_t) rc + 1;
+    buf->hint = quota > buf->hint - buf->hint / 4 ? quota :
+                                                   buf->hint - buf->hint / 4;
+    *out = (uint32_t) rc;
+
+    return true;
+}
+
+void sc_buf_put_fmt(struct sc_buf *buf, const char *fmt, ...)
+{
+    bool rc;
+    uint32_t len;
+    va_list args;
+
+    va_start(args, fmt);
+    rc = sc_buf_format(buf, sc_buf_32_len(0), &len, fmt, args);
+    va_end(args);
+
+    if (!rc) {
+        return;
+    }
+
+    sc_buf_set_32_at(buf, buf->wpos, len);
+    sc_buf_mark_write(buf, len + sc_buf_32_len(0) + sc_buf_8_len('\0'));
+}
+
+void sc_buf_put_text(struct sc_buf *buf, const char *fmt, ...)
+{
+    bool rc;
+    uint32_t len;
+    va_list args;
+
+    // Previous string's '\0' is overwritten, so strings are concatenated.
+    if (sc_buf_size(buf) > 0) {
+        buf->wpos--;
+    }
+
+    va_start(args, fmt);
+    rc = sc_buf_format(buf, 0, &len, fmt, args);
+    va_end(args);
+
+    if (!rc) {
+        sc_buf_set_wpos(buf, 0);
+        return;
+    }
+
+    sc_buf_mark_write(buf, len + sc_buf_8_len('\0'));
 }
 
 void sc_buf_put_blob(struct sc_buf *buf, const void *ptr, uint32_t len)
@@ -754,3 +1301,972 @@ void sc_buf_put_blob(struct sc_buf *buf, const void *ptr, uint32_t len)
     sc_buf_put_32(buf, len);
     sc_buf_put_raw(buf, ptr, len);
 }
+
+void sc_buf_put_varint(struct sc_buf *buf, uint64_t val)
+{
+    unsigned char *p;
+    uint32_t len = sc_buf_varint_len(val);
+
+    if (buf->error != 0 || !sc_buf_reserve(buf, len)) {
+        return;
+    }
+
+    p = &buf->mem[buf->wpos];
+
+    while (val >= 0x80) {
+        *p++ = (unsigned char) (val | 0x80);
+        val >>= 7u;
+    }
+
+    *p = (unsigned char) val;
+    buf->wpos += len;
+}
+
+void sc_buf_put_svarint(struct sc_buf *buf, int64_t val)
+{
+    sc_buf_put_varint(buf, sc_buf_zigzag(val));
+}
+
+uint64_t sc_buf_get_varint(struct sc_buf *buf)
+{
+    unsigned char b;
+    uint64_t val = 0;
+    uint32_t end = sc_buf_min(buf->wpos - buf->rpos, 10);
+
+    for (uint32_t i = 0; i < end; i++) {
+        b = buf->mem[buf->rpos + i];
+
+        // 10th byte can only carry the most significant bit
+        if (i == 9 && b > 1) {
+            break;
+        }
+
+        val |= (uint64_t) (b & 0x7f) << (7 * i);
+
+        if ((b & 0x80) == 0) {
+            buf->rpos += i + 1;
+            return val;
+        }
+    }
+
+    buf->error |= SC_BUF_CORRUPT;
+    return 0;
+}
+
+int64_t sc_buf_get_svarint(struct sc_buf *buf)
+{
+    return sc_buf_unzigzag(sc_buf_get_varint(buf));
+}
+
+void sc_buf_put_vstr(struct sc_buf *buf, const char *str)
+{
+    size_t size;
+
+    if (str == NULL) {
+        sc_buf_put_varint(buf, 0);
+        return;
+    }
+
+    size = strlen(str);
+    if (size >= UINT32_MAX - 16) {
+        buf->error |= SC_BUF_CORRUPT;
+        return;
+    }
+
+    if (!sc_buf_reserve(buf, sc_buf_varint_len(size + 1) + (uint32_t) size +
+                                     sc_buf_8_len('\0'))) {
+        return;
+    }
+
+    sc_buf_put_varint(buf, size + 1);
+    sc_buf_put_raw(buf, str, (uint32_t) size + sc_buf_8_len('\0'));
+}
+
+const char *sc_buf_get_vstr(struct sc_buf *buf)
+{
+    uint64_t len;
+    const char *str;
+
+    len = sc_buf_get_varint(buf);
+    if (len == 0) {
+        return NULL;
+    }
+
+    // 'len' includes '\0' at the end, (len - 1) is string length.
+    if (len > buf->wpos - buf->rpos || buf->mem[buf->rpos + len - 1] != '\0') {
+        buf->error |= SC_BUF_CORRUPT;
+        return NULL;
+    }
+
+    str = (char *) buf->mem + buf->rpos;
+    buf->rpos += (uint32_t) len;
+
+    return str;
+}
+
+void sc_buf_put_vblob(struct sc_buf *buf, const void *ptr, uint32_t len)
+{
+    if (len > UINT32_MAX - 16) {
+        buf->error |= SC_BUF_CORRUPT;
+        return;
+    }
+
+    if (!sc_buf_reserve(buf, len + sc_buf_varint_len(len))) {
+        return;
+    }
+
+    sc_buf_put_varint(buf, len);
+    if (len > 0) {
+        sc_buf_put_raw(buf, ptr, len);
+    }
+}
+
+void *sc_buf_get_vblob(struct sc_buf *buf, uint32_t *len)
+{
+    uint64_t n;
+    void *blob;
+
+    *len = 0;
+
+    n = sc_buf_get_varint(buf);
+    if (n == 0) {
+        return NULL;
+    }
+
+    if (n > buf->wpos - buf->rpos) {
+        buf->error |= SC_BUF_CORRUPT;
+        return NULL;
+    }
+
+    blob = buf->mem + buf->rpos;
+    buf->rpos += (uint32_t) n;
+    *len = (uint32_t) n;
+
+    return blob;
+}
+
+// Copies 'count' values of 'size' bytes, swaps byte order on big endian
+// platforms. Loop is simple enough to be vectorized by the compiler.
+static void sc_buf_copy_le(unsigned char *dst, const unsigned char *src,
+                           uint32_t count, uint32_t size)
+{
+#ifdef SC_BUF_LITTLE_ENDIAN
+    memcpy(dst, src, (size_t) count * size);
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t j = 0; j < size; j++) {
+            dst[j] = src[size - 1 - j];
+        }
+
+        dst += size;
+        src += size;
+    }
+#endif
+}
+
+static void sc_buf_put_array(struct sc_buf *buf, const void *vals,
+                             uint32_t count, uint32_t size)
+{
+    uint64_t len = (uint64_t) count * size;
+
+    if (len > UINT32_MAX) {
+        buf->error |= SC_BUF_CORRUPT;
+        return;
+    }
+
+    if (buf->error != 0 || !sc_buf_reserve(buf, (uint32_t) len)) {
+        return;
+    }
+
+    sc_buf_copy_le(&buf->mem[buf->wpos], vals, count, size);
+    buf->wpos += (uint32_t) len;
+}
+
+static void sc_buf_get_array(struct sc_buf *buf, void *vals, uint32_t count,
+                             uint32_t size)
+{
+    uint64_t len = (uint64_t) count * size;
+
+    if (buf->error != 0 || len > buf->wpos - buf->rpos) {
+        buf->error |= SC_BUF_CORRUPT;
+        memset(vals, 0, (size_t) len);
+        return;
+    }
+
+    sc_buf_copy_le(vals, &buf->mem[buf->rpos], count, size);
+    buf->rpos += (uint32_t) len;
+}
+
+void sc_buf_put_array_32(struct sc_buf *buf, const uint32_t *vals,
+                         uint32_t count)
+{
+    sc_buf_put_array(buf, vals, count, sizeof(*vals));
+}
+
+void sc_buf_put_array_64(struct sc_buf *buf, const uint64_t *vals,
+                         uint32_t count)
+{
+    sc_buf_put_array(buf, vals, count, sizeof(*vals));
+}
+
+void sc_buf_put_array_double(struct sc_buf *buf, const double *vals,
+                             uint32_t count)
+{
+    sc_buf_put_array(buf, vals, count, sizeof(*vals));
+}
+
+void sc_buf_get_array_32(struct sc_buf *buf, uint32_t *vals, uint32_t count)
+{
+    sc_buf_get_array(buf, vals, count, sizeof(*vals));
+}
+
+void sc_buf_get_array_64(struct sc_buf *buf, uint64_t *vals, uint32_t count)
+{
+    sc_buf_get_array(buf, vals, count, sizeof(*vals));
+}
+
+void sc_buf_get_array_double(struct sc_buf *buf, double *vals, uint32_t count)
+{
+    sc_buf_get_array(buf, vals, count, sizeof(*vals));
+}
+
+bool sc_buf_wcursor(struct sc_buf *buf, struct sc_buf_cursor *c, uint32_t len)
+{
+    if (buf->error != 0 || !sc_buf_reserve(buf, len)) {
+        return false;
+    }
+
+    c->pos = buf->mem + buf->wpos;
+    c->end = c->pos + len;
+
+    return true;
+}
+
+void sc_buf_wcommit(struct sc_buf *buf, struct sc_buf_cursor *c)
+{
+    assert(c->pos <= c->end);
+    sc_buf_mark_write(buf, (uint32_t) (c->pos - (buf->mem + buf->wpos)));
+}
+
+bool sc_buf_rcursor(struct sc_buf *buf, struct sc_buf_cursor *c, uint32_t len)
+{
+    if (buf->error != 0 || sc_buf_size(buf) < len) {
+        buf->error |= SC_BUF_CORRUPT;
+        return false;
+    }
+
+    c->pos = buf->mem + buf->rpos;
+    c->end = c->pos + len;
+
+    return true;
+}
+
+void sc_buf_rcommit(struct sc_buf *buf, struct sc_buf_cursor *c)
+{
+    assert(c->pos <= c->end);
+    sc_buf_mark_read(buf, (uint32_t) (c->pos - (buf->mem + buf->rpos)));
+}
+
+void sc_buf_seg_pool_init(struct sc_buf_seg_pool *pool, uint32_t seg_size,
+                          uint32_t max)
+{
+    assert(seg_size > 0);
+
+    *pool = (struct sc_buf_seg_pool){
+            .seg_size = seg_size,
+            .max = max,
+    };
+}
+
+void sc_buf_seg_pool_term(struct sc_buf_seg_pool *pool)
+{
+    struct sc_buf_block *block;
+
+    while ((block = pool->blocks) != NULL) {
+        pool->blocks = block->next;
+        sc_buf_free(block);
+    }
+
+    pool->count = 0;
+}
+
+static struct sc_buf_seg *sc_buf_block_get(struct sc_buf_seg_pool *pool,
+                                           uint32_t len)
+{
+    uint32_t cap = len > pool->seg_size ? len : pool->seg_size;
+    struct sc_buf_block *block = NULL;
+
+    if (cap == pool->seg_size && pool->blocks != NULL) {
+        block = pool->blocks;
+        pool->blocks = block->next;
+        pool->count--;
+    }
+
+    if (block == NULL) {
+        // Overflow check for 32-bit platforms
+        if (sizeof(*block) + (size_t) cap < cap) {
+            return NULL;
+        }
+
+        block = sc_buf_malloc(sizeof(*block) + cap);
+        if (block == NULL) {
+            return NULL;
+        }
+
+        block->cap = cap;
+    }
+
+    block->next = NULL;
+    block->refs = 1;
+    block->seg.next = NULL;
+    block->seg.block = block;
+    block->seg.buf = sc_buf_wrap(block->data, block->cap, SC_BUF_REF);
+
+    return &block->seg;
+}
+
+static void sc_buf_seg_release(struct sc_buf_seg_pool *pool,
+                               struct sc_buf_seg *seg)
+{
+    struct sc_buf_block *block = seg->block;
+
+    if (seg != &block->seg) {
+        sc_buf_free(seg);
+    }
+
+    if (--block->refs > 0) {
+        return;
+    }
+
+    if (block->cap == pool->seg_size && pool->count < pool->max) {
+        block->next = pool->blocks;
+        pool->blocks = block;
+        pool->count++;
+        return;
+    }
+
+    sc_buf_free(block);
+}
+
+void sc_buf_chain_init(struct sc_buf_chain *chain, struct sc_buf_seg_pool *pool)
+{
+    *chain = (struct sc_buf_chain){.pool = pool};
+}
+
+void sc_buf_chain_term(struct sc_buf_chain *chain)
+{
+    struct sc_buf_seg *seg;
+
+    while ((seg = chain->head) != NULL) {
+        chain->head = seg->next;
+        sc_buf_seg_release(chain->pool, seg);
+    }
+
+    sc_buf_chain_init(chain, chain->pool);
+}
+
+bool sc_buf_chain_valid(struct sc_buf_chain *chain)
+{
+    return chain->error == 0;
+}
+
+uint32_t sc_buf_chain_size(struct sc_buf_chain *chain)
+{
+    return chain->size;
+}
+
+void sc_buf_chain_clear(struct sc_buf_chain *chain)
+{
+    sc_buf_chain_term(chain);
+}
+
+static void sc_buf_chain_append(struct sc_buf_chain *chain,
+                                struct sc_buf_seg *seg)
+{
+    seg->next = NULL;
+
+    if (chain->tail != NULL) {
+        chain->tail->next = seg;
+    } else {
+        chain->head = seg;
+    }
+
+    chain->tail = seg;
+}
+
+/**
+ * Releases fully read segments at the head. Releasing is deferred to the next
+ * operation, so pointers returned by get_str/get_blob stay valid until then.
+ * Last segment is kept and rewound if its block is not shared.
+ */
+static void sc_buf_chain_gc(struct sc_buf_chain *chain)
+{
+    struct sc_buf_seg *seg;
+
+    while ((seg = chain->head) != NULL && sc_buf_size(&seg->buf) == 0) {
+        if (seg == chain->tail) {
+            if (seg->block->refs == 1) {
+                sc_buf_clear(&seg->buf);
+            }
+            break;
+        }
+
+        chain->head = seg->next;
+        sc_buf_seg_release(chain->pool, seg);
+    }
+}
+
+static bool sc_buf_chain_expand(struct sc_buf_chain *chain, uint32_t len)
+{
+    struct sc_buf_seg *seg;
+
+    seg = sc_buf_block_get(chain->pool, len);
+    if (seg == NULL) {
+        chain->error |= SC_BUF_OOM;
+        return false;
+    }
+
+    sc_buf_chain_append(chain, seg);
+
+    return true;
+}
+
+bool sc_buf_chain_reserve(struct sc_buf_chain *chain, uint32_t len)
+{
+    sc_buf_chain_gc(chain);
+
+    if (sc_buf_chain_quota(chain) >= len && chain->tail != NULL) {
+        return true;
+    }
+
+    return sc_buf_chain_expand(chain, len);
+}
+
+uint32_t sc_buf_chain_quota(struct sc_buf_chain *chain)
+{
+    return chain->tail != NULL ? sc_buf_quota(&chain->tail->buf) : 0;
+}
+
+void *sc_buf_chain_wbuf(struct sc_buf_chain *chain)
+{
+    return chain->tail != NULL ? sc_buf_wbuf(&chain->tail->buf) : NULL;
+}
+
+void sc_buf_chain_mark_write(struct sc_buf_chain *chain, uint32_t len)
+{
+    assert(len <= sc_buf_chain_quota(chain));
+
+    sc_buf_mark_write(&chain->tail->buf, len);
+    chain->size += len;
+}
+
+// Consumes 'len' bytes, 'len' must be less than or equal to chain size.
+static void sc_buf_chain_read(struct sc_buf_chain *chain, unsigned char *dest,
+                              uint32_t len)
+{
+    uint32_t n;
+    struct sc_buf_seg *seg;
+
+    while (len > 0) {
+        seg = chain->head;
+        n = sc_buf_min(sc_buf_size(&seg->buf), len);
+
+        if (dest != NULL) {
+            memcpy(dest, sc_buf_rbuf(&seg->buf), n);
+            dest += n;
+        }
+
+        sc_buf_mark_read(&seg->buf, n);
+        chain->size -= n;
+        len -= n;
+
+        // There is more data, so 'seg' is not the last segment.
+        if (len > 0) {
+            chain->head = seg->next;
+            sc_buf_seg_release(chain->pool, seg);
+        }
+    }
+}
+
+void sc_buf_chain_mark_read(struct sc_buf_chain *chain, uint32_t len)
+{
+    assert(len <= chain->size);
+
+    sc_buf_chain_gc(chain);
+    sc_buf_chain_read(chain, NULL, len);
+}
+
+void *sc_buf_chain_pullup(struct sc_buf_chain *chain, uint32_t len)
+{
+    uint32_t n;
+    struct sc_buf_seg *seg, *next;
+
+    if (len == 0) {
+        return NULL;
+    }
+
+    if (len > chain->size) {
+        chain->error |= SC_BUF_CORRUPT;
+        return NULL;
+    }
+
+    sc_buf_chain_gc(chain);
+
+    seg = chain->head;
+    if (sc_buf_size(&seg->buf) >= len) {
+        return sc_buf_rbuf(&seg->buf);
+    }
+
+    if (seg->block->refs == 1 && sc_buf_cap(&seg->buf) >= len) {
+        sc_buf_compact(&seg->buf);
+    } else {
+        seg = sc_buf_block_get(chain->pool, len);
+        if (seg == NULL) {
+            chain->error |= SC_BUF_OOM;
+            return NULL;
+        }
+
+        seg->next = chain->head;
+        chain->head = seg;
+    }
+
+    while (sc_buf_size(&seg->buf) < len) {
+        next = seg->next;
+        n = sc_buf_min(len - sc_buf_size(&seg->buf), sc_buf_size(&next->buf));
+
+        memcpy(sc_buf_wbuf(&seg->buf), sc_buf_rbuf(&next->buf), n);
+        sc_buf_mark_write(&seg->buf, n);
+        sc_buf_mark_read(&next->buf, n);
+
+        if (sc_buf_size(&next->buf) == 0 && next != chain->tail) {
+            seg->next = next->next;
+            sc_buf_seg_release(chain->pool, next);
+        }
+    }
+
+    return sc_buf_rbuf(&seg->buf);
+}
+
+bool sc_buf_chain_split(struct sc_buf_chain *src, struct sc_buf_chain *dest,
+                        uint32_t len)
+{
+    uint32_t n;
+    struct sc_buf_seg *seg, *view;
+    struct sc_buf_block *block;
+
+    if (len > src->size) {
+        src->error |= SC_BUF_CORRUPT;
+        return false;
+    }
+
+    if ((uint64_t) dest->size + len > UINT32_MAX) {
+        src->error |= SC_BUF_OOM;
+        return false;
+    }
+
+    // At most one segment is shared, allocate it upfront so split is atomic.
+    view = sc_buf_malloc(sizeof(*view));
+    if (view == NULL) {
+        src->error |= SC_BUF_OOM;
+        return false;
+    }
+
+    sc_buf_chain_gc(src);
+    sc_buf_chain_gc(dest);
+
+    while (len > 0) {
+        seg = src->head;
+        n = sc_buf_size(&seg->buf);
+
+        if (n <= len) {
+            src->head = seg->next;
+            if (src->head == NULL) {
+                src->tail = NULL;
+            }
+
+            if (n == 0) {
+                sc_buf_seg_release(src->pool, seg);
+                continue;
+            }
+
+            sc_buf_chain_append(dest, seg);
+            src->size -= n;
+            dest->size += n;
+            len -= n;
+            continue;
+        }
+
+        block = seg->block;
+        block->refs++;
+
+        // Shared prefix is read only for 'dest', its capacity ends at
+        // the last byte it owns.
+        view->block = block;
+        view->buf = sc_buf_wrap(block->data, sc_buf_rpos(&seg->buf) + len,
+                                SC_BUF_REF | SC_BUF_DATA);
+        sc_buf_set_rpos(&view->buf, sc_buf_rpos(&seg->buf));
+        sc_buf_mark_read(&seg->buf, len);
+
+        sc_buf_chain_append(dest, view);
+        src->size -= len;
+        dest->size += len;
+        view = NULL;
+        break;
+    }
+
+    sc_buf_free(view);
+
+    return true;
+}
+
+void sc_buf_chain_put_raw(struct sc_buf_chain *chain, const void *ptr,
+                          uint32_t len)
+{
+    uint32_t n;
+    const unsigned char *p = ptr;
+
+    if ((uint64_t) chain->size + len > UINT32_MAX) {
+        chain->error |= SC_BUF_OOM;
+        return;
+    }
+
+    sc_buf_chain_gc(chain);
+
+    while (len > 0) {
+        n = sc_buf_chain_quota(chain);
+        if (n == 0) {
+            if (!sc_buf_chain_expand(chain, 1)) {
+                return;
+            }
+            n = sc_buf_chain_quota(chain);
+        }
+
+        n = sc_buf_min(n, len);
+
+        memcpy(sc_buf_wbuf(&chain->tail->buf), p, n);
+        sc_buf_chain_mark_write(chain, n);
+        p += n;
+        len -= n;
+    }
+}
+
+// Returns last segment if it has 'len' bytes contiguous space.
+static struct sc_buf *sc_buf_chain_wr(struct sc_buf_chain *chain,
+                                      uint32_t len)
+{
+    sc_buf_chain_gc(chain);
+
+    if (sc_buf_chain_quota(chain) < len ||
+        (uint64_t) chain->size + len > UINT32_MAX) {
+        return NULL;
+    }
+
+    chain->size += len;
+
+    return &chain->tail->buf;
+}
+
+// Slow path, encodes into a temporary buffer and writes across segments.
+static void sc_buf_chain_put_le(struct sc_buf_chain *chain, uint64_t val,
+                                uint32_t len)
+{
+    unsigned char tmp[8];
+
+    for (uint32_t i = 0; i < len; i++) {
+        tmp[i] = (unsigned char) (val >> (i * 8));
+    }
+
+    sc_buf_chain_put_raw(chain, tmp, len);
+}
+
+void sc_buf_chain_put_bool(struct sc_buf_chain *chain, bool val)
+{
+    sc_buf_chain_put_8(chain, (uint8_t) val);
+}
+
+void sc_buf_chain_put_8(struct sc_buf_chain *chain, uint8_t val)
+{
+    struct sc_buf *buf = sc_buf_chain_wr(chain, sizeof(val));
+
+    if (buf == NULL) {
+        sc_buf_chain_put_le(chain, val, sizeof(val));
+        return;
+    }
+
+    sc_buf_put_8(buf, val);
+}
+
+void sc_buf_chain_put_16(struct sc_buf_chain *chain, uint16_t val)
+{
+    struct sc_buf *buf = sc_buf_chain_wr(chain, sizeof(val));
+
+    if (buf == NULL) {
+        sc_buf_chain_put_le(chain, val, sizeof(val));
+        return;
+    }
+
+    sc_buf_put_16(buf, val);
+}
+
+void sc_buf_chain_put_32(struct sc_buf_chain *chain, uint32_t val)
+{
+    struct sc_buf *buf = sc_buf_chain_wr(chain, sizeof(val));
+
+    if (buf == NULL) {
+        sc_buf_chain_put_le(chain, val, sizeof(val));
+        return;
+    }
+
+    sc_buf_put_32(buf, val);
+}
+
+void sc_buf_chain_put_64(struct sc_buf_chain *chain, uint64_t val)
+{
+    struct sc_buf *buf = sc_buf_chain_wr(chain, sizeof(val));
+
+    if (buf == NULL) {
+        sc_buf_chain_put_le(chain, val, sizeof(val));
+        return;
+    }
+
+    sc_buf_put_64(buf, val);
+}
+
+void sc_buf_chain_put_double(struct sc_buf_chain *chain, double val)
+{
+    uint64_t sw;
+
+    memcpy(&sw, &val, 8);
+    sc_buf_chain_put_64(chain, sw);
+}
+
+void sc_buf_chain_put_str(struct sc_buf_chain *chain, const char *str)
+{
+    size_t size;
+
+    if (str == NULL) {
+        sc_buf_chain_put_32(chain, UINT32_MAX);
+        return;
+    }
+
+    size = strlen(str);
+    if (size >= UINT32_MAX - sc_buf_32_len(0)) {
+        chain->error |= SC_BUF_CORRUPT;
+        return;
+    }
+
+    // Keep string in a single segment, so reader can get it without a copy.
+    if (!sc_buf_chain_reserve(chain, (uint32_t) size + sc_buf_32_len(0) +
+                                             sc_buf_8_len('\0'))) {
+        return;
+    }
+
+    sc_buf_chain_put_32(chain, (uint32_t) size);
+    sc_buf_chain_put_raw(chain, str, (uint32_t) size + sc_buf_8_len('\0'));
+}
+
+void sc_buf_chain_put_blob(struct sc_buf_chain *chain, const void *ptr,
+                           uint32_t len)
+{
+    if (len > UINT32_MAX - sc_buf_32_len(0)) {
+        chain->error |= SC_BUF_CORRUPT;
+        return;
+    }
+
+    if (!sc_buf_chain_reserve(chain, len + sc_buf_32_len(0))) {
+        return;
+    }
+
+    sc_buf_chain_put_32(chain, len);
+    sc_buf_chain_put_raw(chain, ptr, len);
+}
+
+void sc_buf_chain_get_data(struct sc_buf_chain *chain, void *dest,
+                           uint32_t len)
+{
+    if (len > chain->size) {
+        chain->error |= SC_BUF_CORRUPT;
+        memset(dest, 0, len);
+        return;
+    }
+
+    sc_buf_chain_gc(chain);
+    sc_buf_chain_read(chain, dest, len);
+}
+
+// Returns first segment if it has 'len' bytes contiguous data.
+static struct sc_buf *sc_buf_chain_rd(struct sc_buf_chain *chain,
+                                      uint32_t len)
+{
+    sc_buf_chain_gc(chain);
+
+    if (chain->head == NULL || sc_buf_size(&chain->head->buf) < len) {
+        return NULL;
+    }
+
+    chain->size -= len;
+
+    return &chain->head->buf;
+}
+
+// Slow path, value spans multiple segments.
+static uint64_t sc_buf_chain_get_le(struct sc_buf_chain *chain, uint32_t len)
+{
+    uint64_t val = 0;
+    unsigned char tmp[8];
+
+    sc_buf_chain_get_data(chain, tmp, len);
+
+    for (uint32_t i = 0; i < len; i++) {
+        val |= (uint64_t) tmp[i] << (i * 8);
+    }
+
+    return val;
+}
+
+bool sc_buf_chain_get_bool(struct sc_buf_chain *chain)
+{
+    return sc_buf_chain_get_8(chain);
+}
+
+uint8_t sc_buf_chain_get_8(struct sc_buf_chain *chain)
+{
+    struct sc_buf *buf = sc_buf_chain_rd(chain, sizeof(uint8_t));
+
+    if (buf == NULL) {
+        return (uint8_t) sc_buf_chain_get_le(chain, sizeof(uint8_t));
+    }
+
+    return sc_buf_get_8(buf);
+}
+
+uint16_t sc_buf_chain_get_16(struct sc_buf_chain *chain)
+{
+    struct sc_buf *buf = sc_buf_chain_rd(chain, sizeof(uint16_t));
+
+    if (buf == NULL) {
+        return (uint16_t) sc_buf_chain_get_le(chain, sizeof(uint16_t));
+    }
+
+    return sc_buf_get_16(buf);
+}
+
+uint32_t sc_buf_chain_get_32(struct sc_buf_chain *chain)
+{
+    struct sc_buf *buf = sc_buf_chain_rd(chain, sizeof(uint32_t));
+
+    if (buf == NULL) {
+        return (uint32_t) sc_buf_chain_get_le(chain, sizeof(uint32_t));
+    }
+
+    return sc_buf_get_32(buf);
+}
+
+uint64_t sc_buf_chain_get_64(struct sc_buf_chain *chain)
+{
+    struct sc_buf *buf = sc_buf_chain_rd(chain, sizeof(uint64_t));
+
+    if (buf == NULL) {
+        return sc_buf_chain_get_le(chain, sizeof(uint64_t));
+    }
+
+    return sc_buf_get_64(buf);
+}
+
+double sc_buf_chain_get_double(struct sc_buf_chain *chain)
+{
+    double d;
+    uint64_t val;
+
+    val = sc_buf_chain_get_64(chain);
+    memcpy(&d, &val, 8);
+
+    return d;
+}
+
+const char *sc_buf_chain_get_str(struct sc_buf_chain *chain)
+{
+    uint32_t len;
+    const char *str;
+
+    len = sc_buf_chain_get_32(chain);
+    if (len == UINT32_MAX || chain->error != 0) {
+        return NULL;
+    }
+
+    str = sc_buf_chain_pullup(chain, len + sc_buf_8_len('\0'));
+    if (str == NULL) {
+        return NULL;
+    }
+
+    sc_buf_chain_read(chain, NULL, len + sc_buf_8_len('\0'));
+
+    return str;
+}
+
+void *sc_buf_chain_get_blob(struct sc_buf_chain *chain, uint32_t len)
+{
+    void *blob;
+
+    blob = sc_buf_chain_pullup(chain, len);
+    if (blob == NULL) {
+        return NULL;
+    }
+
+    sc_buf_chain_read(chain, NULL, len);
+
+    return blob;
+}
+
+#ifdef SC_BUF_HAVE_CRC32
+
+void sc_buf_crc_wbegin(struct sc_buf *buf, struct sc_buf_crc *crc)
+{
+    assert(buf->crc == NULL);
+
+    *crc = (struct sc_buf_crc){.crc = 0, .pos = buf->wpos, .read = false};
+    buf->crc = crc;
+}
+
+void sc_buf_crc_rbegin(struct sc_buf *buf, struct sc_buf_crc *crc)
+{
+    assert(buf->crc == NULL);
+
+    *crc = (struct sc_buf_crc){.crc = 0, .pos = buf->rpos, .read = true};
+    buf->crc = crc;
+}
+
+uint32_t sc_buf_crc_end(struct sc_buf *buf)
+{
+    struct sc_buf_crc *c = buf->crc;
+
+    assert(c != NULL);
+
+    sc_buf_crc_fold(buf);
+    buf->crc = NULL;
+
+    return c->crc;
+}
+
+void sc_buf_put_crc(struct sc_buf *buf)
+{
+    assert(buf->crc != NULL && !buf->crc->read);
+
+    sc_buf_put_32(buf, sc_buf_crc_end(buf));
+}
+
+bool sc_buf_get_crc(struct sc_buf *buf)
+{
+    uint32_t crc;
+
+    assert(buf->crc != NULL && buf->crc->read);
+
+    crc = sc_buf_crc_end(buf);
+    if (sc_buf_get_32(buf) != crc) {
+        buf->error |= SC_BUF_CORRUPT;
+    }
+
+    return buf->error == 0;
+}
+
+#endif
@@ -39,6 +39,10 @@
     #define sc_buf_free    free
 #endif
 
+#ifdef SC_BUF_HAVE_SCAN
+    #include "sc_scan.h"
+#endif
+
 
 #define SC_BUF_CORRUPT 1u
 #define SC_BUF_OOM     3u
@@ -47,8 +51,23 @@
 #define SC_BUF_DATA 16
 #define SC_BUF_READ (SC_BUF_REF | SC_BUF_DATA)
 
+// Default growth factor, capacity is multiplied by this on expansion.
+#ifndef SC_BUF_GROW_FACTOR
+    #define SC_BUF_GROW_FACTOR 2
+#endif
+
+// Default compaction threshold, percentage of capacity. See sc_buf_policy().
+#ifndef SC_BUF_COMPACT_PCT
+    #define SC_BUF_COMPACT_PCT 25
+#endif
+
+struct sc_buf_pool;
+struct sc_buf_crc;
+
 struct sc_buf
 {
+    struct sc_buf_pool *pool;
+    struct sc_buf_crc *crc;
     unsigned char *mem;
     uint32_t cap;
     uint32_t limit;
@@ -56,6 +75,9 @@ struct sc_buf
     uint32_t wpos;
 
     unsigned int error;
+    uint32_t hint;
+    uint8_t factor;
+    uint8_t compact;
     bool ref;
 };
 
@@ -69,7 +91,7 @@ struct sc_buf
 bool sc_buf_init(struct sc_buf *buf, uint32_t cap);
 
 /**
- * Destroy buffer
+ * Destroy buffer, if buffer is taken from a pool, memory goes back to the pool.
  *
  * @param buf buf
  */
@@ -89,6 +111,83 @@ void sc_buf_term(struct sc_buf *buf);
  */
 struct sc_buf sc_buf_wrap(void *data, uint32_t len, int flags);
 
+/**
+ * Buffer pool
+ *
+ * Hands out buffers of a fixed size and takes memory back on sc_buf_term().
+ * Each thread keeps a small cache of free buffers, so get/put are lock-free
+ * in the common case. Cache overflow goes to a global list shared by all
+ * threads. Pool is thread-safe.
+ *
+ * A thread caches buffers for up to SC_BUF_POOL_TLS pools, it uses the global
+ * list for other pools. Buffers in a thread's cache are not reused by other
+ * threads, call sc_buf_pool_flush() before a thread exits to move them to the
+ * global list. All memory is released on sc_buf_pool_term().
+ */
+
+#ifndef SC_BUF_POOL_CACHE
+    #define SC_BUF_POOL_CACHE 32
+#endif
+
+#ifndef SC_BUF_POOL_TLS
+    #define SC_BUF_POOL_TLS 4
+#endif
+
+struct sc_buf_pool_cache
+{
+    struct sc_buf_pool_cache *next;
+    uint32_t count;
+    void *mem[SC_BUF_POOL_CACHE];
+};
+
+struct sc_buf_pool
+{
+    uint64_t id;
+    uint64_t bytes;
+    uint64_t max;
+    uint32_t size;
+    uint32_t limit;
+    int lock;
+    void *free;
+    struct sc_buf_pool_cache *caches;
+};
+
+/**
+ * @param pool  pool
+ * @param size  buffer size, buffers returned with a different capacity (e.g
+ *              expanded) are freed instead of cached.
+ * @param limit limit of buffers handed out, see sc_buf_limit().
+ * @param max   max bytes kept in the pool for reuse, memory returned beyond
+ *              this is freed.
+ */
+void sc_buf_pool_init(struct sc_buf_pool *pool, uint32_t size, uint32_t limit,
+                      uint64_t max);
+
+/**
+ * Release cached memory. Buffers taken from the pool must be terminated before
+ * and the pool must not be used by any thread after this call.
+ *
+ * @param pool pool
+ */
+void sc_buf_pool_term(struct sc_buf_pool *pool);
+
+/**
+ * Initialize 'buf' with memory from the pool. sc_buf_term() gives memory back
+ * to the pool.
+ *
+ * @param pool pool
+ * @param buf  buf
+ * @return     'false' on out of memory.
+ */
+bool sc_buf_pool_get(struct sc_buf_pool *pool, struct sc_buf *buf);
+
+/**
+ * Move cached buffers of the calling thread to the global list.
+ *
+ * @param pool pool
+ */
+void sc_buf_pool_flush(struct sc_buf_pool *pool);
+
 /**
  * Set limit of the buffer, when buffer reaches limit, it will set buffer's
  * 'out of memory' flag. Default is UINT32_MAX.
@@ -98,6 +197,24 @@ struct sc_buf sc_buf_wrap(void *data, uint32_t len, int flags);
  */
 void sc_buf_limit(struct sc_buf *buf, uint32_t limit);
 
+/**
+ * Set growth and compaction policy of the buffer.
+ *
+ * On expansion, capacity becomes 'cap * factor' or the required size if it is
+ * larger, rounded up to 4096 bytes and clamped to the limit. 'factor' of '1'
+ * grows the buffer just enough for the request (linear page sized growth).
+ *
+ * Before expanding, unread data is moved to the beginning of the buffer only
+ * if it is at most 'compact' percent of the capacity. '100' compacts on every
+ * expansion, '0' compacts only if the buffer is empty or if growing would
+ * exceed the limit. Defaults are SC_BUF_GROW_FACTOR and SC_BUF_COMPACT_PCT.
+ *
+ * @param buf     buf
+ * @param factor  growth factor, between 1 and 16
+ * @param compact compaction threshold, between 0 and 100
+ */
+void sc_buf_policy(struct sc_buf *buf, uint32_t factor, uint32_t compact);
+
 /**
  * @param buf buf
  * @param pos pos
@@ -109,7 +226,10 @@ void *sc_buf_at(struct sc_buf *buf, uint32_t pos);
  * @param buf buf
  * @return    current capacity.
  */
-uint32_t sc_buf_cap(struct sc_buf *buf);
+static inline uint32_t sc_buf_cap(struct sc_buf *buf)
+{
+    return buf->cap;
+}
 
 /**
  * Reserve space
@@ -126,19 +246,28 @@ bool sc_buf_reserve(struct sc_buf *buf, uint32_t len);
  * @return    'true' if buffer is valid. Buffer becomes invalid on out of
  *            memory, on buffer overflow or on buffer underflow.
  */
-bool sc_buf_valid(struct sc_buf *buf);
+static inline bool sc_buf_valid(struct sc_buf *buf)
+{
+    return buf->error == 0;
+}
 
 /**
  * @param buf buf
  * @return    current remaining space to write
  */
-uint32_t sc_buf_quota(struct sc_buf *buf);
+static inline uint32_t sc_buf_quota(struct sc_buf *buf)
+{
+    return buf->cap - buf->wpos;
+}
 
 /**
  * @param buf buf
  * @return    current byte count in the buffer
  */
-uint32_t sc_buf_size(struct sc_buf *buf);
+static inline uint32_t sc_buf_size(struct sc_buf *buf)
+{
+    return buf->wpos - buf->rpos;
+}
 
 /**
  * Set read and write position to '0', clear error flag.
@@ -250,14 +379,120 @@ void sc_buf_set_32(struct sc_buf *buf, uint32_t val);
 void sc_buf_set_64(struct sc_buf *buf, uint64_t val);
 uint32_t sc_buf_set_data(struct sc_buf *buf, uint32_t pos, const void *src,
                          uint32_t len);
+// Internals, bounds checked little endian reads, return bytes read.
+static inline uint16_t sc_buf_peek_8_pos(struct sc_buf *buf, uint32_t pos,
+                                         uint8_t *val)
+{
+    if (pos + sizeof(*val) > buf->wpos) {
+        buf->error |= SC_BUF_CORRUPT;
+        *val = 0;
+        return 0;
+    }
+
+    *val = buf->mem[pos];
+
+    return sizeof(*val);
+}
+
+static inline uint16_t sc_buf_peek_16_pos(struct sc_buf *buf, uint32_t pos,
+                                          uint16_t *val)
+{
+    unsigned char *p;
+
+    if (pos + sizeof(*val) > buf->wpos) {
+        buf->error |= SC_BUF_CORRUPT;
+        *val = 0;
+        return 0;
+    }
+
+    p = &buf->mem[pos];
+
+    *val = (uint16_t) p[0] << 0 | (uint16_t) p[1] << 8;
+
+    return sizeof(*val);
+}
+
+static inline uint32_t sc_buf_peek_32_pos(struct sc_buf *buf, uint32_t pos,
+                                          uint32_t *val)
+{
+    unsigned char *p;
+
+    if (pos + sizeof(*val) > buf->wpos) {
+        buf->error |= SC_BUF_CORRUPT;
+        *val = 0;
+        return 0;
+    }
+
+    p = &buf->mem[pos];
+
+    *val = (uint32_t) p[0] << 0 | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 |
+           (uint32_t) p[3] << 24;
+
+    return sizeof(*val);
+}
+
+static inline uint32_t sc_buf_peek_64_pos(struct sc_buf *buf, uint32_t pos,
+                                          uint64_t *val)
+{
+    unsigned char *p;
+
+    if (pos + sizeof(*val) > buf->wpos) {
+        buf->error |= SC_BUF_CORRUPT;
+        *val = 0;
+        return 0;
+    }
+
+    p = &buf->mem[pos];
+
+    *val = (uint64_t) p[0] << 0 | (uint64_t) p[1] << 8 | (uint64_t) p[2] << 16 |
+           (uint64_t) p[3] << 24 | (uint64_t) p[4] << 32 |
+           (uint64_t) p[5] << 40 | (uint64_t) p[6] << 48 |
+           (uint64_t) p[7] << 56;
+
+    return sizeof(*val);
+}
+// Internals end
+
 /**
  * Get values from buffer, read position will be advanced.
  */
+static inline uint8_t sc_buf_get_8(struct sc_buf *buf)
+{
+    uint8_t val;
+
+    buf->rpos += sc_buf_peek_8_pos(buf, buf->rpos, &val);
+
+    return val;
+}
+
+static inline uint16_t sc_buf_get_16(struct sc_buf *buf)
+{
+    uint16_t val;
+
+    buf->rpos += sc_buf_peek_16_pos(buf, buf->rpos, &val);
+
+    return val;
+}
+
+static inline uint32_t sc_buf_get_32(struct sc_buf *buf)
+{
+    uint32_t val;
+
+    buf->rpos += sc_buf_peek_32_pos(buf, buf->rpos, &val);
+
+    return val;
+}
+
+static inline uint64_t sc_buf_get_64(struct sc_buf *buf)
+{
+    uint64_t val;
+
+    buf->rpos += sc_buf_peek_64_pos(buf, buf->rpos, &val);
+
+    return val;
+}
+
 bool sc_buf_get_bool(struct sc_buf *buf);
-uint8_t sc_buf_get_8(struct sc_buf *buf);
-uint16_t sc_buf_get_16(struct sc_buf *buf);
-uint32_t sc_buf_get_32(struct sc_buf *buf);
-uint64_t sc_buf_get_64(struct sc_buf *buf);
 double sc_buf_get_double(struct sc_buf *buf);
 
 /**
@@ -320,7 +555,9 @@ void sc_buf_put_str(struct sc_buf *buf, const char *str);
 void sc_buf_put_str_len(struct sc_buf *buf, const char *str, int len);
 
 /**
- * Put formatted string, passes arguments to vsnprintf
+ * Put formatted string. Common conversions (%d, %i, %u, %x, %s, %c, %f and
+ * %.Nf with l, ll, z length modifiers, no flags or width) are formatted in a
+ * single pass directly into the buffer, others are passed to vsnprintf.
  *
  * @param buf buffer
  * @param fmt fmt
@@ -367,6 +604,86 @@ void sc_buf_put_blob(struct sc_buf *buf, const void *ptr, uint32_t len);
  */
 void sc_buf_put_raw(struct sc_buf *buf, const void *ptr, uint32_t len);
 
+/**
+ * Put array of values, values are stored back to back in little endian
+ * format, same as 'count' calls to the matching put function, but buffer is
+ * reserved once and data is copied with a single memcpy() on little endian
+ * platforms. Array length is not stored, e.g. put it with sc_buf_put_32() or
+ * sc_buf_put_varint() before.
+ *
+ * @param buf   buffer
+ * @param vals  values
+ * @param count value count
+ */
+void sc_buf_put_array_32(struct sc_buf *buf, const uint32_t *vals,
+                         uint32_t count);
+void sc_buf_put_array_64(struct sc_buf *buf, const uint64_t *vals,
+                         uint32_t count);
+void sc_buf_put_array_double(struct sc_buf *buf, const double *vals,
+                             uint32_t count);
+
+/**
+ * Get array of values written by sc_buf_put_array_*(). If buffer does not
+ * have 'count' values, error flags will be set and 'vals' will be zeroed.
+ *
+ * @param buf   buffer
+ * @param vals  destination
+ * @param count value count
+ */
+void sc_buf_get_array_32(struct sc_buf *buf, uint32_t *vals, uint32_t count);
+void sc_buf_get_array_64(struct sc_buf *buf, uint64_t *vals, uint32_t count);
+void sc_buf_get_array_double(struct sc_buf *buf, double *vals, uint32_t count);
+
+/**
+ * Varint functions, integers are stored as LEB128, 7 bits per byte, least
+ * significant group first. Values less than 128 take 1 byte, UINT64_MAX takes
+ * 10 bytes. Signed values are zigzag encoded first, so small negative values
+ * are short as well. Get functions set error flags on truncated or malformed
+ * input and return '0'.
+ */
+void sc_buf_put_varint(struct sc_buf *buf, uint64_t val);
+void sc_buf_put_svarint(struct sc_buf *buf, int64_t val);
+uint64_t sc_buf_get_varint(struct sc_buf *buf);
+int64_t sc_buf_get_svarint(struct sc_buf *buf);
+
+/**
+ * Write string with varint length prefix. Strings are stored as
+ * [varint (length + 1)][string bytes]['\0']. NULL values are accepted, stored
+ * as [varint 0], a single byte.
+ *
+ * @param buf buffer
+ * @param str string
+ */
+void sc_buf_put_vstr(struct sc_buf *buf, const char *str);
+
+/**
+ * Read string written by sc_buf_put_vstr(), returned pointer is valid until
+ * buffer is altered.
+ *
+ * @param buf buffer
+ * @return    string, NULL if stored value is NULL or on error.
+ */
+const char *sc_buf_get_vstr(struct sc_buf *buf);
+
+/**
+ * Put binary data, it will store len as varint first, then binary data.
+ *
+ * @param buf buffer
+ * @param ptr data
+ * @param len data len
+ */
+void sc_buf_put_vblob(struct sc_buf *buf, const void *ptr, uint32_t len);
+
+/**
+ * Get binary data written by sc_buf_put_vblob(), returned pointer is valid
+ * until buffer is altered.
+ *
+ * @param buf buffer
+ * @param len out, data len
+ * @return    pointer to data, NULL if 'len' is zero or on error.
+ */
+void *sc_buf_get_vblob(struct sc_buf *buf, uint32_t *len);
+
 /**
  *  Get encoded length of the variables.
  */
@@ -401,4 +718,569 @@ static inline uint32_t sc_buf_str_len(const char *str)
     return bytes + (uint32_t) strlen(str);
 }
 
+static inline uint64_t sc_buf_zigzag(int64_t val)
+{
+    return ((uint64_t) val << 1u) ^ (0 - ((uint64_t) val >> 63u));
+}
+
+static inline int64_t sc_buf_unzigzag(uint64_t val)
+{
+    return (int64_t) ((val >> 1u) ^ (0 - (val & 1u)));
+}
+
+static inline uint32_t sc_buf_varint_len(uint64_t val)
+{
+    uint32_t len = 1;
+
+    while (val >= 0x80) {
+        val >>= 7u;
+        len++;
+    }
+
+    return len;
+}
+
+static inline uint32_t sc_buf_svarint_len(int64_t val)
+{
+    return sc_buf_varint_len(sc_buf_zigzag(val));
+}
+
+static inline uint32_t sc_buf_vblob_len(void *ptr, uint32_t len)
+{
+    (void) ptr;
+    assert(len <= UINT32_MAX - 5);
+
+    return len + sc_buf_varint_len(len);
+}
+
+static inline uint32_t sc_buf_vstr_len(const char *str)
+{
+    size_t len;
+
+    if (str == NULL) {
+        return sc_buf_varint_len(0);
+    }
+
+    len = strlen(str);
+    assert(len <= UINT32_MAX - 7);
+
+    return sc_buf_varint_len(len + 1) + (uint32_t) len + sc_buf_8_len('\0');
+}
+
+/**
+ * Cursor API, reserve once and write/read many fields without checks.
+ *
+ * e.g
+ *
+ * struct sc_buf_cursor c;
+ *
+ * if (sc_buf_wcursor(&buf, &c, 4 + 8 + 1)) {
+ *     sc_buf_cursor_put_32(&c, id);
+ *     sc_buf_cursor_put_64(&c, offset);
+ *     sc_buf_cursor_put_8(&c, flags);
+ *     sc_buf_wcommit(&buf, &c);
+ * }
+ *
+ * Cursor functions are inline and do not check bounds or error flags, bounds
+ * are only asserted in debug builds. Cursor is invalid after any other
+ * operation on the buffer. Encoding is the same as put/get functions.
+ */
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || \
+    defined(_WIN32)
+    #define SC_BUF_LITTLE_ENDIAN
+#endif
+
+struct sc_buf_cursor
+{
+    unsigned char *pos;
+    unsigned char *end;
+};
+
+/**
+ * Reserve 'len' bytes and initialize write cursor.
+ *
+ * @param buf buf
+ * @param c   cursor
+ * @param len max bytes that will be written with the cursor
+ * @return    'false' on out of memory or if buffer is invalid.
+ */
+bool sc_buf_wcursor(struct sc_buf *buf, struct sc_buf_cursor *c, uint32_t len);
+
+/**
+ * Mark bytes written with cursor as written.
+ *
+ * @param buf buf
+ * @param c   cursor
+ */
+void sc_buf_wcommit(struct sc_buf *buf, struct sc_buf_cursor *c);
+
+/**
+ * Initialize read cursor, buffer must have 'len' bytes to read. Otherwise,
+ * error flag will be set.
+ *
+ * @param buf buf
+ * @param c   cursor
+ * @param len max bytes that will be read with the cursor
+ * @return    'false' if buffer has less than 'len' bytes or if it is invalid.
+ */
+bool sc_buf_rcursor(struct sc_buf *buf, struct sc_buf_cursor *c, uint32_t len);
+
+/**
+ * Mark bytes read with cursor as read.
+ *
+ * @param buf buf
+ * @param c   cursor
+ */
+void sc_buf_rcommit(struct sc_buf *buf, struct sc_buf_cursor *c);
+
+static inline void sc_buf_cursor_put_8(struct sc_buf_cursor *c, uint8_t val)
+{
+    assert(c->pos + sizeof(val) <= c->end);
+    *c->pos++ = val;
+}
+
+static inline void sc_buf_cursor_put_16(struct sc_buf_cursor *c, uint16_t val)
+{
+    assert(c->pos + sizeof(val) <= c->end);
+#ifdef SC_BUF_LITTLE_ENDIAN
+    memcpy(c->pos, &val, sizeof(val));
+#else
+    c->pos[0] = (unsigned char) (val >> 0);
+    c->pos[1] = (unsigned char) (val >> 8);
+#endif
+    c->pos += sizeof(val);
+}
+
+static inline void sc_buf_cursor_put_32(struct sc_buf_cursor *c, uint32_t val)
+{
+    assert(c->pos + sizeof(val) <= c->end);
+#ifdef SC_BUF_LITTLE_ENDIAN
+    memcpy(c->pos, &val, sizeof(val));
+#else
+    for (int i = 0; i < 4; i++) {
+        c->pos[i] = (unsigned char) (val >> (i * 8));
+    }
+#endif
+    c->pos += sizeof(val);
+}
+
+static inline void sc_buf_cursor_put_64(struct sc_buf_cursor *c, uint64_t val)
+{
+    assert(c->pos + sizeof(val) <= c->end);
+#ifdef SC_BUF_LITTLE_ENDIAN
+    memcpy(c->pos, &val, sizeof(val));
+#else
+    for (int i = 0; i < 8; i++) {
+        c->pos[i] = (unsigned char) (val >> (i * 8));
+    }
+#endif
+    c->pos += sizeof(val);
+}
+
+static inline void sc_buf_cursor_put_bool(struct sc_buf_cursor *c, bool val)
+{
+    sc_buf_cursor_put_8(c, (uint8_t) val);
+}
+
+static inline void sc_buf_cursor_put_double(struct sc_buf_cursor *c, double val)
+{
+    uint64_t sw;
+
+    memcpy(&sw, &val, sizeof(sw));
+    sc_buf_cursor_put_64(c, sw);
+}
+
+static inline void sc_buf_cursor_put_raw(struct sc_buf_cursor *c,
+                                         const void *ptr, uint32_t len)
+{
+    assert(c->pos + len <= c->end);
+    memcpy(c->pos, ptr, len);
+    c->pos += len;
+}
+
+static inline uint8_t sc_buf_cursor_get_8(struct sc_buf_cursor *c)
+{
+    assert(c->pos + sizeof(uint8_t) <= c->end);
+    return *c->pos++;
+}
+
+static inline uint16_t sc_buf_cursor_get_16(struct sc_buf_cursor *c)
+{
+    uint16_t val;
+
+    assert(c->pos + sizeof(val) <= c->end);
+#ifdef SC_BUF_LITTLE_ENDIAN
+    memcpy(&val, c->pos, sizeof(val));
+#else
+    val = (uint16_t) (c->pos[0] | c->pos[1] << 8);
+#endif
+    c->pos += sizeof(val);
+
+    return val;
+}
+
+static inline uint32_t sc_buf_cursor_get_32(struct sc_buf_cursor *c)
+{
+    uint32_t val = 0;
+
+    assert(c->pos + sizeof(val) <= c->end);
+#ifdef SC_BUF_LITTLE_ENDIAN
+    memcpy(&val, c->pos, sizeof(val));
+#else
+    for (int i = 0; i < 4; i++) {
+        val |= (uint32_t) c->pos[i] << (i * 8);
+    }
+#endif
+    c->pos += sizeof(val);
+
+    return val;
+}
+
+static inline uint64_t sc_buf_cursor_get_64(struct sc_buf_cursor *c)
+{
+    uint64_t val = 0;
+
+    assert(c->pos + sizeof(val) <= c->end);
+#ifdef SC_BUF_LITTLE_ENDIAN
+    memcpy(&val, c->pos, sizeof(val));
+#else
+    for (int i = 0; i < 8; i++) {
+        val |= (uint64_t) c->pos[i] << (i * 8);
+    }
+#endif
+    c->pos += sizeof(val);
+
+    return val;
+}
+
+static inline bool sc_buf_cursor_get_bool(struct sc_buf_cursor *c)
+{
+    return sc_buf_cursor_get_8(c) != 0;
+}
+
+static inline double sc_buf_cursor_get_double(struct sc_buf_cursor *c)
+{
+    double d;
+    uint64_t val = sc_buf_cursor_get_64(c);
+
+    memcpy(&d, &val, sizeof(d));
+
+    return d;
+}
+
+static inline void sc_buf_cursor_get_data(struct sc_buf_cursor *c, void *dest,
+                                          uint32_t len)
+{
+    assert(c->pos + len <= c->end);
+    memcpy(dest, c->pos, len);
+    c->pos += len;
+}
+
+/**
+ * Chained buffer
+ *
+ * A chain of fixed size segments taken from a segment pool. Writes append to
+ * the last segment, a new segment is linked when it is full, so growing never
+ * reallocates or copies existing data. Memory blocks of segments are
+ * reference counted, sc_buf_chain_split() moves a prefix of a chain into
+ * another chain by sharing blocks, e.g. a frame can be handed to a handler
+ * right after recv() without a copy.
+ *
+ * Encoding is the same as 'struct sc_buf', little endian integers, length
+ * prefixed and null terminated strings.
+ *
+ * Chains and pools are not thread-safe, chains sharing blocks must be used by
+ * the same thread.
+ */
+
+#ifndef SC_BUF_SEG_SIZE
+    #define SC_BUF_SEG_SIZE 16384
+#endif
+
+struct sc_buf_seg
+{
+    struct sc_buf_seg *next;
+    struct sc_buf_block *block;
+    struct sc_buf buf;
+};
+
+// Each block embeds the segment which is linked when block is allocated.
+// Extra segments are allocated only for shared blocks.
+struct sc_buf_block
+{
+    struct sc_buf_block *next;
+    uint32_t refs;
+    uint32_t cap;
+    struct sc_buf_seg seg;
+    unsigned char data[];
+};
+
+struct sc_buf_seg_pool
+{
+    struct sc_buf_block *blocks;
+    uint32_t seg_size;
+    uint32_t count;
+    uint32_t max;
+};
+
+struct sc_buf_chain
+{
+    struct sc_buf_seg_pool *pool;
+    struct sc_buf_seg *head;
+    struct sc_buf_seg *tail;
+    uint32_t size;
+    unsigned int error;
+};
+
+/**
+ * Init segment pool, up to 'max' released blocks are cached in the pool.
+ *
+ * @param pool     pool
+ * @param seg_size segment size, e.g. SC_BUF_SEG_SIZE
+ * @param max      max cached block count
+ */
+void sc_buf_seg_pool_init(struct sc_buf_seg_pool *pool, uint32_t seg_size,
+                          uint32_t max);
+
+/**
+ * Release cached memory, chains using the pool must be terminated before.
+ *
+ * @param pool pool
+ */
+void sc_buf_seg_pool_term(struct sc_buf_seg_pool *pool);
+
+/**
+ * @param chain chain
+ * @param pool  segment pool
+ */
+void sc_buf_chain_init(struct sc_buf_chain *chain,
+                       struct sc_buf_seg_pool *pool);
+
+/**
+ * Release segments, blocks go back to the pool if they are not shared.
+ *
+ * @param chain chain
+ */
+void sc_buf_chain_term(struct sc_buf_chain *chain);
+
+/**
+ * @param chain chain
+ * @return      'true' if chain is valid. Chain becomes invalid on out of
+ *              memory or on buffer underflow.
+ */
+bool sc_buf_chain_valid(struct sc_buf_chain *chain);
+
+/**
+ * @param chain chain
+ * @return      unread byte count in the chain
+ */
+uint32_t sc_buf_chain_size(struct sc_buf_chain *chain);
+
+/**
+ * Release all segments and clear error flags.
+ *
+ * @param chain chain
+ */
+void sc_buf_chain_clear(struct sc_buf_chain *chain);
+
+/**
+ * Make sure the last segment has 'len' bytes of contiguous space, links a
+ * new segment otherwise. If 'len' is larger than segment size, a dedicated
+ * block is allocated.
+ *
+ * @param chain chain
+ * @param len   len
+ * @return      'false' on out of memory, 'out of memory' flag will be set.
+ */
+bool sc_buf_chain_reserve(struct sc_buf_chain *chain, uint32_t len);
+
+/**
+ * @param chain chain
+ * @return      contiguous free space in the last segment.
+ */
+uint32_t sc_buf_chain_quota(struct sc_buf_chain *chain);
+
+/**
+ * @param chain chain
+ * @return      write address in the last segment, valid if quota is not zero.
+ */
+void *sc_buf_chain_wbuf(struct sc_buf_chain *chain);
+
+/**
+ * Mark 'len' bytes written into sc_buf_chain_wbuf(), e.g. after recv().
+ *
+ * @param chain chain
+ * @param len   len, must be less than or equal to sc_buf_chain_quota().
+ */
+void sc_buf_chain_mark_write(struct sc_buf_chain *chain, uint32_t len);
+
+/**
+ * Consume 'len' bytes, segments are released as they are fully read.
+ *
+ * @param chain chain
+ * @param len   len, must be less than or equal to sc_buf_chain_size().
+ */
+void sc_buf_chain_mark_read(struct sc_buf_chain *chain, uint32_t len);
+
+/**
+ * Make first 'len' unread bytes contiguous. Data is moved only if it spans
+ * multiple segments.
+ *
+ * @param chain chain
+ * @param len   len
+ * @return      pointer to the first unread byte, NULL on underflow or out of
+ *              memory. Valid until the next operation on the chain.
+ */
+void *sc_buf_chain_pullup(struct sc_buf_chain *chain, uint32_t len);
+
+/**
+ * Move first 'len' unread bytes of 'src' to the end of 'dest' without copying
+ * data. A segment on the boundary is shared by both chains.
+ *
+ * @param src  src
+ * @param dest dest
+ * @param len  len
+ * @return     'false' on underflow or out of memory, error flag is set on
+ *             'src'.
+ */
+bool sc_buf_chain_split(struct sc_buf_chain *src, struct sc_buf_chain *dest,
+                        uint32_t len);
+
+/**
+ * Same as sc_buf_put_* and sc_buf_get_* functions. Pointers returned by
+ * sc_buf_chain_get_str() and sc_buf_chain_get_blob() are valid until the next
+ * operation on the chain.
+ */
+void sc_buf_chain_put_raw(struct sc_buf_chain *chain, const void *ptr,
+                          uint32_t len);
+void sc_buf_chain_put_bool(struct sc_buf_chain *chain, bool val);
+void sc_buf_chain_put_8(struct sc_buf_chain *chain, uint8_t val);
+void sc_buf_chain_put_16(struct sc_buf_chain *chain, uint16_t val);
+void sc_buf_chain_put_32(struct sc_buf_chain *chain, uint32_t val);
+void sc_buf_chain_put_64(struct sc_buf_chain *chain, uint64_t val);
+void sc_buf_chain_put_double(struct sc_buf_chain *chain, double val);
+void sc_buf_chain_put_str(struct sc_buf_chain *chain, const char *str);
+void sc_buf_chain_put_blob(struct sc_buf_chain *chain, const void *ptr,
+                           uint32_t len);
+
+void sc_buf_chain_get_data(struct sc_buf_chain *chain, void *dest,
+                           uint32_t len);
+bool sc_buf_chain_get_bool(struct sc_buf_chain *chain);
+uint8_t sc_buf_chain_get_8(struct sc_buf_chain *chain);
+uint16_t sc_buf_chain_get_16(struct sc_buf_chain *chain);
+uint32_t sc_buf_chain_get_32(struct sc_buf_chain *chain);
+uint64_t sc_buf_chain_get_64(struct sc_buf_chain *chain);
+double sc_buf_chain_get_double(struct sc_buf_chain *chain);
+const char *sc_buf_chain_get_str(struct sc_buf_chain *chain);
+void *sc_buf_chain_get_blob(struct sc_buf_chain *chain, uint32_t len);
+
+#ifdef SC_BUF_HAVE_SCAN
+
+/**
+ * Find the first byte of 'set' in the readable data, requires SC_BUF_HAVE_SCAN
+ * and sc_scan. Read position doesn't change, e.g. to find the end of a line or
+ * a delimiter of a text protocol :
+ *
+ * sc_scan_set_init(&set, "\n", 1);
+ *
+ * n = sc_buf_find(&buf, 0, &set);
+ * if (n < sc_buf_size(&buf)) {
+ *     line = sc_buf_get_blob(&buf, n + 1);
+ * }
+ *
+ * @param buf buf
+ * @param off offset from the read position to start from, e.g. size of the
+ *            data searched before more data arrived.
+ * @param set set
+ * @return    offset from the read position, sc_buf_size() if there is no
+ *            match or if buffer has an error.
+ */
+uint32_t sc_buf_find(struct sc_buf *buf, uint32_t off,
+                     const struct sc_scan_set *set);
+
+#endif
+
+/**
+ * CRC32C checksummed frames, requires SC_BUF_HAVE_CRC32 and sc_crc32.
+ *
+ * A checksum context is attached to the buffer, bytes are folded into the
+ * checksum while they are still in cache: bulk put/get (raw, blob, data) are
+ * copied and checksummed chunk by chunk in a single pass, small fields are
+ * folded before the buffer moves data and at the end of the frame.
+ *
+ * struct sc_buf_crc crc;
+ *
+ * sc_buf_crc_wbegin(&buf, &crc);
+ * sc_buf_put_32(&buf, 1);
+ * sc_buf_put_raw(&buf, payload, payload_len);
+ * sc_buf_put_crc(&buf);   // Appends CRC32C of the frame.
+ *
+ * sc_buf_crc_rbegin(&buf, &crc);
+ * val = sc_buf_get_32(&buf);
+ * sc_buf_get_data(&buf, payload, payload_len);
+ * if (!sc_buf_get_crc(&buf)) {
+ *     // Checksum mismatch, buffer error flag is set.
+ * }
+ *
+ * sc_crc32_init() must be called once before. Only one context can be
+ * attached to a buffer. Position setters, sc_buf_clear() and sc_buf_put_text()
+ * must not be used while a context is attached.
+ */
+#ifdef SC_BUF_HAVE_CRC32
+
+#ifndef SC_BUF_CRC_CHUNK
+    #define SC_BUF_CRC_CHUNK 4096
+#endif
+
+struct sc_buf_crc
+{
+    uint32_t crc;
+    uint32_t pos;
+    bool read;
+};
+
+/**
+ * Attach checksum context, bytes written after this call are checksummed.
+ *
+ * @param buf buf
+ * @param crc crc context, must stay valid until it is detached.
+ */
+void sc_buf_crc_wbegin(struct sc_buf *buf, struct sc_buf_crc *crc);
+
+/**
+ * Attach checksum context, bytes read after this call are checksummed.
+ *
+ * @param buf buf
+ * @param crc crc context, must stay valid until it is detached.
+ */
+void sc_buf_crc_rbegin(struct sc_buf *buf, struct sc_buf_crc *crc);
+
+/**
+ * Detach checksum context.
+ *
+ * @param buf buf
+ * @return    CRC32C of the bytes written/read since begin.
+ */
+uint32_t sc_buf_crc_end(struct sc_buf *buf);
+
+/**
+ * Detach checksum context and put checksum as 32 bit integer. Checksum does
+ * not cover itself.
+ *
+ * @param buf buf
+ */
+void sc_buf_put_crc(struct sc_buf *buf);
+
+/**
+ * Detach checksum context, get checksum and compare. On mismatch, error flag
+ * is set to SC_BUF_CORRUPT.
+ *
+ * @param buf buf
+ * @return    'true' if checksum matches and buffer has no error.
+ */
+bool sc_buf_get_crc(struct sc_buf *buf);
+
+#endif
+
 #endif
@@ -0,0 +1,25 @@
+#include "sc_cmap.h"
+
+#include <stdio.h>
+
+int main()
+{
+    const char *value;
+    struct sc_cmap_str map;
+
+    sc_cmap_init_str(&map, 0, 0, 0);
+
+    sc_cmap_put_str(&map, "jack", "chicago");
+    sc_cmap_put_str(&map, "jane", "new york");
+
+    if (sc_cmap_get_str(&map, "jack", &value)) {
+        printf("Key:[jack], Value:[%s] \n", value);
+    }
+
+    sc_cmap_del_str(&map, "jane", NULL);
+    printf("Size: %u \n", sc_cmap_size_str(&map));
+
+    sc_cmap_term_str(&map);
+
+    return 0;
+}
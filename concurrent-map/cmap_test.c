@@ -0,0 +1,261 @@
+#include "sc_cmap.h"
+#include "sc_thread.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define THREADS 4
+#define ITEMS   20000
+
+void test_32()
+{
+    uint32_t val;
+    struct sc_cmap_32 map;
+
+    assert(!sc_cmap_init_32(&map, 0, 0, 24));
+    assert(!sc_cmap_init_32(&map, UINT32_MAX, 0, 0));
+
+    assert(sc_cmap_init_32(&map, 3, 0, 0));
+    assert(map.mask == 3);
+    sc_cmap_term_32(&map);
+    sc_cmap_term_32(&map);
+
+    assert(sc_cmap_init_32(&map, 0, 100, 0));
+    assert(map.mask == 63);
+    assert(sc_cmap_size_32(&map) == 0);
+    assert(!sc_cmap_get_32(&map, 0, &val));
+    assert(!sc_cmap_del_32(&map, 0, NULL));
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        assert(sc_cmap_put_32(&map, i, i * 2));
+    }
+    assert(sc_cmap_size_32(&map) == 1000);
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        assert(sc_cmap_get_32(&map, i, &val));
+        assert(val == i * 2);
+    }
+
+    assert(sc_cmap_put_32(&map, 5, 100));
+    assert(sc_cmap_get_32(&map, 5, &val));
+    assert(val == 100);
+    assert(sc_cmap_size_32(&map) == 1000);
+
+    for (uint32_t i = 0; i < 500; i++) {
+        assert(sc_cmap_del_32(&map, i, &val));
+        assert(i == 5 ? val == 100 : val == i * 2);
+        assert(!sc_cmap_del_32(&map, i, NULL));
+    }
+    assert(sc_cmap_size_32(&map) == 500);
+
+    sc_cmap_clear_32(&map);
+    assert(sc_cmap_size_32(&map) == 0);
+    assert(!sc_cmap_get_32(&map, 700, &val));
+
+    sc_cmap_term_32(&map);
+}
+
+void test_str()
+{
+    char buf[32];
+    const char *val;
+    struct sc_cmap_str map;
+
+    assert(sc_cmap_init_str(&map, 8, 0, 0));
+
+    assert(sc_cmap_put_str(&map, NULL, "null"));
+    assert(sc_cmap_get_str(&map, NULL, &val));
+    assert(strcmp(val, "null") == 0);
+
+    assert(sc_cmap_put_str(&map, "jack", "chicago"));
+    assert(sc_cmap_put_str(&map, "jane", "new york"));
+    assert(sc_cmap_size_str(&map) == 3);
+
+    assert(sc_cmap_get_str(&map, "jack", &val));
+    assert(strcmp(val, "chicago") == 0);
+
+    snprintf(buf, sizeof(buf), "%s", "jane");
+    assert(sc_cmap_del_str(&map, buf, &val));
+    assert(strcmp(val, "new york") == 0);
+    assert(!sc_cmap_get_str(&map, "jane", &val));
+
+    assert(sc_cmap_del_str(&map, NULL, NULL));
+    assert(sc_cmap_size_str(&map) == 1);
+
+    sc_cmap_term_str(&map);
+}
+
+void test_types()
+{
+    uint64_t u64;
+    void *v;
+    const char *s;
+    struct sc_cmap_64 m64;
+    struct sc_cmap_64v m64v;
+    struct sc_cmap_64s m64s;
+    struct sc_cmap_sv msv;
+    struct sc_cmap_s64 ms64;
+
+    assert(sc_cmap_init_64(&m64, 0, 0, 0));
+    assert(sc_cmap_init_64v(&m64v, 0, 0, 0));
+    assert(sc_cmap_init_64s(&m64s, 0, 0, 0));
+    assert(sc_cmap_init_sv(&msv, 0, 0, 0));
+    assert(sc_cmap_init_s64(&ms64, 0, 0, 0));
+
+    for (uint64_t i = 0; i < 100; i++) {
+        assert(sc_cmap_put_64(&m64, i << 32, i));
+        assert(sc_cmap_put_64v(&m64v, i, &m64v));
+        assert(sc_cmap_put_64s(&m64s, i, "value"));
+    }
+    assert(sc_cmap_put_sv(&msv, "key", &msv));
+    assert(sc_cmap_put_s64(&ms64, "key", 64));
+
+    for (uint64_t i = 0; i < 100; i++) {
+        assert(sc_cmap_get_64(&m64, i << 32, &u64) && u64 == i);
+        assert(sc_cmap_get_64v(&m64v, i, &v) && v == &m64v);
+        assert(sc_cmap_get_64s(&m64s, i, &s) && strcmp(s, "value") == 0);
+    }
+    assert(sc_cmap_get_sv(&msv, "key", &v) && v == &msv);
+    assert(sc_cmap_get_s64(&ms64, "key", &u64) && u64 == 64);
+
+    assert(sc_cmap_size_64(&m64) == 100);
+    assert(sc_cmap_del_64v(&m64v, 10, NULL));
+    assert(sc_cmap_size_64v(&m64v) == 99);
+    sc_cmap_clear_64s(&m64s);
+    assert(sc_cmap_size_64s(&m64s) == 0);
+    assert(sc_cmap_del_sv(&msv, "key", NULL));
+    assert(!sc_cmap_del_s64(&ms64, "none", NULL));
+
+    sc_cmap_term_64(&m64);
+    sc_cmap_term_64v(&m64v);
+    sc_cmap_term_64s(&m64s);
+    sc_cmap_term_sv(&msv);
+    sc_cmap_term_s64(&ms64);
+}
+
+struct sc_cmap_64 shared;
+
+void *writer(void *arg)
+{
+    uint64_t val, id = (uint64_t) (uintptr_t) arg;
+
+    for (uint64_t i = 0; i < ITEMS; i++) {
+        uint64_t key = (i * THREADS) + id + 1;
+
+        assert(sc_cmap_put_64(&shared, key, key * 3));
+        assert(sc_cmap_get_64(&shared, key, &val));
+        assert(val == key * 3);
+
+        if (i % 4 == 0) {
+            assert(sc_cmap_del_64(&shared, key, &val));
+            assert(val == key * 3);
+        }
+    }
+
+    return NULL;
+}
+
+void *reader(void *arg)
+{
+    uint64_t val;
+
+    (void) arg;
+
+    for (uint64_t i = 0; i < ITEMS; i++) {
+        /* Values are written once, so any found value must be consistent */
+        if (sc_cmap_get_64(&shared, i + 1, &val)) {
+            assert(val == (i + 1) * 3);
+        }
+    }
+
+    return NULL;
+}
+
+void test_threads()
+{
+    uint64_t val;
+    struct sc_thread threads[THREADS * 2];
+
+    assert(sc_cmap_init_64(&shared, 16, 0, 0));
+
+    for (uintptr_t i = 0; i < THREADS; i++) {
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], writer, (void *) i) == 0);
+        sc_thread_init(&threads[THREADS + i]);
+        assert(sc_thread_start(&threads[THREADS + i], reader, NULL) == 0);
+    }
+
+    for (int i = 0; i < THREADS * 2; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    assert(sc_cmap_size_64(&shared) == THREADS * ITEMS * 3 / 4);
+
+    for (uint64_t key = 1; key <= THREADS * ITEMS; key++) {
+        bool deleted = (((key - 1) / THREADS) % 4) == 0;
+
+        assert(sc_cmap_get_64(&shared, key, &val) == !deleted);
+    }
+
+    sc_cmap_term_64(&shared);
+}
+
+#ifdef SC_HAVE_WRAP
+
+int fail_calloc = -1;
+void *__real_calloc(size_t n, size_t size);
+void *__wrap_calloc(size_t n, size_t size)
+{
+    if (fail_calloc == 0) {
+        return NULL;
+    }
+
+    if (fail_calloc > 0) {
+        fail_calloc--;
+    }
+
+    return __real_calloc(n, size);
+}
+
+void fail_test()
+{
+    struct sc_cmap_32 map;
+
+    fail_calloc = 0;
+    assert(!sc_cmap_init_32(&map, 4, 1000, 0));
+
+    /* Shard array and the first two shards succeed */
+    fail_calloc = 3;
+    assert(!sc_cmap_init_32(&map, 4, 1000, 0));
+    assert(map.shards == NULL);
+
+    fail_calloc = -1;
+    assert(sc_cmap_init_32(&map, 4, 0, 0));
+
+    fail_calloc = 0;
+    assert(!sc_cmap_put_32(&map, 1, 1));
+    fail_calloc = -1;
+    assert(sc_cmap_put_32(&map, 1, 1));
+
+    sc_cmap_term_32(&map);
+}
+
+#else
+
+void fail_test()
+{
+}
+
+#endif
+
+int main()
+{
+    test_32();
+    test_str();
+    test_types();
+    test_threads();
+    fail_test();
+
+    return 0;
+}
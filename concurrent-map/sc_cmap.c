@@ -0,0 +1,274 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _XOPEN_SOURCE
+    #define _XOPEN_SOURCE 700
+#endif
+
+#include "sc_cmap.h"
+
+#ifndef SC_CMAP_SHARDS
+    #define SC_CMAP_SHARDS 64
+#endif
+
+#define SC_CMAP_SHARDS_MAX (1u << 16)
+#define SC_CMAP_CACHE_LINE 64
+
+#if defined(_WIN32) || defined(_WIN64)
+
+#include <windows.h>
+
+struct sc_cmap_lock
+{
+    SRWLOCK rw;
+};
+
+static int sc_cmap_lock_init(struct sc_cmap_lock *l)
+{
+    InitializeSRWLock(&l->rw);
+    return 0;
+}
+
+static void sc_cmap_lock_term(struct sc_cmap_lock *l)
+{
+    (void) l;
+}
+
+static void sc_cmap_lock_read(struct sc_cmap_lock *l)
+{
+    AcquireSRWLockShared(&l->rw);
+}
+
+static void sc_cmap_unlock_read(struct sc_cmap_lock *l)
+{
+    ReleaseSRWLockShared(&l->rw);
+}
+
+static void sc_cmap_lock_write(struct sc_cmap_lock *l)
+{
+    AcquireSRWLockExclusive(&l->rw);
+}
+
+static void sc_cmap_unlock_write(struct sc_cmap_lock *l)
+{
+    ReleaseSRWLockExclusive(&l->rw);
+}
+
+#else
+
+#include <pthread.h>
+
+struct sc_cmap_lock
+{
+    pthread_rwlock_t rw;
+};
+
+static int sc_cmap_lock_init(struct sc_cmap_lock *l)
+{
+    return pthread_rwlock_init(&l->rw, NULL);
+}
+
+static void sc_cmap_lock_term(struct sc_cmap_lock *l)
+{
+    pthread_rwlock_destroy(&l->rw);
+}
+
+static void sc_cmap_lock_read(struct sc_cmap_lock *l)
+{
+    pthread_rwlock_rdlock(&l->rw);
+}
+
+static void sc_cmap_unlock_read(struct sc_cmap_lock *l)
+{
+    pthread_rwlock_unlock(&l->rw);
+}
+
+static void sc_cmap_lock_write(struct sc_cmap_lock *l)
+{
+    pthread_rwlock_wrlock(&l->rw);
+}
+
+static void sc_cmap_unlock_write(struct sc_cmap_lock *l)
+{
+    pthread_rwlock_unlock(&l->rw);
+}
+
+#endif
+
+#define sc_cmap_impl_of(name, K, V, hash_fn)                                   \
+                                                                               \
+    struct sc_cmap_shard_##name                                                \
+    {                                                                          \
+        struct sc_cmap_lock lock;                                              \
+        struct sc_map_##name map;                                              \
+        char pad[SC_CMAP_CACHE_LINE];                                          \
+    };                                                                         \
+                                                                               \
+    /* Upper hash bits, lower ones pick the bucket inside the shard */         \
+    static struct sc_cmap_shard_##name *sc_cmap_shard_##name(                  \
+            struct sc_cmap_##name *m, K key)                                   \
+    {                                                                          \
+        if (key == 0) {                                                        \
+            return &m->shards[0];                                              \
+        }                                                                      \
+                                                                               \
+        return &m->shards[(hash_fn(key) >> 16) & m->mask];                     \
+    }                                                                          \
+                                                                               \
+    bool sc_cmap_init_##name(struct sc_cmap_##name *m, uint32_t shards,        \
+                             uint32_t cap, uint32_t load_factor)               \
+    {                                                                          \
+        uint32_t i, n = 1;                                                     \
+                                                                               \
+        shards = shards == 0 ? SC_CMAP_SHARDS : shards;                        \
+        if (shards > SC_CMAP_SHARDS_MAX) {                                     \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        while (n < shards) {                                                   \
+            n *= 2;                                                            \
+        }                                                                      \
+                                                                               \
+        m->shards = sc_cmap_calloc(n, sizeof(*m->shards));                     \
+        if (m->shards == NULL) {                                               \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        for (i = 0; i < n; i++) {                                              \
+            if (!sc_map_init_##name(&m->shards[i].map, cap / n, load_factor)) { \
+                goto error;                                                    \
+            }                                                                  \
+                                                                               \
+            if (sc_cmap_lock_init(&m->shards[i].lock) != 0) {                  \
+                sc_map_term_##name(&m->shards[i].map);                         \
+                goto error;                                                    \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        m->mask = n - 1;                                                       \
+                                                                               \
+        return true;                                                           \
+                                                                               \
+    error:                                                                     \
+        while (i-- > 0) {                                                      \
+            sc_cmap_lock_term(&m->shards[i].lock);                             \
+            sc_map_term_##name(&m->shards[i].map);                             \
+        }                                                                      \
+                                                                               \
+        sc_cmap_free(m->shards);                                               \
+        m->shards = NULL;                                                      \
+                                                                               \
+        return false;                                                          \
+    }                                                                          \
+                                                                               \
+    void sc_cmap_term_##name(struct sc_cmap_##name *m)                         \
+    {                                                                          \
+        uint32_t i;                                                            \
+                                                                               \
+        if (m->shards == NULL) {                                               \
+            return;                                                            \
+        }                                                                      \
+                                                                               \
+        for (i = 0; i <= m->mask; i++) {                                       \
+            sc_cmap_lock_term(&m->shards[i].lock);                             \
+            sc_map_term_##name(&m->shards[i].map);                             \
+        }                                                                      \
+                                                                               \
+        sc_cmap_free(m->shards);                                               \
+        m->shards = NULL;                                                      \
+        m->mask = 0;                                                           \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_cmap_size_##name(struct sc_cmap_##name *m)                     \
+    {                                                                          \
+        uint32_t i, size = 0;                                                  \
+                                                                               \
+        for (i = 0; i <= m->mask; i++) {                                       \
+            sc_cmap_lock_read(&m->shards[i].lock);                             \
+            size += sc_map_size_##name(&m->shards[i].map);                     \
+            sc_cmap_unlock_read(&m->shards[i].lock);                           \
+        }                                                                      \
+                                                                               \
+        return size;                                                           \
+    }                                                                          \
+                                                                               \
+    void sc_cmap_clear_##name(struct sc_cmap_##name *m)                        \
+    {                                                                          \
+        uint32_t i;                                                            \
+                                                                               \
+        for (i = 0; i <= m->mask; i++) {                                       \
+            sc_cmap_lock_write(&m->shards[i].lock);                            \
+            sc_map_clear_##name(&m->shards[i].map);                            \
+            sc_cmap_unlock_write(&m->shards[i].lock);                          \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    bool sc_cmap_put_##name(struct sc_cmap_##name *m, K key, V val)            \
+    {                                                                          \
+        bool rc;                                                               \
+        struct sc_cmap_shard_##name *s = sc_cmap_shard_##name(m, key);         \
+                                                                               \
+        sc_cmap_lock_write(&s->lock);                                          \
+        rc = sc_map_put_##name(&s->map, key, val);                             \
+        sc_cmap_unlock_write(&s->lock);                                        \
+                                                                               \
+        return rc;                                                             \
+    }                                                                          \
+                                                                               \
+    bool sc_cmap_get_##name(struct sc_cmap_##name *m, K key, V *val)           \
+    {                                                                          \
+        bool rc;                                                               \
+        struct sc_cmap_shard_##name *s = sc_cmap_shard_##name(m, key);         \
+                                                                               \
+        sc_cmap_lock_read(&s->lock);                                           \
+        rc = sc_map_get_##name(&s->map, key, val);                             \
+        sc_cmap_unlock_read(&s->lock);                                         \
+                                                                               \
+        return rc;                                                             \
+    }                                                                          \
+                                                                               \
+    bool sc_cmap_del_##name(struct sc_cmap_##name *m, K key, V *val)           \
+    {                                                                          \
+        bool rc;                                                               \
+        struct sc_cmap_shard_##name *s = sc_cmap_shard_##name(m, key);         \
+                                                                               \
+        sc_cmap_lock_write(&s->lock);                                          \
+        rc = sc_map_del_##name(&s->map, key, val);                             \
+        sc_cmap_unlock_write(&s->lock);                                        \
+                                                                               \
+        return rc;                                                             \
+    }
+
+// clang-format off
+
+//              name  key type      value type     hash
+sc_cmap_impl_of(32,  uint32_t,     uint32_t,      sc_map_hash_32)
+sc_cmap_impl_of(64,  uint64_t,     uint64_t,      sc_map_hash_64)
+sc_cmap_impl_of(64v, uint64_t,     void *,        sc_map_hash_64)
+sc_cmap_impl_of(64s, uint64_t,     const char *,  sc_map_hash_64)
+sc_cmap_impl_of(str, const char *, const char *,  sc_map_hash_str)
+sc_cmap_impl_of(sv,  const char *, void *,        sc_map_hash_str)
+sc_cmap_impl_of(s64, const char *, uint64_t,      sc_map_hash_str)
+
+// clang-format on
@@ -0,0 +1,142 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_CMAP_H
+#define SC_CMAP_H
+
+#include "sc_map.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#else
+    #define sc_cmap_calloc calloc
+    #define sc_cmap_free   free
+#endif
+
+/**
+ * Concurrent map, sharded over sc_map.
+ *
+ * Keys are distributed to independent sc_map shards by hash, each shard has
+ * its own reader-writer lock. Readers of the same shard don't block each
+ * other, writers only block their own shard. Same api as sc_map with
+ * 'sc_cmap_' prefix.
+ */
+#define sc_cmap_of(name, K, V)                                                 \
+    struct sc_cmap_shard_##name;                                               \
+                                                                               \
+    struct sc_cmap_##name                                                      \
+    {                                                                          \
+        struct sc_cmap_shard_##name *shards;                                   \
+        uint32_t mask;                                                         \
+    };                                                                         \
+                                                                               \
+    /**                                                                        \
+     * Create map                                                              \
+     *                                                                         \
+     * struct sc_cmap_str map;                                                 \
+     * sc_cmap_init_str(&map, 0, 0, 0);                                        \
+     *                                                                         \
+     * @param map         map                                                  \
+     * @param shards      shard count, rounded up to a power of two.           \
+     *                    Pass 0 for default value.                            \
+     * @param cap         initial capacity, split between shards.              \
+     * @param load_factor must be >25 and <95. Pass 0 for default value.       \
+     * @return 'true' on success,                                              \
+     *         'false' on out of memory or if 'load_factor' value is invalid.  \
+     */                                                                        \
+    bool sc_cmap_init_##name(struct sc_cmap_##name *map, uint32_t shards,      \
+                             uint32_t cap, uint32_t load_factor);              \
+                                                                               \
+    /**                                                                        \
+     * Destroy map. Not thread-safe, no other thread may use the map.          \
+     *                                                                         \
+     * @param map map                                                          \
+     */                                                                        \
+    void sc_cmap_term_##name(struct sc_cmap_##name *map);                      \
+                                                                               \
+    /**                                                                        \
+     * Get element count. Shards are counted one by one, so the result is      \
+     * not a snapshot if there are concurrent writers.                         \
+     *                                                                         \
+     * @param map map                                                          \
+     * @return element count                                                   \
+     */                                                                        \
+    uint32_t sc_cmap_size_##name(struct sc_cmap_##name *map);                  \
+                                                                               \
+    /**                                                                        \
+     * Clear map                                                               \
+     *                                                                         \
+     * @param map map                                                          \
+     */                                                                        \
+    void sc_cmap_clear_##name(struct sc_cmap_##name *map);                     \
+                                                                               \
+    /**                                                                        \
+     * Put element to the map                                                  \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param K key                                                            \
+     * @param V value                                                          \
+     * @return 'true' on success, 'false' on out of memory.                    \
+     */                                                                        \
+    bool sc_cmap_put_##name(struct sc_cmap_##name *map, K key, V val);         \
+                                                                               \
+    /**                                                                        \
+     * Get element, readers of the same shard don't block each other.          \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param K key                                                            \
+     * @param V pointer to put value, if key is missing, value is undefined    \
+     * @return 'true' if key exists, 'false' otherwise                         \
+     */                                                                        \
+    bool sc_cmap_get_##name(struct sc_cmap_##name *map, K key, V *val);        \
+                                                                               \
+    /**                                                                        \
+     * Delete element                                                          \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param K key                                                            \
+     * @param V pointer to put current value                                   \
+     *          - if key does not exist, value is undefined                    \
+     *          - Pass NULL if you don't want to get previous 'value'          \
+     * @return 'true' if key exists, 'false' otherwise                         \
+     */                                                                        \
+    bool sc_cmap_del_##name(struct sc_cmap_##name *map, K key, V *val);
+
+// clang-format off
+
+//         name  key type      value type
+sc_cmap_of(32,  uint32_t,     uint32_t)
+sc_cmap_of(64,  uint64_t,     uint64_t)
+sc_cmap_of(64v, uint64_t,     void *)
+sc_cmap_of(64s, uint64_t,     const char *)
+sc_cmap_of(str, const char *, const char *)
+sc_cmap_of(sv,  const char *, void*)
+sc_cmap_of(s64, const char *, uint64_t)
+
+// clang-format on
+
+#endif
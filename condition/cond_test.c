@@ -7,6 +7,7 @@
 
 #include <windows.h>
 #define sleep(x) Sleep(1000 * (x))
+#define yield()  SwitchToThread()
 
 struct sc_thread
 {
@@ -20,6 +21,8 @@ struct sc_thread
 
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
+#define yield() sched_yield()
 
 struct sc_thread
 {
@@ -312,9 +315,124 @@ void test1()
 }
 
 
+static void *broadcast_fn(void *arg)
+{
+    char *data;
+    struct sc_cond *cond = arg;
+
+    data = sc_cond_wait(cond);
+    assert(strcmp(data, "all") == 0);
+
+    return NULL;
+}
+
+static uint32_t waiters(struct sc_cond *cond)
+{
+    uint32_t count;
+
+#if defined(_WIN32) || defined(_WIN64)
+    EnterCriticalSection(&cond->mtx);
+    count = cond->waiters;
+    LeaveCriticalSection(&cond->mtx);
+#else
+    pthread_mutex_lock(&cond->mtx);
+    count = cond->waiters;
+    pthread_mutex_unlock(&cond->mtx);
+#endif
+
+    return count;
+}
+
+void test_broadcast()
+{
+    struct sc_cond cond;
+    struct sc_thread threads[4];
+    void *data;
+
+    assert(sc_cond_init(&cond) == 0);
+
+    // Timeout, nothing signalled.
+    assert(sc_cond_wait_timeout(&cond, 10, &data) == false);
+    assert(sc_cond_wait_timeout(&cond, 0, NULL) == false);
+
+    // Signal is kept until somebody waits.
+    sc_cond_signal(&cond, "signal");
+    assert(sc_cond_wait_timeout(&cond, 10, &data) == true);
+    assert(strcmp(data, "signal") == 0);
+    assert(sc_cond_wait_timeout(&cond, 0, &data) == false);
+
+    // Broadcast without waiters behaves like signal.
+    sc_cond_broadcast(&cond, "all");
+    assert(sc_cond_wait_timeout(&cond, 0, &data) == true);
+    assert(strcmp(data, "all") == 0);
+
+    for (int i = 0; i < 4; i++) {
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], broadcast_fn, &cond) == 0);
+    }
+
+    while (waiters(&cond) != 4) {
+        yield();
+    }
+
+    sc_cond_broadcast(&cond, "all");
+
+    for (int i = 0; i < 4; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    // All waiters are woken up, nothing is left for the next one.
+    assert(sc_cond_wait_timeout(&cond, 0, &data) == false);
+    assert(sc_cond_term(&cond) == 0);
+}
+
+static void *sem_fn(void *arg)
+{
+    struct sc_sem *sem = arg;
+
+    for (int i = 0; i < 1000; i++) {
+        sc_sem_wait(sem);
+    }
+
+    return NULL;
+}
+
+void test_sem()
+{
+    struct sc_sem sem;
+    struct sc_thread threads[4];
+
+    assert(sc_sem_init(&sem, 2) == 0);
+    assert(sc_sem_trywait(&sem) == true);
+    assert(sc_sem_wait_timeout(&sem, 10) == true);
+    assert(sc_sem_trywait(&sem) == false);
+    assert(sc_sem_wait_timeout(&sem, 10) == false);
+    sc_sem_post(&sem, 1);
+    sc_sem_wait(&sem);
+
+    for (int i = 0; i < 4; i++) {
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], sem_fn, &sem) == 0);
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        sc_sem_post(&sem, i % 2 == 0 ? 1 : 7);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    // 1000 posts with 4000 count in total, all consumed.
+    assert(sc_sem_trywait(&sem) == false);
+    assert(sc_sem_term(&sem) == 0);
+}
+
 int main()
 {
     test1();
+    test_broadcast();
+    test_sem();
     fail_test();
 
     return 0;
@@ -30,6 +30,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 
 #if defined(_WIN32) || defined(_WIN64)
 #pragma warning(disable : 4996)
@@ -51,37 +52,53 @@ int sc_cond_term(struct sc_cond *cond)
     return 0;
 }
 
-void sc_cond_signal(struct sc_cond *cond, void *var)
+static uint64_t sc_cond_now(void)
 {
-    EnterCriticalSection(&cond->mtx);
+    return GetTickCount64();
+}
 
-    cond->data = var;
-    cond->done = true;
+static void sc_cond_lock(struct sc_cond *cond)
+{
+    EnterCriticalSection(&cond->mtx);
+}
 
-    WakeConditionVariable(&cond->cond);
+static void sc_cond_unlock(struct sc_cond *cond)
+{
     LeaveCriticalSection(&cond->mtx);
 }
 
-void* sc_cond_wait(struct sc_cond *cond)
+static void sc_cond_wake(struct sc_cond *cond, bool all)
 {
-    BOOL rc;
-    void* data;
-
-    EnterCriticalSection(&cond->mtx);
-
-    while (cond->done == false) {
-        // This should not fail as we pass INFINITE.
-        rc = SleepConditionVariableCS(&cond->cond, &cond->mtx, INFINITE);
-        assert(rc != 0);
+    if (all) {
+        WakeAllConditionVariable(&cond->cond);
+    } else {
+        WakeConditionVariable(&cond->cond);
     }
+}
 
-    data = cond->data;
-    cond->data = NULL;
-    cond->done = false;
+// Returns 'false' on timeout.
+static bool sc_cond_sleep(struct sc_cond *cond, uint64_t deadline)
+{
+    BOOL rc;
+    DWORD ms = INFINITE;
+    uint64_t now;
+
+    if (deadline != UINT64_MAX) {
+        now = sc_cond_now();
+        if (now >= deadline) {
+            return false;
+        }
+        ms = (DWORD) (deadline - now);
+    }
 
-    LeaveCriticalSection(&cond->mtx);
+    rc = SleepConditionVariableCS(&cond->cond, &cond->mtx, ms);
+    if (rc == 0) {
+        // This should not fail with anything else.
+        assert(GetLastError() == ERROR_TIMEOUT);
+        return false;
+    }
 
-    return data;
+    return true;
 }
 
 #else
@@ -94,6 +111,7 @@ int sc_cond_init(struct sc_cond *cond)
     *cond = (struct sc_cond){0};
 
     pthread_mutexattr_t attr;
+    pthread_condattr_t cattr;
     pthread_mutex_t mut = PTHREAD_MUTEX_INITIALIZER;
 
     cond->mtx = mut;
@@ -112,7 +130,19 @@ int sc_cond_init(struct sc_cond *cond)
         goto cleanup_attr;
     }
 
-    rc = pthread_cond_init(&cond->cond, NULL);
+    rc = pthread_condattr_init(&cattr);
+    if (rc != 0) {
+        goto cleanup_mutex;
+    }
+
+#if !defined(__APPLE__)
+    // Timed waits use monotonic clock, this won't fail with a valid clock.
+    rc = pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    assert(rc == 0);
+#endif
+
+    rc = pthread_cond_init(&cond->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
     if (rc != 0) {
         goto cleanup_mutex;
     }
@@ -147,43 +177,225 @@ int sc_cond_term(struct sc_cond *cond)
     return rc;
 }
 
-void sc_cond_signal(struct sc_cond *cond, void *data)
+static uint64_t sc_cond_now(void)
 {
-    int rc;
+    struct timespec ts;
 
-    pthread_mutex_lock(&cond->mtx);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+}
 
-    cond->data = data;
-    cond->done = true;
+static void sc_cond_lock(struct sc_cond *cond)
+{
+    int rc;
 
     // This won't fail as long as we pass correct params.
-    rc = pthread_cond_signal(&cond->cond);
+    rc = pthread_mutex_lock(&cond->mtx);
     assert(rc == 0);
+    (void) rc;
+}
+
+static void sc_cond_unlock(struct sc_cond *cond)
+{
+    int rc;
 
-    pthread_mutex_unlock(&cond->mtx);
+    // This won't fail as long as we pass correct params.
+    rc = pthread_mutex_unlock(&cond->mtx);
+    assert(rc == 0);
+    (void) rc;
 }
 
-void *sc_cond_wait(struct sc_cond *cond)
+static void sc_cond_wake(struct sc_cond *cond, bool all)
 {
     int rc;
-    void *data;
 
-    pthread_mutex_lock(&cond->mtx);
+    // This won't fail as long as we pass correct params.
+    rc = all ? pthread_cond_broadcast(&cond->cond) :
+               pthread_cond_signal(&cond->cond);
+    assert(rc == 0);
+    (void) rc;
+}
+
+// Returns 'false' on timeout.
+static bool sc_cond_sleep(struct sc_cond *cond, uint64_t deadline)
+{
+    int rc;
+    uint64_t ms = deadline;
+    struct timespec ts;
 
-    while (cond->done == false) {
+    if (deadline == UINT64_MAX) {
         // This won't fail as long as we pass correct params.
         rc = pthread_cond_wait(&cond->cond, &cond->mtx);
         assert(rc == 0);
+        return true;
     }
 
-    data = cond->data;
-    cond->data = NULL;
-    cond->done = false;
+#if defined(__APPLE__)
+    // No pthread_condattr_setclock(), convert deadline to wall clock time.
+    uint64_t now = sc_cond_now();
 
-    pthread_mutex_unlock(&cond->mtx);
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ms = deadline > now ? deadline - now : 0;
+    ms += (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+#endif
 
-    return data;
+    ts.tv_sec = (time_t) (ms / 1000);
+    ts.tv_nsec = (long) ((ms % 1000) * 1000000);
+
+    rc = pthread_cond_timedwait(&cond->cond, &cond->mtx, &ts);
+    assert(rc == 0 || rc == ETIMEDOUT);
+
+    return rc != ETIMEDOUT;
 }
 
 #endif
 
+void sc_cond_signal(struct sc_cond *cond, void *data)
+{
+    sc_cond_lock(cond);
+    cond->data = data;
+    cond->done = true;
+    sc_cond_wake(cond, false);
+    sc_cond_unlock(cond);
+}
+
+void sc_cond_broadcast(struct sc_cond *cond, void *data)
+{
+    sc_cond_lock(cond);
+    cond->data = data;
+
+    // Wake up current waiters, if there is none, behave like signal.
+    if (cond->waiters == 0) {
+        cond->done = true;
+    } else {
+        cond->gen++;
+        sc_cond_wake(cond, true);
+    }
+
+    sc_cond_unlock(cond);
+}
+
+static bool sc_cond_wait_until(struct sc_cond *cond, uint64_t deadline,
+                               void **data)
+{
+    bool woken, signalled;
+    uint32_t gen;
+
+    sc_cond_lock(cond);
+
+    gen = cond->gen;
+    cond->waiters++;
+
+    while (!cond->done && cond->gen == gen) {
+        if (!sc_cond_sleep(cond, deadline)) {
+            break;
+        }
+    }
+
+    cond->waiters--;
+    woken = cond->gen != gen;
+    signalled = woken || cond->done;
+
+    if (signalled && data != NULL) {
+        *data = cond->data;
+    }
+
+    // Signal is consumed by a single waiter, broadcast data is cleared when
+    // the last waiter leaves.
+    if (!woken && cond->done) {
+        cond->done = false;
+        cond->data = NULL;
+    } else if (woken && cond->waiters == 0 && !cond->done) {
+        cond->data = NULL;
+    }
+
+    sc_cond_unlock(cond);
+
+    return signalled;
+}
+
+void *sc_cond_wait(struct sc_cond *cond)
+{
+    void *data = NULL;
+
+    sc_cond_wait_until(cond, UINT64_MAX, &data);
+
+    return data;
+}
+
+bool sc_cond_wait_timeout(struct sc_cond *cond, uint32_t ms, void **data)
+{
+    return sc_cond_wait_until(cond, sc_cond_now() + ms, data);
+}
+
+int sc_sem_init(struct sc_sem *sem, uint32_t count)
+{
+    sem->count = count;
+    return sc_cond_init(&sem->cond);
+}
+
+int sc_sem_term(struct sc_sem *sem)
+{
+    return sc_cond_term(&sem->cond);
+}
+
+void sc_sem_post(struct sc_sem *sem, uint32_t n)
+{
+    struct sc_cond *cond = &sem->cond;
+
+    sc_cond_lock(cond);
+    sem->count += n;
+    if (cond->waiters > 0) {
+        sc_cond_wake(cond, n > 1);
+    }
+    sc_cond_unlock(cond);
+}
+
+static bool sc_sem_wait_until(struct sc_sem *sem, uint64_t deadline)
+{
+    bool rc = true;
+    struct sc_cond *cond = &sem->cond;
+
+    sc_cond_lock(cond);
+    cond->waiters++;
+
+    while (sem->count == 0) {
+        if (!sc_cond_sleep(cond, deadline)) {
+            rc = sem->count > 0;
+            break;
+        }
+    }
+
+    if (rc) {
+        sem->count--;
+    }
+
+    cond->waiters--;
+    sc_cond_unlock(cond);
+
+    return rc;
+}
+
+void sc_sem_wait(struct sc_sem *sem)
+{
+    sc_sem_wait_until(sem, UINT64_MAX);
+}
+
+bool sc_sem_wait_timeout(struct sc_sem *sem, uint32_t ms)
+{
+    return sc_sem_wait_until(sem, sc_cond_now() + ms);
+}
+
+bool sc_sem_trywait(struct sc_sem *sem)
+{
+    bool rc;
+
+    sc_cond_lock(&sem->cond);
+    rc = sem->count > 0;
+    if (rc) {
+        sem->count--;
+    }
+    sc_cond_unlock(&sem->cond);
+
+    return rc;
+}
@@ -26,6 +26,7 @@
 #define SC_COND_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #if defined(_WIN32) || defined(_WIN64)
     #include <windows.h>
@@ -37,6 +38,8 @@ struct sc_cond
 {
     bool done;
     void *data;
+    uint32_t waiters;
+    uint32_t gen;
 
 #if defined(_WIN32) || defined(_WIN64)
     CONDITION_VARIABLE cond;
@@ -71,6 +74,73 @@ void sc_cond_signal(struct sc_cond *cond, void *data);
  */
 void *sc_cond_wait(struct sc_cond *cond);
 
+/**
+ * Wakes up all threads waiting on the condition at the moment. If there is
+ * no waiter, behaves like sc_cond_signal().
+ *
+ * @param cond cond
+ * @param data data to pass to waiting threads.
+ */
+void sc_cond_broadcast(struct sc_cond *cond, void *data);
+
+/**
+ * Same as sc_cond_wait() with a timeout.
+ *
+ * @param cond cond
+ * @param ms   timeout in milliseconds
+ * @param data out param, 'data' argument of the signal, can be NULL.
+ * @return     'true' if signalled, 'false' on timeout.
+ */
+bool sc_cond_wait_timeout(struct sc_cond *cond, uint32_t ms, void **data);
+
+/**
+ * Counting semaphore, built on sc_cond.
+ */
+struct sc_sem
+{
+    struct sc_cond cond;
+    uint64_t count;
+};
+
+/**
+ * @param sem   sem
+ * @param count initial count
+ * @return      '0' on success, negative on error, errno will be set.
+ */
+int sc_sem_init(struct sc_sem *sem, uint32_t count);
 
+/**
+ * @param sem sem
+ * @return    '0' on success, negative on error, errno will be set.
+ */
+int sc_sem_term(struct sc_sem *sem);
+
+/**
+ * Increment count by 'n' and wake up waiters.
+ *
+ * @param sem sem
+ * @param n   count to add
+ */
+void sc_sem_post(struct sc_sem *sem, uint32_t n);
+
+/**
+ * Wait until count is positive and decrement it.
+ *
+ * @param sem sem
+ */
+void sc_sem_wait(struct sc_sem *sem);
+
+/**
+ * @param sem sem
+ * @param ms  timeout in milliseconds
+ * @return    'true' if count is decremented, 'false' on timeout.
+ */
+bool sc_sem_wait_timeout(struct sc_sem *sem, uint32_t ms);
+
+/**
+ * @param sem sem
+ * @return    'true' if count is decremented, 'false' if count is zero.
+ */
+bool sc_sem_trywait(struct sc_sem *sem);
 
 #endif
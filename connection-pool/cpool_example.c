@@ -0,0 +1,83 @@
+#include "sc_cpool.h"
+#include "sc_thread.h"
+#include "sc_time.h"
+#include "sc_timer.h"
+
+#include <stdio.h>
+
+static struct sc_cpool pool;
+
+static void *worker(void *arg)
+{
+    struct sc_cpool_conn *c;
+
+    for (int i = 0; i < 5; i++) {
+        c = sc_cpool_get(&pool);
+        if (c == NULL) {
+            printf("No connection \n");
+            continue;
+        }
+
+        // Send a request, close the connection on failure.
+        if (sc_sock_send(&c->sock, "ping", 4, 0) != 4) {
+            sc_cpool_put(&pool, c, false);
+            continue;
+        }
+
+        printf("Worker %s, conn : %u \n", (char *) arg, c->index);
+        sc_cpool_put(&pool, c, true);
+        sc_time_sleep(100);
+    }
+
+    return NULL;
+}
+
+static void on_timeout(void *arg, uint64_t timeout, uint64_t type, void *data)
+{
+    struct sc_timer *timer = arg;
+
+    (void) timeout;
+
+    if (type == SC_CPOOL_TIMER) {
+        printf("Evicted : %u \n", sc_cpool_evict(data, sc_time_mono_ms()));
+        sc_timer_add(timer, 200, SC_CPOOL_TIMER, data);
+    }
+}
+
+int main()
+{
+    uint64_t end;
+    struct sc_sock srv;
+    struct sc_timer timer;
+    struct sc_sock_addr addr;
+    struct sc_thread t1, t2;
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    sc_sock_listen(&srv, "127.0.0.1", "11501");
+
+    sc_sock_addr_init(&addr, SC_SOCK_INET, "127.0.0.1", "11501");
+    sc_cpool_init(&pool, &addr, 4, 300, true);
+
+    sc_thread_init(&t1);
+    sc_thread_init(&t2);
+    sc_thread_start(&t1, worker, "1");
+    sc_thread_start(&t2, worker, "2");
+
+    // Event loop thread evicts idle connections.
+    sc_timer_init(&timer, sc_time_mono_ms());
+    sc_timer_add(&timer, 200, SC_CPOOL_TIMER, &pool);
+
+    end = sc_time_mono_ms() + 1500;
+    while (sc_time_mono_ms() < end) {
+        sc_time_sleep(sc_timer_timeout(&timer, sc_time_mono_ms(), &timer,
+                                       on_timeout));
+    }
+
+    sc_thread_term(&t1);
+    sc_thread_term(&t2);
+    sc_timer_term(&timer);
+    sc_cpool_term(&pool);
+    sc_sock_term(&srv);
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include "sc_cpool.h"
+#include "sc_thread.h"
+#include "sc_time.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#define PORT "11500"
+
+#ifdef SC_HAVE_WRAP
+
+bool fail_calloc = false;
+void *__real_calloc(size_t m, size_t n);
+void *__wrap_calloc(size_t m, size_t n)
+{
+    if (fail_calloc) {
+        return NULL;
+    }
+
+    return __real_calloc(m, n);
+}
+
+void fail_test(void)
+{
+    struct sc_cpool p;
+    struct sc_sock_addr addr;
+
+    assert(sc_sock_addr_init(&addr, SC_SOCK_INET, "127.0.0.1", PORT) == 0);
+
+    fail_calloc = true;
+    assert(sc_cpool_init(&p, &addr, 4, 0, true) == -1);
+    fail_calloc = false;
+    assert(sc_cpool_init(&p, &addr, 4, 0, true) == 0);
+    sc_cpool_term(&p);
+}
+
+#else
+void fail_test(void)
+{
+}
+#endif
+
+void test_basic(void)
+{
+    struct sc_sock srv, in;
+    struct sc_cpool p;
+    struct sc_sock_addr addr;
+    struct sc_cpool_conn *c1, *c2, *c3;
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    assert(sc_sock_listen(&srv, "127.0.0.1", PORT) == 0);
+    assert(sc_sock_addr_init(&addr, SC_SOCK_INET, "127.0.0.1", PORT) == 0);
+
+    assert(sc_cpool_init(&p, &addr, 2, 100, true) == 0);
+    assert(sc_cpool_idle(&p) == 0);
+
+    // Reuse
+    c1 = sc_cpool_get(&p);
+    assert(c1 != NULL);
+    assert(sc_sock_accept(&srv, &in) == 0);
+    assert(sc_sock_send(&c1->sock, "a", 1, 0) == 1);
+    sc_cpool_put(&p, c1, true);
+    assert(sc_cpool_idle(&p) == 1);
+    assert(sc_cpool_get(&p) == c1);
+    assert(sc_cpool_idle(&p) == 0);
+
+    // Max
+    c2 = sc_cpool_get(&p);
+    assert(c2 != NULL && c2 != c1);
+    assert(sc_cpool_get(&p) == NULL);
+    sc_cpool_put(&p, c2, false);
+    sc_sock_term(&in);
+    assert(sc_sock_accept(&srv, &in) == 0);
+    sc_sock_term(&in);
+
+    // Closed by the peer, replaced by a new connection.
+    sc_cpool_put(&p, c1, true);
+    sc_time_sleep(10);
+    c3 = sc_cpool_get(&p);
+    assert(c3 != NULL);
+    assert(sc_cpool_idle(&p) == 0);
+    assert(sc_sock_accept(&srv, &in) == 0);
+
+    // Unexpected data on an idle connection
+    sc_cpool_put(&p, c3, true);
+    assert(sc_sock_send(&in, "x", 1, 0) == 1);
+    sc_time_sleep(10);
+    c1 = sc_cpool_get(&p);
+    assert(c1 != NULL);
+    sc_sock_term(&in);
+    assert(sc_sock_accept(&srv, &in) == 0);
+    sc_sock_term(&in);
+    sc_cpool_put(&p, c1, true);
+
+    // Eviction
+    assert(sc_cpool_evict(&p, sc_time_mono_ms()) == 0);
+    assert(sc_cpool_idle(&p) == 1);
+    assert(sc_cpool_evict(&p, sc_time_mono_ms() + 1000) == 1);
+    assert(sc_cpool_idle(&p) == 0);
+
+    sc_cpool_term(&p);
+
+    // No eviction without idle timeout
+    assert(sc_cpool_init(&p, &addr, 1, 0, false) == 0);
+    c1 = sc_cpool_get(&p);
+    assert(c1 != NULL);
+    assert(sc_sock_accept(&srv, &in) == 0);
+    sc_cpool_put(&p, c1, true);
+    assert(sc_cpool_evict(&p, sc_time_mono_ms() + 1000) == 0);
+    sc_cpool_term(&p);
+    sc_sock_term(&in);
+
+    sc_sock_term(&srv);
+
+    // Connect failure releases the slot.
+    assert(sc_cpool_init(&p, &addr, 1, 0, true) == 0);
+    assert(sc_cpool_get(&p) == NULL);
+    assert(sc_cpool_get(&p) == NULL);
+    sc_cpool_term(&p);
+
+    assert(sc_cpool_init(&p, &addr, 0, 0, true) == 0);
+    assert(sc_cpool_get(&p) == NULL);
+    sc_cpool_term(&p);
+}
+
+#define THREADS 4
+#define MAX     3
+
+static struct sc_cpool shared;
+static int inuse;
+
+static void *worker(void *arg)
+{
+    int n;
+    struct sc_cpool_conn *c;
+
+    (void) arg;
+
+    for (int i = 0; i < 10000; i++) {
+        c = sc_cpool_get(&shared);
+        if (c == NULL) {
+            continue;
+        }
+
+        n = __atomic_add_fetch(&inuse, 1, __ATOMIC_RELAXED);
+        assert(n <= MAX);
+        __atomic_sub_fetch(&inuse, 1, __ATOMIC_RELAXED);
+
+        sc_cpool_put(&shared, c, true);
+        if (i % 1000 == 0) {
+            sc_cpool_evict(&shared, sc_time_mono_ms());
+        }
+    }
+
+    return NULL;
+}
+
+void test_threads(void)
+{
+    struct sc_sock srv;
+    struct sc_sock_addr addr;
+    struct sc_thread thr[THREADS];
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    assert(sc_sock_listen(&srv, "127.0.0.1", PORT) == 0);
+    assert(sc_sock_addr_init(&addr, SC_SOCK_INET, "127.0.0.1", PORT) == 0);
+    assert(sc_cpool_init(&shared, &addr, MAX, 60000, true) == 0);
+
+    for (int i = 0; i < THREADS; i++) {
+        sc_thread_init(&thr[i]);
+        assert(sc_thread_start(&thr[i], worker, NULL) == 0);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&thr[i]) == 0);
+    }
+
+    assert(sc_cpool_idle(&shared) >= 1);
+    assert(sc_cpool_idle(&shared) <= MAX);
+
+    sc_cpool_term(&shared);
+    sc_sock_term(&srv);
+}
+
+int main(void)
+{
+    fail_test();
+    test_basic();
+    test_threads();
+
+    return 0;
+}
@@ -0,0 +1,245 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "sc_cpool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <intrin.h>
+
+    #define sc_cpool_load(p)         (*(volatile uint64_t *) (p))
+    #define sc_cpool_load_32(p)      (*(volatile uint32_t *) (p))
+    #define sc_cpool_store_32(p, v)  (*(volatile uint32_t *) (p) = (v))
+    #define sc_cpool_cas(p, old, v)                                            \
+        ((uint64_t) _InterlockedCompareExchange64((volatile __int64 *) (p),    \
+                                                  (__int64) (v),               \
+                                                  (__int64) (old)) == (old))
+    #define sc_cpool_poll(fds, n) WSAPoll(fds, n, 0)
+
+typedef WSAPOLLFD sc_cpool_pollfd;
+#else
+    #include <poll.h>
+    #include <netinet/in.h>
+
+    #define sc_cpool_load(p)        __atomic_load_n(p, __ATOMIC_ACQUIRE)
+    #define sc_cpool_load_32(p)     __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_cpool_store_32(p, v) __atomic_store_n(p, v, __ATOMIC_RELAXED)
+    #define sc_cpool_cas(p, old, v)                                            \
+        __atomic_compare_exchange_n(p, &(old), v, true, __ATOMIC_ACQ_REL,      \
+                                    __ATOMIC_ACQUIRE)
+    #define sc_cpool_poll(fds, n) poll(fds, n, 0)
+
+typedef struct pollfd sc_cpool_pollfd;
+#endif
+
+#include "sc_time.h"
+
+// Stack head : tag in the high 32 bits, index + 1 in low 32 bits, '0' is empty.
+#define SC_CPOOL_NIL 0u
+
+static void sc_cpool_push(uint64_t *head, struct sc_cpool_conn *c)
+{
+    uint64_t old, val;
+
+    do {
+        old = sc_cpool_load(head);
+        sc_cpool_store_32(&c->next, (uint32_t) old);
+        val = (((old >> 32) + 1) << 32) | (c->index + 1);
+    } while (!sc_cpool_cas(head, old, val));
+}
+
+static struct sc_cpool_conn *sc_cpool_pop(struct sc_cpool *p, uint64_t *head)
+{
+    uint32_t idx;
+    uint64_t old, val;
+
+    do {
+        old = sc_cpool_load(head);
+        idx = (uint32_t) old;
+        if (idx == SC_CPOOL_NIL) {
+            return NULL;
+        }
+
+        // Slot may be popped and pushed concurrently, 'next' may be stale
+        // then, but the tag makes CAS fail.
+        val = (((old >> 32) + 1) << 32) |
+              sc_cpool_load_32(&p->conns[idx - 1].next);
+    } while (!sc_cpool_cas(head, old, val));
+
+    return &p->conns[idx - 1];
+}
+
+int sc_cpool_init(struct sc_cpool *p, const struct sc_sock_addr *addr,
+                  uint32_t max, uint64_t idle, bool blocking)
+{
+    *p = (struct sc_cpool){0};
+
+    p->conns = sc_cpool_calloc(max == 0 ? 1 : max, sizeof(*p->conns));
+    if (p->conns == NULL) {
+        return -1;
+    }
+
+    p->max = max;
+    p->idle_timeout = idle;
+    p->blocking = blocking;
+    p->addr = *addr;
+
+    for (uint32_t i = max; i > 0; i--) {
+        p->conns[i - 1].index = i - 1;
+        sc_cpool_push(&p->free_head, &p->conns[i - 1]);
+    }
+
+    return 0;
+}
+
+void sc_cpool_term(struct sc_cpool *p)
+{
+    struct sc_cpool_conn *c;
+
+    while ((c = sc_cpool_pop(p, &p->idle_head)) != NULL) {
+        sc_sock_term(&c->sock);
+    }
+
+    sc_cpool_free(p->conns);
+    p->conns = NULL;
+}
+
+// Idle connection must not be readable, it is either closed by the peer or
+// has unexpected data, e.g. a late response of a timed out request.
+static bool sc_cpool_alive(struct sc_cpool_conn *c)
+{
+    int rc;
+    sc_cpool_pollfd pfd = {.fd = c->sock.fdt.fd, .events = POLLIN};
+
+    rc = sc_cpool_poll(&pfd, 1);
+
+    return rc == 0;
+}
+
+static int sc_cpool_connect(struct sc_cpool *p, struct sc_cpool_conn *c)
+{
+    int rc, on = 1;
+    int family = p->addr.storage.ss_family;
+
+    sc_sock_init(&c->sock, 0, p->blocking, family);
+
+    rc = sc_sock_connect_addr(&c->sock, &p->addr, NULL, NULL);
+    if (rc != 0 && rc != SC_SOCK_WANT_WRITE) {
+        sc_sock_term(&c->sock);
+        return -1;
+    }
+
+    if (family != AF_UNIX) {
+        setsockopt(c->sock.fdt.fd, SOL_SOCKET, SO_KEEPALIVE,
+                   (const char *) &on, sizeof(on));
+    }
+
+    return 0;
+}
+
+struct sc_cpool_conn *sc_cpool_get(struct sc_cpool *p)
+{
+    struct sc_cpool_conn *c;
+
+    while ((c = sc_cpool_pop(p, &p->idle_head)) != NULL) {
+        if (sc_cpool_alive(c)) {
+            return c;
+        }
+
+        sc_sock_term(&c->sock);
+        sc_cpool_push(&p->free_head, c);
+    }
+
+    c = sc_cpool_pop(p, &p->free_head);
+    if (c == NULL) {
+        return NULL;
+    }
+
+    if (sc_cpool_connect(p, c) != 0) {
+        sc_cpool_push(&p->free_head, c);
+        return NULL;
+    }
+
+    return c;
+}
+
+void sc_cpool_put(struct sc_cpool *p, struct sc_cpool_conn *c, bool reuse)
+{
+    if (!reuse) {
+        sc_sock_term(&c->sock);
+        sc_cpool_push(&p->free_head, c);
+        return;
+    }
+
+    c->last_used = sc_time_mono_ms();
+    sc_cpool_push(&p->idle_head, c);
+}
+
+uint32_t sc_cpool_evict(struct sc_cpool *p, uint64_t now)
+{
+    uint32_t count = 0, n = 0;
+    struct sc_cpool_conn *c, *keep = NULL;
+
+    if (p->idle_timeout == 0) {
+        return 0;
+    }
+
+    // Pop at most 'max' to terminate while other threads return connections,
+    // kept ones are pushed back at the end.
+    while (n++ < p->max && (c = sc_cpool_pop(p, &p->idle_head)) != NULL) {
+        if (c->last_used + p->idle_timeout <= now) {
+            sc_sock_term(&c->sock);
+            sc_cpool_push(&p->free_head, c);
+            count++;
+            continue;
+        }
+
+        sc_cpool_store_32(&c->next, keep ? keep->index + 1 : SC_CPOOL_NIL);
+        keep = c;
+    }
+
+    while (keep != NULL) {
+        c = keep;
+        keep = c->next == SC_CPOOL_NIL ? NULL : &p->conns[c->next - 1];
+        sc_cpool_push(&p->idle_head, c);
+    }
+
+    return count;
+}
+
+uint32_t sc_cpool_idle(struct sc_cpool *p)
+{
+    uint32_t count = 0;
+    uint32_t idx = (uint32_t) sc_cpool_load(&p->idle_head);
+
+    while (idx != SC_CPOOL_NIL && count < p->max) {
+        count++;
+        idx = sc_cpool_load_32(&p->conns[idx - 1].next);
+    }
+
+    return count;
+}
@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SC_CPOOL_H
+#define SC_CPOOL_H
+
+#include "sc_sock.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#else
+    #define sc_cpool_calloc calloc
+    #define sc_cpool_free   free
+#endif
+
+// Timer type for periodic eviction, see sc_cpool_evict().
+#ifndef SC_CPOOL_TIMER
+    #define SC_CPOOL_TIMER 0x5cc1
+#endif
+
+struct sc_cpool_conn
+{
+    struct sc_sock sock;
+    uint64_t last_used;
+    uint32_t next;
+    uint32_t index;
+};
+
+/**
+ * Outbound connection pool for a single destination, e.g. keep one pool per
+ * backend in an sc_map.
+ *
+ * Connections are kept in a fixed array of 'max' slots. Idle connections and
+ * unused slots are two lock-free stacks, so worker threads check out and
+ * return connections with a single CAS each. Stack heads carry a tag to
+ * avoid ABA.
+ *
+ * A connection is checked on checkout, one taken from the idle stack is
+ * discarded if the peer closed it or sent unexpected data, then the next one
+ * is tried. New connections have TCP keepalive enabled.
+ *
+ * sc_cpool_evict() closes connections idle longer than the idle timeout,
+ * call it periodically, e.g. from an sc_timer callback.
+ */
+struct sc_cpool
+{
+    uint64_t idle_head;
+    char pad0[56];
+    uint64_t free_head;
+    char pad1[56];
+
+    struct sc_cpool_conn *conns;
+    uint32_t max;
+    uint64_t idle_timeout;
+    bool blocking;
+    struct sc_sock_addr addr;
+};
+
+/**
+ * @param p        pool
+ * @param addr     destination, e.g. resolved with sc_sock_addr_init() or sc_dns
+ * @param max      max connection count
+ * @param idle     idle timeout in milliseconds, '0' to keep connections
+ *                 until they fail.
+ * @param blocking are connections blocking
+ * @return         '0' on success, '-1' on out of memory.
+ */
+int sc_cpool_init(struct sc_cpool *p, const struct sc_sock_addr *addr,
+                  uint32_t max, uint64_t idle, bool blocking);
+
+/**
+ * Close idle connections and release memory, checked out connections must be
+ * returned before.
+ *
+ * @param p pool
+ */
+void sc_cpool_term(struct sc_cpool *p);
+
+/**
+ * Check out a connection, thread-safe. Reuses an idle connection if there is
+ * a healthy one, otherwise connects a new one.
+ *
+ * A new connection of a non-blocking pool may still be connecting, wait for
+ * SC_SOCK_WRITE and call sc_sock_finish_connect().
+ *
+ * @param p pool
+ * @return  connection, NULL if 'max' connections are checked out or connect
+ *          fails.
+ */
+struct sc_cpool_conn *sc_cpool_get(struct sc_cpool *p);
+
+/**
+ * Return a connection, thread-safe.
+ *
+ * @param p     pool
+ * @param c     connection
+ * @param reuse 'true' to keep the connection for reuse, 'false' to close it,
+ *              e.g. after an error or a protocol violation.
+ */
+void sc_cpool_put(struct sc_cpool *p, struct sc_cpool_conn *c, bool reuse);
+
+/**
+ * Close connections idle for longer than the idle timeout, thread-safe.
+ *
+ * e.g. from an sc_timer callback :
+ *   sc_cpool_evict(pool, sc_time_mono_ms());
+ *   sc_timer_add(&timer, 1000, SC_CPOOL_TIMER, pool);
+ *
+ * @param p   pool
+ * @param now sc_time_mono_ms() timestamp
+ * @return    closed connection count
+ */
+uint32_t sc_cpool_evict(struct sc_cpool *p, uint64_t now);
+
+/**
+ * @param p pool
+ * @return  idle connection count, a snapshot.
+ */
+uint32_t sc_cpool_idle(struct sc_cpool *p);
+
+#endif
@@ -0,0 +1,109 @@
+#include "sc_conn.h"
+#include "sc_time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Echo server, connect with 'nc 127.0.0.1 8080'. Idle connections are closed
+// after 10 seconds, slow readers stop being read at the high watermark.
+
+static struct sc_sock_poll poll;
+static struct sc_timer timer;
+
+static void on_timeout(void *arg, uint64_t timeout, uint64_t type, void *data)
+{
+    struct sc_conn *c = data;
+
+    (void) arg;
+    (void) timeout;
+    (void) type;
+
+    printf("Idle connection closed \n");
+    sc_conn_timeout(c);
+    sc_conn_term(c);
+    free(c);
+}
+
+static void on_event(struct sc_conn *c, uint32_t events)
+{
+    int rc;
+    char buf[4096];
+
+    if (events & SC_SOCK_WRITE) {
+        if (sc_conn_flush(c) == SC_SOCK_ERROR) {
+            goto close;
+        }
+    }
+
+    if (events & SC_SOCK_READ) {
+        rc = sc_conn_recv(c, buf, sizeof(buf));
+        if (rc == SC_SOCK_ERROR) {
+            goto close;
+        }
+
+        if (rc > 0 && sc_conn_write(c, buf, (uint32_t) rc) != 0) {
+            goto close;
+        }
+    }
+
+    return;
+
+close:
+    sc_conn_term(c);
+    free(c);
+}
+
+int main()
+{
+    int n;
+    uint64_t end;
+    struct sc_conn *c;
+    struct sc_sock listener;
+
+    sc_sock_poll_init(&poll);
+    sc_timer_init(&timer, sc_time_mono_ms());
+
+    sc_sock_init(&listener, 0, false, AF_INET);
+    if (sc_sock_listen(&listener, "127.0.0.1", "8080") != 0) {
+        printf("%s \n", sc_sock_error(&listener));
+        return -1;
+    }
+
+    sc_sock_poll_add(&poll, &listener.fdt, SC_SOCK_READ, &listener);
+    end = sc_time_mono_ms() + 60000;
+
+    while (sc_time_mono_ms() < end) {
+        n = sc_sock_poll_wait(&poll, 100);
+
+        for (int i = 0; i < n; i++) {
+            void *data = sc_sock_poll_data(&poll, i);
+            uint32_t events = sc_sock_poll_event(&poll, i);
+
+            if (data != &listener) {
+                on_event(data, events);
+                continue;
+            }
+
+            c = malloc(sizeof(*c));
+            if (c == NULL) {
+                continue;
+            }
+
+            sc_conn_init(c, &poll, &timer, c);
+            if (sc_sock_accept(&listener, &c->sock) != 0) {
+                free(c);
+                continue;
+            }
+
+            sc_conn_start(c, 10000);
+        }
+
+        sc_timer_timeout(&timer, sc_time_mono_ms(), NULL, on_timeout);
+    }
+
+    sc_sock_term(&listener);
+    sc_timer_term(&timer);
+    sc_sock_poll_term(&poll);
+
+    return 0;
+}
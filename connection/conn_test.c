@@ -0,0 +1,287 @@
+#include "sc_conn.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PORT "11400"
+
+static struct sc_sock listener;
+static struct sc_sock_poll poll;
+
+// Connects a non-blocking client to a new connection.
+static void conn_open(struct sc_conn *c, struct sc_sock *client,
+                      struct sc_timer *timer)
+{
+    sc_sock_init(&listener, 0, false, AF_INET);
+    assert(sc_sock_listen(&listener, "127.0.0.1", PORT) == 0);
+
+    sc_sock_init(client, 0, true, AF_INET);
+    assert(sc_sock_connect(client, "127.0.0.1", PORT, NULL, NULL) == 0);
+    assert(sc_sock_set_blocking(client, false) == 0);
+
+    sc_conn_init(c, &poll, timer, c);
+    while (sc_sock_accept(&listener, &c->sock) != 0) {
+    }
+    assert(sc_sock_term(&listener) == 0);
+}
+
+// Drains the client side, returns received byte count.
+static uint64_t client_drain(struct sc_sock *client, uint64_t *pos)
+{
+    int rc;
+    uint64_t total = 0;
+    unsigned char buf[8192];
+
+    while ((rc = sc_sock_recv(client, (char *) buf, sizeof(buf), 0)) > 0) {
+        for (int i = 0; i < rc; i++) {
+            assert(buf[i] == (unsigned char) (*pos % 251));
+            (*pos)++;
+        }
+        total += (uint64_t) rc;
+    }
+
+    return total;
+}
+
+#ifdef SC_HAVE_WRAP
+
+bool fail_malloc = false;
+void *__real_malloc(size_t n);
+void *__wrap_malloc(size_t n)
+{
+    if (fail_malloc) {
+        return NULL;
+    }
+
+    return __real_malloc(n);
+}
+
+void fail_test(void)
+{
+    char data[4096] = {0};
+    struct sc_conn c;
+    struct sc_sock client;
+    struct sc_buf buf;
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    conn_open(&c, &client, NULL);
+    assert(sc_conn_start(&c, 0) == 0);
+
+    // Fill socket buffers, then queueing fails.
+    while (sc_conn_queued(&c) == 0) {
+        assert(sc_conn_write(&c, data, sizeof(data)) == 0);
+    }
+
+    fail_malloc = true;
+    for (int i = 0; i < 100; i++) {
+        if (sc_conn_write(&c, data, sizeof(data)) != 0) {
+            break;
+        }
+    }
+    assert(sc_conn_write(&c, data, sizeof(data)) == SC_SOCK_ERROR);
+    assert(strcmp(sc_conn_err(&c), "Out of memory.") == 0);
+
+    buf = sc_buf_wrap(data, sizeof(data), SC_BUF_REF | SC_BUF_DATA);
+    assert(sc_conn_write_buf(&c, &buf) == SC_SOCK_ERROR);
+    fail_malloc = false;
+
+    assert(sc_conn_term(&c) == 0);
+    assert(sc_sock_term(&client) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+
+#else
+void fail_test(void)
+{
+}
+#endif
+
+void test_write(void)
+{
+    int rc;
+    uint64_t pos = 0, written = 0, received = 0;
+    unsigned char data[4096];
+    struct sc_conn c;
+    struct sc_sock client;
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    conn_open(&c, &client, NULL);
+    sc_conn_set_watermark(&c, 16 * 1024, 64 * 1024);
+    assert(sc_conn_start(&c, 0) == 0);
+    assert(c.sock.fdt.op == SC_SOCK_READ);
+
+    // Small write goes out directly.
+    for (int i = 0; i < 100; i++) {
+        data[i] = (unsigned char) ((written + i) % 251);
+    }
+    assert(sc_conn_write(&c, data, 100) == 0);
+    written += 100;
+    assert(sc_conn_queued(&c) == 0);
+    assert(c.sock.fdt.op == SC_SOCK_READ);
+
+    // Slow client, write until reading is paused.
+    while (!sc_conn_paused(&c)) {
+        for (size_t i = 0; i < sizeof(data); i++) {
+            data[i] = (unsigned char) ((written + i) % 251);
+        }
+        assert(sc_conn_write(&c, data, sizeof(data)) == 0);
+        written += sizeof(data);
+        assert(written < 512 * 1024 * 1024);
+    }
+
+    assert(sc_conn_queued(&c) >= 64 * 1024);
+    assert(c.sock.fdt.op == SC_SOCK_WRITE);
+
+    // Client drains, queue is flushed on write events.
+    while (received < written) {
+        received += client_drain(&client, &pos);
+
+        rc = sc_sock_poll_wait(&poll, 10);
+        for (int i = 0; i < rc; i++) {
+            assert(sc_sock_poll_data(&poll, i) == &c);
+            if (sc_sock_poll_event(&poll, i) & SC_SOCK_WRITE) {
+                rc = sc_conn_flush(&c);
+                assert(rc == 0 || rc == SC_SOCK_WANT_WRITE);
+                break;
+            }
+        }
+    }
+
+    assert(received == written);
+    assert(sc_conn_queued(&c) == 0);
+    assert(!sc_conn_paused(&c));
+    assert(c.sock.fdt.op == SC_SOCK_READ);
+    assert(sc_conn_flush(&c) == 0);
+
+    assert(sc_conn_term(&c) == 0);
+    assert(sc_sock_term(&client) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+
+void test_write_buf(void)
+{
+    int rc;
+    char tmp[64];
+    uint64_t pos = 0, received = 0;
+    unsigned char data[1000];
+    struct sc_conn c;
+    struct sc_sock client;
+    struct sc_buf buf;
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    conn_open(&c, &client, NULL);
+    assert(sc_conn_start(&c, 0) == 0);
+
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (unsigned char) (i % 251);
+    }
+
+    // Empty buffer
+    assert(sc_buf_init(&buf, 100));
+    assert(sc_conn_write_buf(&c, &buf) == 0);
+    sc_buf_term(&buf);
+
+    assert(sc_buf_init(&buf, 100));
+    sc_buf_put_raw(&buf, data, 500);
+    assert(sc_conn_write_buf(&c, &buf) == 0);
+    assert(sc_buf_size(&buf) == 0);
+    sc_buf_term(&buf);
+
+    // Reference buffers are not modified by later writes.
+    buf = sc_buf_wrap(data + 500, 500, SC_BUF_REF | SC_BUF_DATA);
+    assert(sc_conn_write_buf(&c, &buf) == 0);
+
+    while (received < sizeof(data)) {
+        received += client_drain(&client, &pos);
+    }
+    assert(received == sizeof(data));
+
+    // Read side
+    assert(sc_sock_send(&client, "ping", 4, 0) == 4);
+    do {
+        rc = sc_conn_recv(&c, tmp, sizeof(tmp));
+    } while (rc == SC_SOCK_WANT_READ);
+    assert(rc == 4 && memcmp(tmp, "ping", 4) == 0);
+
+    assert(sc_sock_term(&client) == 0);
+    do {
+        rc = sc_conn_recv(&c, tmp, sizeof(tmp));
+    } while (rc == SC_SOCK_WANT_READ);
+    assert(rc == SC_SOCK_ERROR);
+
+    assert(sc_conn_term(&c) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+
+static int expired;
+
+static void on_timeout(void *arg, uint64_t timeout, uint64_t type, void *data)
+{
+    (void) arg;
+    (void) timeout;
+
+    assert(type == SC_CONN_TIMER);
+    sc_conn_timeout(data);
+    expired++;
+}
+
+void test_idle(void)
+{
+    int rc;
+    char tmp[64];
+    struct sc_conn c;
+    struct sc_sock client;
+    struct sc_timer timer;
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    assert(sc_timer_init_tick(&timer, 0, 1));
+    conn_open(&c, &client, &timer);
+    assert(sc_conn_start(&c, 100) == 0);
+
+    expired = 0;
+    sc_timer_timeout(&timer, 50, NULL, on_timeout);
+    assert(expired == 0);
+
+    // Activity postpones the timeout.
+    assert(sc_sock_send(&client, "ping", 4, 0) == 4);
+    do {
+        rc = sc_conn_recv(&c, tmp, sizeof(tmp));
+    } while (rc == SC_SOCK_WANT_READ);
+    assert(rc == 4);
+
+    sc_timer_timeout(&timer, 120, NULL, on_timeout);
+    assert(expired == 0);
+    assert(sc_conn_write(&c, "pong", 4) == 0);
+    sc_timer_timeout(&timer, 200, NULL, on_timeout);
+    assert(expired == 0);
+    sc_timer_timeout(&timer, 221, NULL, on_timeout);
+    assert(expired == 1);
+    assert(c.timer_id == SC_TIMER_INVALID);
+
+    assert(sc_conn_term(&c) == 0);
+    assert(sc_sock_term(&client) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+
+    // Cancelled on term.
+    conn_open(&c, &client, &timer);
+    assert(sc_sock_poll_init(&poll) == 0);
+    assert(sc_conn_start(&c, 100) == 0);
+    assert(sc_conn_term(&c) == 0);
+    sc_timer_timeout(&timer, 1000, NULL, on_timeout);
+    assert(expired == 1);
+
+    assert(sc_sock_term(&client) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+    sc_timer_term(&timer);
+}
+
+int main(void)
+{
+    fail_test();
+    test_write();
+    test_write_buf();
+    test_idle();
+
+    return 0;
+}
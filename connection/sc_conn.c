@@ -0,0 +1,372 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "sc_conn.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Queued output segment.
+struct sc_conn_seg
+{
+    struct sc_list list;
+    struct sc_buf buf;
+    bool copy; // Created by sc_conn_write(), later writes can append.
+};
+
+void sc_conn_init(struct sc_conn *c, struct sc_sock_poll *poll,
+                  struct sc_timer *timer, void *data)
+{
+    c->poll = poll;
+    c->timer = timer;
+    c->data = data;
+    c->queued = 0;
+    c->high = SC_CONN_HIGH;
+    c->low = SC_CONN_LOW;
+    c->paused = false;
+    c->idle = 0;
+    c->timer_id = SC_TIMER_INVALID;
+    c->err[0] = '\0';
+
+    sc_list_init(&c->out);
+}
+
+static void sc_conn_seg_destroy(struct sc_conn_seg *seg)
+{
+    sc_buf_term(&seg->buf);
+    sc_conn_free(seg);
+}
+
+int sc_conn_term(struct sc_conn *c)
+{
+    struct sc_list *elem, *tmp;
+
+    if (c->timer != NULL) {
+        sc_timer_cancel(c->timer, &c->timer_id);
+    }
+
+    sc_list_foreach_safe (&c->out, tmp, elem) {
+        sc_list_del(&c->out, elem);
+        sc_conn_seg_destroy(sc_list_entry(elem, struct sc_conn_seg, list));
+    }
+
+    c->queued = 0;
+
+    if (c->sock.fdt.op != SC_SOCK_NONE) {
+        sc_sock_poll_del(c->poll, &c->sock.fdt, SC_SOCK_READ | SC_SOCK_WRITE, c->data);
+    }
+
+    return sc_sock_term(&c->sock);
+}
+
+void sc_conn_set_watermark(struct sc_conn *c, uint64_t low, uint64_t high)
+{
+    c->low = low;
+    c->high = high;
+}
+
+static int sc_conn_poll_err(struct sc_conn *c)
+{
+    snprintf(c->err, sizeof(c->err), "%s", sc_sock_poll_err(c->poll));
+    return SC_SOCK_ERROR;
+}
+
+static int sc_conn_sock_err(struct sc_conn *c)
+{
+    snprintf(c->err, sizeof(c->err), "%s", sc_sock_error(&c->sock));
+    return SC_SOCK_ERROR;
+}
+
+static int sc_conn_oom(struct sc_conn *c)
+{
+    snprintf(c->err, sizeof(c->err), "Out of memory.");
+    return SC_SOCK_ERROR;
+}
+
+// Postpones idle timeout, O(1) if the timer is pending.
+static int sc_conn_touch(struct sc_conn *c)
+{
+    if (c->idle == 0) {
+        return 0;
+    }
+
+    if (!sc_timer_reschedule(c->timer, &c->timer_id, c->idle)) {
+        c->timer_id = sc_timer_add(c->timer, c->idle, SC_CONN_TIMER, c->data);
+        if (c->timer_id == SC_TIMER_INVALID) {
+            return sc_conn_oom(c);
+        }
+    }
+
+    return 0;
+}
+
+int sc_conn_start(struct sc_conn *c, uint64_t idle)
+{
+    int rc;
+
+    c->idle = c->timer != NULL ? idle : 0;
+
+    rc = sc_sock_poll_add(c->poll, &c->sock.fdt, SC_SOCK_READ, c->data);
+    if (rc != 0) {
+        return sc_conn_poll_err(c);
+    }
+
+    return sc_conn_touch(c);
+}
+
+// Registration changes only when the queue becomes empty/non-empty or crosses
+// a watermark, sc_sock_poll_add()/del() are no-ops otherwise.
+static int sc_conn_update(struct sc_conn *c)
+{
+    int rc = 0;
+    struct sc_sock_fd *fdt = &c->sock.fdt;
+
+    if (c->queued > 0 && !(fdt->op & SC_SOCK_WRITE)) {
+        rc |= sc_sock_poll_add(c->poll, fdt, SC_SOCK_WRITE, c->data);
+    } else if (c->queued == 0 && (fdt->op & SC_SOCK_WRITE)) {
+        rc |= sc_sock_poll_del(c->poll, fdt, SC_SOCK_WRITE, c->data);
+    }
+
+    if (!c->paused && c->queued >= c->high) {
+        c->paused = true;
+        rc |= sc_sock_poll_del(c->poll, fdt, SC_SOCK_READ, c->data);
+    } else if (c->paused && c->queued <= c->low) {
+        c->paused = false;
+        rc |= sc_sock_poll_add(c->poll, fdt, SC_SOCK_READ, c->data);
+    }
+
+    return rc != 0 ? sc_conn_poll_err(c) : 0;
+}
+
+static struct sc_conn_seg *sc_conn_seg_create(uint32_t cap)
+{
+    struct sc_conn_seg *seg;
+
+    seg = sc_conn_malloc(sizeof(*seg));
+    if (seg == NULL) {
+        return NULL;
+    }
+
+    if (!sc_buf_init(&seg->buf, cap)) {
+        sc_conn_free(seg);
+        return NULL;
+    }
+
+    seg->copy = true;
+
+    return seg;
+}
+
+// Copies into the free space of the last segment, then into a new segment.
+static int sc_conn_queue(struct sc_conn *c, const char *data, uint32_t len)
+{
+    uint32_t n;
+    struct sc_conn_seg *seg;
+    struct sc_list *tail = sc_list_tail(&c->out);
+
+    seg = tail != NULL ? sc_list_entry(tail, struct sc_conn_seg, list) : NULL;
+    if (seg != NULL && seg->copy) {
+        n = sc_buf_cap(&seg->buf) - sc_buf_wpos(&seg->buf);
+        n = n < len ? n : len;
+
+        memcpy(sc_buf_wbuf(&seg->buf), data, n);
+        sc_buf_mark_write(&seg->buf, n);
+        c->queued += n;
+        data += n;
+        len -= n;
+    }
+
+    if (len == 0) {
+        return 0;
+    }
+
+    seg = sc_conn_seg_create(len > SC_CONN_SEG ? len : SC_CONN_SEG);
+    if (seg == NULL) {
+        return sc_conn_oom(c);
+    }
+
+    memcpy(sc_buf_wbuf(&seg->buf), data, len);
+    sc_buf_mark_write(&seg->buf, len);
+    sc_list_add_tail(&c->out, &seg->list);
+    c->queued += len;
+
+    return 0;
+}
+
+int sc_conn_write(struct sc_conn *c, const void *data, uint32_t len)
+{
+    int rc;
+    const char *p = data;
+
+    // Nothing is queued, try to send without copying.
+    if (c->queued == 0 && len > 0) {
+        rc = sc_sock_send(&c->sock, (char *) p, (int) len, 0);
+        if (rc == SC_SOCK_ERROR) {
+            return sc_conn_sock_err(c);
+        }
+
+        if (rc > 0) {
+            p += rc;
+            len -= (uint32_t) rc;
+
+            rc = sc_conn_touch(c);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+    }
+
+    if (len == 0) {
+        return 0;
+    }
+
+    rc = sc_conn_queue(c, p, len);
+    if (rc != 0) {
+        return rc;
+    }
+
+    return sc_conn_update(c);
+}
+
+int sc_conn_write_buf(struct sc_conn *c, struct sc_buf *buf)
+{
+    uint32_t size = sc_buf_size(buf);
+    struct sc_conn_seg *seg;
+
+    if (size == 0) {
+        sc_buf_term(buf);
+        *buf = sc_buf_wrap(NULL, 0, SC_BUF_REF);
+        return 0;
+    }
+
+    seg = sc_conn_malloc(sizeof(*seg));
+    if (seg == NULL) {
+        return sc_conn_oom(c);
+    }
+
+    seg->buf = *buf;
+    seg->copy = false;
+    *buf = sc_buf_wrap(NULL, 0, SC_BUF_REF);
+
+    sc_list_add_tail(&c->out, &seg->list);
+    c->queued += size;
+
+    return sc_conn_flush(c);
+}
+
+int sc_conn_flush(struct sc_conn *c)
+{
+    int n, rc;
+    uint32_t left, len;
+    struct sc_list *elem, *tmp;
+    struct sc_conn_seg *seg;
+    sc_sock_iov iov[SC_CONN_IOV];
+
+    while (c->queued > 0) {
+        n = 0;
+        sc_list_foreach (&c->out, elem) {
+            seg = sc_list_entry(elem, struct sc_conn_seg, list);
+            sc_sock_iov_set(&iov[n], sc_buf_rbuf(&seg->buf),
+                            sc_buf_size(&seg->buf));
+            if (++n == SC_CONN_IOV) {
+                break;
+            }
+        }
+
+        rc = sc_sock_sendv(&c->sock, iov, n, 0);
+        if (rc == SC_SOCK_ERROR) {
+            return sc_conn_sock_err(c);
+        }
+
+        if (rc <= 0) {
+            break;
+        }
+
+        left = (uint32_t) rc;
+        c->queued -= left;
+
+        sc_list_foreach_safe (&c->out, tmp, elem) {
+            seg = sc_list_entry(elem, struct sc_conn_seg, list);
+            len = sc_buf_size(&seg->buf);
+
+            if (len > left) {
+                sc_buf_mark_read(&seg->buf, left);
+                break;
+            }
+
+            left -= len;
+            sc_list_del(&c->out, elem);
+            sc_conn_seg_destroy(seg);
+        }
+
+        rc = sc_conn_touch(c);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    rc = sc_conn_update(c);
+    if (rc != 0) {
+        return rc;
+    }
+
+    return c->queued > 0 ? SC_SOCK_WANT_WRITE : 0;
+}
+
+int sc_conn_recv(struct sc_conn *c, void *buf, int len)
+{
+    int rc;
+
+    rc = sc_sock_recv(&c->sock, buf, len, 0);
+    if (rc > 0 && sc_conn_touch(c) != 0) {
+        return SC_SOCK_ERROR;
+    }
+
+    if (rc == SC_SOCK_ERROR) {
+        sc_conn_sock_err(c);
+    }
+
+    return rc;
+}
+
+void sc_conn_timeout(struct sc_conn *c)
+{
+    c->timer_id = SC_TIMER_INVALID;
+}
+
+uint64_t sc_conn_queued(struct sc_conn *c)
+{
+    return c->queued;
+}
+
+bool sc_conn_paused(struct sc_conn *c)
+{
+    return c->paused;
+}
+
+const char *sc_conn_err(struct sc_conn *c)
+{
+    return c->err;
+}
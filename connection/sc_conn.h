@@ -0,0 +1,213 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SC_CONN_H
+#define SC_CONN_H
+
+#include "sc_buf.h"
+#include "sc_list.h"
+#include "sc_sock.h"
+#include "sc_timer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#else
+    #define sc_conn_malloc malloc
+    #define sc_conn_free   free
+#endif
+
+// Default watermarks of queued outgoing bytes, see sc_conn_set_watermark().
+#ifndef SC_CONN_HIGH
+    #define SC_CONN_HIGH (1024 * 1024)
+#endif
+
+#ifndef SC_CONN_LOW
+    #define SC_CONN_LOW (256 * 1024)
+#endif
+
+// Small writes are coalesced into segments of this size.
+#ifndef SC_CONN_SEG
+    #define SC_CONN_SEG (16 * 1024)
+#endif
+
+// Max segments sent with a single vectored send.
+#ifndef SC_CONN_IOV
+    #define SC_CONN_IOV 64
+#endif
+
+// Timer type of idle timeouts, see sc_conn_start().
+#ifndef SC_CONN_TIMER
+    #define SC_CONN_TIMER 0x5cc0
+#endif
+
+/**
+ * Connection with an outgoing buffer queue.
+ *
+ * Writes are sent right away while the queue is empty, what the socket does
+ * not accept is queued in a list of sc_buf segments. Queued segments are sent
+ * with vectored sends by sc_conn_flush() on SC_SOCK_WRITE events. Write
+ * interest is registered only while the queue is not empty.
+ *
+ * When queued bytes exceed the high watermark, read interest is removed, so a
+ * slow client stops producing requests, e.g. responses, until the queue drains
+ * below the low watermark. Poll registration changes only on these
+ * transitions.
+ *
+ * Optional idle timeout is a single timer per connection, activity postpones
+ * it with sc_timer_reschedule() which is O(1).
+ *
+ * Not thread-safe, a connection belongs to the thread of its poll.
+ */
+struct sc_conn
+{
+    struct sc_sock sock;
+    struct sc_sock_poll *poll;
+    struct sc_timer *timer;
+    void *data;
+
+    struct sc_list out;
+    uint64_t queued;
+    uint64_t high;
+    uint64_t low;
+    bool paused;
+
+    uint64_t idle;
+    uint64_t timer_id;
+    char err[64];
+};
+
+/**
+ * Initialize connection, 'sock' must be initialized separately, e.g. with
+ * sc_sock_accept(&listener, &conn.sock) or sc_sock_init() and
+ * sc_sock_connect(). Socket should be non-blocking.
+ *
+ * @param c     conn
+ * @param poll  poll, connection registers its socket with 'data'.
+ * @param timer timer for idle timeouts, can be NULL.
+ * @param data  user data for poll events and the timer.
+ */
+void sc_conn_init(struct sc_conn *c, struct sc_sock_poll *poll,
+                  struct sc_timer *timer, void *data);
+
+/**
+ * Remove from poll, cancel idle timer, release queued buffers and close the
+ * socket.
+ *
+ * @param c conn
+ * @return  '0' on success, negative value on failure.
+ */
+int sc_conn_term(struct sc_conn *c);
+
+/**
+ * Set watermarks, defaults are SC_CONN_HIGH and SC_CONN_LOW.
+ *
+ * @param c    conn
+ * @param low  reading is resumed when queued bytes drop to 'low'.
+ * @param high reading is stopped when queued bytes reach 'high'.
+ */
+void sc_conn_set_watermark(struct sc_conn *c, uint64_t low, uint64_t high);
+
+/**
+ * Register read interest and start idle timer.
+ *
+ * Timer is added with type SC_CONN_TIMER and 'data'. When it expires, call
+ * sc_conn_timeout() from the timer callback and close the connection.
+ *
+ * @param c    conn
+ * @param idle idle timeout in timer's unit, '0' to disable.
+ * @return     '0' on success, negative value on failure, call sc_conn_err().
+ */
+int sc_conn_start(struct sc_conn *c, uint64_t idle);
+
+/**
+ * Send 'len' bytes, data that can't be sent right away is copied to the
+ * queue, so 'data' can be reused after the call.
+ *
+ * @param c    conn
+ * @param data data
+ * @param len  len
+ * @return     '0' on success, negative value on socket error or out of
+ *             memory, call sc_conn_err().
+ */
+int sc_conn_write(struct sc_conn *c, const void *data, uint32_t len);
+
+/**
+ * Queue 'buf' without copying, unread part of 'buf' is moved into the queue,
+ * 'buf' is left empty.
+ *
+ * @param c   conn
+ * @param buf buffer
+ * @return    '0' on success, negative value on socket error or out of
+ *            memory, call sc_conn_err().
+ */
+int sc_conn_write_buf(struct sc_conn *c, struct sc_buf *buf);
+
+/**
+ * Send queued data, call on SC_SOCK_WRITE events.
+ *
+ * @param c conn
+ * @return  '0' if the queue is empty, SC_SOCK_WANT_WRITE if data is left in
+ *          the queue, SC_SOCK_ERROR on error.
+ */
+int sc_conn_flush(struct sc_conn *c);
+
+/**
+ * Receive, same as sc_sock_recv(), postpones idle timeout on success.
+ *
+ * @param c   conn
+ * @param buf buf
+ * @param len len
+ * @return    same as sc_sock_recv()
+ */
+int sc_conn_recv(struct sc_conn *c, void *buf, int len);
+
+/**
+ * Call from the timer callback for SC_CONN_TIMER timers.
+ * @param c conn
+ */
+void sc_conn_timeout(struct sc_conn *c);
+
+/**
+ * @param c conn
+ * @return  queued outgoing bytes
+ */
+uint64_t sc_conn_queued(struct sc_conn *c);
+
+/**
+ * @param c conn
+ * @return  'true' if reading is stopped because of the high watermark.
+ */
+bool sc_conn_paused(struct sc_conn *c);
+
+/**
+ * @param c conn
+ * @return  last error string
+ */
+const char *sc_conn_err(struct sc_conn *c);
+
+#endif
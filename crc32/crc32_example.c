@@ -18,5 +18,15 @@ int main()
     crc = sc_crc32(0, buf, sizeof(buf));
     printf("crc : %u \n", crc);
 
+    // Combine crc of two parts
+    crc = sc_crc32_combine(sc_crc32(0, buf, 10),
+                           sc_crc32(0, buf + 10, sizeof(buf) - 10),
+                           sizeof(buf) - 10);
+    printf("crc : %u \n", crc);
+
+    // Use 4 threads, useful for large buffers only
+    crc = sc_crc32_parallel(0, buf, sizeof(buf), 4);
+    printf("crc : %u \n", crc);
+
     return 0;
 }
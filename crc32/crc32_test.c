@@ -1,17 +1,32 @@
 #include "sc_crc32.h"
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
-int main(int argc, char *argv[])
+#ifdef SC_CRC32_TEST
+void sc_crc32_test_init(int level);
+#endif
+
+static uint32_t crc32_bitwise(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int k = 0; k < 8; k++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+        }
+    }
+
+    return ~crc;
+}
+
+void test_basic()
 {
-    (void) argc;
-    (void) argv;
-    
     uint32_t crc1, crc2, crc3;
     uint8_t buf[128] = {1, 1, 2, 3};
-    uint8_t buf2[4096 * 8] = {2 , 5, 6 ,5};
-
-    sc_crc32_init();
+    static uint8_t buf2[4096 * 8] = {2 , 5, 6 ,5};
 
     crc1 = sc_crc32(0, buf, 100);
     crc2 = sc_crc32(crc1, buf + 100, 28);
@@ -24,4 +39,105 @@ int main(int argc, char *argv[])
     crc3 = sc_crc32(0, buf2, 4096 * 8);
 
     assert(crc2 == crc3);
+
+    assert(sc_crc32(0, (const uint8_t *) "123456789", 9) == 0xe3069283);
+    assert(sc_crc32(0, NULL, 0) == 0);
+}
+
+void test_random()
+{
+    uint32_t seed = 1234;
+    const uint32_t size = 32 * 1024;
+    uint8_t *buf = malloc(size + 16);
+
+    assert(buf != NULL);
+
+    for (uint32_t i = 0; i < size + 16; i++) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = (uint8_t) (seed >> 16);
+    }
+
+    // All lengths around the block sizes of each implementation, unaligned.
+    for (uint32_t len = 0; len < 2200; len++) {
+        uint32_t off = len % 16;
+
+        assert(sc_crc32(len, buf + off, len) ==
+               crc32_bitwise(len, buf + off, len));
+    }
+
+    for (uint32_t len = 2200; len <= size; len = len * 3 / 2 + 7) {
+        assert(sc_crc32(7, buf + 3, len) == crc32_bitwise(7, buf + 3, len));
+    }
+
+    assert(sc_crc32(0, buf, size) == crc32_bitwise(0, buf, size));
+
+    free(buf);
+}
+
+void test_combine()
+{
+    uint32_t crc1, crc2;
+    uint8_t buf[4096];
+
+    for (uint32_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (uint8_t) (i * 13 + 7);
+    }
+
+    for (uint32_t split = 0; split <= sizeof(buf); split += 37) {
+        crc1 = sc_crc32(5, buf, split);
+        crc2 = sc_crc32(0, buf + split, sizeof(buf) - split);
+        assert(sc_crc32_combine(crc1, crc2, sizeof(buf) - split) ==
+               sc_crc32(5, buf, sizeof(buf)));
+    }
+
+    assert(sc_crc32_combine(100, 0, 0) == 100);
+}
+
+void test_parallel()
+{
+    uint32_t crc, seed = 99;
+    const uint64_t size = 9 * SC_CRC32_PART_MIN + 1000;
+    uint8_t *buf = malloc(size);
+
+    assert(buf != NULL);
+
+    for (uint64_t i = 0; i < size; i++) {
+        seed = seed * 1103515245 + 12345;
+        buf[i] = (uint8_t) (seed >> 16);
+    }
+
+    crc = sc_crc32(3, buf, (uint32_t) size);
+
+    assert(sc_crc32_parallel(3, buf, size, 0) == crc);
+    assert(sc_crc32_parallel(3, buf, size, 1) == crc);
+    assert(sc_crc32_parallel(3, buf, size, 2) == crc);
+    assert(sc_crc32_parallel(3, buf, size, 7) == crc);
+    assert(sc_crc32_parallel(3, buf, size, 1000) == crc);
+    assert(sc_crc32_parallel(3, buf, 100, 4) == sc_crc32(3, buf, 100));
+    assert(sc_crc32_parallel(3, buf, 0, 4) == 3);
+
+    free(buf);
+}
+
+int main(int argc, char *argv[])
+{
+    (void) argc;
+    (void) argv;
+
+    sc_crc32_init();
+    test_basic();
+    test_random();
+    test_combine();
+    test_parallel();
+
+#ifdef SC_CRC32_TEST
+    for (int level = 0; level < 4; level++) {
+        sc_crc32_test_init(level);
+        test_basic();
+        test_random();
+        test_combine();
+    }
+#endif
+
+    return 0;
 }
@@ -24,25 +24,79 @@
   madler@alumni.caltech.edu
  */
 
-/* Use hardware CRC instruction on Intel SSE 4.2 processors.  This computes a
-   CRC-32C, *not* the CRC-32 used by Ethernet and zip, gzip, etc.  A software
-   version is provided as a fall-back, as well as for speed comparisons. */
+/* Use hardware CRC instruction on Intel SSE 4.2 and ARMv8 processors.  This
+   computes a CRC-32C, *not* the CRC-32 used by Ethernet and zip, gzip, etc.  A
+   software version is provided as a fall-back, as well as for speed
+   comparisons.  The implementation is selected at runtime by
+   sc_crc32_init(). */
 
 /* Version history:
    1.0  10 Feb 2013  First version
    1.1   1 Aug 2013  Correct comments on why three crc instructions in parallel
    1.2         2020  Added gcc intrinsics, fixed alignment issues.
+   1.3         2026  Runtime dispatch, ARMv8 crc32 instructions and
+                     PCLMULQDQ/VPCLMULQDQ folding for large buffers.
  */
 
 #include "sc_crc32.h"
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+    #include <process.h>
+#else
+    #include <pthread.h>
+#endif
 
 /* CRC-32C (iSCSI) polynomial in reversed bit order. */
 #define CRC32_POLY 0x82f63b78
 
-#ifdef HAVE_CRC32C
-#include <x86intrin.h>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #define CRC32_X86
+    #include <immintrin.h>
+
+    #define CRC32_TARGET(t) __attribute__((target(t)))
+
+    /* VPCLMULQDQ intrinsics need gcc 9 or clang 8. */
+    #if defined(__clang__) ? __clang_major__ >= 8 : __GNUC__ >= 9
+        #define CRC32_X86_VPCLMUL
+    #endif
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+    #define CRC32_ARM
+    #include <arm_acle.h>
+
+    #if defined(__linux__)
+        #include <sys/auxv.h>
+        #ifndef HWCAP_CRC32
+            #define HWCAP_CRC32 (1 << 7)
+        #endif
+    #endif
+
+    #if defined(__clang__)
+        #define CRC32_TARGET_CRC __attribute__((target("crc")))
+    #else
+        #define CRC32_TARGET_CRC __attribute__((target("+crc")))
+    #endif
+#endif
+
+/* Implementation levels, sc_crc32_init() picks the highest one supported by
+   the cpu. */
+enum crc32_level
+{
+    CRC32_LEVEL_SW,
+    CRC32_LEVEL_HW,
+    CRC32_LEVEL_PCLMUL,
+    CRC32_LEVEL_VPCLMUL,
+};
+
+static uint32_t crc32_sw(uint32_t crci, const void *buf, size_t len);
+
+static uint32_t (*crc32_func)(uint32_t, const void *, size_t) = crc32_sw;
+
+#if defined(CRC32_X86) || defined(CRC32_ARM)
 
 /* Multiply a matrix times a vector over the Galois field of two elements,
    GF(2).  Each element is a bit in an unsigned integer.  mat must have at
@@ -154,7 +208,10 @@ static void crc32_init_hw(void)
     crc32_zeros(crc32c_short, CRC32_SHORT);
 }
 
-uint32_t crc32_hw(uint32_t crc, const uint8_t *buf, uint32_t len)
+#ifdef CRC32_X86
+
+CRC32_TARGET("sse4.2")
+static uint32_t crc32_hw(uint32_t crc, const void *buf, size_t len)
 {
     const unsigned char *next = buf;
     const unsigned char *end;
@@ -252,7 +309,309 @@ uint32_t crc32_hw(uint32_t crc, const uint8_t *buf, uint32_t len)
     return (uint32_t) crc0 ^ 0xffffffff;
 }
 
+/* Folding constants for PCLMULQDQ.  A 128-bit lane is moved forward by 'd'
+   bits by multiplying its two halves with x^(d+64) and x^d modulo the
+   polynomial, both constants are pre-divided by x as the carry-less product of
+   two reflected 64-bit values is one bit short. */
+static uint64_t crc32_k128[2];
+static uint64_t crc32_k256[2];
+static uint64_t crc32_k384[2];
+static uint64_t crc32_k512[2];
+static uint64_t crc32_k2048[2];
+
+/* x^n modulo the polynomial, reflected. */
+static uint32_t crc32_xpow(size_t n)
+{
+    uint32_t r = 0x80000000;
+
+    while (n--) {
+        r = r & 1 ? (r >> 1) ^ CRC32_POLY : r >> 1;
+    }
+
+    return r;
+}
+
+static void crc32_fold_k(uint64_t k[2], size_t d)
+{
+    k[0] = (uint64_t) crc32_xpow(d + 63) << 32;
+    k[1] = (uint64_t) crc32_xpow(d - 1) << 32;
+}
+
+static void crc32_init_fold(void)
+{
+    crc32_fold_k(crc32_k128, 128);
+    crc32_fold_k(crc32_k256, 256);
+    crc32_fold_k(crc32_k384, 384);
+    crc32_fold_k(crc32_k512, 512);
+    crc32_fold_k(crc32_k2048, 2048);
+}
+
+CRC32_TARGET("sse4.2,pclmul")
+static inline __m128i crc32_fold(__m128i x, const uint64_t k[2])
+{
+    __m128i m = _mm_set_epi64x((long long) k[1], (long long) k[0]);
+
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, m, 0x00),
+                         _mm_clmulepi64_si128(x, m, 0x11));
+}
+
+/* Fold remaining 16-byte blocks into x, then reduce x and the trailing bytes
+   with the crc32 instruction. */
+CRC32_TARGET("sse4.2,pclmul")
+static uint32_t crc32_fold_end(__m128i x, const unsigned char *next,
+                               size_t len)
+{
+    uint64_t crc0;
+
+    while (len >= 16) {
+        x = crc32_fold(x, crc32_k128);
+        x = _mm_xor_si128(x, _mm_loadu_si128((const __m128i *) next));
+        next += 16;
+        len -= 16;
+    }
+
+    crc0 = _mm_crc32_u64(0, (uint64_t) _mm_cvtsi128_si64(x));
+    crc0 = _mm_crc32_u64(crc0, (uint64_t) _mm_extract_epi64(x, 1));
+
+    return crc32_hw((uint32_t) crc0 ^ 0xffffffff, next, len);
+}
+
+/* Four 128-bit lanes in parallel, 64 bytes per iteration. */
+CRC32_TARGET("sse4.2,pclmul")
+static uint32_t crc32_pclmul(uint32_t crc, const void *buf, size_t len)
+{
+    const unsigned char *next = buf;
+    __m128i x0, x1, x2, x3;
+
+    if (len < 128) {
+        return crc32_hw(crc, buf, len);
+    }
+
+    x0 = _mm_loadu_si128((const __m128i *) next);
+    x1 = _mm_loadu_si128((const __m128i *) (next + 16));
+    x2 = _mm_loadu_si128((const __m128i *) (next + 32));
+    x3 = _mm_loadu_si128((const __m128i *) (next + 48));
+
+    /* pre-processed crc goes into the first four bytes */
+    x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128((int) (crc ^ 0xffffffff)));
+
+    next += 64;
+    len -= 64;
+
+    while (len >= 64) {
+        x0 = _mm_xor_si128(crc32_fold(x0, crc32_k512),
+                           _mm_loadu_si128((const __m128i *) next));
+        x1 = _mm_xor_si128(crc32_fold(x1, crc32_k512),
+                           _mm_loadu_si128((const __m128i *) (next + 16)));
+        x2 = _mm_xor_si128(crc32_fold(x2, crc32_k512),
+                           _mm_loadu_si128((const __m128i *) (next + 32)));
+        x3 = _mm_xor_si128(crc32_fold(x3, crc32_k512),
+                           _mm_loadu_si128((const __m128i *) (next + 48)));
+        next += 64;
+        len -= 64;
+    }
+
+    x0 = _mm_xor_si128(crc32_fold(x0, crc32_k384), crc32_fold(x1, crc32_k256));
+    x0 = _mm_xor_si128(x0, crc32_fold(x2, crc32_k128));
+    x0 = _mm_xor_si128(x0, x3);
+
+    return crc32_fold_end(x0, next, len);
+}
+
+#ifdef CRC32_X86_VPCLMUL
+
+CRC32_TARGET("sse4.2,pclmul,avx512f,vpclmulqdq")
+static inline __m512i crc32_fold512(__m512i z, const uint64_t k[2])
+{
+    __m512i m = _mm512_broadcast_i32x4(
+            _mm_set_epi64x((long long) k[1], (long long) k[0]));
+
+    return _mm512_xor_si512(_mm512_clmulepi64_epi128(z, m, 0x00),
+                            _mm512_clmulepi64_epi128(z, m, 0x11));
+}
+
+/* Sixteen 128-bit lanes in four 512-bit registers, 256 bytes per
+   iteration. */
+CRC32_TARGET("sse4.2,pclmul,avx512f,vpclmulqdq")
+static uint32_t crc32_vpclmul(uint32_t crc, const void *buf, size_t len)
+{
+    const unsigned char *next = buf;
+    __m128i x;
+    __m512i z0, z1, z2, z3;
+
+    if (len < 1024) {
+        return crc32_pclmul(crc, buf, len);
+    }
+
+    z0 = _mm512_loadu_si512((const void *) next);
+    z1 = _mm512_loadu_si512((const void *) (next + 64));
+    z2 = _mm512_loadu_si512((const void *) (next + 128));
+    z3 = _mm512_loadu_si512((const void *) (next + 192));
+
+    /* pre-processed crc goes into the first four bytes */
+    x = _mm_cvtsi32_si128((int) (crc ^ 0xffffffff));
+    z0 = _mm512_xor_si512(z0, _mm512_inserti32x4(_mm512_setzero_si512(), x, 0));
+
+    next += 256;
+    len -= 256;
+
+    while (len >= 256) {
+        z0 = _mm512_xor_si512(crc32_fold512(z0, crc32_k2048),
+                              _mm512_loadu_si512((const void *) next));
+        z1 = _mm512_xor_si512(crc32_fold512(z1, crc32_k2048),
+                              _mm512_loadu_si512((const void *) (next + 64)));
+        z2 = _mm512_xor_si512(crc32_fold512(z2, crc32_k2048),
+                              _mm512_loadu_si512((const void *) (next + 128)));
+        z3 = _mm512_xor_si512(crc32_fold512(z3, crc32_k2048),
+                              _mm512_loadu_si512((const void *) (next + 192)));
+        next += 256;
+        len -= 256;
+    }
+
+    z0 = _mm512_xor_si512(crc32_fold512(z0, crc32_k512), z1);
+    z0 = _mm512_xor_si512(crc32_fold512(z0, crc32_k512), z2);
+    z0 = _mm512_xor_si512(crc32_fold512(z0, crc32_k512), z3);
+
+    /* four lanes of the last register into one */
+    x = _mm_xor_si128(crc32_fold(_mm512_extracti32x4_epi32(z0, 0), crc32_k384),
+                      crc32_fold(_mm512_extracti32x4_epi32(z0, 1), crc32_k256));
+    x = _mm_xor_si128(x,
+                      crc32_fold(_mm512_extracti32x4_epi32(z0, 2), crc32_k128));
+    x = _mm_xor_si128(x, _mm512_extracti32x4_epi32(z0, 3));
+
+    return crc32_fold_end(x, next, len);
+}
+
+#endif
+
+static enum crc32_level crc32_cpu(void)
+{
+    __builtin_cpu_init();
+
+    if (!__builtin_cpu_supports("sse4.2")) {
+        return CRC32_LEVEL_SW;
+    }
+
+    if (!__builtin_cpu_supports("pclmul")) {
+        return CRC32_LEVEL_HW;
+    }
+
+#ifdef CRC32_X86_VPCLMUL
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("vpclmulqdq")) {
+        return CRC32_LEVEL_VPCLMUL;
+    }
+#endif
+
+    return CRC32_LEVEL_PCLMUL;
+}
+
+#endif /* CRC32_X86 */
+
+#ifdef CRC32_ARM
+
+/* Same three-way parallel computation as the Intel version with the ARMv8
+   crc32c instructions. */
+CRC32_TARGET_CRC
+static uint32_t crc32_hw(uint32_t crc, const void *buf, size_t len)
+{
+    const unsigned char *next = buf;
+    const unsigned char *end;
+    uint32_t crc0, crc1, crc2;
+
+    crc0 = crc ^ 0xffffffff;
+
+    while (len && ((uintptr_t) next & 7) != 0) {
+        crc0 = __crc32cb(crc0, *next);
+        next++;
+        len--;
+    }
+
+    while (len >= CRC32_LONG * 3) {
+        crc1 = 0;
+        crc2 = 0;
+
+        end = next + CRC32_LONG;
+        do {
+            uint64_t a, b, c;
+
+            memcpy(&a, next, 8);
+            memcpy(&b, next + CRC32_LONG, 8);
+            memcpy(&c, next + (CRC32_LONG * 2), 8);
+
+            crc0 = __crc32cd(crc0, a);
+            crc1 = __crc32cd(crc1, b);
+            crc2 = __crc32cd(crc2, c);
+
+            next += 8;
+        } while (next < end);
+
+        crc0 = crc32_shift(crc32c_long, crc0) ^ crc1;
+        crc0 = crc32_shift(crc32c_long, crc0) ^ crc2;
+
+        next += (CRC32_LONG * 2);
+        len -= (CRC32_LONG * 3);
+    }
+
+    while (len >= CRC32_SHORT * 3) {
+        crc1 = 0;
+        crc2 = 0;
+
+        end = next + CRC32_SHORT;
+        do {
+            uint64_t a, b, c;
+
+            memcpy(&a, next, 8);
+            memcpy(&b, next + CRC32_SHORT, 8);
+            memcpy(&c, next + (CRC32_SHORT * 2), 8);
+
+            crc0 = __crc32cd(crc0, a);
+            crc1 = __crc32cd(crc1, b);
+            crc2 = __crc32cd(crc2, c);
+
+            next += 8;
+        } while (next < end);
+
+        crc0 = crc32_shift(crc32c_short, crc0) ^ crc1;
+        crc0 = crc32_shift(crc32c_short, crc0) ^ crc2;
+
+        next += (CRC32_SHORT * 2);
+        len -= (CRC32_SHORT * 3);
+    }
+
+    while (len >= 8) {
+        uint64_t a;
+
+        memcpy(&a, next, 8);
+        crc0 = __crc32cd(crc0, a);
+        next += 8;
+        len -= 8;
+    }
+
+    while (len) {
+        crc0 = __crc32cb(crc0, *next);
+        next++;
+        len--;
+    }
+
+    return crc0 ^ 0xffffffff;
+}
+
+static enum crc32_level crc32_cpu(void)
+{
+#if defined(__ARM_FEATURE_CRC32) || defined(__APPLE__)
+    return CRC32_LEVEL_HW;
+#elif defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) ? CRC32_LEVEL_HW :
+                                                 CRC32_LEVEL_SW;
 #else
+    return CRC32_LEVEL_SW;
+#endif
+}
+
+#endif /* CRC32_ARM */
+
+#endif /* CRC32_X86 || CRC32_ARM */
 
 /* Table for a quadword-at-a-time software crc. */
 static uint32_t crc32c_table[8][256];
@@ -318,22 +677,226 @@ static uint32_t crc32_sw(uint32_t crci, const void *buf, size_t len)
     return (uint32_t) crc ^ 0xffffffff;
 }
 
-#endif
-
 uint32_t sc_crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
 {
-#ifdef HAVE_CRC32C
-    return crc32_hw(crc, buf, len);
+    return crc32_func(crc, buf, len);
+}
+
+/* x^(8 * 2^n) modulo the polynomial, reflected, for shifting a crc by a
+   length given in bytes. */
+static uint32_t crc32_x2n[64];
+
+/* Multiply a and b modulo the polynomial over GF(2), reflected.  a must not
+   be zero. */
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = (uint32_t) 1 << 31;
+    uint32_t p = 0;
+
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ CRC32_POLY : b >> 1;
+    }
+
+    return p;
+}
+
+static void crc32_init_combine(void)
+{
+    uint32_t p = 0x80000000; /* x^0 */
+
+    for (int n = 0; n < 8; n++) {
+        p = p & 1 ? (p >> 1) ^ CRC32_POLY : p >> 1;
+    }
+
+    crc32_x2n[0] = p;
+    for (int n = 1; n < 64; n++) {
+        crc32_x2n[n] = crc32_multmodp(crc32_x2n[n - 1], crc32_x2n[n - 1]);
+    }
+}
+
+uint32_t sc_crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+    uint32_t p = 0x80000000; /* x^0 */
+
+    /* x^(8 * len2) modulo the polynomial, by squaring */
+    for (int n = 0; len2 != 0; n++, len2 >>= 1) {
+        if (len2 & 1) {
+            p = crc32_multmodp(crc32_x2n[n], p);
+        }
+    }
+
+    return crc32_multmodp(p, crc1) ^ crc2;
+}
+
+/* sc_crc32() for lengths over 4 GB. */
+static uint32_t crc32_long(uint32_t crc, const uint8_t *buf, uint64_t len)
+{
+    const uint32_t chunk = 1u << 30;
+
+    while (len > chunk) {
+        crc = crc32_func(crc, buf, chunk);
+        buf += chunk;
+        len -= chunk;
+    }
+
+    return crc32_func(crc, buf, (size_t) len);
+}
+
+struct crc32_part
+{
+    const uint8_t *buf;
+    uint64_t len;
+    uint32_t crc;
+    bool started;
+
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE id;
 #else
-    return crc32_sw(crc, buf, len);
+    pthread_t id;
 #endif
+};
+
+#if defined(_WIN32) || defined(_WIN64)
+
+static unsigned int __stdcall crc32_thread(void *arg)
+{
+    struct crc32_part *part = arg;
+
+    part->crc = crc32_long(0, part->buf, part->len);
+    return 0;
+}
+
+static bool crc32_thread_start(struct crc32_part *part)
+{
+    part->id = (HANDLE) _beginthreadex(NULL, 0, crc32_thread, part, 0, NULL);
+    return part->id != 0;
 }
 
-void sc_crc32_init()
+static void crc32_thread_join(struct crc32_part *part)
 {
-#ifdef HAVE_CRC32C
-    crc32_init_hw();
+    WaitForSingleObject(part->id, INFINITE);
+    CloseHandle(part->id);
+}
+
 #else
+
+static void *crc32_thread(void *arg)
+{
+    struct crc32_part *part = arg;
+
+    part->crc = crc32_long(0, part->buf, part->len);
+    return NULL;
+}
+
+static bool crc32_thread_start(struct crc32_part *part)
+{
+    return pthread_create(&part->id, NULL, crc32_thread, part) == 0;
+}
+
+static void crc32_thread_join(struct crc32_part *part)
+{
+    pthread_join(part->id, NULL);
+}
+
+#endif
+
+uint32_t sc_crc32_parallel(uint32_t crc, const uint8_t *buf, uint64_t len,
+                           uint32_t threads)
+{
+    uint64_t size;
+    struct crc32_part parts[SC_CRC32_THREADS_MAX];
+
+    if (len / SC_CRC32_PART_MIN < threads) {
+        threads = (uint32_t) (len / SC_CRC32_PART_MIN);
+    }
+
+    threads = threads > SC_CRC32_THREADS_MAX ? SC_CRC32_THREADS_MAX : threads;
+    if (threads <= 1) {
+        return crc32_long(crc, buf, len);
+    }
+
+    /* Part 0 is calculated by the caller, last part takes the remainder. */
+    size = (len / threads) & ~(uint64_t) 63;
+
+    for (uint32_t i = 0; i < threads; i++) {
+        parts[i].buf = buf + size * i;
+        parts[i].len = i == threads - 1 ? len - size * i : size;
+        parts[i].started = i != 0 && crc32_thread_start(&parts[i]);
+    }
+
+    parts[0].crc = crc32_long(crc, parts[0].buf, parts[0].len);
+
+    for (uint32_t i = 1; i < threads; i++) {
+        if (parts[i].started) {
+            crc32_thread_join(&parts[i]);
+        } else {
+            /* Thread could not be created, do it here. */
+            parts[i].crc = crc32_long(0, parts[i].buf, parts[i].len);
+        }
+
+        parts[0].crc = sc_crc32_combine(parts[0].crc, parts[i].crc,
+                                        parts[i].len);
+    }
+
+    return parts[0].crc;
+}
+
+static void crc32_init_level(enum crc32_level level)
+{
     crc32_init_sw();
+    crc32_init_combine();
+    crc32_func = crc32_sw;
+
+#if defined(CRC32_X86) || defined(CRC32_ARM)
+    if (level >= CRC32_LEVEL_HW) {
+        crc32_init_hw();
+        crc32_func = crc32_hw;
+    }
+#endif
+
+#ifdef CRC32_X86
+    if (level >= CRC32_LEVEL_PCLMUL) {
+        crc32_init_fold();
+        crc32_func = crc32_pclmul;
+    }
+#endif
+
+#ifdef CRC32_X86_VPCLMUL
+    if (level >= CRC32_LEVEL_VPCLMUL) {
+        crc32_func = crc32_vpclmul;
+    }
+#endif
+
+    (void) level;
+}
+
+void sc_crc32_init(void)
+{
+#if defined(CRC32_X86) || defined(CRC32_ARM)
+    crc32_init_level(crc32_cpu());
+#else
+    crc32_init_level(CRC32_LEVEL_SW);
 #endif
 }
+
+#ifdef SC_CRC32_TEST
+/* Test hook, limits the implementation to 'level' to test all paths. */
+void sc_crc32_test_init(int level)
+{
+    enum crc32_level max = CRC32_LEVEL_SW;
+
+#if defined(CRC32_X86) || defined(CRC32_ARM)
+    max = crc32_cpu();
+#endif
+
+    crc32_init_level((int) max < level ? max : (enum crc32_level) level);
+}
+#endif
@@ -27,6 +27,16 @@
 
 #include <stdint.h>
 
+// Max threads for sc_crc32_parallel().
+#ifndef SC_CRC32_THREADS_MAX
+    #define SC_CRC32_THREADS_MAX 64
+#endif
+
+// Min bytes per thread for sc_crc32_parallel().
+#ifndef SC_CRC32_PART_MIN
+    #define SC_CRC32_PART_MIN (1024 * 1024)
+#endif
+
 /**
  * Call once globally.
  */
@@ -41,4 +51,33 @@ void sc_crc32_init(void);
  */
 uint32_t sc_crc32(uint32_t crc, const uint8_t *buf, uint32_t len);
 
+/**
+ * Combine crc of two consecutive buffers, e.g. crc of 'A' and crc of 'B' into
+ * crc of 'AB'. Cost is logarithmic in 'len2', the data is not needed.
+ *
+ * @param crc1 crc of the first buffer
+ * @param crc2 crc of the second buffer, calculated with zero initial value
+ * @param len2 length of the second buffer
+ * @return     crc of the concatenation
+ */
+uint32_t sc_crc32_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+/**
+ * Calculate crc of a large buffer with multiple threads, e.g. an sc_mmap-ed
+ * file. Buffer is split into 'threads' parts, partial crcs are combined with
+ * sc_crc32_combine(). Calling thread calculates the first part. Each thread
+ * gets at least SC_CRC32_PART_MIN bytes, so small buffers are calculated on
+ * the calling thread only. If a thread cannot be created, its part is
+ * calculated on the calling thread.
+ *
+ * @param crc     initial value, same as sc_crc32().
+ * @param buf     buf
+ * @param len     len
+ * @param threads thread count including the calling thread,
+ *                max SC_CRC32_THREADS_MAX.
+ * @return        crc value
+ */
+uint32_t sc_crc32_parallel(uint32_t crc, const uint8_t *buf, uint64_t len,
+                           uint32_t threads);
+
 #endif
@@ -0,0 +1,54 @@
+#include "sc_dns.h"
+
+#include <stdio.h>
+
+static void on_resolve(struct sc_dns_req *req)
+{
+    struct sc_sock sock;
+
+    if (req->rc != 0) {
+        printf("%s : %s \n", req->host, req->err);
+        return;
+    }
+
+    // No name lookup, connect doesn't block on DNS.
+    sc_sock_init(&sock, 0, true, SC_SOCK_INET);
+    if (sc_sock_connect_addr(&sock, &req->addr, NULL, NULL) != 0) {
+        printf("Connect to %s failed : %s \n", req->host,
+               sc_sock_error(&sock));
+        return;
+    }
+
+    printf("Connected to %s \n", req->host);
+    sc_sock_term(&sock);
+}
+
+int main()
+{
+    int n;
+    struct sc_dns dns;
+    struct sc_dns_req req;
+    struct sc_sock_poll poll;
+
+    sc_sock_poll_init(&poll);
+    sc_dns_init(&dns, &poll, 30000);
+
+    if (sc_dns_resolve(&dns, &req, "localhost", "8080", SC_SOCK_INET,
+                       on_resolve, NULL) == 0) {
+        on_resolve(&req);
+    }
+
+    // Event loop is not blocked while the name is resolved.
+    while (true) {
+        n = sc_sock_poll_wait(&poll, 100);
+        if (n > 0) {
+            sc_dns_poll(&dns);
+            break;
+        }
+    }
+
+    sc_dns_term(&dns);
+    sc_sock_poll_term(&poll);
+
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "sc_dns.h"
+#include "sc_time.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <netinet/in.h>
+#endif
+
+static struct sc_sock_poll poll;
+static int completed;
+
+static void on_resolve(struct sc_dns_req *req)
+{
+    completed++;
+    (void) req;
+}
+
+// Runs the loop until 'count' callbacks are called.
+static void wait_completed(struct sc_dns *dns, int count)
+{
+    int n;
+
+    while (completed < count) {
+        n = sc_sock_poll_wait(&poll, 1000);
+        for (int i = 0; i < n; i++) {
+            assert(sc_sock_poll_data(&poll, i) == dns);
+            sc_dns_poll(dns);
+        }
+    }
+}
+
+static int addr_port(struct sc_dns_req *req)
+{
+    struct sockaddr_in *in = (struct sockaddr_in *) &req->addr.storage;
+
+    assert(req->addr.storage.ss_family == AF_INET);
+    return ntohs(in->sin_port);
+}
+
+#ifdef SC_HAVE_WRAP
+
+bool fail_malloc = false;
+void *__real_malloc(size_t n);
+void *__wrap_malloc(size_t n)
+{
+    if (fail_malloc) {
+        return NULL;
+    }
+
+    return __real_malloc(n);
+}
+
+void fail_test(void)
+{
+    struct sc_dns dns;
+    struct sc_dns_req req;
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    assert(sc_dns_init(&dns, &poll, 10000) == 0);
+
+    // Result is not cached on out of memory.
+    completed = 0;
+    assert(sc_dns_resolve(&dns, &req, "localhost", "80", SC_SOCK_INET,
+                          on_resolve, NULL) == SC_DNS_PENDING);
+    fail_malloc = true;
+    wait_completed(&dns, 1);
+    fail_malloc = false;
+    assert(req.rc == 0);
+    assert(sc_dns_resolve(&dns, &req, "localhost", "80", SC_SOCK_INET,
+                          on_resolve, NULL) == SC_DNS_PENDING);
+    wait_completed(&dns, 2);
+
+    assert(sc_dns_term(&dns) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+
+#else
+void fail_test(void)
+{
+}
+#endif
+
+void test_resolve(void)
+{
+    char host[512];
+    struct sc_dns dns;
+    struct sc_dns_req req, reqs[100];
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    assert(sc_dns_init(&dns, &poll, 100) == 0);
+    completed = 0;
+
+    // Numeric address
+    assert(sc_dns_resolve(&dns, &req, "127.0.0.1", "8080", SC_SOCK_INET,
+                          on_resolve, NULL) == 0);
+    assert(addr_port(&req) == 8080);
+
+    memset(host, 'a', sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    assert(sc_dns_resolve(&dns, &req, host, "80", SC_SOCK_INET, on_resolve,
+                          NULL) == -1);
+    assert(req.rc == -1 && *req.err != '\0');
+
+    // Thread lookup, then cache
+    assert(sc_dns_resolve(&dns, &req, "localhost", "8081", SC_SOCK_INET,
+                          on_resolve, &dns) == SC_DNS_PENDING);
+    wait_completed(&dns, 1);
+    assert(req.rc == 0);
+    assert(req.data == &dns);
+    assert(addr_port(&req) == 8081);
+
+    memset(&req.addr, 0, sizeof(req.addr));
+    assert(sc_dns_resolve(&dns, &req, "localhost", "8081", SC_SOCK_INET,
+                          on_resolve, NULL) == 0);
+    assert(addr_port(&req) == 8081);
+    assert(completed == 1);
+
+    // Different port is a different entry.
+    assert(sc_dns_resolve(&dns, &req, "localhost", "8082", SC_SOCK_INET,
+                          on_resolve, NULL) == SC_DNS_PENDING);
+    wait_completed(&dns, 2);
+    assert(addr_port(&req) == 8082);
+
+    // Expired
+    sc_time_sleep(150);
+    assert(sc_dns_resolve(&dns, &req, "localhost", "8081", SC_SOCK_INET,
+                          on_resolve, NULL) == SC_DNS_PENDING);
+    wait_completed(&dns, 3);
+    assert(req.rc == 0);
+
+    // Failure is reported through the callback and not cached.
+    assert(sc_dns_resolve(&dns, &req, "localhost", "no-such-service",
+                          SC_SOCK_INET, on_resolve, NULL) == SC_DNS_PENDING);
+    wait_completed(&dns, 4);
+    assert(req.rc == -1);
+    assert(strstr(req.err, "getaddrinfo") != NULL);
+    assert(sc_dns_resolve(&dns, &req, "localhost", "no-such-service",
+                          SC_SOCK_INET, on_resolve, NULL) == SC_DNS_PENDING);
+    wait_completed(&dns, 5);
+
+    // Concurrent requests
+    sc_dns_clear(&dns);
+    for (int i = 0; i < 100; i++) {
+        assert(sc_dns_resolve(&dns, &reqs[i], "localhost", "9000",
+                              SC_SOCK_INET, on_resolve, NULL) == 1);
+    }
+    wait_completed(&dns, 105);
+    for (int i = 0; i < 100; i++) {
+        assert(reqs[i].rc == 0);
+        assert(addr_port(&reqs[i]) == 9000);
+    }
+
+    // Pending requests are dropped on term.
+    assert(sc_dns_resolve(&dns, &req, "localhost", "9001", SC_SOCK_INET,
+                          on_resolve, NULL) == SC_DNS_PENDING);
+    assert(sc_dns_term(&dns) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+
+void test_connect(void)
+{
+    int rc;
+    struct sc_dns dns;
+    struct sc_dns_req req;
+    struct sc_sock srv, cli, in;
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    assert(sc_dns_init(&dns, &poll, 0) == 0);
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    assert(sc_sock_listen(&srv, "127.0.0.1", "8023") == 0);
+
+    completed = 0;
+    assert(sc_dns_resolve(&dns, &req, "localhost", "8023", SC_SOCK_INET,
+                          on_resolve, NULL) == SC_DNS_PENDING);
+    wait_completed(&dns, 1);
+    assert(req.rc == 0);
+
+    // Cache is disabled.
+    assert(sc_dns_resolve(&dns, &req, "localhost", "8023", SC_SOCK_INET,
+                          on_resolve, NULL) == SC_DNS_PENDING);
+    wait_completed(&dns, 2);
+
+    sc_sock_init(&cli, 0, false, SC_SOCK_INET);
+    rc = sc_sock_connect_addr(&cli, &req.addr, NULL, NULL);
+    assert(rc == 0 || rc == SC_SOCK_WANT_WRITE);
+    assert(sc_sock_accept(&srv, &in) == 0);
+
+    assert(sc_sock_term(&in) == 0);
+    assert(sc_sock_term(&cli) == 0);
+    assert(sc_sock_term(&srv) == 0);
+    assert(sc_dns_term(&dns) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+
+int main(void)
+{
+    fail_test();
+    test_resolve();
+    test_connect();
+
+    return 0;
+}
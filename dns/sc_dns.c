@@ -0,0 +1,322 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef _XOPEN_SOURCE
+    #define _XOPEN_SOURCE 700
+#endif
+
+#include "sc_dns.h"
+#include "sc_time.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <netdb.h>
+#endif
+
+struct sc_dns_entry
+{
+    uint64_t expire;
+    struct sc_sock_addr addr;
+    char key[];
+};
+
+static void sc_dns_set_err(struct sc_dns *dns, const char *fmt, const char *s)
+{
+    snprintf(dns->err, sizeof(dns->err), fmt, s);
+}
+
+// Resolves into 'req', 'flags' are passed to getaddrinfo().
+static int sc_dns_lookup(struct sc_dns_req *req, int flags)
+{
+    int rc;
+    struct addrinfo *info = NULL;
+    const char *port = req->port[0] != '\0' ? req->port : NULL;
+    struct addrinfo hints = {.ai_family = req->family,
+                             .ai_socktype = SOCK_STREAM,
+                             .ai_flags = flags};
+
+    rc = getaddrinfo(req->host, port, &hints, &info);
+    if (rc != 0) {
+        snprintf(req->err, sizeof(req->err), "getaddrinfo : %s",
+                 gai_strerror(rc));
+        return -1;
+    }
+
+    req->addr = (struct sc_sock_addr){.len = (int) info->ai_addrlen};
+    memcpy(&req->addr.storage, info->ai_addr, info->ai_addrlen);
+    freeaddrinfo(info);
+
+    return 0;
+}
+
+static void *sc_dns_worker(void *arg)
+{
+    struct sc_dns *dns = arg;
+    struct sc_dns_req *req;
+
+    while (true) {
+        sc_sem_wait(&dns->sem);
+
+        sc_mutex_lock(&dns->mtx);
+        if (dns->stop) {
+            sc_mutex_unlock(&dns->mtx);
+            break;
+        }
+
+        req = dns->head;
+        dns->head = req->next;
+        if (dns->head == NULL) {
+            dns->tail = NULL;
+        }
+        sc_mutex_unlock(&dns->mtx);
+
+        req->rc = sc_dns_lookup(req, 0);
+        sc_sock_notify_push(&dns->notify, &req->node);
+    }
+
+    return NULL;
+}
+
+int sc_dns_init(struct sc_dns *dns, struct sc_sock_poll *poll, uint64_t ttl)
+{
+    int rc;
+
+    *dns = (struct sc_dns){.ttl = ttl};
+
+    if (!sc_map_init_sv(&dns->cache, 0, 0)) {
+        sc_dns_set_err(dns, "%s", "Out of memory.");
+        return -1;
+    }
+
+    rc = sc_sock_notify_init(&dns->notify, poll, dns);
+    if (rc != 0) {
+        sc_dns_set_err(dns, "%s", sc_sock_notify_err(&dns->notify));
+        goto error_notify;
+    }
+
+    if (sc_mutex_init(&dns->mtx) != 0) {
+        sc_dns_set_err(dns, "%s", "sc_mutex_init failed.");
+        goto error_mutex;
+    }
+
+    if (sc_sem_init(&dns->sem, 0) != 0) {
+        sc_dns_set_err(dns, "%s", "sc_sem_init failed.");
+        goto error_sem;
+    }
+
+    for (int i = 0; i < SC_DNS_THREADS; i++) {
+        sc_thread_init(&dns->threads[i]);
+        rc = sc_thread_start(&dns->threads[i], sc_dns_worker, dns);
+        if (rc != 0) {
+            sc_dns_set_err(dns, "%s", sc_thread_err(&dns->threads[i]));
+            sc_dns_term(dns);
+            return -1;
+        }
+        dns->started++;
+    }
+
+    return 0;
+
+error_sem:
+    sc_mutex_term(&dns->mtx);
+error_mutex:
+    sc_sock_notify_term(&dns->notify);
+error_notify:
+    sc_map_term_sv(&dns->cache);
+
+    return -1;
+}
+
+int sc_dns_term(struct sc_dns *dns)
+{
+    int rc = 0;
+
+    sc_mutex_lock(&dns->mtx);
+    dns->stop = true;
+    sc_mutex_unlock(&dns->mtx);
+
+    sc_sem_post(&dns->sem, (uint32_t) dns->started);
+
+    for (int i = 0; i < dns->started; i++) {
+        rc |= sc_thread_term(&dns->threads[i]);
+    }
+
+    rc |= sc_sock_notify_term(&dns->notify);
+    rc |= sc_sem_term(&dns->sem);
+    rc |= sc_mutex_term(&dns->mtx);
+
+    sc_dns_clear(dns);
+    sc_map_term_sv(&dns->cache);
+
+    if (rc != 0) {
+        sc_dns_set_err(dns, "%s", "sc_dns_term failed.");
+    }
+
+    return rc != 0 ? -1 : 0;
+}
+
+static int sc_dns_key(char *buf, size_t len, struct sc_dns_req *req)
+{
+    return snprintf(buf, len, "%d|%s|%s", req->family, req->host, req->port);
+}
+
+static void sc_dns_cache_put(struct sc_dns *dns, struct sc_dns_req *req)
+{
+    int len;
+    void *old;
+    struct sc_dns_entry *e;
+
+    len = sc_dns_key(NULL, 0, req);
+    e = sc_dns_malloc(sizeof(*e) + (size_t) len + 1);
+    if (e == NULL) {
+        return;
+    }
+
+    sc_dns_key(e->key, (size_t) len + 1, req);
+    e->addr = req->addr;
+    e->expire = sc_time_mono_ms() + dns->ttl;
+
+    if (sc_map_del_sv(&dns->cache, e->key, &old)) {
+        sc_dns_free(old);
+    }
+
+    if (sc_map_size_sv(&dns->cache) >= SC_DNS_CACHE_MAX) {
+        sc_dns_clear(dns);
+    }
+
+    if (!sc_map_put_sv(&dns->cache, e->key, e)) {
+        sc_dns_free(e);
+    }
+}
+
+static bool sc_dns_cache_get(struct sc_dns *dns, struct sc_dns_req *req)
+{
+    void *val;
+    struct sc_dns_entry *e;
+    char key[sizeof(req->host) + sizeof(req->port) + 16];
+
+    if (dns->ttl == 0) {
+        return false;
+    }
+
+    sc_dns_key(key, sizeof(key), req);
+    if (!sc_map_get_sv(&dns->cache, key, &val)) {
+        return false;
+    }
+
+    e = val;
+    if (e->expire <= sc_time_mono_ms()) {
+        sc_map_del_sv(&dns->cache, key, &val);
+        sc_dns_free(e);
+        return false;
+    }
+
+    req->addr = e->addr;
+
+    return true;
+}
+
+int sc_dns_resolve(struct sc_dns *dns, struct sc_dns_req *req,
+                   const char *host, const char *port, int family,
+                   void (*cb)(struct sc_dns_req *), void *data)
+{
+    int n, m;
+
+    req->cb = cb;
+    req->data = data;
+    req->family = family;
+    req->next = NULL;
+    req->rc = 0;
+    req->err[0] = '\0';
+
+    n = snprintf(req->host, sizeof(req->host), "%s", host);
+    m = snprintf(req->port, sizeof(req->port), "%s", port ? port : "");
+    if (n < 0 || (size_t) n >= sizeof(req->host) || m < 0 ||
+        (size_t) m >= sizeof(req->port)) {
+        snprintf(req->err, sizeof(req->err), "Host or port is too long.");
+        req->rc = -1;
+        return -1;
+    }
+
+    if (sc_dns_cache_get(dns, req)) {
+        return 0;
+    }
+
+    // Numeric address, no network lookup.
+    if (sc_dns_lookup(req, AI_NUMERICHOST | AI_NUMERICSERV) == 0) {
+        return 0;
+    }
+    req->err[0] = '\0';
+
+    sc_mutex_lock(&dns->mtx);
+    if (dns->tail == NULL) {
+        dns->head = req;
+    } else {
+        dns->tail->next = req;
+    }
+    dns->tail = req;
+    sc_mutex_unlock(&dns->mtx);
+
+    sc_sem_post(&dns->sem, 1);
+
+    return SC_DNS_PENDING;
+}
+
+void sc_dns_poll(struct sc_dns *dns)
+{
+    struct sc_dns_req *req;
+    struct sc_sock_notify_node *node;
+
+    sc_sock_notify_drain(&dns->notify);
+
+    while ((node = sc_sock_notify_pop(&dns->notify)) != NULL) {
+        req = (struct sc_dns_req *) ((char *) node -
+                                     offsetof(struct sc_dns_req, node));
+        if (req->rc == 0 && dns->ttl != 0) {
+            sc_dns_cache_put(dns, req);
+        }
+
+        req->cb(req);
+    }
+}
+
+void sc_dns_clear(struct sc_dns *dns)
+{
+    void *e;
+
+    sc_map_foreach_value (&dns->cache, e) {
+        sc_dns_free(e);
+    }
+
+    sc_map_clear_sv(&dns->cache);
+}
+
+const char *sc_dns_err(struct sc_dns *dns)
+{
+    return dns->err;
+}
@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SC_DNS_H
+#define SC_DNS_H
+
+#include "sc_cond.h"
+#include "sc_map.h"
+#include "sc_mutex.h"
+#include "sc_sock.h"
+#include "sc_thread.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#else
+    #define sc_dns_malloc malloc
+    #define sc_dns_free   free
+#endif
+
+// Resolver threads, each one runs a blocking getaddrinfo() at a time.
+#ifndef SC_DNS_THREADS
+    #define SC_DNS_THREADS 2
+#endif
+
+// Max cached entries, cache is cleared when it is full.
+#ifndef SC_DNS_CACHE_MAX
+    #define SC_DNS_CACHE_MAX 4096
+#endif
+
+#define SC_DNS_PENDING 1
+
+struct sc_dns_req
+{
+    struct sc_sock_notify_node node;
+    struct sc_dns_req *next;
+    void (*cb)(struct sc_dns_req *req);
+    void *data;
+
+    int family;
+    int rc;
+    struct sc_sock_addr addr;
+    char host[256];
+    char port[32];
+    char err[128];
+};
+
+/**
+ * Asynchronous resolver for an event loop.
+ *
+ * getaddrinfo() is offloaded to SC_DNS_THREADS threads, results come back to
+ * the loop through an sc_sock_notify registered to its poll. When the poll
+ * reports the resolver, call sc_dns_poll(), it runs the callbacks of
+ * completed requests on the loop thread.
+ *
+ * Results are cached for 'ttl' milliseconds. getaddrinfo() doesn't expose
+ * record TTLs, so it is a single value for all entries, keep it below the
+ * TTL of your records. Numeric addresses and cache hits are resolved without
+ * a thread hop.
+ *
+ * Except sc_dns_term(), calls are for the loop thread only.
+ */
+struct sc_dns
+{
+    struct sc_sock_notify notify;
+    struct sc_map_sv cache;
+    uint64_t ttl;
+
+    struct sc_mutex mtx;
+    struct sc_sem sem;
+    struct sc_dns_req *head;
+    struct sc_dns_req *tail;
+    bool stop;
+
+    int started;
+    struct sc_thread threads[SC_DNS_THREADS];
+    char err[128];
+};
+
+/**
+ * Start resolver threads and register to 'poll' with 'dns' as user data.
+ *
+ * @param dns  dns
+ * @param poll poll of the loop
+ * @param ttl  cache ttl in milliseconds, '0' disables the cache.
+ * @return     '0' on success, negative value on failure, call sc_dns_err().
+ */
+int sc_dns_init(struct sc_dns *dns, struct sc_sock_poll *poll, uint64_t ttl);
+
+/**
+ * Stop threads and release cache. Requests which are not completed are
+ * dropped, their callbacks are not called.
+ *
+ * @param dns dns
+ * @return    '0' on success, negative value on failure, call sc_dns_err().
+ */
+int sc_dns_term(struct sc_dns *dns);
+
+/**
+ * Resolve 'host' and 'port'.
+ *
+ * On a cache hit or for a numeric address, 'req->addr' is set and '0' is
+ * returned, 'cb' is not called. Otherwise, request is queued and 'cb' is
+ * called from sc_dns_poll(), 'req->rc' is '0' and 'req->addr' is set on
+ * success, 'req->rc' is '-1' and 'req->err' is set on failure.
+ *
+ * e.g
+ *  rc = sc_dns_resolve(&dns, &req, "example.com", "80", SC_SOCK_INET, cb, c);
+ *  if (rc == 0) {
+ *      sc_sock_connect_addr(&sock, &req.addr, NULL, NULL);
+ *  }
+ *
+ * @param dns    dns
+ * @param req    request, must stay valid until 'cb' is called.
+ * @param host   host
+ * @param port   port
+ * @param family SC_SOCK_INET, SC_SOCK_INET6 or AF_UNSPEC
+ * @param cb     callback
+ * @param data   user data, set to 'req->data'.
+ * @return       '0' if resolved, SC_DNS_PENDING if 'cb' will be called,
+ *               '-1' if host or port is too long, 'req->err' is set.
+ */
+int sc_dns_resolve(struct sc_dns *dns, struct sc_dns_req *req,
+                   const char *host, const char *port, int family,
+                   void (*cb)(struct sc_dns_req *), void *data);
+
+/**
+ * Call when poll reports 'dns', runs callbacks of completed requests.
+ * @param dns dns
+ */
+void sc_dns_poll(struct sc_dns *dns);
+
+/**
+ * Drop cached entries.
+ * @param dns dns
+ */
+void sc_dns_clear(struct sc_dns *dns);
+
+/**
+ * @param dns dns
+ * @return    last error string
+ */
+const char *sc_dns_err(struct sc_dns *dns);
+
+#endif
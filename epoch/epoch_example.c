@@ -0,0 +1,51 @@
+#include "sc_epoch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+struct config
+{
+    struct sc_epoch_node node;
+    int timeout;
+};
+
+static void config_free(struct sc_epoch_node *node)
+{
+    // 'node' is the first member.
+    printf("free config \n");
+    free(node);
+}
+
+int main()
+{
+    struct sc_epoch epoch;
+    struct sc_epoch_thread t;
+    struct config *current, *old;
+
+    sc_epoch_init(&epoch);
+    sc_epoch_register(&epoch, &t);
+
+    current = calloc(1, sizeof(*current));
+    current->timeout = 10;
+
+    // Reader
+    sc_epoch_enter(&t);
+    printf("timeout = %d \n", current->timeout);
+    sc_epoch_exit(&t);
+
+    // Writer replaces the config, old one is freed when no reader can see it.
+    old = current;
+    current = calloc(1, sizeof(*current));
+    current->timeout = 20;
+    sc_epoch_retire(&t, &old->node, config_free);
+
+    // Quiescent point
+    sc_epoch_collect(&t);
+    sc_epoch_collect(&t);
+
+    sc_epoch_unregister(&t);
+    sc_epoch_term(&epoch);
+    free(current);
+
+    return 0;
+}
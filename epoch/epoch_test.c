@@ -0,0 +1,504 @@
+#include "sc_epoch.h"
+#include "sc_map.h"
+#include "sc_thread.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#define THREADS 4
+#define COUNT   100000
+
+#define ALIVE 0xa11e
+#define DEAD  0xdead
+
+struct item
+{
+    struct sc_epoch_node node;
+    int magic;
+    int value;
+};
+
+static int freed;
+
+static void item_free(struct sc_epoch_node *node)
+{
+    struct item *item = (struct item *) ((char *) node -
+                                         offsetof(struct item, node));
+    item->magic = DEAD;
+    __atomic_fetch_add(&freed, 1, __ATOMIC_RELAXED);
+    free(item);
+}
+
+static struct item *item_create(int value)
+{
+    struct item *item = malloc(sizeof(*item));
+
+    assert(item != NULL);
+    item->magic = ALIVE;
+    item->value = value;
+
+    return item;
+}
+
+#ifdef SC_HAVE_WRAP
+
+bool fail_malloc = false;
+void *__real_malloc(size_t n);
+void *__wrap_malloc(size_t n)
+{
+    if (fail_malloc) {
+        return NULL;
+    }
+
+    return __real_malloc(n);
+}
+
+void fail_test(void)
+{
+    void *p;
+
+    fail_malloc = true;
+    assert(sc_epoch_hook_malloc(10) == NULL);
+    assert(sc_epoch_hook_calloc(10, 10) == NULL);
+    assert(sc_epoch_hook_realloc(NULL, 10) == NULL);
+    fail_malloc = false;
+
+    p = sc_epoch_hook_malloc(10);
+    assert(p != NULL);
+    fail_malloc = true;
+    assert(sc_epoch_hook_realloc(p, 100) == NULL);
+    fail_malloc = false;
+    sc_epoch_hook_free(p);
+
+    struct sc_rcu rcu;
+    struct sc_epoch e;
+    struct sc_epoch_thread t;
+    int a, b;
+
+    sc_epoch_init(&e);
+    assert(sc_epoch_register(&e, &t) == 0);
+    sc_rcu_init(&rcu, &a, NULL);
+    fail_malloc = true;
+    assert(!sc_rcu_publish(&rcu, &t, &b));
+    fail_malloc = false;
+    assert(sc_rcu_get(&rcu) == &a);
+    sc_epoch_unregister(&t);
+    sc_epoch_term(&e);
+}
+
+#else
+void fail_test(void)
+{
+}
+#endif
+
+void test_basic(void)
+{
+    struct sc_epoch e;
+    struct sc_epoch_thread t;
+
+    sc_epoch_init(&e);
+    assert(sc_epoch_register(&e, &t) == 0);
+    assert(sc_epoch_pending(&t) == 0);
+    assert(sc_epoch_collect(&t) == 0);
+
+    freed = 0;
+    for (int i = 0; i < 10; i++) {
+        sc_epoch_retire(&t, &item_create(i)->node, item_free);
+    }
+    assert(sc_epoch_pending(&t) == 10);
+
+    // Needs two advances.
+    assert(sc_epoch_collect(&t) == 0);
+    assert(sc_epoch_collect(&t) == 10);
+    assert(sc_epoch_pending(&t) == 0);
+    assert(freed == 10);
+
+    // Nested critical sections.
+    sc_epoch_enter(&t);
+    sc_epoch_enter(&t);
+    sc_epoch_retire(&t, &item_create(0)->node, item_free);
+    sc_epoch_exit(&t);
+    assert(t.slot->state & 1);
+    sc_epoch_collect(&t);
+    sc_epoch_collect(&t);
+    sc_epoch_exit(&t);
+    assert(t.slot->state == 0);
+    sc_epoch_collect(&t);
+    sc_epoch_collect(&t);
+    assert(sc_epoch_pending(&t) == 0);
+    assert(freed == 11);
+
+    // Batch triggers collect.
+    for (int i = 0; i < SC_EPOCH_BATCH * 4; i++) {
+        sc_epoch_retire(&t, &item_create(i)->node, item_free);
+    }
+    assert(sc_epoch_pending(&t) < SC_EPOCH_BATCH * 2);
+
+    sc_epoch_unregister(&t);
+    sc_epoch_term(&e);
+    assert(freed == 11 + SC_EPOCH_BATCH * 4);
+}
+
+void test_block(void)
+{
+    uint64_t global;
+    struct sc_epoch e;
+    struct sc_epoch_thread reader, writer;
+
+    sc_epoch_init(&e);
+    assert(sc_epoch_register(&e, &reader) == 0);
+    assert(sc_epoch_register(&e, &writer) == 0);
+
+    freed = 0;
+    sc_epoch_enter(&reader);
+    global = e.global;
+    for (int i = 0; i < 100; i++) {
+        sc_epoch_retire(&writer, &item_create(i)->node, item_free);
+        sc_epoch_collect(&writer);
+    }
+
+    // Reader holds the epoch, it can advance once at most.
+    assert(freed == 0);
+    assert(e.global <= global + 1);
+    sc_epoch_exit(&reader);
+
+    sc_epoch_collect(&writer);
+    sc_epoch_collect(&writer);
+    sc_epoch_collect(&writer);
+    assert(freed == 100);
+    assert(sc_epoch_pending(&writer) == 0);
+
+    sc_epoch_unregister(&reader);
+    sc_epoch_unregister(&writer);
+    sc_epoch_term(&e);
+}
+
+void test_register(void)
+{
+    static struct sc_epoch e;
+    static struct sc_epoch_thread t[SC_EPOCH_THREADS + 1];
+
+    sc_epoch_init(&e);
+    for (int i = 0; i < SC_EPOCH_THREADS; i++) {
+        assert(sc_epoch_register(&e, &t[i]) == 0);
+    }
+    assert(sc_epoch_register(&e, &t[SC_EPOCH_THREADS]) == -1);
+    assert(e.high == SC_EPOCH_THREADS);
+
+    // Slot is reused.
+    sc_epoch_unregister(&t[3]);
+    assert(sc_epoch_register(&e, &t[SC_EPOCH_THREADS]) == 0);
+    assert(t[SC_EPOCH_THREADS].slot == &e.slots[3]);
+    sc_epoch_unregister(&t[SC_EPOCH_THREADS]);
+
+    for (int i = 0; i < SC_EPOCH_THREADS; i++) {
+        if (i != 3) {
+            sc_epoch_unregister(&t[i]);
+        }
+    }
+    sc_epoch_term(&e);
+}
+
+void test_orphan(void)
+{
+    struct sc_epoch e;
+    struct sc_epoch_thread t1, t2;
+
+    sc_epoch_init(&e);
+    assert(sc_epoch_register(&e, &t1) == 0);
+    assert(sc_epoch_register(&e, &t2) == 0);
+
+    freed = 0;
+    sc_epoch_enter(&t2);
+    for (int i = 0; i < 10; i++) {
+        sc_epoch_retire(&t1, &item_create(i)->node, item_free);
+    }
+    sc_epoch_unregister(&t1);
+    assert(freed == 0);
+    assert(e.orphans != NULL);
+    sc_epoch_exit(&t2);
+
+    // Adopted by t2.
+    sc_epoch_collect(&t2);
+    assert(e.orphans == NULL);
+    assert(sc_epoch_pending(&t2) == 10);
+    sc_epoch_collect(&t2);
+    sc_epoch_collect(&t2);
+    assert(freed == 10);
+
+    // Freed on term.
+    sc_epoch_enter(&t2);
+    assert(sc_epoch_register(&e, &t1) == 0);
+    sc_epoch_retire(&t1, &item_create(0)->node, item_free);
+    sc_epoch_unregister(&t1);
+    sc_epoch_exit(&t2);
+    sc_epoch_unregister(&t2);
+    sc_epoch_term(&e);
+    assert(freed == 11);
+}
+
+void test_hook(void)
+{
+    char *p, *q;
+    struct sc_epoch e;
+    struct sc_epoch_thread t;
+
+    // Not registered, freed immediately.
+    sc_epoch_hook_free(NULL);
+    p = sc_epoch_hook_malloc(10);
+    assert(p != NULL);
+    sc_epoch_hook_free(p);
+    assert(sc_epoch_hook_malloc(SIZE_MAX) == NULL);
+    assert(sc_epoch_hook_calloc(SIZE_MAX / 2, 4) == NULL);
+
+    sc_epoch_init(&e);
+    assert(sc_epoch_register(&e, &t) == 0);
+
+    p = sc_epoch_hook_calloc(10, 10);
+    assert(p != NULL);
+    for (int i = 0; i < 100; i++) {
+        assert(p[i] == 0);
+    }
+    strcpy(p, "test");
+
+    sc_epoch_enter(&t);
+    q = sc_epoch_hook_realloc(p, 1000);
+    assert(q != p);
+    assert(strcmp(q, "test") == 0);
+    assert(sc_epoch_pending(&t) == 1);
+
+    // Old memory is still readable inside the critical section.
+    sc_epoch_collect(&t);
+    sc_epoch_collect(&t);
+    assert(strcmp(p, "test") == 0);
+    sc_epoch_exit(&t);
+
+    sc_epoch_hook_free(q);
+    q = sc_epoch_hook_realloc(NULL, 10);
+    assert(q != NULL);
+    q = sc_epoch_hook_realloc(q, 5);
+    assert(q != NULL);
+    sc_epoch_hook_free(q);
+
+    sc_epoch_unregister(&t);
+    sc_epoch_term(&e);
+}
+
+static int maps_freed;
+
+static const char *routes[] = {
+        "route-0",  "route-1",  "route-2",  "route-3",  "route-4",  "route-5",
+        "route-6",  "route-7",  "route-8",  "route-9",  "route-10", "route-11",
+        "route-12", "route-13", "route-14", "route-15",
+};
+
+static struct sc_map_str *map_create(int version)
+{
+    struct sc_map_str *map = malloc(sizeof(*map));
+
+    assert(map != NULL);
+    assert(sc_map_init_str(map, 0, 0));
+
+    for (int i = 0; i < 16; i++) {
+        sc_map_put_str(map, routes[i], version % 2 ? "odd" : "even");
+    }
+
+    return map;
+}
+
+static void map_destroy(void *p)
+{
+    struct sc_map_str *map = p;
+
+    sc_map_term_str(map);
+    free(map);
+    maps_freed++;
+}
+
+void test_rcu(void)
+{
+    const char *val;
+    struct sc_rcu rcu;
+    struct sc_epoch e;
+    struct sc_map_str *map;
+    struct sc_epoch_thread reader, writer;
+
+    sc_epoch_init(&e);
+    assert(sc_epoch_register(&e, &reader) == 0);
+    assert(sc_epoch_register(&e, &writer) == 0);
+
+    sc_rcu_init(&rcu, NULL, map_destroy);
+    assert(sc_rcu_get(&rcu) == NULL);
+    assert(sc_rcu_publish(&rcu, &writer, map_create(0)));
+
+    maps_freed = 0;
+    sc_epoch_enter(&reader);
+    map = sc_rcu_get(&rcu);
+    assert(sc_rcu_publish(&rcu, &writer, map_create(1)));
+    assert(sc_rcu_publish(&rcu, &writer, map_create(2)));
+    sc_epoch_collect(&writer);
+    sc_epoch_collect(&writer);
+
+    // Reader still holds the first version.
+    assert(maps_freed == 0);
+    assert(sc_map_get_str(map, "route-3", &val) && strcmp(val, "even") == 0);
+    sc_epoch_exit(&reader);
+
+    sc_epoch_collect(&writer);
+    sc_epoch_collect(&writer);
+    assert(maps_freed == 2);
+
+    sc_epoch_enter(&reader);
+    map = sc_rcu_get(&rcu);
+    assert(sc_map_get_str(map, "route-15", &val) && strcmp(val, "even") == 0);
+    sc_epoch_exit(&reader);
+
+    sc_rcu_term(&rcu);
+    assert(maps_freed == 3);
+    assert(sc_rcu_get(&rcu) == NULL);
+    sc_rcu_term(&rcu);
+
+    sc_epoch_unregister(&reader);
+    sc_epoch_unregister(&writer);
+    sc_epoch_term(&e);
+}
+
+static struct sc_epoch shared_epoch;
+static struct sc_rcu shared_rcu;
+static int done;
+
+static void *rcu_reader(void *arg)
+{
+    const char *val, *first;
+    struct sc_map_str *map;
+    struct sc_epoch_thread t;
+
+    (void) arg;
+
+    assert(sc_epoch_register(&shared_epoch, &t) == 0);
+
+    while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+        sc_epoch_enter(&t);
+        map = sc_rcu_get(&shared_rcu);
+        assert(sc_map_get_str(map, "route-0", &first));
+
+        // All routes belong to the same version.
+        for (int i = 1; i < 16; i++) {
+            assert(sc_map_get_str(map, routes[i], &val) && val == first);
+        }
+        sc_epoch_exit(&t);
+        sc_epoch_collect(&t);
+    }
+
+    sc_epoch_unregister(&t);
+
+    return NULL;
+}
+
+void test_rcu_threads(void)
+{
+    struct sc_epoch_thread t;
+    struct sc_thread threads[THREADS];
+
+    done = 0;
+    maps_freed = 0;
+    sc_epoch_init(&shared_epoch);
+    assert(sc_epoch_register(&shared_epoch, &t) == 0);
+    sc_rcu_init(&shared_rcu, map_create(0), map_destroy);
+
+    for (int i = 0; i < THREADS; i++) {
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], rcu_reader, NULL) == 0);
+    }
+
+    for (int i = 1; i <= 2000; i++) {
+        assert(sc_rcu_publish(&shared_rcu, &t, map_create(i)));
+    }
+
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    sc_epoch_unregister(&t);
+    sc_epoch_term(&shared_epoch);
+    assert(maps_freed == 2000);
+    sc_rcu_term(&shared_rcu);
+}
+
+static struct item *shared;
+
+static void *reader(void *arg)
+{
+    long sum = 0;
+    struct item *item;
+    struct sc_epoch_thread t;
+
+    (void) arg;
+
+    assert(sc_epoch_register(&shared_epoch, &t) == 0);
+
+    while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+        sc_epoch_enter(&t);
+        item = __atomic_load_n(&shared, __ATOMIC_ACQUIRE);
+        assert(item->magic == ALIVE);
+        sum += item->value;
+        assert(item->magic == ALIVE);
+        sc_epoch_exit(&t);
+        sc_epoch_collect(&t);
+    }
+
+    sc_epoch_unregister(&t);
+
+    return (void *) sum;
+}
+
+void test_threads(void)
+{
+    struct item *old;
+    struct sc_epoch_thread t;
+    struct sc_thread threads[THREADS];
+
+    done = 0;
+    freed = 0;
+    sc_epoch_init(&shared_epoch);
+    assert(sc_epoch_register(&shared_epoch, &t) == 0);
+    shared = item_create(0);
+
+    for (int i = 0; i < THREADS; i++) {
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], reader, NULL) == 0);
+    }
+
+    for (int i = 1; i <= COUNT; i++) {
+        old = __atomic_exchange_n(&shared, item_create(i), __ATOMIC_ACQ_REL);
+        sc_epoch_retire(&t, &old->node, item_free);
+    }
+
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    sc_epoch_unregister(&t);
+    sc_epoch_term(&shared_epoch);
+    assert(freed == COUNT);
+    free(shared);
+}
+
+int main(void)
+{
+    fail_test();
+    test_basic();
+    test_block();
+    test_register();
+    test_orphan();
+    test_hook();
+    test_threads();
+    test_rcu();
+    test_rcu_threads();
+
+    return 0;
+}
@@ -0,0 +1,447 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "sc_epoch.h"
+
+#include <string.h>
+
+#ifndef thread_local
+    #if __STDC_VERSION__ >= 201112 && !defined __STDC_NO_THREADS__
+        #define thread_local _Thread_local
+    #elif defined _WIN32 && (defined _MSC_VER || defined __ICL ||              \
+                             defined __DMC__ || defined __BORLANDC__)
+        #define thread_local __declspec(thread)
+    #elif defined __GNUC__ || defined __SUNPRO_C || defined __xlC__
+        #define thread_local __thread
+    #else
+        #error "Cannot define  thread_local"
+    #endif
+#endif
+
+#if defined(_MSC_VER)
+    #include <windows.h>
+
+    // Volatile accesses have acquire/release semantics on MSVC x86/x64.
+    #define sc_epoch_load(p)         (*(volatile uint64_t *) (p))
+    #define sc_epoch_load_acq(p)     (*(volatile uint64_t *) (p))
+    #define sc_epoch_store(p, v)     (*(volatile uint64_t *) (p) = (v))
+    #define sc_epoch_store_rel(p, v) (*(volatile uint64_t *) (p) = (v))
+    #define sc_epoch_load_ptr(p)     (*(void *volatile *) (p))
+    #define sc_epoch_load_sc(p)                                                \
+        InterlockedCompareExchange64((LONG64 *) (p), 0, 0)
+    #define sc_epoch_xchg(p, v)                                                \
+        InterlockedExchange64((LONG64 *) (p), (LONG64) (v))
+    #define sc_epoch_add(p, v)                                                 \
+        ((uint64_t) InterlockedExchangeAdd64((LONG64 *) (p), (LONG64) (v)))
+    #define sc_epoch_cas(p, old, v)                                            \
+        (InterlockedCompareExchange64((LONG64 *) (p), (LONG64) (v),            \
+                                      (LONG64) (old)) == (LONG64) (old))
+    #define sc_epoch_cas_ptr(p, old, v)                                        \
+        (InterlockedCompareExchangePointer((PVOID *) (p), (v), (old)) == (old))
+    #define sc_epoch_xchg_ptr(p, v)                                            \
+        InterlockedExchangePointer((PVOID *) (p), (v))
+    #define sc_epoch_load_ptr_acq(p) (*(void *volatile *) (p))
+    #define sc_epoch_store_ptr_rel(p, v) (*(void *volatile *) (p) = (v))
+#else
+    #define sc_epoch_load(p)         __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_epoch_load_acq(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+    #define sc_epoch_store(p, v)     __atomic_store_n(p, v, __ATOMIC_RELAXED)
+    #define sc_epoch_store_rel(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+    #define sc_epoch_load_ptr(p)     __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_epoch_load_sc(p)      __atomic_load_n(p, __ATOMIC_SEQ_CST)
+    #define sc_epoch_xchg(p, v)      __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST)
+    #define sc_epoch_add(p, v)       __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST)
+    #define sc_epoch_cas(p, old, v)                                            \
+        __atomic_compare_exchange_n(p, &(uint64_t){old}, v, false,             \
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+    #define sc_epoch_cas_ptr(p, old, v)                                        \
+        __atomic_compare_exchange_n(p, &(struct sc_epoch_node *){old}, v,      \
+                                    false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)
+    #define sc_epoch_xchg_ptr(p, v) __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL)
+    #define sc_epoch_load_ptr_acq(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+    #define sc_epoch_store_ptr_rel(p, v)                                       \
+        __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#endif
+
+// Current record of the thread for the allocation hooks.
+static thread_local struct sc_epoch_thread *sc_epoch_current;
+
+void sc_epoch_init(struct sc_epoch *e)
+{
+    memset(e, 0, sizeof(*e));
+}
+
+static size_t sc_epoch_free_list(struct sc_epoch_node *node)
+{
+    size_t n = 0;
+    struct sc_epoch_node *next;
+
+    while (node != NULL) {
+        next = node->next;
+        node->free_fn(node);
+        node = next;
+        n++;
+    }
+
+    return n;
+}
+
+void sc_epoch_term(struct sc_epoch *e)
+{
+    sc_epoch_free_list(e->orphans);
+    e->orphans = NULL;
+}
+
+int sc_epoch_register(struct sc_epoch *e, struct sc_epoch_thread *t)
+{
+    uint64_t high;
+
+    *t = (struct sc_epoch_thread){.epoch = e};
+
+    for (uint64_t i = 0; i < SC_EPOCH_THREADS; i++) {
+        if (sc_epoch_load(&e->slots[i].used) == 0 &&
+            sc_epoch_cas(&e->slots[i].used, 0, 1)) {
+            t->slot = &e->slots[i];
+
+            // Scanners only check slots below the high mark.
+            do {
+                high = sc_epoch_load_acq(&e->high);
+            } while (high <= i && !sc_epoch_cas(&e->high, high, i + 1));
+
+            sc_epoch_current = t;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static void sc_epoch_orphan(struct sc_epoch *e, struct sc_epoch_node *head)
+{
+    struct sc_epoch_node *old, *tail = head;
+
+    while (tail->next != NULL) {
+        tail = tail->next;
+    }
+
+    do {
+        old = sc_epoch_load_ptr(&e->orphans);
+        tail->next = old;
+    } while (!sc_epoch_cas_ptr(&e->orphans, old, head));
+}
+
+void sc_epoch_unregister(struct sc_epoch_thread *t)
+{
+    sc_epoch_collect(t);
+
+    for (int i = 0; i < 3; i++) {
+        if (t->limbo[i] != NULL) {
+            sc_epoch_orphan(t->epoch, t->limbo[i]);
+            t->limbo[i] = NULL;
+        }
+    }
+
+    sc_epoch_store_rel(&t->slot->state, 0);
+    sc_epoch_store_rel(&t->slot->used, 0);
+
+    if (sc_epoch_current == t) {
+        sc_epoch_current = NULL;
+    }
+
+    t->slot = NULL;
+    t->count = 0;
+}
+
+void sc_epoch_enter(struct sc_epoch_thread *t)
+{
+    uint64_t global;
+
+    if (t->depth++ > 0) {
+        return;
+    }
+
+    // Announcement must be visible before any read of the shared structure,
+    // seq_cst exchange orders it with the later loads.
+    global = sc_epoch_load_acq(&t->epoch->global);
+    sc_epoch_xchg(&t->slot->state, (global << 1) | 1);
+}
+
+void sc_epoch_exit(struct sc_epoch_thread *t)
+{
+    if (--t->depth > 0) {
+        return;
+    }
+
+    sc_epoch_store_rel(&t->slot->state, 0);
+}
+
+// Pushes a list into the deferred list of 'epoch'. The list in the same
+// index belongs to 'epoch - 3' or older, so it is freed first.
+static size_t sc_epoch_push(struct sc_epoch_thread *t, uint64_t epoch,
+                            struct sc_epoch_node *head,
+                            struct sc_epoch_node *tail, size_t count)
+{
+    size_t n = 0;
+    int i = (int) (epoch % 3);
+
+    if (t->limbo[i] != NULL && t->epochs[i] != epoch) {
+        n = sc_epoch_free_list(t->limbo[i]);
+        t->limbo[i] = NULL;
+        t->count -= n;
+    }
+
+    t->epochs[i] = epoch;
+    tail->next = t->limbo[i];
+    t->limbo[i] = head;
+    t->count += count;
+
+    return n;
+}
+
+void sc_epoch_retire(struct sc_epoch_thread *t, struct sc_epoch_node *node,
+                     void (*free_fn)(struct sc_epoch_node *))
+{
+    uint64_t epoch;
+
+    node->free_fn = free_fn;
+
+    if (t->depth > 0) {
+        // Global epoch can't pass 'epoch + 1' until this thread exits.
+        epoch = sc_epoch_load(&t->slot->state) >> 1;
+    } else {
+        // Unlink of the object must be visible before reading the epoch. An
+        // RMW instead of a load, so it is ordered with the unlink and the
+        // threads reading the next epoch synchronize with it.
+        epoch = sc_epoch_add(&t->epoch->global, 0);
+    }
+
+    sc_epoch_push(t, epoch, node, node, 1);
+
+    if (t->count >= SC_EPOCH_BATCH) {
+        sc_epoch_collect(t);
+    }
+}
+
+static uint64_t sc_epoch_advance(struct sc_epoch *e)
+{
+    uint64_t state, high;
+    uint64_t global = sc_epoch_load_sc(&e->global);
+
+    // seq_cst loads pair with the exchange in sc_epoch_enter().
+    high = sc_epoch_load_sc(&e->high);
+
+    for (uint64_t i = 0; i < high; i++) {
+        state = sc_epoch_load_sc(&e->slots[i].state);
+        if ((state & 1) && (state >> 1) != global) {
+            return global;
+        }
+    }
+
+    if (sc_epoch_cas(&e->global, global, global + 1)) {
+        return global + 1;
+    }
+
+    return sc_epoch_load_acq(&e->global);
+}
+
+size_t sc_epoch_collect(struct sc_epoch_thread *t)
+{
+    size_t n = 0, count;
+    uint64_t global;
+    struct sc_epoch_node *head, *tail;
+
+    global = sc_epoch_advance(t->epoch);
+
+    for (int i = 0; i < 3; i++) {
+        if (t->limbo[i] != NULL && t->epochs[i] + 2 <= global) {
+            count = sc_epoch_free_list(t->limbo[i]);
+            t->limbo[i] = NULL;
+            t->count -= count;
+            n += count;
+        }
+    }
+
+    // Objects of unregistered threads were retired in the current epoch or
+    // before, adopt them as if they were retired now.
+    if (sc_epoch_load_ptr(&t->epoch->orphans) != NULL) {
+        head = sc_epoch_xchg_ptr(&t->epoch->orphans, NULL);
+        if (head != NULL) {
+            count = 1;
+            for (tail = head; tail->next != NULL; tail = tail->next) {
+                count++;
+            }
+            n += sc_epoch_push(t, global, head, tail, count);
+        }
+    }
+
+    return n;
+}
+
+size_t sc_epoch_pending(struct sc_epoch_thread *t)
+{
+    return t->count;
+}
+
+// Replaced rcu version waiting for the grace period.
+struct sc_rcu_version
+{
+    struct sc_epoch_node node;
+    void *ptr;
+    void (*free_fn)(void *ptr);
+};
+
+static void sc_rcu_release(struct sc_epoch_node *node)
+{
+    struct sc_rcu_version *v = (struct sc_rcu_version *) node;
+
+    v->free_fn(v->ptr);
+    sc_epoch_free(v);
+}
+
+void sc_rcu_init(struct sc_rcu *r, void *ptr, void (*free_fn)(void *))
+{
+    r->free_fn = free_fn;
+    sc_epoch_store_ptr_rel(&r->ptr, ptr);
+}
+
+void sc_rcu_term(struct sc_rcu *r)
+{
+    if (r->ptr != NULL) {
+        r->free_fn(r->ptr);
+        r->ptr = NULL;
+    }
+}
+
+void *sc_rcu_get(struct sc_rcu *r)
+{
+    return sc_epoch_load_ptr_acq(&r->ptr);
+}
+
+bool sc_rcu_publish(struct sc_rcu *r, struct sc_epoch_thread *t, void *ptr)
+{
+    struct sc_rcu_version *v;
+
+    // Allocate before publishing, so failure leaves the old version intact.
+    v = sc_epoch_malloc(sizeof(*v));
+    if (v == NULL) {
+        return false;
+    }
+
+    v->ptr = sc_epoch_xchg_ptr(&r->ptr, ptr);
+    v->free_fn = r->free_fn;
+
+    if (v->ptr == NULL) {
+        sc_epoch_free(v);
+        return true;
+    }
+
+    sc_epoch_retire(t, &v->node, sc_rcu_release);
+
+    return true;
+}
+
+// Hook allocations have a header to embed the node, it keeps the alignment of
+// malloc().
+struct sc_epoch_hdr
+{
+    struct sc_epoch_node node;
+    size_t size;
+    size_t pad;
+};
+
+static void sc_epoch_hook_release(struct sc_epoch_node *node)
+{
+    sc_epoch_free(node);
+}
+
+void *sc_epoch_hook_malloc(size_t size)
+{
+    struct sc_epoch_hdr *hdr;
+
+    if (size > SIZE_MAX - sizeof(*hdr)) {
+        return NULL;
+    }
+
+    hdr = sc_epoch_malloc(sizeof(*hdr) + size);
+    if (hdr == NULL) {
+        return NULL;
+    }
+
+    hdr->size = size;
+
+    return hdr + 1;
+}
+
+void *sc_epoch_hook_calloc(size_t n, size_t size)
+{
+    void *p;
+
+    if (size != 0 && n > SIZE_MAX / size) {
+        return NULL;
+    }
+
+    p = sc_epoch_hook_malloc(n * size);
+    if (p != NULL) {
+        memset(p, 0, n * size);
+    }
+
+    return p;
+}
+
+void *sc_epoch_hook_realloc(void *p, size_t size)
+{
+    void *mem;
+    struct sc_epoch_hdr *hdr;
+
+    mem = sc_epoch_hook_malloc(size);
+    if (mem == NULL || p == NULL) {
+        return mem;
+    }
+
+    hdr = (struct sc_epoch_hdr *) p - 1;
+    memcpy(mem, p, hdr->size < size ? hdr->size : size);
+    sc_epoch_hook_free(p);
+
+    return mem;
+}
+
+void sc_epoch_hook_free(void *p)
+{
+    struct sc_epoch_hdr *hdr;
+    struct sc_epoch_thread *t = sc_epoch_current;
+
+    if (p == NULL) {
+        return;
+    }
+
+    hdr = (struct sc_epoch_hdr *) p - 1;
+
+    if (t == NULL) {
+        sc_epoch_free(hdr);
+        return;
+    }
+
+    sc_epoch_retire(t, &hdr->node, sc_epoch_hook_release);
+}
@@ -0,0 +1,282 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SC_EPOCH_H
+#define SC_EPOCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#endif
+
+// Backing allocator of the hooks, config.h must not route these to the epoch
+// hooks.
+#ifndef sc_epoch_malloc
+    #define sc_epoch_malloc malloc
+    #define sc_epoch_free   free
+#endif
+
+// Max registered threads at a time.
+#ifndef SC_EPOCH_THREADS
+    #define SC_EPOCH_THREADS 64
+#endif
+
+// Retired objects of a thread that trigger sc_epoch_collect().
+#ifndef SC_EPOCH_BATCH
+    #define SC_EPOCH_BATCH 64
+#endif
+
+/**
+ * Epoch based memory reclamation.
+ *
+ * Readers of a lock-free structure wrap their access with sc_epoch_enter()
+ * and sc_epoch_exit(). Writers unlink an object and pass it to
+ * sc_epoch_retire() instead of freeing it, it is freed once every thread that
+ * could have seen it has left its critical section.
+ *
+ * There is a global epoch and a slot per registered thread. Entering stores
+ * the global epoch into the thread's slot, exiting clears it. The global
+ * epoch advances when every thread inside a critical section has observed
+ * it. Objects retired in epoch 'e' are freed when the global epoch reaches
+ * 'e + 2'. Each thread keeps three deferred lists, one per epoch modulo 3, so
+ * retire and free don't need any shared list.
+ *
+ * Enter and exit are plain stores to the thread's own cache line, enter has a
+ * store-load fence, readers never execute an atomic read-modify-write
+ * operation. Advancing the epoch is done by sc_epoch_collect(), call it at
+ * quiescent points, e.g. once per event loop iteration. It is also called
+ * after every SC_EPOCH_BATCH retired objects.
+ *
+ * A thread stuck inside a critical section blocks reclamation of all
+ * threads, keep critical sections short and never block inside.
+ *
+ * struct sc_epoch_thread t;
+ *
+ * sc_epoch_register(&epoch, &t);
+ *
+ * sc_epoch_enter(&t);
+ * // Read shared structure
+ * sc_epoch_exit(&t);
+ *
+ * sc_epoch_enter(&t);
+ * // Unlink 'item' with a CAS
+ * sc_epoch_retire(&t, &item->node, item_free);
+ * sc_epoch_exit(&t);
+ *
+ * sc_epoch_unregister(&t);
+ */
+
+// Embed into the object to be retired, get the object back in the free
+// callback with offsetof().
+struct sc_epoch_node
+{
+    struct sc_epoch_node *next;
+    void (*free_fn)(struct sc_epoch_node *node);
+};
+
+// Each slot is on a separate cache line.
+struct sc_epoch_slot
+{
+    uint64_t state; // (epoch << 1) | 1 inside a critical section, otherwise 0.
+    uint64_t used;
+    char pad[48];
+};
+
+struct sc_epoch
+{
+    uint64_t global;
+    char pad0[56];
+    uint64_t high;
+    struct sc_epoch_node *orphans;
+    char pad1[48];
+    struct sc_epoch_slot slots[SC_EPOCH_THREADS];
+};
+
+// Per thread state, owned by a single thread.
+struct sc_epoch_thread
+{
+    struct sc_epoch *epoch;
+    struct sc_epoch_slot *slot;
+    uint32_t depth;
+    size_t count;
+    uint64_t epochs[3];
+    struct sc_epoch_node *limbo[3];
+};
+
+/**
+ * @param e epoch
+ */
+void sc_epoch_init(struct sc_epoch *e);
+
+/**
+ * Frees objects left by unregistered threads. All threads must be
+ * unregistered before.
+ *
+ * @param e epoch
+ */
+void sc_epoch_term(struct sc_epoch *e);
+
+/**
+ * Register calling thread. 't' becomes the current record of the thread for
+ * the allocation hooks.
+ *
+ * @param e epoch
+ * @param t thread record, must stay valid until sc_epoch_unregister().
+ * @return  '0' on success, '-1' if SC_EPOCH_THREADS threads are registered.
+ */
+int sc_epoch_register(struct sc_epoch *e, struct sc_epoch_thread *t);
+
+/**
+ * Objects that can't be freed yet are handed over to the epoch, they are
+ * adopted by the next sc_epoch_collect() call of any thread or freed by
+ * sc_epoch_term().
+ *
+ * @param t thread record
+ */
+void sc_epoch_unregister(struct sc_epoch_thread *t);
+
+/**
+ * Enter a critical section, calls can be nested.
+ * @param t thread record
+ */
+void sc_epoch_enter(struct sc_epoch_thread *t);
+
+/**
+ * Exit critical section.
+ * @param t thread record
+ */
+void sc_epoch_exit(struct sc_epoch_thread *t);
+
+/**
+ * Defer free of an unlinked object. 'free_fn' is called with 'node' when no
+ * thread can hold a reference to the object anymore. It can be called inside
+ * or outside of a critical section.
+ *
+ * @param t       thread record
+ * @param node    node embedded into the object
+ * @param free_fn free callback, called on this thread.
+ */
+void sc_epoch_retire(struct sc_epoch_thread *t, struct sc_epoch_node *node,
+                     void (*free_fn)(struct sc_epoch_node *));
+
+/**
+ * Try to advance the global epoch and free retired objects that are safe to
+ * free. Call at quiescent points.
+ *
+ * @param t thread record
+ * @return  freed object count.
+ */
+size_t sc_epoch_collect(struct sc_epoch_thread *t);
+
+/**
+ * @param t thread record
+ * @return  retired objects of this thread that are not freed yet.
+ */
+size_t sc_epoch_pending(struct sc_epoch_thread *t);
+
+/**
+ * Read-copy-update pointer, for read-mostly data that is replaced as a whole,
+ * e.g. a routing table in an sc_map.
+ *
+ * Writers build a new version and publish it, readers get the current
+ * version inside a critical section without any lock. Replaced versions are
+ * freed with 'free_fn' after a grace period, when no reader can hold them.
+ *
+ * struct sc_rcu rcu;
+ * struct sc_map_str *routes;
+ *
+ * sc_rcu_init(&rcu, initial, routes_free);
+ *
+ * // Reader
+ * sc_epoch_enter(&t);
+ * routes = sc_rcu_get(&rcu);
+ * sc_map_get_str(routes, "/path", &val);
+ * sc_epoch_exit(&t);
+ *
+ * // Writer
+ * routes = routes_build();
+ * sc_rcu_publish(&rcu, &t, routes);
+ */
+struct sc_rcu
+{
+    void *ptr;
+    void (*free_fn)(void *ptr);
+};
+
+/**
+ * @param r       rcu
+ * @param ptr     initial version, can be NULL.
+ * @param free_fn called with replaced versions.
+ */
+void sc_rcu_init(struct sc_rcu *r, void *ptr, void (*free_fn)(void *));
+
+/**
+ * Frees current version immediately, readers must be done.
+ * @param r rcu
+ */
+void sc_rcu_term(struct sc_rcu *r);
+
+/**
+ * Call inside sc_epoch_enter()/sc_epoch_exit(), returned version is valid
+ * until sc_epoch_exit().
+ *
+ * @param r rcu
+ * @return  current version.
+ */
+void *sc_rcu_get(struct sc_rcu *r);
+
+/**
+ * Publish a new version, previous one is retired through 't'. Safe to call
+ * from multiple writers.
+ *
+ * @param r   rcu
+ * @param t   thread record of the writer
+ * @param ptr new version
+ * @return    'false' on out of memory, 'ptr' is not published.
+ */
+bool sc_rcu_publish(struct sc_rcu *r, struct sc_epoch_thread *t, void *ptr);
+
+/**
+ * Allocator hooks, malloc() compatible functions to plug into modules with
+ * SC_HAVE_CONFIG_H, e.g. :
+ *
+ * #define sc_cmap_calloc sc_epoch_hook_calloc
+ * #define sc_cmap_free   sc_epoch_hook_free
+ *
+ * Free defers the release through the current record of the calling thread,
+ * set by sc_epoch_register(), so memory a structure frees internally stays
+ * valid for readers inside a critical section. Memory is freed immediately
+ * if the calling thread is not registered. Realloc always moves the memory.
+ */
+void *sc_epoch_hook_malloc(size_t size);
+void *sc_epoch_hook_calloc(size_t n, size_t size);
+void *sc_epoch_hook_realloc(void *p, size_t size);
+void sc_epoch_hook_free(void *p);
+
+#endif
@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 int example(void)
 {
@@ -159,6 +160,199 @@ void test3(void)
     sc_heap_term(&heap);
 }
 
+struct job
+{
+    struct sc_heap_node node;
+    int64_t key;
+};
+
+#define JOB_COUNT 1000
+
+void test_indexed(uint32_t arity)
+{
+    int64_t key, min;
+    struct job jobs[JOB_COUNT], *job;
+    struct sc_heap_node *node;
+    struct sc_iheap heap;
+    size_t size = 0;
+
+    assert(sc_iheap_init(&heap, 0, arity));
+    assert(sc_iheap_peek(&heap, &key) == NULL);
+    assert(sc_iheap_pop(&heap, NULL) == NULL);
+
+    for (int i = 0; i < JOB_COUNT; i++) {
+        sc_heap_node_init(&jobs[i].node);
+        assert(!sc_heap_node_queued(&jobs[i].node));
+    }
+
+    for (int i = 0; i < 100000; i++) {
+        job = &jobs[rand() % JOB_COUNT];
+
+        switch (rand() % 4) {
+        case 0:
+            if (!sc_heap_node_queued(&job->node)) {
+                job->key = rand() % 1000;
+                assert(sc_iheap_add(&heap, &job->node, job->key));
+                size++;
+            }
+            break;
+        case 1:
+            if (sc_heap_node_queued(&job->node)) {
+                job->key = rand() % 1000;
+                sc_iheap_update(&heap, &job->node, job->key);
+                assert(sc_iheap_key(&heap, &job->node) == job->key);
+            }
+            break;
+        case 2:
+            if (sc_heap_node_queued(&job->node)) {
+                sc_iheap_remove(&heap, &job->node);
+                assert(!sc_heap_node_queued(&job->node));
+                size--;
+            }
+            break;
+        case 3:
+            min = INT64_MAX;
+            for (int j = 0; j < JOB_COUNT; j++) {
+                if (sc_heap_node_queued(&jobs[j].node) && jobs[j].key < min) {
+                    min = jobs[j].key;
+                }
+            }
+
+            node = sc_iheap_pop(&heap, &key);
+            if (size == 0) {
+                assert(node == NULL);
+                break;
+            }
+
+            size--;
+            job = (struct job *) node;
+            assert(key == min);
+            assert(job->key == min);
+            assert(!sc_heap_node_queued(node));
+            break;
+        }
+
+        assert(sc_iheap_size(&heap) == size);
+    }
+
+    for (int64_t prev = INT64_MIN; (node = sc_iheap_pop(&heap, &key));) {
+        assert(key >= prev);
+        prev = key;
+    }
+
+    assert(sc_iheap_size(&heap) == 0);
+    sc_iheap_clear(&heap);
+    sc_iheap_term(&heap);
+}
+
+void test_indexed_arity(void)
+{
+    struct sc_iheap heap;
+
+    assert(!sc_iheap_init(&heap, 0, 0));
+    assert(!sc_iheap_init(&heap, 0, 3));
+    assert(!sc_iheap_init(&heap, 0, 16));
+    assert(!sc_iheap_init(&heap, SIZE_MAX / 2, 2));
+
+    test_indexed(2);
+    test_indexed(4);
+    test_indexed(8);
+}
+
+static int cmp_key(const void *a, const void *b)
+{
+    int64_t x = ((const struct sc_heap_data *) a)->key;
+    int64_t y = ((const struct sc_heap_data *) b)->key;
+
+    return (x > y) - (x < y);
+}
+
+void test_build(void)
+{
+    static struct sc_heap_data items[8000], out[8000], sorted[8000];
+    struct sc_heap heap;
+    size_t n, total = 0;
+    int64_t key;
+    void *data;
+
+    assert(sc_heap_init(&heap, 0));
+    assert(sc_heap_build(&heap, items, 0));
+    assert(sc_heap_pop_n(&heap, out, 10) == 0);
+
+    for (int i = 0; i < 8000; i++) {
+        items[i].key = rand() % 5000 - 2500;
+        items[i].data = (void *) (uintptr_t) i;
+        sorted[i] = items[i];
+    }
+
+    qsort(sorted, 8000, sizeof(sorted[0]), cmp_key);
+
+    // Build into an empty heap, then add more to a non-empty heap.
+    assert(sc_heap_build(&heap, items, 6000));
+    assert(sc_heap_size(&heap) == 6000);
+    assert(sc_heap_add(&heap, items[6000].key, items[6000].data));
+    assert(sc_heap_build(&heap, &items[6001], 1999));
+    assert(sc_heap_size(&heap) == 8000);
+
+    while ((n = sc_heap_pop_n(&heap, out, 777)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            int64_t k = items[(uintptr_t) out[i].data].key;
+
+            assert(out[i].key == sorted[total + i].key);
+            assert(k == out[i].key);
+        }
+        total += n;
+    }
+
+    assert(total == 8000);
+    assert(!sc_heap_pop(&heap, &key, &data));
+
+    // Rebuild after clear.
+    sc_heap_clear(&heap);
+    assert(sc_heap_build(&heap, items, 10));
+    assert(sc_heap_pop_n(&heap, out, 100) == 10);
+    for (size_t i = 1; i < 10; i++) {
+        assert(out[i - 1].key <= out[i].key);
+    }
+
+    sc_heap_term(&heap);
+}
+
+void test_wrap(void)
+{
+    int64_t key;
+    void *data;
+    struct sc_heap heap;
+    struct sc_heap_data elems[9];
+    struct sc_heap_data items[3] = {{3, NULL}, {1, NULL}, {2, NULL}};
+
+    sc_heap_wrap(&heap, elems, 9);
+    assert(sc_heap_size(&heap) == 0);
+    assert(!sc_heap_peek(&heap, &key, &data));
+
+    for (int i = 8; i > 0; i--) {
+        assert(sc_heap_add(&heap, i, NULL));
+    }
+
+    // Full, nothing is allocated.
+    assert(!sc_heap_add(&heap, 0, NULL));
+    assert(!sc_heap_reserve(&heap, 9));
+    assert(sc_heap_reserve(&heap, 8));
+    assert(!sc_heap_build(&heap, items, 1));
+    assert(sc_heap_size(&heap) == 8);
+
+    for (int i = 1; i <= 8; i++) {
+        assert(sc_heap_pop(&heap, &key, &data));
+        assert(key == i);
+    }
+
+    assert(sc_heap_build(&heap, items, 3));
+    assert(sc_heap_pop(&heap, &key, &data) && key == 1);
+    sc_heap_clear(&heap);
+    assert(sc_heap_add(&heap, 5, NULL));
+    sc_heap_term(&heap);
+}
+
 #ifdef SC_HAVE_WRAP
 
 bool fail_malloc = false;
@@ -215,6 +409,52 @@ void fail_test(void)
     assert(sc_heap_init(&heap, 1) == true);
 
     sc_heap_term(&heap);
+
+    struct sc_heap_data items[16] = {{0}};
+
+    assert(sc_heap_init(&heap, 0));
+    assert(!sc_heap_reserve(&heap, SIZE_MAX));
+    assert(sc_heap_reserve(&heap, 100));
+
+    fail_realloc = true;
+    for (int i = 0; i < 100; i++) {
+        assert(sc_heap_add(&heap, i, NULL));
+    }
+    assert(sc_heap_reserve(&heap, 50));
+    assert(!sc_heap_add(&heap, 100, NULL));
+    assert(sc_heap_size(&heap) == 100);
+    assert(!sc_heap_build(&heap, items, 16));
+    assert(sc_heap_size(&heap) == 100);
+    fail_realloc = false;
+
+    assert(!sc_heap_build(&heap, items, SIZE_MAX / 2));
+    assert(sc_heap_build(&heap, items, 16));
+    assert(sc_heap_size(&heap) == 116);
+    sc_heap_term(&heap);
+
+    struct sc_iheap iheap;
+    struct sc_heap_node nodes[5];
+
+    fail_malloc = true;
+    assert(!sc_iheap_init(&iheap, 1, 4));
+    fail_malloc = false;
+
+    assert(sc_iheap_init(&iheap, 0, 4));
+    fail_realloc = true;
+    assert(!sc_iheap_add(&iheap, &nodes[0], 1));
+    fail_realloc = false;
+
+    for (int i = 0; i < 4; i++) {
+        assert(sc_iheap_add(&iheap, &nodes[i], 5 - i));
+    }
+
+    fail_realloc = true;
+    assert(!sc_iheap_add(&iheap, &nodes[4], 1));
+    fail_realloc = false;
+    assert(sc_iheap_size(&iheap) == 4);
+    assert(sc_iheap_pop(&iheap, NULL) == &nodes[3]);
+
+    sc_iheap_term(&iheap);
 }
 #else
 void fail_test()
@@ -229,6 +469,9 @@ int main()
     test1();
     test2();
     test3();
+    test_indexed_arity();
+    test_build();
+    test_wrap();
 
     return 0;
 }
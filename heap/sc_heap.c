@@ -25,12 +25,21 @@
 #include "sc_heap.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef SC_SIZE_MAX
     #define SC_SIZE_MAX SIZE_MAX
 #endif
 
-#define SC_CAP_MAX SC_SIZE_MAX / sizeof(struct sc_heap_data)
+#ifdef SC_STATS
+    #include "sc_stats.h"
+#elif !defined(SC_STATS_ADD)
+    #define SC_STATS_ADD(name, n) ((void) (n))
+    #define SC_STATS_MAX(name, v) ((void) (v))
+#endif
+
+#define SC_CAP_MAX  SC_SIZE_MAX / sizeof(struct sc_heap_data)
+#define SC_ICAP_MAX SC_SIZE_MAX / sizeof(struct sc_iheap_data)
 
 bool sc_heap_init(struct sc_heap *heap, size_t cap)
 {
@@ -54,14 +63,20 @@ bool sc_heap_init(struct sc_heap *heap, size_t cap)
     return true;
 }
 
-void sc_heap_term(struct sc_heap *heap)
+void sc_heap_wrap(struct sc_heap *heap, struct sc_heap_data *elems, size_t n)
 {
-    sc_heap_free(heap->elems);
+    *heap = (struct sc_heap){
+            .cap = n,
+            .elems = elems,
+            .ref = true,
+    };
 }
 
-size_t sc_heap_size(struct sc_heap *heap)
+void sc_heap_term(struct sc_heap *heap)
 {
-    return heap->size;
+    if (!heap->ref) {
+        sc_heap_free(heap->elems);
+    }
 }
 
 void sc_heap_clear(struct sc_heap *heap)
@@ -69,25 +84,55 @@ void sc_heap_clear(struct sc_heap *heap)
     heap->size = 0;
 }
 
+// Elements are at [1, size], 'cap' must be greater than element count.
+static bool sc_heap_expand(struct sc_heap *heap, size_t cap)
+{
+    void *exp;
+    const size_t m = cap * sizeof(struct sc_heap_data);
+
+    if (heap->ref) {
+        return false;
+    }
+
+    // Check overflow
+    if (cap > SC_CAP_MAX || (exp = sc_heap_realloc(heap->elems, m)) == NULL) {
+        return false;
+    }
+
+    SC_STATS_ADD("heap.expand", 1);
+    heap->elems = exp;
+    heap->cap = cap;
+
+    return true;
+}
+
+bool sc_heap_reserve(struct sc_heap *heap, size_t n)
+{
+    if (n >= SC_CAP_MAX) {
+        return false;
+    }
+
+    return n < heap->cap || sc_heap_expand(heap, n + 1);
+}
+
 bool sc_heap_add(struct sc_heap *heap, int64_t key, void *data)
 {
     size_t i;
-    void *exp;
 
-    if (++heap->size >= heap->cap) {
-        const size_t cap = heap->cap != 0 ? heap->cap * 2 : 4;
-        const size_t m = cap * 2 * sizeof(struct sc_heap_data);
+    if (heap->size + 1 >= heap->cap) {
+        size_t cap = heap->cap != 0 ? heap->cap * 2 : 4;
+
         // Check overflow
-        if (heap->cap >= SC_CAP_MAX / 2 ||
-            (exp = sc_heap_realloc(heap->elems, m)) == NULL) {
-            return false;
+        if (heap->cap > SC_CAP_MAX / 2) {
+            cap = SC_CAP_MAX;
         }
 
-        heap->elems = exp;
-        heap->cap = cap;
+        if (heap->size + 1 >= cap || !sc_heap_expand(heap, cap)) {
+            return false;
+        }
     }
 
-    i = heap->size;
+    i = ++heap->size;
     while (i != 1 && key < heap->elems[i / 2].key) {
         heap->elems[i] = heap->elems[i / 2];
         i /= 2;
@@ -99,22 +144,33 @@ bool sc_heap_add(struct sc_heap *heap, int64_t key, void *data)
     return true;
 }
 
-bool sc_heap_peek(struct sc_heap *heap, int64_t *key, void **data)
+// Moves 'elem' down from 'i' until its children are not smaller.
+static void sc_heap_down(struct sc_heap *heap, size_t i,
+                         struct sc_heap_data elem)
 {
-    if (heap->size == 0) {
-        return false;
-    }
+    size_t child = i * 2;
 
-    // Top element is always at heap->elems[1].
-    *key = heap->elems[1].key;
-    *data = heap->elems[1].data;
+    while (child <= heap->size) {
+        if (child < heap->size &&
+            heap->elems[child].key > heap->elems[child + 1].key) {
+            child++;
+        }
 
-    return true;
+        if (elem.key <= heap->elems[child].key) {
+            break;
+        }
+
+        heap->elems[i] = heap->elems[child];
+
+        i = child;
+        child *= 2;
+    }
+
+    heap->elems[i] = elem;
 }
 
 bool sc_heap_pop(struct sc_heap *heap, int64_t *key, void **data)
 {
-    size_t i = 1, child = 2;
     struct sc_heap_data last;
 
     if (heap->size == 0) {
@@ -126,23 +182,233 @@ bool sc_heap_pop(struct sc_heap *heap, int64_t *key, void **data)
     *data = heap->elems[1].data;
 
     last = heap->elems[heap->size--];
-    while (child <= heap->size) {
-        if (child < heap->size &&
-            heap->elems[child].key > heap->elems[child + 1].key) {
-            child++;
-        };
+    sc_heap_down(heap, 1, last);
+
+    return true;
+}
+
+bool sc_heap_build(struct sc_heap *heap, const struct sc_heap_data *items,
+                   size_t n)
+{
+    if (n == 0) {
+        return true;
+    }
+
+    if (n > SC_CAP_MAX - 1 - heap->size ||
+        !sc_heap_reserve(heap, heap->size + n)) {
+        return false;
+    }
+
+    memcpy(&heap->elems[heap->size + 1], items, n * sizeof(*items));
+    heap->size += n;
+
+    // Floyd's heapify, sifts down every parent starting from the last one.
+    // Most elements are near the bottom and move a few levels, O(n) total.
+    for (size_t i = heap->size / 2; i >= 1; i--) {
+        sc_heap_down(heap, i, heap->elems[i]);
+    }
+
+    return true;
+}
+
+size_t sc_heap_pop_n(struct sc_heap *heap, struct sc_heap_data *items,
+                     size_t n)
+{
+    size_t count = n < heap->size ? n : heap->size;
+
+    for (size_t i = 0; i < count; i++) {
+        items[i] = heap->elems[1];
+        sc_heap_down(heap, 1, heap->elems[heap->size--]);
+    }
+
+    return count;
+}
+
+bool sc_iheap_init(struct sc_iheap *heap, size_t cap, uint32_t arity)
+{
+    void *elems;
+    const size_t alloc = cap * sizeof(struct sc_iheap_data);
+
+    *heap = (struct sc_iheap){0};
+
+    if (arity != 2 && arity != 4 && arity != 8) {
+        return false;
+    }
+
+    while (((uint32_t) 1 << heap->shift) != arity) {
+        heap->shift++;
+    }
 
-        if (last.key <= heap->elems[child].key) {
+    if (cap == 0) {
+        return true;
+    }
+
+    // Check overflow
+    if (cap > SC_ICAP_MAX || (elems = sc_heap_malloc(alloc)) == NULL) {
+        return false;
+    }
+
+    heap->elems = elems;
+    heap->cap = cap;
+
+    return true;
+}
+
+void sc_iheap_term(struct sc_iheap *heap)
+{
+    sc_heap_free(heap->elems);
+}
+
+void sc_iheap_clear(struct sc_iheap *heap)
+{
+    heap->size = 0;
+}
+
+void sc_heap_node_init(struct sc_heap_node *node)
+{
+    node->index = SC_HEAP_NONE;
+}
+
+bool sc_heap_node_queued(struct sc_heap_node *node)
+{
+    return node->index != SC_HEAP_NONE;
+}
+
+static void sc_iheap_set(struct sc_iheap *heap, size_t i,
+                         struct sc_iheap_data elem)
+{
+    heap->elems[i] = elem;
+    elem.node->index = i;
+}
+
+static void sc_iheap_up(struct sc_iheap *heap, size_t i,
+                        struct sc_iheap_data elem)
+{
+    size_t parent;
+
+    while (i != 0) {
+        parent = (i - 1) >> heap->shift;
+        if (elem.key >= heap->elems[parent].key) {
             break;
         }
 
-        heap->elems[i] = heap->elems[child];
+        sc_iheap_set(heap, i, heap->elems[parent]);
+        i = parent;
+    }
 
-        i = child;
-        child *= 2;
+    sc_iheap_set(heap, i, elem);
+}
+
+static void sc_iheap_down(struct sc_iheap *heap, size_t i,
+                          struct sc_iheap_data elem)
+{
+    size_t child, end, min;
+
+    while ((child = (i << heap->shift) + 1) < heap->size) {
+        end = child + ((size_t) 1 << heap->shift);
+        end = end < heap->size ? end : heap->size;
+
+        // Children are adjacent, scanning them is a sequential read.
+        for (min = child++; child < end; child++) {
+            if (heap->elems[child].key < heap->elems[min].key) {
+                min = child;
+            }
+        }
+
+        if (elem.key <= heap->elems[min].key) {
+            break;
+        }
+
+        sc_iheap_set(heap, i, heap->elems[min]);
+        i = min;
     }
 
-    heap->elems[i] = last;
+    sc_iheap_set(heap, i, elem);
+}
+
+bool sc_iheap_add(struct sc_iheap *heap, struct sc_heap_node *node,
+                  int64_t key)
+{
+    void *exp;
+
+    if (heap->size == heap->cap) {
+        const size_t cap = heap->cap != 0 ? heap->cap * 2 : 4;
+        const size_t m = cap * sizeof(struct sc_iheap_data);
+        // Check overflow
+        if (heap->cap >= SC_ICAP_MAX / 2 ||
+            (exp = sc_heap_realloc(heap->elems, m)) == NULL) {
+            return false;
+        }
+
+        heap->elems = exp;
+        heap->cap = cap;
+    }
+
+    heap->size++;
+    sc_iheap_up(heap, heap->size - 1,
+                (struct sc_iheap_data){.key = key, .node = node});
 
     return true;
 }
+
+void sc_iheap_update(struct sc_iheap *heap, struct sc_heap_node *node,
+                     int64_t key)
+{
+    size_t i = node->index;
+    struct sc_iheap_data elem = {.key = key, .node = node};
+
+    if (key < heap->elems[i].key) {
+        sc_iheap_up(heap, i, elem);
+    } else {
+        sc_iheap_down(heap, i, elem);
+    }
+}
+
+void sc_iheap_remove(struct sc_iheap *heap, struct sc_heap_node *node)
+{
+    size_t i = node->index;
+    struct sc_iheap_data last = heap->elems[--heap->size];
+
+    node->index = SC_HEAP_NONE;
+
+    if (i == heap->size) {
+        return;
+    }
+
+    // Last element takes the removed node's place, it may need to go either
+    // way, removed node might be in a different subtree.
+    if (last.key < heap->elems[i].key) {
+        sc_iheap_up(heap, i, last);
+    } else {
+        sc_iheap_down(heap, i, last);
+    }
+}
+
+int64_t sc_iheap_key(struct sc_iheap *heap, struct sc_heap_node *node)
+{
+    return heap->elems[node->index].key;
+}
+
+struct sc_heap_node *sc_iheap_peek(struct sc_iheap *heap, int64_t *key)
+{
+    if (heap->size == 0) {
+        return NULL;
+    }
+
+    if (key != NULL) {
+        *key = heap->elems[0].key;
+    }
+
+    return heap->elems[0].node;
+}
+
+struct sc_heap_node *sc_iheap_pop(struct sc_iheap *heap, int64_t *key)
+{
+    struct sc_heap_node *node = sc_iheap_peek(heap, key);
+
+    if (node != NULL) {
+        sc_iheap_remove(heap, node);
+    }
+
+    return node;
+}
@@ -49,6 +49,7 @@ struct sc_heap
     size_t cap;
     size_t size;
     struct sc_heap_data *elems;
+    bool ref;
 };
 
 /**
@@ -58,6 +59,23 @@ struct sc_heap
  */
 bool sc_heap_init(struct sc_heap *heap, size_t cap);
 
+/**
+ * Create a fixed capacity heap on caller provided memory, e.g stack or memory
+ * allocated at startup. Heap never allocates : sc_heap_add() and
+ * sc_heap_build() fail when it is full, sc_heap_term() does not free 'elems'.
+ *
+ * struct sc_heap heap;
+ * struct sc_heap_data elems[65];
+ *
+ * sc_heap_wrap(&heap, elems, 65); // Holds 64 elements.
+ *
+ * @param heap  heap
+ * @param elems memory, must outlive the heap.
+ * @param n     element count of 'elems', heap holds 'n - 1' elements as the
+ *              first slot is not used.
+ */
+void sc_heap_wrap(struct sc_heap *heap, struct sc_heap_data *elems, size_t n);
+
 /**
  * Destroys heap, frees memory
  * @param heap heap
@@ -68,7 +86,10 @@ void sc_heap_term(struct sc_heap *heap);
  * @param heap heap
  * @return     element count
  */
-size_t sc_heap_size(struct sc_heap *heap);
+static inline size_t sc_heap_size(struct sc_heap *heap)
+{
+    return heap->size;
+}
 
 /**
  * Clears elements from the queue, does not free the allocated memory.
@@ -76,6 +97,16 @@ size_t sc_heap_size(struct sc_heap *heap);
  */
 void sc_heap_clear(struct sc_heap *heap);
 
+/**
+ * Reserve memory for 'n' elements in total, so adding elements up to 'n' does
+ * not allocate.
+ *
+ * @param heap heap
+ * @param n    element count
+ * @return     'false' on out of memory.
+ */
+bool sc_heap_reserve(struct sc_heap *heap, size_t n);
+
 /**
  * @param heap heap
  * @param key  key
@@ -84,6 +115,19 @@ void sc_heap_clear(struct sc_heap *heap);
  */
 bool sc_heap_add(struct sc_heap *heap, int64_t key, void *data);
 
+/**
+ * Add 'n' elements at once and heapify in O(size + n), faster than 'n'
+ * sc_heap_add() calls which is O(n log n). Prefer this to rebuild a heap, e.g
+ * sc_heap_clear() and then sc_heap_build() with all the elements.
+ *
+ * @param heap  heap
+ * @param items elements to add
+ * @param n     element count
+ * @return      'false' on out of memory, heap is not modified.
+ */
+bool sc_heap_build(struct sc_heap *heap, const struct sc_heap_data *items,
+                   size_t n);
+
 /**
  * Read top element without removing from the heap.
  *
@@ -92,7 +136,19 @@ bool sc_heap_add(struct sc_heap *heap, int64_t key, void *data);
  * @param data [out] data
  * @return     'false' if there is no element in the heap.
  */
-bool sc_heap_peek(struct sc_heap *heap, int64_t *key, void **data);
+static inline bool sc_heap_peek(struct sc_heap *heap, int64_t *key,
+                                void **data)
+{
+    if (heap->size == 0) {
+        return false;
+    }
+
+    // Top element is always at heap->elems[1].
+    *key = heap->elems[1].key;
+    *data = heap->elems[1].data;
+
+    return true;
+}
 
 /**
  * Read top element and remove it from the heap.
@@ -104,5 +160,148 @@ bool sc_heap_peek(struct sc_heap *heap, int64_t *key, void **data);
  */
 bool sc_heap_pop(struct sc_heap *heap, int64_t *key, void **data);
 
+/**
+ * Remove up to 'n' top elements, 'items' are in pop order, smallest first.
+ *
+ * @param heap  heap
+ * @param items [out] elements, must have room for 'n' elements.
+ * @param n     max element count
+ * @return      element count written to 'items'.
+ */
+size_t sc_heap_pop_n(struct sc_heap *heap, struct sc_heap_data *items,
+                     size_t n);
+
+/**
+ * Indexed heap
+ *
+ * Min-heap of caller-owned nodes. Each node knows its position in the heap,
+ * so a node's key can be updated or a node can be removed in O(log n).
+ * Embed 'struct sc_heap_node' into your struct, e.g
+ *
+ * struct job {
+ *     struct sc_heap_node node;
+ *     int id;
+ * };
+ *
+ * Keys are kept in the heap array next to the node pointers, so comparisons
+ * do not touch the nodes. d-ary layout is optional, a 4-ary heap has half the
+ * depth of a binary heap and siblings share a cache line.
+ */
+
+#define SC_HEAP_NONE SIZE_MAX
+
+struct sc_heap_node
+{
+    size_t index;
+};
+
+struct sc_iheap_data
+{
+    int64_t key;
+    struct sc_heap_node *node;
+};
+
+struct sc_iheap
+{
+    size_t cap;
+    size_t size;
+    uint32_t shift;
+    struct sc_iheap_data *elems;
+};
+
+/**
+ * @param heap  heap
+ * @param cap   initial capacity, pass '0' for no initial memory allocation
+ * @param arity children per node, must be 2, 4 or 8.
+ * @return      'true' on success, 'false' on out of memory or invalid arity.
+ */
+bool sc_iheap_init(struct sc_iheap *heap, size_t cap, uint32_t arity);
+
+/**
+ * Destroys heap, frees memory. Nodes are not touched.
+ * @param heap heap
+ */
+void sc_iheap_term(struct sc_iheap *heap);
+
+/**
+ * @param heap heap
+ * @return     element count
+ */
+static inline size_t sc_iheap_size(struct sc_iheap *heap)
+{
+    return heap->size;
+}
+
+/**
+ * Removes all nodes, does not free the allocated memory. Nodes' indexes are
+ * not reset, call sc_heap_node_init() before reusing them.
+ * @param heap heap
+ */
+void sc_iheap_clear(struct sc_iheap *heap);
+
+/**
+ * Initialize node, a node is not in a heap after init.
+ * @param node node
+ */
+void sc_heap_node_init(struct sc_heap_node *node);
+
+/**
+ * @param node node
+ * @return     'true' if node is in a heap.
+ */
+bool sc_heap_node_queued(struct sc_heap_node *node);
+
+/**
+ * @param heap heap
+ * @param node node, must not be in a heap.
+ * @param key  key
+ * @return     'false' on out of memory.
+ */
+bool sc_iheap_add(struct sc_iheap *heap, struct sc_heap_node *node,
+                  int64_t key);
+
+/**
+ * Change key of a node in O(log n).
+ *
+ * @param heap heap
+ * @param node node, must be in the heap.
+ * @param key  new key
+ */
+void sc_iheap_update(struct sc_iheap *heap, struct sc_heap_node *node,
+                     int64_t key);
+
+/**
+ * Remove a node in O(log n).
+ *
+ * @param heap heap
+ * @param node node, must be in the heap.
+ */
+void sc_iheap_remove(struct sc_iheap *heap, struct sc_heap_node *node);
+
+/**
+ * @param heap heap
+ * @param node node, must be in the heap.
+ * @return     key of the node
+ */
+int64_t sc_iheap_key(struct sc_iheap *heap, struct sc_heap_node *node);
+
+/**
+ * Read top node without removing from the heap.
+ *
+ * @param heap heap
+ * @param key  [out] key, can be NULL.
+ * @return     top node, NULL if there is no element in the heap.
+ */
+struct sc_heap_node *sc_iheap_peek(struct sc_iheap *heap, int64_t *key);
+
+/**
+ * Read top node and remove it from the heap.
+ *
+ * @param heap heap
+ * @param key  [out] key, can be NULL.
+ * @return     top node, NULL if there is no element in the heap.
+ */
+struct sc_heap_node *sc_iheap_pop(struct sc_iheap *heap, int64_t *key);
+
 
 #endif
@@ -0,0 +1,27 @@
+#include "sc_hist.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int main()
+{
+    struct sc_hist h, total;
+
+    sc_hist_init(&h);
+    sc_hist_init(&total);
+
+    // e.g. request latencies in nanoseconds
+    for (int i = 0; i < 100000; i++) {
+        sc_hist_record(&h, 1000 + (uint64_t) (rand() % 1000));
+    }
+    sc_hist_record(&h, 50000);
+
+    printf("p50 : %llu ns \n", (unsigned long long) sc_hist_percentile(&h, 50));
+    printf("p99 : %llu ns \n", (unsigned long long) sc_hist_percentile(&h, 99));
+
+    // Merge per thread histograms to get the total
+    sc_hist_merge(&total, &h);
+    sc_hist_print(&total, stdout, "request");
+
+    return 0;
+}
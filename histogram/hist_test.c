@@ -0,0 +1,184 @@
+#include "sc_hist.h"
+#include "sc_thread.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+static struct sc_hist h1, h2, h3;
+
+// Relative error of a percentile against the exact value.
+static bool close_to(uint64_t v, uint64_t exact)
+{
+    uint64_t diff = v > exact ? v - exact : exact - v;
+
+    return diff <= exact / (SC_HIST_SUB / 2) + 1;
+}
+
+void test_empty(void)
+{
+    sc_hist_init(&h1);
+    assert(sc_hist_count(&h1) == 0);
+    assert(sc_hist_min(&h1) == 0);
+    assert(sc_hist_max(&h1) == 0);
+    assert(sc_hist_mean(&h1) == 0);
+    assert(sc_hist_percentile(&h1, 50) == 0);
+    sc_hist_print(&h1, stdout, NULL);
+}
+
+void test_exact(void)
+{
+    sc_hist_init(&h1);
+
+    // Small values have a bucket each.
+    for (uint64_t i = 0; i < 2 * SC_HIST_SUB; i++) {
+        sc_hist_record(&h1, i);
+    }
+
+    assert(sc_hist_count(&h1) == 2 * SC_HIST_SUB);
+    assert(sc_hist_min(&h1) == 0);
+    assert(sc_hist_max(&h1) == 2 * SC_HIST_SUB - 1);
+    assert(sc_hist_percentile(&h1, 0) == 0);
+    assert(sc_hist_percentile(&h1, 50) == SC_HIST_SUB - 1);
+    assert(sc_hist_percentile(&h1, 100) == 2 * SC_HIST_SUB - 1);
+    assert(sc_hist_percentile(&h1, -1) == 0);
+    assert(sc_hist_percentile(&h1, 200) == 2 * SC_HIST_SUB - 1);
+}
+
+void test_percentile(void)
+{
+    sc_hist_init(&h1);
+
+    for (uint64_t i = 1; i <= 100000; i++) {
+        sc_hist_record(&h1, i * 1000);
+    }
+
+    assert(sc_hist_count(&h1) == 100000);
+    assert(sc_hist_min(&h1) == 1000);
+    assert(sc_hist_max(&h1) == 100000000);
+    assert(close_to((uint64_t) sc_hist_mean(&h1), 50000500));
+    assert(close_to(sc_hist_percentile(&h1, 50), 50000000));
+    assert(close_to(sc_hist_percentile(&h1, 90), 90000000));
+    assert(close_to(sc_hist_percentile(&h1, 99), 99000000));
+    assert(close_to(sc_hist_percentile(&h1, 99.9), 99900000));
+    assert(sc_hist_percentile(&h1, 100) == 100000000);
+    assert(sc_hist_percentile(&h1, 0) == 1000);
+
+    // Percentiles are monotonic.
+    for (int p = 1; p <= 100; p++) {
+        assert(sc_hist_percentile(&h1, p) >= sc_hist_percentile(&h1, p - 1));
+    }
+
+    sc_hist_print(&h1, stdout, "test");
+
+    sc_hist_reset(&h1);
+    assert(sc_hist_count(&h1) == 0);
+    assert(sc_hist_percentile(&h1, 99) == 0);
+
+    // Extremes
+    sc_hist_record(&h1, UINT64_MAX);
+    sc_hist_record(&h1, UINT64_MAX - 1);
+    sc_hist_record(&h1, (uint64_t) 1 << 63);
+    assert(sc_hist_percentile(&h1, 100) == UINT64_MAX);
+    assert(sc_hist_percentile(&h1, 0) == (uint64_t) 1 << 63);
+    assert(sc_hist_min(&h1) == (uint64_t) 1 << 63);
+
+    // Errors are relative, for all magnitudes.
+    for (int i = 0; i < 64; i++) {
+        uint64_t v = ((uint64_t) 1 << i) + ((uint64_t) 1 << i) / 3;
+
+        sc_hist_reset(&h1);
+        sc_hist_record(&h1, 0);
+        sc_hist_record(&h1, v);
+        sc_hist_record(&h1, UINT64_MAX);
+        assert(close_to(sc_hist_percentile(&h1, 50), v));
+    }
+
+    sc_hist_reset(&h1);
+    sc_hist_record_n(&h1, 500, 99);
+    sc_hist_record_n(&h1, 100000, 1);
+    assert(sc_hist_count(&h1) == 100);
+    assert(close_to(sc_hist_percentile(&h1, 99), 500));
+    assert(sc_hist_percentile(&h1, 99.5) == 100000);
+}
+
+void test_merge(void)
+{
+    sc_hist_init(&h1);
+    sc_hist_init(&h2);
+    sc_hist_init(&h3);
+
+    for (uint64_t i = 1; i <= 1000; i++) {
+        sc_hist_record(&h1, i);
+        sc_hist_record(&h2, i + 1000);
+    }
+
+    sc_hist_merge(&h3, &h1);
+    sc_hist_merge(&h3, &h2);
+
+    // Empty source is a no-op.
+    sc_hist_reset(&h1);
+    sc_hist_merge(&h3, &h1);
+
+    assert(sc_hist_count(&h3) == 2000);
+    assert(sc_hist_min(&h3) == 1);
+    assert(sc_hist_max(&h3) == 2000);
+    assert(close_to(sc_hist_percentile(&h3, 50), 1000));
+    assert(close_to((uint64_t) sc_hist_mean(&h3), 1000));
+}
+
+#define RECORDS 1000000
+
+static void *writer(void *arg)
+{
+    struct sc_hist *h = arg;
+
+    for (uint64_t i = 0; i < RECORDS; i++) {
+        sc_hist_record(h, i % 1000);
+    }
+
+    return NULL;
+}
+
+void test_threads(void)
+{
+    struct sc_thread threads[2];
+
+    sc_hist_init(&h1);
+    sc_hist_init(&h2);
+
+    sc_thread_init(&threads[0]);
+    sc_thread_init(&threads[1]);
+    assert(sc_thread_start(&threads[0], writer, &h1) == 0);
+    assert(sc_thread_start(&threads[1], writer, &h2) == 0);
+
+    // Readers take snapshots while the owners keep recording.
+    for (int i = 0; i < 100; i++) {
+        sc_hist_init(&h3);
+        sc_hist_merge(&h3, &h1);
+        sc_hist_merge(&h3, &h2);
+        assert(sc_hist_count(&h3) <= 2 * RECORDS);
+        assert(sc_hist_percentile(&h3, 99) < 1000);
+    }
+
+    assert(sc_thread_term(&threads[0]) == 0);
+    assert(sc_thread_term(&threads[1]) == 0);
+
+    sc_hist_init(&h3);
+    sc_hist_merge(&h3, &h1);
+    sc_hist_merge(&h3, &h2);
+    assert(sc_hist_count(&h3) == 2 * RECORDS);
+    assert(sc_hist_max(&h3) == 999);
+    assert(close_to(sc_hist_percentile(&h3, 50), 500));
+}
+
+int main(void)
+{
+    test_empty();
+    test_exact();
+    test_percentile();
+    test_merge();
+    test_threads();
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sc_hist.h"
+
+#include <string.h>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+
+    #define sc_hist_load(p)     (*(volatile uint64_t *) (p))
+    #define sc_hist_store(p, v) (*(volatile uint64_t *) (p) = (v))
+#else
+    // Single writer, so a relaxed load and store is enough, no RMW needed.
+    #define sc_hist_load(p)     __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_hist_store(p, v) __atomic_store_n(p, v, __ATOMIC_RELAXED)
+#endif
+
+static int sc_hist_msb(uint64_t v)
+{
+#if defined(_MSC_VER)
+    unsigned long i;
+
+    _BitScanReverse64(&i, v);
+    return (int) i;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+// Values below 2 * SC_HIST_SUB have a bucket each. Above that, values in
+// [2^k, 2^(k+1)) are split into SC_HIST_SUB buckets of equal width.
+static size_t sc_hist_index(uint64_t v)
+{
+    int e;
+
+    if (v < 2 * SC_HIST_SUB) {
+        return (size_t) v;
+    }
+
+    e = sc_hist_msb(v) - SC_HIST_SUB_BITS;
+
+    return (size_t) e * SC_HIST_SUB + (size_t) (v >> e);
+}
+
+// Highest value that maps to bucket 'i'.
+static uint64_t sc_hist_upper(size_t i)
+{
+    int e;
+    uint64_t m;
+
+    if (i < 2 * SC_HIST_SUB) {
+        return i;
+    }
+
+    e = (int) (i / SC_HIST_SUB) - 1;
+    m = i - (size_t) e * SC_HIST_SUB;
+
+    // Wraps to UINT64_MAX for the last bucket.
+    return ((m + 1) << e) - 1;
+}
+
+void sc_hist_init(struct sc_hist *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void sc_hist_reset(struct sc_hist *h)
+{
+    for (size_t i = 0; i < SC_HIST_BUCKETS; i++) {
+        sc_hist_store(&h->counts[i], 0);
+    }
+
+    sc_hist_store(&h->count, 0);
+    sc_hist_store(&h->sum, 0);
+    sc_hist_store(&h->min, UINT64_MAX);
+    sc_hist_store(&h->max, 0);
+}
+
+void sc_hist_record_n(struct sc_hist *h, uint64_t v, uint64_t n)
+{
+    uint64_t *c = &h->counts[sc_hist_index(v)];
+
+    sc_hist_store(c, sc_hist_load(c) + n);
+    sc_hist_store(&h->count, sc_hist_load(&h->count) + n);
+    sc_hist_store(&h->sum, sc_hist_load(&h->sum) + v * n);
+
+    if (v < sc_hist_load(&h->min)) {
+        sc_hist_store(&h->min, v);
+    }
+
+    if (v > sc_hist_load(&h->max)) {
+        sc_hist_store(&h->max, v);
+    }
+}
+
+void sc_hist_record(struct sc_hist *h, uint64_t v)
+{
+    sc_hist_record_n(h, v, 1);
+}
+
+void sc_hist_merge(struct sc_hist *dst, struct sc_hist *src)
+{
+    uint64_t n, total = 0;
+    uint64_t min = sc_hist_load(&src->min);
+    uint64_t max = sc_hist_load(&src->max);
+
+    // Count is the sum of buckets read, so percentiles of 'dst' stay
+    // consistent even if 'src' is written meanwhile.
+    for (size_t i = 0; i < SC_HIST_BUCKETS; i++) {
+        n = sc_hist_load(&src->counts[i]);
+        if (n != 0) {
+            sc_hist_store(&dst->counts[i], dst->counts[i] + n);
+            total += n;
+        }
+    }
+
+    if (total == 0) {
+        return;
+    }
+
+    sc_hist_store(&dst->count, dst->count + total);
+    sc_hist_store(&dst->sum, dst->sum + sc_hist_load(&src->sum));
+
+    if (min < dst->min) {
+        sc_hist_store(&dst->min, min);
+    }
+
+    if (max > dst->max) {
+        sc_hist_store(&dst->max, max);
+    }
+}
+
+uint64_t sc_hist_percentile(struct sc_hist *h, double p)
+{
+    double r;
+    uint64_t rank, total = 0, count = sc_hist_load(&h->count);
+    uint64_t min, max;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    min = sc_hist_load(&h->min);
+    max = sc_hist_load(&h->max);
+
+    if (p <= 0) {
+        return min;
+    }
+
+    p = p > 100 ? 100 : p;
+    r = p / 100.0 * (double) count;
+    rank = (uint64_t) r;
+    rank += ((double) rank < r);
+    rank = rank == 0 ? 1 : rank > count ? count : rank;
+
+    for (size_t i = 0; i < SC_HIST_BUCKETS; i++) {
+        total += sc_hist_load(&h->counts[i]);
+        if (total >= rank) {
+            uint64_t v = sc_hist_upper(i);
+            return v < min ? min : v > max ? max : v;
+        }
+    }
+
+    return max;
+}
+
+uint64_t sc_hist_count(struct sc_hist *h)
+{
+    return sc_hist_load(&h->count);
+}
+
+uint64_t sc_hist_min(struct sc_hist *h)
+{
+    return sc_hist_load(&h->count) == 0 ? 0 : sc_hist_load(&h->min);
+}
+
+uint64_t sc_hist_max(struct sc_hist *h)
+{
+    return sc_hist_load(&h->max);
+}
+
+double sc_hist_mean(struct sc_hist *h)
+{
+    uint64_t count = sc_hist_load(&h->count);
+
+    if (count == 0) {
+        return 0;
+    }
+
+    return (double) sc_hist_load(&h->sum) / (double) count;
+}
+
+void sc_hist_print(struct sc_hist *h, FILE *fp, const char *name)
+{
+    fprintf(fp,
+            "%s%scount=%llu min=%llu mean=%.1f p50=%llu p90=%llu p99=%llu "
+            "p99.9=%llu max=%llu\n",
+            name ? name : "", name ? " " : "",
+            (unsigned long long) sc_hist_count(h),
+            (unsigned long long) sc_hist_min(h), sc_hist_mean(h),
+            (unsigned long long) sc_hist_percentile(h, 50),
+            (unsigned long long) sc_hist_percentile(h, 90),
+            (unsigned long long) sc_hist_percentile(h, 99),
+            (unsigned long long) sc_hist_percentile(h, 99.9),
+            (unsigned long long) sc_hist_max(h));
+}
@@ -0,0 +1,150 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_HIST_H
+#define SC_HIST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Sub-buckets per power of two, as a power of two. Bucket width is
+ * 2^(e - SC_HIST_SUB_BITS) for values in [2^e, 2^(e+1)), so the relative
+ * error of a recorded value is below 2^-SC_HIST_SUB_BITS, 1.6% for 6. Values
+ * below 2^(SC_HIST_SUB_BITS + 1) are exact.
+ *
+ * Memory is 8 * (65 - SC_HIST_SUB_BITS) * 2^SC_HIST_SUB_BITS bytes, ~30 kb
+ * for 6.
+ */
+#ifndef SC_HIST_SUB_BITS
+    #define SC_HIST_SUB_BITS 6
+#endif
+
+#define SC_HIST_SUB     (1 << SC_HIST_SUB_BITS)
+#define SC_HIST_BUCKETS ((65 - SC_HIST_SUB_BITS) * SC_HIST_SUB)
+
+/**
+ * Log-linear histogram of uint64_t values, e.g. latencies in nanoseconds,
+ * covers the full range of uint64_t. Recording is a few instructions and
+ * never allocates.
+ *
+ * A histogram has a single writer, typically one histogram per thread.
+ * Counters are updated with relaxed atomic stores, so other threads can read
+ * it without locks with sc_hist_merge() while the owner keeps recording.
+ * For a process wide p99, merge the per thread histograms into a local one
+ * and query that.
+ */
+struct sc_hist
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t counts[SC_HIST_BUCKETS];
+};
+
+/**
+ * @param h histogram
+ */
+void sc_hist_init(struct sc_hist *h);
+
+/**
+ * Clears all values, must be called by the owner thread.
+ * @param h histogram
+ */
+void sc_hist_reset(struct sc_hist *h);
+
+/**
+ * Record a value, must be called by the owner thread only.
+ *
+ * @param h histogram
+ * @param v value
+ */
+void sc_hist_record(struct sc_hist *h, uint64_t v);
+
+/**
+ * Record a value 'n' times.
+ *
+ * @param h histogram
+ * @param v value
+ * @param n count
+ */
+void sc_hist_record_n(struct sc_hist *h, uint64_t v, uint64_t n);
+
+/**
+ * Add values of 'src' to 'dst'. 'src' may be recorded concurrently by its
+ * owner, then the snapshot may miss the values recorded during the merge.
+ * 'dst' must not be shared.
+ *
+ * @param dst destination
+ * @param src source
+ */
+void sc_hist_merge(struct sc_hist *dst, struct sc_hist *src);
+
+/**
+ * Value at percentile 'p', e.g. 99.9. Returned value is the upper bound of
+ * the bucket, clamped to [min, max] of recorded values, so p0 is the min and
+ * p100 is the max.
+ *
+ * @param h histogram
+ * @param p percentile in [0, 100]
+ * @return  value, '0' if histogram is empty.
+ */
+uint64_t sc_hist_percentile(struct sc_hist *h, double p);
+
+/**
+ * @param h histogram
+ * @return  value count
+ */
+uint64_t sc_hist_count(struct sc_hist *h);
+
+/**
+ * @param h histogram
+ * @return  minimum value, '0' if histogram is empty.
+ */
+uint64_t sc_hist_min(struct sc_hist *h);
+
+/**
+ * @param h histogram
+ * @return  maximum value, '0' if histogram is empty.
+ */
+uint64_t sc_hist_max(struct sc_hist *h);
+
+/**
+ * @param h histogram
+ * @return  mean of values, '0' if histogram is empty.
+ */
+double sc_hist_mean(struct sc_hist *h);
+
+/**
+ * Print a one line summary,
+ * e.g. "poll count=1000 min=1 mean=2.5 p50=2 p90=4 p99=9 p99.9=12 max=14"
+ *
+ * @param h    histogram
+ * @param fp   file
+ * @param name label, NULL for none.
+ */
+void sc_hist_print(struct sc_hist *h, FILE *fp, const char *name);
+
+#endif
@@ -491,6 +491,224 @@ void example(void)
     file_example();
 }
 
+struct record
+{
+    char buf[4096];
+    size_t len;
+};
+
+int cb_record(void *arg, int line, const char *section, const char *key,
+              const char *value)
+{
+    struct record *r = arg;
+
+    r->len += (size_t) snprintf(r->buf + r->len, sizeof(r->buf) - r->len,
+                                "%d|%s|%s|%s\n", line, section, key, value);
+    return strcmp(value, "stop") == 0;
+}
+
+int cb_record_span(void *arg, int line, struct sc_ini_span section,
+                   struct sc_ini_span key, struct sc_ini_span value)
+{
+    struct record *r = arg;
+
+    r->len += (size_t) snprintf(r->buf + r->len, sizeof(r->buf) - r->len,
+                                "%d|%.*s|%.*s|%.*s\n", line, (int) section.len,
+                                section.str, (int) key.len, key.str,
+                                (int) value.len, value.str);
+    return value.len == 4 && memcmp(value.str, "stop", 4) == 0;
+}
+
+void test_span(void)
+{
+    int rc1, rc2;
+    char *big;
+    struct record r1, r2;
+    static const char *inputs[] = {
+            "",
+            "\n\n",
+            "\xEF\xBB\xBF[section]\nkey=value",
+            "key1 = value1  ;Comment x\nkey2 : value2  #Comment y\n",
+            ";comment\n#comment\n [ sec ] ;c\n a = b ; c\n  d\n\te\n",
+            "[s]\nk = v;notcomment\nk2 = #v\nk3 = v #c\n",
+            "[s]\r\nk = v\r\n  cont\r\n",
+            "cont before key\n",
+            "  cont before key\n",
+            "[s]\nnokey\n",
+            "[s\nk = v\n",
+            "[s] x\n = v\n w\n",
+            "a = 1\nb = stop\nc = 3\n",
+            "[Network]\nhostname = github.com\n github.io\n github.org \n",
+    };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        r1.len = 0;
+        r2.len = 0;
+        r1.buf[0] = '\0';
+        r2.buf[0] = '\0';
+
+        rc1 = sc_ini_parse_string(&r1, cb_record, inputs[i]);
+        rc2 = sc_ini_parse_buf(&r2, cb_record_span, inputs[i],
+                               strlen(inputs[i]));
+        assert(rc1 == rc2);
+        assert(r1.len == r2.len);
+        assert(strcmp(r1.buf, r2.buf) == 0);
+    }
+
+    // Not null terminated.
+    r2.len = 0;
+    assert(sc_ini_parse_buf(&r2, cb_record_span, "k = value", 7) == 0);
+    assert(strcmp(r2.buf, "1||k|val\n") == 0);
+
+    // No line length limit.
+    big = malloc(10000);
+    memset(big, 'x', 10000);
+    memcpy(big, "key = ", 6);
+    r2.len = 0;
+    assert(sc_ini_parse_buf(&r2, cb_record_span, big, 10000) == 0);
+    assert(r2.len == strlen("1||key|") + 9994 + 1);
+    free(big);
+}
+
+#ifdef SC_INI_HAVE_MMAP
+void test_mmap(void)
+{
+    FILE *fp;
+    struct record r;
+    static const char *ini = "[section]\nkey = value\n  value2\n";
+
+    r.len = 0;
+    assert(sc_ini_parse_mmap(&r, cb_record_span, "not_exists.ini") == -1);
+
+    fp = fopen("mmap.ini", "w+");
+    fclose(fp);
+    assert(sc_ini_parse_mmap(&r, cb_record_span, "mmap.ini") == 0);
+    assert(r.len == 0);
+
+    fp = fopen("mmap.ini", "w+");
+    fwrite(ini, 1, strlen(ini), fp);
+    fclose(fp);
+    assert(sc_ini_parse_mmap(&r, cb_record_span, "mmap.ini") == 0);
+    assert(strcmp(r.buf, "2|section|key|value\n3|section|key|value2\n") == 0);
+
+    fp = fopen("mmap.ini", "w+");
+    fprintf(fp, "[section]\nkey\n");
+    fclose(fp);
+    assert(sc_ini_parse_mmap(&r, cb_record_span, "mmap.ini") == 2);
+    remove("mmap.ini");
+}
+#else
+void test_mmap(void)
+{
+}
+#endif
+
+#ifdef SC_INI_HAVE_MAP
+void test_map(void)
+{
+    int rc;
+    FILE *fp;
+    struct sc_ini_map m;
+    static const char *ini = "key0 = value0\n"
+                             "[section1]\n"
+                             "key1 = value1\n"
+                             "key2 = value2 ;comment\n"
+                             "[section2]\n"
+                             "key1 = x\n"
+                             "multi = a\n"
+                             "  b\n";
+
+    sc_ini_map_init(&m);
+    assert(sc_ini_map_size(&m) == 0);
+    assert(sc_ini_map_get(&m, "key0") == NULL);
+    sc_ini_map_term(&m);
+
+    rc = sc_ini_map_load_string(&m, ini);
+    assert(rc == 0);
+    assert(m.changed);
+    assert(sc_ini_map_size(&m) == 5);
+    assert(strcmp(sc_ini_map_get(&m, "key0"), "value0") == 0);
+    assert(strcmp(sc_ini_map_get(&m, "section1.key1"), "value1") == 0);
+    assert(strcmp(sc_ini_map_get(&m, "section1.key2"), "value2") == 0);
+    assert(strcmp(sc_ini_map_get(&m, "section2.key1"), "x") == 0);
+    assert(strcmp(sc_ini_map_get(&m, "section2.multi"), "b") == 0);
+    assert(sc_ini_map_get(&m, "key1") == NULL);
+    assert(sc_ini_map_get(&m, "section3.key1") == NULL);
+
+    // Same content is not parsed again.
+    rc = sc_ini_map_load_string(&m, ini);
+    assert(rc == 0);
+    assert(!m.changed);
+
+    // Parse error keeps previous items.
+    rc = sc_ini_map_load_string(&m, "key = value\n[section\n");
+    assert(rc == 2);
+    assert(strcmp(sc_ini_map_get(&m, "section1.key1"), "value1") == 0);
+
+    rc = sc_ini_map_load_string(&m, "");
+    assert(rc == 0);
+    assert(m.changed);
+    assert(sc_ini_map_size(&m) == 0);
+    sc_ini_map_term(&m);
+
+    // File
+    remove("map.ini");
+    assert(sc_ini_map_load_file(&m, "map.ini") == -1);
+
+    fp = fopen("map.ini", "w+");
+    fwrite(ini, 1, strlen(ini), fp);
+    fclose(fp);
+
+    assert(sc_ini_map_load_file(&m, "map.ini") == 0);
+    assert(m.changed);
+    assert(strcmp(sc_ini_map_get(&m, "section2.key1"), "x") == 0);
+    assert(sc_ini_map_load_file(&m, "map.ini") == 0);
+    assert(!m.changed);
+
+    // Rewritten with the same content, stat may differ but hash is same.
+    fp = fopen("map.ini", "w+");
+    fwrite(ini, 1, strlen(ini), fp);
+    fclose(fp);
+    m.mtime_sec = -1;
+    assert(sc_ini_map_load_file(&m, "map.ini") == 0);
+    assert(!m.changed);
+    assert(sc_ini_map_load_file(&m, "map.ini") == 0);
+    assert(!m.changed);
+
+    // Same size, different content.
+    fp = fopen("map.ini", "w+");
+    fwrite(ini, 1, strlen(ini) - 2, fp);
+    fprintf(fp, "c\n");
+    fclose(fp);
+    m.mtime_sec = -1;
+    assert(sc_ini_map_load_file(&m, "map.ini") == 0);
+    assert(m.changed);
+    assert(strcmp(sc_ini_map_get(&m, "section2.multi"), "c") == 0);
+
+    // Large file
+    fp = fopen("map.ini", "w+");
+    for (int i = 0; i < 1000; i++) {
+        fprintf(fp, "[s%d]\n", i);
+        for (int j = 0; j < 10; j++) {
+            fprintf(fp, "key%d = value%d\n", j, i * 10 + j);
+        }
+    }
+    fclose(fp);
+
+    assert(sc_ini_map_load_file(&m, "map.ini") == 0);
+    assert(m.changed);
+    assert(sc_ini_map_size(&m) == 10000);
+    assert(strcmp(sc_ini_map_get(&m, "s0.key0"), "value0") == 0);
+    assert(strcmp(sc_ini_map_get(&m, "s999.key9"), "value9999") == 0);
+    sc_ini_map_term(&m);
+    remove("map.ini");
+}
+#else
+void test_map(void)
+{
+}
+#endif
+
 #ifdef SC_HAVE_WRAP
 
 int fail_ferror = 0;
@@ -533,6 +751,19 @@ void test_fail()
     rc = sc_ini_parse_file(NULL, cb_fail, "config.ini");
     assert(rc == -1);
     fail_ferror = false;
+
+#ifdef SC_INI_HAVE_MAP
+    struct sc_ini_map m;
+
+    sc_ini_map_init(&m);
+    fail_ferror = true;
+    assert(sc_ini_map_load_file(&m, "config.ini") == -1);
+    fail_ferror = false;
+    assert(sc_ini_map_get(&m, "section.key") == NULL);
+    assert(sc_ini_map_load_file(&m, "config.ini") == 0);
+    assert(strcmp(sc_ini_map_get(&m, "section.key"), "value2") == 0);
+    sc_ini_map_term(&m);
+#endif
 }
 #else
 void test_fail()
@@ -557,6 +788,9 @@ int main()
     test11();
     test12();
     test13();
+    test_span();
+    test_mmap();
+    test_map();
     test_fail();
 
     return 0;
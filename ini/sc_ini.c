@@ -26,12 +26,24 @@
  * Copyright (C) 2009-2020, Ben Hoyt
  */
 
+#ifndef _XOPEN_SOURCE
+    #define _XOPEN_SOURCE 700
+#endif
+
 #include "sc_ini.h"
 
 #include <ctype.h>
 #include <stdint.h>
 #include <string.h>
 
+#if defined(SC_INI_HAVE_MAP) || defined(SC_INI_HAVE_MMAP)
+    #include <sys/stat.h>
+#endif
+
+#ifdef SC_INI_HAVE_SCAN
+    #include "sc_scan.h"
+#endif
+
 #if defined(_WIN32) || defined(_WIN64)
     #pragma warning(disable : 4996)
 #endif
@@ -188,3 +200,415 @@ int sc_ini_parse_string(void *arg, sc_ini_on_item cb, const char *str)
 
     return sc_ini_parse(arg, cb, &ptr, string_next_line);
 }
+
+static bool is_comment(char c)
+{
+    return c == ';' || c == '#';
+}
+
+/*
+ * Line end, separator and comment bytes are found with a single forward scan,
+ * vectorized with SC_INI_HAVE_SCAN.
+ */
+#define INI_SPECIAL "\n=:;#"
+
+#ifdef SC_INI_HAVE_SCAN
+
+typedef struct sc_scan_set ini_scan;
+
+static void scan_init(ini_scan *scan)
+{
+    sc_scan_set_init(scan, INI_SPECIAL, sizeof(INI_SPECIAL) - 1);
+}
+
+static const char *scan_next(const ini_scan *scan, const char *s,
+                             const char *e)
+{
+    return s + sc_scan_find(scan, s, (size_t) (e - s));
+}
+
+#else
+
+typedef int ini_scan;
+
+static void scan_init(ini_scan *scan)
+{
+    *scan = 0;
+}
+
+static const char *scan_next(const ini_scan *scan, const char *s,
+                             const char *e)
+{
+    (void) scan;
+
+    while (s < e && *s != '\n' && *s != '=' && *s != ':' && !is_comment(*s)) {
+        s++;
+    }
+
+    return s;
+}
+
+#endif
+
+static struct sc_ini_span span_trim(const char *s, const char *e)
+{
+    while (s < e && isspace((unsigned char) *s)) {
+        s++;
+    }
+
+    while (e > s && isspace((unsigned char) e[-1])) {
+        e--;
+    }
+
+    return (struct sc_ini_span){.str = s, .len = (size_t) (e - s)};
+}
+
+int sc_ini_parse_buf(void *arg, sc_ini_on_span cb, const char *buf, size_t len)
+{
+    int rc, line = 0;
+    const char *p = buf, *end = buf + len;
+    const char *s, *e, *sep, *eol, *close;
+    struct sc_ini_span section = {buf, 0}, key = {buf, 0}, head, val;
+    ini_scan scan;
+
+    scan_init(&scan);
+
+    if (len >= 3 && (uint8_t) p[0] == 0xEF && (uint8_t) p[1] == 0xBB &&
+        (uint8_t) p[2] == 0xBF) {
+        p += 3;
+    }
+
+    for (; p < end; p = eol + 1) {
+        line++;
+
+        // Single scan for the line end, the separator and the comment start,
+        // a comment starts at the beginning of the line or after a space.
+        sep = NULL;
+        eol = NULL;
+        for (e = scan_next(&scan, p, end); e < end;
+             e = scan_next(&scan, e + 1, end)) {
+            if (*e == '\n') {
+                eol = e;
+                break;
+            }
+
+            if (is_comment(*e) && (e == p || e[-1] == ' ')) {
+                break;
+            }
+
+            if (sep == NULL && (*e == '=' || *e == ':')) {
+                sep = e;
+            }
+        }
+
+        if (eol == NULL) {
+            eol = memchr(e, '\n', (size_t) (end - e));
+            if (eol == NULL) {
+                eol = end;
+            }
+        }
+
+        head = span_trim(p, e);
+        if (head.len == 0) {
+            continue;
+        }
+
+        s = head.str;
+        e = head.str + head.len;
+
+        if (s > p && key.len > 0) {
+            rc = cb(arg, line, section, key, head);
+        } else if (*s == '[') {
+            close = memchr(s, ']', head.len);
+            if (close == NULL) {
+                return line;
+            }
+
+            section = (struct sc_ini_span){s + 1, (size_t) (close - s - 1)};
+            key.len = 0;
+            continue;
+        } else {
+            if (sep == NULL) {
+                return line;
+            }
+
+            key = span_trim(s, sep);
+            val = span_trim(sep + 1, e);
+            rc = cb(arg, line, section, key, val);
+        }
+
+        if (rc != 0) {
+            return line;
+        }
+    }
+
+    return 0;
+}
+
+#ifdef SC_INI_HAVE_MMAP
+
+int sc_ini_parse_mmap(void *arg, sc_ini_on_span cb, const char *filename)
+{
+    int rc;
+    struct stat st;
+    struct sc_mmap m;
+
+    if (stat(filename, &st) != 0) {
+        return -1;
+    }
+
+    // Empty files can't be mapped.
+    if (st.st_size == 0) {
+        return 0;
+    }
+
+    rc = sc_mmap_init(&m, filename, O_RDONLY, PROT_READ, MAP_SHARED, 0, 0);
+    if (rc != 0) {
+        return -1;
+    }
+
+    sc_mmap_advise(&m, 0, m.len, SC_MMAP_SEQUENTIAL | SC_MMAP_WILLNEED);
+    rc = sc_ini_parse_buf(arg, cb, (const char *) m.ptr, m.len);
+    sc_mmap_term(&m);
+
+    return rc;
+}
+
+#endif
+
+#ifdef SC_INI_HAVE_MAP
+
+struct sc_ini_items
+{
+    char *mem;
+    size_t len;
+    size_t cap;
+    uint32_t count;
+    bool oom;
+};
+
+static int items_on_item(void *arg, int line, struct sc_ini_span section,
+                         struct sc_ini_span key, struct sc_ini_span value)
+{
+    char *mem;
+    size_t cap;
+    struct sc_ini_items *items = arg;
+    size_t need = section.len + key.len + value.len + 3;
+
+    (void) line;
+
+    if (items->cap - items->len < need) {
+        cap = items->cap * 2 > items->len + need ? items->cap * 2 :
+                                                   items->len + need;
+        mem = sc_ini_realloc(items->mem, cap);
+        if (mem == NULL) {
+            items->oom = true;
+            return -1;
+        }
+
+        items->mem = mem;
+        items->cap = cap;
+    }
+
+    // Items are appended as "section.key\0value\0", pointers are taken once
+    // parsing is done as 'mem' may move while growing.
+    mem = items->mem + items->len;
+    if (section.len > 0) {
+        memcpy(mem, section.str, section.len);
+        mem += section.len;
+        *mem++ = '.';
+    }
+
+    memcpy(mem, key.str, key.len);
+    mem += key.len;
+    *mem++ = '\0';
+    memcpy(mem, value.str, value.len);
+    mem += value.len;
+    *mem++ = '\0';
+
+    items->len = (size_t) (mem - items->mem);
+    items->count++;
+
+    return 0;
+}
+
+static uint64_t ini_hash(const char *str, size_t len)
+{
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char) str[i];
+        h *= 1099511628211ull;
+    }
+
+    return h;
+}
+
+static int ini_map_build(struct sc_ini_map *m, const char *str, size_t len,
+                         uint64_t hash)
+{
+    int rc;
+    char *p;
+    const char *key;
+    struct sc_map_str map;
+    struct sc_ini_items items;
+
+    // Items take roughly the size of the input, section prefixes and
+    // comments aside.
+    items.cap = len + 64;
+    items.len = 0;
+    items.count = 0;
+    items.oom = false;
+    items.mem = sc_ini_malloc(items.cap);
+    if (items.mem == NULL) {
+        return -1;
+    }
+
+    rc = sc_ini_parse_buf(&items, items_on_item, str, len);
+    if (rc != 0) {
+        sc_ini_free(items.mem);
+        return items.oom ? -1 : rc;
+    }
+
+    if (!sc_map_init_str(&map, items.count, 0)) {
+        sc_ini_free(items.mem);
+        return -1;
+    }
+
+    p = items.mem;
+    for (uint32_t i = 0; i < items.count; i++) {
+        key = p;
+        p += strlen(p) + 1;
+
+        if (!sc_map_put_str(&map, key, p)) {
+            sc_map_term_str(&map);
+            sc_ini_free(items.mem);
+            return -1;
+        }
+
+        p += strlen(p) + 1;
+    }
+
+    sc_ini_map_term(m);
+
+    m->map = map;
+    m->mem = items.mem;
+    m->size = len;
+    m->hash = hash;
+    m->changed = true;
+
+    return 0;
+}
+
+void sc_ini_map_init(struct sc_ini_map *m)
+{
+    *m = (struct sc_ini_map){0};
+    m->mtime_sec = -1;
+}
+
+void sc_ini_map_term(struct sc_ini_map *m)
+{
+    if (m->mem != NULL) {
+        sc_map_term_str(&m->map);
+        sc_ini_free(m->mem);
+    }
+
+    sc_ini_map_init(m);
+}
+
+int sc_ini_map_load_string(struct sc_ini_map *m, const char *str)
+{
+    size_t len = strlen(str);
+    uint64_t hash = ini_hash(str, len);
+
+    if (m->mem != NULL && m->size == len && m->hash == hash) {
+        m->changed = false;
+        return 0;
+    }
+
+    return ini_map_build(m, str, len, hash);
+}
+
+int sc_ini_map_load_file(struct sc_ini_map *m, const char *filename)
+{
+    int rc;
+    char *buf;
+    size_t len;
+    uint64_t hash;
+    int64_t nsec = 0;
+    FILE *file;
+    struct stat st;
+
+    if (stat(filename, &st) != 0 || st.st_size < 0) {
+        return -1;
+    }
+
+#if defined(__linux__)
+    nsec = (int64_t) st.st_mtim.tv_nsec;
+#endif
+
+    if (m->mem != NULL && m->size == (uint64_t) st.st_size &&
+        m->mtime_sec == (int64_t) st.st_mtime && m->mtime_nsec == nsec) {
+        m->changed = false;
+        return 0;
+    }
+
+    file = fopen(filename, "rb");
+    if (!file) {
+        return -1;
+    }
+
+    buf = sc_ini_malloc((size_t) st.st_size + 1);
+    if (buf == NULL) {
+        fclose(file);
+        return -1;
+    }
+
+    // File may change after stat(), 'len' is what we have read.
+    len = fread(buf, 1, (size_t) st.st_size, file);
+    if (ferror(file) != 0) {
+        sc_ini_free(buf);
+        fclose(file);
+        return -1;
+    }
+
+    fclose(file);
+    buf[len] = '\0';
+
+    // Touched but the content is the same.
+    hash = ini_hash(buf, len);
+    if (m->mem != NULL && m->size == len && m->hash == hash) {
+        m->changed = false;
+        rc = 0;
+    } else {
+        rc = ini_map_build(m, buf, len, hash);
+    }
+
+    if (rc == 0) {
+        m->mtime_sec = (int64_t) st.st_mtime;
+        m->mtime_nsec = nsec;
+    }
+
+    sc_ini_free(buf);
+
+    return rc;
+}
+
+const char *sc_ini_map_get(struct sc_ini_map *m, const char *key)
+{
+    const char *val;
+
+    if (m->mem == NULL || !sc_map_get_str(&m->map, key, &val)) {
+        return NULL;
+    }
+
+    return val;
+}
+
+uint32_t sc_ini_map_size(struct sc_ini_map *m)
+{
+    return m->mem != NULL ? sc_map_size_str(&m->map) : 0;
+}
+
+#endif
@@ -25,9 +25,27 @@
 #ifndef SC_INI_H
 #define SC_INI_H
 
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#else
+    #define sc_ini_malloc  malloc
+    #define sc_ini_realloc realloc
+    #define sc_ini_free    free
+#endif
+
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+#ifdef SC_INI_HAVE_MAP
+    #include "sc_map.h"
+#endif
+
+#ifdef SC_INI_HAVE_MMAP
+    #include "sc_mmap.h"
+#endif
 
 // Set max line length. If a line is longer, it will be truncated silently.
 #define SC_INI_MAX_LINE_LEN 1024
@@ -65,4 +83,151 @@ int sc_ini_parse_file(void *arg, sc_ini_on_item on_item, const char *filename);
  */
 int sc_ini_parse_string(void *arg, sc_ini_on_item on_item, const char *str);
 
+/**
+ * Length delimited string, points into the parsed buffer, not null terminated.
+ */
+struct sc_ini_span
+{
+    const char *str;
+    size_t len;
+};
+
+/**
+ * @param arg      user arg
+ * @param line     current line number
+ * @param section  section
+ * @param key      key
+ * @param value    value
+ * @return         Return '0' on success, any other value will make parser
+ *                 stop and return error
+ */
+typedef int (*sc_ini_on_span)(void *arg, int line, struct sc_ini_span section,
+                              struct sc_ini_span key, struct sc_ini_span value);
+
+/**
+ * Same syntax as sc_ini_parse_string() but the buffer is tokenized in a single
+ * forward scan without copying lines. Items are passed to the callback as
+ * spans into 'buf', so 'buf' is not modified and does not need to be null
+ * terminated. There is no line length limit. Compile with -DSC_INI_HAVE_SCAN
+ * to find line ends, separators and comments with sc_scan.
+ *
+ * @param arg      user data to be passed to 'on_span' callback.
+ * @param on_span  callback
+ * @param buf      buffer to parse
+ * @param len      buffer length
+ * @return         - '0' on success,
+ *                 - positive line number on parsing error or if 'on_span'
+ *                   returns other than '0'
+ */
+int sc_ini_parse_buf(void *arg, sc_ini_on_span on_span, const char *buf,
+                     size_t len);
+
+#ifdef SC_INI_HAVE_MMAP
+
+/**
+ * Map the file into memory with sc_mmap and parse it with sc_ini_parse_buf(),
+ * requires sc_mmap (compile with -DSC_INI_HAVE_MMAP). Spans are valid only
+ * during the callback.
+ *
+ * @param arg      user data to be passed to 'on_span' callback.
+ * @param on_span  callback
+ * @param filename filename
+ * @return         - '0' on success,
+ *                 - '-1' on file IO error.
+ *                 - positive line number on parsing error or if 'on_span'
+ *                   returns other than '0'
+ */
+int sc_ini_parse_mmap(void *arg, sc_ini_on_span on_span, const char *filename);
+
+#endif
+
+#ifdef SC_INI_HAVE_MAP
+
+/**
+ * Parse into a map, requires sc_map (compile with -DSC_INI_HAVE_MAP).
+ *
+ * Items are stored as "section.key" -> "value", or "key" -> "value" for items
+ * without a section. If a key is repeated, e.g. multi-value lines, the last
+ * value wins. All keys and values live in a single allocation, lookup is a
+ * single hash map probe.
+ *
+ * sc_ini_map_load_file() remembers the size, modification time and content
+ * hash of the file. Calling it again for an unchanged file returns without
+ * reparsing, so it can be called on each reload signal. On error, previous
+ * items are kept.
+ *
+ * struct sc_ini_map ini;
+ * const char *port;
+ *
+ * sc_ini_map_init(&ini);
+ * sc_ini_map_load_file(&ini, "my.ini");
+ * port = sc_ini_map_get(&ini, "Network.port");
+ *
+ * // On SIGHUP
+ * sc_ini_map_load_file(&ini, "my.ini");
+ * if (ini.changed) {
+ *     // Apply new config
+ * }
+ *
+ * sc_ini_map_term(&ini);
+ */
+struct sc_ini_map
+{
+    struct sc_map_str map;
+    char *mem;
+
+    // Set by the last load call, false if the file was unchanged.
+    bool changed;
+
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t hash;
+};
+
+/**
+ * @param m ini map
+ */
+void sc_ini_map_init(struct sc_ini_map *m);
+
+/**
+ * @param m ini map
+ */
+void sc_ini_map_term(struct sc_ini_map *m);
+
+/**
+ * @param m        ini map
+ * @param filename filename
+ * @return         - '0' on success, 'm->changed' is false if file is unchanged
+ *                   since the last successful load.
+ *                 - '-1' on file IO error or out of memory.
+ *                 - positive line number on parsing error
+ */
+int sc_ini_map_load_file(struct sc_ini_map *m, const char *filename);
+
+/**
+ * @param m   ini map
+ * @param str string to parse
+ * @return    - '0' on success, 'm->changed' is false if string is same as the
+ *              last successful load.
+ *            - '-1' on out of memory.
+ *            - positive line number on parsing error
+ */
+int sc_ini_map_load_string(struct sc_ini_map *m, const char *str);
+
+/**
+ * @param m   ini map
+ * @param key "section.key" or "key" for items without a section
+ * @return    value, NULL if not found.
+ */
+const char *sc_ini_map_get(struct sc_ini_map *m, const char *key);
+
+/**
+ * @param m ini map
+ * @return  item count
+ */
+uint32_t sc_ini_map_size(struct sc_ini_map *m);
+
+#endif
+
 #endif
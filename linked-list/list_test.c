@@ -1,6 +1,54 @@
 #include "sc_list.h"
+#include "sc_thread.h"
 
 #include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef SC_HAVE_WRAP
+
+bool fail_malloc = false;
+void *__real_malloc(size_t n);
+void *__wrap_malloc(size_t n)
+{
+    if (fail_malloc) {
+        return NULL;
+    }
+
+    return __real_malloc(n);
+}
+
+static void fail_test(void)
+{
+    struct sc_list_pool pool;
+    struct sc_list_cache cache;
+
+    fail_malloc = true;
+    assert(!sc_list_pool_init(&pool, 32, 0, 4));
+    fail_malloc = false;
+
+    assert(sc_list_pool_init(&pool, 32, 0, 4));
+    sc_list_cache_init(&cache, &pool);
+    fail_malloc = true;
+    assert(sc_list_pool_get(&pool) == NULL);
+    assert(sc_list_cache_get(&cache) == NULL);
+    fail_malloc = false;
+    assert(sc_list_pool_size(&pool) == 0);
+    sc_list_cache_term(&cache);
+    sc_list_pool_term(&pool);
+    sc_list_pool_term(&pool);
+
+    assert(sc_list_pool_init(&pool, SIZE_MAX / 2, 0, 4));
+    assert(sc_list_pool_get(&pool) == NULL);
+    sc_list_pool_term(&pool);
+}
+
+#else
+static void fail_test(void)
+{
+}
+#endif
 
 struct elem
 {
@@ -141,9 +189,320 @@ static void test1(void)
     }
 }
 
+struct conn
+{
+    uint64_t id;
+    int used;
+    struct sc_list node;
+};
+
+static void test_pool(void)
+{
+    struct conn *c, *prev, *conns[100];
+    struct sc_list list, *it, *tmp;
+    struct sc_list_pool pool;
+    size_t n;
+
+    assert(sc_list_pool_init_of(&pool, struct conn, node, 8));
+    sc_list_init(&list);
+
+    // Objects come from a slab, in address order.
+    prev = NULL;
+    for (int i = 0; i < 8; i++) {
+        c = sc_list_pool_get(&pool);
+        assert(c != NULL);
+        assert(sc_list_is_empty(&c->node));
+        if (prev != NULL) {
+            assert(c == prev + 1);
+        }
+        prev = c;
+        c->id = (uint64_t) i;
+        sc_list_add_tail(&list, &c->node);
+    }
+    assert(sc_list_pool_size(&pool) == 8);
+
+    n = 0;
+    sc_list_foreach_safe (&list, tmp, it) {
+        c = sc_list_entry(it, struct conn, node);
+        assert(c->id == n++);
+        sc_list_del(&list, &c->node);
+        sc_list_pool_put(&pool, c);
+    }
+    assert(n == 8);
+
+    // Reused, no new slab.
+    for (int i = 0; i < 100; i++) {
+        conns[i] = sc_list_pool_get(&pool);
+        conns[i]->used = 1;
+    }
+    assert(sc_list_pool_size(&pool) == 104);
+    for (int i = 0; i < 100; i++) {
+        for (int j = i + 1; j < 100; j++) {
+            assert(conns[i] != conns[j]);
+        }
+        sc_list_pool_put(&pool, conns[i]);
+    }
+    for (int i = 0; i < 100; i++) {
+        conns[i] = sc_list_pool_get(&pool);
+    }
+    assert(sc_list_pool_size(&pool) == 104);
+    for (int i = 0; i < 100; i++) {
+        sc_list_pool_put(&pool, conns[i]);
+    }
+
+    sc_list_pool_term(&pool);
+
+    assert(sc_list_pool_init(&pool, sizeof(struct conn),
+                             offsetof(struct conn, node), 0));
+    assert(pool.batch == 64);
+    c = sc_list_pool_get(&pool);
+    assert(c != NULL);
+    sc_list_pool_term(&pool);
+}
+
+static void test_cache(void)
+{
+    struct conn *conns[1000];
+    struct sc_list_pool pool;
+    struct sc_list_cache cache, other;
+
+    assert(sc_list_pool_init_of(&pool, struct conn, node, 16));
+    sc_list_cache_init(&cache, &pool);
+    sc_list_cache_init(&other, &pool);
+
+    for (int r = 0; r < 10; r++) {
+        for (int i = 0; i < 1000; i++) {
+            conns[i] = sc_list_cache_get(r % 2 ? &cache : &other);
+            assert(conns[i] != NULL);
+            conns[i]->used = 1;
+        }
+
+        for (int i = 0; i < 1000; i++) {
+            assert(conns[i]->used == 1);
+            conns[i]->used = 2;
+            sc_list_cache_put(r % 3 ? &cache : &other, conns[i]);
+        }
+    }
+
+    // Caches hold at most two chains each.
+    assert(sc_list_pool_size(&pool) <= 1000 + 4 * 16);
+    assert(cache.cur.count + cache.full.count <= 32);
+
+    sc_list_cache_term(&cache);
+    sc_list_cache_term(&other);
+    sc_list_cache_term(&other);
+
+    for (int i = 0; i < 1000; i++) {
+        conns[i] = sc_list_pool_get(&pool);
+    }
+    sc_list_cache_init(&cache, &pool);
+    for (int i = 0; i < 1000; i++) {
+        sc_list_cache_put(&cache, conns[i]);
+    }
+    sc_list_cache_term(&cache);
+
+    sc_list_pool_term(&pool);
+}
+
+#define THREADS 8
+#define ITEMS   100000
+
+static struct sc_list_pool shared;
+
+static void *worker(void *arg)
+{
+    struct conn *c;
+    struct sc_list list, *it, *tmp;
+    struct sc_list_cache cache;
+    uint64_t id = (uint64_t) (uintptr_t) arg;
+
+    sc_list_init(&list);
+    sc_list_cache_init(&cache, &shared);
+
+    for (int i = 0; i < ITEMS; i++) {
+        c = sc_list_cache_get(&cache);
+        assert(c != NULL);
+        c->id = id;
+        sc_list_add_tail(&list, &c->node);
+
+        if (i % 64 == 63) {
+            sc_list_foreach_safe (&list, tmp, it) {
+                c = sc_list_entry(it, struct conn, node);
+                // Nobody else owns the object.
+                assert(c->id == id);
+                sc_list_del(&list, &c->node);
+                if (i % 128 == 127) {
+                    sc_list_pool_put(&shared, c);
+                } else {
+                    sc_list_cache_put(&cache, c);
+                }
+            }
+        }
+    }
+
+    sc_list_foreach_safe (&list, tmp, it) {
+        c = sc_list_entry(it, struct conn, node);
+        sc_list_del(&list, &c->node);
+        sc_list_cache_put(&cache, c);
+    }
+
+    sc_list_cache_term(&cache);
+
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    struct sc_thread threads[THREADS];
+
+    assert(sc_list_pool_init_of(&shared, struct conn, node, 32));
+
+    for (uintptr_t i = 0; i < THREADS; i++) {
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], worker, (void *) i) == 0);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    assert(sc_list_pool_size(&shared) <= THREADS * (64 + 3 * 32) + 32);
+    sc_list_pool_term(&shared);
+}
+
+static void test_ulist(void)
+{
+    int v, *it, ref[4000];
+    size_t n = 0, k;
+    uint64_t rnd = 0x9e3779b97f4a7c15ull;
+    struct sc_ulist list;
+    struct sc_ulist_pos pos, handles[100];
+
+    sc_ulist_init(&list, sizeof(int), 0);
+    assert(list.node_cap == 64);
+    sc_ulist_term(&list);
+    sc_ulist_init(&list, 1000, 0);
+    assert(list.node_cap == 4);
+    sc_ulist_term(&list);
+    sc_ulist_init(&list, 1, 1000);
+    assert(list.node_cap == SC_ULIST_NODE_MAX);
+    sc_ulist_term(&list);
+
+    sc_ulist_init(&list, sizeof(int), 8);
+    assert(sc_ulist_first(&list, &pos) == NULL);
+    assert(!sc_ulist_pop_head(&list, &v));
+    assert(!sc_ulist_pop_tail(&list, &v));
+
+    for (int i = 0; i < 100; i++) {
+        assert(sc_ulist_add_tail(&list, &i, &handles[i]));
+        assert(*(int *) sc_ulist_at(&list, handles[i]) == i);
+    }
+
+    // Handles stay valid, delete is O(1).
+    for (int i = 0; i < 100; i += 3) {
+        sc_ulist_del(&list, handles[i]);
+    }
+    for (int i = 1; i < 100; i++) {
+        if (i % 3) {
+            assert(*(int *) sc_ulist_at(&list, handles[i]) == i);
+        }
+    }
+
+    k = 0;
+    sc_ulist_foreach (&list, pos, it) {
+        assert(*it % 3 != 0);
+        k++;
+    }
+    assert(k == sc_ulist_size(&list) && k == 66);
+
+    // Delete current element while iterating, empties some nodes.
+    sc_ulist_foreach (&list, pos, it) {
+        if (*it < 50) {
+            sc_ulist_del(&list, pos);
+        }
+    }
+    assert(sc_ulist_pop_head(&list, &v) && v == 50);
+    assert(sc_ulist_pop_tail(&list, &v) && v == 98);
+    assert(sc_ulist_pop_tail(&list, &v) && v == 97);
+    sc_ulist_clear(&list);
+    assert(sc_ulist_size(&list) == 0);
+    assert(sc_ulist_first(&list, &pos) == NULL);
+
+    // Random ops against an array.
+    for (int i = 0; i < 200000; i++) {
+        rnd ^= rnd << 13u;
+        rnd ^= rnd >> 7u;
+        rnd ^= rnd << 17u;
+        v = (int) (rnd >> 40u);
+
+        switch ((rnd >> 8u) % 6) {
+        case 0:
+        case 1:
+            if (n < 4000) {
+                assert(sc_ulist_add_tail(&list, &v, NULL));
+                ref[n++] = v;
+            }
+            break;
+        case 2:
+            if (n < 4000) {
+                assert(sc_ulist_add_head(&list, &v, NULL));
+                memmove(ref + 1, ref, n * sizeof(*ref));
+                ref[0] = v;
+                n++;
+            }
+            break;
+        case 3:
+            assert(sc_ulist_pop_head(&list, &v) == (n > 0));
+            if (n > 0) {
+                assert(v == ref[0]);
+                memmove(ref, ref + 1, --n * sizeof(*ref));
+            }
+            break;
+        case 4:
+            assert(sc_ulist_pop_tail(&list, &v) == (n > 0));
+            if (n > 0) {
+                assert(v == ref[--n]);
+            }
+            break;
+        case 5:
+            // Delete a random element by position.
+            if (n > 0) {
+                size_t d = (size_t) (rnd >> 20u) % n;
+
+                k = 0;
+                sc_ulist_foreach (&list, pos, it) {
+                    if (k++ == d) {
+                        assert(*it == ref[d]);
+                        sc_ulist_del(&list, pos);
+                        break;
+                    }
+                }
+                memmove(ref + d, ref + d + 1, (--n - d) * sizeof(*ref));
+            }
+            break;
+        }
+
+        assert(sc_ulist_size(&list) == n);
+        if (i % 1000 == 0) {
+            k = 0;
+            sc_ulist_foreach (&list, pos, it) {
+                assert(*it == ref[k++]);
+            }
+            assert(k == n);
+        }
+    }
+
+    sc_ulist_term(&list);
+}
+
 int main()
 {
+    fail_test();
     test1();
+    test_pool();
+    test_cache();
+    test_threads();
+    test_ulist();
 
     return 0;
 }
@@ -24,6 +24,9 @@
 
 #include "sc_list.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 void sc_list_init(struct sc_list *list)
 {
     list->next = list;
@@ -36,11 +39,6 @@ void sc_list_clear(struct sc_list *list)
     list->prev = list;
 }
 
-bool sc_list_is_empty(struct sc_list *list)
-{
-    return list->next == list;
-}
-
 size_t sc_list_count(struct sc_list *list)
 {
     size_t count = 0;
@@ -53,30 +51,6 @@ size_t sc_list_count(struct sc_list *list)
     return count;
 }
 
-struct sc_list *sc_list_head(struct sc_list *list)
-{
-    struct sc_list *elem;
-
-    elem = list->next;
-    if (elem == list) {
-        return NULL;
-    }
-
-    return elem;
-}
-
-struct sc_list *sc_list_tail(struct sc_list *list)
-{
-    struct sc_list *elem;
-
-    elem = list->prev;
-    if (elem == list) {
-        return NULL;
-    }
-
-    return elem;
-}
-
 void sc_list_add_tail(struct sc_list *list, struct sc_list *elem)
 {
     struct sc_list *prev;
@@ -156,3 +130,629 @@ void sc_list_del(struct sc_list *list, struct sc_list *elem)
     elem->next = elem;
     elem->prev = elem;
 }
+
+#if defined(_WIN32) || defined(_WIN64)
+
+#include <windows.h>
+
+struct sc_list_lock
+{
+    SRWLOCK mtx;
+};
+
+static int sc_list_lock_init(struct sc_list_lock *l)
+{
+    InitializeSRWLock(&l->mtx);
+    return 0;
+}
+
+static void sc_list_lock_term(struct sc_list_lock *l)
+{
+    (void) l;
+}
+
+static void sc_list_lock(struct sc_list_lock *l)
+{
+    AcquireSRWLockExclusive(&l->mtx);
+}
+
+static void sc_list_unlock(struct sc_list_lock *l)
+{
+    ReleaseSRWLockExclusive(&l->mtx);
+}
+
+#else
+
+#include <pthread.h>
+
+struct sc_list_lock
+{
+    pthread_mutex_t mtx;
+};
+
+static int sc_list_lock_init(struct sc_list_lock *l)
+{
+    return pthread_mutex_init(&l->mtx, NULL);
+}
+
+static void sc_list_lock_term(struct sc_list_lock *l)
+{
+    pthread_mutex_destroy(&l->mtx);
+}
+
+static void sc_list_lock(struct sc_list_lock *l)
+{
+    pthread_mutex_lock(&l->mtx);
+}
+
+static void sc_list_unlock(struct sc_list_lock *l)
+{
+    pthread_mutex_unlock(&l->mtx);
+}
+
+#endif
+
+#define SC_LIST_POOL_BATCH 64
+
+/**
+ * Slab header is padded to 16 bytes to keep objects aligned as malloc()
+ * memory.
+ */
+struct sc_list_slab
+{
+    struct sc_list_slab *next;
+    char pad[16 - sizeof(void *)];
+};
+
+/**
+ * Free objects are in chains, linked with 'next' of the list member and
+ * terminated with NULL. Full chains are linked with 'prev' of their head.
+ */
+struct sc_list_pool_shared
+{
+    struct sc_list_lock lock;
+    struct sc_list *chains;
+    struct sc_list_chain loose;
+    struct sc_list_slab *slabs;
+    size_t size;
+};
+
+#define sc_list_pool_node(pool, obj)                                           \
+    ((struct sc_list *) ((char *) (obj) + (pool)->offset))
+
+#define sc_list_pool_obj(pool, node) ((void *) ((char *) (node) - (pool)->offset))
+
+bool sc_list_pool_init(struct sc_list_pool *pool, size_t size, size_t offset,
+                       uint32_t batch)
+{
+    struct sc_list_pool_shared *shared;
+
+    shared = sc_list_malloc(sizeof(*shared));
+    if (shared == NULL) {
+        return false;
+    }
+
+    if (sc_list_lock_init(&shared->lock) != 0) {
+        sc_list_free(shared);
+        return false;
+    }
+
+    shared->chains = NULL;
+    shared->loose = (struct sc_list_chain){0};
+    shared->slabs = NULL;
+    shared->size = 0;
+
+    pool->shared = shared;
+    pool->size = size;
+    pool->offset = offset;
+    pool->batch = batch != 0 ? batch : SC_LIST_POOL_BATCH;
+
+    return true;
+}
+
+void sc_list_pool_term(struct sc_list_pool *pool)
+{
+    struct sc_list_slab *slab, *next;
+
+    if (pool->shared == NULL) {
+        return;
+    }
+
+    slab = pool->shared->slabs;
+    while (slab != NULL) {
+        next = slab->next;
+        sc_list_free(slab);
+        slab = next;
+    }
+
+    sc_list_lock_term(&pool->shared->lock);
+    sc_list_free(pool->shared);
+    pool->shared = NULL;
+}
+
+/**
+ * Allocates a slab, objects are chained in address order. Must be called with
+ * the lock held.
+ */
+static struct sc_list_chain sc_list_pool_slab(struct sc_list_pool *pool)
+{
+    char *mem;
+    struct sc_list *node;
+    struct sc_list_slab *slab;
+    struct sc_list_chain chain = {0};
+
+    if (pool->size > (SIZE_MAX - sizeof(*slab)) / pool->batch) {
+        return chain;
+    }
+
+    slab = sc_list_malloc(sizeof(*slab) + pool->size * pool->batch);
+    if (slab == NULL) {
+        return chain;
+    }
+
+    slab->next = pool->shared->slabs;
+    pool->shared->slabs = slab;
+    pool->shared->size += pool->batch;
+
+    mem = (char *) slab + sizeof(*slab);
+
+    for (uint32_t i = pool->batch; i > 0; i--) {
+        node = sc_list_pool_node(pool, mem + (i - 1) * pool->size);
+        node->next = chain.head;
+        chain.head = node;
+    }
+
+    chain.count = pool->batch;
+
+    return chain;
+}
+
+/**
+ * Takes a chain, a full one if there is, must be called with the lock held.
+ */
+static struct sc_list_chain sc_list_pool_take(struct sc_list_pool *pool)
+{
+    struct sc_list_chain chain;
+    struct sc_list_pool_shared *shared = pool->shared;
+
+    if (shared->chains != NULL) {
+        chain.head = shared->chains;
+        chain.count = pool->batch;
+        shared->chains = chain.head->prev;
+    } else if (shared->loose.count != 0) {
+        chain = shared->loose;
+        shared->loose = (struct sc_list_chain){0};
+    } else {
+        chain = sc_list_pool_slab(pool);
+    }
+
+    return chain;
+}
+
+/**
+ * Gives a full chain, must be called with the lock held.
+ */
+static void sc_list_pool_give(struct sc_list_pool *pool,
+                              struct sc_list_chain chain)
+{
+    chain.head->prev = pool->shared->chains;
+    pool->shared->chains = chain.head;
+}
+
+static void *sc_list_chain_pop(struct sc_list_pool *pool,
+                               struct sc_list_chain *chain)
+{
+    struct sc_list *node = chain->head;
+
+    chain->head = node->next;
+    chain->count--;
+    sc_list_init(node);
+
+    return sc_list_pool_obj(pool, node);
+}
+
+static void sc_list_chain_push(struct sc_list_pool *pool,
+                               struct sc_list_chain *chain, void *obj)
+{
+    struct sc_list *node = sc_list_pool_node(pool, obj);
+
+    node->next = chain->head;
+    chain->head = node;
+    chain->count++;
+}
+
+void *sc_list_pool_get(struct sc_list_pool *pool)
+{
+    void *obj = NULL;
+    struct sc_list_pool_shared *shared = pool->shared;
+
+    sc_list_lock(&shared->lock);
+
+    if (shared->loose.count == 0) {
+        shared->loose = sc_list_pool_take(pool);
+    }
+
+    if (shared->loose.count != 0) {
+        obj = sc_list_chain_pop(pool, &shared->loose);
+    }
+
+    sc_list_unlock(&shared->lock);
+
+    return obj;
+}
+
+void sc_list_pool_put(struct sc_list_pool *pool, void *obj)
+{
+    struct sc_list_pool_shared *shared = pool->shared;
+
+    sc_list_lock(&shared->lock);
+
+    sc_list_chain_push(pool, &shared->loose, obj);
+    if (shared->loose.count == pool->batch) {
+        sc_list_pool_give(pool, shared->loose);
+        shared->loose = (struct sc_list_chain){0};
+    }
+
+    sc_list_unlock(&shared->lock);
+}
+
+size_t sc_list_pool_size(struct sc_list_pool *pool)
+{
+    size_t size;
+
+    sc_list_lock(&pool->shared->lock);
+    size = pool->shared->size;
+    sc_list_unlock(&pool->shared->lock);
+
+    return size;
+}
+
+void sc_list_cache_init(struct sc_list_cache *cache, struct sc_list_pool *pool)
+{
+    cache->pool = pool;
+    cache->cur = (struct sc_list_chain){0};
+    cache->full = (struct sc_list_chain){0};
+}
+
+void sc_list_cache_term(struct sc_list_cache *cache)
+{
+    struct sc_list_pool *pool = cache->pool;
+
+    while (cache->cur.count != 0) {
+        sc_list_pool_put(pool, sc_list_chain_pop(pool, &cache->cur));
+    }
+
+    if (cache->full.count != 0) {
+        sc_list_lock(&pool->shared->lock);
+        sc_list_pool_give(pool, cache->full);
+        sc_list_unlock(&pool->shared->lock);
+        cache->full = (struct sc_list_chain){0};
+    }
+}
+
+void *sc_list_cache_get(struct sc_list_cache *cache)
+{
+    struct sc_list_pool *pool = cache->pool;
+
+    if (cache->cur.count == 0) {
+        if (cache->full.count != 0) {
+            cache->cur = cache->full;
+            cache->full = (struct sc_list_chain){0};
+        } else {
+            sc_list_lock(&pool->shared->lock);
+            cache->cur = sc_list_pool_take(pool);
+            sc_list_unlock(&pool->shared->lock);
+
+            if (cache->cur.count == 0) {
+                return NULL;
+            }
+        }
+    }
+
+    return sc_list_chain_pop(pool, &cache->cur);
+}
+
+void sc_list_cache_put(struct sc_list_cache *cache, void *obj)
+{
+    struct sc_list_pool *pool = cache->pool;
+
+    if (cache->cur.count == pool->batch) {
+        if (cache->full.count != 0) {
+            sc_list_lock(&pool->shared->lock);
+            sc_list_pool_give(pool, cache->full);
+            sc_list_unlock(&pool->shared->lock);
+        }
+
+        cache->full = cache->cur;
+        cache->cur = (struct sc_list_chain){0};
+    }
+
+    sc_list_chain_push(pool, &cache->cur, obj);
+}
+
+/**
+ * Bit 'i' of the mask is set if slot 'i' has an element. Elements are in
+ * order of the slot index, new elements go after the last slot of the tail
+ * node or before the first slot of the head node, holes are not reused.
+ */
+struct sc_ulist_node
+{
+    struct sc_ulist_node *next;
+    struct sc_ulist_node *prev;
+    uint64_t mask;
+    uint64_t pad;
+    unsigned char elems[];
+};
+
+#define sc_ulist_elem(list, node, i)                                           \
+    ((node)->elems + (size_t) (i) * (list)->elem_size)
+
+static uint32_t sc_ulist_ctz(uint64_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t) __builtin_ctzll(mask);
+#else
+    uint32_t n = 0;
+
+    while ((mask & 1u) == 0) {
+        mask >>= 1u;
+        n++;
+    }
+
+    return n;
+#endif
+}
+
+static uint32_t sc_ulist_last(uint64_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - (uint32_t) __builtin_clzll(mask);
+#else
+    uint32_t n = 63;
+
+    while ((mask & (1ull << n)) == 0) {
+        n--;
+    }
+
+    return n;
+#endif
+}
+
+void sc_ulist_init(struct sc_ulist *list, size_t elem_size, uint32_t node_cap)
+{
+    if (node_cap == 0) {
+        node_cap = (uint32_t) (512 / (elem_size != 0 ? elem_size : 1));
+        node_cap = node_cap < 4 ? 4 : node_cap;
+    }
+
+    *list = (struct sc_ulist){
+            .elem_size = elem_size,
+            .node_cap = node_cap < SC_ULIST_NODE_MAX ? node_cap :
+                                                       SC_ULIST_NODE_MAX,
+    };
+}
+
+void sc_ulist_clear(struct sc_ulist *list)
+{
+    struct sc_ulist_node *node = list->head, *next;
+
+    while (node != NULL) {
+        next = node->next;
+        sc_list_free(node);
+        node = next;
+    }
+
+    list->head = NULL;
+    list->tail = NULL;
+    list->size = 0;
+}
+
+void sc_ulist_term(struct sc_ulist *list)
+{
+    sc_ulist_clear(list);
+    sc_list_free(list->spare);
+    list->spare = NULL;
+}
+
+size_t sc_ulist_size(struct sc_ulist *list)
+{
+    return list->size;
+}
+
+static struct sc_ulist_node *sc_ulist_node(struct sc_ulist *list)
+{
+    struct sc_ulist_node *node = list->spare;
+
+    if (node != NULL) {
+        list->spare = NULL;
+    } else {
+        node = sc_list_malloc(sizeof(*node) +
+                              list->elem_size * list->node_cap);
+        if (node == NULL) {
+            return NULL;
+        }
+    }
+
+    node->mask = 0;
+    return node;
+}
+
+static void sc_ulist_put(struct sc_ulist *list, struct sc_ulist_node *node,
+                         uint32_t idx, const void *elem,
+                         struct sc_ulist_pos *pos)
+{
+    node->mask |= 1ull << idx;
+    memcpy(sc_ulist_elem(list, node, idx), elem, list->elem_size);
+    list->size++;
+
+    if (pos != NULL) {
+        pos->node = node;
+        pos->idx = idx;
+    }
+}
+
+bool sc_ulist_add_tail(struct sc_ulist *list, const void *elem,
+                       struct sc_ulist_pos *pos)
+{
+    uint32_t idx;
+    struct sc_ulist_node *node = list->tail;
+
+    if (node != NULL) {
+        idx = sc_ulist_last(node->mask) + 1;
+        if (idx < list->node_cap) {
+            sc_ulist_put(list, node, idx, elem, pos);
+            return true;
+        }
+    }
+
+    node = sc_ulist_node(list);
+    if (node == NULL) {
+        return false;
+    }
+
+    node->next = NULL;
+    node->prev = list->tail;
+    if (list->tail != NULL) {
+        list->tail->next = node;
+    } else {
+        list->head = node;
+    }
+    list->tail = node;
+
+    sc_ulist_put(list, node, 0, elem, pos);
+
+    return true;
+}
+
+bool sc_ulist_add_head(struct sc_ulist *list, const void *elem,
+                       struct sc_ulist_pos *pos)
+{
+    struct sc_ulist_node *node = list->head;
+
+    if (node != NULL && (node->mask & 1u) == 0) {
+        sc_ulist_put(list, node, sc_ulist_ctz(node->mask) - 1, elem, pos);
+        return true;
+    }
+
+    node = sc_ulist_node(list);
+    if (node == NULL) {
+        return false;
+    }
+
+    node->prev = NULL;
+    node->next = list->head;
+    if (list->head != NULL) {
+        list->head->prev = node;
+    } else {
+        list->tail = node;
+    }
+    list->head = node;
+
+    sc_ulist_put(list, node, list->node_cap - 1, elem, pos);
+
+    return true;
+}
+
+void sc_ulist_del(struct sc_ulist *list, struct sc_ulist_pos pos)
+{
+    struct sc_ulist_node *node = pos.node;
+
+    node->mask &= ~(1ull << pos.idx);
+    list->size--;
+
+    if (node->mask != 0) {
+        return;
+    }
+
+    if (node->prev != NULL) {
+        node->prev->next = node->next;
+    } else {
+        list->head = node->next;
+    }
+
+    if (node->next != NULL) {
+        node->next->prev = node->prev;
+    } else {
+        list->tail = node->prev;
+    }
+
+    // Node is kept as spare with its 'next' pointer, so iteration can
+    // continue after deleting the current element.
+    sc_list_free(list->spare);
+    list->spare = node;
+}
+
+void *sc_ulist_at(struct sc_ulist *list, struct sc_ulist_pos pos)
+{
+    return sc_ulist_elem(list, pos.node, pos.idx);
+}
+
+bool sc_ulist_pop_head(struct sc_ulist *list, void *elem)
+{
+    struct sc_ulist_pos pos;
+    void *p = sc_ulist_first(list, &pos);
+
+    if (p == NULL) {
+        return false;
+    }
+
+    if (elem != NULL) {
+        memcpy(elem, p, list->elem_size);
+    }
+
+    sc_ulist_del(list, pos);
+
+    return true;
+}
+
+bool sc_ulist_pop_tail(struct sc_ulist *list, void *elem)
+{
+    struct sc_ulist_pos pos;
+
+    if (list->tail == NULL) {
+        return false;
+    }
+
+    pos.node = list->tail;
+    pos.idx = sc_ulist_last(pos.node->mask);
+
+    if (elem != NULL) {
+        memcpy(elem, sc_ulist_at(list, pos), list->elem_size);
+    }
+
+    sc_ulist_del(list, pos);
+
+    return true;
+}
+
+void *sc_ulist_first(struct sc_ulist *list, struct sc_ulist_pos *pos)
+{
+    if (list->head == NULL) {
+        return NULL;
+    }
+
+    pos->node = list->head;
+    pos->idx = sc_ulist_ctz(pos->node->mask);
+
+    return sc_ulist_at(list, *pos);
+}
+
+void *sc_ulist_next(struct sc_ulist *list, struct sc_ulist_pos *pos)
+{
+    // Slots after 'idx', shift in two steps as 'idx' can be 63.
+    uint64_t mask = (pos->node->mask >> pos->idx) >> 1u;
+
+    if (mask != 0) {
+        pos->idx += sc_ulist_ctz(mask) + 1;
+        return sc_ulist_at(list, *pos);
+    }
+
+    pos->node = pos->node->next;
+    if (pos->node == NULL) {
+        return NULL;
+    }
+
+    pos->idx = sc_ulist_ctz(pos->node->mask);
+
+    return sc_ulist_at(list, *pos);
+}
@@ -27,7 +27,14 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#else
+    #define sc_list_malloc malloc
+    #define sc_list_free   free
+#endif
 
 struct sc_list
 {
@@ -53,7 +60,10 @@ void sc_list_clear(struct sc_list *list);
  * @param list list
  * @return     'true' if empty
  */
-bool sc_list_is_empty(struct sc_list *list);
+static inline bool sc_list_is_empty(struct sc_list *list)
+{
+    return list->next == list;
+}
 
 /**
  * @param list list
@@ -65,13 +75,19 @@ size_t sc_list_count(struct sc_list *list);
  * @param list list
  * @return     returns head. If list is empty, returns NULL.
  */
-struct sc_list *sc_list_head(struct sc_list *list);
+static inline struct sc_list *sc_list_head(struct sc_list *list)
+{
+    return list->next != list ? list->next : NULL;
+}
 
 /**
  * @param list list
  * @return     returns tail. If list is empty, returns NULL.
  */
-struct sc_list *sc_list_tail(struct sc_list *list);
+static inline struct sc_list *sc_list_tail(struct sc_list *list)
+{
+    return list->prev != list ? list->prev : NULL;
+}
 
 /**
  *  before : [head]item1 -> [tail]item2
@@ -219,4 +235,274 @@ void sc_list_del(struct sc_list *list, struct sc_list *elem);
     for ((elem) = (list)->prev, (n) = (elem)->prev; (elem) != (list);          \
          (elem) = (n), (n) = (elem)->prev)
 
+/**
+ * Fixed size object pool for objects with an embedded 'struct sc_list'.
+ *
+ * Objects are allocated in slabs of 'batch' objects, so objects taken from
+ * the pool one after another are next to each other in memory, which helps
+ * when a list of them is iterated. While an object is in the pool, its list
+ * member links it to the free list, so there is no per object overhead.
+ *
+ * Free objects are kept in chains of 'batch' objects, the pool is thread-safe
+ * and a 'struct sc_list_cache' per thread takes/returns a whole chain with a
+ * single lock, e.g. get/put calls on a cache lock the pool once every 'batch'
+ * calls at most.
+ *
+ * struct conn {
+ *     int fd;
+ *     struct sc_list node;
+ * };
+ *
+ * struct sc_list_pool pool;
+ * struct sc_list_cache cache; // Per thread
+ *
+ * sc_list_pool_init_of(&pool, struct conn, node, 64);
+ * sc_list_cache_init(&cache, &pool);
+ *
+ * struct conn *c = sc_list_cache_get(&cache);
+ * sc_list_add_tail(&conns, &c->node);
+ * ...
+ * sc_list_del(&conns, &c->node);
+ * sc_list_cache_put(&cache, c);
+ *
+ * sc_list_cache_term(&cache);
+ * sc_list_pool_term(&pool);
+ */
+struct sc_list_pool
+{
+    struct sc_list_pool_shared *shared;
+    size_t size;
+    size_t offset;
+    uint32_t batch;
+};
+
+struct sc_list_chain
+{
+    struct sc_list *head;
+    uint32_t count;
+};
+
+struct sc_list_cache
+{
+    struct sc_list_pool *pool;
+    struct sc_list_chain cur;
+    struct sc_list_chain full;
+};
+
+/**
+ * @param pool   pool
+ * @param size   object size
+ * @param offset offset of the 'struct sc_list' member in the object
+ * @param batch  objects per slab and per chain, pass 0 for default (64).
+ * @return       'false' on out of memory.
+ */
+bool sc_list_pool_init(struct sc_list_pool *pool, size_t size, size_t offset,
+                       uint32_t batch);
+
+/**
+ * e.g sc_list_pool_init_of(&pool, struct conn, node, 64);
+ */
+#define sc_list_pool_init_of(pool, type, elem, batch)                          \
+    sc_list_pool_init(pool, sizeof(type), offsetof(type, elem), batch)
+
+/**
+ * Release all memory, objects taken from the pool are invalid after this
+ * call. Caches must be terminated before.
+ *
+ * @param pool pool
+ */
+void sc_list_pool_term(struct sc_list_pool *pool);
+
+/**
+ * Get an object, list member of the object is initialized with
+ * sc_list_init(), other fields are undefined.
+ *
+ * @param pool pool
+ * @return     object, NULL on out of memory.
+ */
+void *sc_list_pool_get(struct sc_list_pool *pool);
+
+/**
+ * @param pool pool
+ * @param obj  object taken from this pool, must not be in a list.
+ */
+void sc_list_pool_put(struct sc_list_pool *pool, void *obj);
+
+/**
+ * @param pool pool
+ * @return     total object count, in use and free.
+ */
+size_t sc_list_pool_size(struct sc_list_pool *pool);
+
+/**
+ * Per thread cache of a pool, not thread-safe.
+ *
+ * @param cache cache
+ * @param pool  pool
+ */
+void sc_list_cache_init(struct sc_list_cache *cache, struct sc_list_pool *pool);
+
+/**
+ * Return cached objects to the pool.
+ * @param cache cache
+ */
+void sc_list_cache_term(struct sc_list_cache *cache);
+
+/**
+ * Same as sc_list_pool_get(), takes a chain of objects from the pool when
+ * the cache is empty.
+ *
+ * @param cache cache
+ * @return      object, NULL on out of memory.
+ */
+void *sc_list_cache_get(struct sc_list_cache *cache);
+
+/**
+ * Same as sc_list_pool_put(), returns a chain of objects to the pool when
+ * the cache is full.
+ *
+ * @param cache cache
+ * @param obj   object taken from the pool, must not be in a list.
+ */
+void sc_list_cache_put(struct sc_list_cache *cache, void *obj);
+
+/**
+ * Unrolled list, each node stores up to 'node_cap' elements inline, so
+ * iteration touches a node per 'node_cap' elements instead of a node per
+ * element.
+ *
+ * Elements are copied into the list. Deleted elements leave a hole in their
+ * node, other elements don't move, so positions stay valid until the element
+ * is deleted and deletion is O(1). Empty nodes are released.
+ *
+ * struct write { void *data; size_t len; };
+ *
+ * struct sc_ulist list;
+ * struct sc_ulist_pos pos, handle;
+ * struct write w = {data, len}, *it;
+ *
+ * sc_ulist_init(&list, sizeof(struct write), 0);
+ * sc_ulist_add_tail(&list, &w, &handle);
+ *
+ * sc_ulist_foreach (&list, pos, it) {
+ *     send(it->data, it->len);
+ * }
+ *
+ * sc_ulist_del(&list, handle);
+ * sc_ulist_term(&list);
+ */
+#define SC_ULIST_NODE_MAX 64
+
+struct sc_ulist
+{
+    struct sc_ulist_node *head;
+    struct sc_ulist_node *tail;
+    struct sc_ulist_node *spare;
+    size_t elem_size;
+    size_t size;
+    uint32_t node_cap;
+};
+
+// Position of an element, handle for O(1) delete.
+struct sc_ulist_pos
+{
+    struct sc_ulist_node *node;
+    uint32_t idx;
+};
+
+/**
+ * @param list      list
+ * @param elem_size element size
+ * @param node_cap  elements per node, max SC_ULIST_NODE_MAX. Pass 0 to pick
+ *                  a value for ~512 bytes of elements per node.
+ */
+void sc_ulist_init(struct sc_ulist *list, size_t elem_size, uint32_t node_cap);
+
+/**
+ * @param list list
+ */
+void sc_ulist_term(struct sc_ulist *list);
+
+/**
+ * Delete all elements.
+ * @param list list
+ */
+void sc_ulist_clear(struct sc_ulist *list);
+
+/**
+ * @param list list
+ * @return     element count, O(1).
+ */
+size_t sc_ulist_size(struct sc_ulist *list);
+
+/**
+ * @param list list
+ * @param elem element to copy
+ * @param pos  position of the element, pass NULL if not needed.
+ * @return     'false' on out of memory.
+ */
+bool sc_ulist_add_tail(struct sc_ulist *list, const void *elem,
+                       struct sc_ulist_pos *pos);
+
+/**
+ * @param list list
+ * @param elem element to copy
+ * @param pos  position of the element, pass NULL if not needed.
+ * @return     'false' on out of memory.
+ */
+bool sc_ulist_add_head(struct sc_ulist *list, const void *elem,
+                       struct sc_ulist_pos *pos);
+
+/**
+ * @param list list
+ * @param pos  position of an element in the list
+ */
+void sc_ulist_del(struct sc_ulist *list, struct sc_ulist_pos pos);
+
+/**
+ * @param list list
+ * @param pos  position of an element in the list
+ * @return     element
+ */
+void *sc_ulist_at(struct sc_ulist *list, struct sc_ulist_pos pos);
+
+/**
+ * @param list list
+ * @param elem head is copied into 'elem', pass NULL if not needed.
+ * @return     'false' if list is empty.
+ */
+bool sc_ulist_pop_head(struct sc_ulist *list, void *elem);
+
+/**
+ * @param list list
+ * @param elem tail is copied into 'elem', pass NULL if not needed.
+ * @return     'false' if list is empty.
+ */
+bool sc_ulist_pop_tail(struct sc_ulist *list, void *elem);
+
+/**
+ * Iteration, see sc_ulist_foreach().
+ *
+ * @param list list
+ * @param pos  position of the returned element
+ * @return     first/next element, NULL at the end.
+ */
+void *sc_ulist_first(struct sc_ulist *list, struct sc_ulist_pos *pos);
+void *sc_ulist_next(struct sc_ulist *list, struct sc_ulist_pos *pos);
+
+/**
+ * It is safe to delete the current element while iterating with
+ * sc_ulist_del(list, pos).
+ *
+ * struct sc_ulist_pos pos;
+ * struct write *it;
+ *
+ * sc_ulist_foreach (&list, pos, it) {
+ *     printf("%zu \n", it->len);
+ * }
+ */
+#define sc_ulist_foreach(list, pos, elem)                                      \
+    for ((elem) = sc_ulist_first(list, &(pos)); (elem) != NULL;                \
+         (elem) = sc_ulist_next(list, &(pos)))
+
 #endif
@@ -1,3 +1,7 @@
+#ifndef _XOPEN_SOURCE
+    #define _XOPEN_SOURCE 700
+#endif
+
 #define SC_LOG_PRINT_FILE_NAME
 #include "sc_log.h"
 
@@ -93,6 +97,470 @@ void test1(void)
     sc_log_term();
 }
 
+// Lines start with file name and line no, see SC_LOG_PRINT_FILE_NAME
+static bool ends_with(const char *line, const char *str)
+{
+    size_t n = strlen(line), m = strlen(str);
+
+    return n >= m && strcmp(line + n - m, str) == 0;
+}
+
+static long file_size(const char *path)
+{
+    long size;
+    FILE *fp = fopen(path, "rb");
+
+    if (fp == NULL) {
+        return -1;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fclose(fp);
+
+    return size;
+}
+
+static void rotation(bool async)
+{
+    char path[64];
+    time_t t;
+
+    for (int i = 0; i < 5; i++) {
+        snprintf(path, sizeof(path), "rot.txt.%d", i);
+        remove(path);
+    }
+    remove("rot.txt");
+    remove("rot-latest.txt");
+
+    assert(sc_log_init() == 0);
+    if (async) {
+        assert(sc_log_set_async(64, SC_LOG_BLOCK) == 0);
+    }
+    sc_log_set_stdout(false);
+    sc_log_set_rotation(1000, 3, 0);
+    assert(sc_log_set_file("rot.txt", "rot-latest.txt") == 0);
+
+    for (int i = 0; i < 200; i++) {
+        sc_log_info("testtesttesttesttesttesttesttesttesttesttesttest \n");
+    }
+    assert(sc_log_term() == 0);
+
+    // Three generations, oldest ones are removed
+    assert(file_size("rot.txt") > 1000);
+    assert(file_size("rot.txt.1") > 1000);
+    assert(file_size("rot.txt.2") > 1000);
+    assert(file_size("rot.txt.3") == -1);
+    assert(file_size("rot-latest.txt") <= 1000 + SC_LOG_ASYNC_LINE);
+
+    // Time based, size limit is disabled
+    remove("rot.txt");
+    remove("rot.txt.1");
+    remove("rot-latest.txt");
+
+    assert(sc_log_init() == 0);
+    if (async) {
+        assert(sc_log_set_async(64, SC_LOG_BLOCK) == 0);
+    }
+    sc_log_set_stdout(false);
+    sc_log_set_rotation(0, 1, 1);
+    assert(sc_log_set_file("rot.txt", "rot-latest.txt") == 0);
+
+    t = time(NULL);
+    while (time(NULL) == t) {
+    }
+
+    sc_log_info("first \n");
+
+    t = time(NULL);
+    while (time(NULL) == t) {
+    }
+
+    sc_log_info("second \n");
+    assert(sc_log_term() == 0);
+
+    assert(file_size("rot.txt") > 0);
+    assert(file_size("rot-latest.txt") > 0);
+    assert(file_size("rot.txt.1") == -1);
+}
+
+void test_rotation(void)
+{
+    rotation(false);
+    rotation(true);
+}
+
+static int limit_count;
+static unsigned long long limit_suppressed;
+
+static int limit_callback(void *arg, enum sc_log_level level, const char *fmt,
+                          va_list va)
+{
+    (void) arg;
+    (void) level;
+
+    limit_count++;
+
+    if (strstr(fmt, "Suppressed") != NULL) {
+        // Skip file name and line no, see SC_LOG_PRINT_FILE_NAME
+        (void) va_arg(va, const char *);
+        (void) va_arg(va, int);
+        limit_suppressed = va_arg(va, unsigned long long);
+    }
+
+    return 0;
+}
+
+static void limited(int i)
+{
+    sc_log_error_limit(10, "limit %d \n", i);
+}
+
+void test_limit(void)
+{
+    int passed;
+    time_t t;
+
+    assert(sc_log_init() == 0);
+    sc_log_set_stdout(false);
+    sc_log_set_callback(NULL, limit_callback);
+
+    t = time(NULL);
+    while (time(NULL) == t) {
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        limited(i);
+    }
+    assert(limit_count == 10);
+    assert(limit_suppressed == 0);
+
+    t = time(NULL);
+    while (time(NULL) == t) {
+    }
+
+    limit_count = 0;
+    limited(0);
+    assert(limit_count == 2);
+    assert(limit_suppressed == 990);
+
+    limit_count = 0;
+    for (int i = 0; i < 1000; i++) {
+        sc_log_info_sample(100, "sample %d \n", i);
+    }
+    assert(limit_count == 10);
+
+    // Filtered by level
+    limit_count = 0;
+    for (int i = 0; i < 1000; i++) {
+        sc_log_debug_sample(1, "sample %d \n", i);
+    }
+    assert(limit_count == 0);
+
+    // Callsite goes quiet after a burst, term writes the suppressed count.
+    limit_count = 0;
+    for (int i = 0; i < 1000; i++) {
+        limited(i);
+    }
+    assert(limit_count > 0 && limit_count < 1000);
+    passed = limit_count;
+    limit_suppressed = 0;
+    assert(sc_log_term() == 0);
+    assert(limit_suppressed == (unsigned long long) (1000 - passed));
+}
+
+#ifdef SC_LOG_HAVE_HIST
+void test_hist(void)
+{
+    int count = 0;
+    static struct sc_hist hist;
+
+    sc_hist_init(&hist);
+    assert(sc_log_init() == 0);
+    sc_log_set_stdout(false);
+    sc_log_set_callback(&count, callback);
+    assert(sc_log_set_level("INFO") == 0);
+
+    sc_log_set_hist(&hist);
+    for (int i = 0; i < 100; i++) {
+        sc_log_info("hist %d \n", i);
+        sc_log_debug("filtered %d \n", i);
+    }
+    assert(count == 100);
+    assert(sc_hist_count(&hist) == 100);
+    assert(sc_hist_percentile(&hist, 50) > 0);
+
+    sc_log_set_hist(NULL);
+    sc_log_info("not recorded \n");
+    assert(sc_hist_count(&hist) == 100);
+
+    assert(sc_log_term() == 0);
+}
+#else
+void test_hist(void)
+{
+}
+#endif
+
+#if defined(SC_LOG_HAVE_SIGNAL) && !defined(_WIN32)
+    #include "sc_signal.h"
+
+    #include <unistd.h>
+
+void test_ring(void)
+{
+    int fds[2];
+    ssize_t n;
+    char out[8192];
+    static uint64_t mem[1024];
+
+    assert(sc_log_init() == 0);
+    sc_log_set_stdout(false);
+    assert(sc_log_set_level("INFO") == 0);
+
+    sc_log_info("not in ring \n");
+    assert(sc_signal_ring_init(mem, sizeof(mem)) == 0);
+    sc_log_info("ring %d \n", 1);
+    sc_log_debug("filtered \n");
+    sc_log_error("ring %s \n", "2");
+
+    assert(pipe(fds) == 0);
+    sc_signal_ring_dump(fds[1]);
+    close(fds[1]);
+    n = read(fds[0], out, sizeof(out) - 1);
+    assert(n > 0);
+    out[n] = '\0';
+    close(fds[0]);
+
+    assert(strstr(out, "RECENT EVENTS (2)") != NULL);
+    assert(strstr(out, "[INFO][My thread] ") != NULL);
+    assert(strstr(out, "ring 1 \n") != NULL);
+    assert(strstr(out, "ring 2 \n") != NULL);
+    assert(strstr(out, "not in ring") == NULL);
+    assert(strstr(out, "filtered") == NULL);
+
+    assert(sc_signal_ring_init(NULL, 0) == 0);
+    assert(sc_log_term() == 0);
+}
+#else
+void test_ring(void)
+{
+}
+#endif
+
+static int side_effect(int *n)
+{
+    return ++*n;
+}
+
+void test_module(void)
+{
+    int count = 0, n = 0;
+    static struct sc_log_module net = SC_LOG_MODULE_INIT("net");
+    static struct sc_log_module db = SC_LOG_MODULE_INIT("db");
+
+    assert(sc_log_init() == 0);
+    sc_log_set_stdout(false);
+    sc_log_set_callback(&count, callback);
+    sc_log_add_module(&net);
+    sc_log_add_module(&db);
+    sc_log_add_module(&net);
+
+    // Disabled levels do not evaluate arguments
+    sc_log_debug("test %d \n", side_effect(&n));
+    assert(n == 0 && count == 0);
+    sc_log_info("test %d \n", side_effect(&n));
+    assert(n == 1 && count == 1);
+
+    assert(sc_log_set_module_level("net", "DEBUG") == 0);
+    assert(sc_log_set_module_level("net", "xx") == -1);
+    assert(sc_log_set_module_level("unknown", "DEBUG") == -1);
+
+    count = 0;
+    sc_log_mod_debug(&net, "test \n");
+    sc_log_mod_debug(&db, "test \n");
+    sc_log_debug("test \n");
+    assert(count == 1);
+
+    // Global level applies to modules without a level
+    assert(sc_log_set_level("ERROR") == 0);
+    count = 0;
+    sc_log_mod_debug(&net, "test \n");
+    sc_log_mod_warn(&db, "test \n");
+    sc_log_mod_error(&db, "test \n");
+    assert(count == 2);
+
+    assert(sc_log_set_module_level("net", NULL) == 0);
+    count = 0;
+    sc_log_mod_info(&net, "test \n");
+    sc_log_mod_error(&net, "test \n");
+    assert(count == 1);
+
+    assert(sc_log_set_module_level("db", "OFF") == 0);
+    count = 0;
+    sc_log_mod_error(&db, "test \n");
+    assert(count == 0);
+
+    assert(sc_log_term() == 0);
+}
+
+#ifdef SC_LOG_HAVE_BINARY
+    #include "sc_buf.h"
+
+static int rec_count;
+static unsigned char rec_data[4][SC_LOG_REC_SIZE];
+static uint32_t rec_len[4];
+static char rec_line[SC_LOG_REC_SIZE];
+
+static int rec_callback(void *arg, const void *rec, uint32_t len)
+{
+    (void) arg;
+
+    assert(len <= SC_LOG_REC_SIZE);
+    if (rec_count < 4) {
+        memcpy(rec_data[rec_count], rec, len);
+        rec_len[rec_count] = len;
+    }
+    rec_count++;
+
+    return 0;
+}
+
+static int rec_text_callback(void *arg, enum sc_log_level level,
+                             const char *fmt, va_list va)
+{
+    (void) arg;
+    (void) level;
+
+    vsnprintf(rec_line, sizeof(rec_line), fmt, va);
+    return 0;
+}
+
+static void check_kv(const void *data, uint32_t len)
+{
+    struct sc_buf buf = sc_buf_wrap((void *) data, len, SC_BUF_READ);
+
+    assert(sc_buf_get_32(&buf) == len - 4);
+    assert(sc_buf_get_8(&buf) == SC_LOG_INFO);
+    assert(sc_buf_get_64(&buf) > 0);
+    assert(sc_buf_get_64(&buf) > 0);
+    assert(strcmp(sc_buf_get_str(&buf), "My thread") == 0);
+    assert(strcmp(sc_buf_get_str(&buf), "request") == 0);
+    assert(sc_buf_get_8(&buf) == 4);
+
+    assert(strcmp(sc_buf_get_str(&buf), "path") == 0);
+    assert(sc_buf_get_8(&buf) == SC_LOG_TYPE_STR);
+    assert(strcmp(sc_buf_get_str(&buf), "/index") == 0);
+
+    assert(strcmp(sc_buf_get_str(&buf), "status") == 0);
+    assert(sc_buf_get_8(&buf) == SC_LOG_TYPE_INT);
+    assert((int64_t) sc_buf_get_64(&buf) == -2);
+
+    assert(strcmp(sc_buf_get_str(&buf), "bytes") == 0);
+    assert(sc_buf_get_8(&buf) == SC_LOG_TYPE_UINT);
+    assert(sc_buf_get_64(&buf) == 1024);
+
+    assert(strcmp(sc_buf_get_str(&buf), "ms") == 0);
+    assert(sc_buf_get_8(&buf) == SC_LOG_TYPE_DOUBLE);
+    assert(sc_buf_get_double(&buf) == 1.5);
+
+    assert(sc_buf_valid(&buf));
+    assert(sc_buf_size(&buf) == 0);
+}
+
+static void log_kv(void)
+{
+    sc_log_info_kv("request", sc_log_str("path", "/index"),
+                   sc_log_int("status", -2), sc_log_uint("bytes", 1024),
+                   sc_log_double("ms", 1.5));
+}
+
+void test_binary(void)
+{
+    int rc;
+    long size;
+    FILE *fp;
+    struct sc_buf buf;
+    unsigned char data[SC_LOG_REC_SIZE * 2];
+    struct sc_log_field many[256];
+
+    for (int async = 0; async < 2; async++) {
+        rec_count = 0;
+        rec_line[0] = '\0';
+
+        assert(sc_log_init() == 0);
+        if (async) {
+            assert(sc_log_set_async(16, SC_LOG_BLOCK) == 0);
+        }
+        sc_log_set_stdout(false);
+        sc_log_set_callback(NULL, rec_text_callback);
+        sc_log_set_record_callback(NULL, rec_callback);
+
+        log_kv();
+        sc_log_info("hello %d \n", 3);
+        sc_log_debug_kv("filtered", sc_log_int("a", 1));
+        assert(sc_log_term() == 0);
+
+        assert(rec_count == 2);
+        check_kv(rec_data[0], rec_len[0]);
+
+        buf = sc_buf_wrap(rec_data[1], rec_len[1], SC_BUF_READ);
+        sc_buf_get_32(&buf);
+        assert(sc_buf_get_8(&buf) == SC_LOG_INFO);
+        sc_buf_get_64(&buf);
+        sc_buf_get_64(&buf);
+        sc_buf_get_str(&buf);
+        assert(ends_with(sc_buf_get_str(&buf), "hello 3 \n"));
+        assert(sc_buf_get_8(&buf) == 0);
+        assert(sc_buf_valid(&buf));
+    }
+
+    // Text form
+    assert(sc_log_init() == 0);
+    sc_log_set_stdout(false);
+    sc_log_set_callback(NULL, rec_text_callback);
+    log_kv();
+    assert(strcmp(rec_line, "request path=/index status=-2 bytes=1024 ms=1.5 "
+                            "\n") == 0);
+
+    for (int i = 0; i < 256; i++) {
+        many[i] = sc_log_int("key", i);
+    }
+    assert(sc_log_kv(SC_LOG_INFO, "many", many, 256) == -1);
+    assert(sc_log_kv(SC_LOG_INFO, "many", many, 255) == -1);
+    assert(sc_log_term() == 0);
+
+    // Binary file
+    remove("bin.txt");
+    remove("bin-latest.txt");
+
+    assert(sc_log_init() == 0);
+    sc_log_set_stdout(false);
+    sc_log_set_format(SC_LOG_BINARY);
+    assert(sc_log_set_file("bin.txt", "bin-latest.txt") == 0);
+    log_kv();
+    log_kv();
+    assert(sc_log_term() == 0);
+
+    fp = fopen("bin-latest.txt", "rb");
+    assert(fp != NULL);
+    size = (long) fread(data, 1, sizeof(data), fp);
+    fclose(fp);
+
+    buf = sc_buf_wrap(data, (uint32_t) size, SC_BUF_READ);
+    for (int i = 0; i < 2; i++) {
+        rc = (int) sc_buf_peek_32(&buf) + 4;
+        check_kv(sc_buf_rbuf(&buf), (uint32_t) rc);
+        sc_buf_mark_read(&buf, (uint32_t) rc);
+    }
+    assert(sc_buf_size(&buf) == 0);
+}
+#else
+void test_binary(void)
+{
+}
+#endif
+
 #ifdef SC_HAVE_WRAP
 
     #include <errno.h>
@@ -275,6 +743,10 @@ void fail_test(void)
     assert(sc_log_set_file("prev.txt", "current.txt") == -1);
     mock_fopen = false;
     assert(sc_log_set_file("prev.txt", "current.txt") == 0);
+    // Header date is cached per second, wait for the next one.
+    time_t now = time(NULL);
+    while (time(NULL) == now) {
+    }
     mock_localtime = true;
     assert(sc_log_error("test") == -1);
     mock_localtime = false;
@@ -308,6 +780,160 @@ void fail_test(void)
 }
 #endif
 
+#if !defined(_WIN32) && (defined(__GNUC__) || defined(__clang__))
+    #include <pthread.h>
+
+static int async_count;
+static int async_hold;
+static int async_dropped_line;
+
+int async_callback(void *arg, enum sc_log_level level, const char *fmt,
+                   va_list va)
+{
+    char buf[SC_LOG_ASYNC_LINE];
+
+    (void) arg;
+    (void) level;
+
+    // Writer passes the formatted line
+    assert(strcmp(fmt, "%s") == 0 || strstr(fmt, "dropped") != NULL);
+    vsnprintf(buf, sizeof(buf), fmt, va);
+    if (strstr(buf, "records dropped") != NULL) {
+        async_dropped_line++;
+    }
+
+    while (__atomic_load_n(&async_hold, __ATOMIC_SEQ_CST)) {
+        nanosleep(&(struct timespec){.tv_nsec = 1000000}, NULL);
+    }
+
+    __atomic_fetch_add(&async_count, 1, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+void *async_producer(void *arg)
+{
+    (void) arg;
+
+    for (int i = 0; i < 10000; i++) {
+        assert(sc_log_info("async %d \n", i) == 0);
+    }
+
+    return NULL;
+}
+
+void test_async(void)
+{
+    pthread_t threads[4];
+
+    assert(sc_log_init() == 0);
+    assert(sc_log_set_async(0, SC_LOG_BLOCK) == -1);
+    assert(sc_log_set_async(4, SC_LOG_BLOCK) == 0);
+    assert(sc_log_set_async(4, SC_LOG_BLOCK) == -1);
+    sc_log_set_stdout(false);
+    sc_log_set_callback(NULL, async_callback);
+
+    // Small queue, producers block on the writer, nothing is lost.
+    async_count = 0;
+    for (int i = 0; i < 4; i++) {
+        assert(pthread_create(&threads[i], NULL, async_producer, NULL) == 0);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+
+    assert(sc_log_term() == 0);
+    assert(async_count == 40000);
+    assert(sc_log_dropped() == 0);
+
+    // Writer is stuck in the callback, queue fills up and lines are dropped.
+    for (int policy = SC_LOG_DROP; policy <= SC_LOG_COUNT; policy++) {
+        async_count = 0;
+        async_dropped_line = 0;
+        __atomic_store_n(&async_hold, 1, __ATOMIC_SEQ_CST);
+
+        assert(sc_log_init() == 0);
+        assert(sc_log_set_async(2, (enum sc_log_overflow) policy) == 0);
+        sc_log_set_stdout(false);
+        sc_log_set_callback(NULL, async_callback);
+
+        assert(sc_log_info("first") == 0);
+        while (sc_log_info("fill") == 0) {
+        }
+        assert(sc_log_info("dropped") == -1);
+        assert(sc_log_dropped() >= 2);
+
+        __atomic_store_n(&async_hold, 0, __ATOMIC_SEQ_CST);
+        assert(sc_log_term() == 0);
+        assert(async_dropped_line == (policy == SC_LOG_COUNT ? 1 : 0));
+        assert(async_count >= 2);
+    }
+}
+
+static char deferred_lines[16][SC_LOG_ASYNC_LINE];
+static int deferred_count;
+
+int deferred_callback(void *arg, enum sc_log_level level, const char *fmt,
+                      va_list va)
+{
+    (void) arg;
+    (void) level;
+
+    vsnprintf(deferred_lines[deferred_count++], SC_LOG_ASYNC_LINE, fmt, va);
+    return 0;
+}
+
+void test_deferred(void)
+{
+    char exp[SC_LOG_ASYNC_LINE];
+    char str[32] = "stack string";
+    char big[SC_LOG_ASYNC_LINE * 2];
+    int i = 0;
+    void *ptr = &i;
+
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+
+    deferred_count = 0;
+    assert(sc_log_init() == 0);
+    assert(sc_log_set_async(16, SC_LOG_BLOCK) == 0);
+    sc_log_set_deferred(true);
+    sc_log_set_stdout(false);
+    sc_log_set_callback(NULL, deferred_callback);
+
+    sc_log_info("%d %5ld|%-3s|%.2f %x %c %p %% %llu %hhd %zu %Lf \n", -42,
+                123456789L, "ab", 3.14159, 255u, 'z', ptr, 1234567890123ULL,
+                (signed char) -3, (size_t) 77, (long double) 2.5);
+    // String is copied, so it can be modified after the call.
+    sc_log_info("%s", str);
+    strcpy(str, "modified");
+    // Formatted immediately
+    sc_log_info("%*d|%s", 6, 42, big);
+
+    assert(sc_log_term() == 0);
+    assert(deferred_count == 3);
+
+    snprintf(exp, sizeof(exp),
+             "%d %5ld|%-3s|%.2f %x %c %p %% %llu %hhd %zu %Lf \n", -42,
+             123456789L, "ab", 3.14159, 255u, 'z', ptr, 1234567890123ULL,
+             (signed char) -3, (size_t) 77, (long double) 2.5);
+    assert(ends_with(deferred_lines[0], exp));
+    assert(ends_with(deferred_lines[1], ") stack string"));
+
+    // Truncated to SC_LOG_ASYNC_LINE
+    assert(strstr(deferred_lines[2], ")     42|xxx") != NULL);
+    assert(strlen(deferred_lines[2]) == SC_LOG_ASYNC_LINE - 1);
+}
+#else
+void test_async(void)
+{
+}
+
+void test_deferred(void)
+{
+}
+#endif
+
 int log_callback(void *arg, enum sc_log_level level,
                  const char *fmt, va_list va)
 {
@@ -351,6 +977,14 @@ int main()
     fail_test();
     example();
     test1();
+    test_async();
+    test_deferred();
+    test_rotation();
+    test_limit();
+    test_binary();
+    test_module();
+    test_hist();
+    test_ring();
 
     return 0;
 }
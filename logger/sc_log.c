@@ -29,9 +29,35 @@
 #include "sc_log.h"
 
 #include <ctype.h>
+#include <stddef.h>
 #include <errno.h>
 #include <time.h>
 
+#ifdef SC_STATS
+    #include "sc_stats.h"
+#elif !defined(SC_STATS_ADD)
+    #define SC_STATS_ADD(name, n) ((void) (n))
+    #define SC_STATS_MAX(name, v) ((void) (v))
+#endif
+
+#ifdef SC_LOG_HAVE_BINARY
+    #include "sc_buf.h"
+    #include "sc_time.h"
+
+    #define sc_log_mono() sc_time_mono_ns()
+#else
+    #define sc_log_mono() 0
+#endif
+
+#ifdef SC_LOG_HAVE_HIST
+    #include "sc_hist.h"
+    #include "sc_time.h"
+#endif
+
+#ifdef SC_LOG_HAVE_SIGNAL
+    #include "sc_signal.h"
+#endif
+
 #ifndef thread_local
     #if __STDC_VERSION__ >= 201112 && !defined __STDC_NO_THREADS__
         #define thread_local _Thread_local
@@ -45,22 +71,21 @@
     #endif
 #endif
 
-#if __STDC_VERSION__ >= 201112 && !defined __STDC_NO_ATOMIC__
-    #define SC_ATOMIC
-    #include <stdatomic.h>
+thread_local char sc_name[32] = "Thread";
 
-    #define sc_atomic _Atomic
-    #define sc_atomic_store(var, val)                                          \
-        (atomic_store_explicit(var, val, memory_order_relaxed))
-    #define sc_atomic_load(var)                                                \
-        (atomic_load_explicit(var, memory_order_relaxed))
-#else
-    #define sc_atomic
-    #define sc_atomic_store(var, val) ((*(var)) = (val))
-    #define sc_atomic_load(var)       (*(var))
-#endif
+// Date part of the log header, formatted once per second per thread.
+struct sc_log_date
+{
+    time_t time;
+    char str[64];
+};
 
-thread_local char sc_name[32] = "Thread";
+thread_local struct sc_log_date sc_date = {.time = (time_t) -1};
+
+#ifdef SC_LOG_HAVE_HIST
+// Latency histogram of this thread, see sc_log_set_hist().
+thread_local struct sc_hist *sc_log_hist;
+#endif
 
 #if defined(_WIN32) || defined(_WIN64)
 
@@ -96,6 +121,66 @@ void sc_log_mutex_unlock(struct sc_log_mutex *mtx)
     LeaveCriticalSection(&mtx->mtx);
 }
 
+struct sc_log_cond
+{
+    CONDITION_VARIABLE cond;
+};
+
+int sc_log_cond_init(struct sc_log_cond *c)
+{
+    InitializeConditionVariable(&c->cond);
+    return 0;
+}
+
+void sc_log_cond_term(struct sc_log_cond *c)
+{
+    (void) c;
+}
+
+void sc_log_cond_wait(struct sc_log_cond *c, struct sc_log_mutex *mtx)
+{
+    SleepConditionVariableCS(&c->cond, &mtx->mtx, INFINITE);
+}
+
+void sc_log_cond_signal(struct sc_log_cond *c)
+{
+    WakeAllConditionVariable(&c->cond);
+}
+
+struct sc_log_thread
+{
+    HANDLE id;
+    void *(*fn)(void *);
+    void *arg;
+};
+
+static DWORD WINAPI sc_log_thread_fn(void *arg)
+{
+    struct sc_log_thread *t = arg;
+
+    t->fn(t->arg);
+    return 0;
+}
+
+int sc_log_thread_start(struct sc_log_thread *t, void *(*fn)(void *),
+                        void *arg)
+{
+    t->fn = fn;
+    t->arg = arg;
+
+    t->id = CreateThread(NULL, 0, sc_log_thread_fn, t, 0, NULL);
+    return t->id == NULL ? -1 : 0;
+}
+
+int sc_log_thread_join(struct sc_log_thread *t)
+{
+    if (WaitForSingleObject(t->id, INFINITE) == WAIT_FAILED) {
+        return -1;
+    }
+
+    return CloseHandle(t->id) ? 0 : -1;
+}
+
 #else
 
     #include <pthread.h>
@@ -141,7 +226,135 @@ void sc_log_mutex_unlock(struct sc_log_mutex *mtx)
     pthread_mutex_unlock(&mtx->mtx);
 }
 
+struct sc_log_cond
+{
+    pthread_cond_t cond;
+};
+
+int sc_log_cond_init(struct sc_log_cond *c)
+{
+    return pthread_cond_init(&c->cond, NULL);
+}
+
+void sc_log_cond_term(struct sc_log_cond *c)
+{
+    pthread_cond_destroy(&c->cond);
+}
+
+void sc_log_cond_wait(struct sc_log_cond *c, struct sc_log_mutex *mtx)
+{
+    pthread_cond_wait(&c->cond, &mtx->mtx);
+}
+
+void sc_log_cond_signal(struct sc_log_cond *c)
+{
+    pthread_cond_broadcast(&c->cond);
+}
+
+struct sc_log_thread
+{
+    pthread_t id;
+};
+
+int sc_log_thread_start(struct sc_log_thread *t, void *(*fn)(void *),
+                        void *arg)
+{
+    return pthread_create(&t->id, NULL, fn, arg);
+}
+
+int sc_log_thread_join(struct sc_log_thread *t)
+{
+    return pthread_join(t->id, NULL);
+}
+
+#endif
+
+// Atomics for the async ring, sequentially consistent to keep it simple.
+#if defined(__GNUC__) || defined(__clang__)
+    #define SC_LOG_HAVE_ASYNC
+
+    #define sc_log_load(p)     __atomic_load_n(p, __ATOMIC_SEQ_CST)
+    #define sc_log_store(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+    #define sc_log_add(p, v)   __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST)
+    #define sc_log_cas(p, old, val)                                            \
+        __atomic_compare_exchange_n(p, &(uint64_t){old}, val, false,           \
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#elif defined(_MSC_VER)
+    #define SC_LOG_HAVE_ASYNC
+
+    #define sc_log_load(p) ((uint64_t) InterlockedOr64((LONG64 *) (p), 0))
+    #define sc_log_store(p, v)                                                 \
+        InterlockedExchange64((LONG64 *) (p), (LONG64) (v))
+    #define sc_log_add(p, v)                                                   \
+        InterlockedExchangeAdd64((LONG64 *) (p), (LONG64) (v))
+    #define sc_log_cas(p, old, val)                                            \
+        (InterlockedCompareExchange64((LONG64 *) (p), (LONG64) (val),          \
+                                      (LONG64) (old)) == (LONG64) (old))
+#endif
+
+// Atomics for the rate limit callsites. Without compiler atomics, plain
+// accesses like sc_atomic in sc_log.h, counts are approximate then.
+#if defined(__GNUC__) || defined(__clang__)
+    #define sc_log_cas_limit(p, old, val)                                      \
+        __atomic_compare_exchange_n(p, &(struct sc_log_limit *){old}, val,     \
+                                    false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+    #define sc_log_load_limit(p) __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#elif defined(_MSC_VER)
+    #define sc_log_cas_limit(p, old, val)                                      \
+        (InterlockedCompareExchangePointer((PVOID *) (p), (val), (old)) ==     \
+         (old))
+    #define sc_log_load_limit(p)                                               \
+        ((struct sc_log_limit *) InterlockedCompareExchangePointer(            \
+                (PVOID *) (p), NULL, NULL))
+#else
+    #define sc_log_load(p)     (*(p))
+    #define sc_log_store(p, v) (*(p) = (v))
+    #define sc_log_add(p, v)   ((*(p) += (v)) - (v))
+    #define sc_log_cas(p, old, val)                                            \
+        (*(p) == (old) ? (*(p) = (val), true) : false)
+    #define sc_log_cas_limit(p, old, val) sc_log_cas(p, old, val)
+    #define sc_log_load_limit(p)          (*(p))
+#endif
+
+struct sc_log_rec
+{
+    uint64_t seq;
+    time_t time;
+    enum sc_log_level level;
+    const char *fmt; // Not NULL if 'msg' holds packed arguments
+#ifdef SC_LOG_HAVE_BINARY
+    uint64_t mono;
+    uint32_t len; // Not 0 if 'msg' holds an encoded record
 #endif
+    char name[32];
+    char msg[SC_LOG_ASYNC_LINE];
+};
+
+/**
+ * Bounded multi-producer queue, see Dmitry Vyukov's "Bounded MPMC queue".
+ * Each slot has a sequence number, producers claim a slot with a CAS on
+ * 'head' and publish it by storing the sequence. Writer is the only consumer.
+ */
+struct sc_log_async
+{
+    struct sc_log_rec *recs;
+    uint64_t mask;
+    uint64_t head;
+    char pad[64];
+    uint64_t tail;
+    uint64_t sleeping;
+    uint64_t blocked;
+    uint64_t stop;
+    uint64_t dropped;
+    uint64_t reported;
+    enum sc_log_overflow policy;
+    bool deferred;
+
+    struct sc_log_mutex mtx;
+    struct sc_log_cond ready;
+    struct sc_log_cond space;
+    struct sc_log_thread thread;
+};
 
 struct sc_log
 {
@@ -149,17 +362,30 @@ struct sc_log
     const char *current_file;
     const char *prev_file;
     size_t file_size;
+    size_t max_size;
+    uint32_t keep;
+    uint32_t interval;
+    time_t period;
 
     struct sc_log_mutex mtx;
-    sc_atomic enum sc_log_level level;
+    struct sc_log_module *modules;
 
     bool to_stdout;
 
     void *arg;
     int (*cb)(void *, enum sc_log_level, const char *, va_list);
+
+#ifdef SC_LOG_HAVE_BINARY
+    enum sc_log_format format;
+    void *rec_arg;
+    int (*rec_cb)(void *, const void *, uint32_t);
+#endif
+
+    struct sc_log_async *async;
 };
 
 struct sc_log sc_log;
+sc_atomic enum sc_log_level sc_log_min = SC_LOG_INFO;
 
 int sc_log_init(void)
 {
@@ -167,8 +393,10 @@ int sc_log_init(void)
 
     sc_log = (struct sc_log){0};
 
-    sc_atomic_store(&sc_log.level, SC_LOG_INFO);
+    sc_atomic_store(&sc_log_min, SC_LOG_INFO);
     sc_log.to_stdout = true;
+    sc_log.max_size = SC_LOG_FILE_SIZE;
+    sc_log.keep = 1;
 
     rc = sc_log_mutex_init(&sc_log.mtx);
     if (rc != 0) {
@@ -178,13 +406,27 @@ int sc_log_init(void)
     return rc;
 }
 
+#ifdef SC_LOG_HAVE_ASYNC
+static int sc_log_async_stop(void);
+#endif
+
+static void sc_log_flush_limits(void);
+
 int sc_log_term(void)
 {
     int rc = 0;
 
+    sc_log_flush_limits();
+
+#ifdef SC_LOG_HAVE_ASYNC
+    // Writer drains the queue before it exits, no record is lost.
+    if (sc_log.async != NULL) {
+        rc = sc_log_async_stop();
+    }
+#endif
+
     if (sc_log.fp) {
-        rc = fclose(sc_log.fp);
-        if (rc != 0) {
+        if (fclose(sc_log.fp) != 0) {
             rc = -1;
         }
     }
@@ -214,19 +456,13 @@ static int sc_strcasecmp(const char *a, const char *b)
     }
 }
 
-int sc_log_set_level(const char *str)
+static int sc_log_level_id(const char *str, enum sc_log_level *level)
 {
     size_t count = sizeof(sc_log_levels) / sizeof(sc_log_levels[0]);
 
     for (size_t i = 0; i < count; i++) {
         if (sc_strcasecmp(str, sc_log_levels[i].str) == 0) {
-#ifdef SC_ATOMIC
-            sc_atomic_store(&sc_log.level, sc_log_levels[i].id);
-#else
-            sc_log_mutex_lock(&sc_log.mtx);
-            sc_log.level = sc_log_levels[i].id;
-            sc_log_mutex_unlock(&sc_log.mtx);
-#endif
+            *level = sc_log_levels[i].id;
             return 0;
         }
     }
@@ -234,6 +470,70 @@ int sc_log_set_level(const char *str)
     return -1;
 }
 
+int sc_log_set_level(const char *str)
+{
+    enum sc_log_level level;
+
+    if (sc_log_level_id(str, &level) != 0) {
+        return -1;
+    }
+
+    sc_log_mutex_lock(&sc_log.mtx);
+    sc_atomic_store(&sc_log_min, level);
+
+    for (struct sc_log_module *m = sc_log.modules; m != NULL; m = m->next) {
+        if (!m->custom) {
+            sc_atomic_store(&m->level, level);
+        }
+    }
+    sc_log_mutex_unlock(&sc_log.mtx);
+
+    return 0;
+}
+
+void sc_log_add_module(struct sc_log_module *m)
+{
+    struct sc_log_module *it;
+
+    sc_log_mutex_lock(&sc_log.mtx);
+
+    for (it = sc_log.modules; it != NULL && it != m; it = it->next) {
+    }
+
+    if (it == NULL) {
+        m->custom = false;
+        m->next = sc_log.modules;
+        sc_log.modules = m;
+        sc_atomic_store(&m->level, sc_atomic_load(&sc_log_min));
+    }
+
+    sc_log_mutex_unlock(&sc_log.mtx);
+}
+
+int sc_log_set_module_level(const char *name, const char *str)
+{
+    int rc = -1;
+    enum sc_log_level level = SC_LOG_INFO;
+
+    if (str != NULL && sc_log_level_id(str, &level) != 0) {
+        return -1;
+    }
+
+    sc_log_mutex_lock(&sc_log.mtx);
+
+    for (struct sc_log_module *m = sc_log.modules; m != NULL; m = m->next) {
+        if (strcmp(m->name, name) == 0) {
+            m->custom = str != NULL;
+            sc_atomic_store(&m->level, m->custom ? level : sc_log_min);
+            rc = 0;
+        }
+    }
+
+    sc_log_mutex_unlock(&sc_log.mtx);
+
+    return rc;
+}
+
 void sc_log_set_stdout(bool enable)
 {
     sc_log_mutex_lock(&sc_log.mtx);
@@ -241,6 +541,15 @@ void sc_log_set_stdout(bool enable)
     sc_log_mutex_unlock(&sc_log.mtx);
 }
 
+static bool sc_log_is_binary(void)
+{
+#ifdef SC_LOG_HAVE_BINARY
+    return sc_log.format == SC_LOG_BINARY;
+#else
+    return false;
+#endif
+}
+
 int sc_log_set_file(const char *prev_file, const char *current_file)
 {
     int rc = 0, saved_errno = 0;
@@ -261,14 +570,24 @@ int sc_log_set_file(const char *prev_file, const char *current_file)
         goto out;
     }
 
-    fp = fopen(sc_log.current_file, "a+");
-    if (fp == NULL || fprintf(fp, "\n") < 0 || (size = ftell(fp)) < 0) {
+    fp = fopen(sc_log.current_file, sc_log_is_binary() ? "ab+" : "a+");
+    if (fp == NULL) {
+        goto error;
+    }
+
+    // Separates sessions in text files
+    if ((!sc_log_is_binary() && fprintf(fp, "\n") < 0) ||
+        (size = ftell(fp)) < 0) {
         goto error;
     }
 
     sc_log.file_size = (size_t) size;
     sc_log.fp = fp;
 
+    if (sc_log.interval != 0) {
+        sc_log.period = time(NULL) / sc_log.interval;
+    }
+
     goto out;
 
 error:
@@ -285,6 +604,19 @@ out:
     return rc;
 }
 
+void sc_log_set_rotation(size_t size, uint32_t count, uint32_t interval)
+{
+    sc_log_mutex_lock(&sc_log.mtx);
+    sc_log.max_size = size;
+    sc_log.keep = count;
+    sc_log.interval = interval;
+
+    if (interval != 0) {
+        sc_log.period = time(NULL) / interval;
+    }
+    sc_log_mutex_unlock(&sc_log.mtx);
+}
+
 void sc_log_set_callback(void *arg, int (*cb)(void *, enum sc_log_level,
                                               const char *, va_list))
 {
@@ -294,19 +626,45 @@ void sc_log_set_callback(void *arg, int (*cb)(void *, enum sc_log_level,
     sc_log_mutex_unlock(&sc_log.mtx);
 }
 
-static int sc_log_print_header(FILE *fp, enum sc_log_level level)
+#ifdef SC_LOG_HAVE_BINARY
+void sc_log_set_format(enum sc_log_format format)
+{
+    sc_log_mutex_lock(&sc_log.mtx);
+    sc_log.format = format;
+    sc_log_mutex_unlock(&sc_log.mtx);
+}
+
+void sc_log_set_record_callback(void *arg,
+                                int (*cb)(void *, const void *, uint32_t))
+{
+    sc_log_mutex_lock(&sc_log.mtx);
+    sc_log.rec_arg = arg;
+    sc_log.rec_cb = cb;
+    sc_log_mutex_unlock(&sc_log.mtx);
+}
+#endif
+
+static int sc_log_print_header(FILE *fp, enum sc_log_level level, time_t t,
+                               const char *name)
 {
     int rc;
-    time_t t = time(NULL);
-    struct tm *tm = localtime(&t);
+    struct tm *tm;
 
-    if (tm == NULL) {
-        return -1;
+    if (t != sc_date.time) {
+        tm = localtime(&t);
+        if (tm == NULL) {
+            return -1;
+        }
+
+        snprintf(sc_date.str, sizeof(sc_date.str),
+                 "[%d-%02d-%02d %02d:%02d:%02d]", tm->tm_year + 1900,
+                 tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min,
+                 tm->tm_sec);
+        sc_date.time = t;
     }
 
-    rc = fprintf(fp, "[%d-%02d-%02d %02d:%02d:%02d][%-5s][%s] ",
-                 tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour,
-                 tm->tm_min, tm->tm_sec, sc_log_levels[level].str, sc_name);
+    rc = fprintf(fp, "%s[%-5s][%s] ", sc_date.str, sc_log_levels[level].str,
+                 name);
     if (rc < 0) {
         return -1;
     }
@@ -314,11 +672,12 @@ static int sc_log_print_header(FILE *fp, enum sc_log_level level)
     return 0;
 }
 
-static int sc_log_stdout(enum sc_log_level level, const char *fmt, va_list va)
+static int sc_log_stdout(enum sc_log_level level, time_t t, const char *name,
+                         const char *fmt, va_list va)
 {
     int rc;
 
-    rc = sc_log_print_header(stdout, level);
+    rc = sc_log_print_header(stdout, level, t, name);
     if (rc < 0) {
         return -1;
     }
@@ -331,81 +690,1325 @@ static int sc_log_stdout(enum sc_log_level level, const char *fmt, va_list va)
     return 0;
 }
 
-static int sc_log_file(enum sc_log_level level, const char *fmt, va_list va)
+// Shifts previous files by one generation, e.g prev -> prev.1 -> prev.2
+static void sc_log_shift(void)
 {
-    int rc, size;
+    char src[SC_LOG_PATH_MAX], dst[SC_LOG_PATH_MAX];
+    int rc;
 
-    rc = sc_log_print_header(sc_log.fp, level);
-    if (rc < 0) {
-        return -1;
+    if (sc_log.keep == 0) {
+        return;
     }
 
-    size = vfprintf(sc_log.fp, fmt, va);
-    if (size < 0) {
-        return -1;
+    for (uint32_t i = sc_log.keep - 1; i > 0; i--) {
+        if (i == 1) {
+            rc = snprintf(src, sizeof(src), "%s", sc_log.prev_file);
+        } else {
+            rc = snprintf(src, sizeof(src), "%s.%u", sc_log.prev_file, i - 1);
+        }
+
+        if (rc < 0 || (size_t) rc >= sizeof(src)) {
+            continue;
+        }
+
+        rc = snprintf(dst, sizeof(dst), "%s.%u", sc_log.prev_file, i);
+        if (rc < 0 || (size_t) rc >= sizeof(dst)) {
+            continue;
+        }
+
+        // rename() does not replace the destination on Windows.
+        (void) remove(dst);
+        (void) rename(src, dst);
     }
 
-    sc_log.file_size += size;
+    (void) remove(sc_log.prev_file);
+    (void) rename(sc_log.current_file, sc_log.prev_file);
+}
 
-    if (sc_log.file_size > SC_LOG_FILE_SIZE) {
-        fclose(sc_log.fp);
-        (void) rename(sc_log.current_file, sc_log.prev_file);
+static int sc_log_rotate(void)
+{
+    fclose(sc_log.fp);
+    sc_log_shift();
+
+    sc_log.file_size = 0;
+    sc_log.fp = fopen(sc_log.current_file, sc_log_is_binary() ? "wb+" : "w+");
+    if (sc_log.fp == NULL) {
+        return -1;
+    }
+
+    return 0;
+}
 
-        sc_log.fp = fopen(sc_log.current_file, "w+");
-        if (sc_log.fp == NULL) {
+// Time based rotation, called before writing to the file.
+static int sc_log_file_begin(time_t t)
+{
+    if (sc_log.interval != 0 && t / sc_log.interval != sc_log.period) {
+        sc_log.period = t / sc_log.interval;
+        if (sc_log.file_size > 0 && sc_log_rotate() != 0) {
             return -1;
         }
+    }
+
+    return 0;
+}
+
+// Size based rotation, called after writing 'size' bytes to the file.
+static int sc_log_file_end(size_t size)
+{
+    sc_log.file_size += size;
 
-        sc_log.file_size = 0;
+    if (sc_log.max_size != 0 && sc_log.file_size > sc_log.max_size) {
+        if (sc_log_rotate() != 0) {
+            return -1;
+        }
     }
 
-    return rc;
+    return 0;
 }
 
-int sc_log_log(enum sc_log_level level, const char *fmt, ...)
+static int sc_log_file(enum sc_log_level level, time_t t, const char *name,
+                       const char *fmt, va_list va)
 {
-    int rc = 0;
-    va_list va;
+    int rc, size;
 
-    // Use relaxed atomics to avoid locking cost, e.g DEBUG logs when
-    // level=INFO will get away without any synchronization on most platforms.
-#ifdef SC_ATOMIC
-    enum sc_log_level curr;
+    if (sc_log_file_begin(t) != 0) {
+        return -1;
+    }
 
-    curr = sc_atomic_load(&sc_log.level);
-    if (level < curr) {
-        return 0;
+    rc = sc_log_print_header(sc_log.fp, level, t, name);
+    if (rc < 0) {
+        return -1;
     }
-#endif
 
-    sc_log_mutex_lock(&sc_log.mtx);
+    size = vfprintf(sc_log.fp, fmt, va);
+    if (size < 0) {
+        return -1;
+    }
 
-#ifndef SC_ATOMIC
-    if (level < sc_log.level) {
-        sc_log_mutex_unlock(&sc_log.mtx);
-        return 0;
+    if (sc_log_file_end((size_t) size) != 0) {
+        return -1;
     }
-#endif
 
-    if (sc_log.to_stdout) {
-        va_start(va, fmt);
-        rc |= sc_log_stdout(level, fmt, va);
-        va_end(va);
+    return rc;
+}
+
+#ifdef SC_LOG_HAVE_BINARY
+    #define sc_log_text_file()                                                 \
+        (sc_log.fp != NULL && sc_log.format == SC_LOG_TEXT)
+    #define sc_log_binary()                                                    \
+        (sc_log.rec_cb != NULL ||                                              \
+         (sc_log.fp != NULL && sc_log.format == SC_LOG_BINARY))
+
+static uint64_t sc_log_rec_len(const char *name, const char *msg,
+                               const struct sc_log_field *fields,
+                               uint32_t count)
+{
+    uint64_t len = sc_buf_32_len(0) + sc_buf_8_len(0) + sc_buf_64_len(0) * 2 +
+                   sc_buf_str_len(name) + sc_buf_str_len(msg) + sc_buf_8_len(0);
+
+    for (uint32_t i = 0; i < count; i++) {
+        len += sc_buf_str_len(fields[i].key) + sc_buf_8_len(0);
+        len += fields[i].type == SC_LOG_TYPE_STR ?
+                       sc_buf_str_len(fields[i].val.s) :
+                       sc_buf_64_len(0);
     }
 
-    if (sc_log.fp != NULL) {
-        va_start(va, fmt);
-        rc |= sc_log_file(level, fmt, va);
-        va_end(va);
+    return len;
+}
+
+static uint32_t sc_log_encode(void *dst, uint32_t cap, enum sc_log_level level,
+                              time_t t, uint64_t mono, const char *name,
+                              const char *msg,
+                              const struct sc_log_field *fields, uint32_t count)
+{
+    struct sc_buf buf = sc_buf_wrap(dst, cap, SC_BUF_REF);
+
+    // Wrapped buffer does not flag a failed write, so check the size first.
+    if (count > UINT8_MAX ||
+        sc_log_rec_len(name, msg, fields, count) > cap) {
+        return 0;
     }
 
-    if (sc_log.cb) {
-        va_start(va, fmt);
-        rc |= sc_log.cb(sc_log.arg, level, fmt, va);
-        va_end(va);
+    sc_buf_put_32(&buf, 0);
+    sc_buf_put_8(&buf, (uint8_t) level);
+    sc_buf_put_64(&buf, mono);
+    sc_buf_put_64(&buf, (uint64_t) t);
+    sc_buf_put_str(&buf, name);
+    sc_buf_put_str(&buf, msg);
+    sc_buf_put_8(&buf, (uint8_t) count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        sc_buf_put_str(&buf, fields[i].key);
+        sc_buf_put_8(&buf, (uint8_t) fields[i].type);
+
+        switch (fields[i].type) {
+        case SC_LOG_TYPE_INT:
+            sc_buf_put_64(&buf, (uint64_t) fields[i].val.i);
+            break;
+        case SC_LOG_TYPE_UINT:
+            sc_buf_put_64(&buf, fields[i].val.u);
+            break;
+        case SC_LOG_TYPE_DOUBLE:
+            sc_buf_put_double(&buf, fields[i].val.d);
+            break;
+        case SC_LOG_TYPE_STR:
+            sc_buf_put_str(&buf, fields[i].val.s);
+            break;
+        }
     }
 
-    sc_log_mutex_unlock(&sc_log.mtx);
+    if (!sc_buf_valid(&buf)) {
+        return 0;
+    }
 
-    return rc;
+    sc_buf_set_32_at(&buf, 0, sc_buf_size(&buf) - sc_buf_32_len(0));
+
+    return sc_buf_size(&buf);
 }
+
+static void sc_log_append(char *out, size_t cap, size_t *len, const char *fmt,
+                          ...)
+{
+    int rc;
+    va_list va;
+
+    if (*len + 1 >= cap) {
+        return;
+    }
+
+    va_start(va, fmt);
+    rc = vsnprintf(out + *len, cap - *len, fmt, va);
+    va_end(va);
+
+    if (rc > 0) {
+        *len += (size_t) rc < cap - *len ? (size_t) rc : cap - *len - 1;
+    }
+}
+
+// Text form of a record, e.g "msg key=value key=value \n"
+static void sc_log_rec_text(const void *rec, uint32_t len, char *out,
+                            size_t cap)
+{
+    size_t n = 0;
+    uint8_t count, type;
+    const char *key, *str;
+    struct sc_buf buf = sc_buf_wrap((void *) rec, len, SC_BUF_READ);
+
+    sc_buf_get_32(&buf);
+    sc_buf_get_8(&buf);
+    sc_buf_get_64(&buf);
+    sc_buf_get_64(&buf);
+    sc_buf_get_str(&buf);
+
+    str = sc_buf_get_str(&buf);
+    sc_log_append(out, cap, &n, "%s", str ? str : "");
+
+    count = sc_buf_get_8(&buf);
+    for (uint8_t i = 0; i < count && sc_buf_valid(&buf); i++) {
+        key = sc_buf_get_str(&buf);
+        type = sc_buf_get_8(&buf);
+        key = key ? key : "";
+
+        switch (type) {
+        case SC_LOG_TYPE_INT:
+            sc_log_append(out, cap, &n, " %s=%lld", key,
+                          (long long) (int64_t) sc_buf_get_64(&buf));
+            break;
+        case SC_LOG_TYPE_UINT:
+            sc_log_append(out, cap, &n, " %s=%llu", key,
+                          (unsigned long long) sc_buf_get_64(&buf));
+            break;
+        case SC_LOG_TYPE_DOUBLE:
+            sc_log_append(out, cap, &n, " %s=%g", key, sc_buf_get_double(&buf));
+            break;
+        case SC_LOG_TYPE_STR:
+            str = sc_buf_get_str(&buf);
+            sc_log_append(out, cap, &n, " %s=%s", key, str ? str : "");
+            break;
+        default:
+            break;
+        }
+    }
+
+    sc_log_append(out, cap, &n, " \n");
+    out[n] = '\0';
+}
+
+// Binary destinations, must be called with 'sc_log.mtx' held.
+static int sc_log_records(time_t t, const void *rec, uint32_t len)
+{
+    int rc = 0;
+
+    if (sc_log.fp != NULL && sc_log.format == SC_LOG_BINARY) {
+        if (sc_log_file_begin(t) != 0 ||
+            fwrite(rec, 1, len, sc_log.fp) != len ||
+            sc_log_file_end(len) != 0) {
+            rc = -1;
+        }
+    }
+
+    if (sc_log.rec_cb) {
+        rc |= sc_log.rec_cb(sc_log.rec_arg, rec, len);
+    }
+
+    return rc;
+}
+#else
+    #define sc_log_text_file() (sc_log.fp != NULL)
+#endif
+
+// Writes to text destinations, must be called with 'sc_log.mtx' held.
+static int sc_log_text(enum sc_log_level level, time_t t, const char *name,
+                       const char *fmt, va_list va)
+{
+    int rc = 0;
+    va_list copy;
+
+    if (sc_log.to_stdout) {
+        va_copy(copy, va);
+        rc |= sc_log_stdout(level, t, name, fmt, copy);
+        va_end(copy);
+    }
+
+    if (sc_log_text_file()) {
+        va_copy(copy, va);
+        rc |= sc_log_file(level, t, name, fmt, copy);
+        va_end(copy);
+    }
+
+    if (sc_log.cb) {
+        va_copy(copy, va);
+        rc |= sc_log.cb(sc_log.arg, level, fmt, copy);
+        va_end(copy);
+    }
+
+    return rc;
+}
+
+// Writes to all destinations, must be called with 'sc_log.mtx' held.
+static int sc_log_sinks(enum sc_log_level level, time_t t, uint64_t mono,
+                        const char *name, const char *fmt, va_list va)
+{
+    int rc;
+#ifdef SC_LOG_HAVE_BINARY
+    uint32_t len;
+    va_list copy;
+    char line[SC_LOG_ASYNC_LINE];
+    unsigned char rec[SC_LOG_REC_SIZE];
+#endif
+
+    rc = sc_log_text(level, t, name, fmt, va);
+
+#ifdef SC_LOG_HAVE_BINARY
+    // Text lines are converted into records without fields.
+    if (sc_log_binary()) {
+        va_copy(copy, va);
+        vsnprintf(line, sizeof(line), fmt, copy);
+        va_end(copy);
+
+        len = sc_log_encode(rec, sizeof(rec), level, t, mono, name, line, NULL,
+                            0);
+        rc |= len != 0 ? sc_log_records(t, rec, len) : -1;
+    }
+#else
+    (void) mono;
+#endif
+
+    return rc;
+}
+
+#ifdef SC_LOG_HAVE_BINARY
+static int sc_log_textf(enum sc_log_level level, time_t t, const char *name,
+                        const char *fmt, ...)
+{
+    int rc;
+    va_list va;
+
+    va_start(va, fmt);
+    rc = sc_log_text(level, t, name, fmt, va);
+    va_end(va);
+
+    return rc;
+}
+
+// Writes an encoded record, must be called with 'sc_log.mtx' held.
+static int sc_log_rec_sinks(enum sc_log_level level, time_t t,
+                            const char *name, const void *rec, uint32_t len)
+{
+    int rc = 0;
+    char line[SC_LOG_REC_SIZE];
+
+    if (sc_log.to_stdout || sc_log_text_file() || sc_log.cb) {
+        sc_log_rec_text(rec, len, line, sizeof(line));
+        rc |= sc_log_textf(level, t, name, "%s", line);
+    }
+
+    rc |= sc_log_records(t, rec, len);
+
+    return rc;
+}
+#endif
+
+#ifdef SC_LOG_HAVE_ASYNC
+
+enum sc_log_len
+{
+    SC_LOG_LEN_NONE,
+    SC_LOG_LEN_HH,
+    SC_LOG_LEN_H,
+    SC_LOG_LEN_L,
+    SC_LOG_LEN_LL,
+    SC_LOG_LEN_J,
+    SC_LOG_LEN_Z,
+    SC_LOG_LEN_T,
+    SC_LOG_LEN_BIG_L,
+};
+
+struct sc_log_spec
+{
+    const char *flags; // Flags, width and precision
+    int flags_len;
+    enum sc_log_len len;
+    char conv;
+};
+
+/**
+ * Parses a conversion specification, 'p' points to '%'. Returns the position
+ * after the specification or NULL if it is not supported for deferred
+ * formatting, e.g '*' width, %n or wide characters.
+ */
+static const char *sc_log_spec(const char *p, struct sc_log_spec *spec)
+{
+    *spec = (struct sc_log_spec){.flags = ++p};
+
+    if (*p == '%') {
+        spec->conv = '%';
+        return p + 1;
+    }
+
+    while (*p && strchr("-+ #0123456789.", *p) != NULL) {
+        p++;
+    }
+
+    spec->flags_len = (int) (p - spec->flags);
+    if (spec->flags_len > 16) {
+        return NULL;
+    }
+
+    switch (*p) {
+    case 'h':
+        spec->len = p[1] == 'h' ? SC_LOG_LEN_HH : SC_LOG_LEN_H;
+        p += p[1] == 'h' ? 2 : 1;
+        break;
+    case 'l':
+        spec->len = p[1] == 'l' ? SC_LOG_LEN_LL : SC_LOG_LEN_L;
+        p += p[1] == 'l' ? 2 : 1;
+        break;
+    case 'j':
+        spec->len = SC_LOG_LEN_J;
+        p++;
+        break;
+    case 'z':
+        spec->len = SC_LOG_LEN_Z;
+        p++;
+        break;
+    case 't':
+        spec->len = SC_LOG_LEN_T;
+        p++;
+        break;
+    case 'L':
+        spec->len = SC_LOG_LEN_BIG_L;
+        p++;
+        break;
+    default:
+        break;
+    }
+
+    if (*p == '\0' || strchr("diouxXcfFeEgGaAsp", *p) == NULL) {
+        return NULL;
+    }
+
+    if ((*p == 'c' || *p == 's') && spec->len != SC_LOG_LEN_NONE) {
+        return NULL;
+    }
+
+    spec->conv = *p;
+
+    return p + 1;
+}
+
+static intmax_t sc_log_arg_int(enum sc_log_len len, va_list *va)
+{
+    switch (len) {
+    case SC_LOG_LEN_HH:
+        return (signed char) va_arg(*va, int);
+    case SC_LOG_LEN_H:
+        return (short) va_arg(*va, int);
+    case SC_LOG_LEN_L:
+        return va_arg(*va, long);
+    case SC_LOG_LEN_LL:
+        return va_arg(*va, long long);
+    case SC_LOG_LEN_J:
+        return va_arg(*va, intmax_t);
+    case SC_LOG_LEN_Z:
+        return (intmax_t) va_arg(*va, size_t);
+    case SC_LOG_LEN_T:
+        return va_arg(*va, ptrdiff_t);
+    default:
+        return va_arg(*va, int);
+    }
+}
+
+static uintmax_t sc_log_arg_uint(enum sc_log_len len, va_list *va)
+{
+    switch (len) {
+    case SC_LOG_LEN_HH:
+        return (unsigned char) va_arg(*va, unsigned int);
+    case SC_LOG_LEN_H:
+        return (unsigned short) va_arg(*va, unsigned int);
+    case SC_LOG_LEN_L:
+        return va_arg(*va, unsigned long);
+    case SC_LOG_LEN_LL:
+        return va_arg(*va, unsigned long long);
+    case SC_LOG_LEN_J:
+        return va_arg(*va, uintmax_t);
+    case SC_LOG_LEN_Z:
+        return va_arg(*va, size_t);
+    case SC_LOG_LEN_T:
+        return (uintmax_t) va_arg(*va, ptrdiff_t);
+    default:
+        return va_arg(*va, unsigned int);
+    }
+}
+
+/**
+ * Deferred formatting, copies arguments into 'rec->msg' in binary, integers
+ * as intmax_t/uintmax_t, floating points as long double. Strings are copied
+ * as they might not outlive the call. Format string pointer is kept, so it
+ * must be a string literal. Returns false if the format is not supported or
+ * arguments do not fit, caller formats the line immediately in that case.
+ */
+static bool sc_log_pack(struct sc_log_rec *rec, const char *fmt, va_list args)
+{
+    bool rc = false;
+    size_t n, off = 0;
+    const char *p = fmt, *str;
+    struct sc_log_spec spec;
+    union
+    {
+        intmax_t i;
+        uintmax_t u;
+        long double d;
+        void *ptr;
+    } v;
+    va_list va;
+
+    va_copy(va, args);
+
+    while (*p != '\0') {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+
+        p = sc_log_spec(p, &spec);
+        if (p == NULL) {
+            goto out;
+        }
+
+        switch (spec.conv) {
+        case '%':
+            continue;
+        case 'd':
+        case 'i':
+        case 'c':
+            v.i = sc_log_arg_int(spec.len, &va);
+            n = sizeof(v.i);
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            v.u = sc_log_arg_uint(spec.len, &va);
+            n = sizeof(v.u);
+            break;
+        case 'p':
+            v.ptr = va_arg(va, void *);
+            n = sizeof(v.ptr);
+            break;
+        case 's':
+            str = va_arg(va, const char *);
+            str = str != NULL ? str : "(null)";
+            n = strlen(str) + 1;
+            if (n > sizeof(rec->msg) - off) {
+                goto out;
+            }
+
+            memcpy(rec->msg + off, str, n);
+            off += n;
+            continue;
+        default:
+            if (spec.len == SC_LOG_LEN_BIG_L) {
+                v.d = va_arg(va, long double);
+            } else {
+                v.d = va_arg(va, double);
+            }
+            n = sizeof(v.d);
+            break;
+        }
+
+        if (n > sizeof(rec->msg) - off) {
+            goto out;
+        }
+
+        memcpy(rec->msg + off, &v, n);
+        off += n;
+    }
+
+    rec->fmt = fmt;
+    rc = true;
+out:
+    va_end(va);
+
+    return rc;
+}
+
+// Renders a packed record into 'out', runs on the writer thread.
+static void sc_log_render(struct sc_log_rec *rec, char *out, size_t cap)
+{
+    int rc;
+    char fmt[32];
+    size_t i, len = 0, off = 0;
+    const char *p = rec->fmt, *mod;
+    struct sc_log_spec spec;
+    union
+    {
+        intmax_t i;
+        uintmax_t u;
+        long double d;
+        void *ptr;
+    } v;
+
+    while (*p != '\0' && len < cap - 1) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+
+        p = sc_log_spec(p, &spec);
+        if (spec.conv == '%') {
+            out[len++] = '%';
+            continue;
+        }
+
+        // Rebuild the specification with the length modifier of stored type
+        mod = "";
+        if (strchr("diouxX", spec.conv) != NULL) {
+            mod = "j";
+        } else if (strchr("fFeEgGaA", spec.conv) != NULL) {
+            mod = "L";
+        }
+
+        i = 0;
+        fmt[i++] = '%';
+        memcpy(fmt + i, spec.flags, (size_t) spec.flags_len);
+        i += (size_t) spec.flags_len;
+        while (*mod) {
+            fmt[i++] = *mod++;
+        }
+        fmt[i++] = spec.conv;
+        fmt[i] = '\0';
+
+        if (spec.conv == 's') {
+            rc = snprintf(out + len, cap - len, fmt, rec->msg + off);
+            off += strlen(rec->msg + off) + 1;
+        } else if (spec.conv == 'c' || spec.conv == 'd' || spec.conv == 'i') {
+            memcpy(&v.i, rec->msg + off, sizeof(v.i));
+            off += sizeof(v.i);
+            if (spec.conv == 'c') {
+                rc = snprintf(out + len, cap - len, fmt, (int) v.i);
+            } else {
+                rc = snprintf(out + len, cap - len, fmt, v.i);
+            }
+        } else if (strchr("ouxX", spec.conv) != NULL) {
+            memcpy(&v.u, rec->msg + off, sizeof(v.u));
+            off += sizeof(v.u);
+            rc = snprintf(out + len, cap - len, fmt, v.u);
+        } else if (spec.conv == 'p') {
+            memcpy(&v.ptr, rec->msg + off, sizeof(v.ptr));
+            off += sizeof(v.ptr);
+            rc = snprintf(out + len, cap - len, fmt, v.ptr);
+        } else {
+            memcpy(&v.d, rec->msg + off, sizeof(v.d));
+            off += sizeof(v.d);
+            rc = snprintf(out + len, cap - len, fmt, v.d);
+        }
+
+        if (rc < 0) {
+            break;
+        }
+
+        len += (size_t) rc < cap - len ? (size_t) rc : cap - len - 1;
+    }
+
+    out[len] = '\0';
+}
+
+static int sc_log_emit(enum sc_log_level level, time_t t, uint64_t mono,
+                       const char *name, const char *fmt, ...)
+{
+    int rc;
+    va_list va;
+
+    va_start(va, fmt);
+    rc = sc_log_sinks(level, t, mono, name, fmt, va);
+    va_end(va);
+
+    return rc;
+}
+
+static bool sc_log_async_ready(struct sc_log_async *a)
+{
+    struct sc_log_rec *rec = &a->recs[a->tail & a->mask];
+
+    return sc_log_load(&rec->seq) == a->tail + 1;
+}
+
+static uint64_t sc_log_async_drain(struct sc_log_async *a)
+{
+    uint64_t n = 0, dropped, mono;
+    const char *msg;
+    char line[SC_LOG_ASYNC_LINE];
+    struct sc_log_rec *rec;
+
+    sc_log_mutex_lock(&sc_log.mtx);
+
+    // A single batch at most, so setters do not wait for a busy writer.
+    while (n <= a->mask && sc_log_async_ready(a)) {
+        rec = &a->recs[a->tail & a->mask];
+        msg = rec->msg;
+        mono = 0;
+
+#ifdef SC_LOG_HAVE_BINARY
+        mono = rec->mono;
+        if (rec->len != 0) {
+            (void) sc_log_rec_sinks(rec->level, rec->time, rec->name, rec->msg,
+                                    rec->len);
+            goto next;
+        }
+#endif
+        if (rec->fmt != NULL) {
+            sc_log_render(rec, line, sizeof(line));
+            msg = line;
+        }
+
+        (void) sc_log_emit(rec->level, rec->time, mono, rec->name, "%s", msg);
+#ifdef SC_LOG_HAVE_BINARY
+next:
+#endif
+
+        sc_log_store(&rec->seq, a->tail + a->mask + 1);
+        a->tail++;
+        n++;
+    }
+
+    if (a->policy == SC_LOG_COUNT) {
+        dropped = sc_log_load(&a->dropped);
+        if (dropped != a->reported) {
+            (void) sc_log_emit(SC_LOG_WARN, time(NULL), sc_log_mono(), "sc_log",
+                               "%llu log records dropped. \n",
+                               (unsigned long long) (dropped - a->reported));
+            a->reported = dropped;
+        }
+    }
+
+    sc_log_mutex_unlock(&sc_log.mtx);
+
+    if (n > 0 && sc_log_load(&a->blocked) > 0) {
+        sc_log_mutex_lock(&a->mtx);
+        sc_log_cond_signal(&a->space);
+        sc_log_mutex_unlock(&a->mtx);
+    }
+
+    return n;
+}
+
+static void *sc_log_async_run(void *arg)
+{
+    uint64_t stop;
+    struct sc_log_async *a = arg;
+
+    for (;;) {
+        // Records pushed before 'stop' are written before exiting.
+        stop = sc_log_load(&a->stop);
+        if (sc_log_async_drain(a) > 0) {
+            continue;
+        }
+
+        if (stop) {
+            break;
+        }
+
+        // Producers check 'sleeping' after publishing a record, so either
+        // writer sees the record here or the producer sees 'sleeping'.
+        sc_log_mutex_lock(&a->mtx);
+        sc_log_store(&a->sleeping, 1);
+
+        if (!sc_log_async_ready(a) && !sc_log_load(&a->stop)) {
+            sc_log_cond_wait(&a->ready, &a->mtx);
+        }
+
+        sc_log_store(&a->sleeping, 0);
+        sc_log_mutex_unlock(&a->mtx);
+    }
+
+    fflush(stdout);
+
+    return NULL;
+}
+
+static void sc_log_async_wait(struct sc_log_async *a, struct sc_log_rec *rec,
+                              uint64_t pos)
+{
+    sc_log_mutex_lock(&a->mtx);
+    sc_log_add(&a->blocked, 1);
+
+    // Slot is free for 'pos' once its sequence reaches 'pos'
+    while ((int64_t) (sc_log_load(&rec->seq) - pos) < 0) {
+        sc_log_cond_wait(&a->space, &a->mtx);
+    }
+
+    sc_log_add(&a->blocked, (uint64_t) -1);
+    sc_log_mutex_unlock(&a->mtx);
+}
+
+// Claims a slot, returns NULL if the record must be dropped.
+static struct sc_log_rec *sc_log_async_claim(struct sc_log_async *a,
+                                             uint64_t *pos)
+{
+    int64_t diff;
+    uint64_t seq;
+    struct sc_log_rec *rec;
+
+    *pos = sc_log_load(&a->head);
+
+    for (;;) {
+        rec = &a->recs[*pos & a->mask];
+        seq = sc_log_load(&rec->seq);
+        diff = (int64_t) (seq - *pos);
+
+        if (diff == 0) {
+            if (sc_log_cas(&a->head, *pos, *pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            if (a->policy != SC_LOG_BLOCK) {
+                sc_log_add(&a->dropped, 1);
+                SC_STATS_ADD("log.drop", 1);
+                return NULL;
+            }
+
+            sc_log_async_wait(a, rec, *pos);
+        }
+
+        *pos = sc_log_load(&a->head);
+    }
+
+    rec->time = time(NULL);
+    rec->fmt = NULL;
+    memcpy(rec->name, sc_name, sizeof(rec->name));
+#ifdef SC_LOG_HAVE_BINARY
+    rec->mono = sc_log_mono();
+    rec->len = 0;
+#endif
+
+    return rec;
+}
+
+static void sc_log_async_publish(struct sc_log_async *a, struct sc_log_rec *rec,
+                                 uint64_t pos)
+{
+    sc_log_store(&rec->seq, pos + 1);
+
+    if (sc_log_load(&a->sleeping)) {
+        sc_log_mutex_lock(&a->mtx);
+        sc_log_cond_signal(&a->ready);
+        sc_log_mutex_unlock(&a->mtx);
+    }
+}
+
+static int sc_log_async_push(enum sc_log_level level, const char *fmt,
+                             va_list va)
+{
+    bool packed = false;
+    uint64_t pos;
+    struct sc_log_rec *rec;
+    struct sc_log_async *a = sc_log.async;
+
+    rec = sc_log_async_claim(a, &pos);
+    if (rec == NULL) {
+        return -1;
+    }
+
+    rec->level = level;
+
+    if (a->deferred) {
+        packed = sc_log_pack(rec, fmt, va);
+    }
+
+    if (!packed) {
+        rec->fmt = NULL;
+        vsnprintf(rec->msg, sizeof(rec->msg), fmt, va);
+    }
+
+    sc_log_async_publish(a, rec, pos);
+
+    return 0;
+}
+
+    #ifdef SC_LOG_HAVE_BINARY
+static int sc_log_async_push_rec(enum sc_log_level level, const void *data,
+                                 uint32_t len)
+{
+    uint64_t pos;
+    struct sc_log_rec *rec;
+    struct sc_log_async *a = sc_log.async;
+
+    if (len > sizeof(rec->msg)) {
+        return -1;
+    }
+
+    rec = sc_log_async_claim(a, &pos);
+    if (rec == NULL) {
+        return -1;
+    }
+
+    rec->level = level;
+    rec->len = len;
+    memcpy(rec->msg, data, len);
+
+    sc_log_async_publish(a, rec, pos);
+
+    return 0;
+}
+    #endif
+
+static void sc_log_async_free(struct sc_log_async *a)
+{
+    free(a->recs);
+    free(a);
+}
+
+int sc_log_set_async(uint32_t cap, enum sc_log_overflow policy)
+{
+    int rc;
+    uint64_t n = 1;
+    struct sc_log_async *a;
+
+    if (sc_log.async != NULL || cap == 0 || cap > UINT32_MAX / 2 + 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while (n < cap) {
+        n *= 2;
+    }
+
+    a = calloc(1, sizeof(*a));
+    if (a == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    a->recs = malloc(sizeof(*a->recs) * n);
+    if (a->recs == NULL) {
+        rc = ENOMEM;
+        goto error;
+    }
+
+    for (uint64_t i = 0; i < n; i++) {
+        a->recs[i].seq = i;
+    }
+
+    a->mask = n - 1;
+    a->policy = policy;
+
+    rc = sc_log_mutex_init(&a->mtx);
+    if (rc != 0) {
+        goto error;
+    }
+
+    rc = sc_log_cond_init(&a->ready);
+    if (rc != 0) {
+        goto error_ready;
+    }
+
+    rc = sc_log_cond_init(&a->space);
+    if (rc != 0) {
+        goto error_space;
+    }
+
+    rc = sc_log_thread_start(&a->thread, sc_log_async_run, a);
+    if (rc != 0) {
+        goto error_thread;
+    }
+
+    sc_log.async = a;
+
+    return 0;
+
+error_thread:
+    sc_log_cond_term(&a->space);
+error_space:
+    sc_log_cond_term(&a->ready);
+error_ready:
+    sc_log_mutex_term(&a->mtx);
+error:
+    sc_log_async_free(a);
+    errno = rc;
+
+    return -1;
+}
+
+uint64_t sc_log_dropped(void)
+{
+    return sc_log.async ? sc_log_load(&sc_log.async->dropped) : 0;
+}
+
+void sc_log_set_deferred(bool enable)
+{
+    if (sc_log.async != NULL) {
+        sc_log.async->deferred = enable;
+    }
+}
+
+static int sc_log_async_stop(void)
+{
+    int rc;
+    struct sc_log_async *a = sc_log.async;
+
+    sc_log_store(&a->stop, 1);
+
+    sc_log_mutex_lock(&a->mtx);
+    sc_log_cond_signal(&a->ready);
+    sc_log_mutex_unlock(&a->mtx);
+
+    rc = sc_log_thread_join(&a->thread);
+
+    sc_log_cond_term(&a->space);
+    sc_log_cond_term(&a->ready);
+    sc_log_mutex_term(&a->mtx);
+    sc_log_async_free(a);
+    sc_log.async = NULL;
+
+    return rc == 0 ? 0 : -1;
+}
+
+#else
+
+int sc_log_set_async(uint32_t cap, enum sc_log_overflow policy)
+{
+    (void) cap;
+    (void) policy;
+
+    errno = EINVAL;
+    return -1;
+}
+
+uint64_t sc_log_dropped(void)
+{
+    return 0;
+}
+
+void sc_log_set_deferred(bool enable)
+{
+    (void) enable;
+}
+
+#endif
+
+// Callsites that suppressed a line, pending counts are written on term.
+static struct sc_log_limit *sc_log_limits;
+
+static uint64_t sc_log_now_us(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return (uint64_t) GetTickCount64() * 1000;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+#endif
+}
+
+static uint64_t sc_log_take_suppressed(struct sc_log_limit *l)
+{
+    uint64_t count;
+
+    do {
+        count = sc_log_load(&l->suppressed);
+    } while (count != 0 && !sc_log_cas(&l->suppressed, count, 0));
+
+    return count;
+}
+
+static void sc_log_suppress(struct sc_log_limit *l)
+{
+    struct sc_log_limit *head;
+
+    sc_log_add(&l->suppressed, 1);
+
+    // Link the callsite once, the list only grows, no ABA.
+    if (sc_log_load(&l->listed) == 0 && sc_log_cas(&l->listed, 0, 1)) {
+        do {
+            head = sc_log_load_limit(&sc_log_limits);
+            l->next = head;
+        } while (!sc_log_cas_limit(&sc_log_limits, head, l));
+    }
+}
+
+// Writes pending suppressed counts, called from sc_log_term().
+static void sc_log_flush_limits(void)
+{
+    uint64_t count;
+    const char *file;
+    struct sc_log_limit *l = sc_log_load_limit(&sc_log_limits);
+
+    for (; l != NULL; l = l->next) {
+        count = sc_log_take_suppressed(l);
+        if (count != 0) {
+            file = strrchr(l->file, '/');
+            file = file != NULL ? file + 1 : l->file;
+            sc_log_log(l->level, "(%s:%d) Suppressed %llu messages \n", file,
+                       l->line, (unsigned long long) count);
+        }
+    }
+}
+
+// Token bucket as GCRA, 'tat' is when the bucket is full again. Each line
+// pushes it by '1 / n' seconds, a line is allowed if it stays within one
+// second from now, so bursts of 'n' lines pass.
+bool sc_log_ratelimit(struct sc_log_limit *l, uint32_t n,
+                      unsigned long long *suppressed)
+{
+    uint64_t tat, next, now = sc_log_now_us();
+    const uint64_t interval = 1000000 / (n == 0 ? 1 : n);
+
+    *suppressed = 0;
+
+    do {
+        tat = sc_log_load(&l->tat);
+        next = (tat > now ? tat : now) + interval;
+        if (next > now + 1000000) {
+            sc_log_suppress(l);
+            return false;
+        }
+    } while (!sc_log_cas(&l->tat, tat, next));
+
+    if (sc_log_load(&l->suppressed) != 0) {
+        *suppressed = sc_log_take_suppressed(l);
+    }
+
+    return true;
+}
+
+bool sc_log_sampled(struct sc_log_limit *l, uint32_t n)
+{
+    if (n <= 1) {
+        return true;
+    }
+
+    return sc_log_add(&l->count, 1) % n == 0;
+}
+
+#ifdef SC_LOG_HAVE_SIGNAL
+
+// Copies the line into the crash ring of sc_signal, if it is set. Done on the
+// caller thread, so the ring has the line even if the async writer is behind.
+static void sc_log_ring(enum sc_log_level level, const char *fmt, va_list va)
+{
+    int n, len;
+    va_list args;
+    char buf[SC_SIGNAL_RING_ENTRY];
+
+    if (!sc_signal_ring_enabled()) {
+        return;
+    }
+
+    n = snprintf(buf, sizeof(buf), "[%s][%s] ", sc_log_levels[level].str,
+                 sc_name);
+    if (n < 0 || (size_t) n >= sizeof(buf)) {
+        return;
+    }
+
+    va_copy(args, va);
+    len = vsnprintf(buf + n, sizeof(buf) - (size_t) n, fmt, args);
+    va_end(args);
+
+    if (len < 0) {
+        return;
+    }
+
+    len += n;
+    if ((size_t) len >= sizeof(buf)) {
+        len = (int) sizeof(buf) - 1;
+    }
+
+    sc_signal_ring_add(buf, (size_t) len);
+}
+
+#else
+    #define sc_log_ring(level, fmt, va)
+#endif
+
+// 'check' is false for module logs, module level is checked by the caller.
+static int sc_log_vlog(enum sc_log_level level, bool check, const char *fmt,
+                       va_list va)
+{
+    int rc = 0;
+
+    // Use relaxed atomics to avoid locking cost, e.g DEBUG logs when
+    // level=INFO will get away without any synchronization on most platforms.
+#ifdef SC_ATOMIC
+    if (check && level < sc_atomic_load(&sc_log_min)) {
+        return 0;
+    }
+#endif
+
+#ifdef SC_LOG_HAVE_ASYNC
+    if (sc_log.async != NULL) {
+    #ifndef SC_ATOMIC
+        if (check && level < sc_log_min) {
+            return 0;
+        }
+    #endif
+        sc_log_ring(level, fmt, va);
+        return sc_log_async_push(level, fmt, va);
+    }
+#endif
+
+    sc_log_mutex_lock(&sc_log.mtx);
+
+#ifndef SC_ATOMIC
+    if (check && level < sc_log_min) {
+        sc_log_mutex_unlock(&sc_log.mtx);
+        return 0;
+    }
+#endif
+
+    sc_log_ring(level, fmt, va);
+
+    rc = sc_log_sinks(level, time(NULL), sc_log_mono(), sc_name, fmt, va);
+    sc_log_mutex_unlock(&sc_log.mtx);
+
+    return rc;
+}
+
+#ifdef SC_LOG_HAVE_HIST
+
+void sc_log_set_hist(struct sc_hist *hist)
+{
+    sc_log_hist = hist;
+}
+
+// Records the latency of the calls that pass the level check.
+static int sc_log_vlog_timed(enum sc_log_level level, bool check,
+                             const char *fmt, va_list va)
+{
+    int rc;
+    uint64_t start;
+
+    if (sc_log_hist == NULL) {
+        return sc_log_vlog(level, check, fmt, va);
+    }
+
+    #ifdef SC_ATOMIC
+    if (check && level < sc_atomic_load(&sc_log_min)) {
+        return 0;
+    }
+    #endif
+
+    start = sc_time_mono_ns();
+    rc = sc_log_vlog(level, check, fmt, va);
+    sc_hist_record(sc_log_hist, sc_time_mono_ns() - start);
+
+    return rc;
+}
+
+#else
+    #define sc_log_vlog_timed sc_log_vlog
+#endif
+
+int sc_log_log(enum sc_log_level level, const char *fmt, ...)
+{
+    int rc;
+    va_list va;
+
+    va_start(va, fmt);
+    rc = sc_log_vlog_timed(level, true, fmt, va);
+    va_end(va);
+
+    return rc;
+}
+
+int sc_log_write(enum sc_log_level level, const char *fmt, ...)
+{
+    int rc;
+    va_list va;
+
+    va_start(va, fmt);
+    rc = sc_log_vlog_timed(level, false, fmt, va);
+    va_end(va);
+
+    return rc;
+}
+
+#ifdef SC_LOG_HAVE_BINARY
+int sc_log_kv(enum sc_log_level level, const char *msg,
+              const struct sc_log_field *fields, uint32_t count)
+{
+    int rc;
+    uint32_t len;
+    time_t t;
+    unsigned char rec[SC_LOG_REC_SIZE];
+
+    #ifdef SC_ATOMIC
+    if (level < sc_atomic_load(&sc_log_min)) {
+        return 0;
+    }
+    #endif
+
+    t = time(NULL);
+    len = sc_log_encode(rec, sizeof(rec), level, t, sc_log_mono(), sc_name, msg,
+                        fields, count);
+    if (len == 0) {
+        return -1;
+    }
+
+    #ifdef SC_LOG_HAVE_ASYNC
+    if (sc_log.async != NULL) {
+        #ifndef SC_ATOMIC
+        if (level < sc_log_min) {
+            return 0;
+        }
+        #endif
+        return sc_log_async_push_rec(level, rec, len);
+    }
+    #endif
+
+    sc_log_mutex_lock(&sc_log.mtx);
+
+    #ifndef SC_ATOMIC
+    if (level < sc_log_min) {
+        sc_log_mutex_unlock(&sc_log.mtx);
+        return 0;
+    }
+    #endif
+
+    rc = sc_log_rec_sinks(level, t, sc_name, rec, len);
+    sc_log_mutex_unlock(&sc_log.mtx);
+
+    return rc;
+}
+#endif
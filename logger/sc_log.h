@@ -27,10 +27,34 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Relaxed atomics for the level checks in the log macros.
+#if __STDC_VERSION__ >= 201112 && !defined __STDC_NO_ATOMIC__
+    #define SC_ATOMIC
+    #include <stdatomic.h>
+
+    #define sc_atomic _Atomic
+    #define sc_atomic_store(var, val)                                          \
+        (atomic_store_explicit(var, val, memory_order_relaxed))
+    #define sc_atomic_load(var)                                                \
+        (atomic_load_explicit(var, memory_order_relaxed))
+#elif defined(__GNUC__) || defined(__clang__)
+    #define SC_ATOMIC
+
+    #define sc_atomic
+    #define sc_atomic_store(var, val)                                          \
+        (__atomic_store_n(var, val, __ATOMIC_RELAXED))
+    #define sc_atomic_load(var)       (__atomic_load_n(var, __ATOMIC_RELAXED))
+#else
+    #define sc_atomic
+    #define sc_atomic_store(var, val) ((*(var)) = (val))
+    #define sc_atomic_load(var)       (*(var))
+#endif
+
 enum sc_log_level
 {
     SC_LOG_DEBUG,
@@ -54,12 +78,77 @@ static const struct sc_log_level_pair
 };
 // clang-format on
 
-// Internal function
+// Internal functions
 int sc_log_log(enum sc_log_level level, const char *fmt, ...);
+int sc_log_write(enum sc_log_level level, const char *fmt, ...);
+
+// Internal, current level, use sc_log_set_level() to change it.
+extern sc_atomic enum sc_log_level sc_log_min;
+
+// Level check is a single relaxed load, checked again in sc_log_log().
+#define sc_log_enabled(level) ((level) >= sc_atomic_load(&sc_log_min))
+
+/**
+ * Module with its own level, e.g to enable debug logs of a single component.
+ * Modules follow sc_log_set_level() unless a level is set for the module.
+ *
+ * static struct sc_log_module net = SC_LOG_MODULE_INIT("net");
+ *
+ * sc_log_add_module(&net);
+ * sc_log_set_module_level("net", "DEBUG");
+ * sc_log_mod_debug(&net, "Received %d bytes", n);
+ */
+struct sc_log_module
+{
+    const char *name;
+    sc_atomic enum sc_log_level level;
+    bool custom;
+    struct sc_log_module *next;
+};
 
-// Max file size to rotate, should not be more than 4 GB.
+#define SC_LOG_MODULE_INIT(name) {(name), SC_LOG_INFO, false, NULL}
+
+// Internal, per callsite state of rate limited and sampled log macros.
+struct sc_log_limit
+{
+    const char *file;
+    int line;
+    enum sc_log_level level;
+    uint64_t tat; // Theoretical arrival time of the next line, microseconds
+    uint64_t count;
+    uint64_t suppressed;
+    uint64_t listed;
+    struct sc_log_limit *next;
+};
+
+#define SC_LOG_LIMIT_INIT(level)                                               \
+    {__FILE__, __LINE__, (level), 0, 0, 0, 0, NULL}
+
+// Internal functions
+bool sc_log_ratelimit(struct sc_log_limit *l, uint32_t n,
+                      unsigned long long *suppressed);
+bool sc_log_sampled(struct sc_log_limit *l, uint32_t n);
+
+// Default max file size to rotate, see sc_log_set_rotation().
 #define SC_LOG_FILE_SIZE (2 * 1024 * 1024)
 
+// Max log file path length including generation suffix, e.g "log.txt.3"
+#ifndef SC_LOG_PATH_MAX
+    #define SC_LOG_PATH_MAX 1024
+#endif
+
+// Max line length in async mode, longer lines are truncated.
+#ifndef SC_LOG_ASYNC_LINE
+    #define SC_LOG_ASYNC_LINE 512
+#endif
+
+enum sc_log_overflow
+{
+    SC_LOG_BLOCK, // Wait until writer thread makes room
+    SC_LOG_DROP,  // Drop the record, see sc_log_dropped()
+    SC_LOG_COUNT, // Drop the record, writer logs how many were dropped
+};
+
 // Define SC_LOG_PRINT_FILE_NAME to print file name and line no in the log line.
 #ifdef SC_LOG_PRINT_FILE_NAME
     #define sc_log_ap(fmt, ...)                                                \
@@ -78,18 +167,199 @@ int sc_log_log(enum sc_log_level level, const char *fmt, ...);
 int sc_log_init(void);
 int sc_log_term(void);
 
+/**
+ * Switch to async mode. Log calls copy the line into a lock-free queue and a
+ * writer thread writes them to stdout, file and callback in batches.
+ * Callback receives the formatted line, e.g fmt = "%s".
+ *
+ * Call once after sc_log_init(), before other threads start logging.
+ * sc_log_term() stops the writer after all queued lines are written.
+ * In async mode, log functions return '-1' only if the line is dropped.
+ *
+ * @param cap    queue capacity in lines, rounded up to a power of two
+ * @param policy what to do when the queue is full
+ * @return       '0' on success, negative value on error, errno will be set.
+ */
+int sc_log_set_async(uint32_t cap, enum sc_log_overflow policy);
+
+/**
+ * @return dropped line count in async mode
+ */
+uint64_t sc_log_dropped(void);
+
+/**
+ * Deferred formatting in async mode. Log calls copy the format pointer and
+ * arguments in binary and writer thread formats the line. Format strings must
+ * be string literals, e.g sc_log_info(str) is not allowed. Lines with '*'
+ * width or precision, %n or wide characters are formatted immediately.
+ *
+ * Call after sc_log_set_async(), before other threads start logging.
+ *
+ * @param enable 'true' to enable
+ */
+void sc_log_set_deferred(bool enable);
+
+#ifdef SC_LOG_HAVE_BINARY
+
+/**
+ * Binary records, requires sc_buf and sc_time. Define SC_LOG_HAVE_BINARY for
+ * both sc_log.c and your application.
+ *
+ * Record layout, integers are little endian, strings are sc_buf strings :
+ *
+ * [4 bytes len][1 byte level][8 bytes sc_time_mono_ns()][8 bytes unix time]
+ * [str thread name][str message][1 byte field count]
+ * Each field : [str key][1 byte enum sc_log_type][value]
+ *
+ * Value is 8 bytes for integers and double, sc_buf string for strings.
+ * 'len' excludes itself.
+ */
+
+// Max encoded record size, larger records are dropped.
+    #ifndef SC_LOG_REC_SIZE
+        #define SC_LOG_REC_SIZE 1024
+    #endif
+
+enum sc_log_format
+{
+    SC_LOG_TEXT,
+    SC_LOG_BINARY,
+};
+
+enum sc_log_type
+{
+    SC_LOG_TYPE_INT,
+    SC_LOG_TYPE_UINT,
+    SC_LOG_TYPE_DOUBLE,
+    SC_LOG_TYPE_STR,
+};
+
+struct sc_log_field
+{
+    const char *key;
+    enum sc_log_type type;
+    union
+    {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const char *s;
+    } val;
+};
+
+    #define sc_log_int(k, v)                                                   \
+        ((struct sc_log_field){(k), SC_LOG_TYPE_INT, {.i = (v)}})
+    #define sc_log_uint(k, v)                                                  \
+        ((struct sc_log_field){(k), SC_LOG_TYPE_UINT, {.u = (v)}})
+    #define sc_log_double(k, v)                                                \
+        ((struct sc_log_field){(k), SC_LOG_TYPE_DOUBLE, {.d = (v)}})
+    #define sc_log_str(k, v)                                                   \
+        ((struct sc_log_field){(k), SC_LOG_TYPE_STR, {.s = (v)}})
+
+/**
+ * File output format, default is SC_LOG_TEXT. In SC_LOG_BINARY format, all
+ * lines are written to the file as records, text lines are records without
+ * fields. stdout and callback still get the text line.
+ * Call before sc_log_set_file().
+ *
+ * @param format format
+ */
+void sc_log_set_format(enum sc_log_format format);
+
+/**
+ * Callback receives each record in binary, e.g to ship logs without parsing.
+ *
+ * @param arg user arg to callback
+ * @param cb  record callback, 'NULL' to disable
+ */
+void sc_log_set_record_callback(void *arg, int (*cb)(void *arg, const void *rec,
+                                                     uint32_t len));
+
+/**
+ * Log a message with key/value fields. Text output is "msg key=value ...".
+ * Prefer the macros below.
+ *
+ * @param level  level
+ * @param msg    message
+ * @param fields fields
+ * @param count  field count, at most 255
+ * @return       '0' on success, '-1' on error or if the record is too large,
+ *               records are limited to SC_LOG_ASYNC_LINE in async mode.
+ */
+int sc_log_kv(enum sc_log_level level, const char *msg,
+              const struct sc_log_field *fields, uint32_t count);
+
+    // e.g : sc_log_info_kv("done", sc_log_str("path", p), sc_log_int("ms", t));
+    #define sc_log_fields_(...)                                                \
+        (struct sc_log_field[]){__VA_ARGS__},                                  \
+            sizeof((struct sc_log_field[]){__VA_ARGS__}) /                     \
+                sizeof(struct sc_log_field)
+
+    #define sc_log_kv_(level, msg, ...)                                        \
+        (sc_log_enabled(level) ?                                               \
+                 sc_log_kv(level, msg, sc_log_fields_(__VA_ARGS__)) :          \
+                 0)
+
+    #define sc_log_debug_kv(msg, ...) sc_log_kv_(SC_LOG_DEBUG, msg, __VA_ARGS__)
+    #define sc_log_info_kv(msg, ...)  sc_log_kv_(SC_LOG_INFO, msg, __VA_ARGS__)
+    #define sc_log_warn_kv(msg, ...)  sc_log_kv_(SC_LOG_WARN, msg, __VA_ARGS__)
+    #define sc_log_error_kv(msg, ...) sc_log_kv_(SC_LOG_ERROR, msg, __VA_ARGS__)
+
+#endif
+
 /**
  * Call once from each thread if you want to set thread name.
  * @param name  Thread name
  */
 void sc_log_set_thread_name(const char *name);
 
+#ifdef SC_LOG_HAVE_HIST
+    #include "sc_hist.h"
+
+/**
+ * Record latency of log calls of this thread into 'hist' in nanoseconds,
+ * requires sc_hist and sc_time. Define SC_LOG_HAVE_HIST for both sc_log.c and
+ * your application. Calls filtered by level are not recorded. With
+ * sc_log_set_async(), it is the cost of queueing the line.
+ *
+ * 'hist' is written by this thread only, read it from other threads with
+ * sc_hist_merge().
+ *
+ * @param hist histogram, NULL to disable.
+ */
+void sc_log_set_hist(struct sc_hist *hist);
+#endif
+
+/**
+ * If SC_LOG_HAVE_SIGNAL is defined for sc_log.c, log lines that pass the level
+ * check are also copied into the crash ring of sc_signal when it is set, see
+ * sc_signal_ring_init(). Lines are truncated to SC_SIGNAL_RING_ENTRY, requires
+ * sc_signal.
+ */
+
 /**
  * @param level_str  One of "DEBUG", "INFO", "WARN", "ERROR", "OFF"
  * @return           '0' on success, negative value on invalid level string
  */
 int sc_log_set_level(const char *level_str);
 
+/**
+ * Register a module, call after sc_log_init(). Module must stay valid until
+ * sc_log_term().
+ *
+ * @param m module
+ */
+void sc_log_add_module(struct sc_log_module *m);
+
+/**
+ * @param name      module name
+ * @param level_str One of "DEBUG", "INFO", "WARN", "ERROR", "OFF", or 'NULL' to
+ *                  follow sc_log_set_level() again.
+ * @return          '0' on success, negative value on invalid level string or
+ *                  unknown module
+ */
+int sc_log_set_module_level(const char *name, const char *level_str);
+
 /**
  * @param enable 'true' to enable, 'false' to disable logging to stdout.
  */
@@ -106,6 +376,22 @@ void sc_log_set_stdout(bool enable);
  */
 int sc_log_set_file(const char *prev_file, const char *current_file);
 
+/**
+ * Rotation settings, can be called any time. Defaults are SC_LOG_FILE_SIZE, one
+ * previous file and no time based rotation. Generations after the first one
+ * are named 'prev_file' + ".1", ".2" ... and the oldest one is removed.
+ * e.g sc_log_set_rotation(64 * 1024 * 1024, 5, 24 * 60 * 60);
+ *
+ * In async mode, writer thread rotates the file, log calls never touch the
+ * filesystem.
+ *
+ * @param size     rotate when file size exceeds 'size' bytes, '0' to disable
+ * @param count    previous files to keep, '0' truncates the current file
+ * @param interval rotate every 'interval' seconds, intervals are aligned to
+ *                 epoch (UTC), e.g 3600 rotates on the hour, '0' to disable
+ */
+void sc_log_set_rotation(size_t size, uint32_t count, uint32_t interval);
+
 /**
  * @param arg user arg to callback.
  * @param cb  log callback.
@@ -114,10 +400,77 @@ void sc_log_set_callback(void *arg,
                          int (*cb)(void *arg, enum sc_log_level level,
                                    const char *fmt, va_list va));
 
+// Disabled levels cost a load and a branch, arguments are not evaluated.
+#define sc_log_level_(level, ...)                                              \
+    (sc_log_enabled(level) ? sc_log_log(level, sc_log_ap(__VA_ARGS__, "")) : 0)
+
 // e.g : sc_log_error("Errno : %d, reason : %s", errno, strerror(errno));
-#define sc_log_debug(...) (sc_log_log(SC_LOG_DEBUG, sc_log_ap(__VA_ARGS__, "")))
-#define sc_log_info(...)  (sc_log_log(SC_LOG_INFO, sc_log_ap(__VA_ARGS__, "")))
-#define sc_log_warn(...)  (sc_log_log(SC_LOG_WARN, sc_log_ap(__VA_ARGS__, "")))
-#define sc_log_error(...) (sc_log_log(SC_LOG_ERROR, sc_log_ap(__VA_ARGS__, "")))
+#define sc_log_debug(...) sc_log_level_(SC_LOG_DEBUG, __VA_ARGS__)
+#define sc_log_info(...)  sc_log_level_(SC_LOG_INFO, __VA_ARGS__)
+#define sc_log_warn(...)  sc_log_level_(SC_LOG_WARN, __VA_ARGS__)
+#define sc_log_error(...) sc_log_level_(SC_LOG_ERROR, __VA_ARGS__)
+
+// Module log macros, e.g : sc_log_mod_info(&net, "Connected to %s", addr);
+#define sc_log_mod_(m, lvl, ...)                                               \
+    ((lvl) >= sc_atomic_load(&(m)->level) ?                                    \
+             sc_log_write(lvl, sc_log_ap(__VA_ARGS__, "")) :                   \
+             0)
+
+#define sc_log_mod_debug(m, ...) sc_log_mod_(m, SC_LOG_DEBUG, __VA_ARGS__)
+#define sc_log_mod_info(m, ...)  sc_log_mod_(m, SC_LOG_INFO, __VA_ARGS__)
+#define sc_log_mod_warn(m, ...)  sc_log_mod_(m, SC_LOG_WARN, __VA_ARGS__)
+#define sc_log_mod_error(m, ...) sc_log_mod_(m, SC_LOG_ERROR, __VA_ARGS__)
+
+/**
+ * Rate limited log macros, token bucket per callsite. Bucket holds 'n' tokens
+ * and it is refilled continuously at 'n' tokens per second, so a callsite
+ * writes a burst of 'n' lines, then one line every '1 / n' seconds. Lock-free,
+ * suppressed calls only update the counters of the callsite.
+ *
+ * Suppressed line count is written before the next line from the same
+ * callsite, e.g "Suppressed 1500 messages". Counts that are still pending are
+ * written by sc_log_term().
+ *
+ * e.g : sc_log_error_limit(10, "Connection failed : %s", strerror(errno));
+ */
+#define sc_log_limit_(level, n, ...)                                           \
+    do {                                                                       \
+        static struct sc_log_limit sc_log_lim_ = SC_LOG_LIMIT_INIT(level);     \
+        unsigned long long sc_log_sup_;                                        \
+                                                                               \
+        if (sc_log_enabled(level) &&                                           \
+            sc_log_ratelimit(&sc_log_lim_, (n), &sc_log_sup_)) {               \
+            if (sc_log_sup_ != 0) {                                            \
+                sc_log_log(level, sc_log_ap("Suppressed %llu messages \n",     \
+                                            sc_log_sup_));                     \
+            }                                                                  \
+            sc_log_log(level, sc_log_ap(__VA_ARGS__, ""));                     \
+        }                                                                      \
+    } while (0)
+
+#define sc_log_debug_limit(n, ...) sc_log_limit_(SC_LOG_DEBUG, n, __VA_ARGS__)
+#define sc_log_info_limit(n, ...)  sc_log_limit_(SC_LOG_INFO, n, __VA_ARGS__)
+#define sc_log_warn_limit(n, ...)  sc_log_limit_(SC_LOG_WARN, n, __VA_ARGS__)
+#define sc_log_error_limit(n, ...) sc_log_limit_(SC_LOG_ERROR, n, __VA_ARGS__)
+
+/**
+ * Sampled log macros, each callsite writes one of every 'n' lines, starting
+ * with the first one.
+ *
+ * e.g : sc_log_debug_sample(100, "Received packet, len : %d", len);
+ */
+#define sc_log_sample_(level, n, ...)                                          \
+    do {                                                                       \
+        static struct sc_log_limit sc_log_lim_ = SC_LOG_LIMIT_INIT(level);     \
+                                                                               \
+        if (sc_log_enabled(level) && sc_log_sampled(&sc_log_lim_, (n))) {      \
+            sc_log_log(level, sc_log_ap(__VA_ARGS__, ""));                     \
+        }                                                                      \
+    } while (0)
+
+#define sc_log_debug_sample(n, ...) sc_log_sample_(SC_LOG_DEBUG, n, __VA_ARGS__)
+#define sc_log_info_sample(n, ...)  sc_log_sample_(SC_LOG_INFO, n, __VA_ARGS__)
+#define sc_log_warn_sample(n, ...)  sc_log_sample_(SC_LOG_WARN, n, __VA_ARGS__)
+#define sc_log_error_sample(n, ...) sc_log_sample_(SC_LOG_ERROR, n, __VA_ARGS__)
 
 #endif
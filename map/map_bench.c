@@ -0,0 +1,317 @@
+#ifndef _XOPEN_SOURCE
+    #define _XOPEN_SOURCE 700
+#endif
+
+#include "sc_map.h"
+
+#ifdef SC_MAP_BENCH_PERF
+    #include "sc_perf.h"
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Map benchmark, sweeps table size, load factor and key distribution and
+ * prints ns/op of put, get (hit), get (miss) and del.
+ *
+ * Table sizes go from L1 to 4x the last level cache. Tables are filled up to
+ * the load factor exactly, so the load factor is the measured occupancy.
+ *
+ * ./sc_map_bench        : ns/op only
+ * ./sc_map_bench -p     : also prints cache-miss/instruction counters for each
+ *                         case, requires perf_event_open() permission.
+ * ./sc_map_bench -q     : quick run, smaller tables, for smoke testing.
+ */
+
+#define BENCH_OPS  (2 * 1000 * 1000)
+#define BENCH_ZIPF 0.99
+
+enum dist
+{
+    DIST_SEQUENTIAL,
+    DIST_UNIFORM,
+    DIST_ZIPFIAN,
+};
+
+static const char *dist_str[] = {"sequential", "uniform", "zipfian"};
+static const uint32_t load_factors[] = {25, 50, 75, 95};
+
+static bool perf;
+static uint64_t checksum;
+
+static uint64_t time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t rand_next(uint64_t *s)
+{
+    uint64_t x = *s;
+
+    x ^= x << 13u;
+    x ^= x >> 7u;
+    x ^= x << 17u;
+    *s = x;
+
+    return x;
+}
+
+static double rand_double(uint64_t *s)
+{
+    return (double) (rand_next(s) >> 11u) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Zipfian index generator, "Quickly Generating Billion-Record Synthetic
+ * Databases", Gray et al.
+ */
+struct zipf
+{
+    uint64_t n;
+    double theta;
+    double alpha;
+    double zetan;
+    double eta;
+};
+
+static void zipf_init(struct zipf *z, uint64_t n, double theta)
+{
+    double zeta2 = 1.0 + pow(0.5, theta);
+
+    z->n = n;
+    z->theta = theta;
+    z->zetan = 0;
+
+    for (uint64_t i = 1; i <= n; i++) {
+        z->zetan += 1.0 / pow((double) i, theta);
+    }
+
+    z->alpha = 1.0 / (1.0 - theta);
+    z->eta = (1 - pow(2.0 / (double) n, 1 - theta)) / (1 - zeta2 / z->zetan);
+}
+
+static uint64_t zipf_next(struct zipf *z, uint64_t *s)
+{
+    double u = rand_double(s);
+    double uz = u * z->zetan;
+    uint64_t v;
+
+    if (uz < 1.0) {
+        return 0;
+    }
+
+    if (uz < 1.0 + pow(0.5, z->theta)) {
+        return 1;
+    }
+
+    v = (uint64_t) ((double) z->n * pow(z->eta * u - z->eta + 1, z->alpha));
+    return v < z->n ? v : z->n - 1;
+}
+
+static size_t llc_size(void)
+{
+    long size = -1;
+
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (size <= 0) {
+        size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    }
+#endif
+
+    return size > 0 ? (size_t) size : 8 * 1024 * 1024;
+}
+
+static void bench_begin(void)
+{
+#ifdef SC_MAP_BENCH_PERF
+    if (perf) {
+        sc_perf_start();
+    }
+#endif
+}
+
+static void bench_end(const char *op, uint32_t cap, uint32_t lf,
+                      enum dist dist, uint64_t start, uint64_t ops)
+{
+    double ns = (double) (time_ns() - start) / (double) ops;
+
+    printf("| %-10u | %-4u | %-10s | %-8s | %8.2f |\n", cap, lf,
+           dist_str[dist], op, ns);
+
+#ifdef SC_MAP_BENCH_PERF
+    if (perf) {
+        sc_perf_end();
+    }
+#endif
+}
+
+/*
+ * Generates lookup order, indexes into 'keys' following the distribution.
+ */
+static void bench_order(uint32_t *order, uint32_t n, enum dist dist,
+                        struct zipf *z)
+{
+    uint64_t s = 0x9e3779b97f4a7c15ull;
+
+    for (uint32_t i = 0; i < BENCH_OPS; i++) {
+        switch (dist) {
+        case DIST_SEQUENTIAL:
+            order[i] = i % n;
+            break;
+        case DIST_UNIFORM:
+            order[i] = (uint32_t) (rand_next(&s) % n);
+            break;
+        case DIST_ZIPFIAN:
+            order[i] = (uint32_t) zipf_next(z, &s);
+            break;
+        }
+    }
+}
+
+static void bench_case(uint32_t cap, uint32_t lf, enum dist dist,
+                       uint64_t *keys, uint64_t *misses, uint32_t *order,
+                       struct zipf *z)
+{
+    uint64_t start, val;
+    uint32_t n = (uint32_t) (cap * ((double) lf / 100));
+    struct sc_map_64 map;
+
+    if (!sc_map_init_64(&map, cap, lf) || !sc_map_reserve_64(&map, n)) {
+        fprintf(stderr, "Out of memory \n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (map.cap != cap) {
+        sc_map_term_64(&map);
+        return;
+    }
+
+    bench_order(order, n, dist, z);
+
+    bench_begin();
+    start = time_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        sc_map_put_64(&map, keys[i], i);
+    }
+    bench_end("put", cap, lf, dist, start, n);
+
+    bench_begin();
+    start = time_ns();
+    for (uint32_t i = 0; i < BENCH_OPS; i++) {
+        sc_map_get_64(&map, keys[order[i]], &val);
+        checksum += val;
+    }
+    bench_end("get", cap, lf, dist, start, BENCH_OPS);
+
+    bench_begin();
+    start = time_ns();
+    for (uint32_t i = 0; i < BENCH_OPS; i++) {
+        checksum += sc_map_get_64(&map, misses[order[i]], &val);
+    }
+    bench_end("miss", cap, lf, dist, start, BENCH_OPS);
+
+    bench_begin();
+    start = time_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        checksum += sc_map_del_64(&map, keys[i], NULL);
+    }
+    bench_end("del", cap, lf, dist, start, n);
+
+    sc_map_term_64(&map);
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t s = 0x2545f4914f6cdd1dull;
+    size_t l1 = 32 * 1024, max;
+    uint32_t cap_min, cap_max, n_max;
+    uint64_t *keys, *misses;
+    uint32_t *order;
+    struct zipf z;
+    const size_t item = sizeof(struct sc_map_item_64);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0) {
+#ifdef SC_MAP_BENCH_PERF
+            perf = true;
+#else
+            fprintf(stderr, "Perf counters are not supported \n");
+            return EXIT_FAILURE;
+#endif
+        } else if (strcmp(argv[i], "-q") == 0) {
+            l1 = 4 * 1024;
+        } else {
+            fprintf(stderr, "Usage : %s [-p] [-q] \n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    max = l1 == 32 * 1024 ? llc_size() * 4 : 64 * 1024;
+
+    cap_min = 1;
+    while (cap_min * item < l1) {
+        cap_min *= 2;
+    }
+
+    cap_max = cap_min;
+    while ((size_t) cap_max * 2 * item <= max &&
+           cap_max < SC_MAP_SIZE_MAX / 2) {
+        cap_max *= 2;
+    }
+
+    n_max = (uint32_t) (cap_max * 0.95) + 1;
+
+    keys = malloc(sizeof(*keys) * n_max);
+    misses = malloc(sizeof(*misses) * n_max);
+    order = malloc(sizeof(*order) * BENCH_OPS);
+    if (keys == NULL || misses == NULL || order == NULL) {
+        fprintf(stderr, "Out of memory \n");
+        return EXIT_FAILURE;
+    }
+
+    printf("| %-10s | %-4s | %-10s | %-8s | %8s |\n", "cap", "load", "dist",
+           "op", "ns/op");
+    printf("-----------------------------------------------------\n");
+
+    for (uint64_t c = cap_min; c <= cap_max; c *= 4) {
+        uint32_t cap = (uint32_t) c;
+
+        for (size_t lf = 0; lf < sizeof(load_factors) / sizeof(*load_factors);
+             lf++) {
+            uint32_t n = (uint32_t) (cap * ((double) load_factors[lf] / 100));
+
+            zipf_init(&z, n, BENCH_ZIPF);
+
+            for (int d = DIST_SEQUENTIAL; d <= DIST_ZIPFIAN; d++) {
+                for (uint32_t i = 0; i < n; i++) {
+                    if (d == DIST_SEQUENTIAL) {
+                        keys[i] = i + 1;
+                        misses[i] = n + i + 1;
+                    } else {
+                        keys[i] = (rand_next(&s) | 1u);
+                        misses[i] = (rand_next(&s) & ~(uint64_t) 1u) | 2u;
+                    }
+                }
+
+                bench_case(cap, load_factors[lf], d, keys, misses, order, &z);
+            }
+        }
+    }
+
+    printf("checksum : %llu \n", (unsigned long long) checksum);
+
+    free(keys);
+    free(misses);
+    free(order);
+
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "sc_map.h"
 
 #include <assert.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -980,6 +981,995 @@ static void test6()
     free(values);
 }
 
+static bool icase_cmp(const char *a, const char *b)
+{
+    while (*a && tolower((unsigned char) *a) == tolower((unsigned char) *b)) {
+        a++;
+        b++;
+    }
+
+    return tolower((unsigned char) *a) == tolower((unsigned char) *b);
+}
+
+static uint32_t icase_hash(const char *key)
+{
+    char tmp[64];
+    size_t len = strlen(key);
+
+    assert(len < sizeof(tmp));
+    for (size_t i = 0; i < len; i++) {
+        tmp[i] = (char) tolower((unsigned char) key[i]);
+    }
+
+    return sc_map_murmurhash(tmp, len, 0);
+}
+
+static uint32_t const_hash(uint32_t key)
+{
+    (void) key;
+    return 7;
+}
+
+sc_map_of_strkey(icase, const char *, int)
+sc_map_impl_of_strkey(icase, const char *, int, icase_cmp, icase_hash)
+sc_map_of_scalar(collide, uint32_t, uint32_t)
+sc_map_impl_of_scalar(collide, uint32_t, uint32_t, sc_map_varcmp, const_hash)
+
+static void test_custom()
+{
+    int val;
+    uint32_t v;
+    struct sc_map_icase map;
+    struct sc_map_collide cmap;
+
+    assert(sc_map_init_icase(&map, 0, 0));
+    assert(sc_map_put_icase(&map, "Content-Length", 1));
+    assert(sc_map_put_icase(&map, "HOST", 2));
+    assert(sc_map_get_icase(&map, "content-length", &val));
+    assert(val == 1);
+    assert(sc_map_get_icase(&map, "host", &val));
+    assert(val == 2);
+    assert(sc_map_put_icase(&map, "Host", 3));
+    assert(sc_map_size_icase(&map) == 2);
+    assert(sc_map_del_icase(&map, "hOST", &val));
+    assert(val == 3);
+    assert(!sc_map_get_icase(&map, "host", &val));
+    sc_map_term_icase(&map);
+
+    assert(sc_map_init_collide(&cmap, 0, 0));
+    for (uint32_t i = 1; i < 500; i++) {
+        assert(sc_map_put_collide(&cmap, i, i));
+    }
+    for (uint32_t i = 1; i < 500; i += 2) {
+        assert(sc_map_del_collide(&cmap, i, &v));
+        assert(v == i);
+    }
+    for (uint32_t i = 1; i < 500; i++) {
+        assert(sc_map_get_collide(&cmap, i, &v) == (i % 2 == 0));
+        assert(i % 2 == 1 || v == i);
+    }
+    sc_map_term_collide(&cmap);
+}
+
+static void test_hash()
+{
+    const char *value;
+    struct sc_map_str map;
+
+    /* Default seed keeps the hash of murmurhash64a with zero seed */
+    assert(sc_map_hash_str("key") == sc_map_murmurhash("key", 3, 0));
+    assert(sc_map_murmurhash("key", 3, 0) != sc_map_murmurhash("key", 3, 1));
+    assert(sc_map_murmurhash("", 0, 0) == sc_map_murmurhash("", 0, 0));
+
+    /* Integer hashes must spread stride aligned keys */
+    uint32_t low = 0;
+    for (uint32_t i = 0; i < 64; i++) {
+        low |= 1u << (sc_map_hash_32(i * 4096) & 31u);
+        assert(sc_map_hash_64((uint64_t) i << 32u) !=
+               sc_map_hash_64((uint64_t) (i + 1) << 32u));
+    }
+    assert(low != 1u);
+
+    sc_map_set_seed(0x9e3779b97f4a7c15);
+    assert(sc_map_hash_str("key") == sc_map_murmurhash("key", 3, 0x9e3779b97f4a7c15));
+
+    assert(sc_map_init_str(&map, 0, 0));
+    assert(sc_map_put_str(&map, "key", "value"));
+    assert(sc_map_get_str(&map, "key", &value));
+    assert(strcmp(value, "value") == 0);
+    sc_map_term_str(&map);
+
+    sc_map_set_seed(0);
+}
+
+static void test_lenkey()
+{
+    const char *buf = "/api/v1/users/api/v1/users/42";
+    const char *key, *value;
+    void *v;
+    uint64_t u;
+    char *keys[300];
+    struct sc_map_lstr map;
+    struct sc_map_lsv msv;
+    struct sc_map_ls64 m64;
+
+    assert(sc_map_init_lstr(&map, 0, 0));
+    assert(!sc_map_init_lstr(&map, 0, 1));
+    assert(sc_map_init_lstr(&map, 0, 0));
+    assert(!sc_map_get_lstr(&map, "a", 1, &value));
+    assert(!sc_map_get_lstr(&map, NULL, 0, &value));
+    assert(!sc_map_del_lstr(&map, "a", 1, &value));
+
+    /* Slices of a buffer, not null terminated */
+    assert(sc_map_put_lstr(&map, buf, 13, "users"));
+    assert(sc_map_put_lstr(&map, buf, 4, "api"));
+    assert(sc_map_put_lstr(&map, &buf[13], 13, "users2"));
+    assert(sc_map_size_lstr(&map) == 2);
+    assert(sc_map_get_lstr(&map, "/api/v1/users", 13, &value));
+    assert(strcmp(value, "users2") == 0);
+    assert(sc_map_get_lstr(&map, "/api", 4, &value));
+    assert(strcmp(value, "api") == 0);
+    assert(!sc_map_get_lstr(&map, "/ap", 3, &value));
+    assert(!sc_map_get_lstr(&map, "/api/", 5, &value));
+    assert(sc_map_put_lstr(&map, "", 0, "empty"));
+    assert(sc_map_get_lstr(&map, "x", 0, &value));
+    assert(strcmp(value, "empty") == 0);
+    assert(sc_map_put_lstr(&map, NULL, 0, "null"));
+    assert(sc_map_get_lstr(&map, NULL, 0, &value));
+    assert(strcmp(value, "null") == 0);
+    assert(sc_map_size_lstr(&map) == 4);
+
+    int n = 0;
+    sc_map_foreach (&map, key, value) {
+        n++;
+    }
+    assert(n == 4);
+
+    assert(sc_map_del_lstr(&map, NULL, 0, &value));
+    assert(sc_map_del_lstr(&map, "/api", 4, &value));
+    assert(strcmp(value, "api") == 0);
+    assert(sc_map_size_lstr(&map) == 2);
+    sc_map_clear_lstr(&map);
+    assert(sc_map_size_lstr(&map) == 0);
+    sc_map_term_lstr(&map);
+
+    for (int i = 0; i < 300; i++) {
+        keys[i] = str_random((rand() % 80) + 40);
+    }
+
+    assert(sc_map_init_lsv(&msv, 0, 0));
+    assert(sc_map_init_ls64(&m64, 0, 0));
+
+    for (int i = 0; i < 300; i++) {
+        uint32_t len = (uint32_t) strlen(keys[i]);
+        assert(sc_map_put_lsv(&msv, keys[i], len, keys[i]));
+        assert(sc_map_put_ls64(&m64, keys[i], len, (uint64_t) i));
+    }
+
+    for (int i = 0; i < 300; i++) {
+        uint32_t len = (uint32_t) strlen(keys[i]);
+        assert(sc_map_get_lsv(&msv, keys[i], len, &v));
+        assert(v == keys[i]);
+        assert(!sc_map_get_lsv(&msv, keys[i], len - 1, &v));
+        assert(sc_map_get_ls64(&m64, keys[i], len, &u));
+        assert(u == (uint64_t) i);
+    }
+
+    for (int i = 0; i < 300; i += 3) {
+        uint32_t len = (uint32_t) strlen(keys[i]);
+        assert(sc_map_del_ls64(&m64, keys[i], len, &u));
+        assert(u == (uint64_t) i);
+    }
+
+    for (int i = 0; i < 300; i++) {
+        uint32_t len = (uint32_t) strlen(keys[i]);
+        assert(sc_map_get_ls64(&m64, keys[i], len, &u) == (i % 3 != 0));
+    }
+
+    assert(sc_map_size_lsv(&msv) == 300);
+    assert(sc_map_size_ls64(&m64) == 200);
+
+    sc_map_term_lsv(&msv);
+    sc_map_term_ls64(&m64);
+
+    for (int i = 0; i < 300; i++) {
+        free(keys[i]);
+    }
+}
+
+static void test_batch()
+{
+    uint32_t keys[100], values[100];
+    bool found[100];
+    const char *skeys[4] = {"a", NULL, "b", "c"};
+    const char *svalues[4];
+    struct sc_map_32 map;
+    struct sc_map_str smap;
+
+    assert(sc_map_init_32(&map, 0, 0));
+    assert(sc_map_get_batch_32(&map, keys, values, found, 0) == 0);
+
+    for (uint32_t i = 0; i < 100; i++) {
+        keys[i] = i * 2;
+    }
+
+    assert(sc_map_get_batch_32(&map, keys, values, found, 100) == 0);
+    for (uint32_t i = 0; i < 100; i++) {
+        assert(!found[i]);
+    }
+
+    for (uint32_t i = 0; i < 100; i++) {
+        assert(sc_map_put_32(&map, i * 4, i));
+    }
+
+    assert(sc_map_get_batch_32(&map, keys, values, found, 100) == 50);
+    for (uint32_t i = 0; i < 100; i++) {
+        assert(found[i] == (i % 2 == 0));
+        assert(!found[i] || values[i] == i / 2);
+    }
+
+    assert(sc_map_get_batch_32(&map, &keys[1], values, found, 17) == 8);
+    sc_map_term_32(&map);
+
+    assert(sc_map_init_str(&smap, 0, 0));
+    assert(sc_map_put_str(&smap, "a", "1"));
+    assert(sc_map_put_str(&smap, "c", "3"));
+    assert(sc_map_get_batch_str(&smap, skeys, svalues, found, 4) == 2);
+    assert(found[0] && strcmp(svalues[0], "1") == 0);
+    assert(!found[1]);
+    assert(!found[2]);
+    assert(found[3] && strcmp(svalues[3], "3") == 0);
+
+    assert(sc_map_put_str(&smap, NULL, "0"));
+    assert(sc_map_get_batch_str(&smap, skeys, svalues, found, 4) == 3);
+    assert(found[1] && strcmp(svalues[1], "0") == 0);
+    sc_map_term_str(&smap);
+}
+
+static void test_incremental()
+{
+    const int count = 200000;
+    uint64_t key, val, v2;
+    bool b1, b2, migrating = false;
+    struct sc_map_64 ref;
+    struct sc_map_64 map;
+
+    assert(sc_map_init_64(&ref, 0, 0));
+    assert(sc_map_init_64(&map, 0, 0));
+    sc_map_set_incremental_64(&map, true);
+
+    for (int i = 0; i < count; i++) {
+        key = (uint64_t) rand() % 50000;
+        val = (uint64_t) rand();
+
+        switch (rand() % 4) {
+        case 0:
+        case 1:
+            assert(sc_map_put_64(&ref, key, val));
+            assert(sc_map_put_64(&map, key, val));
+            break;
+        case 2:
+            b1 = sc_map_get_64(&ref, key, &val);
+            b2 = sc_map_get_64(&map, key, &v2);
+            assert(b1 == b2);
+            assert(!b1 || val == v2);
+            break;
+        default:
+            b1 = sc_map_del_64(&ref, key, &val);
+            b2 = sc_map_del_64(&map, key, &v2);
+            assert(b1 == b2);
+            assert(!b1 || val == v2);
+            break;
+        }
+
+        assert(sc_map_size_64(&ref) == sc_map_size_64(&map));
+
+        if (map.old != NULL) {
+            migrating = true;
+        }
+
+        if (map.old != NULL && i % 97 == 0) {
+            uint32_t n = 0;
+            sc_map_foreach (&map, key, val) {
+                assert(sc_map_get_64(&ref, key, &v2));
+                assert(val == v2);
+                n++;
+            }
+            assert(n == sc_map_size_64(&map));
+        }
+    }
+
+    assert(migrating);
+
+    sc_map_set_incremental_64(&map, false);
+    assert(map.old == NULL);
+
+    sc_map_foreach (&ref, key, val) {
+        assert(sc_map_get_64(&map, key, &v2));
+        assert(val == v2);
+    }
+
+    sc_map_term_64(&ref);
+    sc_map_term_64(&map);
+
+    /* Clear and term while migration is in progress */
+    const char *value;
+    char *keys[512];
+    struct sc_map_str smap;
+
+    for (int i = 0; i < 512; i++) {
+        keys[i] = str_random((rand() % 64) + 32);
+    }
+
+    assert(sc_map_init_str(&smap, 0, 0));
+    sc_map_set_incremental_str(&smap, true);
+    assert(sc_map_put_str(&smap, NULL, "null"));
+
+    for (int i = 0; i < 512; i++) {
+        assert(sc_map_put_str(&smap, keys[i], keys[i]));
+        if (smap.old != NULL) {
+            for (int j = 0; j <= i; j++) {
+                assert(sc_map_get_str(&smap, keys[j], &value));
+                assert(value == keys[j]);
+            }
+        }
+    }
+
+    assert(sc_map_get_str(&smap, NULL, &value));
+    assert(strcmp(value, "null") == 0);
+
+    sc_map_clear_str(&smap);
+    assert(sc_map_size_str(&smap) == 0);
+    assert(smap.old == NULL);
+
+    for (int i = 0; i < 512; i++) {
+        assert(sc_map_put_str(&smap, keys[i], keys[i]));
+    }
+    for (int i = 0; i < 512; i += 2) {
+        assert(sc_map_del_str(&smap, keys[i], &value));
+        assert(value == keys[i]);
+    }
+    assert(sc_map_size_str(&smap) == 256);
+    sc_map_term_str(&smap);
+
+    for (int i = 0; i < 512; i++) {
+        free(keys[i]);
+    }
+}
+
+struct arena
+{
+    char *mem;
+    size_t len;
+    size_t used;
+    int allocs;
+    int releases;
+};
+
+static void *arena_alloc(void *arg, size_t size)
+{
+    void *p;
+    struct arena *a = arg;
+
+    if (a->len - a->used < size) {
+        return NULL;
+    }
+
+    p = a->mem + a->used;
+    memset(p, 0, size);
+    a->used += (size + 15) & ~(size_t) 15;
+    a->allocs++;
+
+    return p;
+}
+
+static void arena_release(void *arg, void *ptr, size_t size)
+{
+    struct arena *a = arg;
+
+    (void) ptr;
+    (void) size;
+    a->releases++;
+}
+
+static void test_reserve()
+{
+    uint32_t cap;
+    uint64_t val;
+    const char *s;
+    struct sc_map_64 map;
+    struct sc_map_str smap;
+    const char *str_keys[] = {"a", "b", "c", "d", "e", "f"};
+
+    /* Reserve once, no remap while populating */
+    assert(sc_map_init_64(&map, 0, 0));
+    assert(sc_map_reserve_64(&map, 10000));
+    cap = map.cap;
+    assert(cap == 16384);
+    assert(sc_map_reserve_64(&map, 100));
+    assert(map.cap == cap);
+
+    for (uint64_t i = 0; i < 10000; i++) {
+        assert(sc_map_put_64(&map, i, i));
+        assert(map.cap == cap);
+    }
+    assert(!sc_map_reserve_64(&map, UINT32_MAX));
+    assert(map.cap == cap);
+
+    /* Shrink after deletes keeps content, zero key included */
+    for (uint64_t i = 100; i < 10000; i++) {
+        assert(sc_map_del_64(&map, i, NULL));
+    }
+    assert(sc_map_shrink_64(&map));
+    assert(map.cap == 256);
+    assert(sc_map_size_64(&map) == 100);
+    for (uint64_t i = 0; i < 100; i++) {
+        assert(sc_map_get_64(&map, i, &val));
+        assert(val == i);
+    }
+    assert(sc_map_shrink_64(&map));
+    assert(map.cap == 256);
+
+    /* Empty map releases its table */
+    sc_map_clear_64(&map);
+    assert(sc_map_shrink_64(&map));
+    assert(map.cap == 1);
+    assert(!sc_map_get_64(&map, 0, &val));
+    assert(!sc_map_get_64(&map, 1, &val));
+    assert(sc_map_put_64(&map, 0, 5));
+    assert(sc_map_put_64(&map, 1, 6));
+    assert(sc_map_get_64(&map, 0, &val) && val == 5);
+    assert(sc_map_get_64(&map, 1, &val) && val == 6);
+    assert(sc_map_del_64(&map, 0, NULL));
+    assert(sc_map_del_64(&map, 1, NULL));
+    assert(sc_map_shrink_64(&map));
+    assert(map.cap == 1);
+    sc_map_term_64(&map);
+
+    /* Reserve and shrink complete an ongoing migration */
+    assert(sc_map_init_str(&smap, 0, 0));
+    sc_map_set_incremental_str(&smap, true);
+    assert(sc_map_put_str(&smap, NULL, "null"));
+    for (int i = 0; i < 6; i++) {
+        assert(sc_map_put_str(&smap, str_keys[i], str_keys[i]));
+    }
+    assert(smap.old != NULL);
+    assert(sc_map_reserve_str(&smap, 1000));
+    assert(smap.old == NULL);
+    for (int i = 0; i < 6; i++) {
+        assert(sc_map_get_str(&smap, str_keys[i], &s));
+        assert(s == str_keys[i]);
+    }
+    assert(sc_map_get_str(&smap, NULL, &s));
+    assert(strcmp(s, "null") == 0);
+    assert(sc_map_shrink_str(&smap));
+    assert(smap.cap == 16);
+    assert(sc_map_size_str(&smap) == 7);
+    sc_map_term_str(&smap);
+}
+
+static void test_allocator()
+{
+    uint64_t val;
+    struct arena a = {0};
+    struct sc_map_allocator alloc = {
+            .arg = &a,
+            .alloc = arena_alloc,
+            .release = arena_release,
+    };
+    struct sc_map_64 map;
+
+    a.len = 1024 * 1024;
+    a.mem = malloc(a.len);
+    assert(a.mem != NULL);
+
+    assert(sc_map_init_alloc_64(&map, 0, 0, &alloc));
+    assert(a.allocs == 0);
+    for (uint64_t i = 0; i < 1000; i++) {
+        assert(sc_map_put_64(&map, i, i));
+    }
+    assert(a.allocs > 1);
+    assert(a.releases == a.allocs - 1);
+
+    /* Arena is full */
+    for (uint64_t i = 1000; i < 100000; i++) {
+        if (!sc_map_put_64(&map, i, i)) {
+            break;
+        }
+    }
+    assert(sc_map_get_64(&map, 999, &val) && val == 999);
+    sc_map_term_64(&map);
+    assert(a.releases == a.allocs);
+    free(a.mem);
+
+    /* Last remap allocates more than a huge page */
+    assert(sc_map_init_alloc_64(&map, 0, 0, &sc_map_hugepage_allocator));
+    assert(sc_map_reserve_64(&map, 90000));
+    assert(map.cap * sizeof(*map.mem) >= 2 * 1024 * 1024);
+    for (uint64_t i = 0; i < 90000; i++) {
+        assert(sc_map_put_64(&map, i, i * 2));
+    }
+    for (uint64_t i = 0; i < 90000; i++) {
+        assert(sc_map_get_64(&map, i, &val) && val == i * 2);
+    }
+    for (uint64_t i = 10; i < 90000; i++) {
+        assert(sc_map_del_64(&map, i, NULL));
+    }
+    assert(sc_map_shrink_64(&map));
+    assert(map.cap == 16);
+    assert(sc_map_get_64(&map, 9, &val) && val == 18);
+    sc_map_term_64(&map);
+
+    assert(sc_map_init_alloc_64(&map, 100, 0, &sc_map_hugepage_allocator));
+    assert(sc_map_put_64(&map, 1, 1));
+    sc_map_term_64(&map);
+}
+
+struct sweep
+{
+    struct sc_map_64 seen;
+    uint64_t mod;
+};
+
+static bool sweep_64(void *arg, uint64_t key, uint64_t value)
+{
+    struct sweep *sw = arg;
+
+    /* Each element must be visited once */
+    assert(!sc_map_get_64(&sw->seen, key, &value));
+    assert(sc_map_put_64(&sw->seen, key, value));
+
+    return key % sw->mod == 0;
+}
+
+static bool sweep_collide(void *arg, uint32_t key, uint32_t value)
+{
+    uint32_t *visits = arg;
+
+    visits[key]++;
+    return value % 2 == 0;
+}
+
+static bool sweep_str(void *arg, const char *key, const char *value)
+{
+    (void) key;
+    return value == arg;
+}
+
+static void test_del_if()
+{
+    uint64_t val, v64, n;
+    uint32_t v32, visits[12] = {0};
+    const char *s;
+    static const char x[] = "x";
+    struct sweep sw;
+    struct sc_map_64 map;
+    struct sc_map_collide cmap;
+    struct sc_map_str smap;
+
+    assert(sc_map_init_64(&map, 0, 0));
+    assert(sc_map_init_64(&sw.seen, 0, 0));
+    sw.mod = 3;
+
+    assert(sc_map_del_if_64(&map, sweep_64, &sw) == 0);
+
+    for (uint64_t i = 0; i < 10000; i++) {
+        assert(sc_map_put_64(&map, i, i));
+    }
+
+    n = sc_map_del_if_64(&map, sweep_64, &sw);
+    assert(n == 3334);
+    assert(sc_map_size_64(&sw.seen) == 10000);
+    assert(sc_map_size_64(&map) == 10000 - 3334);
+
+    for (uint64_t i = 0; i < 10000; i++) {
+        assert(sc_map_get_64(&map, i, &val) == (i % 3 != 0));
+    }
+
+    n = 0;
+    sc_map_foreach (&map, val, v64) {
+        assert(val == v64);
+        assert(val % 3 != 0);
+        n++;
+    }
+    assert(n == sc_map_size_64(&map));
+
+    /* Old table is swept as well during incremental migration */
+    sc_map_set_incremental_64(&map, true);
+    for (uint64_t i = 10000; i < 20000; i++) {
+        assert(sc_map_put_64(&map, i, i));
+        if (map.old != NULL) {
+            break;
+        }
+    }
+    assert(map.old != NULL);
+
+    sc_map_clear_64(&sw.seen);
+    sw.mod = 2;
+    n = sc_map_size_64(&map);
+    sc_map_del_if_64(&map, sweep_64, &sw);
+    assert(sc_map_size_64(&sw.seen) == n);
+
+    n = 0;
+    sc_map_foreach (&map, val, v64) {
+        assert(val == v64);
+        assert(val % 2 != 0 && (val >= 10000 || val % 3 != 0));
+        n++;
+    }
+    assert(n == sc_map_size_64(&map));
+
+    sc_map_term_64(&sw.seen);
+    sc_map_term_64(&map);
+
+    /* Single cluster wrapping around the end of the table */
+    assert(sc_map_init_collide(&cmap, 16, 0));
+    assert(cmap.cap == 16);
+    for (uint32_t i = 0; i < 12; i++) {
+        assert(sc_map_put_collide(&cmap, i, i));
+    }
+    assert(cmap.cap == 16);
+
+    assert(sc_map_del_if_collide(&cmap, sweep_collide, visits) == 6);
+    for (uint32_t i = 0; i < 12; i++) {
+        assert(visits[i] == 1);
+        assert(sc_map_get_collide(&cmap, i, &v32) == (i % 2 != 0));
+    }
+    assert(sc_map_size_collide(&cmap) == 6);
+    sc_map_term_collide(&cmap);
+
+    /* NULL key */
+    assert(sc_map_init_str(&smap, 0, 0));
+    assert(sc_map_put_str(&smap, NULL, x));
+    assert(sc_map_put_str(&smap, "a", x));
+    assert(sc_map_put_str(&smap, "b", "y"));
+    assert(sc_map_del_if_str(&smap, sweep_str, (void *) x) == 2);
+    assert(!sc_map_get_str(&smap, NULL, &s));
+    assert(!sc_map_get_str(&smap, "a", &s));
+    assert(sc_map_get_str(&smap, "b", &s));
+    assert(sc_map_size_str(&smap) == 1);
+    sc_map_term_str(&smap);
+}
+
+static void *snapshot_read(FILE *fp, size_t *len)
+{
+    long n;
+    void *data;
+
+    assert(fseek(fp, 0, SEEK_END) == 0);
+    n = ftell(fp);
+    assert(n > 0);
+    rewind(fp);
+
+    data = malloc((size_t) n);
+    assert(data != NULL);
+    assert(fread(data, 1, (size_t) n, fp) == (size_t) n);
+    *len = (size_t) n;
+
+    return data;
+}
+
+static void test_snapshot()
+{
+    size_t len;
+    uint64_t val, count;
+    uint32_t v32;
+    char *data;
+    FILE *fp;
+    struct sc_map_64 map;
+    struct sc_map_32 map32;
+    struct sc_map_snapshot_64 snap;
+    struct sc_map_snapshot_32 snap32;
+    struct sc_map_item_64 *items;
+
+    assert(sc_map_init_64(&map, 0, 0));
+    sc_map_set_incremental_64(&map, true);
+    assert(sc_map_put_64(&map, 0, 1234));
+    for (count = 1; count < 10000 || map.old == NULL; count++) {
+        assert(sc_map_put_64(&map, count * 7, count));
+    }
+
+    fp = tmpfile();
+    assert(fp != NULL);
+    assert(sc_map_snapshot_write_64(&map, fp));
+    assert(map.old == NULL);
+    data = snapshot_read(fp, &len);
+    fclose(fp);
+
+    assert(len == sizeof(struct sc_map_snapshot_hdr) +
+                          (map.cap + 1) * sizeof(*map.mem));
+    assert(sc_map_snapshot_open_64(&snap, data, len));
+    assert(sc_map_snapshot_size_64(&snap) == count);
+    assert(sc_map_snapshot_get_64(&snap, 0, &val) && val == 1234);
+    for (uint64_t i = 1; i < count; i++) {
+        assert(sc_map_snapshot_get_64(&snap, i * 7, &val));
+        assert(val == i);
+        assert(!sc_map_snapshot_get_64(&snap, i * 7 + 1, &val));
+    }
+
+    /* All slots occupied, lookup of a missing key must terminate. */
+    items = (struct sc_map_item_64 *) (data +
+                                        sizeof(struct sc_map_snapshot_hdr));
+    for (uint32_t i = 1; i <= snap.cap; i++) {
+        items[i].key = 1;
+    }
+    assert(sc_map_snapshot_open_64(&snap, data, len));
+    assert(sc_map_snapshot_get_64(&snap, 1, &val));
+    assert(!sc_map_snapshot_get_64(&snap, 2, &val));
+
+    /* Invalid snapshots */
+    assert(!sc_map_snapshot_open_64(&snap, data, len - 1));
+    assert(!sc_map_snapshot_open_64(&snap, data, 10));
+    assert(!sc_map_snapshot_open_64(&snap, data + 1, len - 1));
+    assert(!sc_map_snapshot_open_32(&snap32, data, len));
+    data[0] = 'x';
+    assert(!sc_map_snapshot_open_64(&snap, data, len));
+    free(data);
+
+    assert(sc_map_del_64(&map, 0, NULL));
+    assert(sc_map_put_64(&map, 1, 1));
+
+    /* Write error */
+    fp = fopen("/dev/full", "wb");
+    if (fp != NULL) {
+        setvbuf(fp, NULL, _IONBF, 0);
+        assert(!sc_map_snapshot_write_64(&map, fp));
+        fclose(fp);
+    }
+    sc_map_term_64(&map);
+
+    /* Empty map */
+    assert(sc_map_init_32(&map32, 0, 0));
+    fp = tmpfile();
+    assert(fp != NULL);
+    assert(sc_map_snapshot_write_32(&map32, fp));
+    data = snapshot_read(fp, &len);
+    fclose(fp);
+
+    assert(sc_map_snapshot_open_32(&snap32, data, len));
+    assert(sc_map_snapshot_size_32(&snap32) == 0);
+    assert(!sc_map_snapshot_get_32(&snap32, 0, &v32));
+    assert(!sc_map_snapshot_get_32(&snap32, 1, &v32));
+    free(data);
+    sc_map_term_32(&map32);
+}
+
+static void test_simd_32()
+{
+    const int count = 100000;
+    uint32_t key, val, v2;
+    bool b1, b2;
+    struct sc_map_32 ref;
+    struct sc_map_simd_32 map;
+
+    assert(sc_map_simd_init_32(&map, 0, 0));
+    sc_map_simd_term_32(&map);
+    assert(sc_map_simd_init_32(&map, 0, 1) == false);
+    assert(sc_map_simd_init_32(&map, 0, 99) == false);
+    assert(sc_map_simd_init_32(&map, 0, 0));
+    assert(sc_map_simd_get_32(&map, 0, &val) == false);
+    assert(sc_map_simd_get_32(&map, 19, &val) == false);
+    assert(sc_map_simd_del_32(&map, 19, NULL) == false);
+    assert(sc_map_simd_del_32(&map, 0, NULL) == false);
+    sc_map_simd_clear_32(&map);
+
+    sc_map_foreach (&map, key, val) {
+        assert(false);
+    }
+
+    assert(sc_map_simd_put_32(&map, 0, 100));
+    assert(sc_map_simd_get_32(&map, 0, &val));
+    assert(val == 100);
+    assert(sc_map_simd_size_32(&map) == 1);
+    assert(sc_map_simd_del_32(&map, 0, &val));
+    assert(val == 100);
+    assert(sc_map_simd_size_32(&map) == 0);
+    sc_map_simd_term_32(&map);
+
+    assert(sc_map_init_32(&ref, 0, 0));
+    assert(sc_map_simd_init_32(&map, 16, 94));
+
+    for (int i = 0; i < count; i++) {
+        key = (uint32_t) rand() % 4096;
+        val = (uint32_t) rand();
+
+        switch (rand() % 3) {
+        case 0:
+            assert(sc_map_put_32(&ref, key, val));
+            assert(sc_map_simd_put_32(&map, key, val));
+            break;
+        case 1:
+            b1 = sc_map_get_32(&ref, key, &val);
+            b2 = sc_map_simd_get_32(&map, key, &v2);
+            assert(b1 == b2);
+            assert(!b1 || val == v2);
+            break;
+        default:
+            b1 = sc_map_del_32(&ref, key, &val);
+            b2 = sc_map_simd_del_32(&map, key, &v2);
+            assert(b1 == b2);
+            assert(!b1 || val == v2);
+            break;
+        }
+
+        assert(sc_map_size_32(&ref) == sc_map_simd_size_32(&map));
+    }
+
+    int n = 0;
+    sc_map_foreach (&map, key, val) {
+        assert(sc_map_get_32(&ref, key, &v2));
+        assert(val == v2);
+        n++;
+    }
+    assert(n == (int) sc_map_simd_size_32(&map));
+
+    sc_map_simd_clear_32(&map);
+    assert(sc_map_simd_size_32(&map) == 0);
+    sc_map_foreach_key (&map, key) {
+        assert(false);
+    }
+
+    sc_map_term_32(&ref);
+    sc_map_simd_term_32(&map);
+
+    /* Insert/delete churn must not grow the map because of tombstones */
+    assert(sc_map_simd_init_32(&map, 0, 0));
+    for (uint32_t i = 1; i < 100000; i++) {
+        assert(sc_map_simd_put_32(&map, i, i));
+        assert(sc_map_simd_del_32(&map, i, &val));
+        assert(val == i);
+    }
+    assert(map.cap == 16);
+    sc_map_simd_term_32(&map);
+
+    /* Sequential and stride aligned keys */
+    assert(sc_map_simd_init_32(&map, 0, 0));
+    for (uint32_t i = 0; i < 20000; i++) {
+        assert(sc_map_simd_put_32(&map, i * 4096, i));
+    }
+    for (uint32_t i = 0; i < 20000; i++) {
+        assert(sc_map_simd_get_32(&map, i * 4096, &val));
+        assert(val == i);
+        assert(!sc_map_simd_get_32(&map, (i * 4096) + 1, &val));
+    }
+    assert(sc_map_simd_size_32(&map) == 20000);
+    sc_map_simd_term_32(&map);
+}
+
+static void test_simd_str()
+{
+    const char *arr = "abcdefghijklmnoprstuvyzabcdefghijklmnoprstuvyz";
+    const char *key, *value;
+    char *keys[256];
+    struct sc_map_simd_str map;
+
+    for (int i = 0; i < 256; i++) {
+        keys[i] = str_random((rand() % 64) + 32);
+    }
+
+    assert(sc_map_simd_init_str(&map, 0, 0));
+    assert(sc_map_simd_get_str(&map, NULL, &value) == false);
+    assert(sc_map_simd_del_str(&map, "", NULL) == false);
+    assert(sc_map_simd_put_str(&map, NULL, "nullvalue"));
+    assert(sc_map_simd_get_str(&map, NULL, &value));
+    assert(strcmp(value, "nullvalue") == 0);
+    assert(sc_map_simd_put_str(&map, "key", "value"));
+    assert(sc_map_simd_put_str(&map, "key", "value2"));
+    assert(sc_map_simd_size_str(&map) == 2);
+    assert(sc_map_simd_get_str(&map, "key", &value));
+    assert(strcmp(value, "value2") == 0);
+    assert(sc_map_simd_del_str(&map, "key", &value));
+    assert(strcmp(value, "value2") == 0);
+    assert(!sc_map_simd_get_str(&map, "key", &value));
+    assert(sc_map_simd_del_str(&map, NULL, NULL));
+    assert(sc_map_simd_size_str(&map) == 0);
+
+    for (int i = 0; i < 20; i++) {
+        assert(sc_map_simd_put_str(&map, &arr[i], &arr[i]));
+    }
+    for (int i = 0; i < 20; i++) {
+        assert(sc_map_simd_get_str(&map, &arr[i], &value));
+        assert(value == &arr[i]);
+    }
+    for (int i = 0; i < 20; i += 2) {
+        assert(sc_map_simd_del_str(&map, &arr[i], NULL));
+    }
+    for (int i = 0; i < 20; i++) {
+        assert(sc_map_simd_get_str(&map, &arr[i], &value) == (i % 2 == 1));
+    }
+    sc_map_simd_clear_str(&map);
+
+    for (int i = 0; i < 256; i++) {
+        assert(sc_map_simd_put_str(&map, keys[i], keys[255 - i]));
+    }
+    assert(sc_map_simd_size_str(&map) == 256);
+    for (int i = 0; i < 256; i++) {
+        assert(sc_map_simd_get_str(&map, keys[i], &value));
+        assert(value == keys[255 - i]);
+    }
+    for (int i = 0; i < 128; i++) {
+        assert(sc_map_simd_del_str(&map, keys[i], &value));
+        assert(value == keys[255 - i]);
+    }
+
+    int n = 0;
+    sc_map_foreach (&map, key, value) {
+        bool found = false;
+        for (int j = 128; j < 256; j++) {
+            if (strcmp(key, keys[j]) == 0) {
+                assert(value == keys[255 - j]);
+                found = true;
+                break;
+            }
+        }
+        assert(found);
+        n++;
+    }
+    assert(n == 128);
+
+    sc_map_simd_term_str(&map);
+
+    for (int i = 0; i < 256; i++) {
+        free(keys[i]);
+    }
+}
+
+static void test_simd_types()
+{
+    uint64_t u64;
+    void *v;
+    const char *s;
+    const char *arr = "abcdefghijklmnoprstuvyzabcdefghijklmnoprstuvyz";
+    struct sc_map_simd_64 m64;
+    struct sc_map_simd_64v m64v;
+    struct sc_map_simd_64s m64s;
+    struct sc_map_simd_sv msv;
+    struct sc_map_simd_s64 ms64;
+
+    assert(sc_map_simd_init_64(&m64, 100, 0));
+    assert(sc_map_simd_init_64v(&m64v, 0, 50));
+    assert(sc_map_simd_init_64s(&m64s, 0, 25));
+    assert(sc_map_simd_init_sv(&msv, 0, 95));
+    assert(sc_map_simd_init_s64(&ms64, 1, 0));
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        assert(sc_map_simd_put_64(&m64, i << 32u, i));
+        assert(sc_map_simd_put_64v(&m64v, i, (void *) (uintptr_t) i));
+        assert(sc_map_simd_put_64s(&m64s, i, &arr[i % 20]));
+    }
+
+    for (uint64_t i = 0; i < 20; i++) {
+        assert(sc_map_simd_put_sv(&msv, &arr[i], (void *) (uintptr_t) i));
+        assert(sc_map_simd_put_s64(&ms64, &arr[i], i));
+    }
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        assert(sc_map_simd_get_64(&m64, i << 32u, &u64));
+        assert(u64 == i);
+        assert(sc_map_simd_get_64v(&m64v, i, &v));
+        assert(v == (void *) (uintptr_t) i);
+        assert(sc_map_simd_del_64s(&m64s, i, &s));
+        assert(s == &arr[i % 20]);
+    }
+
+    for (uint64_t i = 0; i < 20; i++) {
+        assert(sc_map_simd_get_sv(&msv, &arr[i], &v));
+        assert(v == (void *) (uintptr_t) i);
+        assert(sc_map_simd_del_s64(&ms64, &arr[i], &u64));
+        assert(u64 == i);
+    }
+
+    assert(sc_map_simd_size_64(&m64) == 1000);
+    assert(sc_map_simd_size_64v(&m64v) == 1000);
+    assert(sc_map_simd_size_64s(&m64s) == 0);
+    assert(sc_map_simd_size_sv(&msv) == 20);
+    assert(sc_map_simd_size_s64(&ms64) == 0);
+
+    sc_map_simd_term_64(&m64);
+    sc_map_simd_term_64v(&m64v);
+    sc_map_simd_term_64s(&m64s);
+    sc_map_simd_term_sv(&msv);
+    sc_map_simd_term_s64(&ms64);
+}
 
 #ifdef SC_HAVE_WRAP
 
@@ -1219,7 +2209,68 @@ void fail_test_s64()
     sc_map_term_s64(&map);
 }
 
+void fail_test_simd()
+{
+    struct sc_map_simd_32 map;
+
+    fail_calloc = true;
+    assert(!sc_map_simd_init_32(&map, 10, 0));
+    fail_calloc = false;
+    assert(sc_map_simd_init_32(&map, 10, 0));
+
+    fail_calloc = true;
+    bool success = true;
+    for (int i = 0; i < 20; i++) {
+        success = sc_map_simd_put_32(&map, i, i);
+    }
+    assert(!success);
+    fail_calloc = false;
+    assert(sc_map_simd_put_32(&map, 44444, 44444));
+
+    for (size_t i = 0; i < SC_SIZE_MAX; i++) {
+        success = sc_map_simd_put_32(&map, i, i);
+    }
+    assert(!success);
+
+    sc_map_simd_term_32(&map);
+}
+
+void fail_test_reserve()
+{
+    uint64_t val;
+    struct sc_map_64 map;
+
+    assert(sc_map_init_64(&map, 0, 0));
+    for (uint64_t i = 0; i < 100; i++) {
+        assert(sc_map_put_64(&map, i, i));
+    }
+
+    fail_calloc = true;
+    assert(!sc_map_reserve_64(&map, 1000));
+    assert(map.cap == 256);
+    for (uint64_t i = 10; i < 100; i++) {
+        assert(sc_map_del_64(&map, i, NULL));
+    }
+    assert(!sc_map_shrink_64(&map));
+    assert(map.cap == 256);
+    fail_calloc = false;
+
+    for (uint64_t i = 0; i < 10; i++) {
+        assert(sc_map_get_64(&map, i, &val) && val == i);
+    }
+    assert(sc_map_shrink_64(&map));
+    assert(map.cap == 16);
+
+    sc_map_term_64(&map);
+}
+
 #else
+void fail_test_simd(void)
+{
+}
+void fail_test_reserve(void)
+{
+}
 void fail_test_32(void)
 {
 }
@@ -1253,6 +2304,8 @@ int main()
     fail_test_str();
     fail_test_sv();
     fail_test_s64();
+    fail_test_simd();
+    fail_test_reserve();
     test1();
     test2();
     test3();
@@ -1266,6 +2319,18 @@ int main()
     test_str();
     test_sv();
     test_s64();
+    test_custom();
+    test_hash();
+    test_batch();
+    test_lenkey();
+    test_incremental();
+    test_reserve();
+    test_allocator();
+    test_del_if();
+    test_snapshot();
+    test_simd_32();
+    test_simd_str();
+    test_simd_types();
 
     return 0;
 }
@@ -22,58 +22,371 @@
  * SOFTWARE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
 #include "sc_map.h"
 
 #include <string.h>
 
-#ifndef SC_SIZE_MAX
-    #define SC_SIZE_MAX UINT32_MAX
+#if defined(__linux__)
+    #include <sys/mman.h>
+#endif
+
+#ifdef SC_SIZE_MAX
+    #undef SC_MAP_SIZE_MAX
+    #define SC_MAP_SIZE_MAX SC_SIZE_MAX
 #endif
 
-#define sc_map_impl_of_strkey(name, K, V, cmp, hash_fn)                        \
-    bool sc_map_cmp_##name(struct sc_map_item_##name *t, K key, uint32_t hash) \
+#define sc_map_impl_of_simd_strkey(name, K, V, cmp, hash_fn)                   \
+    static bool sc_map_simd_cmp_##name(struct sc_map_simd_item_##name *t,      \
+                                       K key, uint32_t hash)                   \
     {                                                                          \
         return t->hash == hash && cmp(t->key, key);                            \
     }                                                                          \
                                                                                \
-    void sc_map_assign_##name(struct sc_map_item_##name *t, K key, V value,    \
-                              uint32_t hash)                                   \
+    static void sc_map_simd_assign_##name(struct sc_map_simd_item_##name *t,   \
+                                          K key, V value, uint32_t hash)       \
     {                                                                          \
         t->key = key;                                                          \
         t->value = value;                                                      \
         t->hash = hash;                                                        \
     }                                                                          \
                                                                                \
-    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    static uint32_t sc_map_simd_hashof_##name(                                 \
+            struct sc_map_simd_item_##name *t)                                 \
     {                                                                          \
         return t->hash;                                                        \
     }                                                                          \
                                                                                \
-    sc_map_impl_of(name, K, V, cmp, hash_fn)
+    sc_map_impl_of_simd(name, K, V, cmp, hash_fn)
 
-#define sc_map_impl_of_scalar(name, K, V, cmp, hash_fn)                        \
-    bool sc_map_cmp_##name(struct sc_map_item_##name *t, K key, uint32_t hash) \
+#define sc_map_impl_of_simd_scalar(name, K, V, cmp, hash_fn)                   \
+    static bool sc_map_simd_cmp_##name(struct sc_map_simd_item_##name *t,      \
+                                       K key, uint32_t hash)                   \
     {                                                                          \
         (void) hash;                                                           \
         return cmp(t->key, key);                                               \
     }                                                                          \
                                                                                \
-    void sc_map_assign_##name(struct sc_map_item_##name *t, K key, V value,    \
-                              uint32_t hash)                                   \
+    static void sc_map_simd_assign_##name(struct sc_map_simd_item_##name *t,   \
+                                          K key, V value, uint32_t hash)       \
     {                                                                          \
         (void) hash;                                                           \
         t->key = key;                                                          \
         t->value = value;                                                      \
     }                                                                          \
                                                                                \
-    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    static uint32_t sc_map_simd_hashof_##name(                                 \
+            struct sc_map_simd_item_##name *t)                                 \
     {                                                                          \
         return hash_fn(t->key);                                                \
     }                                                                          \
                                                                                \
-    sc_map_impl_of(name, K, V, cmp, hash_fn)
+    sc_map_impl_of_simd(name, K, V, cmp, hash_fn)
 
-#define sc_map_impl_of(name, K, V, cmp, hash_fn)                               \
+#define sc_map_impl_of_simd(name, K, V, cmp, hash_fn)                          \
+                                                                               \
+    static const struct sc_map_simd_item_##name                                \
+            sc_map_simd_empty_items_##name[2];                                 \
+                                                                               \
+    static const struct sc_map_simd_##name sc_map_simd_empty_##name = {        \
+            .cap = 1,                                                          \
+            .ctrl = (uint8_t *) sc_map_simd_empty_ctrl,                        \
+            .mem = (struct sc_map_simd_item_##name *) &                        \
+                    sc_map_simd_empty_items_##name[1]};                        \
+                                                                               \
+    static void *sc_map_simd_alloc_##name(uint32_t *cap, uint32_t factor,      \
+                                          uint8_t **ctrl)                      \
+    {                                                                          \
+        uint32_t v = *cap;                                                     \
+        size_t items;                                                          \
+        uintptr_t p;                                                           \
+        struct sc_map_simd_item_##name *t;                                     \
+                                                                               \
+        if (*cap > SC_MAP_SIZE_MAX / factor) {                                 \
+            return NULL;                                                       \
+        }                                                                      \
+                                                                               \
+        /* Find next power of two, at least one group */                       \
+        v = v < SC_MAP_GROUP ? SC_MAP_GROUP : (v * factor);                    \
+        v = sc_map_pow2(v);                                                    \
+                                                                               \
+        items = (size_t) v + 1;                                                \
+        if (items > (SIZE_MAX - SC_MAP_GROUP * 2) / (sizeof(*t) + 1)) {        \
+            return NULL;                                                       \
+        }                                                                      \
+                                                                               \
+        t = sc_map_calloc(1, (sizeof(*t) * items) + v + SC_MAP_GROUP);         \
+        if (t == NULL) {                                                       \
+            return NULL;                                                       \
+        }                                                                      \
+                                                                               \
+        /* Control bytes are placed after items, aligned to group size */      \
+        p = (uintptr_t) &t[items];                                             \
+        p = (p + SC_MAP_GROUP - 1) & ~((uintptr_t) SC_MAP_GROUP - 1);          \
+        *ctrl = (uint8_t *) p;                                                 \
+        memset(*ctrl, SC_MAP_EMPTY, v);                                        \
+        *cap = v;                                                              \
+                                                                               \
+        return &t[1];                                                          \
+    }                                                                          \
+                                                                               \
+    bool sc_map_simd_init_##name(struct sc_map_simd_##name *map, uint32_t cap, \
+                                 uint32_t load_factor)                         \
+    {                                                                          \
+        void *t;                                                               \
+        uint8_t *ctrl;                                                         \
+        uint32_t f = (load_factor == 0) ? 75 : load_factor;                    \
+                                                                               \
+        if (f > 95 || f < 25) {                                                \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (cap == 0) {                                                        \
+            *map = sc_map_simd_empty_##name;                                   \
+            map->load_factor = f;                                              \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        t = sc_map_simd_alloc_##name(&cap, 1, &ctrl);                          \
+        if (t == NULL) {                                                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        map->mem = t;                                                          \
+        map->old = NULL;                                                       \
+        map->old_cap = 0;                                                      \
+        map->ctrl = ctrl;                                                      \
+        map->size = 0;                                                         \
+        map->deleted = 0;                                                      \
+        map->used = false;                                                     \
+        map->cap = cap;                                                        \
+        map->load_factor = f;                                                  \
+        map->remap = (uint32_t)(map->cap * ((double) map->load_factor / 100)); \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    void sc_map_simd_term_##name(struct sc_map_simd_##name *map)               \
+    {                                                                          \
+        if (map->mem != sc_map_simd_empty_##name.mem) {                        \
+            sc_map_free(&map->mem[-1]);                                        \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    void sc_map_simd_clear_##name(struct sc_map_simd_##name *map)              \
+    {                                                                          \
+        if (map->size > 0 || map->deleted > 0) {                               \
+            for (uint32_t i = 0; i < map->cap; i++) {                          \
+                map->mem[i].key = 0;                                           \
+            }                                                                  \
+                                                                               \
+            memset(map->ctrl, SC_MAP_EMPTY, map->cap);                         \
+            map->used = false;                                                 \
+            map->size = 0;                                                     \
+            map->deleted = 0;                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static bool sc_map_simd_remap_##name(struct sc_map_simd_##name *map)       \
+    {                                                                          \
+        uint32_t pos, cap, factor, gmask, g, step, hash, mask;                 \
+        uint8_t *ctrl;                                                         \
+        struct sc_map_simd_item_##name *new;                                   \
+                                                                               \
+        if (map->size + map->deleted < map->remap) {                           \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        SC_STATS_ADD("map.remap", 1);                                          \
+                                                                               \
+        /* Mostly tombstones, rehash in place to the same capacity */          \
+        factor = (map->size < map->remap / 2) ? 1 : 2;                         \
+        cap = map->cap;                                                        \
+        new = sc_map_simd_alloc_##name(&cap, factor, &ctrl);                   \
+        if (new == NULL) {                                                     \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        gmask = (cap - 1) / SC_MAP_GROUP;                                      \
+                                                                               \
+        for (uint32_t i = 0; i < map->cap; i++) {                              \
+            if (map->mem[i].key == 0) {                                        \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            hash = sc_map_simd_mix(sc_map_simd_hashof_##name(&map->mem[i]));   \
+            g = hash & gmask;                                                  \
+            step = 0;                                                          \
+                                                                               \
+            while (true) {                                                     \
+                mask = sc_map_simd_match_empty(&ctrl[g * SC_MAP_GROUP]);       \
+                if (mask != 0) {                                               \
+                    pos = (g * SC_MAP_GROUP) + sc_map_simd_ctz(mask);          \
+                    ctrl[pos] = sc_map_simd_tag(hash);                         \
+                    new[pos] = map->mem[i];                                    \
+                    break;                                                     \
+                }                                                              \
+                                                                               \
+                g = (g + ++step) & gmask;                                      \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        if (map->mem != sc_map_simd_empty_##name.mem) {                        \
+            new[-1] = map->mem[-1];                                            \
+            sc_map_free(&map->mem[-1]);                                        \
+        }                                                                      \
+                                                                               \
+        map->mem = new;                                                        \
+        map->ctrl = ctrl;                                                      \
+        map->cap = cap;                                                        \
+        map->deleted = 0;                                                      \
+        map->remap = (uint32_t)(map->cap * ((double) map->load_factor / 100)); \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    /* Returns slot index of the key or UINT32_MAX if key does not exist */    \
+    static uint32_t sc_map_simd_find_##name(struct sc_map_simd_##name *map,    \
+                                            K key, uint32_t hash)              \
+    {                                                                          \
+        const uint32_t gmask = (map->cap - 1) / SC_MAP_GROUP;                  \
+        const uint32_t mixed = sc_map_simd_mix(hash);                          \
+        const uint8_t tag = sc_map_simd_tag(mixed);                            \
+        uint32_t g = mixed & gmask, step = 0, mask, pos;                       \
+        const uint8_t *ctrl;                                                   \
+                                                                               \
+        while (true) {                                                         \
+            ctrl = &map->ctrl[g * SC_MAP_GROUP];                               \
+            mask = sc_map_simd_match(ctrl, tag);                               \
+                                                                               \
+            while (mask != 0) {                                                \
+                pos = (g * SC_MAP_GROUP) + sc_map_simd_ctz(mask);              \
+                if (sc_map_simd_cmp_##name(&map->mem[pos], key, hash)) {       \
+                    return pos;                                                \
+                }                                                              \
+                mask &= mask - 1;                                              \
+            }                                                                  \
+                                                                               \
+            if (sc_map_simd_match_empty(ctrl) != 0) {                          \
+                return UINT32_MAX;                                             \
+            }                                                                  \
+                                                                               \
+            g = (g + ++step) & gmask;                                          \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    bool sc_map_simd_put_##name(struct sc_map_simd_##name *map, K key,         \
+                                V value)                                       \
+    {                                                                          \
+        uint32_t pos, gmask, g, step = 0, hash, mixed, mask;                   \
+                                                                               \
+        if (!sc_map_simd_remap_##name(map)) {                                  \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (key == 0) {                                                        \
+            map->size += !map->used;                                           \
+            map->used = true;                                                  \
+            map->mem[-1].value = value;                                        \
+                                                                               \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        hash = hash_fn(key);                                                   \
+        pos = sc_map_simd_find_##name(map, key, hash);                         \
+        if (pos != UINT32_MAX) {                                               \
+            sc_map_simd_assign_##name(&map->mem[pos], key, value, hash);       \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        mixed = sc_map_simd_mix(hash);                                         \
+        gmask = (map->cap - 1) / SC_MAP_GROUP;                                 \
+        g = mixed & gmask;                                                     \
+                                                                               \
+        while (true) {                                                         \
+            mask = sc_map_simd_match_free(&map->ctrl[g * SC_MAP_GROUP]);       \
+            if (mask != 0) {                                                   \
+                pos = (g * SC_MAP_GROUP) + sc_map_simd_ctz(mask);              \
+                break;                                                         \
+            }                                                                  \
+                                                                               \
+            g = (g + ++step) & gmask;                                          \
+        }                                                                      \
+                                                                               \
+        map->deleted -= (map->ctrl[pos] == SC_MAP_DELETED);                    \
+        map->ctrl[pos] = sc_map_simd_tag(mixed);                               \
+        map->size++;                                                           \
+        sc_map_simd_assign_##name(&map->mem[pos], key, value, hash);           \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_simd_get_##name(struct sc_map_simd_##name *map, K key,         \
+                                V *value)                                      \
+    {                                                                          \
+        uint32_t pos;                                                          \
+                                                                               \
+        if (key == 0) {                                                        \
+            *value = map->mem[-1].value;                                       \
+            return map->used;                                                  \
+        }                                                                      \
+                                                                               \
+        pos = sc_map_simd_find_##name(map, key, hash_fn(key));                 \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        *value = map->mem[pos].value;                                          \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_simd_del_##name(struct sc_map_simd_##name *map, K key,         \
+                                V *value)                                      \
+    {                                                                          \
+        uint32_t pos;                                                          \
+        const uint8_t *group;                                                  \
+                                                                               \
+        if (key == 0) {                                                        \
+            bool ret = map->used;                                              \
+            map->size -= map->used;                                            \
+            map->used = false;                                                 \
+                                                                               \
+            if (value != NULL) {                                               \
+                *value = map->mem[-1].value;                                   \
+            }                                                                  \
+                                                                               \
+            return ret;                                                        \
+        }                                                                      \
+                                                                               \
+        pos = sc_map_simd_find_##name(map, key, hash_fn(key));                 \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (value != NULL) {                                                   \
+            *value = map->mem[pos].value;                                      \
+        }                                                                      \
+                                                                               \
+        /* If the group has an empty slot, no probe sequence has passed    */  \
+        /* through it, so the slot can be marked empty without a tombstone */  \
+        group = &map->ctrl[pos & ~(SC_MAP_GROUP - 1)];                         \
+        if (sc_map_simd_match_empty(group) != 0) {                             \
+            map->ctrl[pos] = SC_MAP_EMPTY;                                     \
+        } else {                                                               \
+            map->ctrl[pos] = SC_MAP_DELETED;                                   \
+            map->deleted++;                                                    \
+        }                                                                      \
+                                                                               \
+        map->mem[pos].key = 0;                                                 \
+        map->size--;                                                           \
+                                                                               \
+        return true;                                                           \
+    }
+
+#define sc_map_impl_of_lenkey(name, V)                                         \
                                                                                \
     static const struct sc_map_item_##name empty_items_##name[2];              \
                                                                                \
@@ -86,17 +399,13 @@
         uint32_t v = *cap;                                                     \
         struct sc_map_item_##name *t;                                          \
                                                                                \
-        if (*cap > SC_SIZE_MAX / factor) {                                     \
+        if (*cap > SC_MAP_SIZE_MAX / factor) {                                 \
             return NULL;                                                       \
         }                                                                      \
                                                                                \
         /* Find next power of two */                                           \
         v = v < 8 ? 8 : (v * factor);                                          \
-        v--;                                                                   \
-        for (uint32_t i = 1; i < sizeof(v) * 8; i *= 2) {                      \
-            v |= v >> i;                                                       \
-        }                                                                      \
-        v++;                                                                   \
+        v = sc_map_pow2(v);                                                    \
                                                                                \
         *cap = v;                                                              \
         t = sc_map_calloc(sizeof(*t), v + 1);                                  \
@@ -125,6 +434,8 @@
         }                                                                      \
                                                                                \
         map->mem = t;                                                          \
+        map->old = NULL;                                                       \
+        map->old_cap = 0;                                                      \
         map->size = 0;                                                         \
         map->used = false;                                                     \
         map->cap = cap;                                                        \
@@ -141,11 +452,6 @@
         }                                                                      \
     }                                                                          \
                                                                                \
-    uint32_t sc_map_size_##name(struct sc_map_##name *map)                     \
-    {                                                                          \
-        return map->size;                                                      \
-    }                                                                          \
-                                                                               \
     void sc_map_clear_##name(struct sc_map_##name *map)                        \
     {                                                                          \
         if (map->size > 0) {                                                   \
@@ -167,6 +473,8 @@
             return true;                                                       \
         }                                                                      \
                                                                                \
+        SC_STATS_ADD("map.remap", 1);                                          \
+                                                                               \
         cap = map->cap;                                                        \
         new = sc_map_alloc_##name(&cap, 2);                                    \
         if (new == NULL) {                                                     \
@@ -177,7 +485,7 @@
                                                                                \
         for (uint32_t i = 0; i < map->cap; i++) {                              \
             if (map->mem[i].key != 0) {                                        \
-                pos = sc_map_hashof_##name(&map->mem[i]) & (mod);              \
+                pos = map->mem[i].hash & (mod);                                \
                                                                                \
                 while (true) {                                                 \
                     if (new[pos].key == 0) {                                   \
@@ -202,7 +510,28 @@
         return true;                                                           \
     }                                                                          \
                                                                                \
-    bool sc_map_put_##name(struct sc_map_##name *map, K key, V value)          \
+    /* Returns position of the key or UINT32_MAX if key does not exist */      \
+    static uint32_t sc_map_find_##name(struct sc_map_##name *map,              \
+                                       const char *key, uint32_t len,          \
+                                       uint32_t hash)                          \
+    {                                                                          \
+        const uint32_t mod = map->cap - 1;                                     \
+        uint32_t pos = hash & (mod);                                           \
+                                                                               \
+        while (true) {                                                         \
+            if (map->mem[pos].key == 0) {                                      \
+                return UINT32_MAX;                                             \
+            } else if (!sc_map_lencmp(&map->mem[pos], key, len, hash)) {       \
+                pos = (pos + 1) & (mod);                                       \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            return pos;                                                        \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    bool sc_map_put_##name(struct sc_map_##name *map, const char *key,         \
+                           uint32_t len, V value)                              \
     {                                                                          \
         uint32_t pos, mod, hash;                                               \
                                                                                \
@@ -219,52 +548,49 @@
         }                                                                      \
                                                                                \
         mod = map->cap - 1;                                                    \
-        hash = hash_fn(key);                                                   \
+        hash = sc_map_lenhash(key, len);                                       \
         pos = hash & (mod);                                                    \
                                                                                \
         while (true) {                                                         \
             if (map->mem[pos].key == 0) {                                      \
                 map->size++;                                                   \
-            } else if (sc_map_cmp_##name(&map->mem[pos], key, hash) != true) { \
+            } else if (!sc_map_lencmp(&map->mem[pos], key, len, hash)) {       \
                 pos = (pos + 1) & (mod);                                       \
                 continue;                                                      \
             }                                                                  \
                                                                                \
-            sc_map_assign_##name(&map->mem[pos], key, value, hash);            \
+            map->mem[pos].key = key;                                           \
+            map->mem[pos].len = len;                                           \
+            map->mem[pos].hash = hash;                                         \
+            map->mem[pos].value = value;                                       \
             return true;                                                       \
         }                                                                      \
     }                                                                          \
                                                                                \
-    bool sc_map_get_##name(struct sc_map_##name *map, K key, V *value)         \
+    bool sc_map_get_##name(struct sc_map_##name *map, const char *key,         \
+                           uint32_t len, V *value)                             \
     {                                                                          \
-        const uint32_t mod = map->cap - 1;                                     \
-        uint32_t hash, pos;                                                    \
+        uint32_t pos;                                                          \
                                                                                \
         if (key == 0) {                                                        \
             *value = map->mem[-1].value;                                       \
             return map->used;                                                  \
         }                                                                      \
                                                                                \
-        hash = hash_fn(key);                                                   \
-        pos = hash & mod;                                                      \
-                                                                               \
-        while (true) {                                                         \
-            if (map->mem[pos].key == 0) {                                      \
-                return false;                                                  \
-            } else if (sc_map_cmp_##name(&map->mem[pos], key, hash) != true) { \
-                pos = (pos + 1) & (mod);                                       \
-                continue;                                                      \
-            }                                                                  \
-                                                                               \
-            *value = map->mem[pos].value;                                      \
-            return true;                                                       \
+        pos = sc_map_find_##name(map, key, len, sc_map_lenhash(key, len));     \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
         }                                                                      \
+                                                                               \
+        *value = map->mem[pos].value;                                          \
+        return true;                                                           \
     }                                                                          \
                                                                                \
-    bool sc_map_del_##name(struct sc_map_##name *map, K key, V *value)         \
+    bool sc_map_del_##name(struct sc_map_##name *map, const char *key,         \
+                           uint32_t len, V *value)                             \
     {                                                                          \
         const uint32_t mod = map->cap - 1;                                     \
-        uint32_t pos, prev_elem, curr, curr_orig, hash;                        \
+        uint32_t pos, prev_elem, curr, curr_orig;                              \
                                                                                \
         if (key == 0) {                                                        \
             bool ret = map->used;                                              \
@@ -278,67 +604,305 @@
             return ret;                                                        \
         }                                                                      \
                                                                                \
-        hash = hash_fn(key);                                                   \
-        pos = hash & (mod);                                                    \
-                                                                               \
-        while (true) {                                                         \
-            if (map->mem[pos].key == 0) {                                      \
-                return false;                                                  \
-            } else if (sc_map_cmp_##name(&map->mem[pos], key, hash) != true) { \
-                pos = (pos + 1) & (mod);                                       \
-                continue;                                                      \
-            }                                                                  \
+        pos = sc_map_find_##name(map, key, len, sc_map_lenhash(key, len));     \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
+        }                                                                      \
                                                                                \
-            if (value != NULL) {                                               \
-                *value = map->mem[pos].value;                                  \
-            }                                                                  \
+        if (value != NULL) {                                                   \
+            *value = map->mem[pos].value;                                      \
+        }                                                                      \
                                                                                \
-            map->size--;                                                       \
-            map->mem[pos].key = 0;                                             \
-            prev_elem = pos;                                                   \
-            curr = pos;                                                        \
+        map->size--;                                                           \
+        map->mem[pos].key = 0;                                                 \
+        prev_elem = pos;                                                       \
+        curr = pos;                                                            \
                                                                                \
-            while (true) {                                                     \
-                curr = (curr + 1) & (mod);                                     \
-                if (map->mem[curr].key == 0) {                                 \
-                    break;                                                     \
-                }                                                              \
+        while (true) {                                                         \
+            curr = (curr + 1) & (mod);                                         \
+            if (map->mem[curr].key == 0) {                                     \
+                break;                                                         \
+            }                                                                  \
                                                                                \
-                curr_orig = sc_map_hashof_##name(&map->mem[curr]) & (mod);     \
+            curr_orig = map->mem[curr].hash & (mod);                           \
                                                                                \
-                if ((curr_orig > curr &&                                       \
-                     (curr_orig <= prev_elem || curr >= prev_elem)) ||         \
-                    (curr_orig <= prev_elem && curr >= prev_elem)) {           \
+            if ((curr_orig > curr &&                                           \
+                 (curr_orig <= prev_elem || curr >= prev_elem)) ||             \
+                (curr_orig <= prev_elem && curr >= prev_elem)) {               \
                                                                                \
-                    map->mem[prev_elem] = map->mem[curr];                      \
-                    map->mem[curr].key = 0;                                    \
-                    prev_elem = curr;                                          \
-                }                                                              \
+                map->mem[prev_elem] = map->mem[curr];                          \
+                map->mem[curr].key = 0;                                        \
+                prev_elem = curr;                                              \
             }                                                                  \
-                                                                               \
-            return true;                                                       \
         }                                                                      \
+                                                                               \
+        return true;                                                           \
+    }
+
+// clang-format off
+
+/*
+ * Control bytes for simd maps: 0x80 is empty, 0xFE is deleted, full slots
+ * keep 7 bits of the hash with the high bit clear.
+ */
+#define SC_MAP_GROUP   16u
+#define SC_MAP_EMPTY   0x80u
+#define SC_MAP_DELETED 0xFEu
+
+#if !defined(SC_MAP_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) ||       \
+                                 (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define SC_MAP_SSE2
+    #include <emmintrin.h>
+#elif !defined(SC_MAP_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+    #define SC_MAP_NEON
+    #include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+// clang-format on
+
+static const uint8_t sc_map_simd_empty_ctrl[SC_MAP_GROUP] = {
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+static inline uint32_t sc_map_simd_ctz(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t) __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (uint32_t) index;
+#else
+    uint32_t n = 0;
+
+    while ((mask & 1u) == 0) {
+        mask >>= 1u;
+        n++;
     }
 
+    return n;
+#endif
+}
+
+/*
+ * Hash is mixed once more (murmur3 finalizer) before use: low bits select the
+ * group and the top 7 bits become the tag. Keeps identity hashes of
+ * sequential or stride aligned keys from piling up in the same group.
+ */
+static inline uint32_t sc_map_simd_mix(uint32_t hash)
+{
+    hash ^= hash >> 16u;
+    hash *= UINT32_C(0x85ebca6b);
+    hash ^= hash >> 13u;
+    hash *= UINT32_C(0xc2b2ae35);
+    hash ^= hash >> 16u;
+
+    return hash;
+}
 
-static uint32_t sc_map_hash_32(uint32_t a)
+static inline uint8_t sc_map_simd_tag(uint32_t mixed)
 {
+    return (uint8_t) (mixed >> 25u);
+}
+
+#if defined(SC_MAP_SSE2)
+
+static inline uint32_t sc_map_simd_match(const uint8_t *ctrl, uint8_t tag)
+{
+    __m128i g = _mm_loadu_si128((const __m128i *) ctrl);
+    __m128i t = _mm_set1_epi8((char) tag);
+
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(g, t));
+}
+
+static inline uint32_t sc_map_simd_match_empty(const uint8_t *ctrl)
+{
+    return sc_map_simd_match(ctrl, SC_MAP_EMPTY);
+}
+
+static inline uint32_t sc_map_simd_match_free(const uint8_t *ctrl)
+{
+    /* Empty and deleted markers are the only ones with the high bit set */
+    return (uint32_t) _mm_movemask_epi8(
+            _mm_loadu_si128((const __m128i *) ctrl));
+}
+
+#elif defined(SC_MAP_NEON)
+
+static inline uint32_t sc_map_simd_movemask(uint8x16_t v)
+{
+    static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                     1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t m = vandq_u8(v, vld1q_u8(bits));
+
+    return (uint32_t) vaddv_u8(vget_low_u8(m)) |
+           ((uint32_t) vaddv_u8(vget_high_u8(m)) << 8u);
+}
+
+static inline uint32_t sc_map_simd_match(const uint8_t *ctrl, uint8_t tag)
+{
+    return sc_map_simd_movemask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(tag)));
+}
+
+static inline uint32_t sc_map_simd_match_empty(const uint8_t *ctrl)
+{
+    return sc_map_simd_match(ctrl, SC_MAP_EMPTY);
+}
+
+static inline uint32_t sc_map_simd_match_free(const uint8_t *ctrl)
+{
+    return sc_map_simd_movemask(vcgeq_u8(vld1q_u8(ctrl), vdupq_n_u8(0x80)));
+}
+
+#else
+
+static inline uint32_t sc_map_simd_match(const uint8_t *ctrl, uint8_t tag)
+{
+    uint32_t mask = 0;
+
+    for (uint32_t i = 0; i < SC_MAP_GROUP; i++) {
+        mask |= (uint32_t) (ctrl[i] == tag) << i;
+    }
+
+    return mask;
+}
+
+static inline uint32_t sc_map_simd_match_empty(const uint8_t *ctrl)
+{
+    return sc_map_simd_match(ctrl, SC_MAP_EMPTY);
+}
+
+static inline uint32_t sc_map_simd_match_free(const uint8_t *ctrl)
+{
+    uint32_t mask = 0;
+
+    for (uint32_t i = 0; i < SC_MAP_GROUP; i++) {
+        mask |= (uint32_t) (ctrl[i] >> 7u) << i;
+    }
+
+    return mask;
+}
+
+#endif
+
+#if defined(__linux__)
+
+#define SC_MAP_HUGEPAGE (2u * 1024 * 1024)
+
+static size_t sc_map_hugepage_size(size_t size)
+{
+    return (size + SC_MAP_HUGEPAGE - 1) & ~((size_t) SC_MAP_HUGEPAGE - 1);
+}
+
+static void *sc_map_hugepage_alloc(void *arg, size_t size)
+{
+    char *p, *aligned;
+    size_t len, head;
+
+    (void) arg;
+
+    if (size < SC_MAP_HUGEPAGE) {
+        return sc_map_calloc(1, size);
+    }
+
+    /* Map an extra page to align the table to a huge page boundary */
+    len = sc_map_hugepage_size(size);
+    p = mmap(NULL, len + SC_MAP_HUGEPAGE, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+
+    aligned = (char *) sc_map_hugepage_size((uintptr_t) p);
+    head = (size_t) (aligned - p);
+
+    if (head > 0) {
+        munmap(p, head);
+    }
+    munmap(aligned + len, SC_MAP_HUGEPAGE - head);
+
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, len, MADV_HUGEPAGE);
+#endif
+
+    return aligned;
+}
+
+static void sc_map_hugepage_release(void *arg, void *ptr, size_t size)
+{
+    (void) arg;
+
+    if (size < SC_MAP_HUGEPAGE) {
+        sc_map_free(ptr);
+        return;
+    }
+
+    munmap(ptr, sc_map_hugepage_size(size));
+}
+
+#else
+
+static void *sc_map_hugepage_alloc(void *arg, size_t size)
+{
+    (void) arg;
+    return sc_map_calloc(1, size);
+}
+
+static void sc_map_hugepage_release(void *arg, void *ptr, size_t size)
+{
+    (void) arg;
+    (void) size;
+    sc_map_free(ptr);
+}
+
+#endif
+
+const struct sc_map_allocator sc_map_hugepage_allocator = {
+        .alloc = sc_map_hugepage_alloc,
+        .release = sc_map_hugepage_release,
+};
+
+uint32_t sc_map_hash_32(uint32_t a)
+{
+    a ^= a >> 16u;
+    a *= UINT32_C(0x7feb352d);
+    a ^= a >> 15u;
+    a *= UINT32_C(0x846ca68b);
+    a ^= a >> 16u;
+
     return a;
 }
 
-static uint32_t sc_map_hash_64(uint64_t a)
+uint32_t sc_map_hash_64(uint64_t a)
+{
+    a ^= a >> 32u;
+    a *= UINT64_C(0xd6e8feb86659fd93);
+    a ^= a >> 32u;
+    a *= UINT64_C(0xd6e8feb86659fd93);
+    a ^= a >> 32u;
+
+    return (uint32_t) a;
+}
+
+static uint64_t sc_map_seed_value;
+
+void sc_map_set_seed(uint64_t seed)
 {
-    return ((uint32_t) a) ^ (uint32_t)(a >> 32u);
+    sc_map_seed_value = seed;
 }
 
 // clang-format off
-uint32_t murmurhash(const char *key)
+uint32_t sc_map_murmurhash(const void *key, size_t len, uint64_t seed)
 {
     const uint64_t m = UINT64_C(0xc6a4a7935bd1e995);
-    const size_t len = strlen(key);
     const unsigned char* p = (const unsigned char*) key;
     const unsigned char *end = p + (len & ~(uint64_t) 0x7);
-    uint64_t h = (len * m);
+    uint64_t h = seed ^ (len * m);
 
     while (p != end) {
         uint64_t k;
@@ -372,19 +936,44 @@ uint32_t murmurhash(const char *key)
 
     return (uint32_t) h;
 }
+// clang-format on
 
-// clang-format off
+uint32_t sc_map_hash_str(const char *key)
+{
+    return sc_map_murmurhash(key, strlen(key), sc_map_seed_value);
+}
 
-#define sc_map_varcmp(a, b) ((a) == (b))
-#define sc_map_strcmp(a, b) (!strcmp(a, b))
+#define sc_map_lenhash(key, len) sc_map_murmurhash(key, len, sc_map_seed_value)
+#define sc_map_lencmp(t, k, l, h)                                              \
+    ((t)->hash == (h) && (t)->len == (l) && memcmp((t)->key, (k), (l)) == 0)
+
+// clang-format off
 
 //                   name, key type,     value type,        cmp           hash
 sc_map_impl_of_scalar(32,  uint32_t,     uint32_t,     sc_map_varcmp, sc_map_hash_32)
 sc_map_impl_of_scalar(64,  uint64_t,     uint64_t,     sc_map_varcmp, sc_map_hash_64)
 sc_map_impl_of_scalar(64v, uint64_t,     void *,       sc_map_varcmp, sc_map_hash_64)
 sc_map_impl_of_scalar(64s, uint64_t,     const char *, sc_map_varcmp, sc_map_hash_64)
-sc_map_impl_of_strkey(str, const char *, const char *, sc_map_strcmp, murmurhash)
-sc_map_impl_of_strkey(sv,  const char *, void *,       sc_map_strcmp, murmurhash)
-sc_map_impl_of_strkey(s64, const char *, uint64_t,     sc_map_strcmp, murmurhash)
+sc_map_impl_of_strkey(str, const char *, const char *, sc_map_strcmp, sc_map_hash_str)
+sc_map_impl_of_strkey(sv,  const char *, void *,       sc_map_strcmp, sc_map_hash_str)
+sc_map_impl_of_strkey(s64, const char *, uint64_t,     sc_map_strcmp, sc_map_hash_str)
+
+//                     name
+sc_map_impl_of_snapshot(32, uint32_t, uint32_t, sc_map_hash_32)
+sc_map_impl_of_snapshot(64, uint64_t, uint64_t, sc_map_hash_64)
+
+//                        name, key type,     value type,        cmp           hash
+sc_map_impl_of_simd_scalar(32,  uint32_t,     uint32_t,     sc_map_varcmp, sc_map_hash_32)
+sc_map_impl_of_simd_scalar(64,  uint64_t,     uint64_t,     sc_map_varcmp, sc_map_hash_64)
+sc_map_impl_of_simd_scalar(64v, uint64_t,     void *,       sc_map_varcmp, sc_map_hash_64)
+sc_map_impl_of_simd_scalar(64s, uint64_t,     const char *, sc_map_varcmp, sc_map_hash_64)
+sc_map_impl_of_simd_strkey(str, const char *, const char *, sc_map_strcmp, sc_map_hash_str)
+sc_map_impl_of_simd_strkey(sv,  const char *, void *,       sc_map_strcmp, sc_map_hash_str)
+sc_map_impl_of_simd_strkey(s64, const char *, uint64_t,     sc_map_strcmp, sc_map_hash_str)
+
+//                   name, value type
+sc_map_impl_of_lenkey(lstr, const char *)
+sc_map_impl_of_lenkey(lsv,  void *)
+sc_map_impl_of_lenkey(ls64, uint64_t)
 
         // clang-format on
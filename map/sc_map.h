@@ -29,7 +29,9 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef SC_HAVE_CONFIG_H
     #include "config.h"
@@ -38,6 +40,39 @@
     #define sc_map_free   free
 #endif
 
+#ifndef SC_MAP_SIZE_MAX
+    #define SC_MAP_SIZE_MAX UINT32_MAX
+#endif
+
+// Remap, lookup and probe counters with -DSC_STATS, see sc_stats.h
+#ifdef SC_STATS
+    #include "sc_stats.h"
+#elif !defined(SC_STATS_ADD)
+    #define SC_STATS_ADD(name, n) ((void) (n))
+    #define SC_STATS_MAX(name, v) ((void) (v))
+#endif
+
+/**
+ * Table allocator. Tables are allocated with sc_map_calloc() and released with
+ * sc_map_free() unless an allocator is passed to sc_map_init_alloc().
+ *
+ * 'alloc' must return zeroed memory, like calloc(). 'release' is called with
+ * the same size passed to 'alloc'. 'arg' is passed to both, e.g an arena.
+ */
+struct sc_map_allocator
+{
+    void *arg;
+    void *(*alloc)(void *arg, size_t size);
+    void (*release)(void *arg, void *ptr, size_t size);
+};
+
+/**
+ * Allocator for large tables. On Linux, tables of 2 MB and more are mapped
+ * with mmap() and advised to use transparent huge pages to reduce TLB misses.
+ * Smaller tables and other platforms fall back to sc_map_calloc().
+ */
+extern const struct sc_map_allocator sc_map_hugepage_allocator;
+
 #define sc_map_of_strkey(name, K, V)                                           \
     struct sc_map_item_##name                                                  \
     {                                                                          \
@@ -61,11 +96,16 @@
     struct sc_map_##name                                                       \
     {                                                                          \
         struct sc_map_item_##name *mem;                                        \
+        struct sc_map_item_##name *old;                                        \
+        const struct sc_map_allocator *alloc;                                  \
         uint32_t cap;                                                          \
+        uint32_t old_cap;                                                      \
+        uint32_t migrated;                                                     \
         uint32_t size;                                                         \
         uint32_t load_factor;                                                  \
         uint32_t remap;                                                        \
         bool used;                                                             \
+        bool incremental;                                                      \
     };                                                                         \
                                                                                \
                                                                                \
@@ -83,6 +123,23 @@
      */                                                                        \
     bool sc_map_init_##name(struct sc_map_##name *map, uint32_t cap,           \
                             uint32_t load_factor);                             \
+    /**                                                                        \
+     * Create map, tables are allocated with 'alloc'. 'alloc' must outlive     \
+     * the map.                                                                \
+     *                                                                         \
+     * struct sc_map_64 map;                                                   \
+     * sc_map_init_alloc_64(&map, 0, 0, &sc_map_hugepage_allocator);           \
+     *                                                                         \
+     * @param map         map                                                  \
+     * @param cap         initial capacity, zero is accepted                   \
+     * @param load_factor must be >25 and <95. Pass 0 for default value.       \
+     * @param alloc       allocator, pass NULL for sc_map_calloc/sc_map_free   \
+     * @return 'true' on success,                                              \
+     *         'false' on out of memory or if 'load_factor' value is invalid.  \
+     */                                                                        \
+    bool sc_map_init_alloc_##name(struct sc_map_##name *map, uint32_t cap,     \
+                                  uint32_t load_factor,                        \
+                                  const struct sc_map_allocator *alloc);       \
                                                                                \
     /**                                                                        \
      * Destroy map.                                                            \
@@ -103,7 +160,10 @@
      * @param map map                                                          \
      * @return element count                                                   \
      */                                                                        \
-    uint32_t sc_map_size_##name(struct sc_map_##name *map);                    \
+    static inline uint32_t sc_map_size_##name(struct sc_map_##name *map)       \
+    {                                                                          \
+        return map->size;                                                      \
+    }                                                                          \
                                                                                \
     /**                                                                        \
      * Get map element count                                                   \
@@ -114,6 +174,50 @@
      * @param map map                                                          \
      */                                                                        \
     void sc_map_clear_##name(struct sc_map_##name *map);                       \
+    /**                                                                        \
+     * Grow the table so 'n' elements fit without a remap. Rehashes once       \
+     * instead of doubling repeatedly while the map is populated. Does nothing \
+     * if the table is already large enough.                                   \
+     *                                                                         \
+     * struct sc_map_str map;                                                  \
+     * sc_map_reserve_str(&map, 1000000);                                      \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param n   element count                                                \
+     * @return 'true' on success, 'false' on out of memory.                    \
+     */                                                                        \
+    bool sc_map_reserve_##name(struct sc_map_##name *map, uint32_t n);         \
+                                                                               \
+    /**                                                                        \
+     * Shrink the table to the smallest size that fits current elements, e.g   \
+     * after a traffic spike. An empty map releases its table.                 \
+     *                                                                         \
+     * struct sc_map_str map;                                                  \
+     * sc_map_shrink_str(&map);                                                \
+     *                                                                         \
+     * @param map map                                                          \
+     * @return 'true' on success, 'false' on out of memory, map is unchanged.  \
+     */                                                                        \
+    bool sc_map_shrink_##name(struct sc_map_##name *map);                      \
+                                                                               \
+    /**                                                                        \
+     * Enable/disable incremental remap. When enabled, growing the map         \
+     * allocates the new table but keeps the old one, each put/get/del moves   \
+     * a bounded number of slots to the new table until migration completes.   \
+     * Puts never stall on rehashing the whole table, at the cost of looking   \
+     * up both tables while migration is in progress.                          \
+     *                                                                         \
+     * Disabling completes an ongoing migration. Disabled by default.          \
+     *                                                                         \
+     * struct sc_map_64v map;                                                  \
+     * sc_map_init_64v(&map, 0, 0);                                            \
+     * sc_map_set_incremental_64v(&map, true);                                 \
+     *                                                                         \
+     * @param map    map                                                       \
+     * @param enable enable                                                    \
+     */                                                                        \
+    void sc_map_set_incremental_##name(struct sc_map_##name *map,              \
+                                       bool enable);                           \
                                                                                \
     /**                                                                        \
      * Put element to the map                                                  \
@@ -144,6 +248,27 @@
      */                                                                        \
     bool sc_map_get_##name(struct sc_map_##name *map, K key, V *val);          \
                                                                                \
+    /**                                                                        \
+     * Get elements in batch. Hashes keys and prefetches buckets in chunks     \
+     * before probing, so cache misses of different keys overlap.              \
+     *                                                                         \
+     * const char *keys[2] = {"key1", "key2"};                                 \
+     * const char *values[2];                                                  \
+     * bool found[2];                                                          \
+     * struct sc_map_str map;                                                  \
+     *                                                                         \
+     * sc_map_get_batch_str(&map, keys, values, found, 2);                     \
+     *                                                                         \
+     * @param map    map                                                       \
+     * @param keys   keys to look up                                           \
+     * @param values values, if a key is missing, its value is undefined       \
+     * @param found  'true' for keys that exist, 'false' otherwise             \
+     * @param n      key count                                                 \
+     * @return       found key count                                           \
+     */                                                                        \
+    size_t sc_map_get_batch_##name(struct sc_map_##name *map, const K *keys,   \
+                                   V *values, bool *found, size_t n);          \
+                                                                               \
     /**                                                                        \
      * Delete element                                                          \
      *                                                                         \
@@ -160,10 +285,365 @@
      *          - Pass NULL if you don't want to get previous 'value'          \
      * @return 'true' if key exists, 'false' otherwise                         \
      */                                                                        \
-    bool sc_map_del_##name(struct sc_map_##name *map, K key, V *val);
+    bool sc_map_del_##name(struct sc_map_##name *map, K key, V *val);          \
+                                                                               \
+    /**                                                                        \
+     * Delete elements for which 'fn' returns 'true' in a single pass, e.g     \
+     * expiring entries without collecting keys first. Each element is passed  \
+     * to 'fn' once, 'fn' must not modify the map.                             \
+     *                                                                         \
+     * static bool expired(void *arg, uint64_t key, void *value)               \
+     * {                                                                       \
+     *     return ((struct session *) value)->deadline < *(uint64_t *) arg;    \
+     * }                                                                       \
+     *                                                                         \
+     * struct sc_map_64v map;                                                  \
+     * sc_map_del_if_64v(&map, expired, &now);                                 \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param fn  callback, return 'true' to delete the element                \
+     * @param arg user data passed to 'fn'                                     \
+     * @return    deleted element count                                        \
+     */                                                                        \
+    uint32_t sc_map_del_if_##name(struct sc_map_##name *map,                   \
+                                  bool (*fn)(void *arg, K key, V value),       \
+                                  void *arg);
+
+/**
+ * SIMD probed variant.
+ *
+ * Same api with 'sc_map_simd_' prefix, e.g sc_map_simd_put_str(). Keeps a
+ * separate array of 1-byte control tags (7 bits from hash or empty/deleted
+ * marker) and scans 16 slots per probe step with SSE2/NEON, scalar fallback
+ * on other targets. Items are only touched on a tag match, so misses are
+ * mostly resolved within the control bytes. Deletion leaves tombstones which
+ * are purged on the next remap.
+ *
+ * sc_map_foreach(), sc_map_foreach_key() and sc_map_foreach_value() work on
+ * simd maps as well.
+ */
+#define sc_map_of_simd_strkey(name, K, V)                                      \
+    struct sc_map_simd_item_##name                                             \
+    {                                                                          \
+        K key;                                                                 \
+        V value;                                                               \
+        uint32_t hash;                                                         \
+    };                                                                         \
+                                                                               \
+    sc_map_of_simd(name, K, V)
+
+#define sc_map_of_simd_scalar(name, K, V)                                      \
+    struct sc_map_simd_item_##name                                             \
+    {                                                                          \
+        K key;                                                                 \
+        V value;                                                               \
+    };                                                                         \
+                                                                               \
+    sc_map_of_simd(name, K, V)
+
+#define sc_map_of_simd(name, K, V)                                             \
+    struct sc_map_simd_##name                                                  \
+    {                                                                          \
+        struct sc_map_simd_item_##name *mem;                                   \
+        struct sc_map_simd_item_##name *old; /* Always empty, see foreach */   \
+        uint8_t *ctrl;                                                         \
+        uint32_t cap;                                                          \
+        uint32_t old_cap;                                                      \
+        uint32_t size;                                                         \
+        uint32_t deleted;                                                      \
+        uint32_t load_factor;                                                  \
+        uint32_t remap;                                                        \
+        bool used;                                                             \
+    };                                                                         \
+                                                                               \
+    /**                                                                        \
+     * Create map                                                              \
+     *                                                                         \
+     * struct sc_map_simd_str map;                                             \
+     * sc_map_simd_init_str(&map, 0, 0);                                       \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param cap initial capacity, zero is accepted                           \
+     * @param load_factor must be >25 and <95. Pass 0 for default value.       \
+     * @return 'true' on success,                                              \
+     *         'false' on out of memory or if 'load_factor' value is invalid.  \
+     */                                                                        \
+    bool sc_map_simd_init_##name(struct sc_map_simd_##name *map, uint32_t cap, \
+                                 uint32_t load_factor);                        \
+                                                                               \
+    /**                                                                        \
+     * Destroy map.                                                            \
+     *                                                                         \
+     * @param map map                                                          \
+     */                                                                        \
+    void sc_map_simd_term_##name(struct sc_map_simd_##name *map);              \
+                                                                               \
+    /**                                                                        \
+     * Get map element count                                                   \
+     *                                                                         \
+     * @param map map                                                          \
+     * @return element count                                                   \
+     */                                                                        \
+    static inline uint32_t sc_map_simd_size_##name(                            \
+            struct sc_map_simd_##name *map)                                    \
+    {                                                                          \
+        return map->size;                                                      \
+    }                                                                          \
+                                                                               \
+    /**                                                                        \
+     * Clear map                                                               \
+     *                                                                         \
+     * @param map map                                                          \
+     */                                                                        \
+    void sc_map_simd_clear_##name(struct sc_map_simd_##name *map);             \
+                                                                               \
+    /**                                                                        \
+     * Put element to the map                                                  \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param K key                                                            \
+     * @param V value                                                          \
+     * @return 'true' on success, 'false' on out of memory.                    \
+     */                                                                        \
+    bool sc_map_simd_put_##name(struct sc_map_simd_##name *map, K key, V val); \
+                                                                               \
+    /**                                                                        \
+     * Get element                                                             \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param K key                                                            \
+     * @param V pointer to put value, if key is missing, value is undefined    \
+     * @return 'true' if key exists, 'false' otherwise                         \
+     */                                                                        \
+    bool sc_map_simd_get_##name(struct sc_map_simd_##name *map, K key,         \
+                                V *val);                                       \
+                                                                               \
+    /**                                                                        \
+     * Delete element                                                          \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param K key                                                            \
+     * @param V pointer to put current value                                   \
+     *          - if key does not exist, value is undefined                    \
+     *          - Pass NULL if you don't want to get previous 'value'          \
+     * @return 'true' if key exists, 'false' otherwise                         \
+     */                                                                        \
+    bool sc_map_simd_del_##name(struct sc_map_simd_##name *map, K key,         \
+                                V *val);
+
+/**
+ * Length aware string key maps.
+ *
+ * Keys are (pointer, length) pairs, so there is no strlen() on lookup and
+ * keys are compared with a length check and memcmp(). Length is stored in
+ * the item next to the hash. Keys don't have to be null terminated, e.g
+ * slices of a buffer or length prefixed strings of sc_str with sc_str_len().
+ *
+ * Same api as other maps with an additional 'len' parameter after the key.
+ * sc_map_foreach() works on these maps as well.
+ */
+#define sc_map_of_lenkey(name, V)                                              \
+    struct sc_map_item_##name                                                  \
+    {                                                                          \
+        const char *key;                                                       \
+        V value;                                                               \
+        uint32_t len;                                                          \
+        uint32_t hash;                                                         \
+    };                                                                         \
+                                                                               \
+    struct sc_map_##name                                                       \
+    {                                                                          \
+        struct sc_map_item_##name *mem;                                        \
+        struct sc_map_item_##name *old; /* Always empty, see foreach */        \
+        uint32_t cap;                                                          \
+        uint32_t old_cap;                                                      \
+        uint32_t size;                                                         \
+        uint32_t load_factor;                                                  \
+        uint32_t remap;                                                        \
+        bool used;                                                             \
+    };                                                                         \
+                                                                               \
+    /**                                                                        \
+     * Create map                                                              \
+     *                                                                         \
+     * struct sc_map_lstr map;                                                 \
+     * sc_map_init_lstr(&map, 0, 0);                                           \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param cap initial capacity, zero is accepted                           \
+     * @param load_factor must be >25 and <95. Pass 0 for default value.       \
+     * @return 'true' on success,                                              \
+     *         'false' on out of memory or if 'load_factor' value is invalid.  \
+     */                                                                        \
+    bool sc_map_init_##name(struct sc_map_##name *map, uint32_t cap,           \
+                            uint32_t load_factor);                             \
+                                                                               \
+    /**                                                                        \
+     * Destroy map.                                                            \
+     *                                                                         \
+     * @param map map                                                          \
+     */                                                                        \
+    void sc_map_term_##name(struct sc_map_##name *map);                        \
+                                                                               \
+    /**                                                                        \
+     * Get map element count                                                   \
+     *                                                                         \
+     * @param map map                                                          \
+     * @return element count                                                   \
+     */                                                                        \
+    static inline uint32_t sc_map_size_##name(struct sc_map_##name *map)       \
+    {                                                                          \
+        return map->size;                                                      \
+    }                                                                          \
+                                                                               \
+    /**                                                                        \
+     * Clear map                                                               \
+     *                                                                         \
+     * @param map map                                                          \
+     */                                                                        \
+    void sc_map_clear_##name(struct sc_map_##name *map);                       \
+                                                                               \
+    /**                                                                        \
+     * Put element to the map, key is not copied.                              \
+     *                                                                         \
+     * struct sc_map_lstr map;                                                 \
+     * sc_map_put_lstr(&map, "key", 3, "value");                               \
+     *                                                                         \
+     * // With length prefixed strings of sc_str                               \
+     * sc_map_put_lstr(&map, str, sc_str_len(str), "value");                   \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param key key, NULL key is accepted                                    \
+     * @param len key length                                                   \
+     * @param V   value                                                        \
+     * @return 'true' on success, 'false' on out of memory.                    \
+     */                                                                        \
+    bool sc_map_put_##name(struct sc_map_##name *map, const char *key,         \
+                           uint32_t len, V val);                               \
+                                                                               \
+    /**                                                                        \
+     * Get element                                                             \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param key key                                                          \
+     * @param len key length                                                   \
+     * @param V   pointer to put value, if key is missing, value is undefined  \
+     * @return 'true' if key exists, 'false' otherwise                         \
+     */                                                                        \
+    bool sc_map_get_##name(struct sc_map_##name *map, const char *key,         \
+                           uint32_t len, V *val);                              \
+                                                                               \
+    /**                                                                        \
+     * Delete element                                                          \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param key key                                                          \
+     * @param len key length                                                   \
+     * @param V   pointer to put current value                                 \
+     *          - if key does not exist, value is undefined                    \
+     *          - Pass NULL if you don't want to get previous 'value'          \
+     * @return 'true' if key exists, 'false' otherwise                         \
+     */                                                                        \
+    bool sc_map_del_##name(struct sc_map_##name *map, const char *key,         \
+                           uint32_t len, V *val);
+
+/**
+ * Read-only snapshots of scalar key maps.
+ *
+ * The table is written as is, with a header, so it can be mapped into memory
+ * later (e.g with sc_mmap) and queried in place without rehashing. Only maps
+ * with plain values make sense, pointers are meaningless after a restart.
+ * Snapshots are only valid on a machine with the same byte order, item layout
+ * and hash function, sc_map_snapshot_open_*() rejects others.
+ */
+#define SC_MAP_SNAPSHOT_VERSION 1
+
+struct sc_map_snapshot_hdr
+{
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint32_t item_size;
+    uint32_t hash_check;
+    uint32_t cap;
+    uint32_t size;
+    uint32_t used;
+    uint32_t reserved;
+};
+
+#define sc_map_of_snapshot(name, K, V)                                         \
+    struct sc_map_snapshot_##name                                              \
+    {                                                                          \
+        const struct sc_map_item_##name *mem;                                  \
+        uint32_t cap;                                                          \
+        uint32_t size;                                                         \
+        bool used;                                                             \
+    };                                                                         \
+                                                                               \
+    /**                                                                        \
+     * Write map to a file. Completes an ongoing incremental remap first.      \
+     *                                                                         \
+     * FILE *fp = fopen("map.snap", "wb");                                     \
+     * struct sc_map_64 map;                                                   \
+     * sc_map_snapshot_write_64(&map, fp);                                     \
+     *                                                                         \
+     * @param map map                                                          \
+     * @param fp  file                                                         \
+     * @return 'true' on success, 'false' on write error.                      \
+     */                                                                        \
+    bool sc_map_snapshot_write_##name(struct sc_map_##name *map, FILE *fp);    \
+                                                                               \
+    /**                                                                        \
+     * Open snapshot, 'data' must stay valid while the snapshot is in use and  \
+     * must be 8 bytes aligned, e.g memory mapped file.                        \
+     *                                                                         \
+     * struct sc_mmap mmap;                                                    \
+     * struct sc_map_snapshot_64 snap;                                         \
+     *                                                                         \
+     * sc_mmap_init(&mmap, "map.snap", O_RDONLY, PROT_READ, MAP_SHARED, 0, 0); \
+     * sc_map_snapshot_open_64(&snap, mmap.ptr, mmap.len);                     \
+     *                                                                         \
+     * @param s    snapshot                                                    \
+     * @param data snapshot data                                               \
+     * @param len  data length                                                 \
+     * @return 'true' on success, 'false' if data is not a valid snapshot.     \
+     */                                                                        \
+    bool sc_map_snapshot_open_##name(struct sc_map_snapshot_##name *s,         \
+                                     const void *data, size_t len);            \
+                                                                               \
+    /**                                                                        \
+     * @param s snapshot                                                       \
+     * @return  element count                                                  \
+     */                                                                        \
+    static inline uint32_t sc_map_snapshot_size_##name(                        \
+            struct sc_map_snapshot_##name *s)                                  \
+    {                                                                          \
+        return s->size;                                                        \
+    }                                                                          \
+                                                                               \
+    /**                                                                        \
+     * Get element                                                             \
+     *                                                                         \
+     * @param s   snapshot                                                     \
+     * @param key key                                                          \
+     * @param val pointer to put value, if key is missing, value is undefined  \
+     * @return 'true' if key exists, 'false' otherwise                         \
+     */                                                                        \
+    bool sc_map_snapshot_get_##name(struct sc_map_snapshot_##name *s, K key,   \
+                                    V *val);
 
 /**
- * Foreach loop
+ * Slot 'i' of the map, slots after 'cap' belong to the old table while an
+ * incremental remap is in progress.
+ */
+#define sc_map_slot(map, i)                                                    \
+    ((i) < (map)->cap ? (map)->mem[(i)] : (map)->old[(i) - (map)->cap])
+
+#define sc_map_slots(map) ((int64_t) (map)->cap + (map)->old_cap)
+
+/**
+ * Foreach loop, stops as soon as all elements are visited. Map must not be
+ * modified inside the loop, see sc_map_del_if_* to delete while iterating.
  *
  * char *key, *value;
  * struct sc_map_str map;
@@ -173,9 +653,11 @@
  * }
  */
 #define sc_map_foreach(map, K, V)                                              \
-    for (int64_t __i = -1, __b = 0; __i < (map)->cap; __i++)                   \
-        for ((V) = (map)->mem[__i].value, (K) = (map)->mem[__i].key, __b = 1;  \
-             __b && ((__i == -1 && (map)->used) || (K) != 0); __b = 0)
+    for (int64_t __i = -1, __b = 0, __n = 0;                                   \
+         __i < sc_map_slots(map) && __n < (map)->size; __i++)                  \
+        for ((V) = sc_map_slot(map, __i).value,                                \
+             (K) = sc_map_slot(map, __i).key, __b = 1;                         \
+             __b && ((__i == -1 && (map)->used) || (K) != 0); __b = 0, __n++)
 
 /**
  * Foreach loop for keys
@@ -188,9 +670,10 @@
  * }
  */
 #define sc_map_foreach_key(map, K)                                             \
-    for (int64_t __i = -1, __b = 0; __i < (map)->cap; __i++)                   \
-        for ((K) = (map)->mem[__i].key, __b = 1;                               \
-             __b && ((__i == -1 && (map)->used) || (K) != 0); __b = 0)
+    for (int64_t __i = -1, __b = 0, __n = 0;                                   \
+         __i < sc_map_slots(map) && __n < (map)->size; __i++)                  \
+        for ((K) = sc_map_slot(map, __i).key, __b = 1;                         \
+             __b && ((__i == -1 && (map)->used) || (K) != 0); __b = 0, __n++)
 
 /**
  * Foreach loop for values
@@ -203,10 +686,831 @@
  * }
  */
 #define sc_map_foreach_value(map, V)                                           \
-    for (int64_t __i = -1, __b = 0; __i < (map)->cap; __i++)                   \
-        for ((V) = (map)->mem[__i].value, __b = 1;                             \
-             __b && ((__i == -1 && (map)->used) || (map)->mem[__i].key != 0);  \
-             __b = 0)
+    for (int64_t __i = -1, __b = 0, __n = 0;                                   \
+         __i < sc_map_slots(map) && __n < (map)->size; __i++)                  \
+        for ((V) = sc_map_slot(map, __i).value, __b = 1;                       \
+             __b && ((__i == -1 && (map)->used) ||                             \
+                     sc_map_slot(map, __i).key != 0);                          \
+             __b = 0, __n++)
+
+/**
+ * Hash functions used by predefined maps. Integer hashes are finalizers, so
+ * sequential or stride aligned keys are spread over the table.
+ */
+uint32_t sc_map_hash_32(uint32_t a);
+uint32_t sc_map_hash_64(uint64_t a);
+
+/**
+ * Seeded murmurhash64a, truncated to 32 bits.
+ *
+ * @param key  key
+ * @param len  key length
+ * @param seed seed
+ * @return     hash
+ */
+uint32_t sc_map_murmurhash(const void *key, size_t len, uint64_t seed);
+
+/**
+ * Hash function of string key maps, seeded with sc_map_set_seed() value.
+ *
+ * @param key null terminated string
+ * @return    hash
+ */
+uint32_t sc_map_hash_str(const char *key);
+
+/**
+ * Set seed of string key hash function. Seed it with a random value to make
+ * it hard to generate colliding keys, e.g when keys are received from
+ * clients. Must be called before any string key map is populated, changing
+ * seed invalidates existing maps. Default seed is zero.
+ *
+ * @param seed seed
+ */
+void sc_map_set_seed(uint64_t seed);
+
+#define sc_map_varcmp(a, b) ((a) == (b))
+#define sc_map_strcmp(a, b) (!strcmp(a, b))
+
+// Batch lookups hash and prefetch this many keys before probing
+#define SC_MAP_BATCH 16
+
+// Incremental remap moves this many slots of the old table on each operation
+#define SC_MAP_MIGRATE 64
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define sc_map_prefetch(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <xmmintrin.h>
+    #define sc_map_prefetch(p) _mm_prefetch((const char *) (p), _MM_HINT_T0)
+#else
+    #define sc_map_prefetch(p) ((void) (p))
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+// Next power of two >= v for v >= 2, '0' if it doesn't fit.
+static inline uint32_t sc_map_pow2(uint32_t v)
+{
+    if (v > ((uint32_t) 1 << 31)) {
+        return 0;
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t) 1 << (32 - __builtin_clz(v - 1));
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, v - 1);
+    return (uint32_t) 1 << (index + 1);
+#else
+    v--;
+    for (uint32_t i = 1; i < sizeof(v) * 8; i *= 2) {
+        v |= v >> i;
+    }
+
+    return v + 1;
+#endif
+}
+
+/**
+ * Map definitions, macros generate function bodies.
+ *
+ * Custom maps can be created with user supplied compare and hash functions.
+ * Declare it in a header and define it in a single .c file :
+ *
+ * // Header
+ * sc_map_of_scalar(my, uint16_t, void *)
+ *
+ * // Source file
+ * static uint32_t my_hash(uint16_t key) { return sc_map_hash_32(key); }
+ * sc_map_impl_of_scalar(my, uint16_t, void *, sc_map_varcmp, my_hash)
+ *
+ * 'cmp(a, b)' must return 'true' if keys are equal. Zero (or NULL) key is
+ * handled by the map and never passed to hash/compare functions.
+ */
+#define sc_map_impl_of_strkey(name, K, V, cmp, hash_fn)                        \
+    bool sc_map_cmp_##name(struct sc_map_item_##name *t, K key, uint32_t hash) \
+    {                                                                          \
+        return t->hash == hash && cmp(t->key, key);                            \
+    }                                                                          \
+                                                                               \
+    void sc_map_assign_##name(struct sc_map_item_##name *t, K key, V value,    \
+                              uint32_t hash)                                   \
+    {                                                                          \
+        t->key = key;                                                          \
+        t->value = value;                                                      \
+        t->hash = hash;                                                        \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    {                                                                          \
+        return t->hash;                                                        \
+    }                                                                          \
+                                                                               \
+    sc_map_impl_of(name, K, V, cmp, hash_fn)
+
+#define sc_map_impl_of_scalar(name, K, V, cmp, hash_fn)                        \
+    bool sc_map_cmp_##name(struct sc_map_item_##name *t, K key, uint32_t hash) \
+    {                                                                          \
+        (void) hash;                                                           \
+        return cmp(t->key, key);                                               \
+    }                                                                          \
+                                                                               \
+    void sc_map_assign_##name(struct sc_map_item_##name *t, K key, V value,    \
+                              uint32_t hash)                                   \
+    {                                                                          \
+        (void) hash;                                                           \
+        t->key = key;                                                          \
+        t->value = value;                                                      \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    {                                                                          \
+        return hash_fn(t->key);                                                \
+    }                                                                          \
+                                                                               \
+    sc_map_impl_of(name, K, V, cmp, hash_fn)
+
+#define sc_map_impl_of(name, K, V, cmp, hash_fn)                               \
+                                                                               \
+    static const struct sc_map_item_##name empty_items_##name[2];              \
+                                                                               \
+    static const struct sc_map_##name sc_map_empty_##name = {                  \
+            .cap = 1,                                                          \
+            .mem = (struct sc_map_item_##name *) &empty_items_##name[1]};      \
+                                                                               \
+    static void *sc_map_alloc_##name(struct sc_map_##name *map, uint32_t *cap, \
+                                     uint32_t factor)                          \
+    {                                                                          \
+        uint32_t v = *cap;                                                     \
+        struct sc_map_item_##name *t;                                          \
+                                                                               \
+        if (*cap > SC_MAP_SIZE_MAX / factor) {                                 \
+            return NULL;                                                       \
+        }                                                                      \
+                                                                               \
+        /* Find next power of two */                                           \
+        v = v < 8 ? 8 : (v * factor);                                          \
+        v = sc_map_pow2(v);                                                    \
+                                                                               \
+        *cap = v;                                                              \
+                                                                               \
+        if (map->alloc != NULL) {                                              \
+            size_t size = sizeof(*t) * ((size_t) v + 1);                       \
+            t = map->alloc->alloc(map->alloc->arg, size);                      \
+        } else {                                                               \
+            t = sc_map_calloc(sizeof(*t), v + 1);                              \
+        }                                                                      \
+                                                                               \
+        return t ? &t[1] : NULL;                                               \
+    }                                                                          \
+                                                                               \
+    static void sc_map_dealloc_##name(struct sc_map_##name *map,               \
+                                      struct sc_map_item_##name *mem,          \
+                                      uint32_t cap)                            \
+    {                                                                          \
+        if (map->alloc != NULL) {                                              \
+            map->alloc->release(map->alloc->arg, &mem[-1],                     \
+                                sizeof(*mem) * ((size_t) cap + 1));            \
+            return;                                                            \
+        }                                                                      \
+                                                                               \
+        sc_map_free(&mem[-1]);                                                 \
+    }                                                                          \
+                                                                               \
+    bool sc_map_init_alloc_##name(struct sc_map_##name *map, uint32_t cap,     \
+                                  uint32_t load_factor,                        \
+                                  const struct sc_map_allocator *alloc)        \
+    {                                                                          \
+        void *t;                                                               \
+        uint32_t f = (load_factor == 0) ? 75 : load_factor;                    \
+                                                                               \
+        if (f > 95 || f < 25) {                                                \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (cap == 0) {                                                        \
+            *map = sc_map_empty_##name;                                        \
+            map->alloc = alloc;                                                \
+            map->load_factor = f;                                              \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        map->alloc = alloc;                                                    \
+                                                                               \
+        t = sc_map_alloc_##name(map, &cap, 1);                                 \
+        if (t == NULL) {                                                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        map->mem = t;                                                          \
+        map->old = NULL;                                                       \
+        map->old_cap = 0;                                                      \
+        map->migrated = 0;                                                     \
+        map->size = 0;                                                         \
+        map->used = false;                                                     \
+        map->incremental = false;                                              \
+        map->cap = cap;                                                        \
+        map->load_factor = f;                                                  \
+        map->remap = (uint32_t)(map->cap * ((double) map->load_factor / 100)); \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_init_##name(struct sc_map_##name *map, uint32_t cap,           \
+                            uint32_t load_factor)                              \
+    {                                                                          \
+        return sc_map_init_alloc_##name(map, cap, load_factor, NULL);          \
+    }                                                                          \
+                                                                               \
+    void sc_map_term_##name(struct sc_map_##name *map)                         \
+    {                                                                          \
+        if (map->old != NULL) {                                                \
+            sc_map_dealloc_##name(map, map->old, map->old_cap);                \
+        }                                                                      \
+                                                                               \
+        if (map->mem != sc_map_empty_##name.mem) {                             \
+            sc_map_dealloc_##name(map, map->mem, map->cap);                    \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    void sc_map_clear_##name(struct sc_map_##name *map)                        \
+    {                                                                          \
+        if (map->old != NULL) {                                                \
+            sc_map_dealloc_##name(map, map->old, map->old_cap);                \
+            map->old = NULL;                                                   \
+            map->old_cap = 0;                                                  \
+            map->migrated = 0;                                                 \
+        }                                                                      \
+                                                                               \
+        if (map->size > 0) {                                                   \
+            for (uint32_t i = 0; i < map->cap; i++) {                          \
+                map->mem[i].key = 0;                                           \
+            }                                                                  \
+                                                                               \
+            map->used = false;                                                 \
+            map->size = 0;                                                     \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Inserts an item known to be missing from the table */                   \
+    static void sc_map_insert_##name(struct sc_map_item_##name *mem,           \
+                                     uint32_t mod,                             \
+                                     struct sc_map_item_##name *item)          \
+    {                                                                          \
+        uint32_t pos = sc_map_hashof_##name(item) & (mod);                     \
+                                                                               \
+        while (true) {                                                         \
+            if (mem[pos].key == 0) {                                           \
+                mem[pos] = *item;                                              \
+                return;                                                        \
+            }                                                                  \
+                                                                               \
+            pos = (pos + 1) & (mod);                                           \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Returns position of the key or UINT32_MAX if key does not exist */      \
+    static uint32_t sc_map_find_##name(struct sc_map_item_##name *mem,         \
+                                       uint32_t mod, K key, uint32_t hash)     \
+    {                                                                          \
+        uint32_t pos = hash & (mod), probe = 0;                                \
+                                                                               \
+        while (true) {                                                         \
+            if (mem[pos].key == 0) {                                           \
+                pos = UINT32_MAX;                                              \
+            } else if (sc_map_cmp_##name(&mem[pos], key, hash) != true) {      \
+                pos = (pos + 1) & (mod);                                       \
+                probe++;                                                       \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            SC_STATS_ADD("map.lookup", 1);                                     \
+            SC_STATS_ADD("map.probe", probe);                                  \
+            SC_STATS_MAX("map.probe_max", probe);                              \
+                                                                               \
+            return pos;                                                        \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Removes item at 'pos' with backward shift, no tombstones */             \
+    static void sc_map_erase_##name(struct sc_map_item_##name *mem,            \
+                                    uint32_t mod, uint32_t pos)                \
+    {                                                                          \
+        uint32_t prev_elem, curr, curr_orig;                                   \
+                                                                               \
+        mem[pos].key = 0;                                                      \
+        prev_elem = pos;                                                       \
+        curr = pos;                                                            \
+                                                                               \
+        while (true) {                                                         \
+            curr = (curr + 1) & (mod);                                         \
+            if (mem[curr].key == 0) {                                          \
+                break;                                                         \
+            }                                                                  \
+                                                                               \
+            curr_orig = sc_map_hashof_##name(&mem[curr]) & (mod);              \
+                                                                               \
+            if ((curr_orig > curr &&                                           \
+                 (curr_orig <= prev_elem || curr >= prev_elem)) ||             \
+                (curr_orig <= prev_elem && curr >= prev_elem)) {               \
+                                                                               \
+                mem[prev_elem] = mem[curr];                                    \
+                mem[curr].key = 0;                                             \
+                prev_elem = curr;                                              \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /*                                                                         \
+     * Deletes items 'fn' returns 'true' for. Pass starts after an empty slot  \
+     * and wraps around, backward shift only moves items within a cluster to   \
+     * the current position, so re-checking it visits each item once.          \
+     */                                                                        \
+    static uint32_t sc_map_sweep_##name(struct sc_map_item_##name *mem,        \
+                                        uint32_t cap,                          \
+                                        bool (*fn)(void *, K, V), void *arg)   \
+    {                                                                          \
+        uint32_t start = 0, i = 1, n = 0;                                      \
+        const uint32_t mod = cap - 1;                                          \
+                                                                               \
+        while (mem[start].key != 0) {                                          \
+            start++;                                                           \
+        }                                                                      \
+                                                                               \
+        while (i < cap) {                                                      \
+            uint32_t pos = (start + i) & mod;                                  \
+                                                                               \
+            if (mem[pos].key != 0 && fn(arg, mem[pos].key, mem[pos].value)) {  \
+                sc_map_erase_##name(mem, mod, pos);                            \
+                n++;                                                           \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            i++;                                                               \
+        }                                                                      \
+                                                                               \
+        return n;                                                              \
+    }                                                                          \
+    /*                                                                         \
+     * Moves up to 'n' slots of the old table into the current one. Old table  \
+     * stays a valid linear probing table, items are removed with backward     \
+     * shift. Slots behind the cursor are empty and nothing shifts into them,  \
+     * so a single forward pass moves everything.                              \
+     */                                                                        \
+    static void sc_map_migrate_##name(struct sc_map_##name *map, uint32_t n)   \
+    {                                                                          \
+        const uint32_t mod = map->cap - 1;                                     \
+        const uint32_t old_mod = map->old_cap - 1;                             \
+                                                                               \
+        while (n-- > 0 && map->migrated < map->old_cap) {                      \
+            if (map->old[map->migrated].key == 0) {                            \
+                map->migrated++;                                               \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            sc_map_insert_##name(map->mem, mod, &map->old[map->migrated]);     \
+            sc_map_erase_##name(map->old, old_mod, map->migrated);             \
+        }                                                                      \
+                                                                               \
+        if (map->migrated == map->old_cap) {                                   \
+            sc_map_dealloc_##name(map, map->old, map->old_cap);                \
+            map->old = NULL;                                                   \
+            map->old_cap = 0;                                                  \
+            map->migrated = 0;                                                 \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    void sc_map_set_incremental_##name(struct sc_map_##name *map, bool enable) \
+    {                                                                          \
+        if (!enable && map->old != NULL) {                                     \
+            sc_map_migrate_##name(map, UINT32_MAX);                            \
+        }                                                                      \
+                                                                               \
+        map->incremental = enable;                                             \
+    }                                                                          \
+                                                                               \
+    /* Smallest table which holds 'n' elements without a remap */              \
+    static bool sc_map_capof_##name(struct sc_map_##name *map, uint32_t n,     \
+                                    uint32_t *cap)                             \
+    {                                                                          \
+        uint64_t v = 8;                                                        \
+                                                                               \
+        while ((uint64_t)(v * ((double) map->load_factor / 100)) < n) {        \
+            v *= 2;                                                            \
+        }                                                                      \
+                                                                               \
+        if (v > SC_MAP_SIZE_MAX) {                                             \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        *cap = (uint32_t) v;                                                   \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    /* Moves all elements to a new table, 'cap' must be a power of two */      \
+    static bool sc_map_rehash_##name(struct sc_map_##name *map, uint32_t cap)  \
+    {                                                                          \
+        struct sc_map_item_##name *new;                                        \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, UINT32_MAX);                            \
+        }                                                                      \
+                                                                               \
+        new = sc_map_alloc_##name(map, &cap, 1);                               \
+        if (new == NULL) {                                                     \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (map->mem != sc_map_empty_##name.mem) {                             \
+            new[-1] = map->mem[-1];                                            \
+                                                                               \
+            for (uint32_t i = 0; i < map->cap; i++) {                          \
+                if (map->mem[i].key != 0) {                                    \
+                    sc_map_insert_##name(new, cap - 1, &map->mem[i]);          \
+                }                                                              \
+            }                                                                  \
+                                                                               \
+            sc_map_dealloc_##name(map, map->mem, map->cap);                    \
+        }                                                                      \
+                                                                               \
+        map->mem = new;                                                        \
+        map->cap = cap;                                                        \
+        map->remap = (uint32_t)(map->cap * ((double) map->load_factor / 100)); \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_reserve_##name(struct sc_map_##name *map, uint32_t n)          \
+    {                                                                          \
+        uint32_t cap;                                                          \
+                                                                               \
+        if (!sc_map_capof_##name(map, n, &cap)) {                              \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (cap <= map->cap) {                                                 \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        return sc_map_rehash_##name(map, cap);                                 \
+    }                                                                          \
+                                                                               \
+    bool sc_map_shrink_##name(struct sc_map_##name *map)                       \
+    {                                                                          \
+        uint32_t cap;                                                          \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, UINT32_MAX);                            \
+        }                                                                      \
+                                                                               \
+        if (map->size == 0) {                                                  \
+            if (map->mem != sc_map_empty_##name.mem) {                         \
+                sc_map_dealloc_##name(map, map->mem, map->cap);                \
+                map->mem = sc_map_empty_##name.mem;                            \
+                map->cap = sc_map_empty_##name.cap;                            \
+                map->remap = sc_map_empty_##name.remap;                        \
+                map->used = false;                                             \
+            }                                                                  \
+                                                                               \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (!sc_map_capof_##name(map, map->size, &cap) || cap >= map->cap) {   \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        return sc_map_rehash_##name(map, cap);                                 \
+    }                                                                          \
+                                                                               \
+    static bool sc_map_remap_##name(struct sc_map_##name *map)                 \
+    {                                                                          \
+        uint32_t cap;                                                          \
+        struct sc_map_item_##name *new;                                        \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, SC_MAP_MIGRATE);                        \
+        }                                                                      \
+                                                                               \
+        if (map->size < map->remap) {                                          \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        SC_STATS_ADD("map.remap", 1);                                          \
+                                                                               \
+        if (!map->incremental || map->mem == sc_map_empty_##name.mem) {        \
+            if (map->cap > SC_MAP_SIZE_MAX / 2) {                              \
+                return false;                                                  \
+            }                                                                  \
+                                                                               \
+            return sc_map_rehash_##name(map, map->cap * 2);                    \
+        }                                                                      \
+                                                                               \
+        /* Previous migration must be completed before the next one */         \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, UINT32_MAX);                            \
+        }                                                                      \
+                                                                               \
+        cap = map->cap;                                                        \
+        new = sc_map_alloc_##name(map, &cap, 2);                               \
+        if (new == NULL) {                                                     \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        new[-1] = map->mem[-1];                                                \
+                                                                               \
+        map->old = map->mem;                                                   \
+        map->old_cap = map->cap;                                               \
+        map->migrated = 0;                                                     \
+        map->mem = new;                                                        \
+        map->cap = cap;                                                        \
+        map->remap = (uint32_t)(map->cap * ((double) map->load_factor / 100)); \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_put_##name(struct sc_map_##name *map, K key, V value)          \
+    {                                                                          \
+        uint32_t pos, mod, hash, probe = 0;                                    \
+                                                                               \
+        if (!sc_map_remap_##name(map)) {                                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (key == 0) {                                                        \
+            map->size += !map->used;                                           \
+            map->used = true;                                                  \
+            map->mem[-1].value = value;                                        \
+                                                                               \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        hash = hash_fn(key);                                                   \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            pos = sc_map_find_##name(map->old, map->old_cap - 1, key, hash);   \
+            if (pos != UINT32_MAX) {                                           \
+                sc_map_assign_##name(&map->old[pos], key, value, hash);        \
+                return true;                                                   \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        mod = map->cap - 1;                                                    \
+        pos = hash & (mod);                                                    \
+                                                                               \
+        while (true) {                                                         \
+            if (map->mem[pos].key == 0) {                                      \
+                map->size++;                                                   \
+            } else if (sc_map_cmp_##name(&map->mem[pos], key, hash) != true) { \
+                pos = (pos + 1) & (mod);                                       \
+                probe++;                                                       \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            SC_STATS_ADD("map.lookup", 1);                                     \
+            SC_STATS_ADD("map.probe", probe);                                  \
+            SC_STATS_MAX("map.probe_max", probe);                              \
+                                                                               \
+            sc_map_assign_##name(&map->mem[pos], key, value, hash);            \
+            return true;                                                       \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static bool sc_map_probe_##name(struct sc_map_##name *map, K key,          \
+                                    uint32_t hash, V *value)                   \
+    {                                                                          \
+        uint32_t pos = sc_map_find_##name(map->mem, map->cap - 1, key, hash);  \
+                                                                               \
+        if (pos != UINT32_MAX) {                                               \
+            *value = map->mem[pos].value;                                      \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            pos = sc_map_find_##name(map->old, map->old_cap - 1, key, hash);   \
+            if (pos != UINT32_MAX) {                                           \
+                *value = map->old[pos].value;                                  \
+                return true;                                                   \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return false;                                                          \
+    }                                                                          \
+                                                                               \
+    bool sc_map_get_##name(struct sc_map_##name *map, K key, V *value)         \
+    {                                                                          \
+        if (key == 0) {                                                        \
+            *value = map->mem[-1].value;                                       \
+            return map->used;                                                  \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, SC_MAP_MIGRATE);                        \
+        }                                                                      \
+                                                                               \
+        return sc_map_probe_##name(map, key, hash_fn(key), value);             \
+    }                                                                          \
+                                                                               \
+    size_t sc_map_get_batch_##name(struct sc_map_##name *map, const K *keys,   \
+                                   V *values, bool *found, size_t n)           \
+    {                                                                          \
+        const uint32_t mod = map->cap - 1;                                     \
+        uint32_t hashes[SC_MAP_BATCH];                                         \
+        size_t len, count = 0;                                                 \
+                                                                               \
+        for (size_t i = 0; i < n; i += len) {                                  \
+            len = (n - i) < SC_MAP_BATCH ? (n - i) : SC_MAP_BATCH;             \
+                                                                               \
+            /* Hash the whole chunk and prefetch home buckets first */         \
+            for (size_t j = 0; j < len; j++) {                                 \
+                if (keys[i + j] != 0) {                                        \
+                    hashes[j] = hash_fn(keys[i + j]);                          \
+                    sc_map_prefetch(&map->mem[hashes[j] & mod]);               \
+                }                                                              \
+            }                                                                  \
+                                                                               \
+            for (size_t j = 0; j < len; j++) {                                 \
+                if (keys[i + j] == 0) {                                        \
+                    values[i + j] = map->mem[-1].value;                        \
+                    found[i + j] = map->used;                                  \
+                } else {                                                       \
+                    found[i + j] = sc_map_probe_##name(map, keys[i + j],       \
+                                                       hashes[j],              \
+                                                       &values[i + j]);        \
+                }                                                              \
+                                                                               \
+                count += found[i + j];                                         \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return count;                                                          \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_del_if_##name(struct sc_map_##name *map,                   \
+                                  bool (*fn)(void *arg, K key, V value),       \
+                                  void *arg)                                   \
+    {                                                                          \
+        uint32_t n = 0;                                                        \
+                                                                               \
+        if (map->used && fn(arg, 0, map->mem[-1].value)) {                     \
+            map->used = false;                                                 \
+            n++;                                                               \
+        }                                                                      \
+                                                                               \
+        n += sc_map_sweep_##name(map->mem, map->cap, fn, arg);                 \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            n += sc_map_sweep_##name(map->old, map->old_cap, fn, arg);         \
+        }                                                                      \
+                                                                               \
+        map->size -= n;                                                        \
+                                                                               \
+        return n;                                                              \
+    }                                                                          \
+                                                                               \
+    bool sc_map_del_##name(struct sc_map_##name *map, K key, V *value)         \
+    {                                                                          \
+        uint32_t pos, hash;                                                    \
+                                                                               \
+        if (key == 0) {                                                        \
+            bool ret = map->used;                                              \
+            map->size -= map->used;                                            \
+            map->used = false;                                                 \
+                                                                               \
+            if (value != NULL) {                                               \
+                *value = map->mem[-1].value;                                   \
+            }                                                                  \
+                                                                               \
+            return ret;                                                        \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, SC_MAP_MIGRATE);                        \
+        }                                                                      \
+                                                                               \
+        hash = hash_fn(key);                                                   \
+                                                                               \
+        pos = sc_map_find_##name(map->mem, map->cap - 1, key, hash);           \
+        if (pos != UINT32_MAX) {                                               \
+            if (value != NULL) {                                               \
+                *value = map->mem[pos].value;                                  \
+            }                                                                  \
+                                                                               \
+            map->size--;                                                       \
+            sc_map_erase_##name(map->mem, map->cap - 1, pos);                  \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            pos = sc_map_find_##name(map->old, map->old_cap - 1, key, hash);   \
+            if (pos != UINT32_MAX) {                                           \
+                if (value != NULL) {                                           \
+                    *value = map->old[pos].value;                              \
+                }                                                              \
+                                                                               \
+                map->size--;                                                   \
+                sc_map_erase_##name(map->old, map->old_cap - 1, pos);          \
+                return true;                                                   \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return false;                                                          \
+    }
+
+/**
+ * Snapshot definitions, must come after sc_map_impl_of_scalar() of the same
+ * map in the same .c file. 'hash_fn' must be the map's hash function.
+ */
+#define sc_map_impl_of_snapshot(name, K, V, hash_fn)                           \
+                                                                               \
+    bool sc_map_snapshot_write_##name(struct sc_map_##name *map, FILE *fp)     \
+    {                                                                          \
+        struct sc_map_snapshot_hdr h = {.magic = "sc_map"};                    \
+        size_t n = (size_t) map->cap + 1;                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, UINT32_MAX);                            \
+        }                                                                      \
+                                                                               \
+        h.byte_order = 0x01020304;                                             \
+        h.version = SC_MAP_SNAPSHOT_VERSION;                                   \
+        h.item_size = sizeof(*map->mem);                                       \
+        h.hash_check = hash_fn((K) 1);                                         \
+        h.cap = map->cap;                                                      \
+        h.size = map->size;                                                    \
+        h.used = map->used;                                                    \
+                                                                               \
+        if (fwrite(&h, sizeof(h), 1, fp) != 1 ||                               \
+            fwrite(&map->mem[-1], sizeof(*map->mem), n, fp) != n) {            \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_snapshot_open_##name(struct sc_map_snapshot_##name *s,         \
+                                     const void *data, size_t len)             \
+    {                                                                          \
+        const struct sc_map_snapshot_hdr *h = data;                            \
+        const struct sc_map_item_##name *mem;                                  \
+                                                                               \
+        if (len < sizeof(*h) || ((uintptr_t) data % 8) != 0) {                 \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (memcmp(h->magic, "sc_map", 7) != 0 ||                              \
+            h->byte_order != 0x01020304 ||                                     \
+            h->version != SC_MAP_SNAPSHOT_VERSION ||                           \
+            h->item_size != sizeof(*mem) || h->hash_check != hash_fn((K) 1)) { \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (h->cap == 0 || (h->cap & (h->cap - 1)) != 0 || h->size > h->cap || \
+            (len - sizeof(*h)) / sizeof(*mem) < (size_t) h->cap + 1) {         \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        mem = (const void *) (h + 1);                                          \
+                                                                               \
+        s->mem = &mem[1];                                                      \
+        s->cap = h->cap;                                                       \
+        s->size = h->size;                                                     \
+        s->used = h->used != 0;                                                \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_snapshot_get_##name(struct sc_map_snapshot_##name *s, K key,   \
+                                    V *val)                                    \
+    {                                                                          \
+        uint32_t pos, hash;                                                    \
+        struct sc_map_item_##name *mem = (void *) s->mem;                      \
+                                                                               \
+        if (key == 0) {                                                        \
+            *val = mem[-1].value;                                              \
+            return s->used;                                                    \
+        }                                                                      \
+                                                                               \
+        /* Probe is bounded, a corrupt image may not have an empty slot. */    \
+        hash = hash_fn(key);                                                   \
+        pos = hash & (s->cap - 1);                                             \
+                                                                               \
+        for (uint32_t i = 0; i < s->cap; i++) {                                \
+            if (mem[pos].key == 0) {                                           \
+                return false;                                                  \
+            }                                                                  \
+                                                                               \
+            if (sc_map_cmp_##name(&mem[pos], key, hash)) {                     \
+                *val = mem[pos].value;                                         \
+                return true;                                                   \
+            }                                                                  \
+                                                                               \
+            pos = (pos + 1) & (s->cap - 1);                                    \
+        }                                                                      \
+                                                                               \
+        return false;                                                          \
+    }
 
 // clang-format off
 
@@ -219,6 +1523,24 @@ sc_map_of_strkey(str, const char *, const char *)
 sc_map_of_strkey(sv,  const char *, void*)
 sc_map_of_strkey(s64, const char *, uint64_t)
 
+//                   name  key type      value type
+sc_map_of_simd_scalar(32,  uint32_t,     uint32_t)
+sc_map_of_simd_scalar(64,  uint64_t,     uint64_t)
+sc_map_of_simd_scalar(64v, uint64_t,     void *)
+sc_map_of_simd_scalar(64s, uint64_t,     const char *)
+sc_map_of_simd_strkey(str, const char *, const char *)
+sc_map_of_simd_strkey(sv,  const char *, void*)
+sc_map_of_simd_strkey(s64, const char *, uint64_t)
+
+//              name
+sc_map_of_lenkey(lstr, const char *)
+sc_map_of_lenkey(lsv,  void *)
+sc_map_of_lenkey(ls64, uint64_t)
+
+//                name
+sc_map_of_snapshot(32, uint32_t, uint32_t)
+sc_map_of_snapshot(64, uint64_t, uint64_t)
+
 // clang-format on
 
 #endif
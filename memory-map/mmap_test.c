@@ -5,7 +5,9 @@
 #include "sc_mmap.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
+#include <string.h>
 
 
 void test1()
@@ -54,6 +56,218 @@ void test1()
     assert(rc == 0);
 }
 
+void test_advise()
+{
+    int rc;
+    unsigned char *p;
+    struct sc_mmap mmap;
+
+    rc = sc_mmap_init(&mmap, "x.txt", O_RDWR | O_CREAT | O_TRUNC,
+                      PROT_READ | PROT_WRITE, MAP_SHARED | SC_MMAP_POPULATE,
+                      0, 64 * 1024);
+    assert(rc == 0);
+    p = mmap.ptr;
+    p[5000] = 'x';
+    rc = sc_mmap_msync(&mmap, 0, 64 * 1024);
+    assert(rc == 0);
+
+    rc = sc_mmap_advise(&mmap, 0, 64 * 1024, SC_MMAP_SEQUENTIAL);
+    assert(rc == 0);
+    rc = sc_mmap_advise(&mmap, 100, 10000, SC_MMAP_RANDOM | SC_MMAP_WILLNEED);
+    assert(rc == 0);
+    rc = sc_mmap_advise(&mmap, 0, 64 * 1024, SC_MMAP_NORMAL);
+    assert(rc == 0);
+
+    // Shared mapping, pages are read from the file again.
+    rc = sc_mmap_advise(&mmap, 4097, 8192, SC_MMAP_DONTNEED);
+    assert(rc == 0);
+    assert(p[5000] == 'x');
+
+    rc = sc_mmap_term(&mmap);
+    assert(rc == 0);
+}
+
+void test_grow()
+{
+    int rc;
+    unsigned char *p;
+    struct sc_mmap mmap, rd;
+
+    rc = sc_mmap_init(&mmap, "x.txt", O_RDWR | O_CREAT | O_TRUNC,
+                      PROT_READ | PROT_WRITE, MAP_SHARED, 0, 4096);
+    assert(rc == 0);
+    mmap.ptr[0] = 'a';
+    mmap.ptr[4095] = 'b';
+
+    rc = sc_mmap_grow(&mmap, 100);
+    assert(rc == 0);
+    assert(mmap.len == 4096);
+
+    // Without reservation, mapping may move.
+    rc = sc_mmap_grow(&mmap, 3 * 4096 + 10);
+    assert(rc == 0);
+    assert(mmap.len == 3 * 4096 + 10);
+    assert(mmap.ptr[0] == 'a' && mmap.ptr[4095] == 'b');
+    mmap.ptr[3 * 4096 + 9] = 'c';
+
+    // Reserved, pointer is stable.
+    rc = sc_mmap_reserve(&mmap, 1024 * 1024);
+    assert(rc == 0);
+    rc = sc_mmap_reserve(&mmap, 4096);
+    assert(rc == 0);
+    assert(mmap.cap == 1024 * 1024);
+    assert(mmap.ptr[0] == 'a' && mmap.ptr[3 * 4096 + 9] == 'c');
+    p = mmap.ptr;
+
+    for (size_t len = 8 * 4096; len <= 1024 * 1024; len += 8 * 4096) {
+        rc = sc_mmap_grow(&mmap, len);
+        assert(rc == 0);
+        assert(mmap.ptr == p);
+        assert(mmap.len == len);
+        mmap.ptr[len - 1] = 'd';
+    }
+
+    rc = sc_mmap_grow(&mmap, 1024 * 1024 + 1);
+    assert(rc == -1);
+    assert(strlen(sc_mmap_err(&mmap)) > 0);
+    assert(mmap.len == 1024 * 1024);
+
+    rc = sc_mmap_msync(&mmap, 0, mmap.len);
+    assert(rc == 0);
+
+    // Read-only mapping follows the file.
+    rc = sc_mmap_init(&rd, "x.txt", O_RDONLY, PROT_READ, MAP_SHARED, 0, 4096);
+    assert(rc == 0);
+    rc = sc_mmap_grow(&rd, 1024 * 1024);
+    assert(rc == 0);
+    assert(rd.ptr[0] == 'a' && rd.ptr[1024 * 1024 - 1] == 'd');
+    rc = sc_mmap_term(&rd);
+    assert(rc == 0);
+
+    rc = sc_mmap_term(&mmap);
+    assert(rc == 0);
+}
+
+#ifdef SC_MMAP_HAVE_THREAD
+
+#define FLUSH_THREADS 4
+#define FLUSH_WRITES  200
+#define FLUSH_RECORD  64
+
+struct flush_arg
+{
+    struct sc_mmap_flusher *f;
+    int id;
+};
+
+static void *flush_writer(void *arg)
+{
+    size_t off;
+    uint64_t ticket;
+    struct flush_arg *a = arg;
+
+    for (int i = 0; i < FLUSH_WRITES; i++) {
+        off = ((size_t) i * FLUSH_THREADS + (size_t) a->id) * FLUSH_RECORD;
+        memset(a->f->map->ptr + off, 'a' + a->id, FLUSH_RECORD);
+
+        ticket = sc_mmap_flusher_add(a->f, off, FLUSH_RECORD);
+        assert(ticket > 0);
+        assert(sc_mmap_flusher_wait(a->f, ticket) == 0);
+    }
+
+    return NULL;
+}
+
+static uint64_t flush_last;
+static int flush_count;
+
+static void flush_cb(void *arg, uint64_t ticket, int rc)
+{
+    (void) arg;
+    assert(rc == 0);
+    assert(ticket > flush_last);
+    flush_last = ticket;
+    flush_count++;
+}
+
+void test_flusher()
+{
+    int rc;
+    uint64_t ticket;
+    struct sc_mmap mmap, rd;
+    struct sc_mmap_flusher f;
+    struct sc_thread threads[FLUSH_THREADS];
+    struct flush_arg args[FLUSH_THREADS];
+    const size_t len = FLUSH_THREADS * FLUSH_WRITES * FLUSH_RECORD;
+
+    rc = sc_mmap_init(&mmap, "x.txt", O_RDWR | O_CREAT | O_TRUNC,
+                      PROT_READ | PROT_WRITE, MAP_SHARED, 0, len);
+    assert(rc == 0);
+
+    // Nothing to flush.
+    rc = sc_mmap_flusher_init(&f, &mmap, 10, NULL, NULL);
+    assert(rc == 0);
+    assert(sc_mmap_flusher_wait(&f, 100) == 0);
+    rc = sc_mmap_flusher_term(&f);
+    assert(rc == 0);
+
+    // Periodic, flushed on term.
+    rc = sc_mmap_flusher_init(&f, &mmap, 100000, NULL, NULL);
+    assert(rc == 0);
+    mmap.ptr[0] = 'x';
+    ticket = sc_mmap_flusher_add(&f, 0, 1);
+    assert(ticket == 1);
+    assert(sc_mmap_flusher_add(&f, 100, 0) == 2);
+    rc = sc_mmap_flusher_term(&f);
+    assert(rc == 0);
+    assert(f.flushed == 2);
+
+    // Concurrent writers, ranges are coalesced.
+    flush_last = 0;
+    flush_count = 0;
+
+    for (int k = 0; k < 2; k++) {
+        rc = sc_mmap_flusher_init(&f, &mmap, k == 0 ? 0 : 1, flush_cb, NULL);
+        assert(rc == 0);
+
+        for (int i = 0; i < FLUSH_THREADS; i++) {
+            args[i] = (struct flush_arg){.f = &f, .id = i};
+            sc_thread_init(&threads[i]);
+            rc = sc_thread_start(&threads[i], flush_writer, &args[i]);
+            assert(rc == 0);
+        }
+
+        for (int i = 0; i < FLUSH_THREADS; i++) {
+            rc = sc_thread_term(&threads[i]);
+            assert(rc == 0);
+        }
+
+        rc = sc_mmap_flusher_term(&f);
+        assert(rc == 0);
+        assert(f.flushed == FLUSH_THREADS * FLUSH_WRITES);
+        assert(flush_last == FLUSH_THREADS * FLUSH_WRITES);
+        assert(flush_count > 0 && flush_count <= FLUSH_THREADS * FLUSH_WRITES);
+        flush_last = 0;
+        flush_count = 0;
+    }
+
+    rc = sc_mmap_init(&rd, "x.txt", O_RDONLY, PROT_READ, MAP_SHARED, 0, 0);
+    assert(rc == 0);
+    for (size_t i = 0; i < len; i++) {
+        assert(rd.ptr[i] == 'a' + (int) ((i / FLUSH_RECORD) % FLUSH_THREADS));
+    }
+    rc = sc_mmap_term(&rd);
+    assert(rc == 0);
+
+    rc = sc_mmap_term(&mmap);
+    assert(rc == 0);
+}
+#else
+void test_flusher()
+{
+}
+#endif
+
 #ifdef SC_HAVE_WRAP
 
 bool fail_open;
@@ -118,6 +332,26 @@ int __wrap_msync (void *addr, size_t len, int flags) {
     return __real_msync(addr, len, flags);
 }
 
+bool fail_madvise;
+extern int __real_posix_madvise(void *addr, size_t len, int advice);
+int __wrap_posix_madvise(void *addr, size_t len, int advice) {
+    if (fail_madvise) {
+        return EINVAL;
+    }
+
+    return __real_posix_madvise(addr, len, advice);
+}
+
+extern int __real_madvise(void *addr, size_t len, int advice);
+int __wrap_madvise(void *addr, size_t len, int advice) {
+    if (fail_madvise) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return __real_madvise(addr, len, advice);
+}
+
 bool fail_munmap;
 extern int __real_munmap (void *addr, size_t len);
 int __wrap_munmap(void *addr, size_t len) {
@@ -189,8 +423,55 @@ void fail_test()
     rc = sc_mmap_msync(&mmap, 0, 4096);
     assert(rc == 0);
 
+    fail_mmap = true;
+    rc = sc_mmap_reserve(&mmap, 1024 * 1024);
+    assert(rc == -1);
+    fail_mmap = false;
+
+    fail_madvise = true;
+    rc = sc_mmap_advise(&mmap, 0, 4096, SC_MMAP_SEQUENTIAL);
+    assert(rc == -1);
+    assert(strlen(sc_mmap_err(&mmap)) > 0);
+    rc = sc_mmap_advise(&mmap, 0, 4096, SC_MMAP_DONTNEED);
+    assert(rc == -1);
+    fail_madvise = false;
+    rc = sc_mmap_advise(&mmap, 0, 4096, SC_MMAP_DONTNEED);
+    assert(rc == 0);
+
     rc = sc_mmap_term(&mmap);
     assert(rc == 0);
+
+#ifdef SC_MMAP_HAVE_THREAD
+    struct sc_mmap_flusher f;
+    uint64_t ticket;
+
+    rc = sc_mmap_init(&mmap, "x.txt", O_RDWR | O_CREAT | O_TRUNC,
+                      PROT_READ | PROT_WRITE, MAP_SHARED, 0, 8192);
+    assert(rc == 0);
+    rc = sc_mmap_flusher_init(&f, &mmap, 0, NULL, NULL);
+    assert(rc == 0);
+
+    // Failed range is retried with the next flush.
+    fail_msync = true;
+    ticket = sc_mmap_flusher_add(&f, 10, 100);
+    assert(sc_mmap_flusher_wait(&f, ticket) == -1);
+    assert(strlen(sc_mmap_flusher_err(&f)) > 0);
+    fail_msync = false;
+    ticket = sc_mmap_flusher_add(&f, 5000, 10);
+    assert(sc_mmap_flusher_wait(&f, ticket) == 0);
+    assert(sc_mmap_flusher_wait(&f, 1) == 0);
+
+    fail_msync = true;
+    sc_mmap_flusher_add(&f, 0, 10);
+    ticket = sc_mmap_flusher_add(&f, 20, 10);
+    assert(sc_mmap_flusher_wait(&f, ticket) == -1);
+    rc = sc_mmap_flusher_term(&f);
+    assert(rc == -1);
+    fail_msync = false;
+
+    rc = sc_mmap_term(&mmap);
+    assert(rc == 0);
+#endif
 }
 #else
 void fail_test()
@@ -202,6 +483,9 @@ void fail_test()
 int main()
 {
     test1();
+    test_advise();
+    test_grow();
+    test_flusher();
     fail_test();
 
     return 0;
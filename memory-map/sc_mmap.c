@@ -22,6 +22,10 @@
  * SOFTWARE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
 #ifndef _XOPEN_SOURCE
     #define _XOPEN_SOURCE 700
 #endif
@@ -106,6 +110,13 @@ int sc_mmap_init(struct sc_mmap *m, const char *name, int file_flags, int prot,
     m->fd = fd;
     m->ptr = p;
     m->len = len;
+    m->offset = offset;
+    m->prot = prot;
+    m->map_flags = map_flags;
+
+    if (map_flags & SC_MMAP_POPULATE) {
+        sc_mmap_advise(m, 0, len, SC_MMAP_WILLNEED);
+    }
 
     return 0;
 
@@ -161,6 +172,87 @@ int sc_mmap_munlock(struct sc_mmap *m, size_t offset, size_t len)
     return 0;
 }
 
+int sc_mmap_grow(struct sc_mmap *m, size_t len)
+{
+    HANDLE fm, h;
+    void *p;
+    const size_t max_size = m->offset + len;
+    const DWORD offset_low = (m->offset & 0xFFFFFFFFL);
+    const DWORD offset_high = ((uint64_t) m->offset >> 32) & 0xFFFFFFFFL;
+    const DWORD size_low = (max_size & 0xFFFFFFFFL);
+    const DWORD size_high = ((uint64_t) max_size >> 32) & 0xFFFFFFFFL;
+    const DWORD protect =
+            (m->prot & PROT_WRITE) ? PAGE_READWRITE : PAGE_READONLY;
+
+    if (len <= m->len) {
+        return 0;
+    }
+
+    h = (HANDLE) _get_osfhandle(m->fd);
+    if (h == INVALID_HANDLE_VALUE) {
+        goto error;
+    }
+
+    // Writable file mapping expands the file to 'max_size'.
+    fm = CreateFileMapping(h, NULL, protect, size_high, size_low, NULL);
+    if (fm == NULL) {
+        goto error;
+    }
+
+    p = MapViewOfFile(fm, m->prot, offset_high, offset_low, len);
+    CloseHandle(fm);
+
+    if (p == NULL) {
+        goto error;
+    }
+
+    UnmapViewOfFile(m->ptr);
+    m->ptr = p;
+    m->len = len;
+
+    return 0;
+
+error:
+    sc_mmap_errstr(m);
+    return -1;
+}
+
+int sc_mmap_reserve(struct sc_mmap *m, size_t cap)
+{
+    (void) cap;
+    strncpy(m->err, "Not supported", sizeof(m->err) - 1);
+
+    return -1;
+}
+
+int sc_mmap_advise(struct sc_mmap *m, size_t offset, size_t len, int advice)
+{
+    char *p = (char *) m->ptr + offset;
+
+    #if _WIN32_WINNT >= 0x0602
+    if (advice & SC_MMAP_WILLNEED) {
+        WIN32_MEMORY_RANGE_ENTRY range = {.VirtualAddress = p,
+                                          .NumberOfBytes = len};
+
+        if (!PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0)) {
+            sc_mmap_errstr(m);
+            return -1;
+        }
+    }
+    #endif
+
+    // Unlocking pages which are not locked removes them from the working set.
+    if (advice & SC_MMAP_DONTNEED) {
+        if (!VirtualUnlock((LPVOID) p, len) &&
+            GetLastError() != ERROR_NOT_LOCKED) {
+            sc_mmap_errstr(m);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 int sc_mmap_term(struct sc_mmap *m)
 {
     BOOL b;
@@ -242,6 +334,9 @@ int sc_mmap_init(struct sc_mmap *m, const char *name, int file_flags, int prot,
     m->fd = fd;
     m->ptr = p;
     m->len = len;
+    m->offset = offset;
+    m->prot = prot;
+    m->map_flags = map_flags;
 
     return 0;
 
@@ -261,7 +356,7 @@ int sc_mmap_term(struct sc_mmap *m)
 
     close(m->fd);
 
-    rc = munmap(m->ptr, m->len);
+    rc = munmap(m->ptr, m->cap > m->len ? m->cap : m->len);
     if (rc != 0) {
         strncpy(m->err, strerror(errno), sizeof(m->err) - 1);
     }
@@ -308,9 +403,396 @@ int sc_mmap_munlock(struct sc_mmap *m, size_t offset, size_t len)
     return rc;
 }
 
+static int sc_mmap_extend(int fd, size_t offset, size_t len)
+{
+    int rc;
+
+    #if defined(__APPLE__)
+    struct stat st;
+
+    rc = fstat(fd, &st);
+    if (rc != 0) {
+        return -1;
+    }
+
+    if ((size_t) st.st_size >= offset + len) {
+        return 0;
+    }
+
+    return ftruncate(fd, (off_t) (offset + len));
+    #else
+    do {
+        rc = posix_fallocate(fd, (off_t) offset, (off_t) len);
+    } while (rc == EINTR);
+
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+
+    return 0;
+    #endif
+}
+
+int sc_mmap_grow(struct sc_mmap *m, size_t len)
+{
+    int rc;
+    void *p;
+
+    if (len <= m->len) {
+        return 0;
+    }
+
+    if (m->prot & PROT_WRITE) {
+        rc = sc_mmap_extend(m->fd, m->offset + m->len, len - m->len);
+        if (rc != 0) {
+            goto error;
+        }
+    }
+
+    // Reserved range is already mapped, new pages are valid once the file
+    // covers them.
+    if (len <= m->cap) {
+        m->len = len;
+        return 0;
+    }
+
+    if (m->cap != 0) {
+        strncpy(m->err, "Exceeds reserved length", sizeof(m->err) - 1);
+        return -1;
+    }
+
+    #if defined(__linux__)
+    p = mremap(m->ptr, m->len, len, MREMAP_MAYMOVE);
+    if (p == MAP_FAILED) {
+        goto error;
+    }
+    #else
+    p = mmap(NULL, len, m->prot, m->map_flags, m->fd, (off_t) m->offset);
+    if (p == MAP_FAILED) {
+        goto error;
+    }
+    munmap(m->ptr, m->len);
+    #endif
+
+    m->ptr = p;
+    m->len = len;
+
+    return 0;
+
+error:
+    strncpy(m->err, strerror(errno), sizeof(m->err) - 1);
+    return -1;
+}
+
+int sc_mmap_reserve(struct sc_mmap *m, size_t cap)
+{
+    void *p;
+    const size_t prev = m->cap > m->len ? m->cap : m->len;
+
+    if (cap <= prev) {
+        return 0;
+    }
+
+    // Mapping beyond the end of file is valid, only access to those pages
+    // fails. Don't prefault the whole range.
+    p = mmap(NULL, cap, m->prot, m->map_flags & ~SC_MMAP_POPULATE, m->fd,
+             (off_t) m->offset);
+    if (p == MAP_FAILED) {
+        strncpy(m->err, strerror(errno), sizeof(m->err) - 1);
+        return -1;
+    }
+
+    munmap(m->ptr, prev);
+    m->ptr = p;
+    m->cap = cap;
+
+    return 0;
+}
+
+int sc_mmap_advise(struct sc_mmap *m, size_t offset, size_t len, int advice)
+{
+    int rc = 0;
+    char *p;
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t start = offset - (offset % page);
+
+    p = (char *) m->ptr + start;
+    len += offset - start;
+
+    if (advice == SC_MMAP_NORMAL) {
+        rc = posix_madvise(p, len, POSIX_MADV_NORMAL);
+    }
+
+    if (rc == 0 && (advice & SC_MMAP_SEQUENTIAL)) {
+        rc = posix_madvise(p, len, POSIX_MADV_SEQUENTIAL);
+    }
+
+    if (rc == 0 && (advice & SC_MMAP_RANDOM)) {
+        rc = posix_madvise(p, len, POSIX_MADV_RANDOM);
+    }
+
+    if (rc == 0 && (advice & SC_MMAP_WILLNEED)) {
+        rc = posix_madvise(p, len, POSIX_MADV_WILLNEED);
+    }
+
+    // posix_madvise(POSIX_MADV_DONTNEED) is a no-op on glibc.
+    if (rc == 0 && (advice & SC_MMAP_DONTNEED)) {
+    #if defined(__linux__)
+        rc = madvise(p, len, MADV_DONTNEED) == 0 ? 0 : errno;
+    #else
+        rc = posix_madvise(p, len, POSIX_MADV_DONTNEED);
+    #endif
+    }
+
+    #if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (rc == 0 && (advice & SC_MMAP_HUGEPAGE)) {
+        rc = madvise(p, len, MADV_HUGEPAGE) == 0 ? 0 : errno;
+    }
+    #endif
+
+    if (rc != 0) {
+        strncpy(m->err, strerror(rc), sizeof(m->err) - 1);
+        return -1;
+    }
+
+    return 0;
+}
+
 const char *sc_mmap_err(struct sc_mmap *m)
 {
     return m->err;
 }
 
 #endif
+
+#ifdef SC_MMAP_HAVE_THREAD
+
+// Each waiter has its own condition on its stack, so a wake-up sent before
+// the waiter blocks is not lost.
+struct sc_mmap_waiter
+{
+    struct sc_cond cond;
+    uint64_t ticket;
+    int rc;
+    struct sc_mmap_waiter *next;
+};
+
+static size_t sc_mmap_page(void)
+{
+    #if defined(_WIN32)
+    return 1;
+    #else
+    return (size_t) sysconf(_SC_PAGESIZE);
+    #endif
+}
+
+// Wakes up waiters of tickets up to 'ticket'. Called with the lock held.
+static void sc_mmap_flusher_notify(struct sc_mmap_flusher *f, uint64_t ticket,
+                                   int rc)
+{
+    struct sc_mmap_waiter **p = &f->waiters;
+    struct sc_mmap_waiter *w;
+
+    while (*p != NULL) {
+        w = *p;
+        if (w->ticket > ticket) {
+            p = &w->next;
+            continue;
+        }
+
+        *p = w->next;
+        w->rc = rc;
+        sc_cond_signal(&w->cond, NULL);
+    }
+}
+
+static void *sc_mmap_flusher_run(void *arg)
+{
+    int rc;
+    bool stop;
+    size_t lo, hi, start;
+    uint64_t ticket;
+    struct sc_mmap_flusher *f = arg;
+    const size_t page = sc_mmap_page();
+
+    while (true) {
+        sc_mutex_lock(&f->mtx);
+        stop = f->stop;
+        sc_mutex_unlock(&f->mtx);
+
+        if (!stop) {
+            if (f->interval == 0) {
+                sc_cond_wait(&f->wake);
+            } else {
+                sc_cond_wait_timeout(&f->wake, f->interval, NULL);
+            }
+        }
+
+        sc_mutex_lock(&f->mtx);
+        stop = f->stop;
+        lo = f->lo;
+        hi = f->hi;
+        ticket = f->seq;
+        f->lo = SIZE_MAX;
+        f->hi = 0;
+        sc_mutex_unlock(&f->mtx);
+
+        if (ticket == f->flushed) {
+            if (stop) {
+                break;
+            }
+            continue;
+        }
+
+        rc = 0;
+        if (lo < hi) {
+            start = lo - (lo % page);
+            rc = sc_mmap_msync(f->map, start, hi - start);
+        }
+
+        sc_mutex_lock(&f->mtx);
+        if (rc == 0) {
+            f->flushed = ticket;
+        } else {
+            // Retry on the next interval.
+            f->failed = ticket;
+            strncpy(f->err, f->map->err, sizeof(f->err) - 1);
+            f->lo = f->lo < lo ? f->lo : lo;
+            f->hi = f->hi > hi ? f->hi : hi;
+        }
+        sc_mmap_flusher_notify(f, ticket, rc);
+        sc_mutex_unlock(&f->mtx);
+
+        if (f->cb) {
+            f->cb(f->arg, ticket, rc);
+        }
+
+        if (stop) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+int sc_mmap_flusher_init(struct sc_mmap_flusher *f, struct sc_mmap *m,
+                         uint32_t interval,
+                         void (*cb)(void *arg, uint64_t ticket, int rc),
+                         void *arg)
+{
+    *f = (struct sc_mmap_flusher){
+            .map = m,
+            .cb = cb,
+            .arg = arg,
+            .lo = SIZE_MAX,
+            .interval = interval,
+    };
+
+    if (sc_mutex_init(&f->mtx) != 0) {
+        strncpy(f->err, "Failed to create mutex", sizeof(f->err) - 1);
+        return -1;
+    }
+
+    if (sc_cond_init(&f->wake) != 0) {
+        strncpy(f->err, "Failed to create condition", sizeof(f->err) - 1);
+        goto err_cond;
+    }
+
+    sc_thread_init(&f->thread);
+    if (sc_thread_start(&f->thread, sc_mmap_flusher_run, f) != 0) {
+        strncpy(f->err, sc_thread_err(&f->thread), sizeof(f->err) - 1);
+        goto err_thread;
+    }
+
+    return 0;
+
+err_thread:
+    sc_thread_term(&f->thread);
+    sc_cond_term(&f->wake);
+err_cond:
+    sc_mutex_term(&f->mtx);
+    return -1;
+}
+
+int sc_mmap_flusher_term(struct sc_mmap_flusher *f)
+{
+    int rc;
+
+    sc_mutex_lock(&f->mtx);
+    f->stop = true;
+    sc_mutex_unlock(&f->mtx);
+
+    sc_cond_signal(&f->wake, NULL);
+    sc_thread_term(&f->thread);
+
+    rc = f->flushed == f->seq ? 0 : -1;
+    sc_mmap_flusher_notify(f, UINT64_MAX, -1);
+
+    sc_cond_term(&f->wake);
+    sc_mutex_term(&f->mtx);
+
+    return rc;
+}
+
+uint64_t sc_mmap_flusher_add(struct sc_mmap_flusher *f, size_t offset,
+                             size_t len)
+{
+    uint64_t ticket;
+
+    sc_mutex_lock(&f->mtx);
+    if (len > 0) {
+        f->lo = f->lo < offset ? f->lo : offset;
+        f->hi = f->hi > offset + len ? f->hi : offset + len;
+    }
+    ticket = ++f->seq;
+    sc_mutex_unlock(&f->mtx);
+
+    if (f->interval == 0) {
+        sc_cond_signal(&f->wake, NULL);
+    }
+
+    return ticket;
+}
+
+int sc_mmap_flusher_wait(struct sc_mmap_flusher *f, uint64_t ticket)
+{
+    struct sc_mmap_waiter w = {.ticket = ticket};
+
+    sc_mutex_lock(&f->mtx);
+    if (ticket > f->seq) {
+        w.ticket = f->seq;
+    }
+
+    if (w.ticket <= f->flushed) {
+        sc_mutex_unlock(&f->mtx);
+        return 0;
+    }
+
+    if (w.ticket <= f->failed) {
+        sc_mutex_unlock(&f->mtx);
+        return -1;
+    }
+
+    if (sc_cond_init(&w.cond) != 0) {
+        strncpy(f->err, "Failed to create condition", sizeof(f->err) - 1);
+        sc_mutex_unlock(&f->mtx);
+        return -1;
+    }
+
+    w.next = f->waiters;
+    f->waiters = &w;
+    sc_mutex_unlock(&f->mtx);
+
+    sc_cond_wait(&w.cond);
+    sc_cond_term(&w.cond);
+
+    return w.rc;
+}
+
+const char *sc_mmap_flusher_err(struct sc_mmap_flusher *f)
+{
+    return f->err;
+}
+
+#endif
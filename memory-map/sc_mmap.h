@@ -27,6 +27,7 @@
 
 #include <fcntl.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #if defined(_WIN32)
@@ -42,17 +43,42 @@
 #define MAP_ANONYMOUS 0x02
 #define MAP_SHARED    0x04
 
+#define SC_MMAP_POPULATE 0x08
+#define SC_MMAP_HUGETLB  0x10
+
 #else /*POSIX*/
 
 #include <sys/mman.h>
 
+#if defined(__linux__)
+#include <linux/mman.h>
+
+#define SC_MMAP_POPULATE MAP_POPULATE
+#define SC_MMAP_HUGETLB  MAP_HUGETLB
+#else
+#define SC_MMAP_POPULATE 0
+#define SC_MMAP_HUGETLB  0
+#endif
+
 #endif
 
+// Flags for sc_mmap_advise()
+#define SC_MMAP_NORMAL     0x00
+#define SC_MMAP_SEQUENTIAL 0x01
+#define SC_MMAP_RANDOM     0x02
+#define SC_MMAP_WILLNEED   0x04
+#define SC_MMAP_DONTNEED   0x08
+#define SC_MMAP_HUGEPAGE   0x10
+
 struct sc_mmap
 {
     int fd;
     unsigned char* ptr; // memory map start address
     size_t len;         // memory map length
+    size_t cap;         // reserved length, see sc_mmap_reserve()
+    size_t offset;
+    int prot;
+    int map_flags;
     char err[128];
 };
 
@@ -66,6 +92,10 @@ struct sc_mmap
  * @param file_flags  flags for open(), e.g : O_RDWR | O_CREAT
  * @param prot        prot flags,       e.g : PROT_READ | PROT_WRITE
  * @param map_flags   mmap flags,       e.g : MAP_SHARED
+ *                    SC_MMAP_POPULATE : prefault pages, file is read ahead
+ *                                       before this function returns.
+ *                    SC_MMAP_HUGETLB  : huge pages, Linux only, file must be
+ *                                       on hugetlbfs.
  * @param offset      offset
  * @param len         len
  * @return            '0' on success, negative on failure,
@@ -106,11 +136,161 @@ int sc_mmap_mlock(struct sc_mmap* m, size_t offset, size_t len);
  */
 int sc_mmap_munlock(struct sc_mmap* m, size_t offset, size_t len);
 
+/**
+ * Grow the mapping to 'len' bytes, file is expanded if the mapping is
+ * writable. A read-only mapping can grow up to the file size, e.g to follow
+ * a file written by another process.
+ *
+ * If 'len' is not larger than the reserved length, see sc_mmap_reserve(),
+ * 'm->ptr' does not change and pointers into the mapping stay valid.
+ * Otherwise, the mapping may move, on Linux with mremap(), elsewhere by
+ * mapping the file again.
+ *
+ * @param m   mmap
+ * @param len new length
+ * @return    '0' on success, negative on failure,
+ *            call sc_mmap_err() for error string.
+ */
+int sc_mmap_grow(struct sc_mmap *m, size_t len);
+
+/**
+ * Reserve address space, so the mapping can grow up to 'cap' bytes without
+ * moving. The file is mapped again with 'cap' length, 'm->ptr' changes once
+ * in this call. Pages beyond the file size must not be accessed until
+ * sc_mmap_grow() covers them. Modifications to MAP_PRIVATE mappings are lost.
+ * Not supported on Windows.
+ *
+ * e.g reserve 64 GB for a log file, then grow it 64 MB at a time.
+ *
+ * @param m   mmap
+ * @param cap reserved length
+ * @return    '0' on success, negative on failure,
+ *            call sc_mmap_err() for error string.
+ */
+int sc_mmap_reserve(struct sc_mmap *m, size_t cap);
+
+/**
+ * Give the kernel a hint about the access pattern of a range, e.g to read
+ * ahead a region which will be scanned sequentially. 'offset' is rounded down
+ * to the page size. Maps to madvise() on POSIX. On Windows, SC_MMAP_WILLNEED
+ * maps to PrefetchVirtualMemory(), SC_MMAP_DONTNEED drops the pages from the
+ * working set and the other flags are ignored.
+ *
+ * @param m      mmap
+ * @param offset offset
+ * @param len    len
+ * @param advice SC_MMAP_NORMAL, or combination of SC_MMAP_SEQUENTIAL or
+ *               SC_MMAP_RANDOM, SC_MMAP_WILLNEED, SC_MMAP_DONTNEED,
+ *               SC_MMAP_HUGEPAGE (transparent huge pages, Linux only).
+ * @return       '0' on success, negative on failure,
+ *               call sc_mmap_err() for error string.
+ */
+int sc_mmap_advise(struct sc_mmap *m, size_t offset, size_t len, int advice);
+
 /**
  * @param m mmap
  * @return  last error string.
  */
 const char *sc_mmap_err(struct sc_mmap *m);
 
+#ifdef SC_MMAP_HAVE_THREAD
+
+#include "sc_cond.h"
+#include "sc_mutex.h"
+#include "sc_thread.h"
+
+/**
+ * Background flusher, batches durability requests of many threads into a
+ * single msync() of the mapping per interval, e.g group commit for records
+ * written into a mapped file.
+ *
+ * Writers copy data into the mapping, register the dirty range with
+ * sc_mmap_flusher_add() and get a ticket. Dirty ranges are coalesced, the
+ * flusher thread wakes up every 'interval' milliseconds and syncs the union
+ * of the ranges registered since the last flush. sc_mmap_flusher_wait()
+ * blocks until a ticket is durable, the callback is called after each flush
+ * from the flusher thread.
+ *
+ * Requires sc_thread, sc_mutex and sc_cond, compile with
+ * -DSC_MMAP_HAVE_THREAD. The mapping must not be moved, e.g by sc_mmap_grow()
+ * beyond the reserved length, or terminated while the flusher is running.
+ */
+struct sc_mmap_flusher
+{
+    struct sc_mmap *map;
+    struct sc_thread thread;
+    struct sc_mutex mtx;
+    struct sc_cond wake;
+    struct sc_mmap_waiter *waiters;
+    void (*cb)(void *arg, uint64_t ticket, int rc);
+    void *arg;
+    size_t lo;           // coalesced dirty range [lo, hi)
+    size_t hi;
+    uint64_t seq;        // last ticket
+    uint64_t flushed;    // tickets up to this one are durable
+    uint64_t failed;     // last ticket of the last failed flush
+    uint32_t interval;
+    bool stop;
+    char err[128];
+};
+
+/**
+ * Start the flusher thread.
+ *
+ * @param f        flusher
+ * @param m        mmap
+ * @param interval flush interval in milliseconds, '0' flushes as soon as a
+ *                 range is added, ranges added during a flush are batched
+ *                 into the next one.
+ * @param cb       called with the last flushed ticket and '0' or '-1' after
+ *                 each flush, from the flusher thread, NULL for none.
+ * @param arg      user data for the callback
+ * @return         '0' on success, negative on failure,
+ *                 call sc_mmap_flusher_err() for error string.
+ */
+int sc_mmap_flusher_init(struct sc_mmap_flusher *f, struct sc_mmap *m,
+                         uint32_t interval,
+                         void (*cb)(void *arg, uint64_t ticket, int rc),
+                         void *arg);
+
+/**
+ * Flush pending ranges and stop the flusher thread.
+ *
+ * @param f flusher
+ * @return  '0' on success, negative if the last flush failed,
+ *          call sc_mmap_flusher_err() for error string.
+ */
+int sc_mmap_flusher_term(struct sc_mmap_flusher *f);
+
+/**
+ * Register a modified range of the mapping, thread-safe.
+ *
+ * @param f      flusher
+ * @param offset offset
+ * @param len    len
+ * @return       ticket, pass to sc_mmap_flusher_wait() to wait until the
+ *               range is durable.
+ */
+uint64_t sc_mmap_flusher_add(struct sc_mmap_flusher *f, size_t offset,
+                             size_t len);
+
+/**
+ * Block until the range of the ticket is flushed, thread-safe. Ranges which
+ * failed to flush are retried with the next flush.
+ *
+ * @param f      flusher
+ * @param ticket ticket from sc_mmap_flusher_add()
+ * @return       '0' on success, negative if the flush of the ticket failed,
+ *               call sc_mmap_flusher_err() for error string.
+ */
+int sc_mmap_flusher_wait(struct sc_mmap_flusher *f, uint64_t ticket);
+
+/**
+ * @param f flusher
+ * @return  last error string.
+ */
+const char *sc_mmap_flusher_err(struct sc_mmap_flusher *f);
+
+#endif
 
 #endif
@@ -3,6 +3,8 @@
 int main()
 {
     struct sc_mutex mutex;
+    struct sc_amutex amutex;
+    struct sc_rwlock rw;
 
     sc_mutex_init(&mutex);
 
@@ -11,5 +13,17 @@ int main()
 
     sc_mutex_term(&mutex);
 
+    sc_amutex_init(&amutex);
+    sc_amutex_lock(&amutex);
+    sc_amutex_unlock(&amutex);
+    sc_amutex_term(&amutex);
+
+    sc_rwlock_init(&rw);
+    sc_rwlock_lock_read(&rw);
+    sc_rwlock_unlock_read(&rw);
+    sc_rwlock_lock_write(&rw);
+    sc_rwlock_unlock_write(&rw);
+    sc_rwlock_term(&rw);
+
     return 0;
 }
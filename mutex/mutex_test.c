@@ -23,10 +23,14 @@
  */
 
 #include "sc_mutex.h"
+#include "sc_thread.h"
 
 #include <assert.h>
 #include <stdbool.h>
 
+#define THREADS 8
+#define COUNT   100000
+
 #ifdef SC_HAVE_WRAP
 bool mock_attrinit = false;
 extern int __real_pthread_mutexattr_init(pthread_mutexattr_t *attr);
@@ -65,6 +69,167 @@ int __wrap_pthread_mutex_init(pthread_mutex_t *__mutex,
 
 #endif
 
+struct shared
+{
+    struct sc_mutex lock;
+    struct sc_mutex_cond cond;
+    uint64_t turn;
+    struct sc_amutex mtx;
+    struct sc_rwlock rw;
+    uint64_t counter;
+    uint64_t a;
+    uint64_t b;
+};
+
+static void *amutex_fn(void *arg)
+{
+    struct shared *s = arg;
+
+    for (int i = 0; i < COUNT; i++) {
+        sc_amutex_lock(&s->mtx);
+        s->counter++;
+        sc_amutex_unlock(&s->mtx);
+    }
+
+    return NULL;
+}
+
+void test_amutex(void)
+{
+    struct shared s = {0};
+    struct sc_thread threads[THREADS];
+
+    assert(sc_amutex_init(&s.mtx) == 0);
+    assert(sc_amutex_trylock(&s.mtx) == 1);
+    assert(sc_amutex_trylock(&s.mtx) == 0);
+    assert(sc_amutex_term(&s.mtx) == -1);
+    sc_amutex_unlock(&s.mtx);
+
+    for (int i = 0; i < THREADS; i++) {
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], amutex_fn, &s) == 0);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    assert(s.counter == (uint64_t) THREADS * COUNT);
+    assert(sc_amutex_term(&s.mtx) == 0);
+}
+
+// Writers keep 'a' and 'b' equal, readers must never see them differ.
+static void *writer_fn(void *arg)
+{
+    struct shared *s = arg;
+
+    for (int i = 0; i < COUNT / 10; i++) {
+        sc_rwlock_lock_write(&s->rw);
+        s->a++;
+        s->b++;
+        s->counter++;
+        sc_rwlock_unlock_write(&s->rw);
+    }
+
+    return NULL;
+}
+
+static void *reader_fn(void *arg)
+{
+    struct shared *s = arg;
+
+    for (int i = 0; i < COUNT; i++) {
+        sc_rwlock_lock_read(&s->rw);
+        assert(s->a == s->b);
+        sc_rwlock_unlock_read(&s->rw);
+    }
+
+    return NULL;
+}
+
+void test_rwlock(void)
+{
+    struct shared s = {0};
+    struct sc_thread threads[THREADS];
+
+    assert(sc_rwlock_init(&s.rw) == 0);
+
+    // Readers don't block each other.
+    sc_rwlock_lock_read(&s.rw);
+    sc_rwlock_lock_read(&s.rw);
+    assert(sc_rwlock_term(&s.rw) == -1);
+    sc_rwlock_unlock_read(&s.rw);
+    sc_rwlock_unlock_read(&s.rw);
+    sc_rwlock_lock_write(&s.rw);
+    sc_rwlock_unlock_write(&s.rw);
+    assert(sc_rwlock_term(&s.rw) == 0);
+
+    assert(sc_rwlock_init(&s.rw) == 0);
+
+    for (int i = 0; i < THREADS; i++) {
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], i % 4 == 0 ? writer_fn : reader_fn,
+                               &s) == 0);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    assert(s.counter == (uint64_t) (THREADS / 4) * (COUNT / 10));
+    assert(s.a == s.counter && s.b == s.counter);
+    assert(sc_rwlock_term(&s.rw) == 0);
+}
+
+// Threads take turns, each waits until 'turn' selects it.
+static void *cond_fn(void *arg)
+{
+    struct shared *s = arg;
+    uint64_t id;
+
+    sc_mutex_lock(&s->lock);
+    id = s->counter++;
+    sc_mutex_unlock(&s->lock);
+
+    for (int i = 0; i < COUNT / 100; i++) {
+        sc_mutex_lock(&s->lock);
+        while (s->turn % THREADS != id) {
+            sc_mutex_cond_wait(&s->cond, &s->lock);
+        }
+        s->turn++;
+        sc_mutex_cond_broadcast(&s->cond);
+        sc_mutex_unlock(&s->lock);
+    }
+
+    return NULL;
+}
+
+void test_cond(void)
+{
+    struct shared s = {0};
+    struct sc_thread threads[THREADS];
+
+    assert(sc_mutex_init(&s.lock) == 0);
+    assert(sc_mutex_cond_init(&s.cond) == 0);
+
+    // Nobody is waiting, signals are no-op.
+    sc_mutex_cond_signal(&s.cond);
+    sc_mutex_cond_broadcast(&s.cond);
+
+    for (int i = 0; i < THREADS; i++) {
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], cond_fn, &s) == 0);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    assert(s.turn == (uint64_t) THREADS * (COUNT / 100));
+    assert(sc_mutex_cond_term(&s.cond) == 0);
+    assert(sc_mutex_term(&s.lock) == 0);
+}
+
 int main()
 {
     struct sc_mutex mutex;
@@ -87,5 +252,9 @@ int main()
     sc_mutex_unlock(&mutex);
     assert(sc_mutex_term(&mutex) == 0);
 
+    test_cond();
+    test_amutex();
+    test_rwlock();
+
     return 0;
 }
@@ -21,6 +21,10 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+    #define _DEFAULT_SOURCE
+#endif
+
 #ifndef _XOPEN_SOURCE
     #define _XOPEN_SOURCE 700
 #endif
@@ -28,6 +32,8 @@
 #include "sc_mutex.h"
 
 #include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
 
 #if defined(_WIN32) || defined(_WIN64)
 
@@ -53,6 +59,36 @@ void sc_mutex_unlock(struct sc_mutex *mtx)
     LeaveCriticalSection(&mtx->mtx);
 }
 
+int sc_mutex_cond_init(struct sc_mutex_cond *cond)
+{
+    InitializeConditionVariable(&cond->cond);
+    return 0;
+}
+
+int sc_mutex_cond_term(struct sc_mutex_cond *cond)
+{
+    (void) cond;
+    return 0;
+}
+
+void sc_mutex_cond_wait(struct sc_mutex_cond *cond, struct sc_mutex *mtx)
+{
+    BOOL rc;
+
+    rc = SleepConditionVariableCS(&cond->cond, &mtx->mtx, INFINITE);
+    assert(rc != 0);
+}
+
+void sc_mutex_cond_signal(struct sc_mutex_cond *cond)
+{
+    WakeConditionVariable(&cond->cond);
+}
+
+void sc_mutex_cond_broadcast(struct sc_mutex_cond *cond)
+{
+    WakeAllConditionVariable(&cond->cond);
+}
+
 #else
 
 int sc_mutex_init(struct sc_mutex *mtx)
@@ -109,4 +145,367 @@ void sc_mutex_unlock(struct sc_mutex *mtx)
     assert(rc == 0);
 }
 
+int sc_mutex_cond_init(struct sc_mutex_cond *cond)
+{
+    int rc;
+
+    // May fail on OOM
+    rc = pthread_cond_init(&cond->cond, NULL);
+    return rc != 0 ? -1 : 0;
+}
+
+int sc_mutex_cond_term(struct sc_mutex_cond *cond)
+{
+    int rc;
+
+    rc = pthread_cond_destroy(&cond->cond);
+    return rc != 0 ? -1 : 0;
+}
+
+void sc_mutex_cond_wait(struct sc_mutex_cond *cond, struct sc_mutex *mtx)
+{
+    int rc;
+
+    // This won't fail as long as we pass correct params.
+    rc = pthread_cond_wait(&cond->cond, &mtx->mtx);
+    assert(rc == 0);
+}
+
+void sc_mutex_cond_signal(struct sc_mutex_cond *cond)
+{
+    int rc;
+
+    rc = pthread_cond_signal(&cond->cond);
+    assert(rc == 0);
+}
+
+void sc_mutex_cond_broadcast(struct sc_mutex_cond *cond)
+{
+    int rc;
+
+    rc = pthread_cond_broadcast(&cond->cond);
+    assert(rc == 0);
+}
+
+#endif
+
+#if defined(_MSC_VER)
+    #pragma comment(lib, "Synchronization.lib")
+
+    #define sc_mutex_load(p) (*(volatile uint32_t *) (p))
+    #define sc_mutex_cas(p, old, v)                                            \
+        (InterlockedCompareExchange((LONG *) (p), (LONG) (v), (LONG) (old)) == \
+         (LONG) (old))
+    #define sc_mutex_xchg(p, v)                                                \
+        ((uint32_t) InterlockedExchange((LONG *) (p), (LONG) (v)))
+    #define sc_mutex_sub(p, v)                                                 \
+        ((uint32_t) InterlockedExchangeAdd((LONG *) (p), -(LONG) (v)) - (v))
+    #define sc_mutex_pause() YieldProcessor()
+#else
+    #define sc_mutex_load(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_mutex_cas(p, old, v)                                            \
+        __atomic_compare_exchange_n(p, &(uint32_t){old}, v, false,             \
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+    #define sc_mutex_xchg(p, v) __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL)
+    #define sc_mutex_sub(p, v)  __atomic_sub_fetch(p, v, __ATOMIC_RELEASE)
+
+    #if defined(__x86_64__) || defined(__i386__)
+        #define sc_mutex_pause() __builtin_ia32_pause()
+    #elif defined(__aarch64__)
+        #define sc_mutex_pause() __asm__ __volatile__("yield")
+    #else
+        #define sc_mutex_pause()
+    #endif
+#endif
+
+/**
+ * Park/unpark on a 32-bit word. sc_mutex_wait() sleeps if '*addr' is still
+ * equal to 'val', it may return spuriously, callers check the word again.
+ */
+#if defined(_WIN32) || defined(_WIN64)
+
+static void sc_mutex_yield(void)
+{
+    SwitchToThread();
+}
+
+static void sc_mutex_wait(uint32_t *addr, uint32_t val)
+{
+    WaitOnAddress(addr, &val, sizeof(val), INFINITE);
+}
+
+static void sc_mutex_wake(uint32_t *addr)
+{
+    WakeByAddressAll(addr);
+}
+
+static void sc_mutex_wake_one(uint32_t *addr)
+{
+    WakeByAddressSingle(addr);
+}
+
+#elif defined(__linux__)
+
+    #include <linux/futex.h>
+    #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+static void sc_mutex_yield(void)
+{
+    sched_yield();
+}
+
+static void sc_mutex_wait(uint32_t *addr, uint32_t val)
+{
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static void sc_mutex_wake(uint32_t *addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static void sc_mutex_wake_one(uint32_t *addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+#else
+
+    #include <sched.h>
+
+// Parking table, waiters sleep on a cond chosen by address hash.
+    #define SC_MUTEX_BUCKETS 64
+
+struct sc_mutex_bucket
+{
+    pthread_mutex_t mtx;
+    pthread_cond_t cond;
+};
+
+static struct sc_mutex_bucket sc_mutex_buckets[SC_MUTEX_BUCKETS];
+static pthread_once_t sc_mutex_once = PTHREAD_ONCE_INIT;
+
+static void sc_mutex_buckets_init(void)
+{
+    int rc;
+
+    for (int i = 0; i < SC_MUTEX_BUCKETS; i++) {
+        // These may only fail on OOM, nothing to do at that point.
+        rc = pthread_mutex_init(&sc_mutex_buckets[i].mtx, NULL);
+        assert(rc == 0);
+        rc = pthread_cond_init(&sc_mutex_buckets[i].cond, NULL);
+        assert(rc == 0);
+        (void) rc;
+    }
+}
+
+static struct sc_mutex_bucket *sc_mutex_bucket(uint32_t *addr)
+{
+    uintptr_t h = (uintptr_t) addr;
+
+    pthread_once(&sc_mutex_once, sc_mutex_buckets_init);
+
+    h = (h >> 2u) ^ (h >> 9u);
+    return &sc_mutex_buckets[h % SC_MUTEX_BUCKETS];
+}
+
+static void sc_mutex_yield(void)
+{
+    sched_yield();
+}
+
+static void sc_mutex_wait(uint32_t *addr, uint32_t val)
+{
+    struct sc_mutex_bucket *b = sc_mutex_bucket(addr);
+
+    pthread_mutex_lock(&b->mtx);
+    if (__atomic_load_n(addr, __ATOMIC_ACQUIRE) == val) {
+        pthread_cond_wait(&b->cond, &b->mtx);
+    }
+    pthread_mutex_unlock(&b->mtx);
+}
+
+static void sc_mutex_wake(uint32_t *addr)
+{
+    struct sc_mutex_bucket *b = sc_mutex_bucket(addr);
+
+    pthread_mutex_lock(&b->mtx);
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->mtx);
+}
+
+static void sc_mutex_wake_one(uint32_t *addr)
+{
+    // Bucket may be shared with other addresses, wake them all.
+    sc_mutex_wake(addr);
+}
+
 #endif
+
+// Spins for a while, returns 'false' when it's time to park.
+static bool sc_mutex_spin(int *spin)
+{
+    if (*spin < SC_MUTEX_SPIN) {
+        (*spin)++;
+        sc_mutex_pause();
+        return true;
+    }
+
+    if (*spin == SC_MUTEX_SPIN) {
+        // Lock holder might be preempted, give it a chance once.
+        (*spin)++;
+        sc_mutex_yield();
+        return true;
+    }
+
+    return false;
+}
+
+// Lock states : unlocked, locked, locked and there may be sleeping waiters.
+#define SC_AMUTEX_UNLOCKED 0u
+#define SC_AMUTEX_LOCKED   1u
+#define SC_AMUTEX_WAITERS  2u
+
+int sc_amutex_init(struct sc_amutex *mtx)
+{
+    mtx->state = SC_AMUTEX_UNLOCKED;
+    return 0;
+}
+
+int sc_amutex_term(struct sc_amutex *mtx)
+{
+    return mtx->state == SC_AMUTEX_UNLOCKED ? 0 : -1;
+}
+
+void sc_amutex_lock(struct sc_amutex *mtx)
+{
+    int spin = 0;
+
+    if (sc_mutex_cas(&mtx->state, SC_AMUTEX_UNLOCKED, SC_AMUTEX_LOCKED)) {
+        return;
+    }
+
+    while (sc_mutex_spin(&spin)) {
+        if (sc_mutex_load(&mtx->state) == SC_AMUTEX_UNLOCKED &&
+            sc_mutex_cas(&mtx->state, SC_AMUTEX_UNLOCKED, SC_AMUTEX_LOCKED)) {
+            return;
+        }
+    }
+
+    // "Futexes Are Tricky", Ulrich Drepper. Once we park, we take the lock in
+    // 'waiters' state, so unlock wakes up the next one.
+    while (sc_mutex_xchg(&mtx->state, SC_AMUTEX_WAITERS) !=
+           SC_AMUTEX_UNLOCKED) {
+        sc_mutex_wait(&mtx->state, SC_AMUTEX_WAITERS);
+    }
+}
+
+int sc_amutex_trylock(struct sc_amutex *mtx)
+{
+    return sc_mutex_cas(&mtx->state, SC_AMUTEX_UNLOCKED, SC_AMUTEX_LOCKED);
+}
+
+void sc_amutex_unlock(struct sc_amutex *mtx)
+{
+    if (sc_mutex_xchg(&mtx->state, SC_AMUTEX_UNLOCKED) == SC_AMUTEX_WAITERS) {
+        sc_mutex_wake_one(&mtx->state);
+    }
+}
+
+// Writer bit, waiting writers bit, waiting readers bit and reader count.
+#define SC_RWLOCK_WRITER  0x80000000u
+#define SC_RWLOCK_WWAIT   0x40000000u
+#define SC_RWLOCK_RWAIT   0x20000000u
+#define SC_RWLOCK_READERS 0x1fffffffu
+
+int sc_rwlock_init(struct sc_rwlock *rw)
+{
+    rw->state = 0;
+    return 0;
+}
+
+int sc_rwlock_term(struct sc_rwlock *rw)
+{
+    return rw->state == 0 ? 0 : -1;
+}
+
+void sc_rwlock_lock_read(struct sc_rwlock *rw)
+{
+    int spin = 0;
+    uint32_t s;
+
+    while (true) {
+        s = sc_mutex_load(&rw->state);
+
+        // Don't take the lock if a writer is waiting, writer preferring.
+        if ((s & (SC_RWLOCK_WRITER | SC_RWLOCK_WWAIT)) == 0) {
+            if (sc_mutex_cas(&rw->state, s, s + 1)) {
+                return;
+            }
+            continue;
+        }
+
+        if (sc_mutex_spin(&spin)) {
+            continue;
+        }
+
+        if ((s & SC_RWLOCK_RWAIT) == 0 &&
+            !sc_mutex_cas(&rw->state, s, s | SC_RWLOCK_RWAIT)) {
+            continue;
+        }
+
+        sc_mutex_wait(&rw->state, s | SC_RWLOCK_RWAIT);
+    }
+}
+
+void sc_rwlock_unlock_read(struct sc_rwlock *rw)
+{
+    uint32_t s = sc_mutex_sub(&rw->state, 1);
+
+    // Last reader wakes up waiting writers.
+    if ((s & SC_RWLOCK_READERS) == 0 &&
+        (s & (SC_RWLOCK_WWAIT | SC_RWLOCK_RWAIT)) != 0) {
+        sc_mutex_wake(&rw->state);
+    }
+}
+
+void sc_rwlock_lock_write(struct sc_rwlock *rw)
+{
+    int spin = 0;
+    uint32_t s, flags;
+
+    while (true) {
+        s = sc_mutex_load(&rw->state);
+
+        if ((s & (SC_RWLOCK_WRITER | SC_RWLOCK_READERS)) == 0) {
+            // Keep waiting flags, other sleepers are woken up on unlock.
+            flags = s & (SC_RWLOCK_WWAIT | SC_RWLOCK_RWAIT);
+            if (sc_mutex_cas(&rw->state, s, SC_RWLOCK_WRITER | flags)) {
+                return;
+            }
+            continue;
+        }
+
+        if (sc_mutex_spin(&spin)) {
+            continue;
+        }
+
+        if ((s & SC_RWLOCK_WWAIT) == 0 &&
+            !sc_mutex_cas(&rw->state, s, s | SC_RWLOCK_WWAIT)) {
+            continue;
+        }
+
+        sc_mutex_wait(&rw->state, s | SC_RWLOCK_WWAIT);
+    }
+}
+
+void sc_rwlock_unlock_write(struct sc_rwlock *rw)
+{
+    uint32_t s = sc_mutex_xchg(&rw->state, 0);
+
+    if ((s & (SC_RWLOCK_WWAIT | SC_RWLOCK_RWAIT)) != 0) {
+        sc_mutex_wake(&rw->state);
+    }
+}
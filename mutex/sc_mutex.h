@@ -25,12 +25,19 @@
 #ifndef SC_MUTEX_H
 #define SC_MUTEX_H
 
+#include <stdint.h>
+
 #if defined(_WIN32) || defined(_WIN64)
     #include <windows.h>
 #else
     #include <pthread.h>
 #endif
 
+// Spin iterations before parking for sc_amutex and sc_rwlock.
+#ifndef SC_MUTEX_SPIN
+    #define SC_MUTEX_SPIN 128
+#endif
+
 struct sc_mutex
 {
 #if defined(_WIN32) || defined(_WIN64)
@@ -70,4 +77,138 @@ void sc_mutex_lock(struct sc_mutex *mtx);
  */
 void sc_mutex_unlock(struct sc_mutex *mtx);
 
+/**
+ * Condition variable bound to a sc_mutex. Unlike sc_cond, which is a latch with
+ * its own mutex, wait releases the caller's mutex and blocks atomically, so a
+ * signal sent while holding the mutex can't be missed. Wakeups may be
+ * spurious, wait in a loop that checks the condition.
+ */
+struct sc_mutex_cond
+{
+#if defined(_WIN32) || defined(_WIN64)
+    CONDITION_VARIABLE cond;
+#else
+    pthread_cond_t cond;
+#endif
+};
+
+/**
+ * @param cond cond
+ * @return     '0' on success, '-1' on error.
+ */
+int sc_mutex_cond_init(struct sc_mutex_cond *cond);
+
+/**
+ * @param cond cond
+ * @return     '0' on success, '-1' on error.
+ */
+int sc_mutex_cond_term(struct sc_mutex_cond *cond);
+
+/**
+ * Release 'mtx' and wait for a signal, 'mtx' is locked again on return.
+ *
+ * @param cond cond
+ * @param mtx  mutex, must be locked by the caller.
+ */
+void sc_mutex_cond_wait(struct sc_mutex_cond *cond, struct sc_mutex *mtx);
+
+/**
+ * Wake up one waiter.
+ * @param cond cond
+ */
+void sc_mutex_cond_signal(struct sc_mutex_cond *cond);
+
+/**
+ * Wake up all waiters.
+ * @param cond cond
+ */
+void sc_mutex_cond_broadcast(struct sc_mutex_cond *cond);
+
+/**
+ * Adaptive mutex, for short critical sections.
+ *
+ * Lock spins for a bounded number of iterations first, then parks the thread
+ * with futex() on Linux, WaitOnAddress() on Windows and a small parking table
+ * of pthread conds on other platforms. Uncontended lock and unlock are a
+ * single atomic operation, unlock makes a syscall only if there are
+ * sleeping waiters. Not recursive.
+ */
+struct sc_amutex
+{
+    uint32_t state;
+};
+
+/**
+ * @param mtx mtx
+ * @return    '0' on success, '-1' on error.
+ */
+int sc_amutex_init(struct sc_amutex *mtx);
+
+/**
+ * @param mtx mtx
+ * @return    '0' on success, '-1' on error.
+ */
+int sc_amutex_term(struct sc_amutex *mtx);
+
+/**
+ * @param mtx mtx
+ */
+void sc_amutex_lock(struct sc_amutex *mtx);
+
+/**
+ * @param mtx mtx
+ * @return    '1' if lock is acquired, '0' if it is already locked.
+ */
+int sc_amutex_trylock(struct sc_amutex *mtx);
+
+/**
+ * @param mtx mtx
+ */
+void sc_amutex_unlock(struct sc_amutex *mtx);
+
+/**
+ * Reader-writer lock, readers don't block each other.
+ *
+ * Writer preferring, once a writer is waiting, new readers wait until the
+ * writer is done. Spins and parks the same way as sc_amutex. Not recursive,
+ * a thread holding the read lock must not try to take it again while a
+ * writer may be waiting.
+ */
+struct sc_rwlock
+{
+    uint32_t state;
+};
+
+/**
+ * @param rw rwlock
+ * @return   '0' on success, '-1' on error.
+ */
+int sc_rwlock_init(struct sc_rwlock *rw);
+
+/**
+ * @param rw rwlock
+ * @return   '0' on success, '-1' on error.
+ */
+int sc_rwlock_term(struct sc_rwlock *rw);
+
+/**
+ * @param rw rwlock
+ */
+void sc_rwlock_lock_read(struct sc_rwlock *rw);
+
+/**
+ * @param rw rwlock
+ */
+void sc_rwlock_unlock_read(struct sc_rwlock *rw);
+
+/**
+ * @param rw rwlock
+ */
+void sc_rwlock_lock_write(struct sc_rwlock *rw);
+
+/**
+ * @param rw rwlock
+ */
+void sc_rwlock_unlock_write(struct sc_rwlock *rw);
+
 #endif
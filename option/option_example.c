@@ -12,6 +12,8 @@ int main(int argc, char *argv[])
                             .count = sizeof(options) / sizeof(options[0]),
                             .options = options};
 
+    sc_option_init(&opt); // Optional, builds lookup tables.
+
     for (int i = 1; i < argc; i++) {
         char c = sc_option_at(&opt, i, &value);
         switch (c) {
@@ -159,6 +159,56 @@ void test6()
     }
 }
 
+static struct sc_option_item options3[] = {{.letter = 'a', .name = "alpha"},
+                                           {.letter = 'b', .name = "beta"},
+                                           {.letter = 'c', .name = NULL},
+                                           {.letter = 'd', .name = "alp"},
+                                           {.letter = 'e', .name = "alpha"},
+                                           {.letter = 'a', .name = "other"}};
+
+void test_index()
+{
+    char c1, c2;
+    char *v1, *v2;
+    char *argv[] = {"program", "-a", "-b=x", "-c", "-cc", "-d value", "-z",
+                    "-", "--", "--alpha", "--alpha=1", "--alp", "--al",
+                    "--alphas", "--beta=", "--beta==", "--other", "--c",
+                    "--unknown=3", "alpha", "--=x"};
+    int argc = sizeof(argv) / sizeof(argv[0]);
+
+    struct sc_option scan = {.argv = argv,
+            .count = sizeof(options3) / sizeof(struct sc_option_item),
+            .options = options3};
+    struct sc_option index = scan;
+
+    assert(sc_option_init(&index) == 0);
+
+    // Same results with and without the index.
+    for (int i = 1; i < argc; i++) {
+        c1 = sc_option_at(&scan, i, &v1);
+        c2 = sc_option_at(&index, i, &v2);
+        assert(c1 == c2);
+        assert(v1 == v2);
+    }
+
+    assert(sc_option_at(&index, 9, &v1) == 'a' && *v1 == '\0');
+    assert(sc_option_at(&index, 10, &v1) == 'a' && strcmp(v1, "1") == 0);
+    assert(v1 == argv[10] + 8);
+    assert(sc_option_at(&index, 11, &v1) == 'd');
+    assert(sc_option_at(&index, 12, &v1) == '?' && v1 == NULL);
+    assert(sc_option_at(&index, 13, &v1) == '?');
+    assert(sc_option_at(&index, 15, &v1) == 'b' && strcmp(v1, "=") == 0);
+    assert(sc_option_at(&index, 16, &v1) == 'a');
+    assert(sc_option_at(&index, 7, &v1) == '?');
+
+    // Too many options
+    struct sc_option_item many[SC_OPTION_SLOTS] = {{0}};
+    struct sc_option big = {.argv = argv, .count = SC_OPTION_SLOTS,
+                            .options = many};
+    assert(sc_option_init(&big) == -1);
+    assert(sc_option_at(&big, 1, &v1) == '?');
+}
+
 int main()
 {
     test1();
@@ -167,6 +217,7 @@ int main()
     test4();
     test5();
     test6();
+    test_index();
 
     return 0;
 }
@@ -26,52 +26,158 @@
 
 #include <string.h>
 
+static uint32_t sc_option_hash(const char *str, size_t len)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char) str[i];
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+int sc_option_init(struct sc_option *opt)
+{
+    uint32_t h, slot;
+    const char *name;
+
+    opt->indexed = false;
+
+    if (opt->count > SC_OPTION_SLOTS / 2) {
+        return -1;
+    }
+
+    memset(opt->letters, 0, sizeof(opt->letters));
+    memset(opt->slots, 0, sizeof(opt->slots));
+
+    // Tables keep index + 1, zero is empty. First definition wins as in the
+    // scan.
+    for (int i = opt->count - 1; i >= 0; i--) {
+        opt->letters[(unsigned char) opt->options[i].letter] = (uint8_t) (i + 1);
+    }
+
+    for (int i = 0; i < opt->count; i++) {
+        name = opt->options[i].name;
+        if (name == NULL) {
+            continue;
+        }
+
+        h = sc_option_hash(name, strlen(name));
+        slot = h & (SC_OPTION_SLOTS - 1);
+
+        while (opt->slots[slot] != 0) {
+            if (opt->hashes[slot] == h &&
+                strcmp(opt->options[opt->slots[slot] - 1].name, name) == 0) {
+                break;
+            }
+
+            slot = (slot + 1) & (SC_OPTION_SLOTS - 1);
+        }
+
+        if (opt->slots[slot] == 0) {
+            opt->slots[slot] = (uint8_t) (i + 1);
+            opt->hashes[slot] = h;
+        }
+    }
+
+    opt->indexed = true;
+
+    return 0;
+}
+
+static int sc_option_short(struct sc_option *opt, char c)
+{
+    if (opt->indexed) {
+        return opt->letters[(unsigned char) c] - 1;
+    }
+
+    for (int i = 0; i < opt->count; i++) {
+        if (c == opt->options[i].letter) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static bool sc_option_equals(const char *name, const char *str, size_t len)
+{
+    return name != NULL && strncmp(name, str, len) == 0 && name[len] == '\0';
+}
+
+static int sc_option_long(struct sc_option *opt, const char *str, size_t len)
+{
+    uint32_t h, slot;
+    int i;
+
+    if (!opt->indexed) {
+        for (i = 0; i < opt->count; i++) {
+            if (sc_option_equals(opt->options[i].name, str, len)) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    h = sc_option_hash(str, len);
+    slot = h & (SC_OPTION_SLOTS - 1);
+
+    while ((i = opt->slots[slot] - 1) >= 0) {
+        if (opt->hashes[slot] == h &&
+            sc_option_equals(opt->options[i].name, str, len)) {
+            return i;
+        }
+
+        slot = (slot + 1) & (SC_OPTION_SLOTS - 1);
+    }
+
+    return -1;
+}
+
 char sc_option_at(struct sc_option *opt, int index, char **value)
 {
-    char id = '?';
-    size_t len;
-    char *pos;
-    const char *curr, *name;
+    int i;
+    char *pos, *name;
 
     pos = opt->argv[index];
     *value = NULL;
 
     if (*pos != '-') {
-        return id;
+        return '?';
     }
 
     pos++; // Skip first '-'
     if (*pos != '-') {
-        for (int i = 0; i < opt->count; i++) {
-            if (*pos == opt->options[i].letter &&
-                strchr("= \0", *(pos + 1)) != NULL) {
-                id = *pos;
-                pos++; // skip letter
-                *value = pos + (*pos != '=' ? 0 : 1);
-                break;
-            }
+        if (*pos == '\0' || strchr("= ", *(pos + 1)) == NULL) {
+            return '?';
         }
-    } else {
-        while (*pos && *pos != '=') {
-            pos++;
+
+        i = sc_option_short(opt, *pos);
+        if (i < 0) {
+            return '?';
         }
 
-        for (int i = 0; i < opt->count; i++) {
-            curr = opt->argv[index] + 2; // Skip '--'
-            name = opt->options[i].name;
-            len = (pos - curr);
+        pos++; // skip letter
+        *value = pos + (*pos != '=' ? 0 : 1);
 
-            if (name == NULL) {
-                continue;
-            }
+        return opt->options[i].letter;
+    }
 
-            if (len == strlen(name) && memcmp(name, curr, len) == 0) {
-                id = opt->options[i].letter;
-                *value = pos + (*pos != '=' ? 0 : 1);
-                break;
-            }
-        }
+    name = ++pos; // Skip second '-'
+    while (*pos && *pos != '=') {
+        pos++;
+    }
+
+    i = sc_option_long(opt, name, (size_t) (pos - name));
+    if (i < 0) {
+        return '?';
     }
 
-    return id;
+    *value = pos + (*pos != '=' ? 0 : 1);
+
+    return opt->options[i].letter;
 }
@@ -26,8 +26,14 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
+// Hash slots for long option names, sc_option_init() accepts up to half of it.
+#ifndef SC_OPTION_SLOTS
+    #define SC_OPTION_SLOTS 64
+#endif
+
 struct sc_option_item
 {
     const char letter;
@@ -39,8 +45,27 @@ struct sc_option
     struct sc_option_item *options;
     int count;
     char **argv;
+
+    // Lookup tables, filled by sc_option_init().
+    bool indexed;
+    uint8_t letters[256];
+    uint8_t slots[SC_OPTION_SLOTS];
+    uint32_t hashes[SC_OPTION_SLOTS];
 };
 
+/**
+ * Optional, builds lookup tables for 'options', so sc_option_at() finds short
+ * options with a table lookup and long options with a hash probe instead of
+ * scanning and comparing all options for each argument. Call once after
+ * setting 'options' and 'count'. Without this call, sc_option_at() scans the
+ * options.
+ *
+ * @param opt opt
+ * @return    '0' on success, '-1' if there are more than SC_OPTION_SLOTS / 2
+ *            options, sc_option_at() keeps scanning in that case.
+ */
+int sc_option_init(struct sc_option *opt);
+
 /**
  *
  * @param opt    Already initialized sc_opt struct
@@ -48,6 +73,7 @@ struct sc_option
  * @param value  [out] Value for the option if exists. It should be after '='
  *               sign. E.g : -key=value or -k=value. If value does not exists
  *               (*value) will point to '\0' character. It won't be NULL itself.
+ *               Value points into argv, it is not copied.
  *
  *               To check if option has value associated : if (*value != '\0')
  *
@@ -1,9 +1,48 @@
 #include "sc_perf.h"
 #include <stdlib.h>
 
-int main()
+#include <stdio.h>
+
+static size_t regions(void)
 {
     size_t total = 0;
+    struct sc_perf perf;
+    const char *events = getenv("SC_PERF_EVENTS");
+
+    // Software events by default, so the example works in virtual machines.
+    if (events == NULL) {
+        events = "task-clock,page-faults";
+    }
+
+    if (sc_perf_init_names(&perf, events) != 0) {
+        printf("%s \n", sc_perf_err(&perf));
+        return 0;
+    }
+
+    for (int i = 0; i < 100; i++) {
+        sc_perf_enter(&perf, "outer");
+        for (int j = 0; j < 100000; j++) {
+            total += (rand() % 331) ^ 33;
+        }
+
+        sc_perf_enter(&perf, "inner");
+        for (int j = 0; j < 100000; j++) {
+            total += (rand() % 327) ^ 37;
+        }
+        sc_perf_leave_ops(&perf, 100000);
+        sc_perf_leave(&perf);
+    }
+
+    sc_perf_print(&perf, stdout, SC_PERF_TEXT);
+    sc_perf_print(&perf, stdout, SC_PERF_JSON);
+    sc_perf_term(&perf);
+
+    return total;
+}
+
+int main()
+{
+    size_t total = regions();
 
     sc_perf_start();
     for (int i = 0; i < 100000000; i++) {
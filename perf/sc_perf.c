@@ -38,12 +38,105 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/syscall.h>
 #include <sys/prctl.h>
 #include <unistd.h>
 
 #define ITEMS_SIZE (sizeof(sc_perf_hw) / sizeof(struct sc_perf_event))
 
+// All events, selectable by name with sc_perf_init_names().
+// clang-format off
+static const struct sc_perf_event sc_perf_events[] = {
+        {"cpu-clock",               PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK                  },
+        {"task-clock",              PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK                 },
+        {"page-faults",             PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS                },
+        {"context-switches",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES           },
+        {"cpu-migrations",          PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS             },
+        {"page-fault-minor",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN            },
+        {"page-fault-major",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ            },
+        {"alignment-faults",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_ALIGNMENT_FAULTS           },
+        {"emulation-faults",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_EMULATION_FAULTS           },
+
+        {"cpu-cycles",              PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES                 },
+        {"instructions",            PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS               },
+        {"cache-references",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES           },
+        {"cache-misses",            PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES               },
+        {"branch-instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS        },
+        {"branch-misses",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES              },
+        {"bus-cycles",              PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES                 },
+        {"stalled-cycles-frontend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND    },
+        {"stalled-cycles-backend",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND     },
+        {"ref-cpu-cycles",          PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES             },
+
+        {"L1D-read-access",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, READ, ACCESS)      },
+        {"L1D-read-miss",           PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, READ, MISS)        },
+        {"L1D-write-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, WRITE, ACCESS)     },
+        {"L1D-write-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, WRITE, MISS)       },
+        {"L1D-prefetch-access",     PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, PREFETCH, ACCESS)  },
+        {"L1D-prefetch-miss",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, PREFETCH, MISS)    },
+        {"L1I-read-access",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, READ, ACCESS)      },
+        {"L1I-read-miss",           PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, READ, MISS)        },
+        {"L1I-write-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, WRITE, ACCESS)     },
+        {"L1I-write-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, WRITE, MISS)       },
+        {"L1I-prefetch-access",     PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, PREFETCH, ACCESS)  },
+        {"L1I-prefetch-miss",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, PREFETCH, MISS)    },
+        {"LL-read-access",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, READ, ACCESS)       },
+        {"LL-read-miss",            PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, READ, MISS)         },
+        {"LL-write-access",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, WRITE, ACCESS)      },
+        {"LL-write-miss",           PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, WRITE, MISS)        },
+        {"LL-prefetch-access",      PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, PREFETCH, ACCESS)   },
+        {"LL-prefetch-miss",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, PREFETCH, MISS)     },
+        {"DTLB-read-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, READ, ACCESS)     },
+        {"DTLB-read-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, READ, MISS)       },
+        {"DTLB-write-access",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, WRITE, ACCESS)    },
+        {"DTLB-write-miss",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, WRITE, MISS)      },
+        {"DTLB-prefetch-access",    PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, PREFETCH, ACCESS) },
+        {"DTLB-prefetch-miss",      PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, PREFETCH, MISS)   },
+        {"ITLB-read-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, READ, ACCESS)     },
+        {"ITLB-read-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, READ, MISS)       },
+        {"ITLB-write-access",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, WRITE, ACCESS)    },
+        {"ITLB-write-miss",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, WRITE, MISS)      },
+        {"ITLB-prefetch-access",    PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, PREFETCH, ACCESS) },
+        {"ITLB-prefetch-miss",      PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, PREFETCH, MISS)   },
+        {"BPU-read-access",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, READ, ACCESS)      },
+        {"BPU-read-miss",           PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, READ, MISS)        },
+        {"BPU-write-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, WRITE, ACCESS)     },
+        {"BPU-write-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, WRITE, MISS)       },
+        {"BPU-prefetch-access",     PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, PREFETCH, ACCESS)  },
+        {"BPU-prefetch-miss",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, PREFETCH, MISS)    },
+        {"NODE-read-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, READ, ACCESS)     },
+        {"NODE-read-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, READ, MISS)       },
+        {"NODE-write-access",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, WRITE, ACCESS)    },
+        {"NODE-write-miss",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, WRITE, MISS)      },
+        {"NODE-prefetch-access",    PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, PREFETCH, ACCESS) },
+        {"NODE-prefetch-miss",      PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, PREFETCH, MISS)   },
+
+        // perf tool names
+        {"cycles",                  PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES                 },
+        {"ref-cycles",              PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES             },
+        {"branches",                PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS        },
+        {"cs",                      PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES           },
+        {"migrations",              PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS             },
+        {"faults",                  PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS                },
+        {"minor-faults",            PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN            },
+        {"major-faults",            PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ            },
+        {"L1-dcache-loads",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, READ, ACCESS)      },
+        {"L1-dcache-load-misses",   PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, READ, MISS)        },
+        {"L1-icache-load-misses",   PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, READ, MISS)        },
+        {"LLC-loads",               PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, READ, ACCESS)       },
+        {"LLC-load-misses",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, READ, MISS)         },
+        {"LLC-stores",              PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, WRITE, ACCESS)      },
+        {"LLC-store-misses",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, WRITE, MISS)        },
+        {"dTLB-loads",              PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, READ, ACCESS)     },
+        {"dTLB-load-misses",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, READ, MISS)       },
+        {"iTLB-load-misses",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, READ, MISS)       },
+        {"branch-loads",            PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, READ, ACCESS)      },
+        {"branch-load-misses",      PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, READ, MISS)        },
+};
+// clang-format on
+
 static int initialized = 0;
 static int running = 0;
 static uint64_t total = 0;
@@ -120,7 +213,8 @@ static void sc_read(struct sc_perf_item *items, size_t size)
             items[i].active = n;
         }
 
-        items[i].value += fmt.value * n;
+        // Counter ran 'n' of the time, extrapolate to the whole duration.
+        items[i].value += (double) fmt.value / n;
     }
 }
 
@@ -203,3 +297,585 @@ void sc_perf_end(void)
 
     sc_perf_clear();
 }
+
+#define sc_perf_barrier() __asm__ __volatile__("" ::: "memory")
+
+#if defined(__x86_64__)
+    #define SC_PERF_HAVE_RDPMC 1
+
+static uint64_t sc_perf_rdpmc(uint32_t counter)
+{
+    uint32_t lo, hi;
+
+    __asm__ __volatile__("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+    return ((uint64_t) hi << 32u) | lo;
+}
+
+static uint64_t sc_perf_cycles(void)
+{
+    uint32_t lo, hi;
+
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32u) | lo;
+}
+
+#elif defined(__aarch64__)
+    #define SC_PERF_HAVE_RDPMC 1
+
+    // Event counters are PMEVCNTR<n>_EL0, register name must be a constant.
+    #define SC_PERF_PMEVCNTR(n)                                                \
+        case n:                                                                \
+            __asm__ __volatile__("mrs %0, pmevcntr" #n "_el0" : "=r"(val));    \
+            break
+
+static uint64_t sc_perf_rdpmc(uint32_t counter)
+{
+    uint64_t val = 0;
+
+    switch (counter) {
+        SC_PERF_PMEVCNTR(0);  SC_PERF_PMEVCNTR(1);  SC_PERF_PMEVCNTR(2);
+        SC_PERF_PMEVCNTR(3);  SC_PERF_PMEVCNTR(4);  SC_PERF_PMEVCNTR(5);
+        SC_PERF_PMEVCNTR(6);  SC_PERF_PMEVCNTR(7);  SC_PERF_PMEVCNTR(8);
+        SC_PERF_PMEVCNTR(9);  SC_PERF_PMEVCNTR(10); SC_PERF_PMEVCNTR(11);
+        SC_PERF_PMEVCNTR(12); SC_PERF_PMEVCNTR(13); SC_PERF_PMEVCNTR(14);
+        SC_PERF_PMEVCNTR(15); SC_PERF_PMEVCNTR(16); SC_PERF_PMEVCNTR(17);
+        SC_PERF_PMEVCNTR(18); SC_PERF_PMEVCNTR(19); SC_PERF_PMEVCNTR(20);
+        SC_PERF_PMEVCNTR(21); SC_PERF_PMEVCNTR(22); SC_PERF_PMEVCNTR(23);
+        SC_PERF_PMEVCNTR(24); SC_PERF_PMEVCNTR(25); SC_PERF_PMEVCNTR(26);
+        SC_PERF_PMEVCNTR(27); SC_PERF_PMEVCNTR(28); SC_PERF_PMEVCNTR(29);
+        SC_PERF_PMEVCNTR(30);
+    case 31: // Cycle counter
+        __asm__ __volatile__("mrs %0, pmccntr_el0" : "=r"(val));
+        break;
+    default:
+        break;
+    }
+
+    return val;
+}
+
+static uint64_t sc_perf_cycles(void)
+{
+    uint64_t val;
+
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(val));
+    return val;
+}
+
+#else
+    #define SC_PERF_HAVE_RDPMC 0
+
+static uint64_t sc_perf_rdpmc(uint32_t counter)
+{
+    (void) counter;
+    return 0;
+}
+
+static uint64_t sc_perf_cycles(void)
+{
+    return 0;
+}
+#endif
+
+// Reads the counter from user space, see 'struct perf_event_mmap_page' in
+// linux/perf_event.h. Returns false if the event is not on a hardware counter
+// at the moment, e.g software events or the counter is not scheduled.
+static bool sc_perf_rdpmc_event(struct perf_event_mmap_page *pc,
+                                uint64_t *value, uint64_t *enabled,
+                                uint64_t *running)
+{
+    uint32_t seq, idx, width;
+    uint64_t count, pmc, cyc, quot, rem, delta;
+
+    do {
+        seq = pc->lock;
+        sc_perf_barrier();
+
+        idx = pc->index;
+        if (!pc->cap_user_rdpmc || idx == 0 || !pc->cap_user_time) {
+            return false;
+        }
+
+        *enabled = pc->time_enabled;
+        *running = pc->time_running;
+
+        // Extend times to now, the event is running while 'idx' is valid.
+        cyc = sc_perf_cycles();
+        quot = cyc >> pc->time_shift;
+        rem = cyc & (((uint64_t) 1 << pc->time_shift) - 1);
+        delta = pc->time_offset + quot * pc->time_mult +
+                ((rem * pc->time_mult) >> pc->time_shift);
+        *enabled += delta;
+        *running += delta;
+
+        width = pc->pmc_width;
+        count = pc->offset;
+        pmc = sc_perf_rdpmc(idx - 1);
+        pmc <<= 64 - width;
+        pmc >>= 64 - width;
+        count += pmc;
+
+        sc_perf_barrier();
+    } while (pc->lock != seq);
+
+    *value = count;
+
+    return true;
+}
+
+static void sc_perf_close(struct sc_perf *p)
+{
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+
+    for (size_t i = 0; i < p->count; i++) {
+        if (p->pages[i] != NULL) {
+            munmap(p->pages[i], page);
+            p->pages[i] = NULL;
+        }
+
+        if (p->fds[i] != -1) {
+            close(p->fds[i]);
+            p->fds[i] = -1;
+        }
+    }
+}
+
+int sc_perf_init(struct sc_perf *p, const struct sc_perf_event *events,
+                 size_t count)
+{
+    int fd, leader;
+    const uint64_t flags = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    if (events == NULL) {
+        events = sc_perf_hw;
+        count = ITEMS_SIZE;
+    }
+
+    p->count = 0;
+    p->depth = 0;
+    p->region_count = 0;
+    p->err[0] = '\0';
+
+    if (count == 0 || count > SC_PERF_MAX_EVENTS) {
+        strncpy(p->err, "Invalid event count", sizeof(p->err) - 1);
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        // Leader starts disabled, the whole group is enabled at once below.
+        struct perf_event_attr attr = {.size = sizeof(struct perf_event_attr),
+                                       .read_format = flags,
+                                       .type = events[i].type,
+                                       .config = events[i].config,
+                                       .disabled = i == 0,
+                                       .exclude_kernel = false,
+                                       .exclude_hv = false};
+#if defined(__aarch64__)
+        // Ask for user space access, config1:1 is the 'rdpmc' format bit.
+        if (events[i].type != PERF_TYPE_SOFTWARE) {
+            attr.config1 = 0x2;
+        }
+#endif
+
+        leader = i == 0 ? -1 : p->fds[0];
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader,
+                     PERF_FLAG_FD_CLOEXEC);
+        if (fd == -1) {
+            snprintf(p->err, sizeof(p->err), "Failed to open counter %s : %s",
+                     events[i].name, strerror(errno));
+            sc_perf_close(p);
+            return -1;
+        }
+
+        strncpy(p->names[i], events[i].name, SC_PERF_NAME_MAX - 1);
+        p->names[i][SC_PERF_NAME_MAX - 1] = '\0';
+        p->events[i] = events[i];
+        p->events[i].name = p->names[i];
+        p->fds[i] = fd;
+        p->pages[i] = NULL;
+        p->count++;
+    }
+
+    p->rdpmc = SC_PERF_HAVE_RDPMC;
+    for (size_t i = 0; i < p->count; i++) {
+        void *page = mmap(NULL, (size_t) sysconf(_SC_PAGESIZE), PROT_READ,
+                          MAP_SHARED, p->fds[i], 0);
+        if (page == MAP_FAILED) {
+            p->rdpmc = false;
+            continue;
+        }
+
+        p->pages[i] = page;
+    }
+
+    if (ioctl(p->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) == -1 ||
+        ioctl(p->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == -1) {
+        snprintf(p->err, sizeof(p->err), "ioctl : %s", strerror(errno));
+        sc_perf_close(p);
+        return -1;
+    }
+
+    return 0;
+}
+
+const struct sc_perf_event *sc_perf_event_find(const char *name)
+{
+    const size_t count = sizeof(sc_perf_events) / sizeof(sc_perf_events[0]);
+
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(sc_perf_events[i].name, name) == 0) {
+            return &sc_perf_events[i];
+        }
+    }
+
+    return NULL;
+}
+
+int sc_perf_init_names(struct sc_perf *p, const char *names)
+{
+    char *end;
+    size_t len, count = 0;
+    const char *next;
+    const struct sc_perf_event *e;
+    char name[SC_PERF_MAX_EVENTS][SC_PERF_NAME_MAX];
+    struct sc_perf_event events[SC_PERF_MAX_EVENTS];
+
+    p->err[0] = '\0';
+
+    while (*names != '\0') {
+        next = strchr(names, ',');
+        len = next ? (size_t) (next - names) : strlen(names);
+
+        if (len == 0 || len >= SC_PERF_NAME_MAX ||
+            count == SC_PERF_MAX_EVENTS) {
+            strncpy(p->err, "Invalid event list", sizeof(p->err) - 1);
+            return -1;
+        }
+
+        memcpy(name[count], names, len);
+        name[count][len] = '\0';
+
+        e = sc_perf_event_find(name[count]);
+        if (e != NULL) {
+            events[count] = *e;
+        } else if (name[count][0] == 'r' && name[count][1] != '\0') {
+            // Raw event, e.g "r01c2" : umask 0x01, event 0xc2 on x86.
+            errno = 0;
+            events[count] = (struct sc_perf_event){
+                    .name = name[count],
+                    .type = PERF_TYPE_RAW,
+                    .config = strtoull(name[count] + 1, &end, 16),
+            };
+
+            if (errno != 0 || *end != '\0') {
+                goto unknown;
+            }
+        } else {
+            goto unknown;
+        }
+
+        count++;
+        names += next ? len + 1 : len;
+    }
+
+    return sc_perf_init(p, events, count);
+
+unknown:
+    snprintf(p->err, sizeof(p->err), "Unknown event : %.*s",
+             SC_PERF_NAME_MAX, name[count]);
+    return -1;
+}
+
+void sc_perf_term(struct sc_perf *p)
+{
+    sc_perf_close(p);
+    p->count = 0;
+    p->depth = 0;
+    p->region_count = 0;
+}
+
+static bool sc_perf_sample_rdpmc(struct sc_perf *p, struct sc_perf_sample *s)
+{
+    uint64_t enabled, running;
+
+    for (size_t i = 0; i < p->count; i++) {
+        if (!sc_perf_rdpmc_event(p->pages[i], &s->values[i], &enabled,
+                                 &running)) {
+            return false;
+        }
+
+        // Group is scheduled together, leader's times are valid for all.
+        if (i == 0) {
+            s->enabled = enabled;
+            s->running = running;
+        }
+    }
+
+    s->time = sy_time_nano();
+
+    return true;
+}
+
+static int sc_perf_sample(struct sc_perf *p, struct sc_perf_sample *s)
+{
+    ssize_t n;
+    uint64_t buf[3 + SC_PERF_MAX_EVENTS];
+    const size_t size = (3 + p->count) * sizeof(uint64_t);
+
+    if (p->rdpmc && sc_perf_sample_rdpmc(p, s)) {
+        return 0;
+    }
+
+    // Layout with PERF_FORMAT_GROUP : nr, time_enabled, time_running, values.
+    n = read(p->fds[0], buf, size);
+    if (n != (ssize_t) size) {
+        snprintf(p->err, sizeof(p->err), "read : %s",
+                 n == -1 ? strerror(errno) : "short read");
+        return -1;
+    }
+
+    s->time = sy_time_nano();
+    s->enabled = buf[1];
+    s->running = buf[2];
+
+    for (size_t i = 0; i < p->count; i++) {
+        s->values[i] = buf[3 + i];
+    }
+
+    return 0;
+}
+
+int sc_perf_enter(struct sc_perf *p, const char *name)
+{
+    struct sc_perf_region *r = NULL;
+
+    if (p->depth == SC_PERF_MAX_DEPTH) {
+        strncpy(p->err, "Max depth", sizeof(p->err) - 1);
+        return -1;
+    }
+
+    for (size_t i = 0; i < p->region_count; i++) {
+        if (p->regions[i].name == name ||
+            strcmp(p->regions[i].name, name) == 0) {
+            r = &p->regions[i];
+            break;
+        }
+    }
+
+    if (r == NULL) {
+        if (p->region_count == SC_PERF_MAX_REGIONS) {
+            strncpy(p->err, "Max regions", sizeof(p->err) - 1);
+            return -1;
+        }
+
+        r = &p->regions[p->region_count++];
+        *r = (struct sc_perf_region){.name = name};
+    }
+
+    r->calls++;
+    p->stack[p->depth].region = r;
+
+    // Read last, so the region is not charged for the bookkeeping above.
+    if (sc_perf_sample(p, &p->stack[p->depth].sample) != 0) {
+        return -1;
+    }
+
+    p->depth++;
+
+    return 0;
+}
+
+int sc_perf_leave(struct sc_perf *p)
+{
+    return sc_perf_leave_ops(p, 1);
+}
+
+int sc_perf_leave_ops(struct sc_perf *p, uint64_t ops)
+{
+    double scale = 1.0;
+    uint64_t enabled, running;
+    struct sc_perf_sample now;
+    struct sc_perf_frame *f;
+
+    if (p->depth == 0) {
+        strncpy(p->err, "No active region", sizeof(p->err) - 1);
+        return -1;
+    }
+
+    if (sc_perf_sample(p, &now) != 0) {
+        return -1;
+    }
+
+    f = &p->stack[--p->depth];
+    enabled = now.enabled - f->sample.enabled;
+    running = now.running - f->sample.running;
+
+    // Counters were multiplexed, extrapolate to the whole region. If the
+    // group was never scheduled, there is nothing to extrapolate from.
+    if (running == 0) {
+        scale = 0;
+    } else if (running < enabled) {
+        scale = (double) enabled / (double) running;
+    }
+
+    f->region->ops += ops;
+    f->region->time += now.time - f->sample.time;
+    f->region->enabled += enabled;
+    f->region->running += running;
+    for (size_t i = 0; i < p->count; i++) {
+        f->region->values[i] +=
+                (double) (now.values[i] - f->sample.values[i]) * scale;
+    }
+
+    return 0;
+}
+
+const struct sc_perf_region *sc_perf_region(struct sc_perf *p,
+                                            const char *name)
+{
+    for (size_t i = 0; i < p->region_count; i++) {
+        if (strcmp(p->regions[i].name, name) == 0) {
+            return &p->regions[i];
+        }
+    }
+
+    return NULL;
+}
+
+static double sc_perf_ratio(const struct sc_perf_region *r)
+{
+    return r->enabled == 0 ? 1.0 : (double) r->running / (double) r->enabled;
+}
+
+static double sc_perf_per_op(const struct sc_perf_region *r, double val)
+{
+    return r->ops == 0 ? 0 : val / (double) r->ops;
+}
+
+// Region names are provided by the user, escape them for JSON and CSV.
+static void sc_perf_print_str(FILE *fp, const char *str, int format)
+{
+    fputc('"', fp);
+    for (const char *c = str; *c != '\0'; c++) {
+        if (*c == '"') {
+            fputs(format == SC_PERF_JSON ? "\\\"" : "\"\"", fp);
+        } else if (format == SC_PERF_JSON && *c == '\\') {
+            fputs("\\\\", fp);
+        } else if ((unsigned char) *c < 0x20) {
+            fputc(' ', fp);
+        } else {
+            fputc(*c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+static void sc_perf_print_text(struct sc_perf *p, FILE *fp)
+{
+    const struct sc_perf_region *r;
+
+    for (size_t i = 0; i < p->region_count; i++) {
+        r = &p->regions[i];
+
+        fprintf(fp, "\n[%s] calls : %llu, ops : %llu, time : %.6f s, "
+                    "multiplexing ratio : %.2f%% \n",
+                r->name, (unsigned long long) r->calls,
+                (unsigned long long) r->ops, (double) r->time / 1e9,
+                sc_perf_ratio(r) * 100);
+        fprintf(fp, "| %-25s | %-18s | %-18s \n", "Event", "Value", "Per op");
+        fprintf(fp, "-------------------------------------------------------"
+                    "-----------\n");
+        fprintf(fp, "| %-25s | %-18llu | %-18.2f \n", "time (ns)",
+                (unsigned long long) r->time,
+                sc_perf_per_op(r, (double) r->time));
+
+        for (size_t j = 0; j < p->count; j++) {
+            fprintf(fp, "| %-25s | %-18.2f | %-18.2f \n", p->events[j].name,
+                    r->values[j], sc_perf_per_op(r, r->values[j]));
+        }
+    }
+}
+
+static void sc_perf_print_csv(struct sc_perf *p, FILE *fp)
+{
+    const struct sc_perf_region *r;
+
+    fprintf(fp, "region,calls,ops,time_ns,ratio,event,value,per_op\n");
+
+    for (size_t i = 0; i < p->region_count; i++) {
+        r = &p->regions[i];
+
+        for (size_t j = 0; j < p->count; j++) {
+            sc_perf_print_str(fp, r->name, SC_PERF_CSV);
+            fprintf(fp, ",%llu,%llu,%llu,%.4f,%s,%.2f,%.4f\n",
+                    (unsigned long long) r->calls, (unsigned long long) r->ops,
+                    (unsigned long long) r->time, sc_perf_ratio(r),
+                    p->events[j].name, r->values[j],
+                    sc_perf_per_op(r, r->values[j]));
+        }
+    }
+}
+
+static void sc_perf_print_json(struct sc_perf *p, FILE *fp)
+{
+    const struct sc_perf_region *r;
+
+    fprintf(fp, "{\"regions\": [");
+
+    for (size_t i = 0; i < p->region_count; i++) {
+        r = &p->regions[i];
+
+        fprintf(fp, "%s{\"name\": ", i == 0 ? "" : ", ");
+        sc_perf_print_str(fp, r->name, SC_PERF_JSON);
+        fprintf(fp, ", \"calls\": %llu, \"ops\": %llu, \"time_ns\": %llu, "
+                    "\"ratio\": %.4f, \"events\": {",
+                (unsigned long long) r->calls, (unsigned long long) r->ops,
+                (unsigned long long) r->time, sc_perf_ratio(r));
+
+        for (size_t j = 0; j < p->count; j++) {
+            fprintf(fp, "%s\"%s\": {\"value\": %.2f, \"per_op\": %.4f}",
+                    j == 0 ? "" : ", ", p->events[j].name, r->values[j],
+                    sc_perf_per_op(r, r->values[j]));
+        }
+
+        fprintf(fp, "}}");
+    }
+
+    fprintf(fp, "]}\n");
+}
+
+int sc_perf_print(struct sc_perf *p, FILE *fp, int format)
+{
+    switch (format) {
+    case SC_PERF_TEXT:
+        sc_perf_print_text(p, fp);
+        break;
+    case SC_PERF_CSV:
+        sc_perf_print_csv(p, fp);
+        break;
+    case SC_PERF_JSON:
+        sc_perf_print_json(p, fp);
+        break;
+    default:
+        strncpy(p->err, "Invalid format", sizeof(p->err) - 1);
+        return -1;
+    }
+
+    if (ferror(fp)) {
+        snprintf(p->err, sizeof(p->err), "write : %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+void sc_perf_reset(struct sc_perf *p)
+{
+    p->region_count = 0;
+}
+
+const char *sc_perf_err(struct sc_perf *p)
+{
+    return p->err;
+}
@@ -26,7 +26,10 @@
 #define SC_PERF_H
 
 #include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #define SC_PERF_HW_CACHE(CACHE, OP, RESULT)                                    \
     ((PERF_COUNT_HW_CACHE_##CACHE) | (PERF_COUNT_HW_CACHE_OP_##OP << 8u) |     \
@@ -39,6 +42,9 @@ struct sc_perf_event
     uint64_t config;
 };
 
+// Default events of sc_perf_start() and sc_perf_init(). All software,
+// hardware and cache events can be selected by name, see
+// sc_perf_init_names().
 // clang-format off
 static const struct sc_perf_event sc_perf_hw[] = {
         {"cpu-clock",               PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK                  },
@@ -47,70 +53,232 @@ static const struct sc_perf_event sc_perf_hw[] = {
         {"context-switches",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES           },
         {"cpu-migrations",          PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS             },
         {"page-fault-minor",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN            },
-     // {"page-fault-major",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ            },
-     // {"alignment-faults",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_ALIGNMENT_FAULTS           },
-     // {"emulation-faults",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_EMULATION_FAULTS           },
-
         {"cpu-cycles",              PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES                 },
         {"instructions",            PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS               },
-     // {"cache-references",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES           },
         {"cache-misses",            PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES               },
-     // {"branch-instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS        },
-     // {"branch-misses",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES              },
-     // {"bus-cycles",              PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES                 },
-     // {"stalled-cycles-frontend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND    },
-     // {"stalled-cycles-backend",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND     },
-     // {"ref-cpu-cycles",          PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES             },
-
-     // {"L1D-read-access",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, READ, ACCESS)      },
         {"L1D-read-miss",           PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, READ, MISS)        },
-     // {"L1D-write-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, WRITE, ACCESS)     },
-     // {"L1D-write-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, WRITE, MISS)       },
-     // {"L1D-prefetch-access",     PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, PREFETCH, ACCESS)  },
-     // {"L1D-prefetch-miss",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1D, PREFETCH, MISS)    },
-     // {"L1I-read-access",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, READ, ACCESS)      },
         {"L1I-read-miss",           PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, READ, MISS)        },
-     // {"L1I-write-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, WRITE, ACCESS)     },
-     // {"L1I-write-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, WRITE, MISS)       },
-     // {"L1I-prefetch-access",     PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, PREFETCH, ACCESS)  },
-     // {"L1I-prefetch-miss",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(L1I, PREFETCH, MISS)    },
-     // {"LL-read-access",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, READ, ACCESS)       },
-     // {"LL-read-miss",            PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, READ, MISS)         },
-     // {"LL-write-access",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, WRITE, ACCESS)      },
-     // {"LL-write-miss",           PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, WRITE, MISS)        },
-     // {"LL-prefetch-access",      PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, PREFETCH, ACCESS)   },
-     // {"LL-prefetch-miss",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(LL, PREFETCH, MISS)     },
-     // {"DTLB-read-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, READ, ACCESS)     },
-     // {"DTLB-read-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, READ, MISS)       },
-     // {"DTLB-write-access",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, WRITE, ACCESS)    },
-     // {"DTLB-write-miss",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, WRITE, MISS)      },
-     // {"DTLB-prefetch-access",    PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, PREFETCH, ACCESS) },
-     // {"DTLB-prefetch-miss",      PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(DTLB, PREFETCH, MISS)   },
-     // {"ITLB-read-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, READ, ACCESS)     },
-     // {"ITLB-read-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, READ, MISS)       },
-     // {"ITLB-write-access",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, WRITE, ACCESS)    },
-     // {"ITLB-write-miss",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, WRITE, MISS)      },
-     // {"ITLB-prefetch-access",    PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, PREFETCH, ACCESS) },
-     // {"ITLB-prefetch-miss",      PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(ITLB, PREFETCH, MISS)   },
-     // {"BPU-read-access",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, READ, ACCESS)      },
-     // {"BPU-read-miss",           PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, READ, MISS)        },
-     // {"BPU-write-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, WRITE, ACCESS)     },
-     // {"BPU-write-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, WRITE, MISS)       },
-     // {"BPU-prefetch-access",     PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, PREFETCH, ACCESS)  },
-     // {"BPU-prefetch-miss",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(BPU, PREFETCH, MISS)    },
-     // {"NODE-read-access",        PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, READ, ACCESS)     },
-     // {"NODE-read-miss",          PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, READ, MISS)       },
-     // {"NODE-write-access",       PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, WRITE, ACCESS)    },
-     // {"NODE-write-miss",         PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, WRITE, MISS)      },
-     // {"NODE-prefetch-access",    PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, PREFETCH, ACCESS) },
-     // {"NODE-prefetch-miss",      PERF_TYPE_HW_CACHE, SC_PERF_HW_CACHE(NODE, PREFETCH, MISS)   },
 };
-
 // clang-format on
 
-
 void sc_perf_start();
 void sc_perf_pause();
 void sc_perf_end();
 
+/**
+ * Per-thread measurement with named regions.
+ *
+ * sc_perf_start()/sc_perf_end() above measure the whole process with a single
+ * region. struct sc_perf opens a counter group for the calling thread only,
+ * counters run all the time and a region is measured by reading the group on
+ * sc_perf_enter() and sc_perf_leave(), so other threads and code outside the
+ * regions are not affected. All events of the group are read with a single
+ * read() and they are scheduled together, values of a region are comparable
+ * with each other, e.g instructions per cycle.
+ *
+ * Regions can nest, values of a region include its nested regions. Results
+ * are accumulated per region name, see sc_perf_region().
+ *
+ * On x86-64 and arm64, counters are read in user space with rdpmc / PMU
+ * register reads through the mmap'ed perf event page, a region costs a few
+ * tens of nanoseconds. If the kernel doesn't allow it, e.g software events,
+ * /sys/bus/event_source/devices/cpu/rdpmc is '0' on x86 or
+ * kernel.perf_user_access is '0' on arm64, counters are read with read().
+ * 'p->rdpmc' is true if user space reads are possible, set it to false after
+ * sc_perf_init() to always use read().
+ *
+ *  struct sc_perf perf;
+ *
+ *  sc_perf_init(&perf, NULL, 0);
+ *
+ *  for (...) {
+ *      sc_perf_enter(&perf, "lookup");
+ *      sc_map_get_str(&map, key, &val);
+ *      sc_perf_leave(&perf);
+ *  }
+ *
+ *  r = sc_perf_region(&perf, "lookup");
+ *  printf("instructions per lookup : %f \n", r->values[1] / r->calls);
+ *
+ *  sc_perf_term(&perf);
+ */
+
+#ifndef SC_PERF_MAX_EVENTS
+    #define SC_PERF_MAX_EVENTS 16
+#endif
+
+#ifndef SC_PERF_MAX_REGIONS
+    #define SC_PERF_MAX_REGIONS 32
+#endif
+
+#ifndef SC_PERF_MAX_DEPTH
+    #define SC_PERF_MAX_DEPTH 16
+#endif
+
+#define SC_PERF_NAME_MAX 32
+
+/**
+ * Values are extrapolated if the counters were multiplexed, i.e the group was
+ * on the PMU for 'running' nanoseconds out of 'enabled'. running / enabled is
+ * the multiplexing ratio, values are less accurate as it gets smaller.
+ */
+struct sc_perf_region
+{
+    const char *name;
+    uint64_t calls;                    // sc_perf_enter() count
+    uint64_t ops;                      // see sc_perf_leave_ops()
+    uint64_t time;                     // nanoseconds
+    uint64_t enabled;                  // nanoseconds counters were enabled
+    uint64_t running;                  // nanoseconds counters were counting
+    double values[SC_PERF_MAX_EVENTS]; // same order as sc_perf.events
+};
+
+struct sc_perf_sample
+{
+    uint64_t time;
+    uint64_t enabled;
+    uint64_t running;
+    uint64_t values[SC_PERF_MAX_EVENTS];
+};
+
+struct sc_perf_frame
+{
+    struct sc_perf_region *region;
+    struct sc_perf_sample sample;
+};
+
+struct sc_perf
+{
+    size_t count;
+    struct sc_perf_event events[SC_PERF_MAX_EVENTS];
+    char names[SC_PERF_MAX_EVENTS][SC_PERF_NAME_MAX];
+    int fds[SC_PERF_MAX_EVENTS];
+    struct perf_event_mmap_page *pages[SC_PERF_MAX_EVENTS];
+    bool rdpmc;
+
+    size_t depth;
+    struct sc_perf_frame stack[SC_PERF_MAX_DEPTH];
+
+    size_t region_count;
+    struct sc_perf_region regions[SC_PERF_MAX_REGIONS];
+    char err[128];
+};
+
+/**
+ * Open and start counters for the calling thread. Use one struct sc_perf per
+ * thread, it must be used by the thread which initialized it.
+ *
+ * @param p      perf
+ * @param events events, NULL for the events in sc_perf_hw.
+ * @param count  event count, at most SC_PERF_MAX_EVENTS.
+ * @return       '0' on success, negative on failure,
+ *               call sc_perf_err() for error string.
+ */
+int sc_perf_init(struct sc_perf *p, const struct sc_perf_event *events,
+                 size_t count);
+
+/**
+ * Same as sc_perf_init() with events selected by name, e.g from a command
+ * line option or an environment variable.
+ *
+ * @param p     perf
+ * @param names comma separated event names, e.g "instructions,LLC-load-misses".
+ *              See sc_perf_event_find() for names, raw events are accepted
+ *              as 'r' followed by the hex config, e.g "r01c2".
+ * @return      '0' on success, negative on failure,
+ *              call sc_perf_err() for error string.
+ */
+int sc_perf_init_names(struct sc_perf *p, const char *names);
+
+/**
+ * @param name event name, e.g "cpu-cycles", "branch-misses", "LL-read-miss",
+ *             "DTLB-read-miss", or a perf tool alias, e.g "cycles",
+ *             "branches", "LLC-load-misses", "dTLB-load-misses".
+ * @return     event, NULL if not found.
+ */
+const struct sc_perf_event *sc_perf_event_find(const char *name);
+
+/**
+ * Close counters, regions are not accessible after this call.
+ * @param p perf
+ */
+void sc_perf_term(struct sc_perf *p);
+
+/**
+ * Start measuring a region. Values are added to the region with the same
+ * name, the name must stay valid until sc_perf_term(), e.g a string literal.
+ *
+ * @param p    perf
+ * @param name region name
+ * @return     '0' on success, negative if regions are nested deeper than
+ *             SC_PERF_MAX_DEPTH, there are more than SC_PERF_MAX_REGIONS
+ *             regions or counters can't be read.
+ */
+int sc_perf_enter(struct sc_perf *p, const char *name);
+
+/**
+ * Stop measuring the last region started with sc_perf_enter().
+ *
+ * @param p perf
+ * @return  '0' on success, negative if there is no active region or counters
+ *          can't be read.
+ */
+int sc_perf_leave(struct sc_perf *p);
+
+/**
+ * Same as sc_perf_leave(), records 'ops' operations for the region instead
+ * of one, e.g a region around a loop of 1000 lookups. Output formats report
+ * values per operation.
+ *
+ * @param p   perf
+ * @param ops operation count
+ * @return    '0' on success, negative if there is no active region or
+ *            counters can't be read.
+ */
+int sc_perf_leave_ops(struct sc_perf *p, uint64_t ops);
+
+/**
+ * @param p    perf
+ * @param name region name
+ * @return     region, NULL if there is no region with this name. Regions are
+ *             also accessible via p->regions[0 .. p->region_count).
+ */
+const struct sc_perf_region *sc_perf_region(struct sc_perf *p,
+                                            const char *name);
+
+#define SC_PERF_TEXT 0
+#define SC_PERF_CSV  1
+#define SC_PERF_JSON 2
+
+/**
+ * Print results of all regions.
+ *
+ * SC_PERF_TEXT : table for humans.
+ * SC_PERF_CSV  : one line per region and event,
+ *                region,calls,ops,time_ns,ratio,event,value,per_op
+ * SC_PERF_JSON : {"regions": [{"name": "lookup", "calls": 1, "ops": 1000,
+ *                 "time_ns": 5120, "ratio": 1.0, "events": {"instructions":
+ *                 {"value": 91000, "per_op": 91.0}, ...}}, ...]}
+ *
+ * 'ratio' is the multiplexing ratio, see struct sc_perf_region.
+ *
+ * @param p      perf
+ * @param fp     output, e.g stdout or a file for CI
+ * @param format SC_PERF_TEXT, SC_PERF_CSV or SC_PERF_JSON
+ * @return       '0' on success, negative on write failure or invalid format.
+ */
+int sc_perf_print(struct sc_perf *p, FILE *fp, int format);
+
+/**
+ * Clear results of all regions, there must be no active region.
+ * @param p perf
+ */
+void sc_perf_reset(struct sc_perf *p);
+
+/**
+ * @param p perf
+ * @return  last error string.
+ */
+const char *sc_perf_err(struct sc_perf *p);
+
 #endif
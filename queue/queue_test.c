@@ -61,6 +61,33 @@ void fail_test(void)
     sc_queue_destroy(q);
     assert(sc_queue_create(q, max + 100) == false);
     fail_realloc = false;
+
+    double arr[100] = {0};
+
+    assert(sc_queue_create(q, 0));
+    fail_realloc = true;
+    assert(sc_queue_add_last_n(q, arr, 100) == false);
+    assert(sc_queue_size(q) == 0);
+    fail_realloc = false;
+    assert(sc_queue_add_last_n(q, arr, 100) == true);
+    fail_realloc = true;
+    assert(sc_queue_add_last_n(q, arr, 100) == false);
+    assert(sc_queue_size(q) == 100);
+    assert(sc_queue_add_last_n(q, arr, max) == false);
+    assert(sc_queue_reserve(q, 1000) == false);
+    assert(sc_queue_reserve(q, 100) == true);
+    assert(sc_queue_shrink_to_fit(q) == true);
+    assert(sc_queue_size(q) == 100);
+    assert(sc_queue_cap(q) == 128);
+    sc_queue_skip(q, 90);
+    assert(sc_queue_shrink_to_fit(q) == false);
+    assert(sc_queue_shrink(q, 4) == false);
+    assert(sc_queue_cap(q) == 128);
+    fail_realloc = false;
+    assert(sc_queue_shrink(q, 4) == true);
+    assert(sc_queue_cap(q) == 32);
+    assert(sc_queue_size(q) == 10);
+    sc_queue_destroy(q);
 }
 #else
 void fail_test(void)
@@ -163,10 +190,212 @@ void test1(void)
     sc_queue_destroy(p);
 }
 
+void test_range(void)
+{
+    int *q;
+    int in[100], out[100];
+    size_t len, total;
+    int *p;
+
+    for (int i = 0; i < 100; i++) {
+        in[i] = i;
+    }
+
+    assert(sc_queue_create(q, 0));
+    assert(sc_queue_add_last_n(q, in, 0) == true);
+    assert(sc_queue_del_first_n(q, out, 10) == 0);
+    sc_queue_span(q, &len);
+    assert(len == 0);
+
+    assert(sc_queue_add_last_n(q, in, 10) == true);
+    assert(sc_queue_size(q) == 10);
+    assert(sc_queue_cap(q) == 16);
+    assert(sc_queue_del_first_n(q, out, 4) == 4);
+    for (int i = 0; i < 4; i++) {
+        assert(out[i] == i);
+    }
+
+    // Wraps around : first = 4, last = 2
+    assert(sc_queue_add_last_n(q, in + 10, 8) == true);
+    assert(sc_queue_cap(q) == 16);
+    assert(sc_queue_size(q) == 14);
+    for (int i = 0; i < 14; i++) {
+        assert(sc_queue_at(q, i) == i + 4);
+    }
+
+    p = sc_queue_span(q, &len);
+    assert(len == 12);
+    assert(p[0] == 4 && p[11] == 15);
+    sc_queue_skip(q, len);
+    p = sc_queue_span(q, &len);
+    assert(len == 2);
+    assert(p[0] == 16 && p[1] == 17);
+
+    // Grow while wrapped, order must be preserved.
+    sc_queue_add_first(q, 15);
+    sc_queue_add_first(q, 14);
+    assert(sc_queue_add_last_n(q, in + 18, 30) == true);
+    assert(sc_queue_cap(q) == 64);
+    assert(sc_queue_size(q) == 34);
+    for (int i = 0; i < 34; i++) {
+        assert(sc_queue_at(q, i) == i + 14);
+    }
+
+    assert(sc_queue_del_first_n(q, out, 100) == 34);
+    for (int i = 0; i < 34; i++) {
+        assert(out[i] == i + 14);
+    }
+    assert(sc_queue_empty(q));
+
+    // Mixed with single element operations.
+    total = 0;
+    for (int i = 0; i < 1000; i++) {
+        assert(sc_queue_add_last_n(q, in, (size_t) (i % 100)) == true);
+        assert(sc_queue_add_last(q, -1) == true);
+        total += (size_t) (i % 100);
+
+        len = sc_queue_del_first_n(q, out, (size_t) (i % 100));
+        assert(len == (size_t) (i % 100));
+        assert(sc_queue_del_first(q) == -1);
+        for (size_t j = 0; j < len; j++) {
+            assert(out[j] == (int) j);
+        }
+    }
+    assert(total > 0);
+    assert(sc_queue_empty(q));
+    sc_queue_destroy(q);
+}
+
+void test_shrink(void)
+{
+    int *q;
+
+    assert(sc_queue_create(q, 0));
+    assert(sc_queue_shrink_to_fit(q) == true);
+    assert(sc_queue_shrink(q, 4) == true);
+    assert(sc_queue_reserve(q, 0) == true);
+    assert(sc_queue_cap(q) == 1);
+
+    assert(sc_queue_reserve(q, 100) == true);
+    assert(sc_queue_cap(q) == 128);
+    assert(sc_queue_reserve(q, 127) == true);
+    assert(sc_queue_cap(q) == 128);
+    assert(sc_queue_reserve(q, 128) == true);
+    assert(sc_queue_cap(q) == 256);
+
+    for (int i = 0; i < 255; i++) {
+        assert(sc_queue_add_last(q, i) == true);
+    }
+    assert(sc_queue_cap(q) == 256);
+
+    // Wrap the ring : first = 250, last = 5
+    for (int i = 0; i < 250; i++) {
+        assert(sc_queue_del_first(q) == i);
+    }
+    for (int i = 255; i < 261; i++) {
+        assert(sc_queue_add_last(q, i) == true);
+    }
+    assert(sc_queue_first(q) > sc_queue_last(q));
+    assert(sc_queue_size(q) == 11);
+
+    // Not below threshold, nothing to do.
+    assert(sc_queue_shrink(q, 32) == true);
+    assert(sc_queue_cap(q) == 256);
+
+    assert(sc_queue_shrink(q, 4) == true);
+    assert(sc_queue_cap(q) == 32);
+    assert(sc_queue_size(q) == 11);
+    for (int i = 0; i < 11; i++) {
+        assert(sc_queue_at(q, i) == i + 250);
+    }
+
+    assert(sc_queue_shrink_to_fit(q) == true);
+    assert(sc_queue_cap(q) == 16);
+    assert(sc_queue_first(q) == 0);
+    assert(sc_queue_last(q) == 11);
+    for (int i = 0; i < 11; i++) {
+        assert(sc_queue_del_first(q) == i + 250);
+    }
+
+    assert(sc_queue_add_last(q, 1) == true);
+    assert(sc_queue_add_first(q, 0) == true);
+    assert(sc_queue_shrink_to_fit(q) == true);
+    assert(sc_queue_cap(q) == 4);
+    assert(sc_queue_del_first(q) == 0);
+    assert(sc_queue_del_first(q) == 1);
+
+    // Empty queue releases its memory and can be used again.
+    assert(sc_queue_shrink_to_fit(q) == true);
+    assert(sc_queue_cap(q) == 1);
+    assert(sc_queue_add_last(q, 7) == true);
+    assert(sc_queue_peek_first(q) == 7);
+    sc_queue_destroy(q);
+
+    // Header writes are safe after releasing the memory.
+    assert(sc_queue_create(q, 8));
+    assert(sc_queue_add_last(q, 1) == true);
+    assert(sc_queue_del_first(q) == 1);
+    assert(sc_queue_shrink(q, 2) == true);
+    sc_queue_clear(q);
+    sc_queue_skip(q, 0);
+    assert(sc_queue_empty(q));
+    assert(sc_queue_add_last(q, 2) == true);
+    sc_queue_clear(q);
+    assert(sc_queue_empty(q));
+    sc_queue_destroy(q);
+}
+
+void test_wrap(void)
+{
+    int *q, out[8], vals[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    unsigned char mem[sc_queue_mem_size(int, 8) + 1];
+
+    assert(!sc_queue_wrap(q, mem, sizeof(struct sc_queue) + sizeof(int)));
+    assert(q == NULL);
+
+    assert(sc_queue_wrap(q, mem + 1, sizeof(mem) - 1));
+    assert(((uintptr_t) q % SC_QUEUE_MEM_ALIGN) == 0);
+    assert(sc_queue_cap(q) == 8);
+    assert(sc_queue_wrap(q, mem, sizeof(mem)));
+    assert(sc_queue_cap(q) == 8);
+
+    for (int i = 0; i < 7; i++) {
+        assert(sc_queue_add_last(q, i) == true);
+    }
+
+    // Full, nothing is allocated.
+    assert(sc_queue_add_last(q, 100) == false);
+    assert(sc_queue_add_first(q, 100) == false);
+    assert(sc_queue_add_last_n(q, vals, 1) == false);
+    assert(sc_queue_reserve(q, 8) == false);
+    assert(sc_queue_reserve(q, 7) == true);
+    assert(sc_queue_shrink_to_fit(q) == true);
+    assert(sc_queue_cap(q) == 8);
+    assert(sc_queue_size(q) == 7);
+
+    // Wraps around the fixed ring.
+    for (int i = 0; i < 100; i++) {
+        assert(sc_queue_del_first(q) == i);
+        assert(sc_queue_add_last(q, i + 7) == true);
+    }
+
+    assert(sc_queue_del_first_n(q, out, 8) == 7);
+    assert(out[0] == 100 && out[6] == 106);
+    assert(sc_queue_empty(q));
+    assert(sc_queue_add_last_n(q, vals, 7) == true);
+    assert(sc_queue_peek_last(q) == 6);
+
+    sc_queue_destroy(q);
+    assert(q == NULL);
+}
+
 int main()
 {
     fail_test();
     example();
     test1();
+    test_range();
+    test_shrink();
+    test_wrap();
     return 0;
 }
@@ -24,13 +24,44 @@
 
 #include "sc_queue.h"
 
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
 #ifndef SC_SIZE_MAX
     #define SC_SIZE_MAX SIZE_MAX
 #endif
 
+#ifdef SC_STATS
+    #include "sc_stats.h"
+#elif !defined(SC_STATS_ADD)
+    #define SC_STATS_ADD(name, n) ((void) (n))
+    #define SC_STATS_MAX(name, v) ((void) (v))
+#endif
+
 #define SC_MAX_CAP ((SC_SIZE_MAX - sizeof(struct sc_queue)) / 2ul)
 
-static const struct sc_queue sc_empty = {.cap = 1, .first = 0, .last = 0};
+static const struct sc_queue sc_empty_queue = {.cap = 1, .first = 0, .last = 0};
+
+// Next power of two >= v, for 2 <= v <= SIZE_MAX / 2 + 1.
+static size_t queue_pow2(size_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t) 1 << (sizeof(unsigned long long) * 8 -
+                          (size_t) __builtin_clzll(v - 1));
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanReverse64(&index, v - 1);
+    return (size_t) 1 << (index + 1);
+#else
+    v--;
+    for (size_t i = 1; i < sizeof(v) * 8; i *= 2) {
+        v |= v >> i;
+    }
+
+    return v + 1;
+#endif
+}
 
 static void *queue_alloc(void *prev, size_t elem_size, size_t *cap)
 {
@@ -40,13 +71,7 @@ static void *queue_alloc(void *prev, size_t elem_size, size_t *cap)
         return NULL;
     }
 
-    // Find next power of two.
-    v = v < 4 ? 4 : v;
-    v--;
-    for (size_t i = 1; i < sizeof(v) * 8; i *= 2) {
-        v |= v >> i;
-    }
-    v++;
+    v = queue_pow2(v < 4 ? 4 : v);
 
     *cap = v;
     alloc = sizeof(struct sc_queue) + (elem_size * v);
@@ -61,7 +86,7 @@ bool sc_queue_init(void *q, size_t elem_size, size_t cap)
     struct sc_queue *meta;
 
     if (cap == 0) {
-        *ptr = (void *) sc_empty.elems;
+        *ptr = (void *) sc_empty_queue.elems;
         return true;
     }
 
@@ -74,6 +99,37 @@ bool sc_queue_init(void *q, size_t elem_size, size_t cap)
     meta->cap = p;
     meta->first = 0;
     meta->last = 0;
+    meta->ref = 0;
+    *ptr = meta->elems;
+
+    return true;
+}
+
+bool sc_queue_init_mem(void *q, size_t elem_size, void *mem, size_t len)
+{
+    size_t pad, cap = 2;
+    void **ptr = q;
+    struct sc_queue *meta;
+
+    *ptr = NULL;
+
+    pad = (SC_QUEUE_MEM_ALIGN - ((uintptr_t) mem & (SC_QUEUE_MEM_ALIGN - 1))) &
+          (SC_QUEUE_MEM_ALIGN - 1);
+
+    if (len < pad + sizeof(*meta) + cap * elem_size) {
+        return false;
+    }
+
+    len = (len - pad - sizeof(*meta)) / elem_size;
+    while (cap <= len / 2) {
+        cap *= 2;
+    }
+
+    meta = (struct sc_queue *) (void *) ((char *) mem + pad);
+    meta->cap = cap;
+    meta->first = 0;
+    meta->last = 0;
+    meta->ref = 1;
     *ptr = meta->elems;
 
     return true;
@@ -90,7 +146,7 @@ void sc_queue_term(void *q)
 
     meta = sc_queue_meta(*ptr);
 
-    if (meta != &sc_empty) {
+    if (meta != &sc_empty_queue && !meta->ref) {
         sc_queue_free(meta);
     }
 
@@ -107,16 +163,22 @@ bool sc_queue_expand(void *q, size_t elem_size)
     uint8_t *e;
 
     if (pos == meta->first) {
-        if (meta == &sc_empty) {
+        if (meta == &sc_empty_queue) {
             return sc_queue_init(ptr, elem_size, 4);
         }
 
+        if (meta->ref) {
+            return false;
+        }
+
         cap = meta->cap * 2;
         tmp = queue_alloc(meta, elem_size, &cap);
         if (tmp == NULL) {
             return false;
         }
 
+        SC_STATS_ADD("queue.expand", 1);
+
         /**
          * Move items to make empty slots at the end.
          *
@@ -159,3 +221,166 @@ bool sc_queue_expand(void *q, size_t elem_size)
 
     return true;
 }
+
+/**
+ * Makes room for 'n' more elements. After realloc(), if the ring is wrapped,
+ * the part from 'first' to the old end is moved to the new end, so elements
+ * keep their order without linearizing the whole ring.
+ */
+static bool sc_queue_grow(void **ptr, size_t elem_size, size_t n)
+{
+    struct sc_queue *tmp, *meta = sc_queue_meta(*ptr);
+    size_t cap, count, size = (meta->last - meta->first) & (meta->cap - 1);
+    void *elems;
+    uint8_t *e;
+
+    if (n > SC_MAX_CAP - size - 1) {
+        return false;
+    }
+
+    cap = size + n + 1;
+    if (cap <= meta->cap) {
+        return true;
+    }
+
+    if (meta->ref) {
+        return false;
+    }
+
+    if (meta == &sc_empty_queue) {
+        if (!sc_queue_init(&elems, elem_size, cap)) {
+            return false;
+        }
+
+        *ptr = elems;
+        return true;
+    }
+
+    tmp = queue_alloc(meta, elem_size, &cap);
+    if (tmp == NULL) {
+        return false;
+    }
+
+    if (tmp->last < tmp->first) {
+        e = tmp->elems;
+        count = tmp->cap - tmp->first;
+
+        memmove(e + (cap - count) * elem_size, e + tmp->first * elem_size,
+                count * elem_size);
+        tmp->first = cap - count;
+    }
+
+    tmp->cap = cap;
+    *ptr = tmp->elems;
+
+    return true;
+}
+
+bool sc_queue_add_n(void *q, size_t elem_size, const void *elems, size_t n)
+{
+    void **ptr = q;
+    struct sc_queue *meta;
+    size_t count;
+
+    if (n == 0) {
+        return true;
+    }
+
+    if (!sc_queue_grow(ptr, elem_size, n)) {
+        return false;
+    }
+
+    meta = sc_queue_meta(*ptr);
+    count = meta->cap - meta->last;
+    count = count < n ? count : n;
+
+    memcpy(meta->elems + meta->last * elem_size, elems, count * elem_size);
+    memcpy(meta->elems, (const uint8_t *) elems + count * elem_size,
+           (n - count) * elem_size);
+
+    meta->last = (meta->last + n) & (meta->cap - 1);
+
+    return true;
+}
+
+size_t sc_queue_del_n(void *q, size_t elem_size, void *elems, size_t n)
+{
+    struct sc_queue *meta = sc_queue_meta(q);
+    size_t count, size = (meta->last - meta->first) & (meta->cap - 1);
+
+    n = n < size ? n : size;
+    if (n == 0) {
+        return 0;
+    }
+
+    count = meta->cap - meta->first;
+    count = count < n ? count : n;
+
+    memcpy(elems, meta->elems + meta->first * elem_size, count * elem_size);
+    memcpy((uint8_t *) elems + count * elem_size, meta->elems,
+           (n - count) * elem_size);
+
+    meta->first = (meta->first + n) & (meta->cap - 1);
+
+    return n;
+}
+
+bool sc_queue_reserve_(void *q, size_t elem_size, size_t n)
+{
+    void **ptr = q;
+    struct sc_queue *meta = sc_queue_meta(*ptr);
+    size_t size = (meta->last - meta->first) & (meta->cap - 1);
+
+    return n <= size ? true : sc_queue_grow(ptr, elem_size, n - size);
+}
+
+bool sc_queue_shrink_(void *q, size_t elem_size, size_t threshold)
+{
+    void **ptr = q;
+    struct sc_queue *tmp, *meta = sc_queue_meta(*ptr);
+    size_t count, cap, size = (meta->last - meta->first) & (meta->cap - 1);
+
+    if (meta == &sc_empty_queue || meta->ref) {
+        return true;
+    }
+
+    if (threshold != 0 && size >= meta->cap / threshold) {
+        return true;
+    }
+
+    if (size == 0) {
+        sc_queue_free(meta);
+        *ptr = (void *) sc_empty_queue.elems;
+        return true;
+    }
+
+    // Leave room for growing back to the threshold when shrinking by ratio.
+    count = threshold != 0 ? (size + 1) * 2 : size + 1;
+    cap = queue_pow2(count < 4 ? 4 : count);
+
+    if (cap >= meta->cap) {
+        return true;
+    }
+
+    tmp = queue_alloc(NULL, elem_size, &cap);
+    if (tmp == NULL) {
+        return false;
+    }
+
+    count = meta->cap - meta->first;
+    count = count < size ? count : size;
+
+    memcpy(tmp->elems, meta->elems + meta->first * elem_size,
+           count * elem_size);
+    memcpy(tmp->elems + count * elem_size, meta->elems,
+           (size - count) * elem_size);
+
+    tmp->cap = cap;
+    tmp->first = 0;
+    tmp->last = size;
+    tmp->ref = 0;
+    *ptr = tmp->elems;
+    sc_queue_free(meta);
+
+    return true;
+}
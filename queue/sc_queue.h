@@ -45,9 +45,13 @@ struct sc_queue
     size_t cap;
     size_t first;
     size_t last;
+    size_t ref;
     unsigned char elems[];
 };
 
+// Alignment of the header and elements in sc_queue_wrap() memory.
+#define SC_QUEUE_MEM_ALIGN 16
+
 #define sc_queue_meta(q)                                                       \
     ((struct sc_queue *) ((char *) (q) -offsetof(struct sc_queue, elems)))
 
@@ -86,8 +90,35 @@ static inline size_t sc_queue_dec_last(void *q)
 }
 
 bool sc_queue_init(void *q, size_t elem_size, size_t cap);
+bool sc_queue_init_mem(void *q, size_t elem_size, void *mem, size_t len);
 void sc_queue_term(void *q);
 bool sc_queue_expand(void *q, size_t elem_size);
+bool sc_queue_add_n(void *q, size_t elem_size, const void *elems, size_t n);
+size_t sc_queue_del_n(void *q, size_t elem_size, void *elems, size_t n);
+bool sc_queue_reserve_(void *q, size_t elem_size, size_t n);
+bool sc_queue_shrink_(void *q, size_t elem_size, size_t threshold);
+
+static inline void sc_queue_skip_(void *q, size_t n)
+{
+    struct sc_queue *meta = sc_queue_meta(q);
+
+    // Empty queue may point to the shared read-only header.
+    if (n != 0) {
+        meta->first = (meta->first + n) & (meta->cap - 1);
+    }
+}
+
+static inline void *sc_queue_span_(void *q, size_t elem_size, size_t *len)
+{
+    struct sc_queue *meta = sc_queue_meta(q);
+
+    *len = meta->last >= meta->first ? meta->last - meta->first :
+                                       meta->cap - meta->first;
+    return (char *) q + (meta->first * elem_size);
+}
+
+// Compile time type check, 'elems' must point to the queue's element type.
+#define sc_queue_check(q, elems) ((void) sizeof(*(q) = *(elems)), (elems))
 
 /**
  *   @param q     queue
@@ -96,12 +127,77 @@ bool sc_queue_expand(void *q, size_t elem_size);
  */
 #define sc_queue_create(q, count) sc_queue_init(&(q), sizeof(*(q)), count)
 
+/**
+ *   Bytes of memory for a fixed capacity queue of 'cap' slots of type 'T',
+ *   header and alignment padding included. 'cap' should be a power of two,
+ *   queue holds 'cap - 1' elements, e.g for a stack buffer :
+ *
+ *   int *q;
+ *   unsigned char mem[sc_queue_mem_size(int, 64)];
+ *
+ *   sc_queue_wrap(q, mem, sizeof(mem)); // Holds 63 elements.
+ */
+#define sc_queue_mem_size(T, cap)                                              \
+    (sizeof(struct sc_queue) + SC_QUEUE_MEM_ALIGN - 1 + sizeof(T) * (cap))
+
+/**
+ *   Create a fixed capacity queue in caller provided memory, e.g stack or
+ *   memory allocated at startup. Queue never allocates : adding elements
+ *   fails when it is full, reserve fails if elements don't fit, shrink is a
+ *   no-op and sc_queue_destroy() does not free 'mem'.
+ *
+ *   @param q   queue
+ *   @param mem memory, must outlive the queue.
+ *   @param len length of 'mem', capacity is the largest power of two that
+ *              fits after the header.
+ *   @return    'true' on success, 'false' if 'mem' is too small for two slots.
+ */
+#define sc_queue_wrap(q, mem, len)                                             \
+    sc_queue_init_mem(&(q), sizeof(*(q)), mem, len)
+
 /**
  *   Destroy queue
  *   @param q queue
  */
 #define sc_queue_destroy(q) sc_queue_term((&(q)))
 
+/**
+ * Make sure queue can hold 'n' elements without allocating memory. Capacity
+ * is a power of two and one slot is kept empty, so capacity may be greater
+ * than 'n'.
+ *
+ *   @param q queue
+ *   @param n element count
+ *   @return  'true' on success, 'false' on out of memory.
+ */
+#define sc_queue_reserve(q, n) sc_queue_reserve_(&(q), sizeof(*(q)), n)
+
+/**
+ * Reallocate the queue into the smallest power of two capacity that holds the
+ * current elements. If the queue is empty, memory is released. Elements are
+ * moved to the start of the new allocation, indexes from sc_queue_first(),
+ * sc_queue_last() and pointers from sc_queue_span() are invalidated.
+ *
+ *   @param q queue
+ *   @return  'true' on success, 'false' on out of memory, queue is unchanged.
+ */
+#define sc_queue_shrink_to_fit(q) sc_queue_shrink_(&(q), sizeof(*(q)), 0)
+
+/**
+ * Shrink the queue if it's using less than 1/threshold of its capacity, e.g
+ * with threshold '4', a queue with 1024 slots shrinks once it has less than
+ * 256 elements. Some headroom is left after shrinking, so a queue oscillating
+ * around the threshold does not reallocate on every call. Intended to be
+ * called periodically, e.g after draining the queue.
+ *
+ *   @param q         queue
+ *   @param threshold ratio of capacity to size, must be greater than '1'.
+ *   @return          'true' on success or if there is nothing to do, 'false'
+ *                    on out of memory, queue is unchanged.
+ */
+#define sc_queue_shrink(q, threshold)                                          \
+    sc_queue_shrink_(&(q), sizeof(*(q)), threshold)
+
 /**
  *   @param q queue
  *   @return  current capacity
@@ -123,13 +219,16 @@ bool sc_queue_expand(void *q, size_t elem_size);
 #define sc_queue_empty(q) ((sc_queue_meta(q)->last == sc_queue_meta(q)->first))
 
 /**
- * Clear the queue without deallocating underlying memory.
+ * Clear the queue without deallocating underlying memory. No-op if the queue is
+ * empty, an empty queue may point to the shared read-only header.
  * @param q queue
  */
 #define sc_queue_clear(q)                                                      \
     do {                                                                       \
-        sc_queue_meta(q)->first = 0;                                           \
-        sc_queue_meta(q)->last = 0;                                            \
+        if (!sc_queue_empty(q)) {                                              \
+            sc_queue_meta(q)->first = 0;                                       \
+            sc_queue_meta(q)->last = 0;                                        \
+        }                                                                      \
     } while (0)
 
 /**
@@ -210,6 +309,58 @@ bool sc_queue_expand(void *q, size_t elem_size);
  */
 #define sc_queue_del_first(q) (q)[sc_queue_inc_first((q))]
 
+/**
+ * Add 'n' elements to the end of the queue, at most two memcpy() calls.
+ *
+ * @param q     queue
+ * @param elems pointer to 'n' elements
+ * @param n     element count
+ * @return      'true' on success, 'false' on out of memory.
+ */
+#define sc_queue_add_last_n(q, elems, n)                                       \
+    sc_queue_add_n(&(q), sizeof(*(q)), sc_queue_check(q, elems), n)
+
+/**
+ * Delete up to 'n' elements from the head of the queue and copy them into
+ * 'elems', at most two memcpy() calls.
+ *
+ * @param q     queue
+ * @param elems destination, must have room for 'n' elements
+ * @param n     max element count
+ * @return      number of elements copied into 'elems'.
+ */
+#define sc_queue_del_first_n(q, elems, n)                                      \
+    sc_queue_del_n((q), sizeof(*(q)), sc_queue_check(q, elems), n)
+
+/**
+ * Zero-copy access to the head of the queue. Returns a pointer to the first
+ * element and sets 'len' to the number of contiguous elements starting from
+ * it. If the ring wraps, the rest of the elements are reachable by calling
+ * sc_queue_span() again after sc_queue_skip().
+ *
+ *  size_t len;
+ *  int *p;
+ *
+ *  while ((p = sc_queue_span(queue, &len)), len > 0) {
+ *      consume(p, len);
+ *      sc_queue_skip(queue, len);
+ *  }
+ *
+ * @param q   queue
+ * @param len out param, contiguous element count, '0' if queue is empty.
+ * @return    pointer to the first element.
+ */
+#define sc_queue_span(q, len) sc_queue_span_((q), sizeof(*(q)), len)
+
+/**
+ * Delete 'n' elements from the head of the queue without copying them.
+ * 'n' must not be greater than sc_queue_size(q).
+ *
+ * @param q queue
+ * @param n element count
+ */
+#define sc_queue_skip(q, n) sc_queue_skip_((q), n)
+
 /**
  *  For each loop,
  *
@@ -0,0 +1,62 @@
+#include "sc_reactor.h"
+#include "sc_time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Echo server, one loop per core, connect with 'nc 127.0.0.1 8080'
+
+struct conn
+{
+    struct sc_sock sock;
+};
+
+static void on_accept(struct sc_reactor_loop *loop, struct sc_sock *sock)
+{
+    struct conn *c = malloc(sizeof(*c));
+
+    if (c == NULL) {
+        sc_sock_term(sock);
+        return;
+    }
+
+    c->sock = *sock;
+    sc_sock_poll_add(&loop->poll, &c->sock.fdt, SC_SOCK_READ, c);
+    printf("Loop[%u] accepted connection \n", loop->index);
+}
+
+static void on_event(struct sc_reactor_loop *loop, void *data, uint32_t events)
+{
+    int rc;
+    char buf[1024];
+    struct conn *c = data;
+
+    (void) events;
+
+    rc = sc_sock_recv(&c->sock, buf, sizeof(buf), 0);
+    if (rc > 0) {
+        sc_sock_send(&c->sock, buf, rc, 0);
+    } else if (rc == SC_SOCK_ERROR) {
+        sc_sock_poll_del(&loop->poll, &c->sock.fdt, SC_SOCK_READ, c);
+        sc_sock_term(&c->sock);
+        free(c);
+    }
+}
+
+int main()
+{
+    struct sc_reactor r;
+    struct sc_reactor_cb cb = {.accept = on_accept, .event = on_event};
+
+    if (sc_reactor_init(&r, 4, SC_REACTOR_REUSEPORT, SC_SOCK_INET,
+                        "127.0.0.1", "8080", cb) != 0) {
+        printf("%s \n", sc_reactor_err(&r));
+        return -1;
+    }
+
+    sc_reactor_start(&r);
+    sc_time_sleep(10000);
+    sc_reactor_term(&r);
+
+    return 0;
+}
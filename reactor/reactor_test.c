@@ -0,0 +1,224 @@
+#include "sc_reactor.h"
+#include "sc_time.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIENTS 8
+#define LOOPS   4
+
+struct stats
+{
+    int accepted;
+    int closed;
+    int timeouts;
+};
+
+struct conn
+{
+    struct sc_sock sock;
+};
+
+static struct stats stats[LOOPS];
+
+static void on_accept(struct sc_reactor_loop *loop, struct sc_sock *sock)
+{
+    struct stats *st = loop->data;
+    struct conn *c = malloc(sizeof(*c));
+
+    assert(c != NULL);
+    c->sock = *sock;
+
+    assert(sc_sock_poll_add(&loop->poll, &c->sock.fdt, SC_SOCK_READ, c) == 0);
+    assert(sc_reactor_timer_add(loop, 10, 7, st) != SC_TIMER_INVALID);
+    st->accepted++;
+}
+
+static void on_event(struct sc_reactor_loop *loop, void *data, uint32_t events)
+{
+    int rc;
+    char buf[5];
+    struct conn *c = data;
+    struct stats *st = loop->data;
+
+    assert(events & SC_SOCK_READ);
+
+    rc = sc_sock_recv(&c->sock, buf, sizeof(buf), 0);
+    if (rc == sizeof(buf)) {
+        assert(strcmp(buf, "ping") == 0);
+        assert(sc_sock_send(&c->sock, "pong", 5, 0) == 5);
+    } else if (rc == SC_SOCK_ERROR) {
+        assert(sc_sock_poll_del(&loop->poll, &c->sock.fdt, SC_SOCK_READ, c) ==
+               0);
+        assert(sc_sock_term(&c->sock) == 0);
+        free(c);
+        st->closed++;
+    }
+}
+
+static void on_timeout(struct sc_reactor_loop *loop, uint64_t type, void *data)
+{
+    assert(type == 7);
+    assert(data == loop->data);
+    stats[loop->index].timeouts++;
+}
+
+static void clients(int family, const char *host, const char *port)
+{
+    char buf[5];
+    struct sc_sock sock;
+
+    for (int i = 0; i < CLIENTS; i++) {
+        sc_sock_init(&sock, 0, true, family);
+        assert(sc_sock_connect(&sock, host, port, NULL, NULL) == 0);
+        assert(sc_sock_send(&sock, "ping", 5, 0) == 5);
+        assert(sc_sock_recv(&sock, buf, sizeof(buf), 0) == 5);
+        assert(strcmp(buf, "pong") == 0);
+        assert(sc_sock_term(&sock) == 0);
+    }
+
+    // Let loops see the disconnects and run the timers
+    sc_time_sleep(200);
+}
+
+static void test_mode(enum sc_reactor_mode mode, int family, const char *host,
+                      const char *port)
+{
+    int accepted = 0;
+    struct sc_reactor r;
+    struct sc_reactor_cb cb = {
+            .accept = on_accept,
+            .event = on_event,
+            .timeout = on_timeout,
+    };
+
+    memset(stats, 0, sizeof(stats));
+
+    assert(sc_reactor_init(&r, LOOPS, mode, family, host, port, cb) == 0);
+    assert(r.count == LOOPS);
+#if defined(__linux__)
+    assert(r.mode == (family == SC_SOCK_UNIX ? SC_REACTOR_ACCEPTOR : mode));
+#endif
+
+    for (uint32_t i = 0; i < r.count; i++) {
+        r.loops[i].data = &stats[i];
+    }
+
+    assert(sc_reactor_start(&r) == 0);
+    assert(sc_reactor_start(&r) != 0);
+
+    clients(family, host, port);
+
+    assert(sc_reactor_stop(&r) == 0);
+    assert(sc_reactor_term(&r) == 0);
+
+    for (int i = 0; i < LOOPS; i++) {
+        assert(stats[i].accepted == stats[i].closed);
+        assert(stats[i].accepted == stats[i].timeouts);
+        accepted += stats[i].accepted;
+
+        // Round-robin
+        if (r.mode == SC_REACTOR_ACCEPTOR) {
+            assert(stats[i].accepted == CLIENTS / LOOPS);
+        }
+    }
+
+    assert(accepted == CLIENTS);
+}
+
+void test1(void)
+{
+    struct sc_reactor r;
+    struct sc_reactor_cb cb = {0};
+
+    test_mode(SC_REACTOR_ACCEPTOR, SC_SOCK_INET, "127.0.0.1", "8014");
+    test_mode(SC_REACTOR_REUSEPORT, SC_SOCK_INET, "127.0.0.1", "8015");
+#if !defined(_WIN32) && !defined(__APPLE__)
+    test_mode(SC_REACTOR_REUSEPORT, SC_SOCK_UNIX, "reactor.sock", NULL);
+#endif
+
+    // Loops without a listener
+    assert(sc_reactor_init(&r, 0, SC_REACTOR_REUSEPORT, SC_SOCK_INET, NULL,
+                           NULL, cb) == 0);
+    assert(r.count == 1);
+    assert(sc_reactor_start(&r) == 0);
+    assert(sc_reactor_term(&r) == 0);
+
+    // Terminate without start
+    assert(sc_reactor_init(&r, 2, SC_REACTOR_ACCEPTOR, SC_SOCK_INET, NULL, NULL,
+                           cb) == 0);
+    assert(sc_reactor_term(&r) == 0);
+
+    assert(sc_reactor_init(&r, 2, SC_REACTOR_ACCEPTOR, SC_SOCK_INET,
+                           "invalid host", "8016", cb) != 0);
+    assert(strlen(sc_reactor_err(&r)) > 0);
+    assert(r.loops == NULL);
+}
+
+#ifdef SC_HAVE_WRAP
+
+int fail_calloc = -1;
+void *__real_calloc(size_t n, size_t size);
+void *__wrap_calloc(size_t n, size_t size)
+{
+    if (fail_calloc == 0) {
+        return NULL;
+    }
+
+    if (fail_calloc > 0) {
+        fail_calloc--;
+    }
+
+    return __real_calloc(n, size);
+}
+
+int fail_malloc = -1;
+void *__real_malloc(size_t n);
+void *__wrap_malloc(size_t n)
+{
+    if (fail_malloc == 0) {
+        return NULL;
+    }
+
+    if (fail_malloc > 0) {
+        fail_malloc--;
+    }
+
+    return __real_malloc(n);
+}
+
+void fail_test(void)
+{
+    struct sc_reactor r;
+    struct sc_reactor_cb cb = {0};
+
+    fail_calloc = 0;
+    assert(sc_reactor_init(&r, 4, SC_REACTOR_ACCEPTOR, SC_SOCK_INET, NULL,
+                           NULL, cb) != 0);
+    fail_calloc = -1;
+
+    // Second loop fails, first one is cleaned up
+    for (int i = 0; i < 4; i++) {
+        fail_malloc = i;
+        assert(sc_reactor_init(&r, 2, SC_REACTOR_ACCEPTOR, SC_SOCK_INET,
+                               NULL, NULL, cb) != 0);
+        assert(r.loops == NULL);
+    }
+    fail_malloc = -1;
+}
+
+#else
+void fail_test(void)
+{
+}
+#endif
+
+int main()
+{
+    test1();
+    fail_test();
+
+    return 0;
+}
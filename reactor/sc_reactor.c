@@ -0,0 +1,444 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#if defined(__linux__)
+    #ifndef _GNU_SOURCE
+        #define _GNU_SOURCE
+    #endif
+#endif
+
+#include "sc_reactor.h"
+#include "sc_time.h"
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Connection handed over to another loop, stop message is 'loop->stop'
+struct sc_reactor_msg
+{
+    struct sc_sock_notify_node node;
+    struct sc_sock sock;
+};
+
+static void sc_reactor_set_err(char *err, size_t len, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(err, len, fmt, args);
+    va_end(args);
+
+    err[len - 1] = '\0';
+}
+
+static int sc_reactor_loop_init(struct sc_reactor_loop *loop,
+                                struct sc_reactor *r, uint32_t index,
+                                int family, const char *host, const char *port)
+{
+    int rc;
+    const char *err;
+
+    loop->reactor = r;
+    loop->index = index;
+
+    sc_thread_init(&loop->thread);
+    sc_sock_init(&loop->listener, 0, false, family);
+
+    if (!sc_timer_init(&loop->timer, sc_time_mono_ms())) {
+        sc_reactor_set_err(r->err, sizeof(r->err), "Out of memory.");
+        return -1;
+    }
+
+    rc = sc_sock_poll_init(&loop->poll);
+    if (rc != 0) {
+        sc_reactor_set_err(r->err, sizeof(r->err), "poll : %s",
+                           sc_sock_poll_err(&loop->poll));
+        goto error_poll;
+    }
+
+    rc = sc_sock_notify_init(&loop->notify, &loop->poll, &loop->notify);
+    if (rc != 0) {
+        sc_reactor_set_err(r->err, sizeof(r->err), "notify : %s",
+                           sc_sock_notify_err(&loop->notify));
+        goto error_notify;
+    }
+
+    if (host == NULL || (r->mode == SC_REACTOR_ACCEPTOR && index != 0)) {
+        return 0;
+    }
+
+    if (r->mode == SC_REACTOR_REUSEPORT) {
+        rc = sc_sock_listen_reuseport(&loop->listener, host, port);
+    } else {
+        rc = sc_sock_listen(&loop->listener, host, port);
+    }
+
+    if (rc != 0) {
+        err = sc_sock_error(&loop->listener);
+        goto error_listener;
+    }
+
+    rc = sc_sock_poll_add(&loop->poll, &loop->listener.fdt, SC_SOCK_READ,
+                          &loop->listener);
+    if (rc != 0) {
+        err = sc_sock_poll_err(&loop->poll);
+        goto error_listener;
+    }
+
+    return 0;
+
+error_listener:
+    sc_reactor_set_err(r->err, sizeof(r->err), "listener : %s", err);
+    sc_sock_term(&loop->listener);
+    sc_sock_notify_term(&loop->notify);
+error_notify:
+    sc_sock_poll_term(&loop->poll);
+error_poll:
+    sc_timer_term(&loop->timer);
+    return -1;
+}
+
+static int sc_reactor_loop_term(struct sc_reactor_loop *loop)
+{
+    int rc = 0;
+    struct sc_reactor *r = loop->reactor;
+    struct sc_sock_notify_node *node;
+    struct sc_reactor_msg *msg;
+
+    // Connections handed over after the loop is stopped
+    while ((node = sc_sock_notify_pop(&loop->notify)) != NULL) {
+        if (node != &loop->stop) {
+            msg = (struct sc_reactor_msg *) node;
+            sc_sock_term(&msg->sock);
+            sc_reactor_free(msg);
+        }
+    }
+
+    if (sc_sock_term(&loop->listener) != 0) {
+        sc_reactor_set_err(r->err, sizeof(r->err), "listener : %s",
+                           sc_sock_error(&loop->listener));
+        rc = -1;
+    }
+
+    if (sc_sock_notify_term(&loop->notify) != 0) {
+        sc_reactor_set_err(r->err, sizeof(r->err), "notify : %s",
+                           sc_sock_notify_err(&loop->notify));
+        rc = -1;
+    }
+
+    if (sc_sock_poll_term(&loop->poll) != 0) {
+        sc_reactor_set_err(r->err, sizeof(r->err), "poll : %s",
+                           sc_sock_poll_err(&loop->poll));
+        rc = -1;
+    }
+
+    sc_timer_term(&loop->timer);
+
+    return rc;
+}
+
+int sc_reactor_init(struct sc_reactor *r, uint32_t count,
+                    enum sc_reactor_mode mode, int family, const char *host,
+                    const char *port, struct sc_reactor_cb cb)
+{
+    int rc;
+
+    *r = (struct sc_reactor){.mode = mode, .cb = cb};
+
+#if !defined(SO_REUSEPORT)
+    r->mode = SC_REACTOR_ACCEPTOR;
+#endif
+
+    if (family == SC_SOCK_UNIX) {
+        r->mode = SC_REACTOR_ACCEPTOR;
+    }
+
+    count = count == 0 ? 1 : count;
+
+    r->loops = sc_reactor_calloc(count, sizeof(*r->loops));
+    if (r->loops == NULL) {
+        sc_reactor_set_err(r->err, sizeof(r->err), "Out of memory.");
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        rc = sc_reactor_loop_init(&r->loops[i], r, i, family, host, port);
+        if (rc != 0) {
+            goto error;
+        }
+
+        r->count++;
+    }
+
+    return 0;
+
+error:
+    for (uint32_t i = 0; i < r->count; i++) {
+        sc_reactor_loop_term(&r->loops[i]);
+    }
+
+    sc_reactor_free(r->loops);
+    r->loops = NULL;
+    r->count = 0;
+
+    return -1;
+}
+
+int sc_reactor_term(struct sc_reactor *r)
+{
+    int rc = 0;
+
+    if (r->started) {
+        rc = sc_reactor_stop(r);
+
+        for (uint32_t i = 0; i < r->count; i++) {
+            if (sc_thread_term(&r->loops[i].thread) != 0) {
+                sc_reactor_set_err(r->err, sizeof(r->err), "thread : %s",
+                                   sc_thread_err(&r->loops[i].thread));
+                rc = -1;
+            }
+
+            if (r->loops[i].err[0] != '\0') {
+                sc_reactor_set_err(r->err, sizeof(r->err), "loop : %s",
+                                   r->loops[i].err);
+                rc = -1;
+            }
+        }
+
+        r->started = false;
+    }
+
+    for (uint32_t i = 0; i < r->count; i++) {
+        if (sc_reactor_loop_term(&r->loops[i]) != 0) {
+            rc = -1;
+        }
+    }
+
+    sc_reactor_free(r->loops);
+    r->loops = NULL;
+    r->count = 0;
+
+    return rc;
+}
+
+static void sc_reactor_on_timeout(void *arg, uint64_t timeout, uint64_t type,
+                                  void *data)
+{
+    struct sc_reactor_loop *loop = arg;
+
+    (void) timeout;
+
+    if (loop->reactor->cb.timeout != NULL) {
+        loop->reactor->cb.timeout(loop, type, data);
+    }
+}
+
+static void sc_reactor_deliver(struct sc_reactor_loop *loop,
+                               struct sc_sock *sock)
+{
+    if (loop->reactor->cb.accept != NULL) {
+        loop->reactor->cb.accept(loop, sock);
+    } else {
+        sc_sock_term(sock);
+    }
+}
+
+static void sc_reactor_on_accept(struct sc_reactor_loop *loop)
+{
+    int rc;
+    struct sc_sock sock;
+    struct sc_reactor *r = loop->reactor;
+    struct sc_reactor_loop *dest = loop;
+    struct sc_reactor_msg *msg;
+
+    rc = sc_sock_accept(&loop->listener, &sock);
+    if (rc != SC_SOCK_OK) {
+        // Connection might be gone before we accept it, nothing to do.
+        return;
+    }
+
+    if (r->mode == SC_REACTOR_ACCEPTOR) {
+        // Only the first loop accepts in this mode, so 'next' is not shared.
+        dest = &r->loops[r->next];
+        r->next = (r->next + 1) % r->count;
+    }
+
+    if (dest == loop) {
+        sc_reactor_deliver(loop, &sock);
+        return;
+    }
+
+    msg = sc_reactor_malloc(sizeof(*msg));
+    if (msg == NULL) {
+        sc_sock_term(&sock);
+        return;
+    }
+
+    msg->sock = sock;
+
+    // Message is queued even if signaling fails, next wakeup delivers it.
+    sc_sock_notify_push(&dest->notify, &msg->node);
+}
+
+static void sc_reactor_on_msg(struct sc_reactor_loop *loop)
+{
+    struct sc_sock_notify_node *node;
+    struct sc_reactor_msg *msg;
+
+    sc_sock_notify_drain(&loop->notify);
+
+    while ((node = sc_sock_notify_pop(&loop->notify)) != NULL) {
+        if (node == &loop->stop) {
+            loop->running = false;
+            continue;
+        }
+
+        msg = (struct sc_reactor_msg *) node;
+        sc_reactor_deliver(loop, &msg->sock);
+        sc_reactor_free(msg);
+    }
+}
+
+static void *sc_reactor_run(void *arg)
+{
+    int n, wait;
+    uint64_t timeout;
+    struct sc_reactor_loop *loop = arg;
+    struct sc_reactor_cb *cb = &loop->reactor->cb;
+
+    while (loop->running) {
+        timeout = sc_timer_timeout(&loop->timer, sc_time_mono_ms(), loop,
+                                   sc_reactor_on_timeout);
+
+        // Sleep until the next timer, forever if there is none. Other threads
+        // wake the loop up through 'notify'.
+        wait = timeout < INT_MAX ? (int) timeout : INT_MAX;
+        if (timeout == SC_TIMER_INVALID) {
+            wait = -1;
+        }
+
+        n = sc_sock_poll_wait(&loop->poll, wait);
+        if (n < 0) {
+            sc_reactor_set_err(loop->err, sizeof(loop->err), "%s",
+                               sc_sock_poll_err(&loop->poll));
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            void *data = sc_sock_poll_data(&loop->poll, i);
+            uint32_t events = sc_sock_poll_event(&loop->poll, i);
+
+            if (data == &loop->notify) {
+                sc_reactor_on_msg(loop);
+            } else if (data == &loop->listener) {
+                sc_reactor_on_accept(loop);
+            } else if (cb->event != NULL) {
+                cb->event(loop, data, events);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int sc_reactor_wakeup(struct sc_reactor *r, uint32_t count)
+{
+    int rc = 0;
+    struct sc_reactor_loop *loop;
+
+    for (uint32_t i = 0; i < count; i++) {
+        loop = &r->loops[i];
+
+        // Stop node must not be queued twice, e.g stop() and then term().
+        if (loop->stop_sent) {
+            continue;
+        }
+
+        loop->stop_sent = true;
+
+        if (sc_sock_notify_push(&loop->notify, &loop->stop) != 0) {
+            sc_reactor_set_err(r->err, sizeof(r->err), "notify : %s",
+                               sc_sock_notify_err(&loop->notify));
+            rc = -1;
+        }
+    }
+
+    return rc;
+}
+
+int sc_reactor_start(struct sc_reactor *r)
+{
+    int rc;
+
+    if (r->started) {
+        sc_reactor_set_err(r->err, sizeof(r->err), "Already started.");
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < r->count; i++) {
+        r->loops[i].running = true;
+        r->loops[i].stop_sent = false;
+        r->loops[i].err[0] = '\0';
+
+        rc = sc_thread_start(&r->loops[i].thread, sc_reactor_run, &r->loops[i]);
+        if (rc != 0) {
+            sc_reactor_set_err(r->err, sizeof(r->err), "thread : %s",
+                               sc_thread_err(&r->loops[i].thread));
+            sc_reactor_wakeup(r, i);
+
+            for (uint32_t j = 0; j < i; j++) {
+                sc_thread_term(&r->loops[j].thread);
+            }
+
+            return -1;
+        }
+    }
+
+    r->started = true;
+
+    return 0;
+}
+
+int sc_reactor_stop(struct sc_reactor *r)
+{
+    return sc_reactor_wakeup(r, r->count);
+}
+
+uint64_t sc_reactor_timer_add(struct sc_reactor_loop *loop, uint64_t timeout,
+                              uint64_t type, void *data)
+{
+    return sc_timer_add(&loop->timer, timeout, type, data);
+}
+
+void sc_reactor_timer_cancel(struct sc_reactor_loop *loop, uint64_t *id)
+{
+    sc_timer_cancel(&loop->timer, id);
+}
+
+const char *sc_reactor_err(struct sc_reactor *r)
+{
+    return r->err;
+}
@@ -0,0 +1,183 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_REACTOR_H
+#define SC_REACTOR_H
+
+#include "sc_sock.h"
+#include "sc_thread.h"
+#include "sc_timer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#else
+    #define sc_reactor_calloc calloc
+    #define sc_reactor_malloc malloc
+    #define sc_reactor_free   free
+#endif
+
+enum sc_reactor_mode
+{
+    // Each loop has its own SO_REUSEPORT listener, kernel balances connections
+    SC_REACTOR_REUSEPORT,
+    // First loop accepts and hands connections over to loops in round-robin
+    SC_REACTOR_ACCEPTOR,
+};
+
+struct sc_reactor;
+struct sc_reactor_loop;
+
+struct sc_reactor_cb
+{
+    /**
+     * Called on the loop thread that owns the connection. 'sock' is temporary,
+     * copy it before adding it to 'loop->poll'. sc_sock_term() it if it is not
+     * wanted.
+     */
+    void (*accept)(struct sc_reactor_loop *loop, struct sc_sock *sock);
+
+    /**
+     * Called for fds user added to 'loop->poll'. 'data' and 'events' are the
+     * values sc_sock_poll_data() and sc_sock_poll_event() return.
+     */
+    void (*event)(struct sc_reactor_loop *loop, void *data, uint32_t events);
+
+    /**
+     * Called for timers added with sc_reactor_timer_add().
+     */
+    void (*timeout)(struct sc_reactor_loop *loop, uint64_t type, void *data);
+
+    void *arg;
+};
+
+struct sc_reactor_loop
+{
+    struct sc_reactor *reactor;
+    struct sc_thread thread;
+    struct sc_sock_poll poll;
+    struct sc_sock_notify notify;
+    struct sc_sock_notify_node stop;
+    bool stop_sent;
+    struct sc_sock listener;
+    struct sc_timer timer;
+    uint32_t index;
+    bool running;
+    void *data; // user data
+    char err[128];
+};
+
+struct sc_reactor
+{
+    struct sc_reactor_loop *loops;
+    uint32_t count;
+    uint32_t next;
+    enum sc_reactor_mode mode;
+    bool started;
+    struct sc_reactor_cb cb;
+    char err[128];
+};
+
+/**
+ * Create loops. Each loop has its own poll, timer and wakeup channel. If
+ * 'host' is not NULL, listener is created too, according to 'mode'. Threads
+ * are not started until sc_reactor_start().
+ *
+ * SC_REACTOR_REUSEPORT falls back to SC_REACTOR_ACCEPTOR if SO_REUSEPORT is
+ * not supported or 'family' is SC_SOCK_UNIX.
+ *
+ * @param r      reactor
+ * @param count  loop count, e.g core count.
+ * @param mode   SC_REACTOR_REUSEPORT or SC_REACTOR_ACCEPTOR
+ * @param family SC_SOCK_INET, SC_SOCK_INET6 or SC_SOCK_UNIX
+ * @param host   host, NULL for no listener
+ * @param port   port
+ * @param cb     callbacks
+ * @return       '0' on success, negative number on failure,
+ *               call sc_reactor_err() to get error string
+ */
+int sc_reactor_init(struct sc_reactor *r, uint32_t count,
+                    enum sc_reactor_mode mode, int family, const char *host,
+                    const char *port, struct sc_reactor_cb cb);
+
+/**
+ * Stop and join loops if they are running, close listeners and destroy loops.
+ * Fds user added to polls are not closed.
+ *
+ * @param r reactor
+ * @return  '0' on success, negative number on failure,
+ *          call sc_reactor_err() to get error string
+ */
+int sc_reactor_term(struct sc_reactor *r);
+
+/**
+ * Start a thread for each loop.
+ *
+ * @param r reactor
+ * @return  '0' on success, negative number on failure,
+ *          call sc_reactor_err() to get error string
+ */
+int sc_reactor_start(struct sc_reactor *r);
+
+/**
+ * Signal loops to stop. Thread-safe, can be called from callbacks as well.
+ * Loops return after completing the current iteration, sc_reactor_term() joins
+ * them.
+ *
+ * @param r reactor
+ * @return  '0' on success, negative number on failure,
+ *          call sc_reactor_err() to get error string
+ */
+int sc_reactor_stop(struct sc_reactor *r);
+
+/**
+ * Add a timer to the loop, must be called from the loop thread, e.g in a
+ * callback or before sc_reactor_start(). 'cb.timeout' is called on expiry.
+ *
+ * @param loop    loop
+ * @param timeout timeout in milliseconds
+ * @param type    user data
+ * @param data    user data
+ * @return        timer id, SC_TIMER_INVALID on out of memory.
+ */
+uint64_t sc_reactor_timer_add(struct sc_reactor_loop *loop, uint64_t timeout,
+                              uint64_t type, void *data);
+
+/**
+ * Cancel timer, must be called from the loop thread.
+ *
+ * @param loop loop
+ * @param id   timer id
+ */
+void sc_reactor_timer_cancel(struct sc_reactor_loop *loop, uint64_t *id);
+
+/**
+ * @param r reactor
+ * @return  last error string
+ */
+const char *sc_reactor_err(struct sc_reactor *r);
+
+#endif
@@ -0,0 +1,25 @@
+#include "sc_ring.h"
+
+#include <stdio.h>
+
+int main()
+{
+    int *ring;
+    int elem, batch[4] = {3, 4, 5, 6};
+
+    sc_ring_mpmc_create(ring, 1024);
+
+    elem = 1;
+    sc_ring_mpmc_push(ring, &elem);
+    elem = 2;
+    sc_ring_mpmc_push(ring, &elem);
+    sc_ring_mpmc_push_batch(ring, batch, 4);
+
+    while (sc_ring_mpmc_pop(ring, &elem)) {
+        printf("elem = [%d] \n", elem);
+    }
+
+    sc_ring_mpmc_destroy(ring);
+
+    return 0;
+}
@@ -0,0 +1,337 @@
+#include "sc_ring.h"
+#include "sc_thread.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+    #define yield() SwitchToThread()
+#else
+    #include <sched.h>
+    #define yield() sched_yield()
+#endif
+
+#define THREADS 4
+#define COUNT   100000
+
+#ifdef SC_HAVE_WRAP
+
+bool fail_malloc = false;
+void *__real_malloc(size_t n);
+void *__wrap_malloc(size_t n)
+{
+    if (fail_malloc) {
+        return NULL;
+    }
+
+    return __real_malloc(n);
+}
+
+void fail_test(void)
+{
+    int *q;
+    long *r;
+
+    fail_malloc = true;
+    assert(!sc_ring_spsc_create(q, 16));
+    assert(q == NULL);
+    assert(!sc_ring_mpmc_create(r, 16));
+    assert(r == NULL);
+    fail_malloc = false;
+
+    assert(sc_ring_spsc_create(q, 16));
+    assert(sc_ring_mpmc_create(r, 16));
+    sc_ring_spsc_destroy(q);
+    sc_ring_mpmc_destroy(r);
+}
+
+#else
+void fail_test(void)
+{
+}
+#endif
+
+struct item
+{
+    uint32_t producer;
+    uint32_t seq;
+};
+
+void test_spsc(void)
+{
+    int *q;
+    int elem = 0, batch[300];
+
+    assert(sc_ring_spsc_create(q, 100));
+    assert(sc_ring_spsc_cap(q) == 128);
+    assert(sc_ring_spsc_size(q) == 0);
+    assert(!sc_ring_spsc_pop(q, &elem));
+
+    for (int i = 0; i < 128; i++) {
+        assert(sc_ring_spsc_push(q, &i));
+    }
+    assert(!sc_ring_spsc_push(q, &elem));
+    assert(sc_ring_spsc_size(q) == 128);
+
+    for (int i = 0; i < 128; i++) {
+        assert(sc_ring_spsc_pop(q, &elem));
+        assert(elem == i);
+    }
+    assert(!sc_ring_spsc_pop(q, &elem));
+
+    // Batches wrap around the end of the ring.
+    for (int i = 0; i < 300; i++) {
+        batch[i] = i;
+    }
+
+    for (int round = 0; round < 10; round++) {
+        assert(sc_ring_spsc_push_batch(q, batch, 100) == 100);
+        assert(sc_ring_spsc_push_batch(q, batch + 100, 200) == 28);
+        assert(sc_ring_spsc_push_batch(q, batch, 1) == 0);
+
+        memset(batch, 0, sizeof(batch));
+        assert(sc_ring_spsc_pop_batch(q, batch, 300) == 128);
+        assert(sc_ring_spsc_pop_batch(q, batch, 0) == 0);
+        for (int i = 0; i < 128; i++) {
+            assert(batch[i] == i);
+        }
+
+        for (int i = 0; i < 300; i++) {
+            batch[i] = i;
+        }
+
+        assert(sc_ring_spsc_push_batch(q, batch, 37) == 37);
+        assert(sc_ring_spsc_pop_batch(q, batch + 37, 37) == 37);
+        assert(memcmp(batch, batch + 37, 37 * sizeof(int)) == 0);
+
+        for (int i = 0; i < 300; i++) {
+            batch[i] = i;
+        }
+    }
+
+    sc_ring_spsc_destroy(q);
+    assert(q == NULL);
+    sc_ring_spsc_destroy(q);
+
+    assert(!sc_ring_spsc_create(q, SIZE_MAX / 2));
+    assert(q == NULL);
+}
+
+void test_mpmc(void)
+{
+    double *q;
+    double elem = 0, batch[300];
+
+    assert(sc_ring_mpmc_create(q, 0));
+    assert(sc_ring_mpmc_cap(q) == 2);
+    sc_ring_mpmc_destroy(q);
+
+    assert(sc_ring_mpmc_create(q, 128));
+    assert(sc_ring_mpmc_cap(q) == 128);
+    assert(!sc_ring_mpmc_pop(q, &elem));
+
+    for (int i = 0; i < 128; i++) {
+        elem = i;
+        assert(sc_ring_mpmc_push(q, &elem));
+    }
+    assert(!sc_ring_mpmc_push(q, &elem));
+    assert(sc_ring_mpmc_size(q) == 128);
+
+    for (int i = 0; i < 128; i++) {
+        assert(sc_ring_mpmc_pop(q, &elem));
+        assert(elem == i);
+    }
+    assert(!sc_ring_mpmc_pop(q, &elem));
+    assert(sc_ring_mpmc_size(q) == 0);
+
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 300; i++) {
+            batch[i] = i;
+        }
+
+        assert(sc_ring_mpmc_push_batch(q, batch, 100) == 100);
+        assert(sc_ring_mpmc_push_batch(q, batch + 100, 200) == 28);
+        assert(sc_ring_mpmc_push_batch(q, batch, 1) == 0);
+
+        memset(batch, 0, sizeof(batch));
+        assert(sc_ring_mpmc_pop_batch(q, batch, 50) == 50);
+        assert(sc_ring_mpmc_pop_batch(q, batch + 50, 300) == 78);
+        assert(sc_ring_mpmc_pop_batch(q, batch, 0) == 0);
+        for (int i = 0; i < 128; i++) {
+            assert(batch[i] == i);
+        }
+
+        assert(sc_ring_mpmc_push_batch(q, batch, 37) == 37);
+        assert(sc_ring_mpmc_pop_batch(q, batch + 37, 37) == 37);
+        assert(memcmp(batch, batch + 37, 37 * sizeof(double)) == 0);
+    }
+
+    sc_ring_mpmc_destroy(q);
+    assert(q == NULL);
+    sc_ring_mpmc_destroy(q);
+}
+
+static struct item *spsc;
+
+static void *spsc_producer(void *arg)
+{
+    struct item items[16];
+    uint32_t n = 0;
+
+    (void) arg;
+
+    while (n < COUNT) {
+        size_t len = 1 + n % 16;
+
+        for (size_t i = 0; i < len; i++) {
+            items[i] = (struct item){.producer = 0, .seq = n + (uint32_t) i};
+        }
+
+        len = len < COUNT - n ? len : COUNT - n;
+        len = sc_ring_spsc_push_batch(spsc, items, len);
+        if (len == 0) {
+            yield();
+        }
+        n += (uint32_t) len;
+    }
+
+    return NULL;
+}
+
+void test_spsc_threads(void)
+{
+    uint32_t next = 0;
+    struct item items[8];
+    struct sc_thread thread;
+
+    assert(sc_ring_spsc_create(spsc, 64));
+
+    sc_thread_init(&thread);
+    assert(sc_thread_start(&thread, spsc_producer, NULL) == 0);
+
+    while (next < COUNT) {
+        size_t n = sc_ring_spsc_pop_batch(spsc, items, 8);
+        if (n == 0) {
+            yield();
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            assert(items[i].seq == next);
+            next++;
+        }
+    }
+
+    assert(sc_thread_term(&thread) == 0);
+    assert(sc_ring_spsc_size(spsc) == 0);
+    sc_ring_spsc_destroy(spsc);
+}
+
+static struct item *mpmc;
+static uint64_t consumed[THREADS];
+static uint64_t count_total;
+
+static void *mpmc_producer(void *arg)
+{
+    struct item items[4];
+    uint32_t id = (uint32_t) (uintptr_t) arg, n = 0;
+
+    while (n < COUNT) {
+        size_t len = 1 + n % 4;
+
+        len = len < COUNT - n ? len : COUNT - n;
+        for (size_t i = 0; i < len; i++) {
+            items[i] = (struct item){.producer = id, .seq = n + (uint32_t) i};
+        }
+
+        len = sc_ring_mpmc_push_batch(mpmc, items, len);
+        if (len == 0) {
+            yield();
+        }
+        n += (uint32_t) len;
+    }
+
+    return NULL;
+}
+
+static void *mpmc_consumer(void *arg)
+{
+    uintptr_t id = (uintptr_t) arg;
+    struct item items[3];
+    uint32_t last[THREADS];
+    uint64_t sum = 0;
+
+    memset(last, 0, sizeof(last));
+
+    for (;;) {
+        size_t n = sc_ring_mpmc_pop_batch(mpmc, items, 1 + sum % 3);
+        if (n == 0) {
+            yield();
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            if (items[i].producer == UINT32_MAX) {
+                // Stop items are pushed last, give the others back.
+                for (size_t j = i + 1; j < n; j++) {
+                    while (!sc_ring_mpmc_push(mpmc, &items[j])) {
+                        yield();
+                    }
+                }
+
+                consumed[id] = sum;
+                return NULL;
+            }
+
+            // Items of a producer are seen in order by each consumer.
+            assert(last[items[i].producer] <= items[i].seq + 1);
+            last[items[i].producer] = items[i].seq + 1;
+            sum++;
+        }
+    }
+}
+
+void test_mpmc_threads(void)
+{
+    struct item stop = {.producer = UINT32_MAX};
+    struct sc_thread producers[THREADS], consumers[THREADS];
+
+    assert(sc_ring_mpmc_create(mpmc, 64));
+
+    for (uintptr_t i = 0; i < THREADS; i++) {
+        sc_thread_init(&producers[i]);
+        sc_thread_init(&consumers[i]);
+        assert(sc_thread_start(&consumers[i], mpmc_consumer, (void *) i) == 0);
+        assert(sc_thread_start(&producers[i], mpmc_producer, (void *) i) == 0);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&producers[i]) == 0);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        while (!sc_ring_mpmc_push(mpmc, &stop)) {
+            yield();
+        }
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&consumers[i]) == 0);
+        count_total += consumed[i];
+    }
+
+    assert(count_total == (uint64_t) THREADS * COUNT);
+    assert(sc_ring_mpmc_size(mpmc) == 0);
+    sc_ring_mpmc_destroy(mpmc);
+}
+
+int main()
+{
+    fail_test();
+    test_spsc();
+    test_mpmc();
+    test_spsc_threads();
+    test_mpmc_threads();
+
+    return 0;
+}
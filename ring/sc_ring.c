@@ -0,0 +1,320 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sc_ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+    #include <windows.h>
+
+    #define sc_ring_load(p)     (*(volatile uint64_t *) (p))
+    #define sc_ring_load_acq(p)                                                \
+        ((uint64_t) InterlockedCompareExchange64((LONG64 *) (p), 0, 0))
+    #define sc_ring_store_rel(p, v)                                            \
+        InterlockedExchange64((LONG64 *) (p), (LONG64) (v))
+    #define sc_ring_cas(p, old, v)                                             \
+        (InterlockedCompareExchange64((LONG64 *) (p), (LONG64) (v),            \
+                                      (LONG64) (old)) == (LONG64) (old))
+#else
+    #define sc_ring_load(p)         __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_ring_load_acq(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+    #define sc_ring_store_rel(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+    #define sc_ring_cas(p, old, v)                                             \
+        __atomic_compare_exchange_n(p, &(uint64_t){old}, v, true,              \
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#endif
+
+#define sc_ring_min(a, b) ((a) < (b) ? (a) : (b))
+
+// Rounds 'cap' up to a power of two, returns '0' if it is too large.
+static uint64_t sc_ring_cap(size_t cap, size_t elem_size, size_t extra)
+{
+    uint64_t v = 2;
+    const size_t max = (SIZE_MAX - 512) / (elem_size + extra) / 2;
+
+    if (cap > max) {
+        return 0;
+    }
+
+    while (v < cap) {
+        v *= 2;
+    }
+
+    return v;
+}
+
+// Copies 'n' elements into the ring starting from 'pos', handles wraparound.
+static void sc_ring_write(unsigned char *ring, uint64_t cap, size_t elem_size,
+                          uint64_t pos, const unsigned char *src, size_t n)
+{
+    size_t idx = (size_t) (pos & (cap - 1));
+    size_t first = sc_ring_min(n, (size_t) cap - idx);
+
+    memcpy(ring + (idx * elem_size), src, first * elem_size);
+    memcpy(ring, src + (first * elem_size), (n - first) * elem_size);
+}
+
+static void sc_ring_read(unsigned char *ring, uint64_t cap, size_t elem_size,
+                         uint64_t pos, unsigned char *dst, size_t n)
+{
+    size_t idx = (size_t) (pos & (cap - 1));
+    size_t first = sc_ring_min(n, (size_t) cap - idx);
+
+    memcpy(dst, ring + (idx * elem_size), first * elem_size);
+    memcpy(dst + (first * elem_size), ring, (n - first) * elem_size);
+}
+
+bool sc_ring_spsc_init(void *q, size_t elem_size, size_t cap)
+{
+    void **ptr = q;
+    uint64_t c;
+    struct sc_ring_spsc *r;
+
+    *ptr = NULL;
+
+    c = sc_ring_cap(cap, elem_size, 0);
+    if (c == 0) {
+        return false;
+    }
+
+    r = sc_ring_malloc(sizeof(*r) + (size_t) c * elem_size);
+    if (r == NULL) {
+        return false;
+    }
+
+    *r = (struct sc_ring_spsc){.cap = c, .elem_size = elem_size};
+    *ptr = r->elems;
+
+    return true;
+}
+
+void sc_ring_spsc_term(void *q)
+{
+    void **ptr = q;
+
+    if (*ptr == NULL) {
+        return;
+    }
+
+    sc_ring_free(sc_ring_spsc_meta(*ptr));
+    *ptr = NULL;
+}
+
+size_t sc_ring_spsc_push_n(void *q, const void *elems, size_t n)
+{
+    struct sc_ring_spsc *r = sc_ring_spsc_meta(q);
+    uint64_t tail = sc_ring_load(&r->tail);
+    uint64_t used = tail - r->head_cache;
+
+    // Consumer's position is loaded only when the cached one is not enough.
+    if (used + n > r->cap) {
+        r->head_cache = sc_ring_load_acq(&r->head);
+        used = tail - r->head_cache;
+        n = (size_t) sc_ring_min(n, r->cap - used);
+    }
+
+    if (n == 0) {
+        return 0;
+    }
+
+    sc_ring_write(r->elems, r->cap, r->elem_size, tail, elems, n);
+    sc_ring_store_rel(&r->tail, tail + n);
+
+    return n;
+}
+
+size_t sc_ring_spsc_pop_n(void *q, void *elems, size_t n)
+{
+    struct sc_ring_spsc *r = sc_ring_spsc_meta(q);
+    uint64_t head = sc_ring_load(&r->head);
+    uint64_t avail = r->tail_cache - head;
+
+    if (avail < n) {
+        r->tail_cache = sc_ring_load_acq(&r->tail);
+        avail = r->tail_cache - head;
+        n = (size_t) sc_ring_min(n, avail);
+    }
+
+    if (n == 0) {
+        return 0;
+    }
+
+    sc_ring_read(r->elems, r->cap, r->elem_size, head, elems, n);
+    sc_ring_store_rel(&r->head, head + n);
+
+    return n;
+}
+
+size_t sc_ring_spsc_size(void *q)
+{
+    struct sc_ring_spsc *r = sc_ring_spsc_meta(q);
+    uint64_t head = sc_ring_load_acq(&r->head);
+    uint64_t tail = sc_ring_load_acq(&r->tail);
+
+    return (size_t) sc_ring_min(tail - head, r->cap);
+}
+
+bool sc_ring_mpmc_init(void *q, size_t elem_size, size_t cap)
+{
+    void **ptr = q;
+    uint64_t c;
+    size_t off;
+    struct sc_ring_mpmc *r;
+
+    *ptr = NULL;
+
+    c = sc_ring_cap(cap, elem_size, sizeof(uint64_t));
+    if (c == 0) {
+        return false;
+    }
+
+    // Sequence numbers are stored after the elements.
+    off = (size_t) c * elem_size;
+    off = (off + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+
+    r = sc_ring_malloc(sizeof(*r) + off + (size_t) c * sizeof(uint64_t));
+    if (r == NULL) {
+        return false;
+    }
+
+    *r = (struct sc_ring_mpmc){.cap = c, .elem_size = elem_size};
+    r->seq = (uint64_t *) (void *) (r->elems + off);
+
+    for (uint64_t i = 0; i < c; i++) {
+        r->seq[i] = i;
+    }
+
+    *ptr = r->elems;
+
+    return true;
+}
+
+void sc_ring_mpmc_term(void *q)
+{
+    void **ptr = q;
+
+    if (*ptr == NULL) {
+        return;
+    }
+
+    sc_ring_free(sc_ring_mpmc_meta(*ptr));
+    *ptr = NULL;
+}
+
+size_t sc_ring_mpmc_push_n(void *q, const void *elems, size_t n)
+{
+    size_t k;
+    uint64_t pos, seq = 0;
+    struct sc_ring_mpmc *r = sc_ring_mpmc_meta(q);
+    const uint64_t mask = r->cap - 1;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    pos = sc_ring_load(&r->tail);
+
+    for (;;) {
+        // Slots are free for this lap if their sequence equals the position.
+        // Only the producer that claims them can change it, so a single CAS
+        // claims all of them.
+        for (k = 0; k < n; k++) {
+            seq = sc_ring_load_acq(&r->seq[(pos + k) & mask]);
+            if (seq != pos + k) {
+                break;
+            }
+        }
+
+        if (k == 0 && (int64_t) (seq - pos) < 0) {
+            return 0;
+        }
+
+        if (k > 0 && sc_ring_cas(&r->tail, pos, pos + k)) {
+            break;
+        }
+
+        pos = sc_ring_load(&r->tail);
+    }
+
+    sc_ring_write(r->elems, r->cap, r->elem_size, pos, elems, k);
+
+    for (size_t i = 0; i < k; i++) {
+        sc_ring_store_rel(&r->seq[(pos + i) & mask], pos + i + 1);
+    }
+
+    return k;
+}
+
+size_t sc_ring_mpmc_pop_n(void *q, void *elems, size_t n)
+{
+    size_t k;
+    uint64_t pos, seq = 0;
+    struct sc_ring_mpmc *r = sc_ring_mpmc_meta(q);
+    const uint64_t mask = r->cap - 1;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    pos = sc_ring_load(&r->head);
+
+    for (;;) {
+        for (k = 0; k < n; k++) {
+            seq = sc_ring_load_acq(&r->seq[(pos + k) & mask]);
+            if (seq != pos + k + 1) {
+                break;
+            }
+        }
+
+        if (k == 0 && (int64_t) (seq - (pos + 1)) < 0) {
+            return 0;
+        }
+
+        if (k > 0 && sc_ring_cas(&r->head, pos, pos + k)) {
+            break;
+        }
+
+        pos = sc_ring_load(&r->head);
+    }
+
+    sc_ring_read(r->elems, r->cap, r->elem_size, pos, elems, k);
+
+    // Slot is free for the producer of the next lap.
+    for (size_t i = 0; i < k; i++) {
+        sc_ring_store_rel(&r->seq[(pos + i) & mask], pos + i + r->cap);
+    }
+
+    return k;
+}
+
+size_t sc_ring_mpmc_size(void *q)
+{
+    struct sc_ring_mpmc *r = sc_ring_mpmc_meta(q);
+    uint64_t head = sc_ring_load_acq(&r->head);
+    uint64_t tail = sc_ring_load_acq(&r->tail);
+
+    return (size_t) sc_ring_min(tail - head, r->cap);
+}
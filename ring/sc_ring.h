@@ -0,0 +1,187 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_RING_H
+#define SC_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#else
+    #define sc_ring_malloc malloc
+    #define sc_ring_free   free
+#endif
+
+#ifndef SC_RING_CACHE_LINE
+    #define SC_RING_CACHE_LINE 64
+#endif
+
+/**
+ * Fixed capacity lock-free ring queues, capacity is rounded up to a power of
+ * two. Positions are 64 bit counters, they never wrap in practice.
+ *
+ * sc_ring_spsc : single producer, single consumer.
+ * sc_ring_mpmc : multi producer, multi consumer, see Dmitry Vyukov's
+ *                "Bounded MPMC queue". Each slot has a sequence number.
+ *
+ * Producer and consumer positions are on separate cache lines.
+ */
+
+// Internals
+struct sc_ring_spsc
+{
+    uint64_t cap;
+    uint64_t elem_size;
+    char pad0[SC_RING_CACHE_LINE - 2 * sizeof(uint64_t)];
+
+    uint64_t head;       // Consumer position
+    uint64_t tail_cache; // Consumer's copy of 'tail'
+    char pad1[SC_RING_CACHE_LINE - 2 * sizeof(uint64_t)];
+
+    uint64_t tail;       // Producer position
+    uint64_t head_cache; // Producer's copy of 'head'
+    char pad2[SC_RING_CACHE_LINE - 2 * sizeof(uint64_t)];
+
+    unsigned char elems[];
+};
+
+struct sc_ring_mpmc
+{
+    uint64_t cap;
+    uint64_t elem_size;
+    uint64_t *seq;
+    char pad0[SC_RING_CACHE_LINE - 2 * sizeof(uint64_t) - sizeof(void *)];
+
+    uint64_t head;
+    char pad1[SC_RING_CACHE_LINE - sizeof(uint64_t)];
+
+    uint64_t tail;
+    char pad2[SC_RING_CACHE_LINE - sizeof(uint64_t)];
+
+    unsigned char elems[];
+};
+
+#define sc_ring_spsc_meta(q)                                                   \
+    ((struct sc_ring_spsc *) ((char *) (q) -offsetof(struct sc_ring_spsc,      \
+                                                     elems)))
+#define sc_ring_mpmc_meta(q)                                                   \
+    ((struct sc_ring_mpmc *) ((char *) (q) -offsetof(struct sc_ring_mpmc,      \
+                                                     elems)))
+
+// Type check, compiles only if 'elem' points to the element type of 'q'.
+#define sc_ring_check(q, elem) ((void) sizeof(*(q) = *(elem)), (elem))
+
+bool sc_ring_spsc_init(void *q, size_t elem_size, size_t cap);
+void sc_ring_spsc_term(void *q);
+size_t sc_ring_spsc_push_n(void *q, const void *elems, size_t n);
+size_t sc_ring_spsc_pop_n(void *q, void *elems, size_t n);
+
+bool sc_ring_mpmc_init(void *q, size_t elem_size, size_t cap);
+void sc_ring_mpmc_term(void *q);
+size_t sc_ring_mpmc_push_n(void *q, const void *elems, size_t n);
+size_t sc_ring_mpmc_pop_n(void *q, void *elems, size_t n);
+
+/**
+ * Create ring, e.g
+ *
+ * struct job *jobs;
+ * sc_ring_mpmc_create(jobs, 1024);
+ *
+ * @param q     ring
+ * @param count capacity, rounded up to a power of two, must be > 0.
+ * @return      'true' on success, 'false' on out of memory.
+ */
+#define sc_ring_spsc_create(q, count)                                          \
+    sc_ring_spsc_init(&(q), sizeof(*(q)), count)
+#define sc_ring_mpmc_create(q, count)                                          \
+    sc_ring_mpmc_init(&(q), sizeof(*(q)), count)
+
+/**
+ * Destroy ring, no thread may use the ring at this point.
+ * @param q ring
+ */
+#define sc_ring_spsc_destroy(q) sc_ring_spsc_term(&(q))
+#define sc_ring_mpmc_destroy(q) sc_ring_mpmc_term(&(q))
+
+/**
+ * @param q ring
+ * @return  capacity
+ */
+#define sc_ring_spsc_cap(q) ((size_t) sc_ring_spsc_meta(q)->cap)
+#define sc_ring_mpmc_cap(q) ((size_t) sc_ring_mpmc_meta(q)->cap)
+
+/**
+ * Copies '*elem' into the ring.
+ *
+ * @param q    ring
+ * @param elem pointer to the element
+ * @return     '1' on success, '0' if ring is full.
+ */
+#define sc_ring_spsc_push(q, elem)                                             \
+    sc_ring_spsc_push_n((q), sc_ring_check(q, elem), 1)
+#define sc_ring_mpmc_push(q, elem)                                             \
+    sc_ring_mpmc_push_n((q), sc_ring_check(q, elem), 1)
+
+/**
+ * Copies the first element into '*elem' and removes it from the ring.
+ *
+ * @param q    ring
+ * @param elem pointer to the destination
+ * @return     '1' on success, '0' if ring is empty.
+ */
+#define sc_ring_spsc_pop(q, elem)                                              \
+    sc_ring_spsc_pop_n((q), sc_ring_check(q, elem), 1)
+#define sc_ring_mpmc_pop(q, elem)                                              \
+    sc_ring_mpmc_pop_n((q), sc_ring_check(q, elem), 1)
+
+/**
+ * Batch operations, copy up to 'n' elements with a single synchronization on
+ * the shared position. Elements are contiguous in 'elems'.
+ *
+ * @param q     ring
+ * @param elems elements
+ * @param n     element count
+ * @return      elements pushed / popped, less than 'n' if ring is full / empty
+ */
+#define sc_ring_spsc_push_batch(q, elems, n)                                   \
+    sc_ring_spsc_push_n((q), sc_ring_check(q, elems), (n))
+#define sc_ring_spsc_pop_batch(q, elems, n)                                    \
+    sc_ring_spsc_pop_n((q), sc_ring_check(q, elems), (n))
+#define sc_ring_mpmc_push_batch(q, elems, n)                                   \
+    sc_ring_mpmc_push_n((q), sc_ring_check(q, elems), (n))
+#define sc_ring_mpmc_pop_batch(q, elems, n)                                    \
+    sc_ring_mpmc_pop_n((q), sc_ring_check(q, elems), (n))
+
+/**
+ * Element count, exact only if no other thread is using the ring.
+ * @param q ring
+ * @return  element count
+ */
+size_t sc_ring_spsc_size(void *q);
+size_t sc_ring_mpmc_size(void *q);
+
+#endif
@@ -29,6 +29,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    #include <windows.h>
+#endif
+
+#ifndef thread_local
+    #if __STDC_VERSION__ >= 201112 && !defined __STDC_NO_THREADS__
+        #define thread_local _Thread_local
+    #elif defined _WIN32 && (defined _MSC_VER || defined __ICL ||              \
+                             defined __DMC__ || defined __BORLANDC__)
+        #define thread_local __declspec(thread)
+    #elif defined __GNUC__ || defined __SUNPRO_C || defined __xlC__
+        #define thread_local __thread
+    #else
+        #error "Cannot define  thread_local"
+    #endif
+#endif
 
 #if (SIZE_MAX == 0xFFFF)
     #define SIZE_T_BITS 16
@@ -76,26 +95,151 @@ void sc_rand_read(struct sc_rand *r, void *buf, int size)
     } while (--size);
 }
 
-bool sc_is_pow2(size_t num)
+static uint64_t sc_splitmix64(uint64_t *x)
 {
-    return (num != 0) && (num & (num - 1)) == 0;
+    uint64_t z = (*x += 0x9e3779b97f4a7c15);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+
+    return z ^ (z >> 31);
 }
 
-size_t sc_to_pow2(size_t size)
+// 64x64 -> 128 bit multiplication.
+static void sc_mul128(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo)
+{
+#if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 p = (unsigned __int128) a * b;
+
+    *hi = (uint64_t) (p >> 64);
+    *lo = (uint64_t) p;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *lo = _umul128(a, b, hi);
+#else
+    uint64_t a_lo = (uint32_t) a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t) b, b_hi = b >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi;
+    uint64_t hl = a_hi * b_lo, hh = a_hi * b_hi;
+    uint64_t mid = (ll >> 32) + (uint32_t) lh + (uint32_t) hl;
+
+    *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    *lo = (mid << 32) | (uint32_t) ll;
+#endif
+}
+
+void sc_rng_init(struct sc_rng *r, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++) {
+        r->s[i] = sc_splitmix64(&seed);
+    }
+}
+
+uint64_t sc_rng_range(struct sc_rng *r, uint64_t n)
+{
+    uint64_t hi, lo, min;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    sc_mul128(sc_rng_next(r), n, &hi, &lo);
+
+    if (lo < n) {
+        // 2^64 % n, values below it would make some results more likely.
+        min = (0 - n) % n;
+        while (lo < min) {
+            sc_mul128(sc_rng_next(r), n, &hi, &lo);
+        }
+    }
+
+    return hi;
+}
+
+double sc_rng_double(struct sc_rng *r)
+{
+    return (double) (sc_rng_next(r) >> 11) * 0x1.0p-53;
+}
+
+static void sc_rng_jump_by(struct sc_rng *r, const uint64_t poly[4])
 {
-    if (size == 0) {
-        return 1;
+    uint64_t s[4] = {0};
+
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (poly[i] & ((uint64_t) 1 << b)) {
+                s[0] ^= r->s[0];
+                s[1] ^= r->s[1];
+                s[2] ^= r->s[2];
+                s[3] ^= r->s[3];
+            }
+            sc_rng_next(r);
+        }
     }
 
-    size--;
+    memcpy(r->s, s, sizeof(s));
+}
+
+void sc_rng_jump(struct sc_rng *r)
+{
+    static const uint64_t poly[4] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+                                     0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+
+    sc_rng_jump_by(r, poly);
+}
+
+void sc_rng_long_jump(struct sc_rng *r)
+{
+    static const uint64_t poly[4] = {0x76e15d3efefdcbbf, 0xc5004e441c522fb3,
+                                     0x77710069854ee241, 0x39109bb02acbe635};
+
+    sc_rng_jump_by(r, poly);
+}
+
+struct sc_rng *sc_rng_local(void)
+{
+    static uint64_t counter;
+    static thread_local bool init;
+    static thread_local struct sc_rng rng;
+    uint64_t seed;
+
+    if (!init) {
+#if defined(_MSC_VER)
+        seed = (uint64_t) InterlockedIncrement64((LONG64 *) &counter);
+#else
+        seed = __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED);
+#endif
+        seed = seed * 0x9e3779b97f4a7c15 ^ (uint64_t) time(NULL);
+        seed ^= (uint64_t) (uintptr_t) &rng ^ ((uint64_t) clock() << 32);
 
-    for (uint32_t i = 1; i < sizeof(size) * 8; i *= 2) {
-        size |= size >> i;
+        sc_rng_init(&rng, seed);
+        init = true;
     }
 
-    size++;
+    return &rng;
+}
+
+uint64_t sc_wyrand(uint64_t *seed)
+{
+    uint64_t hi, lo;
+
+    *seed += 0xa0761d6478bd642f;
+    sc_mul128(*seed, *seed ^ 0xe7037ed1a0b428db, &hi, &lo);
+
+    return hi ^ lo;
+}
+
+bool sc_is_pow2(size_t num)
+{
+    return (num != 0) && (num & (num - 1)) == 0;
+}
 
-    return size;
+size_t sc_to_pow2(size_t size)
+{
+#if SIZE_T_BITS == 64
+    return (size_t) sc_next_pow2_64(size);
+#else
+    return (size_t) sc_next_pow2_32((uint32_t) size);
+#endif
 }
 
 char *sc_bytes_to_size(char *buf, size_t len, uint64_t val)
@@ -31,6 +31,179 @@
 #define sc_max(a, b) (((a) > (b)) ? (a) : (b))
 #define sc_min(a, b) (((a) > (b)) ? (b) : (a))
 
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+// Branch hints, e.g if (sc_unlikely(p == NULL)) { ... }
+#if defined(__GNUC__) || defined(__clang__)
+    #define sc_likely(x)   __builtin_expect(!!(x), 1)
+    #define sc_unlikely(x) __builtin_expect(!!(x), 0)
+#else
+    #define sc_likely(x)   (x)
+    #define sc_unlikely(x) (x)
+#endif
+
+// Prefetch the cache line of 'p' for reading or writing.
+#if defined(__GNUC__) || defined(__clang__)
+    #define sc_prefetch(p)       __builtin_prefetch(p)
+    #define sc_prefetch_write(p) __builtin_prefetch(p, 1)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #define sc_prefetch(p)       _mm_prefetch((const char *) (p), _MM_HINT_T0)
+    #define sc_prefetch_write(p) _mm_prefetch((const char *) (p), _MM_HINT_T0)
+#else
+    #define sc_prefetch(p)       ((void) (p))
+    #define sc_prefetch_write(p) ((void) (p))
+#endif
+
+// Cache line size and alignment, e.g to keep counters of different threads
+// on separate lines : struct counter { sc_cache_aligned uint64_t n; };
+#ifndef SC_CACHE_LINE
+    #define SC_CACHE_LINE 64
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define sc_cache_aligned __attribute__((aligned(SC_CACHE_LINE)))
+#elif defined(_MSC_VER)
+    #define sc_cache_aligned __declspec(align(SC_CACHE_LINE))
+#else
+    #define sc_cache_aligned
+#endif
+
+/**
+ * Bit helpers, compiled to a single instruction with GCC/Clang/MSVC.
+ * clz/ctz return the bit width for '0'.
+ */
+static inline uint32_t sc_clz32(uint32_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return v ? (uint32_t) __builtin_clz(v) : 32;
+#elif defined(_MSC_VER)
+    unsigned long i;
+    return _BitScanReverse(&i, v) ? 31 - (uint32_t) i : 32;
+#else
+    uint32_t n = 32;
+
+    while (v) {
+        v >>= 1;
+        n--;
+    }
+
+    return n;
+#endif
+}
+
+static inline uint32_t sc_clz64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return v ? (uint32_t) __builtin_clzll(v) : 64;
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long i;
+    return _BitScanReverse64(&i, v) ? 63 - (uint32_t) i : 64;
+#else
+    uint32_t hi = (uint32_t) (v >> 32);
+    return hi ? sc_clz32(hi) : 32 + sc_clz32((uint32_t) v);
+#endif
+}
+
+static inline uint32_t sc_ctz32(uint32_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return v ? (uint32_t) __builtin_ctz(v) : 32;
+#elif defined(_MSC_VER)
+    unsigned long i;
+    return _BitScanForward(&i, v) ? (uint32_t) i : 32;
+#else
+    uint32_t n = 0;
+
+    if (v == 0) {
+        return 32;
+    }
+
+    while ((v & 1u) == 0) {
+        v >>= 1;
+        n++;
+    }
+
+    return n;
+#endif
+}
+
+static inline uint32_t sc_ctz64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return v ? (uint32_t) __builtin_ctzll(v) : 64;
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long i;
+    return _BitScanForward64(&i, v) ? (uint32_t) i : 64;
+#else
+    uint32_t lo = (uint32_t) v;
+    return lo ? sc_ctz32(lo) : 32 + sc_ctz32((uint32_t) (v >> 32));
+#endif
+}
+
+static inline uint32_t sc_popcount64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t) __builtin_popcountll(v);
+#else
+    // MSVC __popcnt64() requires POPCNT support on the CPU.
+    v = v - ((v >> 1) & 0x5555555555555555);
+    v = (v & 0x3333333333333333) + ((v >> 2) & 0x3333333333333333);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0f;
+    return (uint32_t) ((v * 0x0101010101010101) >> 56);
+#endif
+}
+
+static inline uint32_t sc_popcount32(uint32_t v)
+{
+    return sc_popcount64(v);
+}
+
+/**
+ * @param v value, must not be '0'.
+ * @return  floor(log2(v)), index of the highest set bit.
+ */
+static inline uint32_t sc_log2_32(uint32_t v)
+{
+    return 31 - sc_clz32(v);
+}
+
+static inline uint32_t sc_log2_64(uint64_t v)
+{
+    return 63 - sc_clz64(v);
+}
+
+/**
+ * @param v value
+ * @return  smallest power of two >= v, '1' for '0', '0' if it doesn't fit.
+ */
+static inline uint32_t sc_next_pow2_32(uint32_t v)
+{
+    if (v <= 1) {
+        return 1;
+    }
+
+    if (v > ((uint32_t) 1 << 31)) {
+        return 0;
+    }
+
+    return (uint32_t) 1 << (32 - sc_clz32(v - 1));
+}
+
+static inline uint64_t sc_next_pow2_64(uint64_t v)
+{
+    if (v <= 1) {
+        return 1;
+    }
+
+    if (v > ((uint64_t) 1 << 63)) {
+        return 0;
+    }
+
+    return (uint64_t) 1 << (64 - sc_clz64(v - 1));
+}
+
 struct sc_rand
 {
     unsigned char i;
@@ -67,6 +240,110 @@ struct sc_rand
 void sc_rand_init(struct sc_rand *r, const unsigned char *init);
 void sc_rand_read(struct sc_rand *r, void *buf, int size);
 
+/**
+ * Fast non-cryptographic generator, xoshiro256**. ~1 ns per number, passes
+ * BigCrush, period is 2^256 - 1. Use it for jitter, sampling, hashing seeds
+ * etc. Use sc_rand for anything security related.
+ *
+ * Not thread-safe, use a generator per thread, e.g sc_rng_local(). For
+ * parallel streams, init one generator and copy it, calling sc_rng_jump() on
+ * each copy a different number of times, streams won't overlap for 2^128
+ * numbers.
+ *
+ *      struct sc_rng rng;
+ *
+ *      sc_rng_init(&rng, 12345);
+ *      uint64_t x = sc_rng_next(&rng);
+ *      uint64_t dice = sc_rng_range(&rng, 6) + 1;
+ *      double d = sc_rng_double(&rng);
+ */
+struct sc_rng
+{
+    uint64_t s[4];
+};
+
+/**
+ * Expands 'seed' with splitmix64, any seed including '0' is fine.
+ *
+ * @param r    rng
+ * @param seed seed
+ */
+void sc_rng_init(struct sc_rng *r, uint64_t seed);
+
+/**
+ * @param r rng
+ * @return  uniformly distributed 64 bits
+ */
+static inline uint64_t sc_rng_next(struct sc_rng *r)
+{
+    uint64_t *s = r->s;
+    uint64_t x = s[1] * 5;
+    const uint64_t t = s[1] << 17;
+    const uint64_t res = ((x << 7) | (x >> 57)) * 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+
+    return res;
+}
+
+/**
+ * Unbiased number in [0, n), Lemire's multiply-shift method, divides only if
+ * the first try is rejected, which is rare unless 'n' is huge.
+ *
+ * @param r rng
+ * @param n bound
+ * @return  number in [0, n), '0' if 'n' is '0'.
+ */
+uint64_t sc_rng_range(struct sc_rng *r, uint64_t n);
+
+/**
+ * @param r rng
+ * @return  uniformly distributed double in [0, 1), 53 bits of precision.
+ */
+double sc_rng_double(struct sc_rng *r);
+
+/**
+ * Advances the generator 2^128 steps, e.g to create 2^128 non-overlapping
+ * streams for parallel computations.
+ *
+ * @param r rng
+ */
+void sc_rng_jump(struct sc_rng *r);
+
+/**
+ * Advances the generator 2^192 steps, e.g to create 2^64 starting points, each
+ * can generate 2^64 streams with sc_rng_jump().
+ *
+ * @param r rng
+ */
+void sc_rng_long_jump(struct sc_rng *r);
+
+/**
+ * Generator of the calling thread, seeded on the first call of each thread
+ * from the time, the address of the thread's state and a process wide
+ * counter.
+ *
+ * @return thread local generator.
+ */
+struct sc_rng *sc_rng_local(void);
+
+/**
+ * wyrand, smaller and a bit faster than sc_rng, a single 64 bit state, period
+ * is 2^64. Good fit to embed a generator in small structs.
+ *
+ *      uint64_t seed = 12345;
+ *      uint64_t x = sc_wyrand(&seed);
+ *
+ * @param seed state, any value, it is updated on each call.
+ * @return     uniformly distributed 64 bits
+ */
+uint64_t sc_wyrand(uint64_t *seed);
+
 /**
  * @param num num
  * @return    'true' if num is power of 2
@@ -161,6 +161,123 @@ void test_rand()
     sc_rand_read(&rc4_1, NULL, 10);
 }
 
+void test_bits(void)
+{
+    sc_cache_aligned uint64_t aligned = 0;
+
+    assert(((uintptr_t) &aligned % SC_CACHE_LINE) == 0);
+    sc_prefetch(&aligned);
+    sc_prefetch_write(&aligned);
+    assert(sc_likely(aligned == 0));
+    assert(!sc_unlikely(aligned != 0));
+
+    assert(sc_clz32(0) == 32);
+    assert(sc_clz32(1) == 31);
+    assert(sc_clz32(UINT32_MAX) == 0);
+    assert(sc_clz64(0) == 64);
+    assert(sc_clz64(1) == 63);
+    assert(sc_clz64((uint64_t) 1 << 40) == 23);
+
+    assert(sc_ctz32(0) == 32);
+    assert(sc_ctz32(8) == 3);
+    assert(sc_ctz32(0x80000000u) == 31);
+    assert(sc_ctz64(0) == 64);
+    assert(sc_ctz64((uint64_t) 1 << 40) == 40);
+
+    assert(sc_popcount32(0) == 0);
+    assert(sc_popcount32(UINT32_MAX) == 32);
+    assert(sc_popcount64(UINT64_MAX) == 64);
+    assert(sc_popcount64(0xf0f0) == 8);
+
+    assert(sc_log2_32(1) == 0);
+    assert(sc_log2_32(1023) == 9);
+    assert(sc_log2_32(1024) == 10);
+    assert(sc_log2_64(UINT64_MAX) == 63);
+
+    assert(sc_next_pow2_32(0) == 1);
+    assert(sc_next_pow2_32(1) == 1);
+    assert(sc_next_pow2_32(3) == 4);
+    assert(sc_next_pow2_32(4) == 4);
+    assert(sc_next_pow2_32((uint32_t) 1 << 31) == (uint32_t) 1 << 31);
+    assert(sc_next_pow2_32(((uint32_t) 1 << 31) + 1) == 0);
+    assert(sc_next_pow2_64(5) == 8);
+    assert(sc_next_pow2_64(((uint64_t) 1 << 40) + 1) == (uint64_t) 1 << 41);
+    assert(sc_next_pow2_64(((uint64_t) 1 << 63) + 1) == 0);
+
+    for (uint32_t i = 1; i < 100000; i++) {
+        uint32_t p = sc_next_pow2_32(i);
+
+        assert(sc_is_pow2(p) && p >= i && p / 2 < i);
+        assert(sc_to_pow2(i) == p);
+    }
+}
+
+void test_rng(void)
+{
+    uint64_t x, seed = 0, hist[10] = {0};
+    double d;
+    struct sc_rng r, r2;
+
+    // Reference outputs of xoshiro256**
+    r = (struct sc_rng){.s = {1, 2, 3, 4}};
+    assert(sc_rng_next(&r) == 0x2d00);
+    assert(sc_rng_next(&r) == 0x0);
+    assert(sc_rng_next(&r) == 0x5a007080);
+    assert(sc_rng_next(&r) == 0x10e0000000009d80);
+
+    r = (struct sc_rng){.s = {1, 2, 3, 4}};
+    sc_rng_jump(&r);
+    assert(r.s[0] == 0x8c7a153956b5f3d1);
+    assert(r.s[3] == 0x8386b786c4408050);
+    assert(sc_rng_next(&r) == 0xbbd2f312298443d8);
+
+    r = (struct sc_rng){.s = {1, 2, 3, 4}};
+    sc_rng_long_jump(&r);
+    assert(sc_rng_next(&r) == 0x527752a1d792704d);
+
+    // Seeded with splitmix64
+    sc_rng_init(&r, 0);
+    assert(r.s[0] == 0xe220a8397b1dcdaf);
+    assert(r.s[3] == 0xf88bb8a8724c81ec);
+    assert(sc_rng_next(&r) == 0x99ec5f36cb75f2b4);
+
+    sc_rng_init(&r, 1);
+    sc_rng_init(&r2, 1);
+    assert(sc_rng_next(&r) == sc_rng_next(&r2));
+    sc_rng_jump(&r2);
+    assert(sc_rng_next(&r) != sc_rng_next(&r2));
+
+    assert(sc_rng_range(&r, 0) == 0);
+    assert(sc_rng_range(&r, 1) == 0);
+
+    for (int i = 0; i < 100000; i++) {
+        x = sc_rng_range(&r, 10);
+        assert(x < 10);
+        hist[x]++;
+
+        x = sc_rng_range(&r, UINT64_MAX);
+        assert(x < UINT64_MAX);
+
+        x = sc_rng_range(&r, ((uint64_t) 1 << 63) + 1);
+        assert(x <= (uint64_t) 1 << 63);
+
+        d = sc_rng_double(&r);
+        assert(d >= 0 && d < 1);
+    }
+
+    for (int i = 0; i < 10; i++) {
+        assert(hist[i] > 9000 && hist[i] < 11000);
+    }
+
+    assert(sc_rng_local() == sc_rng_local());
+    assert(sc_rng_next(sc_rng_local()) != sc_rng_next(sc_rng_local()));
+
+    // Reference outputs of wyrand
+    assert(sc_wyrand(&seed) == 0x111cb3a78f59a58e);
+    assert(sc_wyrand(&seed) == 0xceabd938ff4e856d);
+    assert(sc_wyrand(&seed) == 0x61fb51318f47d2a4);
+}
+
 #ifdef SC_HAVE_WRAP
 
 int fail_snprintf;
@@ -217,6 +334,8 @@ int main()
 {
     test1();
     test_rand();
+    test_bits();
+    test_rng();
     fail_test();
 
     return 0;
@@ -0,0 +1,395 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "sc_scan.h"
+
+#include <string.h>
+
+// clang-format off
+#if !defined(SC_SCAN_NO_SIMD) && defined(__AVX2__)
+    #define SC_SCAN_AVX2
+    #include <immintrin.h>
+#elif !defined(SC_SCAN_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) ||   \
+                                    (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define SC_SCAN_SSE2
+    #include <emmintrin.h>
+#elif !defined(SC_SCAN_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+    #define SC_SCAN_NEON
+    #include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+/*
+ * Vector operations. sc_scan_mask() packs the lanes of a compare result into
+ * a bit mask, each byte takes SC_SCAN_BITS bits. sc_scan_lower() converts
+ * 'A'-'Z' to lowercase, other bytes are unchanged.
+ */
+#if defined(SC_SCAN_AVX2)
+
+typedef __m256i sc_scan_vec;
+
+    #define SC_SCAN_WIDTH 32
+    #define SC_SCAN_BITS  1
+    #define SC_SCAN_FULL  UINT64_C(0xFFFFFFFF)
+
+    #define sc_scan_load(p)  _mm256_loadu_si256((const __m256i *) (p))
+    #define sc_scan_set1(c)  _mm256_set1_epi8((char) (c))
+    #define sc_scan_eq(a, b) _mm256_cmpeq_epi8(a, b)
+    #define sc_scan_or(a, b) _mm256_or_si256(a, b)
+    #define sc_scan_mask(v)  ((uint64_t) (uint32_t) _mm256_movemask_epi8(v))
+    #define sc_scan_high(v)  sc_scan_mask(v)
+
+static inline sc_scan_vec sc_scan_lower(sc_scan_vec v)
+{
+    // 'A'-'Z' is [-128, -103] after adding 0x3F, the only signed range below
+    // -102.
+    __m256i t = _mm256_add_epi8(v, _mm256_set1_epi8(0x3F));
+    __m256i up = _mm256_cmpgt_epi8(_mm256_set1_epi8(-102), t);
+
+    return _mm256_or_si256(v, _mm256_and_si256(up, _mm256_set1_epi8(0x20)));
+}
+
+#elif defined(SC_SCAN_SSE2)
+
+typedef __m128i sc_scan_vec;
+
+    #define SC_SCAN_WIDTH 16
+    #define SC_SCAN_BITS  1
+    #define SC_SCAN_FULL  UINT64_C(0xFFFF)
+
+    #define sc_scan_load(p)  _mm_loadu_si128((const __m128i *) (p))
+    #define sc_scan_set1(c)  _mm_set1_epi8((char) (c))
+    #define sc_scan_eq(a, b) _mm_cmpeq_epi8(a, b)
+    #define sc_scan_or(a, b) _mm_or_si128(a, b)
+    #define sc_scan_mask(v)  ((uint64_t) (uint32_t) _mm_movemask_epi8(v))
+    #define sc_scan_high(v)  sc_scan_mask(v)
+
+static inline sc_scan_vec sc_scan_lower(sc_scan_vec v)
+{
+    // See AVX2 version.
+    __m128i t = _mm_add_epi8(v, _mm_set1_epi8(0x3F));
+    __m128i up = _mm_cmpgt_epi8(_mm_set1_epi8(-102), t);
+
+    return _mm_or_si128(v, _mm_and_si128(up, _mm_set1_epi8(0x20)));
+}
+
+#elif defined(SC_SCAN_NEON)
+
+typedef uint8x16_t sc_scan_vec;
+
+    #define SC_SCAN_WIDTH 16
+    #define SC_SCAN_BITS  4
+    #define SC_SCAN_FULL  UINT64_MAX
+
+    #define sc_scan_load(p)  vld1q_u8((const uint8_t *) (p))
+    #define sc_scan_set1(c)  vdupq_n_u8((uint8_t) (c))
+    #define sc_scan_eq(a, b) vceqq_u8(a, b)
+    #define sc_scan_or(a, b) vorrq_u8(a, b)
+    #define sc_scan_high(v)  sc_scan_mask(vcgeq_u8(v, vdupq_n_u8(0x80)))
+
+// Narrowing shift keeps a nibble per byte, cheaper than a movemask emulation.
+static inline uint64_t sc_scan_mask(uint8x16_t v)
+{
+    uint8x8_t n = vshrn_n_u16(vreinterpretq_u16_u8(v), 4);
+
+    return vget_lane_u64(vreinterpret_u64_u8(n), 0);
+}
+
+static inline sc_scan_vec sc_scan_lower(sc_scan_vec v)
+{
+    uint8x16_t up = vcltq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8(26));
+
+    return vorrq_u8(v, vandq_u8(up, vdupq_n_u8(0x20)));
+}
+
+#endif
+
+// clang-format on
+
+#ifdef SC_SCAN_WIDTH
+
+static inline uint32_t sc_scan_ctz(uint64_t mask)
+{
+    #if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t) __builtin_ctzll(mask);
+    #elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (uint32_t) index;
+    #else
+    uint32_t n = 0;
+
+    while ((mask & 1u) == 0) {
+        mask >>= 1u;
+        n++;
+    }
+
+    return n;
+    #endif
+}
+
+static inline uint32_t sc_scan_popcount(uint64_t mask)
+{
+    #if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t) __builtin_popcountll(mask);
+    #else
+    uint32_t n = 0;
+
+    while (mask != 0) {
+        mask &= mask - 1;
+        n++;
+    }
+
+    return n;
+    #endif
+}
+
+#endif
+
+static inline int sc_scan_tolower(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+void sc_scan_set_init(struct sc_scan_set *set, const char *chars, size_t len)
+{
+    unsigned char c;
+
+    memset(set, 0, sizeof(*set));
+
+    for (size_t i = 0; i < len; i++) {
+        c = (unsigned char) chars[i];
+        if (sc_scan_set_has(set, c)) {
+            continue;
+        }
+
+        set->map[c >> 3u] |= (uint8_t) (1u << (c & 7u));
+        if (set->count < SC_SCAN_SET_MAX) {
+            set->chars[set->count] = c;
+        }
+        set->count++;
+    }
+}
+
+size_t sc_scan_find(const struct sc_scan_set *set, const void *p, size_t len)
+{
+    size_t i = 0;
+    const unsigned char *s = p;
+
+    if (set->count == 0) {
+        return len;
+    }
+
+    if (set->count == 1) {
+        const unsigned char *c = memchr(s, set->chars[0], len);
+        return c != NULL ? (size_t) (c - s) : len;
+    }
+
+#ifdef SC_SCAN_WIDTH
+    if (set->count <= SC_SCAN_SET_MAX) {
+        uint64_t mask;
+        sc_scan_vec v, m, d[SC_SCAN_SET_MAX];
+
+        for (uint32_t j = 0; j < set->count; j++) {
+            d[j] = sc_scan_set1(set->chars[j]);
+        }
+
+        for (; i + SC_SCAN_WIDTH <= len; i += SC_SCAN_WIDTH) {
+            v = sc_scan_load(s + i);
+            m = sc_scan_eq(v, d[0]);
+
+            for (uint32_t j = 1; j < set->count; j++) {
+                m = sc_scan_or(m, sc_scan_eq(v, d[j]));
+            }
+
+            mask = sc_scan_mask(m);
+            if (mask != 0) {
+                return i + sc_scan_ctz(mask) / SC_SCAN_BITS;
+            }
+        }
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (sc_scan_set_has(set, s[i])) {
+            return i;
+        }
+    }
+
+    return len;
+}
+
+size_t sc_scan_count(const void *p, size_t len, unsigned char c)
+{
+    size_t i = 0, n = 0;
+    const unsigned char *s = p;
+
+#ifdef SC_SCAN_WIDTH
+    size_t bits = 0;
+    sc_scan_vec d = sc_scan_set1(c);
+
+    for (; i + SC_SCAN_WIDTH <= len; i += SC_SCAN_WIDTH) {
+        bits += sc_scan_popcount(sc_scan_mask(sc_scan_eq(sc_scan_load(s + i), d)));
+    }
+
+    n = bits / SC_SCAN_BITS;
+#endif
+
+    for (; i < len; i++) {
+        n += (s[i] == c);
+    }
+
+    return n;
+}
+
+bool sc_scan_ascii(const void *p, size_t len)
+{
+    size_t i = 0;
+    const unsigned char *s = p;
+
+#ifdef SC_SCAN_WIDTH
+    for (; i + SC_SCAN_WIDTH <= len; i += SC_SCAN_WIDTH) {
+        if (sc_scan_high(sc_scan_load(s + i)) != 0) {
+            return false;
+        }
+    }
+#endif
+
+    for (; i < len; i++) {
+        if (s[i] & 0x80u) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Returns byte count of a valid multibyte sequence, '0' if it is invalid.
+static size_t sc_scan_utf8_seq(const unsigned char *s, size_t len)
+{
+    size_t n;
+    uint32_t cp;
+
+    if (s[0] >= 0xC2 && s[0] <= 0xDF) {
+        n = 2;
+        cp = s[0] & 0x1Fu;
+    } else if ((s[0] & 0xF0u) == 0xE0) {
+        n = 3;
+        cp = s[0] & 0x0Fu;
+    } else if (s[0] >= 0xF0 && s[0] <= 0xF4) {
+        n = 4;
+        cp = s[0] & 0x07u;
+    } else {
+        return 0;
+    }
+
+    if (len < n) {
+        return 0;
+    }
+
+    for (size_t i = 1; i < n; i++) {
+        if ((s[i] & 0xC0u) != 0x80) {
+            return 0;
+        }
+
+        cp = (cp << 6u) | (s[i] & 0x3Fu);
+    }
+
+    if (n == 3 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) {
+        return 0;
+    }
+
+    if (n == 4 && (cp < 0x10000 || cp > 0x10FFFF)) {
+        return 0;
+    }
+
+    return n;
+}
+
+bool sc_scan_utf8(const void *p, size_t len)
+{
+    size_t i = 0, n;
+    const unsigned char *s = p;
+
+    while (i < len) {
+#ifdef SC_SCAN_WIDTH
+        if (i + SC_SCAN_WIDTH <= len &&
+            sc_scan_high(sc_scan_load(s + i)) == 0) {
+            i += SC_SCAN_WIDTH;
+            continue;
+        }
+#endif
+        if (s[i] < 0x80) {
+            i++;
+            continue;
+        }
+
+        n = sc_scan_utf8_seq(s + i, len - i);
+        if (n == 0) {
+            return false;
+        }
+
+        i += n;
+    }
+
+    return true;
+}
+
+int sc_scan_casecmp(const void *a, const void *b, size_t len)
+{
+    int ca, cb;
+    size_t i = 0;
+    const unsigned char *x = a, *y = b;
+
+#ifdef SC_SCAN_WIDTH
+    uint64_t mask;
+    sc_scan_vec va, vb;
+
+    for (; i + SC_SCAN_WIDTH <= len; i += SC_SCAN_WIDTH) {
+        va = sc_scan_lower(sc_scan_load(x + i));
+        vb = sc_scan_lower(sc_scan_load(y + i));
+
+        mask = sc_scan_mask(sc_scan_eq(va, vb));
+        if (mask != SC_SCAN_FULL) {
+            // Scalar loop below stops at the first mismatch.
+            i += sc_scan_ctz(~mask) / SC_SCAN_BITS;
+            break;
+        }
+    }
+#endif
+
+    for (; i < len; i++) {
+        ca = sc_scan_tolower(x[i]);
+        cb = sc_scan_tolower(y[i]);
+        if (ca != cb) {
+            return ca - cb;
+        }
+    }
+
+    return 0;
+}
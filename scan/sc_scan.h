@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SC_SCAN_H
+#define SC_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Byte scanning primitives for parsers. Implementation is selected at compile
+ * time : AVX2 if the compiler targets it (e.g. -mavx2 or -march=native),
+ * otherwise SSE2 on x86-64 and NEON on aarch64, otherwise scalar.
+ * Define SC_SCAN_NO_SIMD to force the scalar implementation.
+ */
+
+// Max byte count of a set that is matched with vector compares, larger sets
+// use a bitmap lookup per byte.
+#define SC_SCAN_SET_MAX 16
+
+struct sc_scan_set
+{
+    uint8_t map[32];
+    uint8_t chars[SC_SCAN_SET_MAX];
+    uint32_t count;
+};
+
+/**
+ * Initialize byte set, duplicates are ignored.
+ *
+ * e.g sc_scan_set_init(&set, "\r\n", 2);
+ *     sc_scan_set_init(&set, " \t", 3); // Includes '\0' terminator
+ *
+ * @param set   set
+ * @param chars bytes
+ * @param len   byte count
+ */
+void sc_scan_set_init(struct sc_scan_set *set, const char *chars, size_t len);
+
+/**
+ * @param set set
+ * @param c   byte
+ * @return    'true' if 'c' is in the set.
+ */
+static inline bool sc_scan_set_has(const struct sc_scan_set *set,
+                                   unsigned char c)
+{
+    return (set->map[c >> 3u] >> (c & 7u)) & 1u;
+}
+
+/**
+ * Find first byte which is in the set.
+ *
+ * @param set set
+ * @param p   data
+ * @param len data length
+ * @return    index of the first match, 'len' if there is no match.
+ */
+size_t sc_scan_find(const struct sc_scan_set *set, const void *p, size_t len);
+
+/**
+ * @param p   data
+ * @param len data length
+ * @param c   byte
+ * @return    occurrence count of 'c', e.g. line count with '\n'.
+ */
+size_t sc_scan_count(const void *p, size_t len, unsigned char c);
+
+/**
+ * @param p   data
+ * @param len data length
+ * @return    'true' if all bytes are ASCII.
+ */
+bool sc_scan_ascii(const void *p, size_t len);
+
+/**
+ * Strict UTF-8 validation : overlong encodings, surrogates and code points
+ * above U+10FFFF are invalid. ASCII runs are validated at vector speed.
+ *
+ * @param p   data
+ * @param len data length
+ * @return    'true' if data is valid UTF-8.
+ */
+bool sc_scan_utf8(const void *p, size_t len);
+
+/**
+ * ASCII case-insensitive compare, like strncasecmp() but '\0' is not special.
+ *
+ * @param a   data
+ * @param b   data
+ * @param len length of 'a' and 'b'
+ * @return    '0' if equal, negative if 'a' is less than 'b', positive
+ *            otherwise, lowercase bytes are compared.
+ */
+int sc_scan_casecmp(const void *a, const void *b, size_t len);
+
+#endif
@@ -0,0 +1,24 @@
+#include "sc_scan.h"
+
+#include <stdio.h>
+#include <string.h>
+
+int main()
+{
+    size_t n;
+    struct sc_scan_set set;
+    const char *text = "key = value ; comment\nname: sc\n";
+    size_t len = strlen(text);
+
+    sc_scan_set_init(&set, "=:;\n", 4);
+
+    n = sc_scan_find(&set, text, len);
+    printf("First delimiter '%c' at : %zu \n", text[n], n);
+
+    printf("Lines : %zu \n", sc_scan_count(text, len, '\n'));
+    printf("ASCII : %d \n", sc_scan_ascii(text, len));
+    printf("UTF-8 : %d \n", sc_scan_utf8("\xC3\xA9t\xC3\xA9", 6));
+    printf("Equal : %d \n", sc_scan_casecmp("Host", "HOST", 4) == 0);
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include "sc_scan.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t ref_find(const char *set, size_t n, const unsigned char *p,
+                       size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (memchr(set, p[i], n) != NULL) {
+            return i;
+        }
+    }
+
+    return len;
+}
+
+static int ref_casecmp(const unsigned char *a, const unsigned char *b,
+                       size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        int x = (a[i] >= 'A' && a[i] <= 'Z') ? a[i] + 32 : a[i];
+        int y = (b[i] >= 'A' && b[i] <= 'Z') ? b[i] + 32 : b[i];
+
+        if (x != y) {
+            return x - y;
+        }
+    }
+
+    return 0;
+}
+
+static int sign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+void test_find(void)
+{
+    unsigned char buf[300];
+    struct sc_scan_set set;
+    const char *sets[] = {"", "\n", "\r\n", "=:;#", "\0 \t", "abcdefghijklmnop",
+                          "abcdefghijklmnopq"};
+    const size_t lens[] = {0, 1, 2, 4, 3, 16, 17};
+
+    sc_scan_set_init(&set, "aab", 3);
+    assert(set.count == 2);
+    assert(sc_scan_set_has(&set, 'a') && sc_scan_set_has(&set, 'b'));
+    assert(!sc_scan_set_has(&set, 'c') && !sc_scan_set_has(&set, 0xFF));
+
+    sc_scan_set_init(&set, "\xFF", 1);
+    assert(sc_scan_find(&set, "ab\xFF", 3) == 2);
+
+    for (size_t k = 0; k < sizeof(sets) / sizeof(sets[0]); k++) {
+        sc_scan_set_init(&set, sets[k], lens[k]);
+
+        for (int r = 0; r < 200; r++) {
+            size_t len = (size_t) rand() % sizeof(buf);
+
+            for (size_t i = 0; i < len; i++) {
+                // Sparse matches
+                buf[i] = (unsigned char) (rand() % 8 == 0 ? rand() % 128 :
+                                                            'z' + rand() % 3);
+            }
+
+            for (size_t off = 0; off < 3 && off <= len; off++) {
+                assert(sc_scan_find(&set, buf + off, len - off) ==
+                       ref_find(sets[k], lens[k], buf + off, len - off));
+            }
+        }
+    }
+
+    // Match at each position of a block
+    sc_scan_set_init(&set, "\r\n", 2);
+    for (size_t i = 0; i < 100; i++) {
+        memset(buf, 'x', sizeof(buf));
+        buf[i] = '\n';
+        assert(sc_scan_find(&set, buf, sizeof(buf)) == i);
+        assert(sc_scan_find(&set, buf, i) == i);
+    }
+
+    assert(sc_scan_find(&set, NULL, 0) == 0);
+}
+
+void test_count(void)
+{
+    size_t n;
+    unsigned char buf[1000];
+
+    assert(sc_scan_count("", 0, '\n') == 0);
+    assert(sc_scan_count("a\nb\n\n", 5, '\n') == 3);
+
+    for (int r = 0; r < 200; r++) {
+        size_t len = (size_t) rand() % sizeof(buf);
+
+        n = 0;
+        for (size_t i = 0; i < len; i++) {
+            buf[i] = (unsigned char) (rand() % 4 == 0 ? '\n' : rand() % 256);
+            n += buf[i] == '\n';
+        }
+
+        assert(sc_scan_count(buf, len, '\n') == n);
+    }
+
+    memset(buf, 0xFF, sizeof(buf));
+    assert(sc_scan_count(buf, sizeof(buf), 0xFF) == sizeof(buf));
+    assert(sc_scan_count(buf, sizeof(buf), 0) == 0);
+}
+
+void test_ascii(void)
+{
+    char buf[200];
+
+    assert(sc_scan_ascii("", 0));
+    assert(sc_scan_ascii("hello", 5));
+
+    memset(buf, 'a', sizeof(buf));
+    assert(sc_scan_ascii(buf, sizeof(buf)));
+
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (char) 0x80;
+        assert(!sc_scan_ascii(buf, sizeof(buf)));
+        assert(sc_scan_ascii(buf, i));
+        buf[i] = 'a';
+    }
+}
+
+void test_utf8(void)
+{
+    char buf[200];
+
+    assert(sc_scan_utf8("", 0));
+    assert(sc_scan_utf8("ascii", 5));
+    assert(sc_scan_utf8("\xC3\xA9t\xC3\xA9", 6));         // été
+    assert(sc_scan_utf8("\xE2\x82\xAC", 3));              // U+20AC
+    assert(sc_scan_utf8("\xED\x9F\xBF", 3));              // U+D7FF
+    assert(sc_scan_utf8("\xEE\x80\x80", 3));              // U+E000
+    assert(sc_scan_utf8("\xF0\x9F\x98\x80", 4));          // U+1F600
+    assert(sc_scan_utf8("\xF4\x8F\xBF\xBF", 4));          // U+10FFFF
+    assert(sc_scan_utf8("a\0b", 3));
+
+    assert(!sc_scan_utf8("\x80", 1));                     // Continuation
+    assert(!sc_scan_utf8("\xC0\xAF", 2));                 // Overlong
+    assert(!sc_scan_utf8("\xC1\xBF", 2));                 // Overlong
+    assert(!sc_scan_utf8("\xE0\x9F\xBF", 3));             // Overlong
+    assert(!sc_scan_utf8("\xF0\x8F\xBF\xBF", 4));         // Overlong
+    assert(!sc_scan_utf8("\xED\xA0\x80", 3));             // Surrogate
+    assert(!sc_scan_utf8("\xED\xBF\xBF", 3));             // Surrogate
+    assert(!sc_scan_utf8("\xF4\x90\x80\x80", 4));         // > U+10FFFF
+    assert(!sc_scan_utf8("\xF5\x80\x80\x80", 4));
+    assert(!sc_scan_utf8("\xFF", 1));
+    assert(!sc_scan_utf8("\xE2\x82", 2));                 // Truncated
+    assert(!sc_scan_utf8("\xE2\x82\x41", 3));             // Bad continuation
+    assert(!sc_scan_utf8("\xF0\x9F\x98", 3));
+
+    // Multibyte sequences at block boundaries
+    for (size_t i = 0; i < 100; i++) {
+        memset(buf, 'a', sizeof(buf));
+        memcpy(buf + i, "\xF0\x9F\x98\x80", 4);
+        assert(sc_scan_utf8(buf, sizeof(buf)));
+        assert(!sc_scan_utf8(buf, i + 3));
+
+        buf[i + 2] = 'a';
+        assert(!sc_scan_utf8(buf, sizeof(buf)));
+    }
+}
+
+void test_casecmp(void)
+{
+    unsigned char a[200], b[200];
+
+    assert(sc_scan_casecmp("", "", 0) == 0);
+    assert(sc_scan_casecmp("Content-Length", "content-length", 14) == 0);
+    assert(sc_scan_casecmp("abc", "ABD", 3) < 0);
+    assert(sc_scan_casecmp("abd", "ABC", 3) > 0);
+    assert(sc_scan_casecmp("a@[`{", "A@[`{", 5) == 0);
+    assert(sc_scan_casecmp("@", "`", 1) != 0);
+    assert(sc_scan_casecmp("[", "{", 1) != 0);
+    assert(sc_scan_casecmp("\xC1", "\xE1", 1) != 0);
+
+    // All byte pairs
+    for (int i = 0; i < 256; i++) {
+        for (int j = 0; j < 256; j++) {
+            unsigned char x = (unsigned char) i, y = (unsigned char) j;
+
+            memset(a, 'q', 40);
+            memset(b, 'Q', 40);
+            a[33] = x;
+            b[33] = y;
+            assert(sign(sc_scan_casecmp(a, b, 40)) ==
+                   sign(ref_casecmp(a, b, 40)));
+        }
+    }
+
+    for (int r = 0; r < 1000; r++) {
+        size_t len = (size_t) rand() % sizeof(a);
+
+        for (size_t i = 0; i < len; i++) {
+            a[i] = (unsigned char) (rand() % 256);
+            b[i] = (unsigned char) (rand() % 2 ? a[i] ^ 0x20 : a[i]);
+        }
+
+        if (len > 0 && rand() % 2) {
+            b[rand() % len] = (unsigned char) (rand() % 256);
+        }
+
+        assert(sign(sc_scan_casecmp(a, b, len)) ==
+               sign(ref_casecmp(a, b, len)));
+    }
+}
+
+int main(void)
+{
+    test_find();
+    test_count();
+    test_ascii();
+    test_utf8();
+    test_casecmp();
+
+    return 0;
+}
@@ -56,6 +56,54 @@ volatile sig_atomic_t sc_signal_log_fd;
  */
 volatile sig_atomic_t sc_signal_will_shutdown;
 
+#if defined(_MSC_VER)
+    #define sc_signal_fetch_add(p, v)                                          \
+        ((uint64_t) InterlockedExchangeAdd64((volatile LONG64 *) (p),          \
+                                             (LONG64) (v)))
+    #define sc_signal_load(p)     (*(volatile uint64_t *) (p))
+    #define sc_signal_store(p, v) (*(volatile uint64_t *) (p) = (v))
+    #define sc_signal_load_ptr(p) (*(void *volatile *) (p))
+    #define sc_signal_store_ptr(p, v) (*(void *volatile *) (p) = (v))
+    #define sc_signal_fetch_add_sc(p, v) sc_signal_fetch_add(p, v)
+    #define sc_signal_xchg(p, v)                                               \
+        ((uint64_t) InterlockedExchange64((volatile LONG64 *) (p),             \
+                                          (LONG64) (v)))
+#else
+    #define sc_signal_fetch_add(p, v) __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+    #define sc_signal_load(p)         __atomic_load_n(p, __ATOMIC_ACQUIRE)
+    #define sc_signal_store(p, v)     __atomic_store_n(p, v, __ATOMIC_RELEASE)
+    #define sc_signal_load_ptr(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+    #define sc_signal_store_ptr(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+    #define sc_signal_fetch_add_sc(p, v)                                       \
+        __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST)
+    #define sc_signal_xchg(p, v) __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST)
+#endif
+
+// "scring01"
+#define SC_SIGNAL_RING_MAGIC 0x31306772696e6373ull
+
+struct sc_signal_ring
+{
+    uint64_t magic;
+    uint64_t head;
+    uint32_t cap;
+    uint32_t entry;
+    uint64_t pad[5];
+};
+
+/**
+ * Each entry is 'seq' of the event + 1 (0 while being written), length and
+ * data. Dump checks 'seq' before and after the copy.
+ */
+struct sc_signal_entry
+{
+    uint64_t seq;
+    uint32_t len;
+    char data[];
+};
+
+static struct sc_signal_ring *sc_signal_ring;
+
 #define get_uint(va, size)                                                     \
     (size) == 3 ? va_arg(va, unsigned long long) :                             \
     (size) == 2 ? va_arg(va, unsigned long) :                                  \
@@ -244,6 +292,7 @@ LONG WINAPI sc_signal_on_fatal(PEXCEPTION_POINTERS info)
 
     sc_signal_log(fd, buf, sizeof(buf), "Fatal signal : %d, shutting down! \n",
                   info->ExceptionRecord->ExceptionCode);
+    sc_signal_ring_dump(fd);
 
     return 0;
 }
@@ -274,6 +323,7 @@ void sc_signal_std_on_fatal(int type)
 
     sc_signal_log(fd, buf, sizeof(buf),
                   "Fatal signal : [%s][%d], shutting down! \n", sig_str, type);
+    sc_signal_ring_dump(fd);
 
     _Exit(1);
 }
@@ -459,6 +509,8 @@ static void sc_signal_on_fatal(int sig, siginfo_t *info, void *context)
 #else
     (void) context;
 #endif
+    sc_signal_ring_dump(fd);
+
     sc_signal_log(fd, buf, sizeof(buf),
                   "\n--------------- CRASH REPORT END -------------- \n");
 
@@ -503,6 +555,13 @@ int sc_signal_init()
     rc &= (sigaction(SIGFPE, &action, NULL) == 0);
     rc &= (sigaction(SIGILL, &action, NULL) == 0);
 
+#ifdef HAVE_BACKTRACE
+    // First call of backtrace() may load libgcc and allocate, that is not
+    // safe in a signal handler, do it here.
+    void *trace[1];
+    (void) backtrace(trace, 1);
+#endif
+
     return rc ? 0 : -1;
 }
 
@@ -519,3 +578,185 @@ void sc_signal_log(int fd, char *buf, size_t len, char *fmt, ...)
 
     (void) write(fd, buf, (size_t) written);
 }
+
+static struct sc_signal_entry *sc_signal_ring_at(struct sc_signal_ring *r,
+                                                 uint64_t seq)
+{
+    char *entries = (char *) (r + 1);
+    size_t index = (size_t) (seq & (r->cap - 1));
+
+    return (struct sc_signal_entry *) (entries + index * r->entry);
+}
+
+int sc_signal_ring_init(void *mem, size_t size)
+{
+    size_t cap = 1;
+    struct sc_signal_ring *r = mem;
+
+    if (mem == NULL) {
+        sc_signal_store_ptr(&sc_signal_ring, NULL);
+        return 0;
+    }
+
+    if (size < sizeof(*r) + 2 * SC_SIGNAL_RING_ENTRY) {
+        return -1;
+    }
+
+    while (cap * 2 <= (size - sizeof(*r)) / SC_SIGNAL_RING_ENTRY &&
+           cap * 2 <= UINT32_MAX) {
+        cap *= 2;
+    }
+
+    sc_signal_store_ptr(&sc_signal_ring, NULL);
+
+    *r = (struct sc_signal_ring){
+            .magic = SC_SIGNAL_RING_MAGIC,
+            .cap = (uint32_t) cap,
+            .entry = SC_SIGNAL_RING_ENTRY,
+    };
+
+    for (size_t i = 0; i < cap; i++) {
+        sc_signal_ring_at(r, i)->seq = 0;
+    }
+
+    sc_signal_store_ptr(&sc_signal_ring, r);
+
+    return 0;
+}
+
+int sc_signal_ring_enabled(void)
+{
+    return sc_signal_load_ptr(&sc_signal_ring) != NULL;
+}
+
+void sc_signal_ring_add(const char *str, size_t len)
+{
+    uint64_t seq;
+    struct sc_signal_entry *e;
+    struct sc_signal_ring *r = sc_signal_load_ptr(&sc_signal_ring);
+    const size_t max = SC_SIGNAL_RING_ENTRY - sizeof(*e);
+
+    if (r == NULL) {
+        return;
+    }
+
+    seq = sc_signal_fetch_add(&r->head, 1);
+    e = sc_signal_ring_at(r, seq);
+    len = len < max ? len : max;
+
+    // Seqlock style, the entry is invalid while being written. Exchange
+    // instead of a store, so the writes below can't be reordered before it.
+    sc_signal_xchg(&e->seq, 0);
+    e->len = (uint32_t) len;
+    memcpy(e->data, str, len);
+    sc_signal_store(&e->seq, seq + 1);
+}
+
+void sc_signal_ring_addf(const char *fmt, ...)
+{
+    int len;
+    va_list args;
+    char buf[SC_SIGNAL_RING_ENTRY];
+
+    if (!sc_signal_ring_enabled()) {
+        return;
+    }
+
+    va_start(args, fmt);
+    len = sc_signal_vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    if (len >= 0) {
+        sc_signal_ring_add(buf, (size_t) len);
+    }
+}
+
+// 'live' is false if 'r' is a copy, e.g. read-only mapping of a ring file.
+static void sc_signal_ring_write(int fd, struct sc_signal_ring *r, bool live)
+{
+    uint32_t len;
+    uint64_t seq, head, start;
+    struct sc_signal_entry *e;
+    char buf[SC_SIGNAL_RING_ENTRY + 1];
+    char hdr[128];
+
+    head = sc_signal_load(&r->head);
+    start = head > r->cap ? head - r->cap : 0;
+
+    sc_signal_log(fd, hdr, sizeof(hdr),
+                  "\n--------------- RECENT EVENTS (%llu) ------------- \n",
+                  (unsigned long long) (head - start));
+
+    for (uint64_t i = start; i < head; i++) {
+        e = sc_signal_ring_at(r, i);
+
+        seq = sc_signal_load(&e->seq);
+        if (seq != i + 1) {
+            continue;
+        }
+
+        len = e->len;
+        len = len < r->entry - sizeof(*e) ? len : r->entry - sizeof(*e);
+        memcpy(buf, e->data, len);
+
+        // RMW with release semantics, the copy above can't be reordered
+        // after it. Nobody writes to a copy, it may not be writable anyway.
+        if (live && sc_signal_fetch_add_sc(&e->seq, 0) != seq) {
+            continue;
+        }
+
+        if (len == 0 || buf[len - 1] != '\n') {
+            buf[len++] = '\n';
+        }
+
+        (void) write(fd, buf, len);
+    }
+}
+
+void sc_signal_ring_dump(int fd)
+{
+    struct sc_signal_ring *r = sc_signal_load_ptr(&sc_signal_ring);
+
+    if (r != NULL) {
+        sc_signal_ring_write(fd, r, true);
+    }
+}
+
+int sc_signal_ring_dump_mem(int fd, const void *mem, size_t size)
+{
+    struct sc_signal_ring *r = (struct sc_signal_ring *) mem;
+
+    if (size < sizeof(*r) || r->magic != SC_SIGNAL_RING_MAGIC ||
+        r->entry != SC_SIGNAL_RING_ENTRY || r->cap == 0 ||
+        (r->cap & (r->cap - 1)) != 0 ||
+        (size - sizeof(*r)) / r->entry < r->cap) {
+        return -1;
+    }
+
+    sc_signal_ring_write(fd, r, false);
+
+    return 0;
+}
+
+#ifdef SC_SIGNAL_HAVE_MMAP
+
+int sc_signal_ring_open(struct sc_mmap *m, const char *path, size_t size)
+{
+    int rc;
+
+    rc = sc_mmap_init(m, path, O_RDWR | O_CREAT, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, 0, size);
+    if (rc != 0) {
+        return -1;
+    }
+
+    rc = sc_signal_ring_init(m->ptr, m->len);
+    if (rc != 0) {
+        sc_mmap_term(m);
+        return -1;
+    }
+
+    return 0;
+}
+
+#endif
@@ -29,6 +29,10 @@
 #include <stddef.h>
 #include <stdarg.h>
 
+#ifdef SC_SIGNAL_HAVE_MMAP
+    #include "sc_mmap.h"
+#endif
+
 /**
  * Set shutdown fd here. When shutdown signal is received e.g SIGINT, SIGTERM.
  * Signal handler will write 1 byte to shutdown fd. So, your app can detect
@@ -95,4 +99,96 @@ int sc_signal_vsnprintf(char *buf, size_t size, const char *fmt, va_list va);
  */
 int sc_signal_snprintf(char *buf, size_t size, const char *fmt, ...);
 
+/**
+ * Crash ring, a preallocated in memory ring of recent events. Fatal signal
+ * handler dumps it after the backtrace, so the last events before the crash
+ * are not lost in buffered logs.
+ *
+ * Adding an event is lock-free, an atomic increment and a copy into a fixed
+ * size entry, so it is cheap enough for hot paths and it is async-signal-safe.
+ * Longer events are truncated. When the ring is full, oldest events are
+ * overwritten. If a writer is preempted in the middle of a copy, that entry is
+ * skipped in the dump.
+ *
+ * Ring memory can be an sc_mmap'ed file (MAP_SHARED), then the events survive
+ * the process even if it is killed with SIGKILL. Use sc_signal_ring_dump_mem()
+ * to print a ring left by a previous run, before calling sc_signal_ring_init()
+ * on the same memory.
+ *
+ * static char ring[64 * 1024];
+ *
+ * sc_signal_init();
+ * sc_signal_ring_init(ring, sizeof(ring));
+ *
+ * sc_signal_ring_addf("accepted fd : %d", fd);
+ */
+
+// Entry size including a 16 bytes header.
+#ifndef SC_SIGNAL_RING_ENTRY
+    #define SC_SIGNAL_RING_ENTRY 128
+#endif
+
+/**
+ * @param mem  ring memory, must be 8 bytes aligned and must outlive the ring,
+ *             NULL to disable.
+ * @param size memory size, entry count is the largest power of two fits in.
+ * @return     '0' on success, '-1' if memory is too small for two entries.
+ */
+int sc_signal_ring_init(void *mem, size_t size);
+
+/**
+ * @return '1' if a ring is set, '0' otherwise.
+ */
+int sc_signal_ring_enabled(void);
+
+/**
+ * Add an event, no-op if ring is not set.
+ *
+ * @param str event
+ * @param len event length
+ */
+void sc_signal_ring_add(const char *str, size_t len);
+
+/**
+ * Add an event, formatted with sc_signal_vsnprintf().
+ *
+ * @param fmt fmt
+ * @param ... args
+ */
+void sc_signal_ring_addf(const char *fmt, ...);
+
+/**
+ * Write events of the ring to 'fd', oldest first, async-signal-safe.
+ * @param fd fd
+ */
+void sc_signal_ring_dump(int fd);
+
+/**
+ * Write events of a ring to 'fd', e.g a ring file of a crashed process.
+ *
+ * @param fd   fd
+ * @param mem  ring memory
+ * @param size memory size
+ * @return     '0' on success, '-1' if 'mem' does not contain a ring.
+ */
+int sc_signal_ring_dump_mem(int fd, const void *mem, size_t size);
+
+#ifdef SC_SIGNAL_HAVE_MMAP
+
+/**
+ * Map 'path' with sc_mmap and use it as the ring, requires sc_mmap (compile
+ * with -DSC_SIGNAL_HAVE_MMAP). File is created or resized to 'size' bytes.
+ * Previous content is overwritten, call sc_signal_ring_dump_mem() on a mapping
+ * of the file before if it is needed. Call sc_mmap_term() after disabling the
+ * ring with sc_signal_ring_init(NULL, 0).
+ *
+ * @param m    mmap
+ * @param path file path
+ * @param size file size
+ * @return     '0' on success, '-1' on failure.
+ */
+int sc_signal_ring_open(struct sc_mmap *m, const char *path, size_t size);
+
+#endif
+
 #endif
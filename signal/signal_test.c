@@ -1,8 +1,14 @@
 #include "sc_signal.h"
 
 #include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
+#if !defined(_WIN32)
+    #include <unistd.h>
+#endif
+
 void test1()
 {
     char tmp[128] = "";
@@ -46,6 +52,121 @@ void test2()
     assert(sc_signal_init() == 0);
 }
 
+#if !defined(_WIN32)
+
+static size_t dump(const void *mem, size_t size, char *out, size_t cap)
+{
+    int fds[2];
+    ssize_t n;
+    size_t len = 0;
+
+    assert(pipe(fds) == 0);
+    if (mem == NULL) {
+        sc_signal_ring_dump(fds[1]);
+    } else {
+        assert(sc_signal_ring_dump_mem(fds[1], mem, size) == 0);
+    }
+    close(fds[1]);
+
+    while ((n = read(fds[0], out + len, cap - len - 1)) > 0) {
+        len += (size_t) n;
+    }
+    out[len] = '\0';
+    close(fds[0]);
+
+    return len;
+}
+
+void test_ring()
+{
+    char out[8192], big[512];
+    uint64_t mem[(4096 + 64) / 8];
+    uint64_t small[8];
+
+    // Disabled
+    assert(sc_signal_ring_init(NULL, 0) == 0);
+    assert(!sc_signal_ring_enabled());
+    sc_signal_ring_add("x", 1);
+    sc_signal_ring_addf("%d", 1);
+    assert(dump(NULL, 0, out, sizeof(out)) == 0);
+
+    assert(sc_signal_ring_init(small, sizeof(small)) == -1);
+    assert(sc_signal_ring_dump_mem(1, small, sizeof(small)) == -1);
+    assert(!sc_signal_ring_enabled());
+
+    // 64 bytes header, 32 entries
+    assert(sc_signal_ring_init(mem, sizeof(mem)) == 0);
+    assert(sc_signal_ring_enabled());
+    dump(NULL, 0, out, sizeof(out));
+    assert(strstr(out, "RECENT EVENTS (0)") != NULL);
+
+    sc_signal_ring_add("first", 5);
+    sc_signal_ring_addf("second %d %s", 2, "x");
+    sc_signal_ring_add("third\n", 6);
+    dump(NULL, 0, out, sizeof(out));
+    assert(strstr(out, "RECENT EVENTS (3)") != NULL);
+    assert(strstr(out, "first\nsecond 2 x\nthird\n") != NULL);
+
+    // Truncated to entry size
+    memset(big, 'a', sizeof(big));
+    sc_signal_ring_add(big, sizeof(big));
+    dump(NULL, 0, out, sizeof(out));
+    assert(strstr(out, "third\n") != NULL);
+    assert(strlen(strstr(out, "third\n") + 6) == SC_SIGNAL_RING_ENTRY - 16 + 1);
+
+    // Oldest events are overwritten
+    for (int i = 0; i < 100; i++) {
+        sc_signal_ring_addf("event-%d", i);
+    }
+    dump(NULL, 0, out, sizeof(out));
+    assert(strstr(out, "RECENT EVENTS (32)") != NULL);
+    assert(strstr(out, "first") == NULL);
+    assert(strstr(out, "event-67\n") == NULL);
+    assert(strstr(out, "event-68\nevent-69\n") != NULL);
+    assert(strstr(out, "event-99\n") != NULL);
+
+    // Memory of a previous ring
+    assert(sc_signal_ring_init(NULL, 0) == 0);
+    dump(mem, sizeof(mem), out, sizeof(out));
+    assert(strstr(out, "event-99\n") != NULL);
+    assert(sc_signal_ring_dump_mem(1, mem, 100) == -1);
+}
+
+    #ifdef SC_SIGNAL_HAVE_MMAP
+void test_ring_mmap()
+{
+    char out[8192];
+    struct sc_mmap m;
+
+    assert(sc_signal_ring_open(&m, "/dev/null/x", 4096) == -1);
+    assert(sc_signal_ring_open(&m, "ring.bin", 16) == -1);
+    assert(sc_signal_ring_open(&m, "ring.bin", 8192) == 0);
+    sc_signal_ring_addf("mapped %d", 1);
+    assert(sc_signal_ring_init(NULL, 0) == 0);
+    assert(sc_mmap_term(&m) == 0);
+
+    assert(sc_mmap_init(&m, "ring.bin", O_RDONLY, PROT_READ, MAP_SHARED, 0,
+                        0) == 0);
+    dump(m.ptr, m.len, out, sizeof(out));
+    assert(strstr(out, "mapped 1\n") != NULL);
+    assert(sc_mmap_term(&m) == 0);
+    unlink("ring.bin");
+}
+    #else
+void test_ring_mmap()
+{
+}
+    #endif
+
+#else
+void test_ring()
+{
+}
+void test_ring_mmap()
+{
+}
+#endif
+
 #ifdef SC_HAVE_WRAP
     #include <stdbool.h>
     #include <stdio.h>
@@ -217,7 +338,51 @@ void test8()
     }
 }
 
+void test9()
+{
+    int fds[2];
+    char out[16384];
+    ssize_t n;
+    size_t len = 0;
+    static uint64_t mem[1024];
+
+    assert(pipe(fds) == 0);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        assert(true);
+    } else if (pid) {
+        int status = 0;
+
+        close(fds[1]);
+        while ((n = read(fds[0], out + len, sizeof(out) - len - 1)) > 0) {
+            len += (size_t) n;
+        }
+        out[len] = '\0';
+        close(fds[0]);
+        wait(&status);
+
+        assert(strstr(out, "CRASH REPORT") != NULL);
+        assert(strstr(out, "before crash 9\n") != NULL);
+    } else {
+        close(fds[0]);
+        assert(sc_signal_init() == 0);
+        assert(sc_signal_ring_init(mem, sizeof(mem)) == 0);
+        sc_signal_log_fd = fds[1];
+
+        for (int i = 0; i < 10; i++) {
+            sc_signal_ring_addf("before crash %d", i);
+        }
+
+        raise(SIGSEGV);
+        exit(-2);
+    }
+}
+
 #else
+void test9()
+{
+}
 void test3()
 {
 }
@@ -248,6 +413,9 @@ int main()
     test6();
     test7();
     test8();
+    test9();
+    test_ring();
+    test_ring_mmap();
 
     return 0;
 }
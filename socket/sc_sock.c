@@ -22,6 +22,21 @@
  * SOFTWARE.
  */
 
+#if defined(__linux__)
+    #ifndef _GNU_SOURCE
+        #define _GNU_SOURCE
+    #endif
+#elif defined(__APPLE__)
+    // sendfile() is hidden by _XOPEN_SOURCE otherwise
+    #ifndef _DARWIN_C_SOURCE
+        #define _DARWIN_C_SOURCE
+    #endif
+#elif defined(__FreeBSD__)
+    #ifndef __BSD_VISIBLE
+        #define __BSD_VISIBLE 1
+    #endif
+#endif
+
 #ifndef _XOPEN_SOURCE
     #define _XOPEN_SOURCE 700
 #endif
@@ -34,15 +49,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #ifndef SC_SIZE_MAX
     #define SC_SIZE_MAX INT32_MAX
 #endif
 
+#ifdef SC_STATS
+    #include "sc_stats.h"
+#elif !defined(SC_STATS_ADD)
+    #define SC_STATS_ADD(name, n) ((void) (n))
+    #define SC_STATS_MAX(name, v) ((void) (v))
+#endif
+
 #if defined(_WIN32) || defined(_WIN64)
     #include <Ws2tcpip.h>
     #include <afunix.h>
     #include <assert.h>
+    #include <io.h>
 
     #pragma warning(disable : 4996)
     #define sc_close(n)    closesocket(n)
@@ -93,6 +117,13 @@ int sc_sock_set_blocking(struct sc_sock *sock, bool blocking)
     #include <unistd.h>
     #include <sys/time.h>
 
+    #if defined(__linux__)
+        #include <sys/sendfile.h>
+    #elif defined(__APPLE__) || defined(__FreeBSD__)
+        #include <sys/types.h>
+        #include <sys/uio.h>
+    #endif
+
     #define sc_close(n)    close(n)
     #define sc_unlink(n)   unlink(n)
     #define SC_ERR         (-1)
@@ -135,10 +166,170 @@ void sc_sock_init(struct sc_sock *sock, int type, bool blocking, int family)
     sock->fdt.index = -1;
     sock->blocking = blocking;
     sock->family = family;
+    sock->profile = SC_SOCK_PROFILE_DEFAULT;
 
     memset(sock->err, 0, sizeof(sock->err));
+#ifdef SC_SOCK_HAVE_STATS
+    sock->stats = (struct sc_sock_stats){0};
+#endif
+}
+
+#if defined(SC_SOCK_HAVE_STATS) || defined(SC_SOCK_HAVE_HIST)
+
+static uint64_t sc_sock_time_ns(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER count, freq;
+
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+
+    return (uint64_t) ((count.QuadPart / freq.QuadPart) * 1000000000 +
+                       (count.QuadPart % freq.QuadPart) * 1000000000 /
+                               freq.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+#endif
+
+#ifdef SC_SOCK_HAVE_HIST
+
+void sc_sock_poll_set_hist(struct sc_sock_poll *p, struct sc_hist *hist)
+{
+    p->hist = hist;
+    p->hist_wake = 0;
+}
+
+/* Dispatch of the previous wakeup ends here */
+static void sc_sock_poll_hist_begin(struct sc_sock_poll *p)
+{
+    if (p->hist != NULL && p->hist_wake != 0) {
+        sc_hist_record(p->hist, sc_sock_time_ns() - p->hist_wake);
+    }
+}
+
+static void sc_sock_poll_hist_end(struct sc_sock_poll *p)
+{
+    if (p->hist != NULL) {
+        p->hist_wake = sc_sock_time_ns();
+    }
+}
+
+#else
+    #define sc_sock_poll_hist_begin(p) ((void) 0)
+    #define sc_sock_poll_hist_end(p)   ((void) 0)
+#endif
+
+#ifdef SC_SOCK_HAVE_STATS
+
+#if defined(_MSC_VER)
+    #define sc_sock_stat_load(p)   (*(volatile uint64_t *) (p))
+    #define sc_sock_stat_add(p, v) (*(volatile uint64_t *) (p) += (v))
+#else
+    // Single writer, so a relaxed load and store is enough, no RMW needed.
+    #define sc_sock_stat_load(p) __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_sock_stat_add(p, v)                                             \
+        __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + (v),        \
+                         __ATOMIC_RELAXED)
+#endif
+
+static uint64_t sc_sock_time_us(void)
+{
+    return sc_sock_time_ns() / 1000;
+}
+
+static int sc_sock_stat_io(struct sc_sock *sock, bool send, int rc)
+{
+    struct sc_sock_stats *st = &sock->stats;
+
+    sc_sock_stat_add(send ? &st->send_calls : &st->recv_calls, 1);
+
+    if (rc > 0) {
+        sc_sock_stat_add(send ? &st->bytes_sent : &st->bytes_recv, rc);
+    } else if (rc == SC_SOCK_WANT_READ || rc == SC_SOCK_WANT_WRITE) {
+        sc_sock_stat_add(send ? &st->send_again : &st->recv_again, 1);
+    } else if (rc == SC_SOCK_ERROR) {
+        sc_sock_stat_add(&st->errors, 1);
+    }
+
+    return rc;
+}
+
+void sc_sock_stats_get(struct sc_sock *sock, struct sc_sock_stats *out)
+{
+    struct sc_sock_stats *st = &sock->stats;
+
+    out->bytes_sent = sc_sock_stat_load(&st->bytes_sent);
+    out->bytes_recv = sc_sock_stat_load(&st->bytes_recv);
+    out->send_calls = sc_sock_stat_load(&st->send_calls);
+    out->recv_calls = sc_sock_stat_load(&st->recv_calls);
+    out->send_again = sc_sock_stat_load(&st->send_again);
+    out->recv_again = sc_sock_stat_load(&st->recv_again);
+    out->errors = sc_sock_stat_load(&st->errors);
+}
+
+/* Dispatch of the previous wakeup ends here */
+static void sc_sock_poll_stat_begin(struct sc_sock_poll *p)
+{
+    int i = 0;
+    uint64_t us;
+    struct sc_sock_poll_stats *st = &p->stats;
+
+    if (p->wake == 0) {
+        return;
+    }
+
+    us = sc_sock_time_us() - p->wake;
+    while (i < SC_SOCK_POLL_HIST - 1 && us >= ((uint64_t) 1 << i)) {
+        i++;
+    }
+
+    sc_sock_stat_add(&st->hist[i], 1);
+
+    if (us > st->max_us) {
+        sc_sock_stat_add(&st->max_us, us - st->max_us);
+    }
+}
+
+static void sc_sock_poll_stat_end(struct sc_sock_poll *p, int n)
+{
+    sc_sock_stat_add(&p->stats.waits, 1);
+    sc_sock_stat_add(&p->stats.events, n > 0 ? n : 0);
+    SC_STATS_ADD("sock.poll_wait", 1);
+    SC_STATS_ADD("sock.poll_event", n > 0 ? n : 0);
+    p->wake = sc_sock_time_us();
+}
+
+void sc_sock_poll_stats_get(struct sc_sock_poll *p,
+                            struct sc_sock_poll_stats *out)
+{
+    struct sc_sock_poll_stats *st = &p->stats;
+
+    out->waits = sc_sock_stat_load(&st->waits);
+    out->events = sc_sock_stat_load(&st->events);
+    out->max_us = sc_sock_stat_load(&st->max_us);
+
+    for (int i = 0; i < SC_SOCK_POLL_HIST; i++) {
+        out->hist[i] = sc_sock_stat_load(&st->hist[i]);
+    }
 }
 
+#else
+    #define sc_sock_stat_io(sock, send, rc) (rc)
+    #define sc_sock_poll_stat_begin(p)      ((void) 0)
+    #define sc_sock_poll_stat_end(p, n)                                        \
+        do {                                                                   \
+            SC_STATS_ADD("sock.poll_wait", 1);                                 \
+            SC_STATS_ADD("sock.poll_event", (n) > 0 ? (n) : 0);                \
+            (void) (p);                                                        \
+        } while (0)
+#endif
+
 static int sc_sock_close(struct sc_sock *sock)
 {
     int rc = 0;
@@ -203,6 +394,77 @@ int sc_sock_set_sndtimeo(struct sc_sock *sock, int ms)
     return rc == 0 ? SC_SOCK_OK : SC_SOCK_ERROR;
 }
 
+static void sc_sock_opt_try(sc_sock_int fd, int level, int opt, int val)
+{
+    int rc;
+
+    rc = setsockopt(fd, level, opt, (void *) &val, sizeof(val));
+    (void) rc;
+}
+
+static int sc_sock_profile_apply(struct sc_sock *sock)
+{
+    int rc;
+    const socklen_t sz = sizeof(int);
+    const sc_sock_int fd = sock->fdt.fd;
+    int bf = SC_SOCK_BUF_SIZE;
+
+    if (sock->profile == SC_SOCK_HIGH_THROUGHPUT) {
+        bf = SC_SOCK_BUF_SIZE_HIGH;
+    }
+
+    rc = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (void *) &bf, sz);
+    if (rc != 0) {
+        goto error;
+    }
+
+    rc = setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (void *) &bf, sz);
+    if (rc != 0) {
+        goto error;
+    }
+
+    if (sock->family == AF_UNIX) {
+        return 0;
+    }
+
+    rc = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *) &(int){1}, sz);
+    if (rc != 0) {
+        goto error;
+    }
+
+    if (sock->profile != SC_SOCK_LOW_LATENCY) {
+        return 0;
+    }
+
+    // TCP_QUICKACK is not permanent, kernel may switch back to delayed acks.
+#ifdef TCP_QUICKACK
+    sc_sock_opt_try(fd, IPPROTO_TCP, TCP_QUICKACK, 1);
+#endif
+#ifdef SO_BUSY_POLL
+    sc_sock_opt_try(fd, SOL_SOCKET, SO_BUSY_POLL, 50);
+#endif
+#ifdef TCP_NOTSENT_LOWAT
+    sc_sock_opt_try(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, 16 * 1024);
+#endif
+
+    return 0;
+
+error:
+    sc_sock_errstr(sock, 0);
+    return SC_SOCK_ERROR;
+}
+
+int sc_sock_set_profile(struct sc_sock *sock, enum sc_sock_profile profile)
+{
+    sock->profile = profile;
+
+    if (sock->fdt.fd == SC_INVALID) {
+        return SC_SOCK_OK;
+    }
+
+    return sc_sock_profile_apply(sock);
+}
+
 static int sc_sock_bind_unix(struct sc_sock *sock, const char *host)
 {
     int rc;
@@ -216,7 +478,8 @@ static int sc_sock_bind_unix(struct sc_sock *sock, const char *host)
     return rc == 0 ? 0 : -1;
 }
 
-static int sc_sock_bind(struct sc_sock *sock, const char *host, const char *prt)
+static int sc_sock_bind(struct sc_sock *sock, const char *host, const char *prt,
+                        bool reuseport)
 {
     const int bf = SC_SOCK_BUF_SIZE;
     const socklen_t sz = sizeof(bf);
@@ -246,6 +509,13 @@ static int sc_sock_bind(struct sc_sock *sock, const char *host, const char *prt)
             goto error_unix;
         }
 
+        if (sock->profile != SC_SOCK_PROFILE_DEFAULT) {
+            rc = sc_sock_profile_apply(sock);
+            if (rc != 0) {
+                goto error_unix;
+            }
+        }
+
         rc = sc_sock_bind_unix(sock, host);
         if (rc != 0) {
             goto error_unix;
@@ -301,6 +571,17 @@ error_unix:
             goto error;
         }
 
+#ifdef SO_REUSEPORT
+        if (reuseport) {
+            rc = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, tmp, sizeof(int));
+            if (rc != 0) {
+                goto error;
+            }
+        }
+#else
+        (void) reuseport;
+#endif
+
         rc = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (void *) &bf, sz);
         if (rc != 0) {
             goto error;
@@ -311,6 +592,19 @@ error_unix:
             goto error;
         }
 
+        if (sock->profile != SC_SOCK_PROFILE_DEFAULT) {
+            rc = sc_sock_profile_apply(sock);
+            if (rc != 0) {
+                goto error;
+            }
+
+#if defined(TCP_FASTOPEN) && defined(__linux__)
+            sc_sock_opt_try(fd, IPPROTO_TCP, TCP_FASTOPEN, 256); // Queue len
+#elif defined(TCP_FASTOPEN)
+            sc_sock_opt_try(fd, IPPROTO_TCP, TCP_FASTOPEN, 1);
+#endif
+        }
+
         rc = bind(sock->fdt.fd, p->ai_addr, (socklen_t) p->ai_addrlen);
         if (rc == -1) {
             goto error;
@@ -363,6 +657,105 @@ static int sc_sock_connect_unix(struct sc_sock *sock, const char *addr)
     return rc;
 }
 
+// Connects to a single address. Returns '0' on success, SC_SOCK_WANT_WRITE if
+// connect is in progress, '1' if connect failed and the next address can be
+// tried, '-1' on error.
+static int sc_sock_connect_to(struct sc_sock *sock, const struct sockaddr *addr,
+                              socklen_t len, const char *source_addr,
+                              const char *source_port)
+{
+    const int bf = SC_SOCK_BUF_SIZE;
+
+    int rc;
+    void *tmp;
+    sc_sock_int fd;
+    struct addrinfo inf = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo *bindinfo = NULL, *s;
+
+    fd = socket(addr->sa_family, SOCK_STREAM, 0);
+    if (fd == SC_INVALID) {
+        return 1;
+    }
+
+    sock->family = addr->sa_family;
+    sock->fdt.fd = fd;
+
+    rc = sc_sock_set_blocking(sock, sock->blocking);
+    if (rc != 0) {
+        goto error;
+    }
+
+    tmp = (void *) &(int){1};
+    rc = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, tmp, sizeof(int));
+    if (rc != 0) {
+        goto error;
+    }
+
+    rc = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, tmp, sizeof(int));
+    if (rc != 0) {
+        goto error;
+    }
+
+    rc = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (void *) &bf, sizeof(int));
+    if (rc != 0) {
+        goto error;
+    }
+
+    rc = setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (void *) &bf, sizeof(int));
+    if (rc != 0) {
+        goto error;
+    }
+
+    // Buffer sizes must be set before connect for the window scaling
+    if (sock->profile != SC_SOCK_PROFILE_DEFAULT) {
+        rc = sc_sock_profile_apply(sock);
+        if (rc != 0) {
+            goto error;
+        }
+    }
+
+    if (source_addr || source_port) {
+        rc = getaddrinfo(source_addr, source_port, &inf, &bindinfo);
+        if (rc != 0) {
+            sc_sock_errstr(sock, rc);
+            goto error_gai;
+        }
+
+        for (s = bindinfo; s != NULL; s = s->ai_next) {
+            rc = bind(sock->fdt.fd, s->ai_addr, (socklen_t) s->ai_addrlen);
+            if (rc != -1) {
+                break;
+            }
+        }
+
+        freeaddrinfo(bindinfo);
+
+        if (rc == -1) {
+            goto error;
+        }
+    }
+
+    rc = connect(sock->fdt.fd, addr, len);
+    if (rc != 0) {
+        if (!sock->blocking && (sc_sock_err() == SC_EINPROGRESS ||
+                                sc_sock_err() == SC_EAGAIN)) {
+            return SC_SOCK_WANT_WRITE;
+        }
+
+        sc_sock_close(sock);
+        return 1;
+    }
+
+    return 0;
+
+error:
+    sc_sock_errstr(sock, 0);
+error_gai:
+    sc_sock_close(sock);
+
+    return -1;
+}
+
 int sc_sock_connect(struct sc_sock *sock, const char *dest_addr,
                     const char *dest_port, const char *source_addr,
                     const char *source_port)
@@ -370,9 +763,9 @@ int sc_sock_connect(struct sc_sock *sock, const char *dest_addr,
     const int bf = SC_SOCK_BUF_SIZE;
     const socklen_t sz = sizeof(bf);
 
-    int rc, rv = SC_SOCK_OK;
+    int rc, rv = 1;
     struct addrinfo inf = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
-    struct addrinfo *servinfo = NULL, *bindinfo = NULL, *p, *s;
+    struct addrinfo *servinfo = NULL, *p;
 
     if (sock->family == AF_UNIX) {
         sc_sock_int fd = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -392,6 +785,13 @@ int sc_sock_connect(struct sc_sock *sock, const char *dest_addr,
             goto error_unix;
         }
 
+        if (sock->profile != SC_SOCK_PROFILE_DEFAULT) {
+            rc = sc_sock_profile_apply(sock);
+            if (rc != 0) {
+                goto error_unix;
+            }
+        }
+
         rc = sc_sock_connect_unix(sock, dest_addr);
         if (rc != 0) {
             goto error_unix;
@@ -413,91 +813,44 @@ error_unix:
     }
 
     for (p = servinfo; p != NULL; p = p->ai_next) {
-        void *tmp;
-        sc_sock_int fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
-        if (fd == SC_INVALID) {
-            continue;
+        rv = sc_sock_connect_to(sock, p->ai_addr, (socklen_t) p->ai_addrlen,
+                                source_addr, source_port);
+        if (rv != 1) {
+            break;
         }
+    }
 
-        sock->family = p->ai_family;
-        sock->fdt.fd = fd;
-
-        rc = sc_sock_set_blocking(sock, sock->blocking);
-        if (rc != 0) {
-            goto error;
-        }
+    if (rv == 1) {
+        sc_sock_errstr(sock, 0);
+        sc_sock_close(sock);
+        rv = -1;
+    }
 
-        tmp = (void *) &(int){1};
-        rc = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, tmp, sizeof(int));
-        if (rc != 0) {
-            goto error;
-        }
+    freeaddrinfo(servinfo);
 
-        rc = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, tmp, sizeof(int));
-        if (rc != 0) {
-            goto error;
-        }
+    return rv;
+}
 
-        rc = setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (void *) &bf, sizeof(int));
-        if (rc != 0) {
-            goto error;
-        }
+int sc_sock_connect_addr(struct sc_sock *sock, const struct sc_sock_addr *addr,
+                         const char *source_addr, const char *source_port)
+{
+    int rv;
 
-        rc = setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (void *) &bf, sizeof(int));
-        if (rc != 0) {
-            goto error;
-        }
+    *sock->err = '\0';
 
-        if (source_addr || source_port) {
-            rc = getaddrinfo(source_addr, source_port, &inf, &bindinfo);
-            if (rc != 0) {
-                sc_sock_errstr(sock, rc);
-                goto error_gai;
-            }
+    rv = sc_sock_connect_to(sock, (const struct sockaddr *) &addr->storage,
+                            (socklen_t) addr->len, source_addr, source_port);
+    if (rv == 1) {
+        sc_sock_errstr(sock, 0);
+        rv = -1;
+    }
 
-            for (s = bindinfo; s != NULL; s = s->ai_next) {
-                rc = bind(sock->fdt.fd, s->ai_addr, (socklen_t) s->ai_addrlen);
-                if (rc != -1) {
-                    break;
-                }
-            }
+    return rv;
+}
 
-            freeaddrinfo(bindinfo);
-
-            if (rc == -1) {
-                goto error;
-            }
-        }
-
-        rc = connect(sock->fdt.fd, p->ai_addr, (socklen_t) p->ai_addrlen);
-        if (rc != 0) {
-            if (!sock->blocking && (sc_sock_err() == SC_EINPROGRESS ||
-                                    sc_sock_err() == SC_EAGAIN)) {
-                rv = SC_SOCK_WANT_WRITE;
-                goto end;
-            }
-
-            sc_sock_close(sock);
-            continue;
-        }
-
-        goto end;
-    }
-
-error:
-    sc_sock_errstr(sock, 0);
-error_gai:
-    sc_sock_close(sock);
-    rv = -1;
-end:
-    freeaddrinfo(servinfo);
-
-    return rv;
-}
-
-int sc_sock_send(struct sc_sock *sock, char *buf, int len, int flags)
-{
-    int n;
+int sc_sock_send(struct sc_sock *sock, char *buf, int len, int flags)
+{
+    int n;
 
     if (len <= 0) {
         return len;
@@ -512,14 +865,14 @@ retry:
         }
 
         if (err == SC_EAGAIN) {
-            return SC_SOCK_WANT_WRITE;
+            return sc_sock_stat_io(sock, true, SC_SOCK_WANT_WRITE);
         }
 
         sc_sock_errstr(sock, 0);
         n = SC_SOCK_ERROR;
     }
 
-    return n;
+    return sc_sock_stat_io(sock, true, n);
 }
 
 int sc_sock_recv(struct sc_sock *sock, char *buf, int len, int flags)
@@ -533,7 +886,7 @@ int sc_sock_recv(struct sc_sock *sock, char *buf, int len, int flags)
 retry:
     n = (int) recv(sock->fdt.fd, buf, (size_t) len, flags);
     if (n == 0) {
-        return SC_SOCK_ERROR;
+        return sc_sock_stat_io(sock, false, SC_SOCK_ERROR);
     } else if (n == SC_ERR) {
         int err = sc_sock_err();
         if (err == SC_EINTR) {
@@ -541,964 +894,2870 @@ retry:
         }
 
         if (err == SC_EAGAIN) {
-            return SC_SOCK_WANT_READ;
+            return sc_sock_stat_io(sock, false, SC_SOCK_WANT_READ);
         }
 
         sc_sock_errstr(sock, 0);
         n = SC_SOCK_ERROR;
     }
 
-    return n;
+    return sc_sock_stat_io(sock, false, n);
 }
 
-int sc_sock_accept(struct sc_sock *sock, struct sc_sock *in)
+static int sc_sock_vec(struct sc_sock *sock, sc_sock_iov *iov, int count,
+                       int flags, bool send)
 {
-    const int bf = SC_SOCK_BUF_SIZE;
-    const socklen_t sz = sizeof(bf);
-
+    int err;
+    long n;
+#if defined(_WIN32) || defined(_WIN64)
     int rc;
-    sc_sock_int fd;
-    void *tmp;
+    DWORD bytes, f;
+#else
+    struct msghdr msg = {.msg_iov = iov, .msg_iovlen = count};
+#endif
 
-    fd = accept(sock->fdt.fd, NULL, NULL);
-    if (fd == SC_INVALID) {
-        sc_sock_errstr(sock, 0);
-        return SC_SOCK_ERROR;
+retry:
+#if defined(_WIN32) || defined(_WIN64)
+    bytes = 0;
+    f = (DWORD) flags;
+
+    if (send) {
+        rc = WSASend(sock->fdt.fd, iov, (DWORD) count, &bytes, f, NULL, NULL);
+    } else {
+        rc = WSARecv(sock->fdt.fd, iov, (DWORD) count, &bytes, &f, NULL, NULL);
     }
 
-    in->fdt.fd = fd;
-    in->fdt.op = SC_SOCK_NONE;
-    in->family = sock->family;
+    n = rc == 0 ? (long) bytes : SC_ERR;
+#else
+    n = send ? sendmsg(sock->fdt.fd, &msg, flags) :
+               recvmsg(sock->fdt.fd, &msg, flags);
+#endif
+    if (n == 0 && !send) {
+        return sc_sock_stat_io(sock, send, SC_SOCK_ERROR);
+    } else if (n == SC_ERR) {
+        err = sc_sock_err();
+        if (err == SC_EINTR) {
+            goto retry;
+        }
 
-    if (in->family != AF_UNIX) {
-        tmp = (void *) &(int){1};
-        rc = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, tmp, sizeof(int));
-        if (rc != 0) {
-            goto error;
+        if (err == SC_EAGAIN) {
+            return sc_sock_stat_io(sock, send,
+                                   send ? SC_SOCK_WANT_WRITE :
+                                          SC_SOCK_WANT_READ);
         }
+
+        sc_sock_errstr(sock, 0);
+        return sc_sock_stat_io(sock, send, SC_SOCK_ERROR);
     }
 
-    rc = sc_sock_set_blocking(in, sock->blocking);
-    if (rc != 0) {
-        goto error;
+    return sc_sock_stat_io(sock, send, (int) n);
+}
+
+int sc_sock_sendv(struct sc_sock *sock, sc_sock_iov *iov, int count, int flags)
+{
+    if (count <= 0) {
+        return 0;
     }
 
-    rc = setsockopt(in->fdt.fd, SOL_SOCKET, SO_RCVBUF, (void *) &bf, sz);
-    if (rc != 0) {
-        goto error;
+    return sc_sock_vec(sock, iov, count, flags, true);
+}
+
+int sc_sock_recvv(struct sc_sock *sock, sc_sock_iov *iov, int count, int flags)
+{
+    if (count <= 0) {
+        return 0;
     }
 
-    rc = setsockopt(in->fdt.fd, SOL_SOCKET, SO_SNDBUF, (void *) &bf, sz);
+    return sc_sock_vec(sock, iov, count, flags, false);
+}
+
+int sc_sock_dgram_bind(struct sc_sock *sock, const char *host,
+                       const char *port)
+{
+    int rc, rv = 0;
+    struct addrinfo *servinfo = NULL;
+    struct addrinfo hints = {.ai_family = sock->family,
+                             .ai_socktype = SOCK_DGRAM};
+
+    *sock->err = '\0';
+
+    rc = getaddrinfo(host, port, &hints, &servinfo);
     if (rc != 0) {
-        goto error;
+        sc_sock_errstr(sock, rc);
+        return -1;
     }
 
-    return SC_SOCK_OK;
+    for (struct addrinfo *p = servinfo; p != NULL; p = p->ai_next) {
+        sc_sock_int fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (fd == SC_INVALID) {
+            continue;
+        }
+
+        sock->fdt.fd = fd;
+
+        rc = sc_sock_set_blocking(sock, sock->blocking);
+        if (rc != 0) {
+            goto error;
+        }
+
+        rc = bind(sock->fdt.fd, p->ai_addr, (socklen_t) p->ai_addrlen);
+        if (rc == -1) {
+            goto error;
+        }
+
+        goto out;
+    }
 
 error:
     sc_sock_errstr(sock, 0);
-    sc_sock_close(in);
+    sc_sock_close(sock);
+    rv = -1;
+out:
+    freeaddrinfo(servinfo);
 
-    return SC_SOCK_ERROR;
+    return rv;
 }
 
-int sc_sock_listen(struct sc_sock *sock, const char *host, const char *port)
+int sc_sock_addr_init(struct sc_sock_addr *addr, int family, const char *host,
+                      const char *port)
 {
     int rc;
+    struct addrinfo *info = NULL;
+    struct addrinfo hints = {.ai_family = family, .ai_socktype = SOCK_DGRAM};
 
-    rc = sc_sock_bind(sock, host, port);
+    rc = getaddrinfo(host, port, &hints, &info);
     if (rc != 0) {
-        return rc;
+        return -1;
     }
 
-    rc = listen(sock->fdt.fd, 4096);
-    if (rc != 0) {
-        sc_sock_errstr(sock, 0);
-        sc_sock_close(sock);
-    }
+    *addr = (struct sc_sock_addr){.len = (int) info->ai_addrlen};
+    memcpy(&addr->storage, info->ai_addr, info->ai_addrlen);
+    freeaddrinfo(info);
 
-    return rc == 0 ? 0 : -1;
+    return 0;
 }
 
-const char *sc_sock_error(struct sc_sock *sock)
-{
-    sock->err[sizeof(sock->err) - 1] = '\0';
-    return sock->err;
-}
+#if defined(__linux__)
 
-static const char *sc_sock_addr(struct sc_sock *sock, int af, void *cp,
-                                char *buf, socklen_t len)
+int sc_sock_recv_batch(struct sc_sock *sock, sc_sock_iov *iov, int *lens,
+                       struct sc_sock_addr *addrs, int count, int flags)
 {
-    const char *dest;
+    int n, err;
+    struct mmsghdr msgs[SC_SOCK_BATCH_MAX];
 
-    dest = inet_ntop(af, cp, buf, len);
-    if (dest == NULL) {
-        sc_sock_errstr(sock, 0);
-        *buf = '\0';
+    count = count < SC_SOCK_BATCH_MAX ? count : SC_SOCK_BATCH_MAX;
+    if (count <= 0) {
+        return 0;
     }
 
-    return dest;
-}
+    for (int i = 0; i < count; i++) {
+        msgs[i] = (struct mmsghdr){.msg_len = 0};
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
 
-static const char *sc_sock_print_storage(struct sc_sock *sock,
-                                         struct sockaddr_storage *storage,
-                                         char *buf, size_t len)
-{
-    const char *dst;
-    struct sockaddr_in *addr;
-    struct sockaddr_in6 *addr6;
-    struct sockaddr_un *addr_un;
-    char tmp[INET6_ADDRSTRLEN];
+        if (addrs != NULL) {
+            msgs[i].msg_hdr.msg_name = &addrs[i].storage;
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i].storage);
+        }
+    }
 
-    *buf = '\0';
+retry:
+    // Otherwise, blocking sockets wait until all 'count' datagrams arrive
+    n = recvmmsg(sock->fdt.fd, msgs, (unsigned int) count,
+                 flags | MSG_WAITFORONE, NULL);
+    if (n == SC_ERR) {
+        err = sc_sock_err();
+        if (err == SC_EINTR) {
+            goto retry;
+        }
 
-    switch (storage->ss_family) {
-    case AF_INET:
-        addr = (struct sockaddr_in *) storage;
-        dst = sc_sock_addr(sock, AF_INET, &addr->sin_addr, tmp, sizeof(tmp));
-        snprintf(buf, len, "%s:%d", dst, ntohs(addr->sin_port));
-        break;
+        if (err == SC_EAGAIN) {
+            return SC_SOCK_WANT_READ;
+        }
 
-    case AF_INET6:
-        addr6 = (struct sockaddr_in6 *) storage;
-        dst = sc_sock_addr(sock, AF_INET6, &addr6->sin6_addr, tmp, sizeof(tmp));
-        snprintf(buf, len, "%s:%d", dst, ntohs(addr6->sin6_port));
-        break;
+        sc_sock_errstr(sock, 0);
+        return SC_SOCK_ERROR;
+    }
 
-    case AF_UNIX:
-        addr_un = (struct sockaddr_un *) storage;
-        snprintf(buf, len, "%s", addr_un->sun_path);
-        break;
+    for (int i = 0; i < n; i++) {
+        lens[i] = (int) msgs[i].msg_len;
+
+        if (addrs != NULL) {
+            addrs[i].len = (int) msgs[i].msg_hdr.msg_namelen;
+        }
     }
 
-    return buf;
+    return n;
 }
 
-const char *sc_sock_local_str(struct sc_sock *sock, char *buf, size_t len)
+int sc_sock_send_batch(struct sc_sock *sock, sc_sock_iov *iov,
+                       struct sc_sock_addr *addrs, int count, int flags)
 {
-    int rc;
-    struct sockaddr_storage st;
-    socklen_t storage_len = sizeof(st);
+    int n, err;
+    struct mmsghdr msgs[SC_SOCK_BATCH_MAX];
 
-    rc = getsockname(sock->fdt.fd, (struct sockaddr *) &st, &storage_len);
-    if (rc != 0) {
-        sc_sock_errstr(sock, 0);
-        *buf = '\0';
-        return NULL;
+    count = count < SC_SOCK_BATCH_MAX ? count : SC_SOCK_BATCH_MAX;
+    if (count <= 0) {
+        return 0;
     }
 
-    return sc_sock_print_storage(sock, &st, buf, len);
-}
+    for (int i = 0; i < count; i++) {
+        msgs[i] = (struct mmsghdr){.msg_len = 0};
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addrs[i].storage;
+        msgs[i].msg_hdr.msg_namelen = (socklen_t) addrs[i].len;
+    }
 
-const char *sc_sock_remote_str(struct sc_sock *sock, char *buf, size_t len)
-{
-    int rc;
-    struct sockaddr_storage st;
-    socklen_t storage_len = sizeof(st);
+retry:
+    n = sendmmsg(sock->fdt.fd, msgs, (unsigned int) count, flags);
+    if (n == SC_ERR) {
+        err = sc_sock_err();
+        if (err == SC_EINTR) {
+            goto retry;
+        }
+
+        if (err == SC_EAGAIN) {
+            return SC_SOCK_WANT_WRITE;
+        }
 
-    rc = getpeername(sock->fdt.fd, (struct sockaddr *) &st, &storage_len);
-    if (rc != 0) {
         sc_sock_errstr(sock, 0);
-        *buf = '\0';
-        return NULL;
+        return SC_SOCK_ERROR;
     }
 
-    return sc_sock_print_storage(sock, &st, buf, len);
+    return n;
 }
 
-void sc_sock_print(struct sc_sock *sock, char *buf, size_t len)
+#else
+
+    #if defined(_WIN32) || defined(_WIN64)
+        #define sc_sock_iov_base(iov) ((iov)->buf)
+        #define sc_sock_iov_len(iov)  ((int) (iov)->len)
+        #define SC_SOCK_DONTWAIT      0
+    #else
+        #define sc_sock_iov_base(iov) ((iov)->iov_base)
+        #define sc_sock_iov_len(iov)  ((iov)->iov_len)
+        #define SC_SOCK_DONTWAIT      MSG_DONTWAIT
+    #endif
+
+int sc_sock_recv_batch(struct sc_sock *sock, sc_sock_iov *iov, int *lens,
+                       struct sc_sock_addr *addrs, int count, int flags)
 {
-    char l[128];
-    char r[128];
+    int i, err;
+    long n;
+    socklen_t len;
+    struct sockaddr *addr;
 
-    sc_sock_local_str(sock, l, sizeof(l));
-    sc_sock_remote_str(sock, r, sizeof(r));
+    count = count < SC_SOCK_BATCH_MAX ? count : SC_SOCK_BATCH_MAX;
 
-    snprintf(buf, len, "Local(%s), Remote(%s) ", l, r);
-}
+    for (i = 0; i < count; i++) {
+        addr = addrs != NULL ? (struct sockaddr *) &addrs[i].storage : NULL;
+        len = addrs != NULL ? sizeof(addrs[i].storage) : 0;
 
+        // Blocking sockets wait for the first datagram only
+        if (i > 0 && sock->blocking) {
+            if (SC_SOCK_DONTWAIT == 0) {
+                break;
+            }
 
-const char *sc_sock_pipe_err(struct sc_sock_pipe *pipe)
-{
-    return pipe->err;
-}
+            flags |= SC_SOCK_DONTWAIT;
+        }
 
-static void sc_sock_pipe_set_err(struct sc_sock_pipe *pipe, const char *fmt,
-                                 ...)
-{
-    va_list args;
+    retry:
+        n = recvfrom(sock->fdt.fd, sc_sock_iov_base(&iov[i]),
+                     sc_sock_iov_len(&iov[i]), flags, addr,
+                     addrs != NULL ? &len : NULL);
+        if (n == SC_ERR) {
+            err = sc_sock_err();
+            if (err == SC_EINTR) {
+                goto retry;
+            }
 
-    va_start(args, fmt);
-    vsnprintf(pipe->err, sizeof(pipe->err), fmt, args);
-    va_end(args);
+            if (i > 0) {
+                break;
+            }
 
-    pipe->err[sizeof(pipe->err) - 1] = '\0';
-}
+            if (err == SC_EAGAIN) {
+                return SC_SOCK_WANT_READ;
+            }
 
-#if defined(_WIN32) || defined(_WIN64)
+            sc_sock_errstr(sock, 0);
+            return SC_SOCK_ERROR;
+        }
 
-int sc_sock_pipe_init(struct sc_sock_pipe *p, int type)
-{
-    SOCKET listener;
-    int rc;
+        lens[i] = (int) n;
+
+        if (addrs != NULL) {
+            addrs[i].len = (int) len;
+        }
+    }
+
+    return i;
+}
+
+int sc_sock_send_batch(struct sc_sock *sock, sc_sock_iov *iov,
+                       struct sc_sock_addr *addrs, int count, int flags)
+{
+    int i, err;
+    long n;
+
+    count = count < SC_SOCK_BATCH_MAX ? count : SC_SOCK_BATCH_MAX;
+
+    for (i = 0; i < count; i++) {
+    retry:
+        n = sendto(sock->fdt.fd, sc_sock_iov_base(&iov[i]),
+                   sc_sock_iov_len(&iov[i]), flags,
+                   (struct sockaddr *) &addrs[i].storage,
+                   (socklen_t) addrs[i].len);
+        if (n == SC_ERR) {
+            err = sc_sock_err();
+            if (err == SC_EINTR) {
+                goto retry;
+            }
+
+            if (i > 0) {
+                break;
+            }
+
+            if (err == SC_EAGAIN) {
+                return SC_SOCK_WANT_WRITE;
+            }
+
+            sc_sock_errstr(sock, 0);
+            return SC_SOCK_ERROR;
+        }
+    }
+
+    return i;
+}
+
+#endif
+
+#if !defined(SC_SOCK_SENDFILE_COPY) &&                                       \
+        (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__))
+
+int sc_sock_sendfile(struct sc_sock *sock, int fd, uint64_t offset, int len)
+{
+    int rc, err;
+    off_t off, sent;
+
+    if (len <= 0) {
+        return len;
+    }
+
+retry:
+    off = (off_t) offset;
+    sent = 0;
+
+    #if defined(__linux__)
+    long n = (long) sendfile(sock->fdt.fd, fd, &off, (size_t) len);
+
+    rc = n >= 0 ? 0 : -1;
+    sent = n > 0 ? (off_t) n : 0;
+    #elif defined(__APPLE__)
+    // Partial progress is reported in 'sent' even if it fails with EAGAIN
+    sent = len;
+    rc = sendfile(fd, sock->fdt.fd, off, &sent, NULL, 0);
+    #else
+    rc = sendfile(fd, sock->fdt.fd, off, (size_t) len, NULL, &sent, 0);
+    #endif
+
+    if (rc != 0 && sent <= 0) {
+        err = sc_sock_err();
+        if (err == SC_EINTR) {
+            goto retry;
+        }
+
+        if (err == SC_EAGAIN) {
+            return sc_sock_stat_io(sock, true, SC_SOCK_WANT_WRITE);
+        }
+
+        sc_sock_errstr(sock, 0);
+        return sc_sock_stat_io(sock, true, SC_SOCK_ERROR);
+    }
+
+    return sc_sock_stat_io(sock, true, (int) sent);
+}
+
+#else
+
+int sc_sock_sendfile(struct sc_sock *sock, int fd, uint64_t offset, int len)
+{
+    int n;
+    char buf[16 * 1024];
+    #if defined(_WIN32) || defined(_WIN64)
+    DWORD rd;
+    __int64 pos;
+    OVERLAPPED ov = {0};
+    HANDLE h = (HANDLE) _get_osfhandle(fd);
+    #endif
+
+    if (len <= 0) {
+        return len;
+    }
+
+    len = len < (int) sizeof(buf) ? len : (int) sizeof(buf);
+
+    #if defined(_WIN32) || defined(_WIN64)
+    // Positioned read, ReadFile() still moves the file pointer of synchronous
+    // handles, so it is restored afterwards.
+    pos = _telli64(fd);
+    if (h == INVALID_HANDLE_VALUE || pos < 0) {
+        goto error;
+    }
+
+    ov.Offset = (DWORD) offset;
+    ov.OffsetHigh = (DWORD) (offset >> 32);
+
+    if (!ReadFile(h, buf, (DWORD) len, &rd, &ov)) {
+        if (GetLastError() != ERROR_HANDLE_EOF) {
+            errno = EIO;
+            goto error;
+        }
+        rd = 0;
+    }
+
+    if (_lseeki64(fd, pos, SEEK_SET) < 0) {
+        goto error;
+    }
+
+    n = (int) rd;
+    #else
+    n = (int) pread(fd, buf, (size_t) len, (off_t) offset);
+    #endif
+    if (n < 0) {
+        goto error;
+    }
+
+    // If it is a partial send, rest of the chunk is read again on next call
+    return sc_sock_send(sock, buf, n, 0);
+
+error:
+    strncpy(sock->err, strerror(errno), sizeof(sock->err) - 1);
+    return SC_SOCK_ERROR;
+}
+
+#endif
+
+#ifdef SC_SOCK_HAVE_BUF
+
+int sc_sock_iov_rbufs(sc_sock_iov *iov, int cap, struct sc_buf *bufs,
+                      int count)
+{
+    int n = 0;
+
+    for (int i = 0; i < count && n < cap; i++) {
+        uint32_t size = sc_buf_size(&bufs[i]);
+
+        if (size > 0) {
+            sc_sock_iov_set(&iov[n], sc_buf_rbuf(&bufs[i]), size);
+            n++;
+        }
+    }
+
+    return n;
+}
+
+int sc_sock_sendv_buf(struct sc_sock *sock, struct sc_buf *bufs, int count,
+                      int flags)
+{
+    int n, rc;
+    uint32_t left, len;
+    sc_sock_iov iov[SC_SOCK_IOV_MAX];
+
+    n = sc_sock_iov_rbufs(iov, SC_SOCK_IOV_MAX, bufs, count);
+    if (n == 0) {
+        return 0;
+    }
+
+    rc = sc_sock_sendv(sock, iov, n, flags);
+    if (rc <= 0) {
+        return rc;
+    }
+
+    left = (uint32_t) rc;
+
+    for (int i = 0; i < count && left > 0; i++) {
+        len = sc_buf_size(&bufs[i]);
+        len = len < left ? len : left;
+
+        sc_buf_mark_read(&bufs[i], len);
+        left -= len;
+    }
+
+    return rc;
+}
+
+int sc_sock_recvv_buf(struct sc_sock *sock, struct sc_buf *bufs, int count,
+                      int flags)
+{
+    int n = 0, rc;
+    uint32_t left, len;
+    sc_sock_iov iov[SC_SOCK_IOV_MAX];
+
+    for (int i = 0; i < count && n < SC_SOCK_IOV_MAX; i++) {
+        len = sc_buf_quota(&bufs[i]);
+        if (len > 0) {
+            sc_sock_iov_set(&iov[n], sc_buf_wbuf(&bufs[i]), len);
+            n++;
+        }
+    }
+
+    if (n == 0) {
+        return 0;
+    }
+
+    rc = sc_sock_recvv(sock, iov, n, flags);
+    if (rc <= 0) {
+        return rc;
+    }
+
+    left = (uint32_t) rc;
+
+    for (int i = 0; i < count && left > 0; i++) {
+        len = sc_buf_quota(&bufs[i]);
+        len = len < left ? len : left;
+
+        sc_buf_mark_write(&bufs[i], len);
+        left -= len;
+    }
+
+    return rc;
+}
+
+int sc_sock_iov_chain(sc_sock_iov *iov, int cap, struct sc_buf_chain *chain)
+{
+    int n = 0;
+    struct sc_buf_seg *seg;
+
+    for (seg = chain->head; seg != NULL && n < cap; seg = seg->next) {
+        uint32_t size = sc_buf_size(&seg->buf);
+
+        if (size > 0) {
+            sc_sock_iov_set(&iov[n], sc_buf_rbuf(&seg->buf), size);
+            n++;
+        }
+    }
+
+    return n;
+}
+
+int sc_sock_sendv_chain(struct sc_sock *sock, struct sc_buf_chain *chain,
+                        int flags)
+{
+    int n, rc;
+    sc_sock_iov iov[SC_SOCK_IOV_MAX];
+
+    n = sc_sock_iov_chain(iov, SC_SOCK_IOV_MAX, chain);
+    if (n == 0) {
+        return 0;
+    }
+
+    rc = sc_sock_sendv(sock, iov, n, flags);
+    if (rc <= 0) {
+        return rc;
+    }
+
+    sc_buf_chain_mark_read(chain, (uint32_t) rc);
+
+    return rc;
+}
+
+int sc_sock_recv_chain(struct sc_sock *sock, struct sc_buf_chain *chain,
+                       int flags)
+{
+    int rc;
+    uint32_t quota;
+
+    if (!sc_buf_chain_reserve(chain, 1)) {
+        strncpy(sock->err, "Out of memory", sizeof(sock->err) - 1);
+        return SC_SOCK_ERROR;
+    }
+
+    quota = sc_buf_chain_quota(chain);
+    quota = quota < INT32_MAX ? quota : INT32_MAX;
+
+    rc = sc_sock_recv(sock, sc_buf_chain_wbuf(chain), (int) quota, flags);
+    if (rc > 0) {
+        sc_buf_chain_mark_write(chain, (uint32_t) rc);
+    }
+
+    return rc;
+}
+
+#endif
+
+static int sc_sock_accept_fd(struct sc_sock *sock, struct sc_sock *in,
+                             sc_sock_int fd)
+{
+    const int bf = SC_SOCK_BUF_SIZE;
+    const socklen_t sz = sizeof(bf);
+
+    int rc;
+    void *tmp;
+
+    in->fdt.fd = fd;
+    in->fdt.op = SC_SOCK_NONE;
+    in->family = sock->family;
+#ifdef SC_SOCK_HAVE_STATS
+    in->stats = (struct sc_sock_stats){0};
+#endif
+
+    if (in->family != AF_UNIX) {
+        tmp = (void *) &(int){1};
+        rc = setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, tmp, sizeof(int));
+        if (rc != 0) {
+            goto error;
+        }
+    }
+
+    rc = sc_sock_set_blocking(in, sock->blocking);
+    if (rc != 0) {
+        goto error;
+    }
+
+    rc = setsockopt(in->fdt.fd, SOL_SOCKET, SO_RCVBUF, (void *) &bf, sz);
+    if (rc != 0) {
+        goto error;
+    }
+
+    rc = setsockopt(in->fdt.fd, SOL_SOCKET, SO_SNDBUF, (void *) &bf, sz);
+    if (rc != 0) {
+        goto error;
+    }
+
+    in->profile = sock->profile;
+    if (in->profile != SC_SOCK_PROFILE_DEFAULT) {
+        rc = sc_sock_profile_apply(in);
+        if (rc != 0) {
+            goto error;
+        }
+    }
+
+    return SC_SOCK_OK;
+
+error:
+    sc_sock_errstr(sock, 0);
+    sc_sock_close(in);
+
+    return SC_SOCK_ERROR;
+}
+
+int sc_sock_accept(struct sc_sock *sock, struct sc_sock *in)
+{
+    sc_sock_int fd;
+
+    fd = accept(sock->fdt.fd, NULL, NULL);
+    if (fd == SC_INVALID) {
+        sc_sock_errstr(sock, 0);
+        return SC_SOCK_ERROR;
+    }
+
+    return sc_sock_accept_fd(sock, in, fd);
+}
+
+static int sc_sock_listen_addr(struct sc_sock *sock, const char *host,
+                               const char *port, bool reuseport)
+{
+    int rc;
+
+    rc = sc_sock_bind(sock, host, port, reuseport);
+    if (rc != 0) {
+        return rc;
+    }
+
+    rc = listen(sock->fdt.fd, 4096);
+    if (rc != 0) {
+        sc_sock_errstr(sock, 0);
+        sc_sock_close(sock);
+    }
+
+    return rc == 0 ? 0 : -1;
+}
+
+int sc_sock_listen(struct sc_sock *sock, const char *host, const char *port)
+{
+    return sc_sock_listen_addr(sock, host, port, false);
+}
+
+int sc_sock_listen_reuseport(struct sc_sock *sock, const char *host,
+                             const char *port)
+{
+#ifdef SO_REUSEPORT
+    if (sock->family != AF_UNIX) {
+        return sc_sock_listen_addr(sock, host, port, true);
+    }
+#endif
+    (void) host;
+    (void) port;
+
+    strncpy(sock->err, "SO_REUSEPORT is not supported.", sizeof(sock->err) - 1);
+    return -1;
+}
+
+const char *sc_sock_error(struct sc_sock *sock)
+{
+    sock->err[sizeof(sock->err) - 1] = '\0';
+    return sock->err;
+}
+
+static const char *sc_sock_addr(struct sc_sock *sock, int af, void *cp,
+                                char *buf, socklen_t len)
+{
+    const char *dest;
+
+    dest = inet_ntop(af, cp, buf, len);
+    if (dest == NULL) {
+        sc_sock_errstr(sock, 0);
+        *buf = '\0';
+    }
+
+    return dest;
+}
+
+static const char *sc_sock_print_storage(struct sc_sock *sock,
+                                         struct sockaddr_storage *storage,
+                                         char *buf, size_t len)
+{
+    const char *dst;
+    struct sockaddr_in *addr;
+    struct sockaddr_in6 *addr6;
+    struct sockaddr_un *addr_un;
+    char tmp[INET6_ADDRSTRLEN];
+
+    *buf = '\0';
+
+    switch (storage->ss_family) {
+    case AF_INET:
+        addr = (struct sockaddr_in *) storage;
+        dst = sc_sock_addr(sock, AF_INET, &addr->sin_addr, tmp, sizeof(tmp));
+        snprintf(buf, len, "%s:%d", dst, ntohs(addr->sin_port));
+        break;
+
+    case AF_INET6:
+        addr6 = (struct sockaddr_in6 *) storage;
+        dst = sc_sock_addr(sock, AF_INET6, &addr6->sin6_addr, tmp, sizeof(tmp));
+        snprintf(buf, len, "%s:%d", dst, ntohs(addr6->sin6_port));
+        break;
+
+    case AF_UNIX:
+        addr_un = (struct sockaddr_un *) storage;
+        snprintf(buf, len, "%s", addr_un->sun_path);
+        break;
+    }
+
+    return buf;
+}
+
+const char *sc_sock_local_str(struct sc_sock *sock, char *buf, size_t len)
+{
+    int rc;
+    struct sockaddr_storage st;
+    socklen_t storage_len = sizeof(st);
+
+    rc = getsockname(sock->fdt.fd, (struct sockaddr *) &st, &storage_len);
+    if (rc != 0) {
+        sc_sock_errstr(sock, 0);
+        *buf = '\0';
+        return NULL;
+    }
+
+    return sc_sock_print_storage(sock, &st, buf, len);
+}
+
+const char *sc_sock_remote_str(struct sc_sock *sock, char *buf, size_t len)
+{
+    int rc;
+    struct sockaddr_storage st;
+    socklen_t storage_len = sizeof(st);
+
+    rc = getpeername(sock->fdt.fd, (struct sockaddr *) &st, &storage_len);
+    if (rc != 0) {
+        sc_sock_errstr(sock, 0);
+        *buf = '\0';
+        return NULL;
+    }
+
+    return sc_sock_print_storage(sock, &st, buf, len);
+}
+
+void sc_sock_print(struct sc_sock *sock, char *buf, size_t len)
+{
+    char l[128];
+    char r[128];
+
+    sc_sock_local_str(sock, l, sizeof(l));
+    sc_sock_remote_str(sock, r, sizeof(r));
+
+    snprintf(buf, len, "Local(%s), Remote(%s) ", l, r);
+}
+
+
+const char *sc_sock_pipe_err(struct sc_sock_pipe *pipe)
+{
+    return pipe->err;
+}
+
+static void sc_sock_pipe_set_err(struct sc_sock_pipe *pipe, const char *fmt,
+                                 ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(pipe->err, sizeof(pipe->err), fmt, args);
+    va_end(args);
+
+    pipe->err[sizeof(pipe->err) - 1] = '\0';
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+
+int sc_sock_pipe_init(struct sc_sock_pipe *p, int type)
+{
+    SOCKET listener;
+    int rc;
     struct sockaddr_in addr;
     int addrlen = sizeof(addr);
     int val = 1;
     BOOL nodelay = 1;
 
-    p->fdt.type = type;
-    p->fdt.op = SC_SOCK_NONE;
-    p->fdt.index = -1;
-    p->fds[0] = INVALID_SOCKET;
-    p->fds[1] = INVALID_SOCKET;
+    p->fdt.type = type;
+    p->fdt.op = SC_SOCK_NONE;
+    p->fdt.index = -1;
+    p->fds[0] = INVALID_SOCKET;
+    p->fds[1] = INVALID_SOCKET;
+
+    /*  Create listening socket. */
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener == SOCKET_ERROR) {
+        goto wsafail;
+    }
+
+    rc = setsockopt(listener, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (char *) &val,
+                    sizeof(val));
+    if (rc == SOCKET_ERROR) {
+        goto wsafail;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    rc = bind(listener, (const struct sockaddr *) &addr, sizeof(addr));
+    if (rc == SOCKET_ERROR) {
+        goto wsafail;
+    }
+
+    rc = getsockname(listener, (struct sockaddr *) &addr, &addrlen);
+    if (rc == SOCKET_ERROR) {
+        goto wsafail;
+    }
+
+    rc = listen(listener, 1);
+    if (rc == SOCKET_ERROR) {
+        goto wsafail;
+    }
+
+    p->fds[1] = socket(AF_INET, SOCK_STREAM, 0);
+    if (p->fds[1] == SOCKET_ERROR) {
+        goto wsafail;
+    }
+
+    rc = setsockopt(p->fds[1], IPPROTO_TCP, TCP_NODELAY, (char *) &nodelay,
+                    sizeof(nodelay));
+    if (rc == SOCKET_ERROR) {
+        goto wsafail;
+    }
+
+    rc = connect(p->fds[1], (struct sockaddr *) &addr, sizeof(addr));
+    if (rc == SOCKET_ERROR) {
+        goto wsafail;
+    }
+
+    p->fds[0] = accept(listener, (struct sockaddr *) &addr, &addrlen);
+    if (p->fds[0] == INVALID_SOCKET) {
+        goto wsafail;
+    }
+
+    closesocket(listener);
+
+    return 0;
+
+wsafail:
+    sc_sock_pipe_set_err(p, "sc_sock_pipe_init() : %d ", WSAGetLastError());
+    return -1;
+}
+
+int sc_sock_pipe_term(struct sc_sock_pipe *p)
+{
+    int rc = 0, rv;
+
+    rv = closesocket(p->fds[0]);
+    if (rv != 0) {
+        rc = -1;
+        sc_sock_pipe_set_err(p, "closesocket() : err(%d) ", WSAGetLastError());
+    }
+
+    rv = closesocket(p->fds[1]);
+    if (rv != 0) {
+        rc = -1;
+        sc_sock_pipe_set_err(p, "closesocket() : err(%d) ", WSAGetLastError());
+    }
+
+    return rc;
+}
+
+int sc_sock_pipe_write(struct sc_sock_pipe *p, void *data, unsigned int len)
+{
+    int rc;
+
+    rc = send(p->fds[1], data, len, 0);
+    if (rc == SOCKET_ERROR || (unsigned int) rc != len) {
+        sc_sock_pipe_set_err(p, "pipe send() : err(%d) ", WSAGetLastError());
+    }
+
+    return rc;
+}
+
+int sc_sock_pipe_read(struct sc_sock_pipe *p, void *data, unsigned int len)
+{
+    int rc;
+
+    rc = recv(p->fds[0], (char *) data, len, 0);
+    if (rc == SOCKET_ERROR || (unsigned int) rc != len) {
+        sc_sock_pipe_set_err(p, "pipe recv() : err(%d) ", WSAGetLastError());
+    }
+
+    return rc;
+}
+
+#else
+
+int sc_sock_pipe_init(struct sc_sock_pipe *p, int type)
+{
+    int rc;
+
+    rc = pipe(p->fds);
+    if (rc != 0) {
+        sc_sock_pipe_set_err(p, "pipe() : %s ", strerror(errno));
+        return -1;
+    }
+
+    p->fdt.type = type;
+    p->fdt.op = SC_SOCK_NONE;
+    p->fdt.fd = p->fds[0];
+
+    return 0;
+}
+
+int sc_sock_pipe_term(struct sc_sock_pipe *p)
+{
+    int rc = 0, rv;
+
+    rv = close(p->fds[0]);
+    if (rv != 0) {
+        rc = -1;
+        sc_sock_pipe_set_err(p, "pipe close() : %s ", strerror(errno));
+    }
+
+    rv = close(p->fds[1]);
+    if (rv != 0) {
+        rc = -1;
+        sc_sock_pipe_set_err(p, "pipe close() : %s ", strerror(errno));
+    }
+
+    return rc;
+}
+
+int sc_sock_pipe_write(struct sc_sock_pipe *p, void *data, unsigned int len)
+{
+    ssize_t n;
+    char *b = data;
+
+retry:
+    n = write(p->fds[1], b, len);
+    if (n == -1 && errno == EINTR) {
+        goto retry;
+    }
+
+    return n;
+}
+
+int sc_sock_pipe_read(struct sc_sock_pipe *p, void *data, unsigned int len)
+{
+    ssize_t n;
+    char *b = data;
+
+retry:
+    n = read(p->fds[0], b, len);
+    if (n == -1 && errno == EINTR) {
+        goto retry;
+    }
+
+    return n;
+}
+
+#endif
+
+const char *sc_sock_poll_err(struct sc_sock_poll *p)
+{
+    return p->err;
+}
+
+static void sc_sock_poll_set_err(struct sc_sock_poll *p, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(p->err, sizeof(p->err), fmt, args);
+    va_end(args);
+
+    p->err[sizeof(p->err) - 1] = '\0';
+}
+
+#define SC_SOCK_RW (SC_SOCK_READ | SC_SOCK_WRITE)
+
+static int sc_sock_poll_max(struct sc_sock_poll *p, int cap)
+{
+    int max = cap < p->cap ? cap : p->cap;
+
+    return (p->max > 0 && p->max < max) ? p->max : max;
+}
+
+void sc_sock_poll_set_max(struct sc_sock_poll *p, int max)
+{
+    p->max = max < 0 ? 0 : max;
+}
+
+/* One-shot fds must be re-armed even if events are already registered */
+static bool sc_sock_poll_registered(struct sc_sock_fd *fdt,
+                                    enum sc_sock_ev events)
+{
+    return (fdt->op & events) == events && !(events & SC_SOCK_ONESHOT);
+}
+
+/* Flags are meaningless once both events are removed */
+static enum sc_sock_ev sc_sock_poll_rest(struct sc_sock_fd *fdt,
+                                         enum sc_sock_ev events)
+{
+    enum sc_sock_ev rest = fdt->op & ~events;
+
+    return (rest & SC_SOCK_RW) ? rest : SC_SOCK_NONE;
+}
+
+#if defined(__linux__)
+
+int sc_sock_poll_init(struct sc_sock_poll *p)
+{
+    int fds;
+
+    *p = (struct sc_sock_poll){0};
+
+    p->events = sc_sock_malloc(sizeof(*p->events) * 16);
+    if (p->events == NULL) {
+        sc_sock_poll_set_err(p, "Out of memory.");
+        goto error;
+    }
+
+    fds = epoll_create1(0);
+    if (fds == -1) {
+        sc_sock_poll_set_err(p, "epoll_create1(): %s ", strerror(errno));
+        goto error;
+    }
+
+    p->cap = 16;
+    p->fds = fds;
+
+    return 0;
+error:
+    sc_sock_free(p->events);
+    p->events = NULL;
+    p->fds = -1;
+
+    return -1;
+}
+
+int sc_sock_poll_term(struct sc_sock_poll *p)
+{
+    sc_sock_free(p->events);
+    return close(p->fds);
+}
+
+static int sc_sock_poll_expand(struct sc_sock_poll *p)
+{
+    int cap, rc = 0;
+    void *ev;
+
+    if (p->count == p->cap) {
+        if (p->cap >= SC_SIZE_MAX / 2) {
+            goto error;
+        }
+
+        cap = p->cap * 2;
+        ev = sc_sock_realloc(p->events, cap * sizeof(*p->events));
+        if (ev == NULL) {
+            goto error;
+        }
+
+        p->cap = cap;
+        p->events = ev;
+    }
+
+    return rc;
+
+error:
+    sc_sock_poll_set_err(p, "Out of memory.");
+    return -1;
+}
+
+int sc_sock_poll_add(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
+                     enum sc_sock_ev events, void *data)
+{
+    int rc, op = EPOLL_CTL_MOD;
+    enum sc_sock_ev mask = fdt->op | events;
+
+    struct epoll_event ep_ev = {.data.ptr = data,
+                                .events = EPOLLERR | EPOLLHUP | EPOLLRDHUP};
+
+    if (sc_sock_poll_registered(fdt, events)) {
+        return SC_SOCK_OK;
+    }
+
+    if (fdt->op == SC_SOCK_NONE) {
+        rc = sc_sock_poll_expand(p);
+        if (rc != 0) {
+            return -1;
+        }
+
+        op = EPOLL_CTL_ADD;
+    }
+
+    if (mask & SC_SOCK_READ) {
+        ep_ev.events |= EPOLLIN;
+    }
+
+    if (mask & SC_SOCK_WRITE) {
+        ep_ev.events |= EPOLLOUT;
+    }
+
+    if (mask & SC_SOCK_EDGE) {
+        ep_ev.events |= EPOLLET;
+    }
+
+    if (mask & SC_SOCK_ONESHOT) {
+        ep_ev.events |= EPOLLONESHOT;
+    }
+
+    rc = epoll_ctl(p->fds, op, fdt->fd, &ep_ev);
+    if (rc != 0) {
+        sc_sock_poll_set_err(p, "epoll_ctl : %s ", strerror(errno));
+        return -1;
+    }
+
+    p->count += fdt->op == SC_SOCK_NONE;
+    fdt->op = mask;
+
+    return 0;
+}
+
+int sc_sock_poll_del(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
+                     enum sc_sock_ev events, void *data)
+{
+    int rc, op;
+    struct epoll_event ep_ev = {.data.ptr = data,
+                                .events = EPOLLERR | EPOLLHUP | EPOLLRDHUP};
+
+    if ((fdt->op & events) == 0) {
+        return 0;
+    }
+
+    fdt->op = sc_sock_poll_rest(fdt, events);
+    op = fdt->op == SC_SOCK_NONE ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+
+    if (fdt->op & SC_SOCK_READ) {
+        ep_ev.events |= EPOLLIN;
+    }
+
+    if (fdt->op & SC_SOCK_WRITE) {
+        ep_ev.events |= EPOLLOUT;
+    }
+
+    if (fdt->op & SC_SOCK_EDGE) {
+        ep_ev.events |= EPOLLET;
+    }
+
+    if (fdt->op & SC_SOCK_ONESHOT) {
+        ep_ev.events |= EPOLLONESHOT;
+    }
+
+    rc = epoll_ctl(p->fds, op, fdt->fd, &ep_ev);
+    if (rc != 0) {
+        sc_sock_poll_set_err(p, "epoll_ctl : %s ", strerror(errno));
+        return -1;
+    }
+
+    if (fdt->op == SC_SOCK_NONE) {
+        p->count--;
+    }
+
+    return 0;
+}
+
+void *sc_sock_poll_data(struct sc_sock_poll *p, int i)
+{
+    return p->events[i].data.ptr;
+}
+
+static uint32_t sc_sock_poll_decode(const struct epoll_event *ev)
+{
+    uint32_t events = 0;
+    uint32_t epoll_events = ev->events;
+
+    if (epoll_events & EPOLLIN) {
+        events |= SC_SOCK_READ;
+    }
+
+    if (epoll_events & EPOLLOUT) {
+        events |= SC_SOCK_WRITE;
+    }
+
+    epoll_events &= EPOLLHUP | EPOLLRDHUP | EPOLLERR;
+    if (epoll_events != 0) {
+        events = (SC_SOCK_READ | SC_SOCK_WRITE);
+    }
+
+    return events;
+}
+
+uint32_t sc_sock_poll_event(struct sc_sock_poll *p, int i)
+{
+    return sc_sock_poll_decode(&p->events[i]);
+}
+
+static int sc_sock_poll_epoll(struct sc_sock_poll *p, int timeout, int max)
+{
+    int n;
+
+    sc_sock_poll_stat_begin(p);
+    sc_sock_poll_hist_begin(p);
+
+    do {
+        n = epoll_wait(p->fds, &p->events[0], max, timeout);
+    } while (n < 0 && errno == EINTR);
+
+    if (n == -1) {
+        sc_sock_poll_set_err(p, "epoll_wait : %s ", strerror(errno));
+    }
+
+    sc_sock_poll_stat_end(p, n);
+    sc_sock_poll_hist_end(p);
+
+    return n;
+}
+
+int sc_sock_poll_wait(struct sc_sock_poll *p, int timeout)
+{
+    return sc_sock_poll_epoll(p, timeout, sc_sock_poll_max(p, p->cap));
+}
+
+int sc_sock_poll_wait_batch(struct sc_sock_poll *p, int timeout,
+                            struct sc_sock_poll_ev *ev, int cap)
+{
+    int n;
+
+    n = sc_sock_poll_epoll(p, timeout, sc_sock_poll_max(p, cap));
+    if (n == -1) {
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        ev[i].data = p->events[i].data.ptr;
+        ev[i].events = sc_sock_poll_decode(&p->events[i]);
+    }
+
+    return n;
+}
+
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+
+static unsigned short sc_sock_poll_flags(int mask)
+{
+    unsigned short flags = EV_ADD;
+
+    if (mask & SC_SOCK_EDGE) {
+        flags |= EV_CLEAR;
+    }
+
+    if (mask & SC_SOCK_ONESHOT) {
+        flags |= EV_ONESHOT;
+    }
+
+    return flags;
+}
+
+int sc_sock_poll_init(struct sc_sock_poll *p)
+{
+    int fds;
+
+    *p = (struct sc_sock_poll){0};
+
+    p->events = sc_sock_malloc(sizeof(*p->events) * 16);
+    if (p->events == NULL) {
+        sc_sock_poll_set_err(p, "Out of memory.");
+        goto error;
+    }
+
+    fds = kqueue();
+    if (fds == -1) {
+        sc_sock_poll_set_err(p, "kqueue(): %s ", strerror(errno));
+        return -1;
+    }
+
+    p->cap = 16;
+    p->fds = fds;
+
+    return 0;
+error:
+    sc_sock_free(p->events);
+    p->events = NULL;
+    p->fds = -1;
+
+    return -1;
+}
+
+static int sc_sock_poll_expand(struct sc_sock_poll *p)
+{
+    int rc = 0, cap;
+    void *ev;
+
+    if (p->count == p->cap) {
+        if (p->cap >= SC_SIZE_MAX / 2) {
+            goto error;
+        }
+
+        cap = p->cap * 2;
+        ev = sc_sock_realloc(p->events, cap * sizeof(*p->events));
+        if (ev == NULL) {
+            goto error;
+        }
+
+        p->cap = cap;
+        p->events = ev;
+    }
+
+    return rc;
+
+error:
+    sc_sock_poll_set_err(p, "Out of memory.");
+    return -1;
+}
+
+int sc_sock_poll_term(struct sc_sock_poll *p)
+{
+    sc_sock_free(p->events);
+    return close(p->fds);
+}
+
+int sc_sock_poll_add(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
+                     enum sc_sock_ev events, void *data)
+{
+    int rc, count = 0;
+    struct kevent ev[2];
+    int mask = fdt->op | events;
+    unsigned short flags = sc_sock_poll_flags(mask);
+
+    if (sc_sock_poll_registered(fdt, events)) {
+        return SC_SOCK_OK;
+    }
+
+    if (fdt->op == SC_SOCK_NONE) {
+        rc = sc_sock_poll_expand(p);
+        if (rc != 0) {
+            return -1;
+        }
+    }
+
+    if (mask & SC_SOCK_WRITE) {
+        EV_SET(&ev[count++], fdt->fd, EVFILT_WRITE, flags, 0, 0, data);
+    }
+
+    if (mask & SC_SOCK_READ) {
+        EV_SET(&ev[count++], fdt->fd, EVFILT_READ, flags, 0, 0, data);
+    }
+
+    rc = kevent(p->fds, ev, count, NULL, 0, NULL);
+    if (rc != 0) {
+        sc_sock_poll_set_err(p, "kevent : %s ", strerror(errno));
+        return -1;
+    }
+
+    p->count += fdt->op == SC_SOCK_NONE;
+    fdt->op = mask;
+
+    return 0;
+}
+
+int sc_sock_poll_del(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
+                     enum sc_sock_ev events, void *data)
+{
+    int rc, count = 0;
+    struct kevent ev[2];
+    int mask = fdt->op & events & SC_SOCK_RW;
+    int rest = sc_sock_poll_rest(fdt, events);
+    unsigned short flags = sc_sock_poll_flags(rest);
+
+    if ((fdt->op & events) == 0) {
+        return 0;
+    }
+
+    if (mask & SC_SOCK_READ) {
+        EV_SET(&ev[count++], fdt->fd, EVFILT_READ, EV_DELETE, 0, 0, 0);
+    } else if ((rest & SC_SOCK_READ) && rest != fdt->op) {
+        EV_SET(&ev[count++], fdt->fd, EVFILT_READ, flags, 0, 0, data);
+    }
+
+    if (mask & SC_SOCK_WRITE) {
+        EV_SET(&ev[count++], fdt->fd, EVFILT_WRITE, EV_DELETE, 0, 0, 0);
+    } else if ((rest & SC_SOCK_WRITE) && rest != fdt->op) {
+        EV_SET(&ev[count++], fdt->fd, EVFILT_WRITE, flags, 0, 0, data);
+    }
+
+    if (fdt->op & SC_SOCK_ONESHOT) {
+        /*
+         * A one-shot filter is deleted by the kernel once it fires. Deleting
+         * it again fails with ENOENT and kevent() stops processing the
+         * changelist, so changes are applied one by one.
+         */
+        for (int i = 0; i < count; i++) {
+            rc = kevent(p->fds, &ev[i], 1, NULL, 0, NULL);
+            if (rc != 0 && errno != ENOENT) {
+                break;
+            }
+            rc = 0;
+        }
+    } else {
+        rc = kevent(p->fds, ev, count, NULL, 0, NULL);
+    }
+
+    if (rc != 0) {
+        sc_sock_poll_set_err(p, "kevent : %s ", strerror(errno));
+        return -1;
+    }
+
+    fdt->op = rest;
+    p->count -= fdt->op == SC_SOCK_NONE;
+
+    return 0;
+}
+
+void *sc_sock_poll_data(struct sc_sock_poll *p, int i)
+{
+    return p->events[i].udata;
+}
+
+static uint32_t sc_sock_poll_decode(const struct kevent *ev)
+{
+    uint32_t events = 0;
+
+    if (ev->flags & EV_EOF) {
+        events = (SC_SOCK_READ | SC_SOCK_WRITE);
+    } else if (ev->filter == EVFILT_READ) {
+        events |= SC_SOCK_READ;
+    } else if (ev->filter == EVFILT_WRITE) {
+        events |= SC_SOCK_WRITE;
+    } else if (ev->filter == EVFILT_USER) {
+        events |= SC_SOCK_READ;
+    }
+
+    return events;
+}
+
+uint32_t sc_sock_poll_event(struct sc_sock_poll *p, int i)
+{
+    return sc_sock_poll_decode(&p->events[i]);
+}
+
+static int sc_sock_poll_kevent(struct sc_sock_poll *p, int timeout, int max)
+{
+    int n;
+    struct timespec ts;
+
+    sc_sock_poll_stat_begin(p);
+    sc_sock_poll_hist_begin(p);
+
+    do {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000;
+
+        n = kevent(p->fds, NULL, 0, &p->events[0], max,
+                   timeout >= 0 ? &ts : NULL);
+    } while (n < 0 && errno == EINTR);
+
+    if (n == -1) {
+        sc_sock_poll_set_err(p, "kevent : %s ", strerror(errno));
+    }
+
+    sc_sock_poll_stat_end(p, n);
+    sc_sock_poll_hist_end(p);
+
+    return n;
+}
+
+int sc_sock_poll_wait(struct sc_sock_poll *p, int timeout)
+{
+    return sc_sock_poll_kevent(p, timeout, sc_sock_poll_max(p, p->cap));
+}
+
+int sc_sock_poll_wait_batch(struct sc_sock_poll *p, int timeout,
+                            struct sc_sock_poll_ev *ev, int cap)
+{
+    int n;
+
+    n = sc_sock_poll_kevent(p, timeout, sc_sock_poll_max(p, cap));
+
+    for (int i = 0; i < n; i++) {
+        ev[i].data = p->events[i].udata;
+        ev[i].events = sc_sock_poll_decode(&p->events[i]);
+    }
+
+    return n;
+}
+
+#else // WINDOWS
+
+int sc_sock_poll_init(struct sc_sock_poll *p)
+{
+    *p = (struct sc_sock_poll){0};
+
+    p->events = sc_sock_malloc(sizeof(*p->events) * 16);
+    if (p->events == NULL) {
+        sc_sock_poll_set_err(p, "Out of memory.");
+        return -1;
+    }
+
+    p->data = sc_sock_malloc(sizeof(void *) * 16);
+    if (p->data == NULL) {
+        sc_sock_free(p->events);
+        sc_sock_poll_set_err(p, "Out of memory.");
+        return -1;
+    }
+
+    p->cap = 16;
+
+    for (int i = 0; i < p->cap; i++) {
+        p->events[i].fd = SC_INVALID;
+    }
+
+    return 0;
+}
+
+int sc_sock_poll_term(struct sc_sock_poll *p)
+{
+    sc_sock_free(p->events);
+    sc_sock_free(p->data);
+
+    return 0;
+}
+
+static int sc_sock_poll_expand(struct sc_sock_poll* p)
+{
+    int cap, rc = 0;
+    void** data = NULL;
+    struct pollfd* ev = NULL;
+
+    if (p->count == p->cap) {
+        if (p->cap >= SC_SIZE_MAX / 2) {
+            goto error;
+        }
+
+        cap = p->cap * 2;
+        ev = sc_sock_realloc(p->events, cap * sizeof(*ev));
+        if (ev == NULL) {
+            goto error;
+        }
+
+        data = sc_sock_realloc(p->data, cap * sizeof(*data));
+        if (data == NULL) {
+            goto error;
+        }
+
+        p->events = ev;
+        p->data = data;
+
+        for (int i = p->cap; i < cap; i++) {
+             p->events[i].fd = SC_INVALID;
+        }
+
+        p->cap = cap;
+    }
+
+    return rc;
+
+error:
+    sc_sock_free(ev);
+    sc_sock_poll_set_err(p, "Out of memory.");
+    return -1;
+}
+
+int sc_sock_poll_add(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
+                     enum sc_sock_ev events, void *data)
+{
+    int rc;
+    int index = fdt->index;
+
+    if (sc_sock_poll_registered(fdt, events)) {
+        return SC_SOCK_OK;
+    }
+
+    if (fdt->op == SC_SOCK_NONE) {
+        rc = sc_sock_poll_expand(p);
+        if (rc != 0) {
+            sc_sock_poll_set_err(p, "Out of memory.");
+            return -1;
+        }
+
+        p->count++;
+
+        for (int i = 0; i < p->cap; i++) {
+            if (p->events[i].fd == SC_INVALID) {
+                index = i;
+                break;
+            }
+        }
+
+        assert(index != -1);
+
+        p->events[index].fd = fdt->fd;
+        fdt->index = index;
+    }
+
+    assert(index != -1);
+
+    fdt->op |= events;
+
+    p->events[fdt->index].events = 0;
+    p->events[fdt->index].revents = 0;
+
+    if (fdt->op & SC_SOCK_READ) {
+        p->events[fdt->index].events |= POLLIN;
+    }
+
+    if (fdt->op & SC_SOCK_WRITE) {
+        p->events[fdt->index].events |= POLLOUT;
+    }
+
+    p->data[fdt->index] = data;
+
+    return 0;
+}
+
+int sc_sock_poll_del(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
+                     enum sc_sock_ev events, void *data)
+{
+    if ((fdt->op & events) == 0) {
+        return 0;
+    }
+
+    fdt->op = sc_sock_poll_rest(fdt, events);
+    if (fdt->op == SC_SOCK_NONE) {
+        p->events[fdt->index].fd = SC_INVALID;
+        p->count--;
+        fdt->index = -1;
+    } else {
+        p->events[fdt->index].events = 0;
+
+        if (fdt->op & SC_SOCK_READ) {
+            p->events[fdt->index].events |= POLLIN;
+        }
+
+        if (fdt->op & SC_SOCK_WRITE) {
+            p->events[fdt->index].events |= POLLOUT;
+        }
+
+        p->data[fdt->index] = data;
+    }
+
+    return 0;
+}
+
+void *sc_sock_poll_data(struct sc_sock_poll *p, int i)
+{
+    return p->data[i];
+}
+
+static uint32_t sc_sock_poll_decode(const struct pollfd *ev)
+{
+    uint32_t events = 0;
+    uint32_t epoll_events = (uint32_t) ev->revents;
+
+    if (epoll_events & POLLIN) {
+        events |= SC_SOCK_READ;
+    }
 
-    /*  Create listening socket. */
-    listener = socket(AF_INET, SOCK_STREAM, 0);
-    if (listener == SOCKET_ERROR) {
-        goto wsafail;
+    if (epoll_events & POLLOUT) {
+        events |= SC_SOCK_WRITE;
     }
 
-    rc = setsockopt(listener, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (char *) &val,
-                    sizeof(val));
-    if (rc == SOCKET_ERROR) {
-        goto wsafail;
+    epoll_events &= POLLHUP | POLLERR;
+    if (epoll_events != 0) {
+        events = (SC_SOCK_READ | SC_SOCK_WRITE);
     }
 
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
-    addr.sin_port = 0;
+    return events;
+}
 
-    rc = bind(listener, (const struct sockaddr *) &addr, sizeof(addr));
-    if (rc == SOCKET_ERROR) {
-        goto wsafail;
-    }
+uint32_t sc_sock_poll_event(struct sc_sock_poll *p, int i)
+{
+    return sc_sock_poll_decode(&p->events[i]);
+}
 
-    rc = getsockname(listener, (struct sockaddr *) &addr, &addrlen);
-    if (rc == SOCKET_ERROR) {
-        goto wsafail;
-    }
+int sc_sock_poll_wait(struct sc_sock_poll* p, int timeout)
+{
+    int n, rc = p->cap;
 
-    rc = listen(listener, 1);
-    if (rc == SOCKET_ERROR) {
-        goto wsafail;
+    timeout = (timeout == -1) ? 16 : timeout;
+
+    sc_sock_poll_stat_begin(p);
+    sc_sock_poll_hist_begin(p);
+
+    do {
+        n = WSAPoll(p->events, (ULONG)p->cap, timeout);
+    } while (n < 0 && errno == EINTR);
+
+    if (n == SC_INVALID) {
+        rc = -1;
+        sc_sock_poll_set_err(p, "poll : %s ", strerror(errno));
     }
 
-    p->fds[1] = socket(AF_INET, SOCK_STREAM, 0);
-    if (p->fds[1] == SOCKET_ERROR) {
-        goto wsafail;
+    sc_sock_poll_stat_end(p, n);
+    sc_sock_poll_hist_end(p);
+
+    return rc;
+}
+
+int sc_sock_poll_wait_batch(struct sc_sock_poll *p, int timeout,
+                            struct sc_sock_poll_ev *ev, int cap)
+{
+    int n = 0, max = sc_sock_poll_max(p, cap);
+    int rc = sc_sock_poll_wait(p, timeout);
+
+    if (rc < 0) {
+        return -1;
     }
 
-    rc = setsockopt(p->fds[1], IPPROTO_TCP, TCP_NODELAY, (char *) &nodelay,
-                    sizeof(nodelay));
-    if (rc == SOCKET_ERROR) {
-        goto wsafail;
+    // Only ready fds are returned, unlike sc_sock_poll_wait()
+    for (int i = 0; i < rc && n < max; i++) {
+        if (p->events[i].fd == SC_INVALID || p->events[i].revents == 0) {
+            continue;
+        }
+
+        ev[n].data = p->data[i];
+        ev[n].events = sc_sock_poll_decode(&p->events[i]);
+        n++;
     }
 
-    rc = connect(p->fds[1], (struct sockaddr *) &addr, sizeof(addr));
-    if (rc == SOCKET_ERROR) {
-        goto wsafail;
+    return n;
+}
+
+#endif
+
+#if defined(_MSC_VER)
+    #define sc_sock_xchg_ptr(p, v) InterlockedExchangePointer((void **) (p), v)
+    #define sc_sock_xchg_long(p, v) InterlockedExchange(p, v)
+    #define sc_sock_load_ptr(p)                                                \
+        InterlockedCompareExchangePointer((void **) (p), NULL, NULL)
+    #define sc_sock_store_ptr(p, v) sc_sock_xchg_ptr(p, v)
+#else
+    #define sc_sock_xchg_ptr(p, v) __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST)
+    #define sc_sock_xchg_long(p, v) __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST)
+    #define sc_sock_load_ptr(p) __atomic_load_n(p, __ATOMIC_SEQ_CST)
+    #define sc_sock_store_ptr(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#endif
+
+#if defined(__linux__)
+    #include <sys/eventfd.h>
+#endif
+
+const char *sc_sock_notify_err(struct sc_sock_notify *n)
+{
+    return n->err;
+}
+
+static void sc_sock_notify_set_err(struct sc_sock_notify *n, const char *fmt,
+                                   ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(n->err, sizeof(n->err), fmt, args);
+    va_end(args);
+
+    n->err[sizeof(n->err) - 1] = '\0';
+}
+
+#if defined(__linux__)
+
+static int sc_sock_notify_open(struct sc_sock_notify *n, void *data)
+{
+    int rc;
+
+    n->fdt = (struct sc_sock_fd){0};
+
+    rc = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (rc == -1) {
+        sc_sock_notify_set_err(n, "eventfd() : %s ", strerror(errno));
+        return -1;
     }
 
-    p->fds[0] = accept(listener, (struct sockaddr *) &addr, &addrlen);
-    if (p->fds[0] == INVALID_SOCKET) {
-        goto wsafail;
+    n->fdt.fd = rc;
+
+    rc = sc_sock_poll_add(n->poll, &n->fdt, SC_SOCK_READ, data);
+    if (rc != 0) {
+        sc_sock_notify_set_err(n, "%s", sc_sock_poll_err(n->poll));
+        close(n->fdt.fd);
+        return -1;
     }
 
-    closesocket(listener);
+    return 0;
+}
+
+static int sc_sock_notify_close(struct sc_sock_notify *n)
+{
+    int rc;
+
+    rc = sc_sock_poll_del(n->poll, &n->fdt, SC_SOCK_READ, NULL);
+    rc |= close(n->fdt.fd);
+
+    return rc == 0 ? 0 : -1;
+}
+
+static int sc_sock_notify_signal(struct sc_sock_notify *n)
+{
+    ssize_t rc;
+    uint64_t val = 1;
+
+retry:
+    rc = write(n->fdt.fd, &val, sizeof(val));
+    if (rc != sizeof(val)) {
+        if (rc == -1 && errno == EINTR) {
+            goto retry;
+        }
+
+        // Counter is full, consumer is going to wake up anyway.
+        if (rc == -1 && errno == EAGAIN) {
+            return 0;
+        }
+
+        return -1;
+    }
 
     return 0;
+}
 
-wsafail:
-    sc_sock_pipe_set_err(p, "sc_sock_pipe_init() : %d ", WSAGetLastError());
-    return -1;
+void sc_sock_notify_drain(struct sc_sock_notify *n)
+{
+    ssize_t rc;
+    uint64_t val;
+
+    // Non-blocking, a single read resets the counter.
+    do {
+        rc = read(n->fdt.fd, &val, sizeof(val));
+    } while (rc == -1 && errno == EINTR);
 }
 
-int sc_sock_pipe_term(struct sc_sock_pipe *p)
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+
+/* User event identifier is the notify address, unique while it is alive. */
+static int sc_sock_notify_open(struct sc_sock_notify *n, void *data)
 {
-    int rc = 0, rv;
+    int rc;
+    struct kevent ev;
 
-    rv = closesocket(p->fds[0]);
-    if (rv != 0) {
-        rc = -1;
-        sc_sock_pipe_set_err(p, "closesocket() : err(%d) ", WSAGetLastError());
+    rc = sc_sock_poll_expand(n->poll);
+    if (rc != 0) {
+        sc_sock_notify_set_err(n, "%s", sc_sock_poll_err(n->poll));
+        return -1;
     }
 
-    rv = closesocket(p->fds[1]);
-    if (rv != 0) {
-        rc = -1;
-        sc_sock_pipe_set_err(p, "closesocket() : err(%d) ", WSAGetLastError());
+    EV_SET(&ev, (uintptr_t) n, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, data);
+
+    rc = kevent(n->poll->fds, &ev, 1, NULL, 0, NULL);
+    if (rc != 0) {
+        sc_sock_notify_set_err(n, "kevent : %s ", strerror(errno));
+        return -1;
     }
 
-    return rc;
+    n->poll->count++;
+
+    return 0;
 }
 
-int sc_sock_pipe_write(struct sc_sock_pipe *p, void *data, unsigned int len)
+static int sc_sock_notify_close(struct sc_sock_notify *n)
 {
     int rc;
+    struct kevent ev;
 
-    rc = send(p->fds[1], data, len, 0);
-    if (rc == SOCKET_ERROR || (unsigned int) rc != len) {
-        sc_sock_pipe_set_err(p, "pipe send() : err(%d) ", WSAGetLastError());
+    EV_SET(&ev, (uintptr_t) n, EVFILT_USER, EV_DELETE, 0, 0, NULL);
+
+    rc = kevent(n->poll->fds, &ev, 1, NULL, 0, NULL);
+    if (rc != 0) {
+        sc_sock_notify_set_err(n, "kevent : %s ", strerror(errno));
+        return -1;
     }
 
-    return rc;
+    n->poll->count--;
+
+    return 0;
 }
 
-int sc_sock_pipe_read(struct sc_sock_pipe *p, void *data, unsigned int len)
+static int sc_sock_notify_signal(struct sc_sock_notify *n)
 {
     int rc;
+    struct kevent ev;
 
-    rc = recv(p->fds[0], (char *) data, len, 0);
-    if (rc == SOCKET_ERROR || (unsigned int) rc != len) {
-        sc_sock_pipe_set_err(p, "pipe recv() : err(%d) ", WSAGetLastError());
+    EV_SET(&ev, (uintptr_t) n, EVFILT_USER, 0, NOTE_TRIGGER, 0, NULL);
+
+retry:
+    rc = kevent(n->poll->fds, &ev, 1, NULL, 0, NULL);
+    if (rc != 0) {
+        if (errno == EINTR) {
+            goto retry;
+        }
+
+        return -1;
     }
 
-    return rc;
+    return 0;
+}
+
+void sc_sock_notify_drain(struct sc_sock_notify *n)
+{
+    // EV_CLEAR resets the user event once it is reported.
+    (void) n;
 }
 
 #else
 
-int sc_sock_pipe_init(struct sc_sock_pipe *p, int type)
+static int sc_sock_notify_open(struct sc_sock_notify *n, void *data)
 {
     int rc;
 
-    rc = pipe(p->fds);
+    rc = sc_sock_pipe_init(&n->pipe, 0);
     if (rc != 0) {
-        sc_sock_pipe_set_err(p, "pipe() : %s ", strerror(errno));
+        sc_sock_notify_set_err(n, "%s", sc_sock_pipe_err(&n->pipe));
         return -1;
     }
 
-    p->fdt.type = type;
-    p->fdt.op = SC_SOCK_NONE;
-    p->fdt.fd = p->fds[0];
+    rc = sc_sock_poll_add(n->poll, &n->pipe.fdt, SC_SOCK_READ, data);
+    if (rc != 0) {
+        sc_sock_notify_set_err(n, "%s", sc_sock_poll_err(n->poll));
+        sc_sock_pipe_term(&n->pipe);
+        return -1;
+    }
 
     return 0;
 }
 
-int sc_sock_pipe_term(struct sc_sock_pipe *p)
+static int sc_sock_notify_close(struct sc_sock_notify *n)
 {
-    int rc = 0, rv;
+    int rc;
 
-    rv = close(p->fds[0]);
-    if (rv != 0) {
-        rc = -1;
-        sc_sock_pipe_set_err(p, "pipe close() : %s ", strerror(errno));
+    rc = sc_sock_poll_del(n->poll, &n->pipe.fdt, SC_SOCK_READ, NULL);
+    rc |= sc_sock_pipe_term(&n->pipe);
+
+    return rc == 0 ? 0 : -1;
+}
+
+static int sc_sock_notify_signal(struct sc_sock_notify *n)
+{
+    char c = 0;
+
+    return sc_sock_pipe_write(&n->pipe, &c, 1) == 1 ? 0 : -1;
+}
+
+/*
+ * Drain is called only after poll reports the pipe readable, so there is at
+ * least one byte to read and the blocking pipe does not block. Leftover
+ * bytes cause one more wakeup.
+ */
+void sc_sock_notify_drain(struct sc_sock_notify *n)
+{
+    char buf[64];
+
+    sc_sock_pipe_read(&n->pipe, buf, sizeof(buf));
+}
+
+#endif
+
+int sc_sock_notify_init(struct sc_sock_notify *n, struct sc_sock_poll *poll,
+                        void *data)
+{
+    *n = (struct sc_sock_notify){0};
+
+    n->poll = poll;
+    n->head = &n->stub;
+    n->tail = &n->stub;
+
+    // Consumer is parked initially, first push must signal.
+    n->armed = 1;
+
+    return sc_sock_notify_open(n, data);
+}
+
+int sc_sock_notify_term(struct sc_sock_notify *n)
+{
+    return sc_sock_notify_close(n);
+}
+
+static void sc_sock_notify_enqueue(struct sc_sock_notify *n,
+                                   struct sc_sock_notify_node *node)
+{
+    struct sc_sock_notify_node *prev;
+
+    sc_sock_store_ptr(&node->next, NULL);
+    prev = sc_sock_xchg_ptr(&n->head, node);
+
+    // Between these two lines, consumer sees an empty queue.
+    sc_sock_store_ptr(&prev->next, node);
+}
+
+int sc_sock_notify_push(struct sc_sock_notify *n,
+                        struct sc_sock_notify_node *node)
+{
+    int rc;
+
+    sc_sock_notify_enqueue(n, node);
+
+    // Only the producer that disarms the notifier signals the consumer.
+    if (sc_sock_xchg_long(&n->armed, 0) == 0) {
+        return 0;
     }
 
-    rv = close(p->fds[1]);
-    if (rv != 0) {
-        rc = -1;
-        sc_sock_pipe_set_err(p, "pipe close() : %s ", strerror(errno));
+    rc = sc_sock_notify_signal(n);
+    if (rc != 0) {
+        sc_sock_notify_set_err(n, "signal : %s ", strerror(errno));
+        return -1;
     }
 
-    return rc;
+    return 0;
 }
 
-int sc_sock_pipe_write(struct sc_sock_pipe *p, void *data, unsigned int len)
+/*
+ * Intrusive MPSC queue, see Dmitry Vyukov's "Intrusive MPSC node-based
+ * queue". The stub node is used to keep the queue non-empty, so consumer
+ * never touches the 'head'.
+ */
+static struct sc_sock_notify_node *
+sc_sock_notify_dequeue(struct sc_sock_notify *n)
 {
-    ssize_t n;
-    char *b = data;
+    struct sc_sock_notify_node *tail = n->tail;
+    struct sc_sock_notify_node *next = sc_sock_load_ptr(&tail->next);
+
+    if (tail == &n->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+
+        n->tail = next;
+        tail = next;
+        next = sc_sock_load_ptr(&next->next);
+    }
+
+    if (next != NULL) {
+        n->tail = next;
+        return tail;
+    }
+
+    // A producer is in the middle of a push
+    if (tail != sc_sock_load_ptr(&n->head)) {
+        return NULL;
+    }
 
-retry:
-    n = write(p->fds[1], b, len);
-    if (n == -1 && errno == EINTR) {
-        goto retry;
+    sc_sock_notify_enqueue(n, &n->stub);
+
+    next = sc_sock_load_ptr(&tail->next);
+    if (next != NULL) {
+        n->tail = next;
+        return tail;
     }
 
-    return n;
+    return NULL;
 }
 
-int sc_sock_pipe_read(struct sc_sock_pipe *p, void *data, unsigned int len)
+struct sc_sock_notify_node *sc_sock_notify_pop(struct sc_sock_notify *n)
 {
-    ssize_t n;
-    char *b = data;
+    struct sc_sock_notify_node *node;
 
-retry:
-    n = read(p->fds[0], b, len);
-    if (n == -1 && errno == EINTR) {
-        goto retry;
+    node = sc_sock_notify_dequeue(n);
+    if (node != NULL) {
+        return node;
     }
 
-    return n;
+    /*
+     * Arm and check again. A producer that pushed before arming is visible
+     * now, a producer that pushes after arming signals. If we disarm here
+     * and a producer got there first, it signals anyway, worst case is a
+     * spurious wakeup.
+     */
+    sc_sock_xchg_long(&n->armed, 1);
+
+    node = sc_sock_notify_dequeue(n);
+    if (node != NULL) {
+        sc_sock_xchg_long(&n->armed, 0);
+    }
+
+    return node;
 }
 
-#endif
+#if !defined(_WIN32)
 
-const char *sc_sock_poll_err(struct sc_sock_poll *p)
+    #include <signal.h>
+
+    #if defined(__linux__)
+        #include <sys/signalfd.h>
+    #endif
+
+const char *sc_sock_signal_err(struct sc_sock_signal *s)
 {
-    return p->err;
+    return s->err;
 }
 
-static void sc_sock_poll_set_err(struct sc_sock_poll *p, const char *fmt, ...)
+static void sc_sock_signal_set_err(struct sc_sock_signal *s, const char *fmt,
+                                   ...)
 {
     va_list args;
 
     va_start(args, fmt);
-    vsnprintf(p->err, sizeof(p->err), fmt, args);
+    vsnprintf(s->err, sizeof(s->err), fmt, args);
     va_end(args);
 
-    p->err[sizeof(p->err) - 1] = '\0';
+    s->err[sizeof(s->err) - 1] = '\0';
 }
 
-#if defined(__linux__)
+    #if defined(__linux__)
 
-int sc_sock_poll_init(struct sc_sock_poll *p)
+static int sc_sock_signal_open(struct sc_sock_signal *s, sigset_t *set)
 {
-    int fds;
+    int rc;
+    sigset_t old;
 
-    *p = (struct sc_sock_poll){0};
+    rc = sigprocmask(SIG_BLOCK, set, &old);
+    if (rc != 0) {
+        sc_sock_signal_set_err(s, "sigprocmask() : %s ", strerror(errno));
+        return -1;
+    }
 
-    p->events = sc_sock_malloc(sizeof(*p->events) * 16);
-    if (p->events == NULL) {
-        sc_sock_poll_set_err(p, "Out of memory.");
-        goto error;
+    for (int i = 0; i < s->count; i++) {
+        if (s->signals[i] < 64 && sigismember(&old, s->signals[i])) {
+            s->blocked |= (uint64_t) 1 << s->signals[i];
+        }
     }
 
-    fds = epoll_create1(0);
-    if (fds == -1) {
-        sc_sock_poll_set_err(p, "epoll_create1(): %s ", strerror(errno));
-        goto error;
+    rc = signalfd(-1, set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (rc == -1) {
+        sc_sock_signal_set_err(s, "signalfd() : %s ", strerror(errno));
+        sigprocmask(SIG_SETMASK, &old, NULL);
+        return -1;
     }
 
-    p->cap = 16;
-    p->fds = fds;
+    s->fdt.fd = rc;
 
     return 0;
-error:
-    sc_sock_free(p->events);
-    p->events = NULL;
-    p->fds = -1;
-
-    return -1;
 }
 
-int sc_sock_poll_term(struct sc_sock_poll *p)
+static int sc_sock_signal_close(struct sc_sock_signal *s)
 {
-    sc_sock_free(p->events);
-    return close(p->fds);
+    int rc;
+    sigset_t set;
+
+    sigemptyset(&set);
+    for (int i = 0; i < s->count; i++) {
+        if (s->signals[i] >= 64 ||
+            (s->blocked & ((uint64_t) 1 << s->signals[i])) == 0) {
+            sigaddset(&set, s->signals[i]);
+        }
+    }
+
+    rc = close(s->fdt.fd);
+    rc |= sigprocmask(SIG_UNBLOCK, &set, NULL);
+
+    return rc == 0 ? 0 : -1;
 }
 
-static int sc_sock_poll_expand(struct sc_sock_poll *p)
+int sc_sock_signal_read(struct sc_sock_signal *s)
 {
-    int cap, rc = 0;
-    void *ev;
+    ssize_t n;
+    struct signalfd_siginfo info;
 
-    if (p->count == p->cap) {
-        if (p->cap >= SC_SIZE_MAX / 2) {
-            goto error;
+retry:
+    n = read(s->fdt.fd, &info, sizeof(info));
+    if (n != sizeof(info)) {
+        if (n == -1 && errno == EINTR) {
+            goto retry;
         }
 
-        cap = p->cap * 2;
-        ev = sc_sock_realloc(p->events, cap * sizeof(*p->events));
-        if (ev == NULL) {
-            goto error;
+        if (n == -1 && errno == EAGAIN) {
+            return 0;
         }
 
-        p->cap = cap;
-        p->events = ev;
+        sc_sock_signal_set_err(s, "signalfd read : %s ", strerror(errno));
+        return -1;
     }
 
-    return rc;
-
-error:
-    sc_sock_poll_set_err(p, "Out of memory.");
-    return -1;
+    return (int) info.ssi_signo;
 }
 
-int sc_sock_poll_add(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
-                     enum sc_sock_ev events, void *data)
+    #elif defined(__APPLE__) || defined(__FreeBSD__)
+
+static void sc_sock_signal_reset(struct sc_sock_signal *s, void (*fn)(int))
 {
-    int rc, op = EPOLL_CTL_MOD;
-    enum sc_sock_ev mask = fdt->op | events;
+    struct sigaction act = {0};
 
-    struct epoll_event ep_ev = {.data.ptr = data,
-                                .events = EPOLLERR | EPOLLHUP | EPOLLRDHUP};
+    act.sa_handler = fn;
+    sigemptyset(&act.sa_mask);
 
-    if ((fdt->op & events) == events) {
-        return SC_SOCK_OK;
+    for (int i = 0; i < s->count; i++) {
+        sigaction(s->signals[i], &act, NULL);
     }
+}
 
-    if (fdt->op == SC_SOCK_NONE) {
-        rc = sc_sock_poll_expand(p);
-        if (rc != 0) {
-            return -1;
-        }
+// EVFILT_SIGNAL records a signal even if it is ignored, ignore them so the
+// default action does not run.
+static int sc_sock_signal_open(struct sc_sock_signal *s, sigset_t *set)
+{
+    int rc;
+    struct kevent ev[SC_SOCK_SIGNAL_MAX];
 
-        op = EPOLL_CTL_ADD;
-    }
+    (void) set;
 
-    if (mask & SC_SOCK_READ) {
-        ep_ev.events |= EPOLLIN;
+    rc = kqueue();
+    if (rc == -1) {
+        sc_sock_signal_set_err(s, "kqueue() : %s ", strerror(errno));
+        return -1;
     }
 
-    if (mask & SC_SOCK_WRITE) {
-        ep_ev.events |= EPOLLOUT;
+    s->fdt.fd = rc;
+
+    for (int i = 0; i < s->count; i++) {
+        EV_SET(&ev[i], s->signals[i], EVFILT_SIGNAL, EV_ADD, 0, 0, NULL);
     }
 
-    rc = epoll_ctl(p->fds, op, fdt->fd, &ep_ev);
+    rc = kevent(s->fdt.fd, ev, s->count, NULL, 0, NULL);
     if (rc != 0) {
-        sc_sock_poll_set_err(p, "epoll_ctl : %s ", strerror(errno));
+        sc_sock_signal_set_err(s, "kevent : %s ", strerror(errno));
+        close(s->fdt.fd);
         return -1;
     }
 
-    p->count += fdt->op == SC_SOCK_NONE;
-    fdt->op = mask;
+    sc_sock_signal_reset(s, SIG_IGN);
 
     return 0;
 }
 
-int sc_sock_poll_del(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
-                     enum sc_sock_ev events, void *data)
+static int sc_sock_signal_close(struct sc_sock_signal *s)
 {
-    int rc, op;
-    struct epoll_event ep_ev = {.data.ptr = data,
-                                .events = EPOLLERR | EPOLLHUP | EPOLLRDHUP};
+    sc_sock_signal_reset(s, SIG_DFL);
 
-    if ((fdt->op & events) == 0) {
-        return 0;
+    return close(s->fdt.fd) == 0 ? 0 : -1;
+}
+
+int sc_sock_signal_read(struct sc_sock_signal *s)
+{
+    int n;
+    struct kevent ev;
+    struct timespec ts = {0, 0};
+
+retry:
+    n = kevent(s->fdt.fd, NULL, 0, &ev, 1, &ts);
+    if (n == -1) {
+        if (errno == EINTR) {
+            goto retry;
+        }
+
+        sc_sock_signal_set_err(s, "kevent : %s ", strerror(errno));
+        return -1;
     }
 
-    fdt->op &= ~events;
-    op = fdt->op == SC_SOCK_NONE ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    return n == 0 ? 0 : (int) ev.ident;
+}
 
-    if (fdt->op & SC_SOCK_READ) {
-        ep_ev.events |= EPOLLIN;
+    #else
+
+// Write end of the self-pipe, used by the signal handler.
+static volatile sig_atomic_t sc_sock_signal_fd = -1;
+
+static void sc_sock_signal_handler(int sig)
+{
+    int saved_errno = errno;
+    unsigned char c = (unsigned char) sig;
+
+    // Pipe is non-blocking, if it is full, there are pending reads anyway.
+    (void) !write(sc_sock_signal_fd, &c, 1);
+    errno = saved_errno;
+}
+
+static void sc_sock_signal_reset(struct sc_sock_signal *s)
+{
+    struct sigaction act = {0};
+
+    act.sa_handler = SIG_DFL;
+    sigemptyset(&act.sa_mask);
+
+    for (int i = 0; i < s->count; i++) {
+        sigaction(s->signals[i], &act, NULL);
     }
+}
 
-    if (fdt->op & SC_SOCK_WRITE) {
-        ep_ev.events |= EPOLLOUT;
+static int sc_sock_signal_open(struct sc_sock_signal *s, sigset_t *set)
+{
+    int rc, flags;
+    struct sigaction act = {0};
+
+    if (sc_sock_signal_fd != -1) {
+        sc_sock_signal_set_err(s, "sc_sock_signal exists already. ");
+        return -1;
     }
 
-    rc = epoll_ctl(p->fds, op, fdt->fd, &ep_ev);
+    rc = pipe(s->fds);
     if (rc != 0) {
-        sc_sock_poll_set_err(p, "epoll_ctl : %s ", strerror(errno));
+        sc_sock_signal_set_err(s, "pipe() : %s ", strerror(errno));
         return -1;
     }
 
-    if (fdt->op == SC_SOCK_NONE) {
-        p->count--;
+    for (int i = 0; i < 2; i++) {
+        flags = fcntl(s->fds[i], F_GETFL, 0);
+        if (flags == -1 || fcntl(s->fds[i], F_SETFL, flags | O_NONBLOCK) != 0 ||
+            fcntl(s->fds[i], F_SETFD, FD_CLOEXEC) != 0) {
+            sc_sock_signal_set_err(s, "fcntl() : %s ", strerror(errno));
+            close(s->fds[0]);
+            close(s->fds[1]);
+            return -1;
+        }
+    }
+
+    s->fdt.fd = s->fds[0];
+    sc_sock_signal_fd = s->fds[1];
+
+    act.sa_handler = sc_sock_signal_handler;
+    act.sa_mask = *set;
+    act.sa_flags = SA_RESTART;
+
+    for (int i = 0; i < s->count; i++) {
+        if (sigaction(s->signals[i], &act, NULL) != 0) {
+            sc_sock_signal_set_err(s, "sigaction() : %s ", strerror(errno));
+            sc_sock_signal_reset(s);
+            sc_sock_signal_fd = -1;
+            close(s->fds[0]);
+            close(s->fds[1]);
+            return -1;
+        }
     }
 
     return 0;
 }
 
-void *sc_sock_poll_data(struct sc_sock_poll *p, int i)
+static int sc_sock_signal_close(struct sc_sock_signal *s)
 {
-    return p->events[i].data.ptr;
+    int rc;
+
+    sc_sock_signal_reset(s);
+    sc_sock_signal_fd = -1;
+
+    rc = close(s->fds[0]);
+    rc |= close(s->fds[1]);
+
+    return rc == 0 ? 0 : -1;
 }
 
-uint32_t sc_sock_poll_event(struct sc_sock_poll *p, int i)
+int sc_sock_signal_read(struct sc_sock_signal *s)
 {
-    uint32_t events = 0;
-    uint32_t epoll_events = p->events[i].events;
+    ssize_t n;
+    unsigned char c;
 
-    if (epoll_events & EPOLLIN) {
-        events |= SC_SOCK_READ;
-    }
+retry:
+    n = read(s->fdt.fd, &c, 1);
+    if (n != 1) {
+        if (n == -1 && errno == EINTR) {
+            goto retry;
+        }
 
-    if (epoll_events & EPOLLOUT) {
-        events |= SC_SOCK_WRITE;
-    }
+        if (n == -1 && errno == EAGAIN) {
+            return 0;
+        }
 
-    epoll_events &= EPOLLHUP | EPOLLRDHUP | EPOLLERR;
-    if (epoll_events != 0) {
-        events = (SC_SOCK_READ | SC_SOCK_WRITE);
+        sc_sock_signal_set_err(s, "pipe read : %s ", strerror(errno));
+        return -1;
     }
 
-    return events;
+    return c;
 }
 
-int sc_sock_poll_wait(struct sc_sock_poll *p, int timeout)
+    #endif
+
+int sc_sock_signal_init(struct sc_sock_signal *s, struct sc_sock_poll *poll,
+                        void *data, const int *signals, int count)
 {
-    int n;
+    int rc;
+    sigset_t set;
 
-    do {
-        n = epoll_wait(p->fds, &p->events[0], p->cap, timeout);
-    } while (n < 0 && errno == EINTR);
+    *s = (struct sc_sock_signal){0};
+    s->poll = poll;
+    s->fds[0] = -1;
+    s->fds[1] = -1;
 
-    if (n == -1) {
-        sc_sock_poll_set_err(p, "epoll_wait : %s ", strerror(errno));
+    if (count <= 0 || count > SC_SOCK_SIGNAL_MAX) {
+        sc_sock_signal_set_err(s, "Invalid signal count : %d ", count);
+        return -1;
     }
 
-    return n;
-}
-
-#elif defined(__APPLE__) || defined(__FreeBSD__)
+    sigemptyset(&set);
+    for (int i = 0; i < count; i++) {
+        if (signals[i] <= 0 || sigaddset(&set, signals[i]) != 0) {
+            sc_sock_signal_set_err(s, "Invalid signal : %d ", signals[i]);
+            return -1;
+        }
 
-int sc_sock_poll_init(struct sc_sock_poll *p)
-{
-    int fds;
+        s->signals[i] = signals[i];
+    }
 
-    *p = (struct sc_sock_poll){0};
+    s->count = count;
 
-    p->events = sc_sock_malloc(sizeof(*p->events) * 16);
-    if (p->events == NULL) {
-        sc_sock_poll_set_err(p, "Out of memory.");
-        goto error;
+    rc = sc_sock_signal_open(s, &set);
+    if (rc != 0) {
+        return -1;
     }
 
-    fds = kqueue();
-    if (fds == -1) {
-        sc_sock_poll_set_err(p, "kqueue(): %s ", strerror(errno));
+    rc = sc_sock_poll_add(poll, &s->fdt, SC_SOCK_READ, data);
+    if (rc != 0) {
+        sc_sock_signal_set_err(s, "%s", sc_sock_poll_err(poll));
+        sc_sock_signal_close(s);
         return -1;
     }
 
-    p->cap = 16;
-    p->fds = fds;
-
     return 0;
-error:
-    sc_sock_free(p->events);
-    p->events = NULL;
-    p->fds = -1;
-
-    return -1;
 }
 
-static int sc_sock_poll_expand(struct sc_sock_poll *p)
+int sc_sock_signal_term(struct sc_sock_signal *s)
 {
-    int rc = 0, cap;
-    void *ev;
-
-    if (p->count == p->cap) {
-        if (p->cap >= SC_SIZE_MAX / 2) {
-            goto error;
-        }
+    int rc;
 
-        cap = p->cap * 2;
-        ev = sc_sock_realloc(p->events, cap * sizeof(*p->events));
-        if (ev == NULL) {
-            goto error;
-        }
+    rc = sc_sock_poll_del(s->poll, &s->fdt, SC_SOCK_READ, NULL);
+    rc |= sc_sock_signal_close(s);
 
-        p->cap = cap;
-        p->events = ev;
+    if (rc != 0) {
+        sc_sock_signal_set_err(s, "close : %s ", strerror(errno));
+        return -1;
     }
 
-    return rc;
+    return 0;
+}
 
-error:
-    sc_sock_poll_set_err(p, "Out of memory.");
-    return -1;
+#endif
+
+#if defined(__linux__) && defined(SC_SOCK_HAVE_URING)
+
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+
+static void sc_sock_uring_set_err(struct sc_sock_uring *u, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(u->err, sizeof(u->err), fmt, args);
+    va_end(args);
+
+    u->err[sizeof(u->err) - 1] = '\0';
 }
 
-int sc_sock_poll_term(struct sc_sock_poll *p)
+static int sc_sock_uring_enter(struct sc_sock_uring *u, unsigned int submit,
+                               unsigned int min, unsigned int flags, void *arg,
+                               size_t size)
 {
-    sc_sock_free(p->events);
-    return close(p->fds);
+    long rc;
+
+    do {
+        rc = syscall(__NR_io_uring_enter, u->fd, submit, min, flags, arg,
+                     size);
+    } while (rc < 0 && errno == EINTR);
+
+    return (int) rc;
 }
 
-int sc_sock_poll_add(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
-                     enum sc_sock_ev events, void *data)
+int sc_sock_uring_init(struct sc_sock_uring *u, unsigned int entries)
 {
-    int rc, count = 0;
-    struct kevent ev[2];
-    int mask = fdt->op | events;
+    void *p;
+    long fd;
+    struct io_uring_params params = {0};
 
-    if ((fdt->op & events) == events) {
-        return SC_SOCK_OK;
-    }
+    *u = (struct sc_sock_uring){.fd = -1};
 
-    if (fdt->op == SC_SOCK_NONE) {
-        rc = sc_sock_poll_expand(p);
-        if (rc != 0) {
-            return -1;
-        }
-    }
+    entries = entries == 0 ? SC_SOCK_URING_ENTRIES : entries;
 
-    if (mask & SC_SOCK_WRITE) {
-        EV_SET(&ev[count++], fdt->fd, EVFILT_WRITE, EV_ADD, 0, 0, data);
+    fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) {
+        sc_sock_uring_set_err(u, "io_uring_setup : %s ", strerror(errno));
+        return -1;
     }
 
-    if (mask & SC_SOCK_READ) {
-        EV_SET(&ev[count++], fdt->fd, EVFILT_READ, EV_ADD, 0, 0, data);
-    }
+    u->fd = (int) fd;
 
-    rc = kevent(p->fds, ev, count, NULL, 0, NULL);
-    if (rc != 0) {
-        sc_sock_poll_set_err(p, "kevent : %s ", strerror(errno));
-        return -1;
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        sc_sock_uring_set_err(u, "io_uring : kernel is too old. ");
+        goto error;
     }
 
-    p->count += fdt->op == SC_SOCK_NONE;
-    fdt->op = mask;
+    u->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    u->cq_ring_size = params.cq_off.cqes +
+                      params.cq_entries * sizeof(struct io_uring_cqe);
+    u->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
 
-    return 0;
-}
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_ring_size > u->sq_ring_size) {
+            u->sq_ring_size = u->cq_ring_size;
+        }
+        u->cq_ring_size = 0;
+    }
 
-int sc_sock_poll_del(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
-                     enum sc_sock_ev events, void *data)
-{
-    (void) data;
+    p = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    if (p == MAP_FAILED) {
+        goto error_mmap;
+    }
 
-    int rc, count = 0;
-    struct kevent ev[2];
-    int mask = fdt->op & events;
+    u->sq_ring = p;
+    u->cq_ring = p;
 
-    if (mask == 0) {
-        return 0;
-    }
+    if (u->cq_ring_size != 0) {
+        p = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+        if (p == MAP_FAILED) {
+            goto error_mmap;
+        }
 
-    if (mask & SC_SOCK_READ) {
-        EV_SET(&ev[count++], fdt->fd, EVFILT_READ, EV_DELETE, 0, 0, 0);
+        u->cq_ring = p;
     }
 
-    if (mask & SC_SOCK_WRITE) {
-        EV_SET(&ev[count++], fdt->fd, EVFILT_WRITE, EV_DELETE, 0, 0, 0);
+    p = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (p == MAP_FAILED) {
+        goto error_mmap;
     }
 
-    rc = kevent(p->fds, ev, count, NULL, 0, NULL);
-    if (rc != 0) {
-        sc_sock_poll_set_err(p, "kevent : %s ", strerror(errno));
-        return -1;
+    u->sqes = p;
+
+    u->events = sc_sock_malloc(sizeof(*u->events) * params.cq_entries);
+    if (u->events == NULL) {
+        sc_sock_uring_set_err(u, "Out of memory.");
+        goto error;
     }
 
-    fdt->op &= ~events;
-    p->count -= fdt->op == SC_SOCK_NONE;
+    u->cap = (int) params.cq_entries;
+    u->sq_entries = params.sq_entries;
+    u->sq_head = (unsigned int *) ((char *) u->sq_ring + params.sq_off.head);
+    u->sq_tail = (unsigned int *) ((char *) u->sq_ring + params.sq_off.tail);
+    u->sq_array = (unsigned int *) ((char *) u->sq_ring + params.sq_off.array);
+    u->sq_mask = *(unsigned int *) ((char *) u->sq_ring +
+                                    params.sq_off.ring_mask);
+    u->cq_head = (unsigned int *) ((char *) u->cq_ring + params.cq_off.head);
+    u->cq_tail = (unsigned int *) ((char *) u->cq_ring + params.cq_off.tail);
+    u->cq_cqes = (struct io_uring_cqe *) ((char *) u->cq_ring +
+                                          params.cq_off.cqes);
+    u->cq_mask = *(unsigned int *) ((char *) u->cq_ring +
+                                    params.cq_off.ring_mask);
 
     return 0;
-}
 
-void *sc_sock_poll_data(struct sc_sock_poll *p, int i)
-{
-    return p->events[i].udata;
+error_mmap:
+    sc_sock_uring_set_err(u, "mmap : %s ", strerror(errno));
+error:
+    sc_sock_uring_term(u);
+    return -1;
 }
 
-uint32_t sc_sock_poll_event(struct sc_sock_poll *p, int i)
+int sc_sock_uring_term(struct sc_sock_uring *u)
 {
-    uint32_t events = 0;
+    int rc = 0;
 
-    if (p->events[i].flags & EV_EOF) {
-        events = (SC_SOCK_READ | SC_SOCK_WRITE);
-    } else if (p->events[i].filter == EVFILT_READ) {
-        events |= SC_SOCK_READ;
-    } else if (p->events[i].filter == EVFILT_WRITE) {
-        events |= SC_SOCK_WRITE;
+    if (u->sqes != NULL) {
+        munmap(u->sqes, u->sqes_size);
     }
 
-    return events;
-}
+    if (u->cq_ring != NULL && u->cq_ring != u->sq_ring) {
+        munmap(u->cq_ring, u->cq_ring_size);
+    }
 
-int sc_sock_poll_wait(struct sc_sock_poll *p, int timeout)
-{
-    int n;
-    struct timespec ts;
+    if (u->sq_ring != NULL) {
+        munmap(u->sq_ring, u->sq_ring_size);
+    }
 
-    do {
-        ts.tv_sec = timeout / 1000;
-        ts.tv_nsec = (timeout % 1000) * 1000000;
+    if (u->fd != -1) {
+        rc = close(u->fd);
+        if (rc != 0) {
+            sc_sock_uring_set_err(u, "close : %s ", strerror(errno));
+        }
+    }
 
-        n = kevent(p->fds, NULL, 0, &p->events[0], p->cap,
-                   timeout >= 0 ? &ts : NULL);
-    } while (n < 0 && errno == EINTR);
+    sc_sock_free(u->bufs);
+    sc_sock_free(u->events);
 
-    if (n == -1) {
-        sc_sock_poll_set_err(p, "kevent : %s ", strerror(errno));
-    }
+    u->fd = -1;
+    u->sqes = NULL;
+    u->sq_ring = NULL;
+    u->cq_ring = NULL;
+    u->bufs = NULL;
+    u->events = NULL;
 
-    return n;
+    return rc;
 }
 
-#else // WINDOWS
-
-int sc_sock_poll_init(struct sc_sock_poll *p)
+int sc_sock_uring_register(struct sc_sock_uring *u, const struct iovec *bufs,
+                           unsigned int count)
 {
-    *p = (struct sc_sock_poll){0};
+    long rc;
 
-    p->events = sc_sock_malloc(sizeof(*p->events) * 16);
-    if (p->events == NULL) {
-        sc_sock_poll_set_err(p, "Out of memory.");
+    if (u->bufs != NULL) {
+        sc_sock_uring_set_err(u, "Buffers are already registered.");
         return -1;
     }
 
-    p->data = sc_sock_malloc(sizeof(void *) * 16);
-    if (p->data == NULL) {
-        sc_sock_free(p->events);
-        sc_sock_poll_set_err(p, "Out of memory.");
+    u->bufs = sc_sock_malloc(sizeof(*bufs) * count);
+    if (u->bufs == NULL) {
+        sc_sock_uring_set_err(u, "Out of memory.");
         return -1;
     }
 
-    p->cap = 16;
+    memcpy(u->bufs, bufs, sizeof(*bufs) * count);
 
-    for (int i = 0; i < p->cap; i++) {
-        p->events[i].fd = SC_INVALID;
+    rc = syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_BUFFERS,
+                 u->bufs, count);
+    if (rc < 0) {
+        sc_sock_uring_set_err(u, "io_uring_register : %s ", strerror(errno));
+        sc_sock_free(u->bufs);
+        u->bufs = NULL;
+        return -1;
     }
 
+    u->buf_count = count;
+
     return 0;
 }
 
-int sc_sock_poll_term(struct sc_sock_poll *p)
+int sc_sock_uring_submit(struct sc_sock_uring *u)
 {
-    sc_sock_free(p->events);
-    sc_sock_free(p->data);
+    int rc;
 
-    return 0;
+    if (u->pending == 0) {
+        return 0;
+    }
+
+    rc = sc_sock_uring_enter(u, u->pending, 0, 0, NULL, 0);
+    if (rc < 0) {
+        sc_sock_uring_set_err(u, "io_uring_enter : %s ", strerror(errno));
+        return -1;
+    }
+
+    u->pending -= (unsigned int) rc;
+
+    return rc;
 }
 
-static int sc_sock_poll_expand(struct sc_sock_poll* p)
+static struct io_uring_sqe *sc_sock_uring_sqe(struct sc_sock_uring *u,
+                                              uint8_t op, int fd, void *data)
 {
-    int cap, rc = 0;
-    void** data = NULL;
-    struct pollfd* ev = NULL;
+    unsigned int head, tail, index;
+    struct io_uring_sqe *sqe;
 
-    if (p->count == p->cap) {
-        if (p->cap >= SC_SIZE_MAX / 2) {
-            goto error;
-        }
+    tail = *u->sq_tail;
+    head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
 
-        cap = p->cap * 2;
-        ev = sc_sock_realloc(p->events, cap * sizeof(*ev));
-        if (ev == NULL) {
-            goto error;
+    if (tail - head == u->sq_entries) {
+        /* Ring is full, hand queued entries to the kernel to make space */
+        if (sc_sock_uring_submit(u) < 0) {
+            return NULL;
         }
 
-        data = sc_sock_realloc(p->data, cap * sizeof(*data));
-        if (data == NULL) {
-            goto error;
+        head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head == u->sq_entries) {
+            sc_sock_uring_set_err(u, "Submission queue is full.");
+            return NULL;
         }
+    }
 
-        p->events = ev;
-        p->data = data;
+    index = tail & u->sq_mask;
+    sqe = &u->sqes[index];
 
-        for (int i = p->cap; i < cap; i++) {
-             p->events[i].fd = SC_INVALID;
-        }
+    *sqe = (struct io_uring_sqe){0};
+    sqe->opcode = op;
+    sqe->fd = fd;
+    sqe->user_data = (uint64_t) (uintptr_t) data;
 
-        p->cap = cap;
-    }
+    u->sq_array[index] = index;
 
-    return rc;
+    return sqe;
+}
 
-error:
-    sc_sock_free(ev);
-    sc_sock_poll_set_err(p, "Out of memory.");
-    return -1;
+static void sc_sock_uring_queue(struct sc_sock_uring *u)
+{
+    __atomic_store_n(u->sq_tail, *u->sq_tail + 1, __ATOMIC_RELEASE);
+    u->pending++;
 }
 
-int sc_sock_poll_add(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
-                     enum sc_sock_ev events, void *data)
+int sc_sock_uring_accept(struct sc_sock_uring *u, struct sc_sock *sock,
+                         void *data)
 {
-    int rc;
-    int index = fdt->index;
+    struct io_uring_sqe *sqe;
 
-    if ((fdt->op & events) == events) {
-        return SC_SOCK_OK;
+    sqe = sc_sock_uring_sqe(u, IORING_OP_ACCEPT, sock->fdt.fd, data);
+    if (sqe == NULL) {
+        return -1;
     }
 
-    if (fdt->op == SC_SOCK_NONE) {
-        rc = sc_sock_poll_expand(p);
-        if (rc != 0) {
-            sc_sock_poll_set_err(p, "Out of memory.");
-            return -1;
-        }
-
-        p->count++;
-
-        for (int i = 0; i < p->cap; i++) {
-            if (p->events[i].fd == SC_INVALID) {
-                index = i;
-                break;
-            }
-        }
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sc_sock_uring_queue(u);
 
-        assert(index != -1);
+    return 0;
+}
 
-        p->events[index].fd = fdt->fd;
-        fdt->index = index;
+int sc_sock_uring_accepted(struct sc_sock *sock, struct sc_sock *in, int fd)
+{
+    if (fd < 0) {
+        strncpy(sock->err, strerror(-fd), sizeof(sock->err) - 1);
+        return SC_SOCK_ERROR;
     }
 
-    assert(index != -1);
-
-    fdt->op |= events;
-
-    p->events[fdt->index].events = 0;
-    p->events[fdt->index].revents = 0;
+    return sc_sock_accept_fd(sock, in, fd);
+}
 
-    if (events & SC_SOCK_READ) {
-        p->events[fdt->index].events |= POLLIN;
-    }
+static int sc_sock_uring_rw(struct sc_sock_uring *u, uint8_t op,
+                            struct sc_sock *sock, const char *buf,
+                            unsigned int len, int flags, void *data)
+{
+    struct io_uring_sqe *sqe;
 
-    if (events & SC_SOCK_WRITE) {
-        p->events[fdt->index].events |= POLLOUT;
+    sqe = sc_sock_uring_sqe(u, op, sock->fdt.fd, data);
+    if (sqe == NULL) {
+        return -1;
     }
 
-    p->data[fdt->index] = data;
+    sqe->addr = (uint64_t) (uintptr_t) buf;
+    sqe->len = len;
+    sqe->msg_flags = (uint32_t) flags;
+    sc_sock_uring_queue(u);
 
     return 0;
 }
 
-int sc_sock_poll_del(struct sc_sock_poll *p, struct sc_sock_fd *fdt,
-                     enum sc_sock_ev events, void *data)
+int sc_sock_uring_recv(struct sc_sock_uring *u, struct sc_sock *sock,
+                       char *buf, unsigned int len, int flags, void *data)
 {
-    if ((fdt->op & events) == 0) {
-        return 0;
-    }
+    return sc_sock_uring_rw(u, IORING_OP_RECV, sock, buf, len, flags, data);
+}
 
-    fdt->op &= ~events;
-    if (fdt->op == SC_SOCK_NONE) {
-        p->events[fdt->index].fd = SC_INVALID;
-        p->count--;
-        fdt->index = -1;
-    } else {
-        p->events[fdt->index].events = 0;
+int sc_sock_uring_send(struct sc_sock_uring *u, struct sc_sock *sock,
+                       const char *buf, unsigned int len, int flags,
+                       void *data)
+{
+    return sc_sock_uring_rw(u, IORING_OP_SEND, sock, buf, len, flags, data);
+}
 
-        if (fdt->op & SC_SOCK_READ) {
-            p->events[fdt->index].events |= POLLIN;
-        }
+static int sc_sock_uring_fixed(struct sc_sock_uring *u, uint8_t op,
+                               struct sc_sock *sock, unsigned int index,
+                               size_t offset, unsigned int len, void *data)
+{
+    struct io_uring_sqe *sqe;
 
-        if (fdt->op & SC_SOCK_WRITE) {
-            p->events[fdt->index].events |= POLLOUT;
-        }
+    if (index >= u->buf_count || offset > u->bufs[index].iov_len ||
+        len > u->bufs[index].iov_len - offset) {
+        sc_sock_uring_set_err(u, "Invalid buffer index or range.");
+        return -1;
+    }
 
-        p->data[fdt->index] = data;
+    sqe = sc_sock_uring_sqe(u, op, sock->fdt.fd, data);
+    if (sqe == NULL) {
+        return -1;
     }
 
+    sqe->addr = (uint64_t) (uintptr_t) ((char *) u->bufs[index].iov_base +
+                                        offset);
+    sqe->len = len;
+    sqe->buf_index = (uint16_t) index;
+    sc_sock_uring_queue(u);
+
     return 0;
 }
 
-void *sc_sock_poll_data(struct sc_sock_poll *p, int i)
+int sc_sock_uring_recv_fixed(struct sc_sock_uring *u, struct sc_sock *sock,
+                             unsigned int index, size_t offset,
+                             unsigned int len, void *data)
 {
-    return p->data[i];
+    return sc_sock_uring_fixed(u, IORING_OP_READ_FIXED, sock, index, offset,
+                               len, data);
 }
 
-uint32_t sc_sock_poll_event(struct sc_sock_poll *p, int i)
+int sc_sock_uring_send_fixed(struct sc_sock_uring *u, struct sc_sock *sock,
+                             unsigned int index, size_t offset,
+                             unsigned int len, void *data)
 {
-    uint32_t events = 0;
-    uint32_t epoll_events = p->events[i].revents;
+    return sc_sock_uring_fixed(u, IORING_OP_WRITE_FIXED, sock, index, offset,
+                               len, data);
+}
 
-    if (epoll_events & POLLIN) {
-        events |= SC_SOCK_READ;
-    }
+int sc_sock_uring_wait(struct sc_sock_uring *u, int timeout)
+{
+    int rc;
+    unsigned int head, tail;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg = {0};
+
+    if (timeout != 0) {
+        if (timeout > 0) {
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000ll;
+            arg.ts = (uint64_t) (uintptr_t) &ts;
+        }
 
-    if (epoll_events & POLLOUT) {
-        events |= SC_SOCK_WRITE;
+        rc = sc_sock_uring_enter(u, u->pending, 1,
+                                 IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                 &arg, sizeof(arg));
+        if (rc < 0 && errno != ETIME) {
+            sc_sock_uring_set_err(u, "io_uring_enter : %s ", strerror(errno));
+            return -1;
+        }
+
+        u->pending -= rc > 0 ? (unsigned int) rc : 0;
+    } else if (sc_sock_uring_submit(u) < 0) {
+        return -1;
     }
 
-    epoll_events &= POLLHUP | POLLERR;
-    if (epoll_events != 0) {
-        events = (SC_SOCK_READ | SC_SOCK_WRITE);
+    head = *u->cq_head;
+    tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+
+    u->count = 0;
+    while (head != tail && u->count < u->cap) {
+        u->events[u->count++] = u->cq_cqes[head & u->cq_mask];
+        head++;
     }
 
-    return events;
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+
+    return u->count;
 }
 
-int sc_sock_poll_wait(struct sc_sock_poll* p, int timeout)
+void *sc_sock_uring_data(struct sc_sock_uring *u, int i)
 {
-    int n, rc = p->cap;
-
-    timeout = (timeout == -1) ? 16 : timeout;
-
-    do {
-        n = WSAPoll(p->events, (ULONG)p->cap, timeout);
-    } while (n < 0 && errno == EINTR);
+    return (void *) (uintptr_t) u->events[i].user_data;
+}
 
-    if (n == SC_INVALID) {
-        rc = -1;
-        sc_sock_poll_set_err(p, "poll : %s ", strerror(errno));
-    }
+int sc_sock_uring_result(struct sc_sock_uring *u, int i)
+{
+    return u->events[i].res;
+}
 
-    return rc;
+const char *sc_sock_uring_err(struct sc_sock_uring *u)
+{
+    return u->err;
 }
 
 #endif
@@ -43,14 +43,35 @@
     #pragma comment(lib, "ws2_32.lib")
 
 typedef SOCKET sc_sock_int;
+typedef WSABUF sc_sock_iov;
+
+    // Set buffer of 'iov', arguments are evaluated more than once.
+    #define sc_sock_iov_set(iov, b, l)                                         \
+        ((iov)->buf = (CHAR *) (b), (iov)->len = (ULONG) (l))
 
 #else
     #include <sys/socket.h>
+    #include <sys/uio.h>
 
 typedef int sc_sock_int;
+typedef struct iovec sc_sock_iov;
+
+    // Set buffer of 'iov', arguments are evaluated more than once.
+    #define sc_sock_iov_set(iov, b, l)                                         \
+        ((iov)->iov_base = (void *) (b), (iov)->iov_len = (size_t) (l))
+
+#endif
+
+#ifdef SC_SOCK_HAVE_BUF
+    #include "sc_buf.h"
+#endif
+
+#ifdef SC_SOCK_HAVE_HIST
+    #include "sc_hist.h"
 #endif
 
 #define SC_SOCK_BUF_SIZE 32768
+#define SC_SOCK_BUF_SIZE_HIGH (1024 * 1024)
 
 enum sc_sock_rc
 {
@@ -60,11 +81,23 @@ enum sc_sock_rc
     SC_SOCK_OK = 0
 };
 
+enum sc_sock_profile
+{
+    // SC_SOCK_BUF_SIZE buffers and TCP_NODELAY
+    SC_SOCK_PROFILE_DEFAULT = 0,
+    // TCP_NODELAY, TCP_QUICKACK, SO_BUSY_POLL and TCP_NOTSENT_LOWAT
+    SC_SOCK_LOW_LATENCY = 1,
+    // SC_SOCK_BUF_SIZE_HIGH buffers and TCP_NODELAY
+    SC_SOCK_HIGH_THROUGHPUT = 2,
+};
+
 enum sc_sock_ev
 {
     SC_SOCK_NONE = 0u,
     SC_SOCK_READ = 1u,
     SC_SOCK_WRITE = 2u,
+    SC_SOCK_EDGE = 4u,    // Edge triggered, see sc_sock_poll_add()
+    SC_SOCK_ONESHOT = 8u, // Disarmed after an event, see sc_sock_poll_add()
 };
 
 enum sc_sock_family
@@ -82,12 +115,56 @@ struct sc_sock_fd
     int index;
 };
 
+#ifdef SC_SOCK_HAVE_STATS
+
+/**
+ * Compiled only if SC_SOCK_HAVE_STATS is defined. Counters are written by the
+ * thread that uses the socket or the poll, other threads can take a snapshot
+ * without locks with sc_sock_stats_get() and sc_sock_poll_stats_get().
+ */
+struct sc_sock_stats
+{
+    uint64_t bytes_sent;
+    uint64_t bytes_recv;
+    uint64_t send_calls;
+    uint64_t recv_calls;
+    uint64_t send_again; // EAGAIN count
+    uint64_t recv_again; // EAGAIN count
+    uint64_t errors;
+};
+
+#define SC_SOCK_POLL_HIST 16
+
+struct sc_sock_poll_stats
+{
+    uint64_t waits;
+    uint64_t events;
+    // Wake-to-dispatch time : from wait returning until the next wait call.
+    // hist[i] counts dispatches shorter than 2^i microseconds, last bucket is
+    // for the rest.
+    uint64_t hist[SC_SOCK_POLL_HIST];
+    uint64_t max_us;
+};
+
+#endif
+
 struct sc_sock
 {
     struct sc_sock_fd fdt;
     bool blocking;
     int family;
+    enum sc_sock_profile profile;
     char err[128];
+#ifdef SC_SOCK_HAVE_STATS
+    struct sc_sock_stats stats;
+#endif
+};
+
+// Datagram peer address, see sc_sock_recv_batch() and sc_sock_send_batch().
+struct sc_sock_addr
+{
+    struct sockaddr_storage storage;
+    int len;
 };
 
 /**
@@ -118,6 +195,20 @@ int sc_sock_term(struct sc_sock *sock);
  */
 int sc_sock_listen(struct sc_sock *sock, const char *host, const char *port);
 
+/**
+ * Same as sc_sock_listen() but sets SO_REUSEPORT, so several sockets can
+ * listen on the same address, e.g one per thread. Kernel distributes incoming
+ * connections among them. Not supported on Windows and for unix domain sockets.
+ *
+ * @param sock sock
+ * @param host host
+ * @param port port
+ * @return    '0' on success, negative number on failure.
+ *             call sc_sock_error() for error string.
+ */
+int sc_sock_listen_reuseport(struct sc_sock *sock, const char *host,
+                             const char *port);
+
 /**
  * @param sock sock
  * @param in   sock struct pointer the incoming connection
@@ -139,6 +230,21 @@ int sc_sock_connect(struct sc_sock *sock, const char *dest_addr,
                     const char *dest_port, const char *source_addr,
                     const char *source_port);
 
+/**
+ * Same as sc_sock_connect() with a resolved address, no name lookup is done.
+ * e.g. with an address from sc_sock_addr_init() or an async resolver.
+ *
+ * @param sock         sock
+ * @param addr         destination address
+ * @param source_addr  source addr (outgoing addr), can be NULL.
+ * @param source_port  source port (outgoing port), can be NULL.
+ * @return            '0' on success, SC_SOCK_WANT_WRITE if connect is in
+ *                     progress for a non-blocking socket, '-1' on failure.
+ *                     call sc_sock_error() for error string.
+ */
+int sc_sock_connect_addr(struct sc_sock *sock, const struct sc_sock_addr *addr,
+                         const char *source_addr, const char *source_port);
+
 /**
  * Set socket blocking or nonblocking. Normally, you don't call this directly.
  * sc_sock_init() takes 'blocking' parameter, so sockets will be set according
@@ -167,6 +273,23 @@ int sc_sock_set_rcvtimeo(struct sc_sock *sock, int ms);
  */
 int sc_sock_set_sndtimeo(struct sc_sock *sock, int ms);
 
+/**
+ * Set socket options profile. If socket is not created yet, e.g before
+ * sc_sock_listen() or sc_sock_connect(), profile is applied once it is
+ * created. Profile of a listener is applied to accepted sockets and enables
+ * TCP_FASTOPEN on the listener if it is not the default profile.
+ *
+ * Options that are not supported by the platform or need privileges
+ * (TCP_QUICKACK, SO_BUSY_POLL, TCP_NOTSENT_LOWAT, TCP_FASTOPEN) are
+ * best effort, failures are ignored.
+ *
+ * @param sock    sock
+ * @param profile profile
+ * @return        '0' on success, negative number on failure.
+ *                call sc_sock_error() for error string.
+ */
+int sc_sock_set_profile(struct sc_sock *sock, enum sc_sock_profile profile);
+
 /**
  * Finish connect for nonblocking connections. This function must be called
  * after sc_sock_poll() indicates socket is writable.
@@ -199,6 +322,216 @@ int sc_sock_send(struct sc_sock *sock, char *buf, int len, int flags);
  */
 int sc_sock_recv(struct sc_sock *sock, char *buf, int len, int flags);
 
+/**
+ * Vectored send, sendmsg() or WSASend(). Sends from all buffers with a single
+ * syscall, no need to copy them into a contiguous buffer.
+ *
+ * e.g
+ *  sc_sock_iov iov[2];
+ *  sc_sock_iov_set(&iov[0], header, header_len);
+ *  sc_sock_iov_set(&iov[1], body, body_len);
+ *  int n = sc_sock_sendv(sock, iov, 2, 0);
+ *
+ * @param sock  sock
+ * @param iov   buffers
+ * @param count buffer count, should not exceed IOV_MAX (1024 on Linux)
+ * @param flags normally should be zero, otherwise flags are passed to send().
+ * @return      - on success, returns sent byte count, might be less than the
+ *                total length.
+ *              - SC_SOCK_WANT_WRITE on EAGAIN.
+ *              - SC_SOCK_ERROR on error
+ */
+int sc_sock_sendv(struct sc_sock *sock, sc_sock_iov *iov, int count, int flags);
+
+/**
+ * Vectored receive, recvmsg() or WSARecv(). Buffers are filled in order.
+ *
+ * @param sock  sock
+ * @param iov   buffers
+ * @param count buffer count, should not exceed IOV_MAX (1024 on Linux)
+ * @param flags normally should be zero, otherwise flags are passed to recv().
+ * @return      - on success, returns bytes received.
+ *              - SC_SOCK_WANT_READ on EAGAIN.
+ *              - SC_SOCK_ERROR on error
+ */
+int sc_sock_recvv(struct sc_sock *sock, sc_sock_iov *iov, int count, int flags);
+
+/**
+ * Send file contents without copying them into user space, sendfile() on
+ * Linux, FreeBSD and MacOS. Other platforms read a chunk into a stack buffer
+ * and send it, define SC_SOCK_SENDFILE_COPY to use it everywhere.
+ *
+ * Progress is reported the same way as sc_sock_send(), call it again with
+ * 'offset + sent' and 'len - sent' on partial progress. File offset of 'fd'
+ * is not used, so 'fd' can be shared. On Windows, the offset is moved
+ * while reading and restored before returning. Don't use the file offset
+ * of 'fd' from another thread during the call.
+ *
+ * @param sock   sock
+ * @param fd     file descriptor opened for reading
+ * @param offset file offset
+ * @param len    len
+ * @return       - on success, returns sent byte count, '0' on end of file.
+ *               - SC_SOCK_WANT_WRITE on EAGAIN.
+ *               - SC_SOCK_ERROR on error
+ */
+int sc_sock_sendfile(struct sc_sock *sock, int fd, uint64_t offset, int len);
+
+#ifndef SC_SOCK_BATCH_MAX
+    #define SC_SOCK_BATCH_MAX 64
+#endif
+
+/**
+ * Create a datagram (UDP) socket and bind it. Use port "0" for an ephemeral
+ * port, e.g for a client.
+ *
+ * @param sock sock, initialized with sc_sock_init(), family must be
+ *             SC_SOCK_INET or SC_SOCK_INET6
+ * @param host host
+ * @param port port
+ * @return     '0' on success, negative number on failure.
+ *             call sc_sock_error() for error string.
+ */
+int sc_sock_dgram_bind(struct sc_sock *sock, const char *host,
+                       const char *port);
+
+/**
+ * Resolve datagram destination address, e.g for sc_sock_send_batch().
+ *
+ * @param addr   addr
+ * @param family SC_SOCK_INET or SC_SOCK_INET6
+ * @param host   host
+ * @param port   port
+ * @return       '0' on success, negative number on failure.
+ */
+int sc_sock_addr_init(struct sc_sock_addr *addr, int family, const char *host,
+                      const char *port);
+
+/**
+ * Receive multiple datagrams with a single recvmmsg() call on Linux. Other
+ * platforms fall back to a recvfrom() loop. Each datagram is received into
+ * its own buffer, e.g iov[i] for datagram 'i'. At most SC_SOCK_BATCH_MAX
+ * datagrams are received at once.
+ *
+ * Blocking sockets wait for the first datagram only and return whatever is
+ * ready after that.
+ *
+ * @param sock  sock
+ * @param iov   receive buffer for each datagram
+ * @param lens  out, received length of each datagram, '0' is a valid
+ *              length for datagrams.
+ * @param addrs out, source address of each datagram, can be NULL.
+ * @param count buffer count
+ * @param flags normally should be zero, otherwise flags are passed to recv().
+ * @return      - on success, received datagram count.
+ *              - SC_SOCK_WANT_READ on EAGAIN.
+ *              - SC_SOCK_ERROR on error
+ */
+int sc_sock_recv_batch(struct sc_sock *sock, sc_sock_iov *iov, int *lens,
+                       struct sc_sock_addr *addrs, int count, int flags);
+
+/**
+ * Send multiple datagrams with a single sendmmsg() call on Linux. Other
+ * platforms fall back to a sendto() loop. At most SC_SOCK_BATCH_MAX datagrams
+ * are sent at once.
+ *
+ * @param sock  sock
+ * @param iov   datagrams, iov[i] is sent as datagram 'i'
+ * @param addrs destination address of each datagram
+ * @param count datagram count
+ * @param flags normally should be zero, otherwise flags are passed to send().
+ * @return      - on success, sent datagram count, might be less than 'count'
+ *              - SC_SOCK_WANT_WRITE on EAGAIN.
+ *              - SC_SOCK_ERROR on error
+ */
+int sc_sock_send_batch(struct sc_sock *sock, sc_sock_iov *iov,
+                       struct sc_sock_addr *addrs, int count, int flags);
+
+#ifdef SC_SOCK_HAVE_BUF
+
+    #ifndef SC_SOCK_IOV_MAX
+        #define SC_SOCK_IOV_MAX 64
+    #endif
+
+/**
+ * Fill 'iov' with read regions of 'bufs', e.g a chain of outgoing buffers.
+ * Empty buffers are skipped. Data is not copied, 'bufs' must not be modified
+ * until 'iov' is used. Requires SC_SOCK_HAVE_BUF and sc_buf.
+ *
+ * @param iov   iov array
+ * @param cap   iov array size
+ * @param bufs  buffers
+ * @param count buffer count
+ * @return      iov count
+ */
+int sc_sock_iov_rbufs(sc_sock_iov *iov, int cap, struct sc_buf *bufs,
+                      int count);
+
+/**
+ * Send read regions of 'bufs' with a single sc_sock_sendv() call and mark
+ * sent bytes as read. On partial send, buffers are consumed in order, so
+ * next call continues from where this one left. At most SC_SOCK_IOV_MAX
+ * non-empty buffers are sent at once.
+ *
+ * @param sock  sock
+ * @param bufs  buffers
+ * @param count buffer count
+ * @param flags normally should be zero, otherwise flags are passed to send().
+ * @return      same as sc_sock_sendv()
+ */
+int sc_sock_sendv_buf(struct sc_sock *sock, struct sc_buf *bufs, int count,
+                      int flags);
+
+/**
+ * Receive into free space of 'bufs' in order with a single sc_sock_recvv()
+ * call and mark received bytes as written. Buffers are not expanded.
+ *
+ * @param sock  sock
+ * @param bufs  buffers
+ * @param count buffer count
+ * @param flags normally should be zero, otherwise flags are passed to recv().
+ * @return      same as sc_sock_recvv()
+ */
+int sc_sock_recvv_buf(struct sc_sock *sock, struct sc_buf *bufs, int count,
+                      int flags);
+
+/**
+ * Fill 'iov' with segments of 'chain'. Empty segments are skipped. Data is not
+ * copied, 'chain' must not be modified until 'iov' is used.
+ *
+ * @param iov   iov array
+ * @param cap   iov array size
+ * @param chain chain
+ * @return      iov count
+ */
+int sc_sock_iov_chain(sc_sock_iov *iov, int cap, struct sc_buf_chain *chain);
+
+/**
+ * Send segments of 'chain' with a single sc_sock_sendv() call and consume sent
+ * bytes. At most SC_SOCK_IOV_MAX segments are sent at once.
+ *
+ * @param sock  sock
+ * @param chain chain
+ * @param flags normally should be zero, otherwise flags are passed to send().
+ * @return      same as sc_sock_sendv()
+ */
+int sc_sock_sendv_chain(struct sc_sock *sock, struct sc_buf_chain *chain,
+                        int flags);
+
+/**
+ * Receive into the last segment of 'chain', a new segment is linked if it is
+ * full.
+ *
+ * @param sock  sock
+ * @param chain chain
+ * @param flags normally should be zero, otherwise flags are passed to recv().
+ * @return      same as sc_sock_recv(), SC_SOCK_ERROR on out of memory.
+ */
+int sc_sock_recv_chain(struct sc_sock *sock, struct sc_buf_chain *chain,
+                       int flags);
+
+#endif
+
 /**
  * @param sock sock
  * @return     last error string
@@ -295,8 +628,17 @@ struct sc_sock_poll
     int fds;
     int count;
     int cap;
+    int max;
     struct epoll_event *events;
     char err[128];
+#ifdef SC_SOCK_HAVE_STATS
+    struct sc_sock_poll_stats stats;
+    uint64_t wake;
+#endif
+#ifdef SC_SOCK_HAVE_HIST
+    struct sc_hist *hist;
+    uint64_t hist_wake;
+#endif
 };
 
 #elif defined(__FreeBSD__) || defined(__APPLE__)
@@ -307,8 +649,17 @@ struct sc_sock_poll
     int fds;
     int count;
     int cap;
+    int max;
     struct kevent *events;
     char err[128];
+#ifdef SC_SOCK_HAVE_STATS
+    struct sc_sock_poll_stats stats;
+    uint64_t wake;
+#endif
+#ifdef SC_SOCK_HAVE_HIST
+    struct sc_hist *hist;
+    uint64_t hist_wake;
+#endif
 };
 #else
 
@@ -320,13 +671,28 @@ struct sc_sock_poll
 {
     int count;
     int cap;
+    int max;
     void **data;
     struct pollfd *events;
     char err[128];
+#ifdef SC_SOCK_HAVE_STATS
+    struct sc_sock_poll_stats stats;
+    uint64_t wake;
+#endif
+#ifdef SC_SOCK_HAVE_HIST
+    struct sc_hist *hist;
+    uint64_t hist_wake;
+#endif
 };
 
 #endif
 
+struct sc_sock_poll_ev
+{
+    void *data;
+    uint32_t events;
+};
+
 /**
  * Create poll
  *
@@ -348,9 +714,23 @@ int sc_sock_poll_term(struct sc_sock_poll *poll);
 /**
  * Add fd to to poller.
  *
+ * Optional flags can be combined with events :
+ *
+ * SC_SOCK_EDGE    : Edge triggered (EPOLLET, EV_CLEAR). An event is reported
+ *                   once when fd becomes ready, read/write until it returns
+ *                   SC_SOCK_WANT_READ/SC_SOCK_WANT_WRITE before waiting again.
+ *
+ * SC_SOCK_ONESHOT : (EPOLLONESHOT, EV_ONESHOT). fd is disarmed after an event
+ *                   is reported, call sc_sock_poll_add() with the same events
+ *                   to re-arm it. fd stays registered until sc_sock_poll_del().
+ *
+ * poll()/WSAPoll() backend ignores both flags, events are level triggered.
+ * Registration is not a syscall on this backend.
+ *
  * @param poll    poll
  * @param fdt     fdt
- * @param events  SC_SOCK_READ, SC_SOCK_WRITE or SC_SOCK_READ | SC_SOCK_WRITE
+ * @param events  SC_SOCK_READ, SC_SOCK_WRITE or SC_SOCK_READ | SC_SOCK_WRITE,
+ *                optionally with SC_SOCK_EDGE and/or SC_SOCK_ONESHOT
  * @param data    user data
  * @return        '0' on success, negative number on failure,
  *                call sc_sock_poll_err() to get error string
@@ -362,7 +742,9 @@ int sc_sock_poll_add(struct sc_sock_poll *poll, struct sc_sock_fd *fdt,
  *
  * @param poll   poll
  * @param fdt    fdt
- * @param events SC_SOCK_READ, SC_SOCK_WRITE or SC_SOCK_READ | SC_SOCK_WRITE
+ * @param events SC_SOCK_READ, SC_SOCK_WRITE or SC_SOCK_READ | SC_SOCK_WRITE,
+ *               SC_SOCK_EDGE or SC_SOCK_ONESHOT to clear the flag only.
+ *               Removing both events clears flags as well.
  * @param data   user data
  * @return       '0' on success, negative number on failure,
  *               call sc_sock_poll_err() to get error string
@@ -392,6 +774,40 @@ int sc_sock_poll_del(struct sc_sock_poll *poll, struct sc_sock_fd *fdt,
  */
 int sc_sock_poll_wait(struct sc_sock_poll *poll, int timeout);
 
+/**
+ * Wait and fill 'ev' with user data and events of ready fds, same values
+ * sc_sock_poll_data() and sc_sock_poll_event() return, in a single pass.
+ *
+ * e.g
+ *  struct sc_sock_poll_ev ev[256];
+ *  int n = sc_sock_poll_wait_batch(poll, 100, ev, 256);
+ *  for (int i = 0; i < n; i++) {
+ *      if (ev[i].events & SC_SOCK_READ)  {
+ *          // Handle read event of ev[i].data
+ *      }
+ *  }
+ *
+ * @param poll    poll
+ * @param timeout timeout in milliseconds, '-1' to wait forever
+ * @param ev      event array
+ * @param cap     event array size, at most 'cap' events are returned
+ * @return        event count, negative number on failure,
+ *                call sc_sock_poll_err() to get error string
+ */
+int sc_sock_poll_wait_batch(struct sc_sock_poll *poll, int timeout,
+                            struct sc_sock_poll_ev *ev, int cap);
+
+/**
+ * Limit events returned from a single wait, default is no limit. A smaller
+ * value gives fairness between fds and timers with lower latency, a larger
+ * value amortizes the syscall over more events. poll()/WSAPoll() backend
+ * applies it to sc_sock_poll_wait_batch() only.
+ *
+ * @param poll poll
+ * @param max  max events per wait, '0' for no limit
+ */
+void sc_sock_poll_set_max(struct sc_sock_poll *poll, int max);
+
 /**
  *
  * @param poll poll
@@ -422,4 +838,449 @@ uint32_t sc_sock_poll_event(struct sc_sock_poll *poll, int i);
  */
 const char *sc_sock_poll_err(struct sc_sock_poll *poll);
 
+#ifdef SC_SOCK_HAVE_STATS
+
+/**
+ * Take a snapshot of socket counters, can be called from any thread.
+ * Counters cover sc_sock_send(), sc_sock_recv(), sc_sock_sendv(),
+ * sc_sock_recvv() and sc_sock_sendfile().
+ *
+ * @param sock sock
+ * @param out  snapshot
+ */
+void sc_sock_stats_get(struct sc_sock *sock, struct sc_sock_stats *out);
+
+/**
+ * Take a snapshot of poll counters, can be called from any thread.
+ *
+ * @param poll poll
+ * @param out  snapshot
+ */
+void sc_sock_poll_stats_get(struct sc_sock_poll *poll,
+                            struct sc_sock_poll_stats *out);
+
+#endif
+
+#ifdef SC_SOCK_HAVE_HIST
+
+/**
+ * Record wake-to-dispatch time of the poll into 'hist' in nanoseconds : from
+ * sc_sock_poll_wait() returning until the next wait call. Compiled only if
+ * SC_SOCK_HAVE_HIST is defined, requires sc_hist. 'hist' is written by the
+ * poll thread, other threads can read it with sc_hist_merge().
+ *
+ * @param poll poll
+ * @param hist histogram, NULL to disable.
+ */
+void sc_sock_poll_set_hist(struct sc_sock_poll *poll, struct sc_hist *hist);
+
+#endif
+
+struct sc_sock_notify_node
+{
+    struct sc_sock_notify_node *next;
+};
+
+/**
+ * Wakeup channel, lock-free multi-producer single-consumer queue with a
+ * notifier registered to a poll. Producers push nodes from any thread, fd
+ * is signaled only if the consumer drained the queue and is about to wait.
+ * So, a busy consumer gets many messages without any syscall.
+ *
+ * Notifier is eventfd on Linux, EVFILT_USER on kqueue and sc_sock_pipe on
+ * other platforms. Nodes are intrusive, embed 'struct sc_sock_notify_node'
+ * into your struct.
+ */
+struct sc_sock_notify
+{
+    struct sc_sock_notify_node *head; // Producers
+    char pad[64];
+    struct sc_sock_notify_node *tail; // Consumer
+    struct sc_sock_notify_node stub;
+    long armed;
+    struct sc_sock_poll *poll;
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__)
+    struct sc_sock_fd fdt;
+#else
+    struct sc_sock_pipe pipe;
+#endif
+    char err[128];
+};
+
+/**
+ * Create notifier and register it to 'poll'. Poll reports SC_SOCK_READ with
+ * 'data' once there are nodes to pop.
+ *
+ * @param n    notify
+ * @param poll poll, consumer thread waits on it
+ * @param data user data for the poll event
+ * @return     '0' on success, negative number on failure,
+ *             call sc_sock_notify_err() to get error string
+ */
+int sc_sock_notify_init(struct sc_sock_notify *n, struct sc_sock_poll *poll,
+                        void *data);
+
+/**
+ * Unregister from poll and destroy notifier. Nodes left in the queue are not
+ * touched.
+ *
+ * @param n notify
+ * @return  '0' on success, negative number on failure,
+ *          call sc_sock_notify_err() to get error string
+ */
+int sc_sock_notify_term(struct sc_sock_notify *n);
+
+/**
+ * Push node, thread-safe. Signals the consumer only if it is waiting.
+ *
+ * @param n    notify
+ * @param node node
+ * @return     '0' on success, negative number if signaling fails,
+ *             node is pushed in any case.
+ */
+int sc_sock_notify_push(struct sc_sock_notify *n,
+                        struct sc_sock_notify_node *node);
+
+/**
+ * Consumer thread only. Call it when poll reports the notifier, before
+ * popping nodes.
+ *
+ * e.g
+ *  if (sc_sock_poll_data(poll, i) == &notify) {
+ *      sc_sock_notify_drain(&notify);
+ *      while ((node = sc_sock_notify_pop(&notify)) != NULL) {
+ *          // Handle node
+ *      }
+ *  }
+ *
+ * @param n notify
+ */
+void sc_sock_notify_drain(struct sc_sock_notify *n);
+
+/**
+ * Pop node, consumer thread only. Returning NULL arms the notifier, so the
+ * next push wakes up the poll.
+ *
+ * @param n notify
+ * @return  node or NULL if queue is empty
+ */
+struct sc_sock_notify_node *sc_sock_notify_pop(struct sc_sock_notify *n);
+
+/**
+ * @param n notify
+ * @return  last error string
+ */
+const char *sc_sock_notify_err(struct sc_sock_notify *n);
+
+#if !defined(_WIN32)
+
+// Max signal count of a struct sc_sock_signal.
+#define SC_SOCK_SIGNAL_MAX 8
+
+/**
+ * Signals as poll events. Selected signals make the fd readable instead of
+ * running a handler, so they are handled on the poll thread without locks and
+ * they don't interrupt sc_sock_poll_wait() with EINTR.
+ *
+ * Linux uses signalfd(), signals are blocked with sigprocmask(). Call
+ * sc_sock_signal_init() before creating threads, so other threads inherit the
+ * mask and the signals are not delivered to them. kqueue platforms use a
+ * separate kqueue with EVFILT_SIGNAL, signal dispositions are set to SIG_IGN.
+ * Other platforms use a self-pipe written by a signal handler, only one
+ * sc_sock_signal can exist at a time.
+ *
+ * Not available on Windows.
+ *
+ * e.g
+ *  int sigs[] = {SIGHUP, SIGTERM};
+ *
+ *  sc_sock_signal_init(&sig, &poll, &sig, sigs, 2);
+ *
+ *  if (sc_sock_poll_data(poll, i) == &sig) {
+ *      while ((signo = sc_sock_signal_read(&sig)) > 0) {
+ *          // Handle signal
+ *      }
+ *  }
+ */
+struct sc_sock_signal
+{
+    struct sc_sock_fd fdt;
+    struct sc_sock_poll *poll;
+    int signals[SC_SOCK_SIGNAL_MAX];
+    int count;
+    int fds[2];
+    uint64_t blocked; // Signals already blocked before init, Linux only.
+    char err[128];
+};
+
+/**
+ * Create signal fd and register it to 'poll'. Poll reports SC_SOCK_READ with
+ * 'data' when a signal is pending.
+ *
+ * @param s       signal
+ * @param poll    poll
+ * @param data    user data for the poll event
+ * @param signals signal numbers
+ * @param count   signal count, max SC_SOCK_SIGNAL_MAX
+ * @return        '0' on success, negative number on failure,
+ *                call sc_sock_signal_err() to get error string
+ */
+int sc_sock_signal_init(struct sc_sock_signal *s, struct sc_sock_poll *poll,
+                        void *data, const int *signals, int count);
+
+/**
+ * Unregister from poll and destroy. Signals are unblocked on Linux, other
+ * platforms reset them to SIG_DFL. Signals pending at this point are
+ * delivered with the default action, read them before if needed.
+ *
+ * @param s signal
+ * @return  '0' on success, negative number on failure,
+ *          call sc_sock_signal_err() to get error string
+ */
+int sc_sock_signal_term(struct sc_sock_signal *s);
+
+/**
+ * Non-blocking, call it until it returns '0' when poll reports the signal fd.
+ * Multiple instances of the same signal may be reported once.
+ *
+ * @param s signal
+ * @return  signal number, '0' if there is no pending signal, negative number
+ *          on failure, call sc_sock_signal_err() to get error string.
+ */
+int sc_sock_signal_read(struct sc_sock_signal *s);
+
+/**
+ * @param s signal
+ * @return  last error string
+ */
+const char *sc_sock_signal_err(struct sc_sock_signal *s);
+
+#endif
+
+#if defined(__linux__) && defined(SC_SOCK_HAVE_URING)
+
+    #include <linux/io_uring.h>
+    #include <sys/uio.h>
+
+    #ifndef SC_SOCK_URING_ENTRIES
+        #define SC_SOCK_URING_ENTRIES 256
+    #endif
+
+/**
+ * io_uring completion API, Linux only, compile with SC_SOCK_HAVE_URING.
+ *
+ * Operations are queued into the submission ring without a syscall, a single
+ * sc_sock_uring_wait() call submits all of them and reaps completions. Sockets
+ * can be blocking, kernel waits for readiness internally.
+ *
+ * Requires Linux 5.11+ (IORING_FEAT_EXT_ARG). Uses raw syscalls, liburing is
+ * not required.
+ */
+struct sc_sock_uring
+{
+    int fd;
+    unsigned int pending;
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_array;
+    unsigned int cq_mask;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    struct io_uring_cqe *cq_cqes;
+    struct io_uring_sqe *sqes;
+
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    struct iovec *bufs;
+    unsigned int buf_count;
+
+    int count;
+    int cap;
+    struct io_uring_cqe *events;
+    char err[128];
+};
+
+/**
+ * Create io_uring instance
+ *
+ * @param u       uring
+ * @param entries submission queue size, '0' for SC_SOCK_URING_ENTRIES.
+ *                Completion queue is twice of it.
+ * @return        '0' on success, negative number on failure,
+ *                call sc_sock_uring_err() to get error string
+ */
+int sc_sock_uring_init(struct sc_sock_uring *u, unsigned int entries);
+
+/**
+ * Destroy io_uring instance. Operations in flight are cancelled by the kernel.
+ *
+ * @param u uring
+ * @return  '0' on success, negative number on failure,
+ *          call sc_sock_uring_err() to get error string
+ */
+int sc_sock_uring_term(struct sc_sock_uring *u);
+
+/**
+ * Register buffers for sc_sock_uring_recv_fixed()/sc_sock_uring_send_fixed().
+ * Kernel pins the pages once, so each operation skips page mapping. Buffers
+ * must stay valid until sc_sock_uring_term(). Can be called once.
+ *
+ * @param u     uring
+ * @param bufs  buffers
+ * @param count buffer count
+ * @return      '0' on success, negative number on failure,
+ *              call sc_sock_uring_err() to get error string
+ */
+int sc_sock_uring_register(struct sc_sock_uring *u, const struct iovec *bufs,
+                           unsigned int count);
+
+/**
+ * Queue accept. Result is the accepted fd, pass it to sc_sock_uring_accepted().
+ *
+ * @param u    uring
+ * @param sock listening socket
+ * @param data user data
+ * @return     '0' on success, negative number on failure,
+ *             call sc_sock_uring_err() to get error string
+ */
+int sc_sock_uring_accept(struct sc_sock_uring *u, struct sc_sock *sock,
+                         void *data);
+
+/**
+ * Setup accepted socket, same as sc_sock_accept() does after accept().
+ *
+ * @param sock listening socket
+ * @param in   accepted socket
+ * @param fd   completion result of sc_sock_uring_accept()
+ * @return     SC_SOCK_OK on success, SC_SOCK_ERROR on error,
+ *             call sc_sock_error() on 'sock' to get error string
+ */
+int sc_sock_uring_accepted(struct sc_sock *sock, struct sc_sock *in, int fd);
+
+/**
+ * Queue recv. Result is byte count, '0' if peer closed the connection.
+ * 'buf' must stay valid until the completion.
+ *
+ * @param u     uring
+ * @param sock  socket
+ * @param buf   buf
+ * @param len   len
+ * @param flags recv flags
+ * @param data  user data
+ * @return      '0' on success, negative number on failure,
+ *              call sc_sock_uring_err() to get error string
+ */
+int sc_sock_uring_recv(struct sc_sock_uring *u, struct sc_sock *sock,
+                       char *buf, unsigned int len, int flags, void *data);
+
+/**
+ * Queue send. Result is byte count, might be less than 'len'.
+ * 'buf' must stay valid until the completion.
+ *
+ * @param u     uring
+ * @param sock  socket
+ * @param buf   buf
+ * @param len   len
+ * @param flags send flags
+ * @param data  user data
+ * @return      '0' on success, negative number on failure,
+ *              call sc_sock_uring_err() to get error string
+ */
+int sc_sock_uring_send(struct sc_sock_uring *u, struct sc_sock *sock,
+                       const char *buf, unsigned int len, int flags,
+                       void *data);
+
+/**
+ * Queue recv into a registered buffer.
+ *
+ * @param u      uring
+ * @param sock   socket
+ * @param index  registered buffer index
+ * @param offset offset in the buffer
+ * @param len    len, 'offset + len' must not exceed buffer size
+ * @param data   user data
+ * @return       '0' on success, negative number on failure,
+ *               call sc_sock_uring_err() to get error string
+ */
+int sc_sock_uring_recv_fixed(struct sc_sock_uring *u, struct sc_sock *sock,
+                             unsigned int index, size_t offset,
+                             unsigned int len, void *data);
+
+/**
+ * Queue send from a registered buffer.
+ *
+ * @param u      uring
+ * @param sock   socket
+ * @param index  registered buffer index
+ * @param offset offset in the buffer
+ * @param len    len, 'offset + len' must not exceed buffer size
+ * @param data   user data
+ * @return       '0' on success, negative number on failure,
+ *               call sc_sock_uring_err() to get error string
+ */
+int sc_sock_uring_send_fixed(struct sc_sock_uring *u, struct sc_sock *sock,
+                             unsigned int index, size_t offset,
+                             unsigned int len, void *data);
+
+/**
+ * Submit queued operations without waiting.
+ *
+ * @param u uring
+ * @return  submitted operation count, negative number on failure,
+ *          call sc_sock_uring_err() to get error string
+ */
+int sc_sock_uring_submit(struct sc_sock_uring *u);
+
+/**
+ * Submit queued operations and wait for completions.
+ *
+ * e.g
+ *  int n = sc_sock_uring_wait(u, 100);
+ *  for (int i = 0; i < n; i++) {
+ *      void *user_data = sc_sock_uring_data(u, i);
+ *      int res = sc_sock_uring_result(u, i);
+ *
+ *      if (res < 0) {
+ *          // Operation failed, 'res' is -errno
+ *      }
+ *  }
+ *
+ * @param u       uring
+ * @param timeout timeout in milliseconds, '-1' to wait forever, '0' to reap
+ *                completions without waiting
+ * @return        completion count, negative number on failure,
+ *                call sc_sock_uring_err() to get error string
+ */
+int sc_sock_uring_wait(struct sc_sock_uring *u, int timeout);
+
+/**
+ * @param u uring
+ * @param i completion index
+ * @return  user data of the operation at index 'i'
+ */
+void *sc_sock_uring_data(struct sc_sock_uring *u, int i);
+
+/**
+ * @param u uring
+ * @param i completion index
+ * @return  result of the operation at index 'i', negative errno on failure
+ */
+int sc_sock_uring_result(struct sc_sock_uring *u, int i);
+
+/**
+ * Get error string
+ *
+ * @param u uring
+ * @return  last error string
+ */
+const char *sc_sock_uring_err(struct sc_sock_uring *u);
+
+#endif
+
 #endif
@@ -10,6 +10,9 @@
 #if defined(_WIN32) || defined(_WIN64)
     #include <synchapi.h>
     #define sleep(n) (Sleep(n * 1000))
+#else
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
 #endif
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -454,6 +457,689 @@ void test_poll_mass(void)
     assert(sc_sock_poll_term(&poll) == 0);
 }
 
+void test_poll_flags(void)
+{
+    char buf[8];
+    struct sc_sock_poll poll;
+    struct sc_sock_pipe pipe;
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    assert(sc_sock_pipe_init(&pipe, 0) == 0);
+
+    /* Edge triggered, data left unread is not reported again */
+    assert(sc_sock_poll_add(&poll, &pipe.fdt, SC_SOCK_READ | SC_SOCK_EDGE,
+                            &pipe) == 0);
+    assert(poll.count == 1);
+    assert(sc_sock_pipe_write(&pipe, "ab", 2) == 2);
+    assert(sc_sock_poll_wait(&poll, 100) == 1);
+    assert(sc_sock_poll_data(&poll, 0) == &pipe);
+    assert(sc_sock_poll_event(&poll, 0) == SC_SOCK_READ);
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+#endif
+
+    /* Back to level triggered */
+    assert(sc_sock_poll_del(&poll, &pipe.fdt, SC_SOCK_EDGE, &pipe) == 0);
+    assert(pipe.fdt.op == SC_SOCK_READ);
+    assert(sc_sock_poll_wait(&poll, 100) == 1);
+    assert(sc_sock_poll_wait(&poll, 100) == 1);
+    assert(sc_sock_pipe_read(&pipe, buf, 2) == 2);
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+
+    /* One-shot, disarmed after the first event until re-armed */
+    assert(sc_sock_poll_add(&poll, &pipe.fdt, SC_SOCK_READ | SC_SOCK_ONESHOT,
+                            &pipe) == 0);
+    assert(poll.count == 1);
+    assert(sc_sock_pipe_write(&pipe, "cd", 2) == 2);
+    assert(sc_sock_poll_wait(&poll, 100) == 1);
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+#endif
+    assert(sc_sock_poll_add(&poll, &pipe.fdt, SC_SOCK_READ | SC_SOCK_ONESHOT,
+                            &pipe) == 0);
+    assert(sc_sock_poll_wait(&poll, 100) == 1);
+    assert(sc_sock_poll_event(&poll, 0) == SC_SOCK_READ);
+
+    /* Delete after the event fired, flags are cleared with the events */
+    assert(sc_sock_poll_del(&poll, &pipe.fdt, SC_SOCK_READ, &pipe) == 0);
+    assert(pipe.fdt.op == SC_SOCK_NONE);
+    assert(poll.count == 0);
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+
+    /* Adding write keeps read registered */
+    assert(sc_sock_poll_add(&poll, &pipe.fdt, SC_SOCK_READ, &pipe) == 0);
+    assert(sc_sock_poll_add(&poll, &pipe.fdt, SC_SOCK_WRITE, &pipe) == 0);
+    assert(sc_sock_poll_del(&poll, &pipe.fdt, SC_SOCK_WRITE, &pipe) == 0);
+    assert(sc_sock_poll_wait(&poll, 100) == 1);
+    assert(sc_sock_poll_event(&poll, 0) == SC_SOCK_READ);
+    assert(sc_sock_poll_del(&poll, &pipe.fdt, SC_SOCK_READ, &pipe) == 0);
+    assert(poll.count == 0);
+
+    assert(sc_sock_pipe_term(&pipe) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+
+void test_reuseport(void)
+{
+    struct sc_sock s1, s2, s3;
+
+    sc_sock_init(&s1, 0, false, SC_SOCK_INET);
+    sc_sock_init(&s2, 0, false, SC_SOCK_INET);
+    sc_sock_init(&s3, 0, false, SC_SOCK_UNIX);
+
+#if defined(__linux__) || defined(SO_REUSEPORT)
+    assert(sc_sock_listen_reuseport(&s1, "127.0.0.1", "8013") == 0);
+    assert(sc_sock_listen_reuseport(&s2, "127.0.0.1", "8013") == 0);
+    assert(sc_sock_term(&s1) == 0);
+    assert(sc_sock_term(&s2) == 0);
+#else
+    assert(sc_sock_listen_reuseport(&s1, "127.0.0.1", "8013") != 0);
+#endif
+    assert(sc_sock_listen_reuseport(&s3, "y.sock", NULL) != 0);
+}
+
+void test_vector(void)
+{
+    char a[4], b[16], tmp[32];
+    char s1[] = "head", s2[] = "er", s3[] = "body";
+    sc_sock_iov iov[3];
+    struct sc_sock srv, cli, in;
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    sc_sock_init(&cli, 0, true, SC_SOCK_INET);
+    assert(sc_sock_listen(&srv, "127.0.0.1", "8017") == 0);
+    assert(sc_sock_connect(&cli, "127.0.0.1", "8017", NULL, NULL) == 0);
+    assert(sc_sock_accept(&srv, &in) == 0);
+
+    assert(sc_sock_sendv(&cli, iov, 0, 0) == 0);
+    assert(sc_sock_recvv(&in, iov, 0, 0) == 0);
+
+    sc_sock_iov_set(&iov[0], s1, 4);
+    sc_sock_iov_set(&iov[1], s2, 2);
+    sc_sock_iov_set(&iov[2], s3, 5);
+    assert(sc_sock_sendv(&cli, iov, 3, 0) == 11);
+
+    /* Scatter into two buffers, first one is filled first */
+    sc_sock_iov_set(&iov[0], a, sizeof(a));
+    sc_sock_iov_set(&iov[1], b, sizeof(b));
+    assert(sc_sock_recvv(&in, iov, 2, 0) == 11);
+    assert(memcmp(a, "head", 4) == 0);
+    assert(strcmp(b, "erbody") == 0);
+
+    /* Nonblocking, nothing to read */
+    assert(sc_sock_set_blocking(&in, false) == 0);
+    assert(sc_sock_recvv(&in, iov, 2, 0) == SC_SOCK_WANT_READ);
+    assert(sc_sock_set_blocking(&in, true) == 0);
+
+#ifdef SC_SOCK_HAVE_BUF
+    struct sc_buf bufs[3], rbufs[2];
+
+    assert(sc_buf_init(&bufs[0], 16));
+    assert(sc_buf_init(&bufs[1], 16));
+    assert(sc_buf_init(&bufs[2], 16));
+    sc_buf_put_raw(&bufs[0], "abc", 3);
+    sc_buf_put_raw(&bufs[2], "defgh", 5);
+
+    /* Empty buffers are skipped */
+    assert(sc_sock_iov_rbufs(iov, 3, bufs, 3) == 2);
+    assert(sc_sock_iov_rbufs(iov, 1, bufs, 3) == 1);
+
+    assert(sc_sock_sendv_buf(&cli, bufs, 3, 0) == 8);
+    assert(sc_buf_size(&bufs[0]) == 0);
+    assert(sc_buf_size(&bufs[2]) == 0);
+    assert(sc_sock_sendv_buf(&cli, bufs, 3, 0) == 0);
+
+    rbufs[0] = sc_buf_wrap(a, 2, SC_BUF_REF);
+    rbufs[1] = sc_buf_wrap(tmp, sizeof(tmp), SC_BUF_REF);
+    assert(sc_sock_recvv_buf(&in, rbufs, 2, 0) == 8);
+    assert(sc_buf_size(&rbufs[0]) == 2);
+    assert(sc_buf_size(&rbufs[1]) == 6);
+    assert(memcmp(a, "ab", 2) == 0);
+    assert(memcmp(tmp, "cdefgh", 6) == 0);
+
+    /* Partial progress is accounted in order */
+    sc_buf_put_raw(&bufs[0], "123", 3);
+    sc_buf_put_raw(&bufs[1], "456", 3);
+    assert(sc_sock_sendv_buf(&cli, bufs, 2, 0) == 6);
+    sc_buf_clear(&rbufs[1]);
+    rbufs[1] = sc_buf_wrap(tmp, 4, SC_BUF_REF);
+    assert(sc_sock_recvv_buf(&in, &rbufs[1], 1, 0) == 4);
+    assert(sc_sock_recvv_buf(&in, &rbufs[1], 1, 0) == 0);
+    assert(sc_sock_recv(&in, tmp + 4, 2, 0) == 2);
+    assert(memcmp(tmp, "123456", 6) == 0);
+
+    for (int i = 0; i < 3; i++) {
+        sc_buf_term(&bufs[i]);
+    }
+
+    struct sc_buf_seg_pool pool;
+    struct sc_buf_chain chain, rchain;
+
+    sc_buf_seg_pool_init(&pool, 4, 8);
+    sc_buf_chain_init(&chain, &pool);
+    sc_buf_chain_init(&rchain, &pool);
+
+    assert(sc_sock_sendv_chain(&cli, &chain, 0) == 0);
+    sc_buf_chain_put_raw(&chain, "chained", 7);
+    assert(sc_sock_iov_chain(iov, 3, &chain) == 2);
+    assert(sc_sock_iov_chain(iov, 1, &chain) == 1);
+    assert(sc_sock_sendv_chain(&cli, &chain, 0) == 7);
+    assert(sc_buf_chain_size(&chain) == 0);
+
+    assert(sc_sock_recv_chain(&in, &rchain, 0) == 4);
+    assert(sc_sock_recv_chain(&in, &rchain, 0) == 3);
+    assert(sc_buf_chain_size(&rchain) == 7);
+    assert(memcmp(sc_buf_chain_pullup(&rchain, 7), "chained", 7) == 0);
+
+    sc_buf_chain_term(&chain);
+    sc_buf_chain_term(&rchain);
+    sc_buf_seg_pool_term(&pool);
+#endif
+
+    assert(sc_sock_term(&cli) == 0);
+    assert(sc_sock_recvv(&in, iov, 2, 0) == SC_SOCK_ERROR);
+    assert(sc_sock_term(&in) == 0);
+    assert(sc_sock_term(&srv) == 0);
+}
+
+void test_batch(void)
+{
+    int lens[4];
+    char bufs[4][16];
+    char *msgs[] = {"a", "bc", "", "defg"};
+    sc_sock_iov iov[4];
+    struct sc_sock_addr addrs[4], dest;
+    struct sc_sock srv, cli;
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    sc_sock_init(&cli, 0, false, SC_SOCK_INET);
+    assert(sc_sock_dgram_bind(&srv, "127.0.0.1", "8018") == 0);
+    assert(sc_sock_dgram_bind(&cli, "127.0.0.1", "0") == 0);
+    assert(sc_sock_addr_init(&dest, SC_SOCK_INET, "127.0.0.1", "8018") == 0);
+    assert(sc_sock_addr_init(&dest, SC_SOCK_INET, "invalid host", "1") != 0);
+    assert(sc_sock_addr_init(&dest, SC_SOCK_INET, "127.0.0.1", "8018") == 0);
+
+    for (int i = 0; i < 4; i++) {
+        sc_sock_iov_set(&iov[i], bufs[i], sizeof(bufs[i]));
+    }
+
+    assert(sc_sock_recv_batch(&cli, iov, lens, addrs, 4, 0) ==
+           SC_SOCK_WANT_READ);
+
+    for (int i = 0; i < 4; i++) {
+        sc_sock_iov_set(&iov[i], msgs[i], strlen(msgs[i]));
+        addrs[i] = dest;
+    }
+
+    assert(sc_sock_send_batch(&cli, iov, addrs, 0, 0) == 0);
+    assert(sc_sock_send_batch(&cli, iov, addrs, 4, 0) == 4);
+
+    for (int i = 0; i < 4; i++) {
+        sc_sock_iov_set(&iov[i], bufs[i], sizeof(bufs[i]));
+    }
+
+    /* Blocking socket returns after first datagram with what is ready */
+    int n = 0;
+    while (n < 4) {
+        int rc = sc_sock_recv_batch(&srv, &iov[n], &lens[n], &addrs[n], 4 - n,
+                                    0);
+        assert(rc > 0);
+        n += rc;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        assert(lens[i] == (int) strlen(msgs[i]));
+        assert(memcmp(bufs[i], msgs[i], (size_t) lens[i]) == 0);
+        assert(addrs[i].len > 0);
+    }
+
+    /* Echo back to the source addresses */
+    for (int i = 0; i < 4; i++) {
+        sc_sock_iov_set(&iov[i], bufs[i], lens[i]);
+    }
+    assert(sc_sock_send_batch(&srv, iov, addrs, 4, 0) == 4);
+
+    for (int i = 0; i < 4; i++) {
+        sc_sock_iov_set(&iov[i], bufs[i], sizeof(bufs[i]));
+    }
+
+    n = 0;
+    while (n < 4) {
+        int rc = sc_sock_recv_batch(&cli, &iov[n], &lens[n], NULL, 4 - n, 0);
+        assert(rc > 0 || rc == SC_SOCK_WANT_READ);
+        n += rc > 0 ? rc : 0;
+    }
+    assert(lens[3] == 4 && memcmp(bufs[3], "defg", 4) == 0);
+
+    assert(sc_sock_term(&srv) == 0);
+    assert(sc_sock_term(&cli) == 0);
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    assert(sc_sock_dgram_bind(&srv, "invalid host", "8018") != 0);
+    assert(sc_sock_recv_batch(&srv, iov, lens, NULL, 4, 0) == SC_SOCK_ERROR);
+    assert(sc_sock_send_batch(&srv, iov, addrs, 4, 0) == SC_SOCK_ERROR);
+}
+
+void test_sendfile(void)
+{
+    int fd, rc;
+    int total = 256 * 1024;
+    int sent = 0, recvd = 0;
+    char *data, *out;
+    FILE *fp;
+    struct sc_sock srv, cli, in;
+
+    data = malloc((size_t) total);
+    out = malloc((size_t) total);
+    assert(data != NULL && out != NULL);
+
+    for (int i = 0; i < total; i++) {
+        data[i] = (char) (i * 31);
+    }
+
+    fp = tmpfile();
+    assert(fp != NULL);
+    assert(fwrite(data, 1, (size_t) total, fp) == (size_t) total);
+    assert(fflush(fp) == 0);
+    fd = fileno(fp);
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    sc_sock_init(&cli, 0, true, SC_SOCK_INET);
+    assert(sc_sock_listen(&srv, "127.0.0.1", "8019") == 0);
+    assert(sc_sock_connect(&cli, "127.0.0.1", "8019", NULL, NULL) == 0);
+    assert(sc_sock_accept(&srv, &in) == 0);
+    assert(sc_sock_set_blocking(&cli, false) == 0);
+
+    assert(sc_sock_sendfile(&cli, fd, 0, 0) == 0);
+
+    /* Socket buffers are smaller than the file, expect partial progress */
+    while (recvd < total) {
+        if (sent < total) {
+            rc = sc_sock_sendfile(&cli, fd, (uint64_t) sent, total - sent);
+            assert(rc > 0 || rc == SC_SOCK_WANT_WRITE);
+            if (rc > 0) {
+                sent += rc;
+                continue;
+            }
+        }
+
+        rc = sc_sock_recv(&in, out + recvd, total - recvd, 0);
+        assert(rc > 0);
+        recvd += rc;
+    }
+
+    assert(sent == total);
+    assert(memcmp(data, out, (size_t) total) == 0);
+
+    /* End of file */
+    assert(sc_sock_sendfile(&cli, fd, (uint64_t) total, 100) == 0);
+    assert(sc_sock_sendfile(&cli, -1, 0, 100) == SC_SOCK_ERROR);
+
+    assert(sc_sock_term(&cli) == 0);
+    assert(sc_sock_term(&in) == 0);
+    assert(sc_sock_term(&srv) == 0);
+    assert(fclose(fp) == 0);
+    free(data);
+    free(out);
+}
+
+void test_poll_batch(void)
+{
+    int n;
+    struct sc_sock_poll_ev ev[4];
+    struct sc_sock_poll poll;
+    struct sc_sock_pipe p1, p2;
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    assert(sc_sock_pipe_init(&p1, 0) == 0);
+    assert(sc_sock_pipe_init(&p2, 0) == 0);
+
+    assert(sc_sock_poll_add(&poll, &p1.fdt, SC_SOCK_READ, &p1) == 0);
+    assert(sc_sock_poll_add(&poll, &p2.fdt, SC_SOCK_READ, &p2) == 0);
+    assert(sc_sock_poll_wait_batch(&poll, 0, ev, 4) == 0);
+
+    assert(sc_sock_pipe_write(&p1, "a", 1) == 1);
+    assert(sc_sock_pipe_write(&p2, "b", 1) == 1);
+
+    n = sc_sock_poll_wait_batch(&poll, 100, ev, 4);
+    assert(n == 2);
+    for (int i = 0; i < n; i++) {
+        assert(ev[i].data == &p1 || ev[i].data == &p2);
+        assert(ev[i].events == SC_SOCK_READ);
+    }
+    assert(ev[0].data != ev[1].data);
+
+    /* Caller array size limits the returned events */
+    assert(sc_sock_poll_wait_batch(&poll, 100, ev, 1) == 1);
+
+    /* Max events per wait */
+    sc_sock_poll_set_max(&poll, 1);
+    assert(sc_sock_poll_wait_batch(&poll, 100, ev, 4) == 1);
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+    assert(sc_sock_poll_wait(&poll, 100) == 1);
+#endif
+    sc_sock_poll_set_max(&poll, -1);
+    assert(poll.max == 0);
+    assert(sc_sock_poll_wait_batch(&poll, 100, ev, 4) == 2);
+
+    assert(sc_sock_poll_del(&poll, &p1.fdt, SC_SOCK_READ, &p1) == 0);
+    assert(sc_sock_poll_wait_batch(&poll, 100, ev, 4) == 1);
+    assert(ev[0].data == &p2);
+
+    assert(sc_sock_pipe_term(&p1) == 0);
+    assert(sc_sock_pipe_term(&p2) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+
+void test_stats(void)
+{
+    uint64_t total = 0;
+    char buf[16];
+    struct sc_sock srv, cli, in;
+    struct sc_sock_stats st;
+    struct sc_sock_poll poll;
+    struct sc_sock_poll_stats pst;
+    static struct sc_hist hist;
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    sc_sock_init(&cli, 0, true, SC_SOCK_INET);
+    assert(sc_sock_listen(&srv, "127.0.0.1", "8020") == 0);
+    assert(sc_sock_connect(&cli, "127.0.0.1", "8020", NULL, NULL) == 0);
+    assert(sc_sock_accept(&srv, &in) == 0);
+    assert(sc_sock_set_blocking(&in, false) == 0);
+
+    sc_sock_stats_get(&in, &st);
+    assert(st.bytes_recv == 0 && st.recv_calls == 0);
+
+    assert(sc_sock_recv(&in, buf, sizeof(buf), 0) == SC_SOCK_WANT_READ);
+    assert(sc_sock_send(&cli, "hello", 5, 0) == 5);
+    assert(sc_sock_recv(&in, buf, 5, 0) == 5);
+
+    sc_sock_stats_get(&cli, &st);
+    assert(st.bytes_sent == 5 && st.send_calls == 1 && st.send_again == 0);
+
+    sc_sock_stats_get(&in, &st);
+    assert(st.bytes_recv == 5);
+    assert(st.recv_calls == 2);
+    assert(st.recv_again == 1);
+    assert(st.errors == 0);
+
+    /* Peer close is an error */
+    assert(sc_sock_term(&cli) == 0);
+    assert(sc_sock_set_blocking(&in, true) == 0);
+    assert(sc_sock_recv(&in, buf, sizeof(buf), 0) == SC_SOCK_ERROR);
+    sc_sock_stats_get(&in, &st);
+    assert(st.errors == 1);
+
+    /* First wait has no previous dispatch to measure */
+    assert(sc_sock_poll_init(&poll) == 0);
+    for (int i = 0; i < 4; i++) {
+        assert(sc_sock_poll_wait(&poll, 0) == 0);
+    }
+
+    sc_sock_poll_stats_get(&poll, &pst);
+    assert(pst.waits == 4);
+    assert(pst.events == 0);
+    for (int i = 0; i < SC_SOCK_POLL_HIST; i++) {
+        total += pst.hist[i];
+    }
+    assert(total == 3);
+    assert(sc_sock_poll_term(&poll) == 0);
+
+    /* Same for the histogram */
+    assert(sc_sock_poll_init(&poll) == 0);
+    sc_hist_init(&hist);
+    sc_sock_poll_set_hist(&poll, &hist);
+    for (int i = 0; i < 4; i++) {
+        assert(sc_sock_poll_wait(&poll, 0) == 0);
+    }
+    assert(sc_hist_count(&hist) == 3);
+    assert(sc_hist_max(&hist) < 1000000000);
+    sc_sock_poll_set_hist(&poll, NULL);
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+    assert(sc_hist_count(&hist) == 3);
+    assert(sc_sock_poll_term(&poll) == 0);
+
+    assert(sc_sock_term(&in) == 0);
+    assert(sc_sock_term(&srv) == 0);
+}
+
+static int sock_opt(struct sc_sock *sock, int level, int opt)
+{
+    int val = 0;
+    socklen_t len = sizeof(val);
+
+    assert(getsockopt(sock->fdt.fd, level, opt, (void *) &val, &len) == 0);
+    return val;
+}
+
+void test_profile(void)
+{
+    int def, high;
+    struct sc_sock srv, cli, in;
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    sc_sock_init(&cli, 0, true, SC_SOCK_INET);
+    assert(sc_sock_set_profile(&srv, SC_SOCK_LOW_LATENCY) == 0);
+    assert(sc_sock_set_profile(&cli, SC_SOCK_HIGH_THROUGHPUT) == 0);
+    assert(sc_sock_listen(&srv, "127.0.0.1", "8021") == 0);
+    assert(sc_sock_connect(&cli, "127.0.0.1", "8021", NULL, NULL) == 0);
+    assert(sc_sock_accept(&srv, &in) == 0);
+
+    /* Accepted socket inherits the listener profile */
+    assert(in.profile == SC_SOCK_LOW_LATENCY);
+    assert(sock_opt(&in, IPPROTO_TCP, TCP_NODELAY) != 0);
+#if defined(__linux__) && defined(TCP_NOTSENT_LOWAT)
+    assert(sock_opt(&in, IPPROTO_TCP, TCP_NOTSENT_LOWAT) == 16 * 1024);
+#endif
+
+    /* Profile can be changed on a connected socket */
+    high = sock_opt(&cli, SOL_SOCKET, SO_RCVBUF);
+    assert(sc_sock_set_profile(&cli, SC_SOCK_PROFILE_DEFAULT) == 0);
+    def = sock_opt(&cli, SOL_SOCKET, SO_RCVBUF);
+    assert(def <= high);
+    assert(sock_opt(&cli, IPPROTO_TCP, TCP_NODELAY) != 0);
+
+    assert(sc_sock_send(&cli, "x", 1, 0) == 1);
+    assert(sc_sock_recv(&in, (char[1]){0}, 1, 0) == 1);
+
+    assert(sc_sock_term(&cli) == 0);
+    assert(sc_sock_term(&in) == 0);
+    assert(sc_sock_term(&srv) == 0);
+}
+
+void test_connect_addr(void)
+{
+    int rc;
+    struct sc_sock srv, cli, in;
+    struct sc_sock_addr addr;
+
+    assert(sc_sock_addr_init(&addr, SC_SOCK_INET, "127.0.0.1", "8022") == 0);
+
+    sc_sock_init(&cli, 0, true, SC_SOCK_INET);
+    assert(sc_sock_connect_addr(&cli, &addr, NULL, NULL) == -1);
+    assert(*sc_sock_error(&cli) != '\0');
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    assert(sc_sock_listen(&srv, "127.0.0.1", "8022") == 0);
+
+    sc_sock_init(&cli, 0, true, SC_SOCK_INET);
+    assert(sc_sock_connect_addr(&cli, &addr, "127.0.0.1", NULL) == 0);
+    assert(sc_sock_accept(&srv, &in) == 0);
+    assert(sc_sock_send(&cli, "x", 1, 0) == 1);
+    assert(sc_sock_recv(&in, (char[1]){0}, 1, 0) == 1);
+    assert(sc_sock_term(&cli) == 0);
+    assert(sc_sock_term(&in) == 0);
+
+    // Non-blocking
+    sc_sock_init(&cli, 0, false, SC_SOCK_INET);
+    rc = sc_sock_connect_addr(&cli, &addr, NULL, NULL);
+    assert(rc == 0 || rc == SC_SOCK_WANT_WRITE);
+    while (sc_sock_accept(&srv, &in) != 0) {
+    }
+    assert(sc_sock_term(&in) == 0);
+    assert(sc_sock_term(&cli) == 0);
+    assert(sc_sock_term(&srv) == 0);
+}
+
+#define NOTIFY_THREADS 4
+#define NOTIFY_COUNT   20000
+
+struct notify_msg
+{
+    struct sc_sock_notify_node node;
+    int producer;
+    int seq;
+};
+
+static struct sc_sock_notify notify;
+static struct notify_msg notify_msgs[NOTIFY_THREADS][NOTIFY_COUNT];
+
+static void *notify_producer(void *arg)
+{
+    int id = *(int *) arg;
+
+    for (int i = 0; i < NOTIFY_COUNT; i++) {
+        notify_msgs[id][i].producer = id;
+        notify_msgs[id][i].seq = i;
+        assert(sc_sock_notify_push(&notify, &notify_msgs[id][i].node) == 0);
+    }
+
+    return NULL;
+}
+
+void test_notify(void)
+{
+    int n, total = 0;
+    int ids[NOTIFY_THREADS];
+    int next[NOTIFY_THREADS] = {0};
+    struct notify_msg a, b, *msg;
+    struct sc_sock_notify_node *node;
+    struct sc_sock_poll poll;
+    struct sc_thread threads[NOTIFY_THREADS];
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    assert(sc_sock_notify_init(&notify, &poll, &notify) == 0);
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+    assert(sc_sock_notify_pop(&notify) == NULL);
+
+    /* Only the first push signals, the consumer is not parked afterwards */
+    assert(sc_sock_notify_push(&notify, &a.node) == 0);
+    assert(notify.armed == 0);
+    assert(sc_sock_notify_push(&notify, &b.node) == 0);
+    assert(sc_sock_poll_wait(&poll, 100) == 1);
+    assert(sc_sock_poll_data(&poll, 0) == &notify);
+    assert(sc_sock_poll_event(&poll, 0) == SC_SOCK_READ);
+
+    sc_sock_notify_drain(&notify);
+    assert(sc_sock_notify_pop(&notify) == &a.node);
+    assert(sc_sock_notify_pop(&notify) == &b.node);
+    assert(sc_sock_notify_pop(&notify) == NULL);
+    assert(notify.armed == 1);
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+
+    /* Node pushed after the consumer sees an empty queue wakes it up */
+    assert(sc_sock_notify_push(&notify, &a.node) == 0);
+    assert(sc_sock_poll_wait(&poll, 100) == 1);
+    sc_sock_notify_drain(&notify);
+    assert(sc_sock_notify_pop(&notify) == &a.node);
+    assert(sc_sock_notify_pop(&notify) == NULL);
+
+    for (int i = 0; i < NOTIFY_THREADS; i++) {
+        ids[i] = i;
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], notify_producer, &ids[i]) == 0);
+    }
+
+    /* Per producer order must be kept */
+    while (total < NOTIFY_THREADS * NOTIFY_COUNT) {
+        n = sc_sock_poll_wait(&poll, 5000);
+        assert(n == 1);
+
+        sc_sock_notify_drain(&notify);
+        while ((node = sc_sock_notify_pop(&notify)) != NULL) {
+            msg = (struct notify_msg *) node;
+            assert(msg->seq == next[msg->producer]);
+            next[msg->producer]++;
+            total++;
+        }
+    }
+
+    for (int i = 0; i < NOTIFY_THREADS; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    assert(sc_sock_notify_pop(&notify) == NULL);
+    assert(sc_sock_notify_term(&notify) == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+
+#if !defined(_WIN32)
+    #include <signal.h>
+
+void test_signal(void)
+{
+    int a, b;
+    sigset_t cur, set;
+    struct sc_sock_poll poll;
+    struct sc_sock_signal sig;
+    int sigs[] = {SIGUSR1, SIGUSR2};
+    int bad[] = {-1};
+
+    assert(sc_sock_poll_init(&poll) == 0);
+    assert(sc_sock_signal_init(&sig, &poll, &sig, sigs, 0) == -1);
+    assert(strlen(sc_sock_signal_err(&sig)) > 0);
+    assert(sc_sock_signal_init(&sig, &poll, &sig, sigs,
+                               SC_SOCK_SIGNAL_MAX + 1) == -1);
+    assert(sc_sock_signal_init(&sig, &poll, &sig, bad, 1) == -1);
+
+    // SIGUSR2 is blocked already, it stays blocked after term.
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR2);
+    assert(sigprocmask(SIG_BLOCK, &set, NULL) == 0);
+
+    assert(sc_sock_signal_init(&sig, &poll, &sig, sigs, 2) == 0);
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+    assert(sc_sock_signal_read(&sig) == 0);
+
+    assert(raise(SIGUSR1) == 0);
+    assert(kill(getpid(), SIGUSR2) == 0);
+    assert(sc_sock_poll_wait(&poll, 1000) == 1);
+    assert(sc_sock_poll_data(&poll, 0) == &sig);
+    assert(sc_sock_poll_event(&poll, 0) == SC_SOCK_READ);
+
+    a = sc_sock_signal_read(&sig);
+    b = sc_sock_signal_read(&sig);
+    assert((a == SIGUSR1 && b == SIGUSR2) || (a == SIGUSR2 && b == SIGUSR1));
+    assert(sc_sock_signal_read(&sig) == 0);
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+
+    // Same signal before read is reported once.
+    assert(raise(SIGUSR1) == 0);
+    assert(raise(SIGUSR1) == 0);
+    assert(sc_sock_poll_wait(&poll, 1000) == 1);
+    assert(sc_sock_signal_read(&sig) == SIGUSR1);
+    assert(sc_sock_signal_read(&sig) == 0);
+
+    assert(sc_sock_signal_term(&sig) == 0);
+
+    #if defined(__linux__)
+    assert(sigprocmask(SIG_BLOCK, NULL, &cur) == 0);
+    assert(!sigismember(&cur, SIGUSR1));
+    assert(sigismember(&cur, SIGUSR2));
+    #else
+    (void) cur;
+    #endif
+    assert(sigprocmask(SIG_UNBLOCK, &set, NULL) == 0);
+
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+#else
+void test_signal(void)
+{
+}
+#endif
+
 void test_pipe(void)
 {
     char buf[5];
@@ -1412,6 +2098,117 @@ void *client(void *arg)
     return NULL;
 }
 
+#if defined(__linux__) && defined(SC_SOCK_HAVE_URING)
+void test_uring(void)
+{
+    int n, rc;
+    char buf[16] = {0};
+    char fixed[2][16] = {{0}};
+    struct iovec iov[2] = {{fixed[0], sizeof(fixed[0])},
+                           {fixed[1], sizeof(fixed[1])}};
+    struct sc_sock srv, cli, in;
+    struct sc_sock_uring u;
+
+    if (sc_sock_uring_init(&u, 4) != 0) {
+        printf("Skipping io_uring test : %s \n", sc_sock_uring_err(&u));
+        return;
+    }
+
+    assert(u.sq_entries == 4);
+    assert(sc_sock_uring_wait(&u, 0) == 0);
+    assert(sc_sock_uring_wait(&u, 10) == 0);
+
+    sc_sock_init(&srv, 0, true, SC_SOCK_INET);
+    sc_sock_init(&cli, 0, true, SC_SOCK_INET);
+    assert(sc_sock_listen(&srv, "127.0.0.1", "8012") == 0);
+
+    assert(sc_sock_uring_accept(&u, &srv, &srv) == 0);
+    assert(sc_sock_uring_submit(&u) == 1);
+    assert(sc_sock_connect(&cli, "127.0.0.1", "8012", NULL, NULL) == 0);
+    assert(sc_sock_uring_wait(&u, 1000) == 1);
+    assert(sc_sock_uring_data(&u, 0) == &srv);
+    rc = sc_sock_uring_result(&u, 0);
+    assert(rc >= 0);
+    assert(sc_sock_uring_accepted(&srv, &in, rc) == 0);
+    assert(sc_sock_uring_accepted(&srv, &cli, -EBADF) == SC_SOCK_ERROR);
+
+    /* Batch, single syscall submits both */
+    assert(sc_sock_uring_recv(&u, &in, buf, 5, 0, buf) == 0);
+    assert(sc_sock_uring_send(&u, &cli, "test", 5, 0, &cli) == 0);
+    assert(u.pending == 2);
+
+    n = 0;
+    while (n < 2) {
+        rc = sc_sock_uring_wait(&u, 1000);
+        assert(rc > 0);
+        for (int i = 0; i < rc; i++) {
+            assert(sc_sock_uring_result(&u, i) == 5);
+        }
+        n += rc;
+    }
+    assert(u.pending == 0);
+    assert(strcmp(buf, "test") == 0);
+
+    /* Registered buffers */
+    assert(sc_sock_uring_send_fixed(&u, &cli, 0, 0, 4, NULL) != 0);
+    assert(sc_sock_uring_register(&u, iov, 2) == 0);
+    assert(sc_sock_uring_register(&u, iov, 2) != 0);
+    assert(sc_sock_uring_send_fixed(&u, &cli, 2, 0, 4, NULL) != 0);
+    assert(sc_sock_uring_send_fixed(&u, &cli, 0, 10, 8, NULL) != 0);
+
+    memcpy(fixed[0], "fixed", 6);
+    assert(sc_sock_uring_send_fixed(&u, &cli, 0, 0, 6, &cli) == 0);
+    assert(sc_sock_uring_recv_fixed(&u, &in, 1, 2, 6, &in) == 0);
+
+    n = 0;
+    while (n < 2) {
+        rc = sc_sock_uring_wait(&u, 1000);
+        assert(rc > 0);
+        for (int i = 0; i < rc; i++) {
+            assert(sc_sock_uring_result(&u, i) == 6);
+        }
+        n += rc;
+    }
+    assert(strcmp(&fixed[1][2], "fixed") == 0);
+
+    /* Full submission queue is flushed to the kernel automatically */
+    for (int i = 0; i < 5; i++) {
+        assert(sc_sock_uring_send(&u, &cli, "x", 1, 0, NULL) == 0);
+    }
+    assert(u.pending == 1);
+
+    n = 0;
+    while (n < 5) {
+        rc = sc_sock_uring_wait(&u, 1000);
+        assert(rc > 0);
+        n += rc;
+    }
+
+    /* Peer close */
+    assert(sc_sock_uring_recv(&u, &in, buf, sizeof(buf), 0, NULL) == 0);
+    assert(sc_sock_uring_wait(&u, 1000) == 1);
+    assert(sc_sock_uring_result(&u, 0) == 5);
+    assert(sc_sock_term(&cli) == 0);
+    assert(sc_sock_uring_recv(&u, &in, buf, sizeof(buf), 0, NULL) == 0);
+    assert(sc_sock_uring_wait(&u, -1) == 1);
+    assert(sc_sock_uring_result(&u, 0) == 0);
+
+    assert(sc_sock_term(&in) == 0);
+    assert(sc_sock_term(&srv) == 0);
+    assert(sc_sock_uring_term(&u) == 0);
+
+#ifdef SC_HAVE_WRAP
+    fail_malloc = true;
+    assert(sc_sock_uring_init(&u, 4) != 0);
+    fail_malloc = false;
+#endif
+}
+#else
+void test_uring(void)
+{
+}
+#endif
+
 void test_poll()
 {
     struct sc_thread thread1;
@@ -1497,6 +2294,18 @@ int main()
     test_poll();
     test_err();
     test_poll_mass();
+    test_poll_flags();
+    test_uring();
+    test_reuseport();
+    test_vector();
+    test_batch();
+    test_sendfile();
+    test_poll_batch();
+    test_notify();
+    test_signal();
+    test_stats();
+    test_profile();
+    test_connect_addr();
 
 #if defined(_WIN32) || defined(_WIN64)
     rc = WSACleanup();
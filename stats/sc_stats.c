@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "sc_stats.h"
+
+#include <string.h>
+
+#if defined(_MSC_VER)
+    #define sc_stats_load_ptr(p) (*(void *volatile *) (p))
+    #define sc_stats_cas_int(p, old, v)                                        \
+        (_InterlockedCompareExchange((volatile long *) (p), (v), (old)) == (old))
+    #define sc_stats_cas_ptr(p, old, v)                                        \
+        (_InterlockedCompareExchangePointer((void *volatile *) (p), (v),       \
+                                            (old)) == (old))
+    #define sc_stats_store(p, v) _InterlockedExchange64((__int64 *) (p), (v))
+#else
+    #define sc_stats_load_ptr(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+    #define sc_stats_cas_int(p, old, v)                                        \
+        __atomic_compare_exchange_n(p, &(old), v, false, __ATOMIC_ACQ_REL,     \
+                                    __ATOMIC_RELAXED)
+    #define sc_stats_cas_ptr(p, old, v)                                        \
+        __atomic_compare_exchange_n(p, &(old), v, true, __ATOMIC_RELEASE,      \
+                                    __ATOMIC_RELAXED)
+    #define sc_stats_store(p, v) __atomic_store_n(p, v, __ATOMIC_RELAXED)
+#endif
+
+// Registered counters, new ones are pushed to the head, never removed.
+static struct sc_stats_counter *sc_stats_head;
+
+void sc_stats_register(struct sc_stats_counter *c)
+{
+    int unset = 0;
+    struct sc_stats_counter *head;
+
+    if (!sc_stats_cas_int(&c->registered, unset, 1)) {
+        return;
+    }
+
+    do {
+        head = sc_stats_load_ptr(&sc_stats_head);
+        c->next = head;
+    } while (!sc_stats_cas_ptr(&sc_stats_head, head, c));
+}
+
+// Value of the counters named as 'c', starting from 'c'.
+static uint64_t sc_stats_value(struct sc_stats_counter *c)
+{
+    uint64_t v, total = 0;
+    const char *name = c->name;
+    enum sc_stats_type type = c->type;
+
+    for (; c != NULL; c = c->next) {
+        if (strcmp(c->name, name) != 0) {
+            continue;
+        }
+
+        v = sc_stats_atomic_load(&c->value);
+        if (type == SC_STATS_TYPE_MAX) {
+            total = v > total ? v : total;
+        } else {
+            total += v;
+        }
+    }
+
+    return total;
+}
+
+uint64_t sc_stats_get(const char *name)
+{
+    struct sc_stats_counter *c = sc_stats_load_ptr(&sc_stats_head);
+
+    for (; c != NULL; c = c->next) {
+        if (strcmp(c->name, name) == 0) {
+            return sc_stats_value(c);
+        }
+    }
+
+    return 0;
+}
+
+void sc_stats_foreach(void *arg,
+                      void (*fn)(void *arg, const char *name, uint64_t value))
+{
+    struct sc_stats_counter *p;
+    struct sc_stats_counter *head = sc_stats_load_ptr(&sc_stats_head);
+
+    for (struct sc_stats_counter *c = head; c != NULL; c = c->next) {
+        // Report a name once, at its first counter.
+        for (p = head; p != c && strcmp(p->name, c->name) != 0; p = p->next) {
+        }
+
+        if (p == c) {
+            fn(arg, c->name, sc_stats_value(c));
+        }
+    }
+}
+
+static void sc_stats_print_fn(void *arg, const char *name, uint64_t value)
+{
+    fprintf(arg, "%-20s %llu\n", name, (unsigned long long) value);
+}
+
+void sc_stats_print(FILE *fp)
+{
+    sc_stats_foreach(fp, sc_stats_print_fn);
+}
+
+void sc_stats_reset(void)
+{
+    struct sc_stats_counter *c = sc_stats_load_ptr(&sc_stats_head);
+
+    for (; c != NULL; c = c->next) {
+        sc_stats_store(&c->value, 0);
+    }
+}
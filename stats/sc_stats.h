@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SC_STATS_H
+#define SC_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Process wide counters of internal events, e.g. map remaps, buffer reallocs,
+ * queue expansions. Modules count events only if they are compiled with
+ * -DSC_STATS, otherwise counting compiles to nothing and this module is not
+ * needed.
+ *
+ * Each call site of SC_STATS_ADD()/SC_STATS_MAX() owns a static counter,
+ * incremented with a relaxed atomic. A counter registers itself on its first
+ * event, so untouched counters cost nothing. Counters with the same name,
+ * e.g. the same macro in each map instantiation, are reported as one value :
+ * sum of SC_STATS_ADD() counters, max of SC_STATS_MAX() counters.
+ *
+ * Counter names :
+ *
+ *  map.remap        Table grow or rehash because of the load factor
+ *  map.lookup       Key lookups, puts included
+ *  map.probe        Extra slots visited by lookups, probe / lookup is the
+ *                   average probe length
+ *  map.probe_max    Longest probe
+ *  buf.realloc      sc_buf_reserve() reallocations
+ *  buf.compact      sc_buf_reserve() compactions
+ *  array.expand     sc_array grows
+ *  queue.expand     sc_queue grows
+ *  heap.expand      sc_heap grows
+ *  timer.expand     Timer wheel pool grows
+ *  log.drop         Records dropped by a full async log
+ *  sock.poll_wait   Poll wakeups
+ *  sock.poll_event  Events returned from poll
+ */
+
+enum sc_stats_type
+{
+    SC_STATS_TYPE_SUM,
+    SC_STATS_TYPE_MAX,
+};
+
+struct sc_stats_counter
+{
+    const char *name;
+    enum sc_stats_type type;
+    uint64_t value;
+    struct sc_stats_counter *next;
+    int registered;
+};
+
+// clang-format off
+#if defined(_MSC_VER)
+    #include <intrin.h>
+
+    #define sc_stats_atomic_load(p)       (*(volatile uint64_t *) (p))
+    #define sc_stats_atomic_load_int(p)   (*(volatile int *) (p))
+    #define sc_stats_atomic_add(p, n)                                          \
+        _InterlockedExchangeAdd64((volatile __int64 *) (p), (__int64) (n))
+    #define sc_stats_atomic_cas(p, old, v)                                     \
+        ((uint64_t) _InterlockedCompareExchange64((volatile __int64 *) (p),    \
+                                                  (__int64) (v),               \
+                                                  (__int64) (old)) == (old))
+#else
+    #define sc_stats_atomic_load(p)       __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_stats_atomic_load_int(p)   __atomic_load_n(p, __ATOMIC_ACQUIRE)
+    #define sc_stats_atomic_add(p, n)                                          \
+        __atomic_fetch_add(p, n, __ATOMIC_RELAXED)
+    #define sc_stats_atomic_cas(p, old, v)                                     \
+        __atomic_compare_exchange_n(p, &(old), v, true, __ATOMIC_RELAXED,      \
+                                    __ATOMIC_RELAXED)
+#endif
+// clang-format on
+
+/**
+ * Add counter to the registry, called on the first event of the counter.
+ * Thread-safe, a counter is registered once.
+ *
+ * @param c counter with static storage duration
+ */
+void sc_stats_register(struct sc_stats_counter *c);
+
+static inline void sc_stats_add(struct sc_stats_counter *c, uint64_t n)
+{
+    if (!sc_stats_atomic_load_int(&c->registered)) {
+        sc_stats_register(c);
+    }
+
+    sc_stats_atomic_add(&c->value, n);
+}
+
+static inline void sc_stats_max(struct sc_stats_counter *c, uint64_t v)
+{
+    uint64_t cur;
+
+    if (!sc_stats_atomic_load_int(&c->registered)) {
+        sc_stats_register(c);
+    }
+
+    cur = sc_stats_atomic_load(&c->value);
+    while (v > cur && !sc_stats_atomic_cas(&c->value, cur, v)) {
+        cur = sc_stats_atomic_load(&c->value);
+    }
+}
+
+// clang-format off
+#define SC_STATS_ADD(name, n)                                                  \
+    do {                                                                       \
+        static struct sc_stats_counter sc_stats_c_ = {                         \
+                name, SC_STATS_TYPE_SUM, 0, NULL, 0};                          \
+        sc_stats_add(&sc_stats_c_, (uint64_t) (n));                            \
+    } while (0)
+
+#define SC_STATS_MAX(name, v)                                                  \
+    do {                                                                       \
+        static struct sc_stats_counter sc_stats_c_ = {                         \
+                name, SC_STATS_TYPE_MAX, 0, NULL, 0};                          \
+        sc_stats_max(&sc_stats_c_, (uint64_t) (v));                            \
+    } while (0)
+// clang-format on
+
+/**
+ * @param name counter name
+ * @return     value of the counters with this name, '0' if there is none.
+ */
+uint64_t sc_stats_get(const char *name);
+
+/**
+ * Call 'fn' once for each counter name.
+ *
+ * @param arg user data to be passed to 'fn'
+ * @param fn  callback
+ */
+void sc_stats_foreach(void *arg,
+                      void (*fn)(void *arg, const char *name, uint64_t value));
+
+/**
+ * Print counters as "name value" lines, e.g. sc_stats_print(stdout).
+ *
+ * @param fp file
+ */
+void sc_stats_print(FILE *fp);
+
+/**
+ * Set all counters to zero. Events counted concurrently may be lost.
+ */
+void sc_stats_reset(void);
+
+#endif
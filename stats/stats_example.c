@@ -0,0 +1,25 @@
+#include "sc_stats.h"
+
+#include <stdio.h>
+
+static void lookup(int key)
+{
+    // Modules compiled with -DSC_STATS count their events the same way.
+    SC_STATS_ADD("example.lookup", 1);
+    SC_STATS_MAX("example.key_max", key);
+}
+
+int main()
+{
+    for (int i = 0; i < 100; i++) {
+        lookup(i);
+    }
+
+    printf("Lookups : %llu \n",
+           (unsigned long long) sc_stats_get("example.lookup"));
+
+    sc_stats_print(stdout);
+    sc_stats_reset();
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "sc_stats.h"
+
+#include "sc_array.h"
+#include "sc_buf.h"
+#include "sc_heap.h"
+#include "sc_map.h"
+#include "sc_queue.h"
+#include "sc_sock.h"
+#include "sc_timer.h"
+
+#include <assert.h>
+#include <string.h>
+
+void test_counter(void)
+{
+    sc_stats_reset();
+    assert(sc_stats_get("test.not_exists") == 0);
+
+    for (int i = 0; i < 10; i++) {
+        SC_STATS_ADD("test.add", 2);
+        SC_STATS_MAX("test.max", i);
+    }
+    assert(sc_stats_get("test.add") == 20);
+    assert(sc_stats_get("test.max") == 9);
+
+    // Another call site with the same name.
+    SC_STATS_ADD("test.add", 5);
+    SC_STATS_MAX("test.max", 4);
+    assert(sc_stats_get("test.add") == 25);
+    assert(sc_stats_get("test.max") == 9);
+
+    SC_STATS_MAX("test.max", 100);
+    assert(sc_stats_get("test.max") == 100);
+
+    sc_stats_reset();
+    assert(sc_stats_get("test.add") == 0);
+    assert(sc_stats_get("test.max") == 0);
+    SC_STATS_ADD("test.add", 1);
+    assert(sc_stats_get("test.add") == 1);
+}
+
+static void count_fn(void *arg, const char *name, uint64_t value)
+{
+    int *count = arg;
+
+    if (strcmp(name, "test.foreach") == 0) {
+        assert(value == 3);
+        count[0]++;
+    }
+
+    count[1]++;
+}
+
+void test_foreach(void)
+{
+    int count[2] = {0};
+
+    sc_stats_reset();
+    SC_STATS_ADD("test.foreach", 1);
+    SC_STATS_ADD("test.foreach", 2);
+
+    sc_stats_foreach(count, count_fn);
+    assert(count[0] == 1);
+    assert(count[1] >= 1);
+
+    sc_stats_print(stdout);
+}
+
+void test_map(void)
+{
+    struct sc_map_64 map;
+
+    sc_stats_reset();
+    assert(sc_map_init_64(&map, 0, 0));
+    for (uint64_t i = 1; i <= 1000; i++) {
+        assert(sc_map_put_64(&map, i, i));
+    }
+
+    assert(sc_stats_get("map.remap") > 0);
+    assert(sc_stats_get("map.lookup") >= 1000);
+    assert(sc_stats_get("map.probe_max") <= sc_stats_get("map.probe"));
+    sc_map_term_64(&map);
+}
+
+void test_buf(void)
+{
+    struct sc_buf buf;
+    char tmp[100] = {0};
+
+    sc_stats_reset();
+    assert(sc_buf_init(&buf, 100));
+    for (int i = 0; i < 100; i++) {
+        sc_buf_put_raw(&buf, tmp, sizeof(tmp));
+    }
+    assert(sc_buf_valid(&buf));
+    assert(sc_stats_get("buf.realloc") > 0);
+
+    // Reading frees space at the start, next reserve compacts.
+    sc_buf_clear(&buf);
+    sc_buf_put_raw(&buf, tmp, sizeof(tmp));
+    sc_buf_mark_read(&buf, sizeof(tmp) - 1);
+    while (sc_buf_quota(&buf) >= sizeof(tmp)) {
+        sc_buf_put_raw(&buf, tmp, sizeof(tmp));
+        sc_buf_mark_read(&buf, sizeof(tmp));
+    }
+    sc_buf_put_raw(&buf, tmp, sizeof(tmp));
+    assert(sc_stats_get("buf.compact") > 0);
+    sc_buf_term(&buf);
+}
+
+void test_containers(void)
+{
+    int *arr, *queue;
+    struct sc_heap heap;
+
+    sc_stats_reset();
+
+    sc_array_create(arr, 0);
+    for (int i = 0; i < 100; i++) {
+        sc_array_add(arr, i);
+    }
+    assert(sc_stats_get("array.expand") > 0);
+    sc_array_destroy(arr);
+
+    sc_queue_create(queue, 0);
+    for (int i = 0; i < 100; i++) {
+        sc_queue_add_last(queue, i);
+    }
+    assert(sc_stats_get("queue.expand") > 0);
+    sc_queue_destroy(queue);
+
+    assert(sc_heap_init(&heap, 0));
+    for (int i = 0; i < 100; i++) {
+        assert(sc_heap_add(&heap, i, NULL));
+    }
+    assert(sc_stats_get("heap.expand") > 0);
+    sc_heap_term(&heap);
+}
+
+void test_timer(void)
+{
+    struct sc_timer timer;
+
+    sc_stats_reset();
+    assert(sc_timer_init(&timer, 0));
+    for (int i = 0; i < 1000; i++) {
+        assert(sc_timer_add(&timer, 100, 0, NULL) != SC_TIMER_INVALID);
+    }
+    assert(sc_stats_get("timer.expand") > 0);
+    sc_timer_term(&timer);
+}
+
+void test_poll(void)
+{
+    struct sc_sock_poll poll;
+
+    sc_stats_reset();
+    assert(sc_sock_poll_init(&poll) == 0);
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+    assert(sc_sock_poll_wait(&poll, 0) == 0);
+    assert(sc_stats_get("sock.poll_wait") == 2);
+    assert(sc_stats_get("sock.poll_event") == 0);
+    assert(sc_sock_poll_term(&poll) == 0);
+}
+
+int main(void)
+{
+    test_counter();
+    test_foreach();
+    test_map();
+    test_buf();
+    test_containers();
+    test_timer();
+    test_poll();
+
+    return 0;
+}
@@ -30,18 +30,42 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef SC_STR_HAVE_SCAN
+    #include "sc_scan.h"
+#endif
+
+// clang-format off
+
+#if !defined(SC_STR_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) ||       \
+                                 (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define SC_STR_SSE2
+    #include <emmintrin.h>
+#elif !defined(SC_STR_NO_SIMD) && defined(__aarch64__)
+    #define SC_STR_NEON
+    #include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+// clang-format on
+
 /**
- * String with 'length' at the start of the allocated memory
+ * String with 'capacity' and 'length' at the start of the allocated memory
  *  e.g :
- *  -----------------------------------------------
- *  | 0 | 0 | 0 | 4 | 'T' | 'E' | 'S' | 'T' | '\0'|
- *  -----------------------------------------------
+ *  -----------------------------------------------------------------
+ *  | 0 | 0 | 0 | 4 | 0 | 0 | 0 | 4 | 'T' | 'E' | 'S' | 'T' | '\0'|
+ *  -----------------------------------------------------------------
  *
  *  User can keep pointer to first character, so it's like C style strings with
  *  additional functionality when it's used with these functions here.
+ *  Capacity excludes '\0'. Strings are created with exact size, capacity
+ *  grows geometrically on append.
  */
 struct sc_str
 {
+    uint32_t cap;
     uint32_t len;
     char buf[];
 };
@@ -81,6 +105,7 @@ char *sc_str_create_len(const char *str, uint32_t len)
 
     memcpy(copy->buf, str, len);
     copy->buf[len] = '\0';
+    copy->cap = len;
     copy->len = len;
 
     return copy->buf;
@@ -105,13 +130,14 @@ char *sc_str_create_va(const char *fmt, va_list va)
         return NULL;
     }
 
+    str->cap = (uint32_t) rc;
     str->len = (uint32_t) rc;
 
     if (rc < (int) sizeof(tmp)) {
         memcpy(str->buf, tmp, str->len + 1);
     } else {
         va_copy(args, va);
-        rc = vsnprintf(str->buf, str->len, fmt, args);
+        rc = vsnprintf(str->buf, str->len + 1, fmt, args);
         va_end(args);
 
         if (rc < 0 || (uint32_t) rc > str->len) {
@@ -192,31 +218,332 @@ bool sc_str_set_fmt(char **str, const char *fmt, ...)
     return ret != NULL;
 }
 
-bool sc_str_append(char **str, const char *param)
+// Makes sure there is capacity for 'len' characters, grows geometrically.
+static bool sc_str_grow(struct sc_str **meta, uint64_t len)
+{
+    uint64_t cap;
+    struct sc_str *tmp;
+
+    if (len <= (*meta)->cap) {
+        return true;
+    }
+
+    if (len > SC_SIZE_MAX) {
+        return false;
+    }
+
+    cap = (uint64_t) (*meta)->cap * 2;
+    cap = cap < len ? len : cap;
+    cap = cap > SC_SIZE_MAX ? SC_SIZE_MAX : cap;
+
+    tmp = sc_str_realloc(*meta, sc_str_bytes(cap));
+    if (tmp == NULL) {
+        return false;
+    }
+
+    tmp->cap = (uint32_t) cap;
+    *meta = tmp;
+
+    return true;
+}
+
+bool sc_str_reserve(char **str, uint32_t cap)
 {
-    size_t len, alloc;
     struct sc_str *meta;
 
     if (*str == NULL) {
-        return (*str = sc_str_create(param)) != NULL;
+        if ((*str = sc_str_create_len("", 0)) == NULL) {
+            return false;
+        }
     }
 
     meta = sc_str_meta(*str);
-    len = strlen(param);
-    alloc = sc_str_bytes(meta->len + len);
+    if (cap <= meta->cap) {
+        return true;
+    }
+
+    if (cap > SC_SIZE_MAX) {
+        return false;
+    }
+
+    meta = sc_str_realloc(meta, sc_str_bytes(cap));
+    if (meta == NULL) {
+        return false;
+    }
+
+    meta->cap = cap;
+    *str = meta->buf;
+
+    return true;
+}
 
-    if (alloc > SC_SIZE_MAX || (meta = sc_str_realloc(meta, alloc)) == NULL) {
+uint32_t sc_str_cap(const char *str)
+{
+    return sc_str_meta(str)->cap;
+}
+
+bool sc_str_append_len(char **str, const char *text, uint32_t len)
+{
+    struct sc_str *meta;
+
+    if (*str == NULL) {
+        return (*str = sc_str_create_len(text, len)) != NULL;
+    }
+
+    meta = sc_str_meta(*str);
+    if (!sc_str_grow(&meta, (uint64_t) meta->len + len)) {
         return false;
     }
 
-    memcpy(&meta->buf[meta->len], param, len);
-    meta->len += (uint32_t) len;
+    memcpy(&meta->buf[meta->len], text, len);
+    meta->len += len;
     meta->buf[meta->len] = '\0';
     *str = meta->buf;
 
     return true;
 }
 
+bool sc_str_append(char **str, const char *param)
+{
+    size_t len;
+
+    if (*str == NULL) {
+        return (*str = sc_str_create(param)) != NULL;
+    }
+
+    len = strlen(param);
+    if (len > SC_SIZE_MAX) {
+        return false;
+    }
+
+    return sc_str_append_len(str, param, (uint32_t) len);
+}
+
+// Formats into spare capacity of 'meta', grows and formats again if needed.
+static bool sc_str_append_va(struct sc_str **meta, const char *fmt, va_list va)
+{
+    int rc;
+    va_list args;
+    struct sc_str *m = *meta;
+
+    va_copy(args, va);
+    rc = vsnprintf(m->buf + m->len, (size_t) m->cap - m->len + 1, fmt, args);
+    va_end(args);
+
+    if (rc < 0) {
+        goto error;
+    }
+
+    if ((uint32_t) rc > m->cap - m->len) {
+        if (!sc_str_grow(&m, (uint64_t) m->len + (uint32_t) rc)) {
+            goto error;
+        }
+
+        *meta = m;
+
+        va_copy(args, va);
+        rc = vsnprintf(m->buf + m->len, (size_t) m->cap - m->len + 1, fmt,
+                       args);
+        va_end(args);
+
+        if (rc < 0 || (uint32_t) rc > m->cap - m->len) {
+            goto error;
+        }
+    }
+
+    m->len += (uint32_t) rc;
+
+    return true;
+
+error:
+    m->buf[m->len] = '\0';
+    return false;
+}
+
+bool sc_str_append_fmt(char **str, const char *fmt, ...)
+{
+    bool rc;
+    va_list args;
+    struct sc_str *meta;
+
+    va_start(args, fmt);
+
+    if (*str == NULL) {
+        rc = (*str = sc_str_create_va(fmt, args)) != NULL;
+    } else {
+        meta = sc_str_meta(*str);
+        rc = sc_str_append_va(&meta, fmt, args);
+        *str = meta->buf;
+    }
+
+    va_end(args);
+
+    return rc;
+}
+
+void sc_str_builder_init(struct sc_str_builder *b)
+{
+    b->str = NULL;
+    b->len = 0;
+    b->oom = false;
+    b->buf[0] = '\0';
+}
+
+void sc_str_builder_term(struct sc_str_builder *b)
+{
+    sc_str_destroy(b->str);
+    sc_str_builder_init(b);
+}
+
+void sc_str_builder_reset(struct sc_str_builder *b)
+{
+    b->len = 0;
+    b->oom = false;
+    b->buf[0] = '\0';
+
+    if (b->str != NULL) {
+        sc_str_meta(b->str)->len = 0;
+        b->str[0] = '\0';
+    }
+}
+
+// Moves to heap storage when inline storage is not enough.
+static bool sc_str_builder_heap(struct sc_str_builder *b, uint64_t len)
+{
+    char *str;
+
+    if (b->oom) {
+        return false;
+    }
+
+    if (b->str == NULL) {
+        if (len < SC_STR_BUILDER_INLINE) {
+            return true;
+        }
+
+        str = sc_str_create_len(b->buf, b->len);
+        if (str == NULL || !sc_str_reserve(&str, SC_STR_BUILDER_INLINE * 2)) {
+            sc_str_destroy(str);
+            b->oom = true;
+            return false;
+        }
+
+        b->str = str;
+    }
+
+    return true;
+}
+
+void sc_str_builder_add_len(struct sc_str_builder *b, const char *text,
+                            uint32_t len)
+{
+    if (!sc_str_builder_heap(b, (uint64_t) b->len + len)) {
+        return;
+    }
+
+    if (b->str == NULL) {
+        memcpy(b->buf + b->len, text, len);
+        b->len += len;
+        b->buf[b->len] = '\0';
+        return;
+    }
+
+    if (!sc_str_append_len(&b->str, text, len)) {
+        b->oom = true;
+        return;
+    }
+
+    b->len = sc_str_meta(b->str)->len;
+}
+
+void sc_str_builder_add(struct sc_str_builder *b, const char *text)
+{
+    size_t len = strlen(text);
+
+    if (len > SC_SIZE_MAX) {
+        b->oom = true;
+        return;
+    }
+
+    sc_str_builder_add_len(b, text, (uint32_t) len);
+}
+
+void sc_str_builder_add_char(struct sc_str_builder *b, char c)
+{
+    sc_str_builder_add_len(b, &c, 1);
+}
+
+void sc_str_builder_add_fmt(struct sc_str_builder *b, const char *fmt, ...)
+{
+    int rc;
+    bool ret;
+    va_list args;
+    struct sc_str *meta;
+
+    if (b->oom) {
+        return;
+    }
+
+    if (b->str == NULL) {
+        va_start(args, fmt);
+        rc = vsnprintf(b->buf + b->len, SC_STR_BUILDER_INLINE - b->len, fmt,
+                       args);
+        va_end(args);
+
+        if (rc < 0) {
+            b->buf[b->len] = '\0';
+            b->oom = true;
+            return;
+        }
+
+        if ((uint32_t) rc < SC_STR_BUILDER_INLINE - b->len) {
+            b->len += (uint32_t) rc;
+            return;
+        }
+
+        b->buf[b->len] = '\0';
+        if (!sc_str_builder_heap(b, (uint64_t) b->len + (uint32_t) rc)) {
+            return;
+        }
+    }
+
+    meta = sc_str_meta(b->str);
+
+    va_start(args, fmt);
+    ret = sc_str_append_va(&meta, fmt, args);
+    va_end(args);
+
+    b->str = meta->buf;
+    b->len = meta->len;
+    b->oom = !ret;
+}
+
+const char *sc_str_builder_cstr(struct sc_str_builder *b)
+{
+    return b->str != NULL ? b->str : b->buf;
+}
+
+char *sc_str_builder_finish(struct sc_str_builder *b)
+{
+    char *str;
+
+    if (b->oom) {
+        sc_str_builder_reset(b);
+        return NULL;
+    }
+
+    if (b->str == NULL) {
+        str = sc_str_create_len(b->buf, b->len);
+    } else {
+        str = b->str;
+        b->str = NULL;
+    }
+
+    sc_str_builder_reset(b);
+
+    return str;
+}
+
 bool sc_str_cmp(const char *str, const char *other)
 {
     struct sc_str *s1 = sc_str_meta(str);
@@ -252,7 +579,16 @@ const char *sc_str_token_begin(char *str, char **save, const char *delim)
         it++;
     }
 
+#ifdef SC_STR_HAVE_SCAN
+    struct sc_scan_set set;
+    char *end = str + sc_str_meta(str)->len;
+
+    // Terminator is in the set, stops at an embedded '\0' like strcspn().
+    sc_scan_set_init(&set, delim, strlen(delim) + 1);
+    *save = it + sc_scan_find(&set, it, (size_t) (end - it));
+#else
     *save = it + strcspn(it, delim);
+#endif
     swap(str, *save);
 
     return it;
@@ -274,6 +610,191 @@ void sc_str_token_end(char *str, char **save)
     swap(str, (save != NULL && *save != NULL) ? *save : str + strlen(str));
 }
 
+struct sc_str_view sc_str_view(const char *str)
+{
+    struct sc_str_view view = {NULL, 0};
+
+    if (str != NULL) {
+        view.ptr = str;
+        view.len = sc_str_meta(str)->len;
+    }
+
+    return view;
+}
+
+struct sc_str_view sc_str_view_len(const char *ptr, uint32_t len)
+{
+    struct sc_str_view view = {ptr, len};
+    return view;
+}
+
+char *sc_str_create_view(struct sc_str_view view)
+{
+    return sc_str_create_len(view.ptr, view.len);
+}
+
+bool sc_str_cmp_view(const char *str, struct sc_str_view view)
+{
+    struct sc_str *s = sc_str_meta(str);
+
+    return s->len == view.len && !memcmp(s->buf, view.ptr, view.len);
+}
+
+bool sc_str_view_cmp(struct sc_str_view view, struct sc_str_view other)
+{
+    return view.len == other.len && !memcmp(view.ptr, other.ptr, view.len);
+}
+
+void sc_str_tokenizer_init(struct sc_str_tokenizer *t, struct sc_str_view src,
+                           const char *delim)
+{
+    unsigned char c;
+
+    *t = (struct sc_str_tokenizer){
+            .pos = src.ptr,
+            .end = src.ptr,
+            .done = src.ptr == NULL,
+    };
+
+    if (src.ptr != NULL) {
+        t->end += src.len;
+    }
+
+    for (; *delim != '\0'; delim++) {
+        c = (unsigned char) *delim;
+        if (t->map[c >> 5u] & (1u << (c & 31u))) {
+            continue;
+        }
+
+        t->map[c >> 5u] |= (1u << (c & 31u));
+        if (t->count < SC_STR_TOKEN_SIMD) {
+            t->delim[t->count] = (char) c;
+        }
+        t->count++;
+    }
+}
+
+static inline uint32_t sc_str_ctz(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t) __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (uint32_t) index;
+#else
+    uint32_t n = 0;
+
+    while ((mask & 1u) == 0) {
+        mask >>= 1u;
+        n++;
+    }
+
+    return n;
+#endif
+}
+
+/**
+ * Finds first delimiter in [p, end), returns 'end' if there is none.
+ */
+static const char *sc_str_tokenizer_find(struct sc_str_tokenizer *t,
+                                         const char *p, const char *end)
+{
+    unsigned char c;
+
+    if (t->count == 1) {
+        const char *d = memchr(p, t->delim[0], (size_t) (end - p));
+        return d != NULL ? d : end;
+    }
+
+#if defined(SC_STR_SSE2)
+    if (t->count <= SC_STR_TOKEN_SIMD) {
+        __m128i d[SC_STR_TOKEN_SIMD];
+
+        for (uint32_t i = 0; i < t->count; i++) {
+            d[i] = _mm_set1_epi8(t->delim[i]);
+        }
+
+        while (end - p >= 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *) (const void *) p);
+            __m128i m = _mm_cmpeq_epi8(v, d[0]);
+            uint32_t mask;
+
+            for (uint32_t i = 1; i < t->count; i++) {
+                m = _mm_or_si128(m, _mm_cmpeq_epi8(v, d[i]));
+            }
+
+            mask = (uint32_t) _mm_movemask_epi8(m);
+            if (mask != 0) {
+                return p + sc_str_ctz(mask);
+            }
+
+            p += 16;
+        }
+    }
+#elif defined(SC_STR_NEON)
+    if (t->count <= SC_STR_TOKEN_SIMD) {
+        uint8x16_t d[SC_STR_TOKEN_SIMD];
+
+        for (uint32_t i = 0; i < t->count; i++) {
+            d[i] = vdupq_n_u8((uint8_t) t->delim[i]);
+        }
+
+        while (end - p >= 16) {
+            uint8x16_t v = vld1q_u8((const uint8_t *) p);
+            uint8x16_t m = vceqq_u8(v, d[0]);
+            uint64_t mask;
+
+            for (uint32_t i = 1; i < t->count; i++) {
+                m = vorrq_u8(m, vceqq_u8(v, d[i]));
+            }
+
+            // Narrow to 4 bits per byte.
+            mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(
+                                         vreinterpretq_u16_u8(m), 4)),
+                                 0);
+            if (mask != 0) {
+                return p + (__builtin_ctzll(mask) >> 2u);
+            }
+
+            p += 16;
+        }
+    }
+#endif
+
+    for (; p < end; p++) {
+        c = (unsigned char) *p;
+        if (t->map[c >> 5u] & (1u << (c & 31u))) {
+            return p;
+        }
+    }
+
+    return end;
+}
+
+bool sc_str_tokenizer_next(struct sc_str_tokenizer *t,
+                           struct sc_str_view *token)
+{
+    const char *d;
+
+    if (t->done) {
+        return false;
+    }
+
+    d = t->count == 0 ? t->end : sc_str_tokenizer_find(t, t->pos, t->end);
+
+    token->ptr = t->pos;
+    token->len = (uint32_t) (d - t->pos);
+
+    if (d == t->end) {
+        t->done = true;
+    } else {
+        t->pos = d + 1;
+    }
+
+    return true;
+}
+
 bool sc_str_trim(char **str, const char *list)
 {
     size_t len;
@@ -333,80 +854,377 @@ bool sc_str_substring(char **str, uint32_t start, uint32_t end)
     return true;
 }
 
+// Replace pattern, lengths are calculated once.
+struct sc_str_pattern
+{
+    const char *rep;
+    const char *with;
+    uint32_t rep_len;
+    uint32_t with_len;
+};
+
+struct sc_str_match
+{
+    uint32_t pos;
+    uint32_t idx;
+};
+
+/**
+ * Find the first match at or after 'pos'. Single pattern search jumps to the
+ * candidates with memchr(). Multiple pattern search checks a first byte map,
+ * the first pattern in the list wins if more than one matches at a position.
+ *
+ * @return match position, -1 if not found.
+ */
+static int64_t sc_str_find(const char *s, uint32_t pos, uint32_t len,
+                           const struct sc_str_pattern *p, uint32_t n,
+                           const bool *first, uint32_t *idx)
+{
+    const char *c;
+
+    if (n == 1) {
+        while (len - pos >= p->rep_len) {
+            c = memchr(s + pos, p->rep[0], len - pos - p->rep_len + 1);
+            if (c == NULL) {
+                return -1;
+            }
+
+            pos = (uint32_t) (c - s);
+            if (memcmp(c + 1, p->rep + 1, p->rep_len - 1) == 0) {
+                *idx = 0;
+                return pos;
+            }
+            pos++;
+        }
+
+        return -1;
+    }
+
+    for (; pos < len; pos++) {
+        if (!first[(unsigned char) s[pos]]) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            if (p[i].rep_len <= len - pos && p[i].rep[0] == s[pos] &&
+                memcmp(s + pos, p[i].rep, p[i].rep_len) == 0) {
+                *idx = i;
+                return pos;
+            }
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Replaces in a single pass, match offsets are recorded in a small buffer and
+ * the result is created with a single allocation. If every pattern has the
+ * same length as its replacement, string is modified in place.
+ */
+static bool sc_str_replace_patterns(char **str, const struct sc_str_pattern *p,
+                                    uint32_t n)
+{
+    bool in_place = true;
+    bool first[256] = {false};
+    int64_t pos;
+    uint32_t idx, cap, count = 0, start = 0;
+    uint64_t size;
+    char *dest;
+    struct sc_str *res;
+    struct sc_str_match stack[64], *matches = stack, *tmp;
+    struct sc_str *meta = sc_str_meta(*str);
+
+    for (uint32_t i = 0; i < n; i++) {
+        first[(unsigned char) p[i].rep[0]] = true;
+        in_place &= (p[i].rep_len == p[i].with_len);
+    }
+
+    if (in_place) {
+        while ((pos = sc_str_find(*str, start, meta->len, p, n, first, &idx)) !=
+               -1) {
+            memcpy(*str + pos, p[idx].with, p[idx].with_len);
+            start = (uint32_t) pos + p[idx].rep_len;
+        }
+
+        return true;
+    }
+
+    cap = sizeof(stack) / sizeof(stack[0]);
+    size = meta->len;
+
+    while ((pos = sc_str_find(*str, start, meta->len, p, n, first, &idx)) !=
+           -1) {
+        if (count == cap) {
+            tmp = sc_str_realloc(matches == stack ? NULL : matches,
+                                 sizeof(*matches) * cap * 2);
+            if (tmp == NULL) {
+                goto error;
+            }
+
+            if (matches == stack) {
+                memcpy(tmp, stack, sizeof(stack));
+            }
+
+            matches = tmp;
+            cap *= 2;
+        }
+
+        size = size - p[idx].rep_len + p[idx].with_len;
+        if (size > SC_SIZE_MAX) {
+            goto error;
+        }
+
+        matches[count++] = (struct sc_str_match){.pos = (uint32_t) pos,
+                                                 .idx = idx};
+        start = (uint32_t) pos + p[idx].rep_len;
+    }
+
+    // No match.
+    if (count == 0) {
+        return true;
+    }
+
+    res = sc_str_malloc(sc_str_bytes(size));
+    if (res == NULL) {
+        goto error;
+    }
+
+    res->len = (uint32_t) size;
+    dest = res->buf;
+    start = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const struct sc_str_pattern *m = &p[matches[i].idx];
+
+        memcpy(dest, *str + start, matches[i].pos - start);
+        dest += matches[i].pos - start;
+        memcpy(dest, m->with, m->with_len);
+        dest += m->with_len;
+        start = matches[i].pos + m->rep_len;
+    }
+
+    memcpy(dest, *str + start, meta->len - start + 1);
+
+    if (matches != stack) {
+        sc_str_free(matches);
+    }
+
+    sc_str_destroy(*str);
+    *str = res->buf;
+
+    return true;
+
+error:
+    if (matches != stack) {
+        sc_str_free(matches);
+    }
+
+    return false;
+}
+
 bool sc_str_replace(char **str, const char *replace, const char *with)
 {
+    size_t replace_len, with_len;
+    struct sc_str_pattern p;
+
     assert(replace != NULL && with != NULL);
 
     if (*str == NULL) {
         return true;
     }
 
-    size_t replace_len = strlen(replace);
-    size_t with_len = strlen(with);
-    int64_t diff;
-    size_t len_unmatch;
-    size_t count, size;
-    struct sc_str *dest;
-    struct sc_str *meta = sc_str_meta(*str);
-    char *orig = *str;
-    char *orig_end = *str + meta->len;
-    char *tmp;
+    replace_len = strlen(replace);
+    with_len = strlen(with);
 
     if (replace_len >= UINT32_MAX || with_len >= UINT32_MAX) {
         return false;
     }
 
-    diff = (int64_t) with_len - (int64_t) replace_len;
+    if (replace_len == 0) {
+        return true;
+    }
 
-    // Fast path, same size replacement.
-    if (diff == 0) {
-        while ((orig = strstr(orig, replace)) != NULL) {
-            memcpy(orig, with, replace_len);
-            orig += replace_len;
-        }
+    p = (struct sc_str_pattern){.rep = replace,
+                                .with = with,
+                                .rep_len = (uint32_t) replace_len,
+                                .with_len = (uint32_t) with_len};
 
+    return sc_str_replace_patterns(str, &p, 1);
+}
+
+bool sc_str_replace_multi(char **str, const char *const *replace,
+                          const char *const *with, uint32_t count)
+{
+    size_t replace_len, with_len;
+    uint32_t n = 0;
+    struct sc_str_pattern p[SC_STR_REPLACE_MAX];
+
+    if (*str == NULL) {
         return true;
     }
 
-    // Calculate new string size.
-    tmp = orig;
-    size = meta->len;
-    for (count = 0; (tmp = strstr(tmp, replace)) != NULL; count++) {
-        tmp += replace_len;
-        // Check overflow.
-        if ((int64_t) size > (int64_t) SC_SIZE_MAX - diff) {
+    if (count > SC_STR_REPLACE_MAX) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        assert(replace[i] != NULL && with[i] != NULL);
+
+        replace_len = strlen(replace[i]);
+        with_len = strlen(with[i]);
+
+        if (replace_len >= UINT32_MAX || with_len >= UINT32_MAX) {
             return false;
         }
-        size += diff;
+
+        if (replace_len == 0) {
+            continue;
+        }
+
+        p[n++] = (struct sc_str_pattern){.rep = replace[i],
+                                         .with = with[i],
+                                         .rep_len = (uint32_t) replace_len,
+                                         .with_len = (uint32_t) with_len};
     }
 
-    // No match.
-    if (count == 0) {
+    if (n == 0) {
         return true;
     }
 
-    dest = sc_str_malloc(sc_str_bytes(size));
-    if (!dest) {
-        return false;
+    return sc_str_replace_patterns(str, p, n);
+}
+
+#ifdef SC_STR_HAVE_MAP
+
+/**
+ * Arena block, interned strings are placed back to back as struct sc_str,
+ * aligned to four bytes for the header.
+ */
+struct sc_str_block
+{
+    struct sc_str_block *next;
+    size_t cap;
+    size_t used;
+    char mem[];
+};
+
+#define sc_str_align(n) (((n) + 3) & ~(size_t) 3)
+
+bool sc_str_intern_init(struct sc_str_intern *pool)
+{
+    pool->blocks = NULL;
+    pool->mem = 0;
+
+    return sc_map_init_lsv(&pool->map, 0, 0);
+}
+
+void sc_str_intern_term(struct sc_str_intern *pool)
+{
+    struct sc_str_block *block = pool->blocks, *next;
+
+    while (block != NULL) {
+        next = block->next;
+        sc_str_free(block);
+        block = next;
     }
 
-    dest->len = (uint32_t) size;
-    tmp = dest->buf;
+    sc_map_term_lsv(&pool->map);
+    pool->blocks = NULL;
+    pool->mem = 0;
+}
 
-    while (count--) {
-        len_unmatch = strstr(orig, replace) - orig;
-        memcpy(tmp, orig, len_unmatch);
-        tmp += len_unmatch;
+static struct sc_str_block *sc_str_intern_block(struct sc_str_intern *pool,
+                                                size_t size)
+{
+    size_t cap;
+    struct sc_str_block *block = pool->blocks;
 
-        memcpy(tmp, with, with_len);
-        tmp += with_len;
-        orig += len_unmatch + replace_len;
+    if (block != NULL && block->cap - block->used >= size) {
+        return block;
     }
 
-    memcpy(tmp, orig, orig_end - orig + 1);
+    // Large strings get a block of their own, placed after the current block
+    // so the free space in the current block is not wasted.
+    cap = size > SC_STR_INTERN_BLOCK / 4 ? size : SC_STR_INTERN_BLOCK;
 
-    sc_str_destroy(*str);
-    *str = dest->buf;
+    block = sc_str_malloc(sizeof(*block) + cap);
+    if (block == NULL) {
+        return NULL;
+    }
 
-    return true;
+    block->cap = cap;
+    block->used = 0;
+    pool->mem += sizeof(*block) + cap;
+
+    if (cap == size && pool->blocks != NULL) {
+        block->next = pool->blocks->next;
+        pool->blocks->next = block;
+    } else {
+        block->next = pool->blocks;
+        pool->blocks = block;
+    }
+
+    return block;
+}
+
+const char *sc_str_intern_len(struct sc_str_intern *pool, const char *str,
+                              uint32_t len)
+{
+    size_t size;
+    void *found;
+    struct sc_str *s;
+    struct sc_str_block *block;
+
+    if (str == NULL || len > SC_SIZE_MAX) {
+        return NULL;
+    }
+
+    if (sc_map_get_lsv(&pool->map, str, len, &found)) {
+        return found;
+    }
+
+    size = sc_str_align(sc_str_bytes(len));
+
+    block = sc_str_intern_block(pool, size);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    s = (struct sc_str *) (block->mem + block->used);
+    s->cap = len;
+    s->len = len;
+    memcpy(s->buf, str, len);
+    s->buf[len] = '\0';
+
+    if (!sc_map_put_lsv(&pool->map, s->buf, len, s->buf)) {
+        return NULL;
+    }
+
+    block->used += size;
+
+    return s->buf;
+}
+
+const char *sc_str_intern(struct sc_str_intern *pool, const char *str)
+{
+    size_t size;
+
+    if (str == NULL || (size = strlen(str)) > SC_SIZE_MAX) {
+        return NULL;
+    }
+
+    return sc_str_intern_len(pool, str, (uint32_t) size);
 }
+
+uint32_t sc_str_intern_count(struct sc_str_intern *pool)
+{
+    return sc_map_size_lsv(&pool->map);
+}
+
+uint64_t sc_str_intern_mem(struct sc_str_intern *pool)
+{
+    return pool->mem;
+}
+
+#endif
@@ -38,13 +38,14 @@
 #endif
 
 /**
- * length prefixed C strings, length is at the start of the allocated memory
+ * length prefixed C strings, capacity and length are at the start of the
+ * allocated memory
  *  e.g :
- *  -----------------------------------------------
- *  | 0 | 0 | 0 | 4 | 'T' | 'E' | 'S' | 'T' | '\0'|
- *  -----------------------------------------------
- *                    ^
- *                  return
+ *  -----------------------------------------------------------------
+ *  | 0 | 0 | 0 | 4 | 0 | 0 | 0 | 4 | 'T' | 'E' | 'S' | 'T' | '\0'|
+ *  -----------------------------------------------------------------
+ *                                    ^
+ *                                  return
  *  User can keep pointer to first character, so it's like C style strings with
  *  additional functionality when it's used with these functions here.
  */
@@ -117,13 +118,41 @@ bool sc_str_set_fmt(char **str, const char *fmt, ...);
 bool sc_str_append(char **str, const char *text);
 
 /**
- * @param str pointer to length prefixed string. (char**).'*str' may change.
+ * Append formatted string. Formats directly into spare capacity if possible.
+ *
+ * @param str pointer to length prefixed string, '*str' may change. If '*str'
+ *            is NULL, a new string is created.
  * @param fmt format
  * @param ... arguments
- * @return    'true' on success, 'false' on out of memory or if '*str' is NULL.
+ * @return    'true' on success, 'false' on out of memory
+ */
+bool sc_str_append_fmt(char **str, const char *fmt, ...);
+
+/**
+ * @param str  pointer to length prefixed string, '*str' may change. If '*str'
+ *             is NULL, a new string is created.
+ * @param text text to append, no need for '\0' termination.
+ * @param len  length of the 'text'.
+ * @return     'true' on success, 'false' on out of memory
+ */
+bool sc_str_append_len(char **str, const char *text, uint32_t len);
+
+/**
+ * Strings are created with exact size, appending grows capacity
+ * geometrically. Reserve capacity upfront if final size is known.
+ *
+ * @param str pointer to length prefixed string, '*str' may change. If '*str'
+ *            is NULL, an empty string is created.
+ * @param cap capacity, excluding '\0'.
+ * @return    'true' on success, 'false' on out of memory
+ */
+bool sc_str_reserve(char **str, uint32_t cap);
+
+/**
+ * @param str length prefixed string, must not be NULL.
+ * @return    capacity, excluding '\0'.
  */
-#define sc_str_append_fmt(str, fmt, ...)                                       \
-    sc_str_set_fmt(str, "%s" fmt, *str, __VA_ARGS__)
+uint32_t sc_str_cap(const char *str);
 
 /**
  * Compare two length prefixed strings. To compare with C string, use strcmp().
@@ -151,6 +180,8 @@ bool sc_str_trim(char **str, const char *list);
 bool sc_str_substring(char **str, uint32_t start, uint32_t end);
 
 /**
+ * Replace all occurrences of 'rep' in a single pass over the string.
+ *
  * @param str  length prefixed string, '*str' may change.
  * @param rep  string to be replaced
  * @param with string to replace with
@@ -158,6 +189,27 @@ bool sc_str_substring(char **str, uint32_t start, uint32_t end);
  */
 bool sc_str_replace(char **str, const char *rep, const char *with);
 
+// Max pattern count for sc_str_replace_multi().
+#ifndef SC_STR_REPLACE_MAX
+    #define SC_STR_REPLACE_MAX 64
+#endif
+
+/**
+ * Replace multiple patterns in a single pass. At each position, the first
+ * pattern in the list that matches is replaced. Replaced text is not searched
+ * again, e.g. replacing "a" with "b" and "b" with "c" on "ab" gives "bc".
+ * Empty patterns are ignored.
+ *
+ * @param str     length prefixed string, '*str' may change.
+ * @param rep     strings to be replaced
+ * @param with    strings to replace with, 'with[i]' replaces 'rep[i]'
+ * @param count   pattern count, max SC_STR_REPLACE_MAX.
+ * @return        'true' on success or if '*str' is NULL.  'false' on out of
+ *                memory or if 'count' is more than SC_STR_REPLACE_MAX.
+ */
+bool sc_str_replace_multi(char **str, const char *const *rep,
+                          const char *const *with, uint32_t count);
+
 /**
  * Tokenization is zero-copy but a bit tricky. This function will mutate 'str',
  * but it is temporary. On each 'sc_str_token_begin' call, this function will
@@ -179,6 +231,7 @@ bool sc_str_replace(char **str, const char *rep, const char *with);
  *
  * sc_str_token_end(str, &save);
  *
+ * With SC_STR_HAVE_SCAN, delimiters are searched with sc_scan_find().
  *
  * @param str   length prefixed string, must not be NULL.
  * @param save  helper variable for tokenizer code.
@@ -188,5 +241,269 @@ bool sc_str_replace(char **str, const char *rep, const char *with);
 const char *sc_str_token_begin(char *str, char **save, const char *delim);
 void sc_str_token_end(char *str, char **save);
 
+/**
+ * String view, (pointer, length) pair, doesn't own the memory and the bytes
+ * don't have to be '\0' terminated, e.g a line inside a network buffer.
+ */
+struct sc_str_view
+{
+    const char *ptr;
+    uint32_t len;
+};
+
+/**
+ * @param str length prefixed string, can be NULL.
+ * @return    view of the string, {NULL, 0} if 'str' is NULL.
+ */
+struct sc_str_view sc_str_view(const char *str);
+
+/**
+ * @param ptr bytes, no need for '\0' termination.
+ * @param len length of the 'ptr'
+ * @return    view
+ */
+struct sc_str_view sc_str_view_len(const char *ptr, uint32_t len);
+
+/**
+ * @param view view
+ * @return     length prefixed string, NULL on out of memory or if view->ptr
+ *             is NULL.
+ */
+char *sc_str_create_view(struct sc_str_view view);
+
+/**
+ * @param str  length prefixed string
+ * @param view view
+ * @return     'true' if equals
+ */
+bool sc_str_cmp_view(const char *str, struct sc_str_view view);
+
+/**
+ * @param view  view
+ * @param other view
+ * @return      'true' if equals
+ */
+bool sc_str_view_cmp(struct sc_str_view view, struct sc_str_view other);
+
+/**
+ * Non-mutating tokenizer, returns views into the source, the source is never
+ * modified, so it works on read only memory and on strings which are not
+ * '\0' terminated. Same semantics as sc_str_token_begin(), consecutive
+ * delimiters give empty tokens.
+ *
+ * Delimiters are classified 16 bytes at a time with SSE2/NEON compares if
+ * there are at most SC_STR_TOKEN_SIMD delimiters, with a 256-bit bitmap
+ * otherwise. Single delimiter uses memchr(). Define SC_STR_NO_SIMD to disable
+ * SIMD code.
+ *
+ * usage:
+ *
+ * struct sc_str_tokenizer t;
+ * struct sc_str_view token;
+ *
+ * sc_str_tokenizer_init(&t, sc_str_view_len(buf, len), "\r\n");
+ * while (sc_str_tokenizer_next(&t, &token)) {
+ *      printf("token : %.*s \n", (int) token.len, token.ptr);
+ * }
+ */
+#ifndef SC_STR_TOKEN_SIMD
+    #define SC_STR_TOKEN_SIMD 8
+#endif
+
+struct sc_str_tokenizer
+{
+    const char *pos;
+    const char *end;
+    uint32_t count;
+    bool done;
+    char delim[SC_STR_TOKEN_SIMD];
+    uint32_t map[8];
+};
+
+/**
+ * @param t     tokenizer
+ * @param src   source, if src.ptr is NULL, there are no tokens.
+ * @param delim '\0' terminated delimiter list.
+ */
+void sc_str_tokenizer_init(struct sc_str_tokenizer *t, struct sc_str_view src,
+                           const char *delim);
+
+/**
+ * @param t     tokenizer
+ * @param token next token
+ * @return      'false' if there are no more tokens.
+ */
+bool sc_str_tokenizer_next(struct sc_str_tokenizer *t,
+                           struct sc_str_view *token);
+
+
+/**
+ * String builder, appends many pieces and creates a length prefixed string at
+ * the end. Short strings are built in inline storage, so building a short
+ * string costs a single allocation in sc_str_builder_finish(). Longer strings
+ * are moved to a heap string that grows geometrically and finish() returns it
+ * without a copy.
+ *
+ * Errors are checked lazily, if an append fails, following appends are
+ * ignored and finish() returns NULL.
+ *
+ * struct sc_str_builder b;
+ *
+ * sc_str_builder_init(&b);
+ * sc_str_builder_add(&b, "user:");
+ * sc_str_builder_add_fmt(&b, "%d", id);
+ * key = sc_str_builder_finish(&b); // Builder can be used again.
+ * ...
+ * sc_str_builder_term(&b);
+ */
+
+#ifndef SC_STR_BUILDER_INLINE
+    #define SC_STR_BUILDER_INLINE 128
+#endif
+
+struct sc_str_builder
+{
+    char *str;
+    uint32_t len;
+    bool oom;
+    char buf[SC_STR_BUILDER_INLINE];
+};
+
+/**
+ * @param b builder
+ */
+void sc_str_builder_init(struct sc_str_builder *b);
+
+/**
+ * Release memory.
+ * @param b builder
+ */
+void sc_str_builder_term(struct sc_str_builder *b);
+
+/**
+ * Clear content and error, keeps allocated memory.
+ * @param b builder
+ */
+void sc_str_builder_reset(struct sc_str_builder *b);
+
+/**
+ * @param b    builder
+ * @param text '\0' terminated string.
+ */
+void sc_str_builder_add(struct sc_str_builder *b, const char *text);
+
+/**
+ * @param b    builder
+ * @param text text, no need for '\0' termination.
+ * @param len  length of the 'text'
+ */
+void sc_str_builder_add_len(struct sc_str_builder *b, const char *text,
+                            uint32_t len);
+
+/**
+ * @param b builder
+ * @param c character
+ */
+void sc_str_builder_add_char(struct sc_str_builder *b, char c);
+
+/**
+ * @param b   builder
+ * @param fmt format
+ * @param ... arguments
+ */
+void sc_str_builder_add_fmt(struct sc_str_builder *b, const char *fmt, ...);
+
+/**
+ * @param b builder
+ * @return  current content as '\0' terminated string, valid until next call.
+ */
+const char *sc_str_builder_cstr(struct sc_str_builder *b);
+
+/**
+ * Create length prefixed string from the content, builder is reset.
+ *
+ * @param b builder
+ * @return  length prefixed string, NULL on out of memory.
+ */
+char *sc_str_builder_finish(struct sc_str_builder *b);
+
+/**
+ * String interning, requires SC_STR_HAVE_MAP and sc_map.
+ *
+ * Strings are copied once into arena blocks and deduplicated with a length
+ * keyed map, equal strings get the same pointer, so interned strings can be
+ * compared with '==' and used as pointer keys in maps.
+ *
+ * Returned strings have the same layout as sc_str, so read only functions
+ * work on them, e.g sc_str_len(), sc_str_cmp(), sc_str_dup(). They are owned
+ * by the pool and valid until sc_str_intern_term(). Don't pass them to
+ * sc_str_destroy() or to any function which modifies the string.
+ *
+ * struct sc_str_intern pool;
+ *
+ * sc_str_intern_init(&pool);
+ * a = sc_str_intern(&pool, "content-type");
+ * b = sc_str_intern_len(&pool, header, header_len);
+ * if (a == b) {
+ *     // Same string
+ * }
+ * sc_str_intern_term(&pool);
+ */
+#ifdef SC_STR_HAVE_MAP
+
+#include "sc_map.h"
+
+#ifndef SC_STR_INTERN_BLOCK
+    #define SC_STR_INTERN_BLOCK 4096
+#endif
+
+struct sc_str_intern
+{
+    struct sc_map_lsv map;
+    struct sc_str_block *blocks;
+    uint64_t mem;
+};
+
+/**
+ * @param pool pool
+ * @return     'false' on out of memory.
+ */
+bool sc_str_intern_init(struct sc_str_intern *pool);
+
+/**
+ * Release all memory, interned strings are invalid after this call.
+ * @param pool pool
+ */
+void sc_str_intern_term(struct sc_str_intern *pool);
+
+/**
+ * @param pool pool
+ * @param str  '\0' terminated C string.
+ * @return     interned string, NULL on out of memory or if 'str' is NULL.
+ */
+const char *sc_str_intern(struct sc_str_intern *pool, const char *str);
+
+/**
+ * @param pool pool
+ * @param str  string bytes, no need for '\0' termination.
+ * @param len  length of the 'str'
+ * @return     interned string, NULL on out of memory or if 'str' is NULL.
+ */
+const char *sc_str_intern_len(struct sc_str_intern *pool, const char *str,
+                              uint32_t len);
+
+/**
+ * @param pool pool
+ * @return     interned string count.
+ */
+uint32_t sc_str_intern_count(struct sc_str_intern *pool);
+
+/**
+ * @param pool pool
+ * @return     total bytes allocated for the arena blocks.
+ */
+uint64_t sc_str_intern_mem(struct sc_str_intern *pool);
+
+#endif
 
 #endif
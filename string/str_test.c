@@ -200,7 +200,84 @@ void test2()
     fail_strlen = 2;
     assert(sc_str_replace(&c, "*", "2") == false);
     fail_strlen = INT32_MAX;
+
+    // Match buffer grows after 64 matches.
+    memset(buf, '*', 100);
+    buf[100] = '\0';
+    sc_str_set(&c, buf);
+    fail_realloc = true;
+    assert(sc_str_replace(&c, "*", "--") == false);
+    fail_realloc = false;
+    fail_malloc = true;
+    assert(sc_str_replace(&c, "*", "--") == false);
+    fail_malloc = false;
+    assert(strcmp(c, buf) == 0);
+    fail_strlen = 2;
+    assert(sc_str_replace_multi(&c, (const char *[]){"*"},
+                                (const char *[]){"-"}, 1) == false);
+    fail_strlen = INT32_MAX;
+    sc_str_destroy(c);
+
+    struct sc_str_builder b;
+
+    sc_str_builder_init(&b);
+    fail_malloc = true;
+    sc_str_builder_add(&b, "test");
+    assert(strcmp(sc_str_builder_cstr(&b), "test") == 0);
+    sc_str_builder_add_len(&b, buf, 200);
+    sc_str_builder_add(&b, "test");
+    assert(sc_str_builder_finish(&b) == NULL);
+    sc_str_builder_add(&b, "test");
+    assert(sc_str_builder_finish(&b) == NULL);
+    fail_malloc = false;
+
+    sc_str_builder_add_len(&b, buf, 200);
+    fail_realloc = true;
+    sc_str_builder_add_len(&b, buf, 200);
+    assert(sc_str_builder_finish(&b) == NULL);
+    sc_str_builder_add_len(&b, buf, 200);
+    sc_str_builder_add_fmt(&b, "%s", buf);
+    assert(sc_str_builder_finish(&b) == NULL);
+    fail_realloc = false;
+
+    fail_vsnprintf = true;
+    sc_str_builder_add_fmt(&b, "%d", 1);
+    assert(sc_str_builder_finish(&b) == NULL);
+    c = sc_str_create("test");
+    assert(!sc_str_append_fmt(&c, "%d", 1));
+    assert(strcmp(c, "test") == 0);
+    fail_vsnprintf = false;
+    fail_realloc = true;
+    assert(!sc_str_reserve(&c, 100));
+    fail_realloc = false;
     sc_str_destroy(c);
+
+    c = NULL;
+    fail_malloc = true;
+    assert(!sc_str_reserve(&c, 100));
+    fail_malloc = false;
+    sc_str_builder_term(&b);
+
+#ifdef SC_STR_HAVE_MAP
+    struct sc_str_intern pool;
+    const char *in;
+
+    assert(sc_str_intern_init(&pool));
+    fail_malloc = true;
+    assert(sc_str_intern(&pool, "test") == NULL);
+    fail_malloc = false;
+    assert(sc_str_intern_count(&pool) == 0);
+    in = sc_str_intern(&pool, "test");
+    assert(in != NULL);
+    fail_malloc = true;
+    assert(sc_str_intern(&pool, "test") == in);
+    assert(sc_str_intern(&pool, "test2") != NULL);
+    fail_strlen = 1;
+    assert(sc_str_intern(&pool, "test") == NULL);
+    fail_strlen = INT32_MAX;
+    fail_malloc = false;
+    sc_str_intern_term(&pool);
+#endif
 }
 
 #endif
@@ -460,6 +537,334 @@ void test6()
     sc_str_destroy(s2);
 }
 
+void test_replace()
+{
+    char *s;
+    char big[1024];
+    char expect[4096];
+    const char *rep[] = {"{{name}}", "{{id}}", "{{", "a"};
+    const char *with[] = {"john", "1234567", "<", "b"};
+
+    // Many matches, more than the initial match buffer.
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    s = sc_str_create(big);
+    assert(sc_str_replace(&s, "x", "yz"));
+    assert(sc_str_len(s) == 2 * (sizeof(big) - 1));
+    for (size_t i = 0; i < sizeof(big) - 1; i++) {
+        assert(s[i * 2] == 'y' && s[i * 2 + 1] == 'z');
+    }
+    assert(sc_str_replace(&s, "yz", "x"));
+    assert(strcmp(s, big) == 0);
+    assert(sc_str_replace(&s, "xx", ""));
+    assert(strcmp(s, "x") == 0);
+    sc_str_destroy(s);
+
+    // Matches are not overlapping, search continues after replaced text.
+    s = sc_str_create("aaaaa");
+    assert(sc_str_replace(&s, "aa", "a"));
+    assert(strcmp(s, "aaa") == 0);
+    assert(sc_str_replace(&s, "", "b"));
+    assert(strcmp(s, "aaa") == 0);
+    assert(sc_str_replace(&s, "aaaa", "b"));
+    assert(strcmp(s, "aaa") == 0);
+    assert(sc_str_replace(&s, "aaa", "bbbb"));
+    assert(strcmp(s, "bbbb") == 0);
+    sc_str_destroy(s);
+
+    // Embedded '\0', length is used rather than strlen().
+    s = sc_str_create_len("ab\0ab", 5);
+    assert(sc_str_replace(&s, "b", "cc"));
+    assert(sc_str_len(s) == 7);
+    assert(memcmp(s, "acc\0acc", 8) == 0);
+    sc_str_destroy(s);
+
+    s = sc_str_create("Hi {{name}}, id={{id}} {{x}} aa {{name}}");
+    assert(sc_str_replace_multi(&s, rep, with, 4));
+    assert(strcmp(s, "Hi john, id=1234567 <x}} bb john") == 0);
+    assert(sc_str_replace_multi(&s, rep, with, 0));
+    assert(strcmp(s, "Hi john, id=1234567 <x}} bb john") == 0);
+
+    // Replaced text is not searched again.
+    sc_str_set(&s, "ab");
+    assert(sc_str_replace_multi(&s, (const char *[]){"a", "b"},
+                                (const char *[]){"b", "c"}, 2));
+    assert(strcmp(s, "bc") == 0);
+
+    // Same size replacements are done in place.
+    assert(sc_str_replace_multi(&s, (const char *[]){"b", "c", ""},
+                                (const char *[]){"1", "2", "3"}, 3));
+    assert(strcmp(s, "12") == 0);
+    assert(!sc_str_replace_multi(&s, rep, with, SC_STR_REPLACE_MAX + 1));
+    sc_str_destroy(s);
+
+    s = NULL;
+    assert(sc_str_replace_multi(&s, rep, with, 4));
+    assert(s == NULL);
+
+    // Many matches with multiple patterns.
+    memset(big, 0, sizeof(big));
+    expect[0] = '\0';
+    for (int i = 0; i < 100; i++) {
+        strcat(big, i % 2 ? "{{id}}-" : "a.");
+        strcat(expect, i % 2 ? "1234567-" : "b.");
+    }
+    s = sc_str_create(big);
+    assert(sc_str_replace_multi(&s, rep, with, 4));
+    assert(strcmp(s, expect) == 0);
+    sc_str_destroy(s);
+}
+
+void test_builder()
+{
+    char *s = NULL;
+    char *key;
+    char big[2001];
+    uint32_t cap, grows = 0;
+    struct sc_str_builder b;
+
+    // Capacity grows geometrically.
+    assert(sc_str_append(&s, "x"));
+    cap = sc_str_cap(s);
+    for (int i = 0; i < 3000; i++) {
+        assert(sc_str_append_len(&s, "y", 1));
+        if (sc_str_cap(s) != cap) {
+            cap = sc_str_cap(s);
+            grows++;
+        }
+    }
+    assert(sc_str_len(s) == 3001);
+    assert(grows < 16);
+    assert(sc_str_append_fmt(&s, "%d", 123));
+    assert(strcmp(s + 3001, "123") == 0);
+    assert(sc_str_len(s) == 3004);
+    sc_str_destroy(s);
+
+    s = NULL;
+    assert(sc_str_reserve(&s, 100));
+    assert(sc_str_len(s) == 0 && sc_str_cap(s) == 100);
+    assert(sc_str_append_fmt(&s, "%s-%d", "a", 1));
+    assert(sc_str_cap(s) == 100);
+    assert(strcmp(s, "a-1") == 0);
+    assert(sc_str_reserve(&s, 10));
+    assert(!sc_str_reserve(&s, SC_SIZE_MAX + 1));
+    assert(sc_str_cap(s) == 100);
+    sc_str_destroy(s);
+
+    s = NULL;
+    assert(sc_str_append_fmt(&s, "%d", 5));
+    assert(strcmp(s, "5") == 0);
+    sc_str_destroy(s);
+
+    // Output longer than the internal format buffer.
+    memset(big, 'b', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    s = sc_str_create_fmt("%s", big);
+    assert(sc_str_len(s) == 2000);
+    assert(strcmp(s, big) == 0);
+    sc_str_destroy(s);
+
+    sc_str_builder_init(&b);
+    sc_str_builder_add(&b, "user:");
+    sc_str_builder_add_fmt(&b, "%d", 42);
+    sc_str_builder_add_char(&b, ':');
+    sc_str_builder_add_len(&b, "abcdef", 3);
+    assert(strcmp(sc_str_builder_cstr(&b), "user:42:abc") == 0);
+    key = sc_str_builder_finish(&b);
+    assert(strcmp(key, "user:42:abc") == 0);
+    assert(sc_str_len(key) == 11);
+    sc_str_destroy(key);
+
+    // Builder is reusable, content goes over inline storage.
+    for (int i = 0; i < 100; i++) {
+        sc_str_builder_add_fmt(&b, "%04d", i);
+    }
+    sc_str_builder_add_fmt(&b, "%s", big);
+    key = sc_str_builder_finish(&b);
+    assert(sc_str_len(key) == 400 + 2000);
+    assert(strncmp(key, "000000010002", 12) == 0);
+    assert(strcmp(key + 400, big) == 0);
+    sc_str_destroy(key);
+
+    sc_str_builder_add_len(&b, big, SC_STR_BUILDER_INLINE - 1);
+    assert(b.str == NULL);
+    sc_str_builder_add_char(&b, 'c');
+    assert(b.str != NULL);
+    assert(sc_str_len(b.str) == SC_STR_BUILDER_INLINE);
+    sc_str_builder_reset(&b);
+    assert(strcmp(sc_str_builder_cstr(&b), "") == 0);
+    sc_str_builder_add(&b, big);
+    sc_str_builder_add(&b, big);
+    sc_str_builder_add(&b, big);
+    assert(sc_str_builder_finish(&b) == NULL);
+    key = sc_str_builder_finish(&b);
+    assert(strcmp(key, "") == 0);
+    sc_str_destroy(key);
+    sc_str_builder_term(&b);
+}
+
+static void test_tokenizer_check(const char *src, uint32_t len,
+                                 const char *delim)
+{
+    uint32_t start = 0, count = 0;
+    struct sc_str_tokenizer t;
+    struct sc_str_view tok;
+
+    sc_str_tokenizer_init(&t, sc_str_view_len(src, len), delim);
+
+    for (uint32_t i = 0; i <= len; i++) {
+        if (i == len || (src[i] != '\0' && strchr(delim, src[i]) != NULL)) {
+            assert(sc_str_tokenizer_next(&t, &tok));
+            assert(tok.ptr == src + start);
+            assert(tok.len == i - start);
+            start = i + 1;
+            count++;
+        }
+    }
+
+    assert(!sc_str_tokenizer_next(&t, &tok));
+    assert(count > 0);
+}
+
+void test_view()
+{
+    char buf[300];
+    char *s;
+    const char *delims[] = {"", ",", ",;", " \t\r\n", "abcdefgh",
+                            "abcdefghi", "aabbcc", "\x80\xff,"};
+    struct sc_str_view v, tok;
+    struct sc_str_tokenizer t;
+    uint64_t rnd = 0x9e3779b97f4a7c15ull;
+    const char *alphabet = "abcdefghij,; \t\r\n\x80\xff";
+    const size_t n = strlen(alphabet);
+
+    v = sc_str_view(NULL);
+    assert(v.ptr == NULL && v.len == 0);
+    assert(sc_str_create_view(v) == NULL);
+
+    s = sc_str_create("GET /index.html");
+    v = sc_str_view(s);
+    assert(v.ptr == s && v.len == 15);
+    assert(sc_str_cmp_view(s, v));
+    assert(sc_str_cmp_view(s, sc_str_view_len("GET /index.html!", 15)));
+    assert(!sc_str_cmp_view(s, sc_str_view_len("GET /index.html!", 16)));
+    assert(sc_str_view_cmp(sc_str_view_len(s, 3), sc_str_view_len("GET", 3)));
+    assert(!sc_str_view_cmp(sc_str_view_len(s, 3), sc_str_view_len("PUT", 3)));
+
+    sc_str_tokenizer_init(&t, v, " ");
+    assert(sc_str_tokenizer_next(&t, &tok));
+    assert(sc_str_view_cmp(tok, sc_str_view_len("GET", 3)));
+    assert(sc_str_tokenizer_next(&t, &tok));
+    char *path = sc_str_create_view(tok);
+    assert(strcmp(path, "/index.html") == 0);
+    assert(sc_str_len(path) == 11);
+    assert(!sc_str_tokenizer_next(&t, &tok));
+    assert(strcmp(s, "GET /index.html") == 0);
+    sc_str_destroy(path);
+    sc_str_destroy(s);
+
+    // Source is not modified and does not need '\0'.
+    const char lines[] = {'a', '\n', '\n', 'b', 'c', '\n', 'd'};
+    sc_str_tokenizer_init(&t, sc_str_view_len(lines, sizeof(lines)), "\n");
+    assert(sc_str_tokenizer_next(&t, &tok) && tok.len == 1);
+    assert(sc_str_tokenizer_next(&t, &tok) && tok.len == 0);
+    assert(sc_str_tokenizer_next(&t, &tok) && tok.len == 2);
+    assert(sc_str_tokenizer_next(&t, &tok) && tok.len == 1);
+    assert(tok.ptr == lines + 6);
+    assert(!sc_str_tokenizer_next(&t, &tok));
+    assert(!sc_str_tokenizer_next(&t, &tok));
+
+    sc_str_tokenizer_init(&t, sc_str_view_len(NULL, 0), ",");
+    assert(!sc_str_tokenizer_next(&t, &tok));
+
+    sc_str_tokenizer_init(&t, sc_str_view_len("", 0), ",");
+    assert(sc_str_tokenizer_next(&t, &tok) && tok.len == 0);
+    assert(!sc_str_tokenizer_next(&t, &tok));
+
+    for (int iter = 0; iter < 2000; iter++) {
+        uint32_t len = (uint32_t) (iter % 280);
+
+        for (uint32_t i = 0; i < len; i++) {
+            rnd ^= rnd << 13u;
+            rnd ^= rnd >> 7u;
+            rnd ^= rnd << 17u;
+            // Mostly letters, so there are long runs without delimiters.
+            buf[i] = alphabet[(rnd >> 8u) % 8 ? (rnd >> 16u) % 10
+                                               : (rnd >> 16u) % n];
+        }
+
+        for (size_t d = 0; d < sizeof(delims) / sizeof(delims[0]); d++) {
+            test_tokenizer_check(buf + iter % 7, len > 7 ? len - 7 : 0,
+                                 delims[d]);
+        }
+    }
+}
+
+#ifdef SC_STR_HAVE_MAP
+void test_intern()
+{
+    char key[32];
+    char big[2001];
+    const char *a, *b, *c, *e;
+    const char *keys[500];
+    struct sc_str_intern pool;
+
+    assert(sc_str_intern_init(&pool));
+    assert(sc_str_intern(&pool, NULL) == NULL);
+    assert(sc_str_intern_len(&pool, NULL, 3) == NULL);
+
+    a = sc_str_intern(&pool, "content-type");
+    b = sc_str_intern_len(&pool, "content-type: text", 12);
+    c = sc_str_intern(&pool, "content-length");
+    assert(a == b);
+    assert(a != c);
+    assert(strcmp(a, "content-type") == 0);
+    assert(sc_str_len(a) == 12);
+    assert(sc_str_cmp(a, b));
+    assert(!sc_str_cmp(a, c));
+    assert(sc_str_intern_count(&pool) == 2);
+
+    e = sc_str_intern(&pool, "");
+    assert(e != NULL && sc_str_len(e) == 0);
+    assert(e == sc_str_intern_len(&pool, "abc", 0));
+
+    // Pointers stay valid as the pool grows.
+    for (int i = 0; i < 500; i++) {
+        snprintf(key, sizeof(key), "host-%d.example.com", i);
+        keys[i] = sc_str_intern(&pool, key);
+        assert(keys[i] != NULL);
+        assert(((uintptr_t) keys[i] & 3) == 0);
+    }
+
+    memset(big, 'b', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    c = sc_str_intern(&pool, big);
+    assert(sc_str_len(c) == 2000 && strcmp(c, big) == 0);
+    assert(c == sc_str_intern(&pool, big));
+
+    for (int i = 0; i < 500; i++) {
+        snprintf(key, sizeof(key), "host-%d.example.com", i);
+        assert(sc_str_intern(&pool, key) == keys[i]);
+        assert(strcmp(keys[i], key) == 0);
+        assert(sc_str_len(keys[i]) == (int64_t) strlen(key));
+    }
+
+    assert(sc_str_intern_count(&pool) == 3 + 500 + 1);
+    assert(sc_str_intern_mem(&pool) < 500 * 64);
+    assert(a == sc_str_intern(&pool, "content-type"));
+
+    char *dup = sc_str_dup(a);
+    assert(sc_str_cmp(dup, a));
+    sc_str_destroy(dup);
+
+    sc_str_intern_term(&pool);
+    assert(sc_str_intern_mem(&pool) == 0);
+}
+#else
+void test_intern()
+{
+}
+#endif
 
 int main()
 {
@@ -472,5 +877,9 @@ int main()
     test4();
     test5();
     test6();
+    test_replace();
+    test_builder();
+    test_intern();
+    test_view();
     return 0;
 }
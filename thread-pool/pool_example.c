@@ -0,0 +1,38 @@
+#include "sc_pool.h"
+
+#include <stdio.h>
+
+static void square(void *arg)
+{
+    int *val = arg;
+
+    *val = *val * *val;
+}
+
+int main()
+{
+    int vals[8];
+    struct sc_pool pool;
+    struct sc_pool_task tasks[8];
+    struct sc_pool_wait wait;
+
+    sc_pool_init(&pool, 0, false);
+    sc_pool_wait_init(&wait);
+
+    for (int i = 0; i < 8; i++) {
+        vals[i] = i;
+        sc_pool_task_init(&tasks[i], square, &vals[i]);
+        sc_pool_submit(&pool, &tasks[i], &wait);
+    }
+
+    sc_pool_wait(&pool, &wait);
+
+    for (int i = 0; i < 8; i++) {
+        printf("%d \n", vals[i]);
+    }
+
+    sc_pool_wait_term(&wait);
+    sc_pool_term(&pool);
+
+    return 0;
+}
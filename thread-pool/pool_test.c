@@ -0,0 +1,273 @@
+#include "sc_pool.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define COUNT 10000
+
+#ifdef SC_HAVE_WRAP
+
+int fail_malloc = -1;
+void *__real_malloc(size_t n);
+void *__wrap_malloc(size_t n)
+{
+    if (fail_malloc == 0) {
+        return NULL;
+    }
+
+    if (fail_malloc > 0) {
+        fail_malloc--;
+    }
+
+    return __real_malloc(n);
+}
+
+int fail_pthread_create = -1;
+int __real_pthread_create(pthread_t *newthread, const pthread_attr_t *attr,
+                          void *(*start_routine)(void *), void *arg);
+int __wrap_pthread_create(pthread_t *newthread, const pthread_attr_t *attr,
+                          void *(*start_routine)(void *), void *arg)
+{
+    if (fail_pthread_create == 0) {
+        return -1;
+    }
+
+    if (fail_pthread_create > 0) {
+        fail_pthread_create--;
+    }
+
+    return __real_pthread_create(newthread, attr, start_routine, arg);
+}
+
+void fail_test(void)
+{
+    struct sc_pool pool;
+
+    // Workers array, idle list and a deque per worker.
+    for (int i = 0; i < 6; i++) {
+        fail_malloc = i;
+        assert(sc_pool_init(&pool, 4, false) == -1);
+        assert(strcmp(sc_pool_err(&pool), "Out of memory.") == 0);
+        assert(sc_pool_term(&pool) == 0);
+    }
+    fail_malloc = -1;
+
+    for (int i = 0; i < 4; i++) {
+        fail_pthread_create = i;
+        assert(sc_pool_init(&pool, 4, false) == -1);
+        assert(sc_pool_term(&pool) == 0);
+    }
+    fail_pthread_create = -1;
+
+    assert(sc_pool_init(&pool, 4, false) == 0);
+    assert(sc_pool_term(&pool) == 0);
+}
+
+#else
+void fail_test(void)
+{
+}
+#endif
+
+static void square(void *arg)
+{
+    long *val = arg;
+
+    *val = *val * *val;
+}
+
+void test_basic(void)
+{
+    static long vals[COUNT];
+    static struct sc_pool_task tasks[COUNT];
+    struct sc_pool pool;
+    struct sc_pool_wait wait;
+
+    assert(sc_pool_init(&pool, 4, false) == 0);
+    assert(sc_pool_threads(&pool) == 4);
+    assert(sc_pool_wait_init(&wait) == 0);
+
+    // Nothing submitted.
+    sc_pool_wait(&pool, &wait);
+
+    for (int round = 0; round < 3; round++) {
+        for (long i = 0; i < COUNT; i++) {
+            vals[i] = i;
+            sc_pool_task_init(&tasks[i], square, &vals[i]);
+            sc_pool_submit(&pool, &tasks[i], &wait);
+        }
+
+        sc_pool_wait(&pool, &wait);
+
+        for (long i = 0; i < COUNT; i++) {
+            assert(vals[i] == i * i);
+        }
+    }
+
+    assert(sc_pool_wait_term(&wait) == 0);
+    assert(sc_pool_term(&pool) == 0);
+    assert(sc_pool_term(&pool) == 0);
+}
+
+struct range
+{
+    struct sc_pool *pool;
+    const int *arr;
+    size_t begin;
+    size_t end;
+    long long sum;
+};
+
+// Splits the range, submits one half and runs the other half inline.
+static void sum(void *arg)
+{
+    struct range *r = arg;
+    struct range left, right;
+    struct sc_pool_task task;
+    struct sc_pool_wait wait;
+    size_t mid;
+
+    if (r->end - r->begin <= 64) {
+        r->sum = 0;
+        for (size_t i = r->begin; i < r->end; i++) {
+            r->sum += r->arr[i];
+        }
+        return;
+    }
+
+    mid = r->begin + (r->end - r->begin) / 2;
+    left = (struct range){r->pool, r->arr, r->begin, mid, 0};
+    right = (struct range){r->pool, r->arr, mid, r->end, 0};
+
+    assert(sc_pool_wait_init(&wait) == 0);
+    sc_pool_task_init(&task, sum, &left);
+    sc_pool_submit(r->pool, &task, &wait);
+    sum(&right);
+    sc_pool_wait(r->pool, &wait);
+    assert(sc_pool_wait_term(&wait) == 0);
+
+    r->sum = left.sum + right.sum;
+}
+
+void test_nested(void)
+{
+    static int arr[100000];
+    long long expected = 0;
+    struct sc_pool pool;
+    struct sc_pool_task task;
+    struct sc_pool_wait wait;
+    struct range r;
+
+    for (int i = 0; i < 100000; i++) {
+        arr[i] = i % 1000;
+        expected += arr[i];
+    }
+
+    for (uint32_t threads = 1; threads <= 8; threads *= 2) {
+        assert(sc_pool_init(&pool, threads, false) == 0);
+        assert(sc_pool_wait_init(&wait) == 0);
+
+        r = (struct range){&pool, arr, 0, 100000, 0};
+        sc_pool_task_init(&task, sum, &r);
+        sc_pool_submit(&pool, &task, &wait);
+        sc_pool_wait(&pool, &wait);
+        assert(r.sum == expected);
+
+        // Run from the calling thread, it steals and helps while waiting.
+        r = (struct range){&pool, arr, 0, 100000, 0};
+        sum(&r);
+        assert(r.sum == expected);
+
+        assert(sc_pool_wait_term(&wait) == 0);
+        assert(sc_pool_term(&pool) == 0);
+    }
+}
+
+struct spawn
+{
+    struct sc_pool *pool;
+    struct sc_pool_task *tasks;
+    long *vals;
+    int count;
+};
+
+// Submits more tasks than a worker deque can hold, the rest overflows to the
+// global queue.
+static void spawn(void *arg)
+{
+    struct spawn *s = arg;
+
+    for (int i = 0; i < s->count; i++) {
+        s->vals[i] = i;
+        sc_pool_task_init(&s->tasks[i], square, &s->vals[i]);
+        sc_pool_submit(s->pool, &s->tasks[i], NULL);
+    }
+}
+
+void test_drain(void)
+{
+    static long vals[COUNT];
+    static struct sc_pool_task tasks[COUNT];
+    struct sc_pool pool;
+    struct sc_pool_task task;
+    struct spawn s;
+
+    assert(sc_pool_init(&pool, 0, true) == 0);
+    assert(sc_pool_threads(&pool) > 0);
+
+    s = (struct spawn){&pool, tasks, vals, COUNT};
+    sc_pool_task_init(&task, spawn, &s);
+    sc_pool_submit(&pool, &task, NULL);
+
+    // Pending tasks are executed before workers exit.
+    assert(sc_pool_term(&pool) == 0);
+
+    for (long i = 0; i < COUNT; i++) {
+        assert(vals[i] == i * i);
+    }
+}
+
+static void increment(void *arg, size_t begin, size_t end)
+{
+    int *arr = arg;
+
+    assert(begin < end);
+    for (size_t i = begin; i < end; i++) {
+        __atomic_add_fetch(&arr[i], 1, __ATOMIC_RELAXED);
+    }
+}
+
+void test_for(void)
+{
+    static int arr[100000];
+    size_t grains[] = {0, 1, 7, 1000, 100000, 200000};
+    struct sc_pool pool;
+
+    for (uint32_t threads = 1; threads <= 8; threads *= 4) {
+        assert(sc_pool_init(&pool, threads, false) == 0);
+
+        sc_pool_for(&pool, 0, 0, increment, arr);
+
+        for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+            memset(arr, 0, sizeof(arr));
+            sc_pool_for(&pool, 100000, grains[g], increment, arr);
+            for (int i = 0; i < 100000; i++) {
+                assert(arr[i] == 1);
+            }
+        }
+
+        assert(sc_pool_term(&pool) == 0);
+    }
+}
+
+int main()
+{
+    fail_test();
+    test_basic();
+    test_nested();
+    test_drain();
+    test_for();
+
+    return 0;
+}
@@ -0,0 +1,645 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _XOPEN_SOURCE
+    #define _XOPEN_SOURCE 700
+#endif
+
+#include "sc_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+#ifndef thread_local
+    #if __STDC_VERSION__ >= 201112 && !defined __STDC_NO_THREADS__
+        #define thread_local _Thread_local
+    #elif defined _WIN32 && (defined _MSC_VER || defined __ICL ||              \
+                             defined __DMC__ || defined __BORLANDC__)
+        #define thread_local __declspec(thread)
+    #elif defined __GNUC__ || defined __SUNPRO_C || defined __xlC__
+        #define thread_local __thread
+    #else
+        #error "Cannot define  thread_local"
+    #endif
+#endif
+
+#if defined(_MSC_VER)
+    #define sc_pool_load(p)     (*(volatile int64_t *) (p))
+    #define sc_pool_load_acq(p)                                                \
+        InterlockedCompareExchange64((LONG64 *) (p), 0, 0)
+    #define sc_pool_store(p, v) (*(volatile int64_t *) (p) = (v))
+    #define sc_pool_store_rel(p, v)                                            \
+        InterlockedExchange64((LONG64 *) (p), (LONG64) (v))
+    #define sc_pool_load_ptr(p)     (*(void *volatile *) (p))
+    #define sc_pool_store_ptr(p, v) (*(void *volatile *) (p) = (v))
+    #define sc_pool_load_sc(p)                                                 \
+        InterlockedCompareExchange64((LONG64 *) (p), 0, 0)
+    #define sc_pool_xchg(p, v)                                                 \
+        InterlockedExchange64((LONG64 *) (p), (LONG64) (v))
+    #define sc_pool_cas(p, old, v)                                             \
+        (InterlockedCompareExchange64((LONG64 *) (p), (LONG64) (v),            \
+                                      (LONG64) (old)) == (LONG64) (old))
+    #define sc_pool_add(p, v)                                                  \
+        ((uint64_t) InterlockedExchangeAdd64((LONG64 *) (p), (LONG64) (v)) +   \
+         (v))
+    #define sc_pool_sub(p, v) sc_pool_add(p, -(LONG64) (v))
+#else
+    #define sc_pool_load(p)         __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_pool_load_acq(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+    #define sc_pool_store(p, v)     __atomic_store_n(p, v, __ATOMIC_RELAXED)
+    #define sc_pool_store_rel(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+    #define sc_pool_load_ptr(p)     __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_pool_store_ptr(p, v) __atomic_store_n(p, v, __ATOMIC_RELAXED)
+    #define sc_pool_load_sc(p)      __atomic_load_n(p, __ATOMIC_SEQ_CST)
+    #define sc_pool_xchg(p, v)      __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST)
+    #define sc_pool_cas(p, old, v)                                             \
+        __atomic_compare_exchange_n(p, &(int64_t){old}, v, false,              \
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)
+    #define sc_pool_add(p, v)   __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST)
+    #define sc_pool_sub(p, v)   __atomic_sub_fetch(p, v, __ATOMIC_SEQ_CST)
+#endif
+
+#define SC_POOL_DEQUE_MASK (SC_POOL_DEQUE_SIZE - 1)
+
+// Worker of the current thread, NULL if the thread is not a pool worker.
+static thread_local struct sc_pool_worker *sc_pool_current;
+
+static void sc_pool_errstr(struct sc_pool *p, const char *str)
+{
+    snprintf(p->err, sizeof(p->err), "%s", str);
+}
+
+static uint32_t sc_pool_cpus(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (uint32_t) n : 1;
+#endif
+}
+
+/**
+ * Chase-Lev deque, "Correct and Efficient Work-Stealing for Weak Memory
+ * Models", Lê et al. Owner pushes and takes from the bottom, other threads
+ * steal from the top. Fixed capacity, push fails if the deque is full.
+ *
+ * The seq_cst fences of the paper are replaced with seq_cst operations on
+ * 'top' and 'bottom', thread sanitizer doesn't support standalone fences.
+ */
+static bool sc_pool_push(struct sc_pool_deque *d, struct sc_pool_task *t)
+{
+    int64_t b = sc_pool_load(&d->bottom);
+    int64_t top = sc_pool_load_acq(&d->top);
+
+    if (b - top >= SC_POOL_DEQUE_SIZE) {
+        return false;
+    }
+
+    sc_pool_store_ptr(&d->tasks[b & SC_POOL_DEQUE_MASK], t);
+    sc_pool_store_rel(&d->bottom, b + 1);
+
+    return true;
+}
+
+static struct sc_pool_task *sc_pool_take(struct sc_pool_deque *d)
+{
+    int64_t top, b = sc_pool_load(&d->bottom) - 1;
+    struct sc_pool_task *t = NULL;
+
+    sc_pool_xchg(&d->bottom, b);
+    top = sc_pool_load_sc(&d->top);
+
+    if (top > b) {
+        sc_pool_store(&d->bottom, b + 1);
+        return NULL;
+    }
+
+    t = sc_pool_load_ptr(&d->tasks[b & SC_POOL_DEQUE_MASK]);
+    if (top == b) {
+        // Last item, race with stealers.
+        if (!sc_pool_cas(&d->top, top, top + 1)) {
+            t = NULL;
+        }
+        sc_pool_store(&d->bottom, b + 1);
+    }
+
+    return t;
+}
+
+static struct sc_pool_task *sc_pool_steal(struct sc_pool_deque *d)
+{
+    int64_t b, top = sc_pool_load_sc(&d->top);
+    struct sc_pool_task *t;
+
+    b = sc_pool_load_sc(&d->bottom);
+
+    if (top >= b) {
+        return NULL;
+    }
+
+    t = sc_pool_load_ptr(&d->tasks[top & SC_POOL_DEQUE_MASK]);
+    if (!sc_pool_cas(&d->top, top, top + 1)) {
+        return NULL;
+    }
+
+    return t;
+}
+
+static bool sc_pool_deque_empty(struct sc_pool_deque *d)
+{
+    return sc_pool_load_acq(&d->top) >= sc_pool_load_acq(&d->bottom);
+}
+
+static struct sc_pool_task *sc_pool_pop(struct sc_pool *p)
+{
+    struct sc_pool_task *t;
+
+    if (sc_pool_load(&p->pending) == 0) {
+        return NULL;
+    }
+
+    sc_mutex_lock(&p->mtx);
+    t = p->head;
+    if (t != NULL) {
+        p->head = t->next;
+        if (p->head == NULL) {
+            p->tail = NULL;
+        }
+        sc_pool_sub(&p->pending, 1);
+    }
+    sc_mutex_unlock(&p->mtx);
+
+    return t;
+}
+
+// Own deque first, then the global queue, then steal from other workers.
+static struct sc_pool_task *sc_pool_find(struct sc_pool *p,
+                                         struct sc_pool_worker *w)
+{
+    uint32_t start;
+    struct sc_pool_task *t;
+    struct sc_pool_worker *victim;
+
+    if (w != NULL && (t = sc_pool_take(&w->deque)) != NULL) {
+        return t;
+    }
+
+    if ((t = sc_pool_pop(p)) != NULL) {
+        return t;
+    }
+
+    start = w != NULL ? w->id + 1 : (uint32_t) sc_pool_add(&p->steal, 1);
+
+    for (uint32_t i = 0; i < p->count; i++) {
+        victim = &p->workers[(start + i) % p->count];
+        if (victim == w) {
+            continue;
+        }
+
+        if ((t = sc_pool_steal(&victim->deque)) != NULL) {
+            return t;
+        }
+    }
+
+    return NULL;
+}
+
+static bool sc_pool_has_work(struct sc_pool *p)
+{
+    if (sc_pool_load_acq(&p->pending) != 0) {
+        return true;
+    }
+
+    for (uint32_t i = 0; i < p->count; i++) {
+        if (!sc_pool_deque_empty(&p->workers[i].deque)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void sc_pool_run(struct sc_pool_task *t)
+{
+    struct sc_pool_wait *wait = t->wait;
+
+    // Task memory may be reused by 'fn', don't touch 't' after this line.
+    t->fn(t->arg);
+
+    if (wait != NULL) {
+        sc_mutex_lock(&wait->mtx);
+        if (sc_pool_sub(&wait->count, 1) == 0) {
+            sc_cond_signal(&wait->cond, NULL);
+        }
+        sc_mutex_unlock(&wait->mtx);
+    }
+}
+
+// Wakes up a parked worker if there is any.
+static void sc_pool_wake(struct sc_pool *p)
+{
+    struct sc_pool_worker *w = NULL;
+
+    // Pairs with the increment in sc_pool_park(), both are RMWs on
+    // 'sleepers', either we see the sleeper or the sleeper sees the task.
+    if (sc_pool_add(&p->sleepers, 0) == 0) {
+        return;
+    }
+
+    sc_mutex_lock(&p->mtx);
+    if (p->idle_count > 0) {
+        w = &p->workers[p->idle[--p->idle_count]];
+        w->parked = false;
+        sc_pool_sub(&p->sleepers, 1);
+    }
+    sc_mutex_unlock(&p->mtx);
+
+    if (w != NULL) {
+        sc_cond_signal(&w->cond, NULL);
+    }
+}
+
+// Returns 'true' if the worker should exit.
+static bool sc_pool_park(struct sc_pool *p, struct sc_pool_worker *w)
+{
+    bool parked;
+
+    sc_mutex_lock(&p->mtx);
+    if (p->head != NULL) {
+        sc_mutex_unlock(&p->mtx);
+        return false;
+    }
+
+    if (p->stop) {
+        sc_mutex_unlock(&p->mtx);
+        return true;
+    }
+
+    w->parked = true;
+    p->idle[p->idle_count++] = w->id;
+    sc_pool_add(&p->sleepers, 1);
+    sc_mutex_unlock(&p->mtx);
+
+    // A task might be pushed to a deque before we became visible as a
+    // sleeper, check again before going to sleep.
+    if (sc_pool_has_work(p)) {
+        sc_mutex_lock(&p->mtx);
+        parked = w->parked;
+        if (parked) {
+            for (uint32_t i = 0; i < p->idle_count; i++) {
+                if (p->idle[i] == w->id) {
+                    p->idle[i] = p->idle[--p->idle_count];
+                    break;
+                }
+            }
+            w->parked = false;
+            sc_pool_sub(&p->sleepers, 1);
+        }
+        sc_mutex_unlock(&p->mtx);
+
+        // If somebody else removed us from idle list, it will signal us,
+        // consume the signal below.
+        if (parked) {
+            return false;
+        }
+    }
+
+    sc_cond_wait(&w->cond);
+
+    return false;
+}
+
+static void *sc_pool_worker_fn(void *arg)
+{
+    struct sc_pool_worker *w = arg;
+    struct sc_pool *p = w->pool;
+    struct sc_pool_task *t;
+
+    sc_pool_current = w;
+
+    while (true) {
+        t = sc_pool_find(p, w);
+        if (t != NULL) {
+            sc_pool_run(t);
+            continue;
+        }
+
+        if (sc_pool_park(p, w)) {
+            break;
+        }
+    }
+
+    sc_pool_current = NULL;
+
+    return NULL;
+}
+
+// Stops 'started' worker threads and releases resources of 'count' workers.
+static int sc_pool_cleanup(struct sc_pool *p, uint32_t count, uint32_t started)
+{
+    int rc = 0;
+    struct sc_pool_worker *w;
+
+    sc_mutex_lock(&p->mtx);
+    p->stop = true;
+    sc_mutex_unlock(&p->mtx);
+
+    for (uint32_t i = 0; i < started; i++) {
+        sc_cond_signal(&p->workers[i].cond, NULL);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        w = &p->workers[i];
+
+        if (i < started && sc_thread_term(&w->thread) != 0) {
+            sc_pool_errstr(p, sc_thread_err(&w->thread));
+            rc = -1;
+        }
+
+        sc_cond_term(&w->cond);
+        sc_pool_free(w->deque.tasks);
+    }
+
+    sc_pool_free(p->workers);
+    sc_pool_free(p->idle);
+    sc_mutex_term(&p->mtx);
+
+    p->workers = NULL;
+    p->idle = NULL;
+    p->count = 0;
+
+    return rc;
+}
+
+int sc_pool_init(struct sc_pool *p, uint32_t threads, bool pin)
+{
+    char name[16];
+    uint32_t i = 0, cpu, cpus;
+    struct sc_pool_worker *w;
+
+    *p = (struct sc_pool){0};
+    threads = threads != 0 ? threads : sc_pool_cpus();
+
+    if (sc_mutex_init(&p->mtx) != 0) {
+        sc_pool_errstr(p, "Failed to create mutex.");
+        return -1;
+    }
+
+    p->workers = sc_pool_malloc(sizeof(*p->workers) * threads);
+    p->idle = sc_pool_malloc(sizeof(*p->idle) * threads);
+    if (p->workers == NULL || p->idle == NULL) {
+        sc_pool_errstr(p, "Out of memory.");
+        goto err_worker;
+    }
+
+    for (i = 0; i < threads; i++) {
+        w = &p->workers[i];
+        *w = (struct sc_pool_worker){.pool = p, .id = i};
+
+        w->deque.tasks = sc_pool_malloc(sizeof(*w->deque.tasks) *
+                                        SC_POOL_DEQUE_SIZE);
+        if (w->deque.tasks == NULL) {
+            sc_pool_errstr(p, "Out of memory.");
+            goto err_worker;
+        }
+
+        if (sc_cond_init(&w->cond) != 0) {
+            sc_pool_free(w->deque.tasks);
+            sc_pool_errstr(p, "Failed to create cond.");
+            goto err_worker;
+        }
+
+        sc_thread_init(&w->thread);
+    }
+
+    p->count = threads;
+    cpus = sc_pool_cpus();
+
+    for (i = 0; i < threads; i++) {
+        w = &p->workers[i];
+        cpu = i % cpus;
+
+        snprintf(name, sizeof(name), "pool-%u", i);
+        sc_thread_set_name(&w->thread, name);
+
+        if (pin) {
+            sc_thread_set_cpus(&w->thread, &cpu, 1);
+        }
+
+        if (sc_thread_start(&w->thread, sc_pool_worker_fn, w) != 0) {
+            sc_pool_errstr(p, sc_thread_err(&w->thread));
+            sc_pool_cleanup(p, threads, i);
+            return -1;
+        }
+    }
+
+    return 0;
+
+err_worker:
+    sc_pool_cleanup(p, p->workers != NULL ? i : 0, 0);
+    return -1;
+}
+
+int sc_pool_term(struct sc_pool *p)
+{
+    if (p->workers == NULL) {
+        return 0;
+    }
+
+    return sc_pool_cleanup(p, p->count, p->count);
+}
+
+const char *sc_pool_err(struct sc_pool *p)
+{
+    return p->err;
+}
+
+uint32_t sc_pool_threads(struct sc_pool *p)
+{
+    return p->count;
+}
+
+void sc_pool_task_init(struct sc_pool_task *t, void (*fn)(void *), void *arg)
+{
+    *t = (struct sc_pool_task){.fn = fn, .arg = arg};
+}
+
+void sc_pool_submit(struct sc_pool *p, struct sc_pool_task *t,
+                    struct sc_pool_wait *wait)
+{
+    struct sc_pool_worker *w = sc_pool_current;
+
+    t->wait = wait;
+    t->next = NULL;
+
+    if (wait != NULL) {
+        sc_pool_add(&wait->count, 1);
+    }
+
+    if (w == NULL || w->pool != p || !sc_pool_push(&w->deque, t)) {
+        sc_mutex_lock(&p->mtx);
+        if (p->tail != NULL) {
+            p->tail->next = t;
+        } else {
+            p->head = t;
+        }
+        p->tail = t;
+        sc_pool_add(&p->pending, 1);
+        sc_mutex_unlock(&p->mtx);
+    }
+
+    sc_pool_wake(p);
+}
+
+void sc_pool_wait(struct sc_pool *p, struct sc_pool_wait *wait)
+{
+    uint64_t count;
+    struct sc_pool_task *t;
+    struct sc_pool_worker *w = sc_pool_current;
+
+    if (w != NULL && w->pool != p) {
+        w = NULL;
+    }
+
+    while (true) {
+        // Read under the lock, so the last task is done with 'wait' when we
+        // see zero and 'wait' can be destroyed after we return.
+        sc_mutex_lock(&wait->mtx);
+        count = sc_pool_load(&wait->count);
+        sc_mutex_unlock(&wait->mtx);
+
+        if (count == 0) {
+            return;
+        }
+
+        t = sc_pool_find(p, w);
+        if (t != NULL) {
+            sc_pool_run(t);
+            continue;
+        }
+
+        sc_cond_wait(&wait->cond);
+    }
+}
+
+int sc_pool_wait_init(struct sc_pool_wait *wait)
+{
+    wait->count = 0;
+
+    if (sc_mutex_init(&wait->mtx) != 0) {
+        return -1;
+    }
+
+    if (sc_cond_init(&wait->cond) != 0) {
+        sc_mutex_term(&wait->mtx);
+        return -1;
+    }
+
+    return 0;
+}
+
+int sc_pool_wait_term(struct sc_pool_wait *wait)
+{
+    int rc = 0;
+
+    rc |= sc_cond_term(&wait->cond);
+    rc |= sc_mutex_term(&wait->mtx);
+
+    return rc != 0 ? -1 : 0;
+}
+
+struct sc_pool_range
+{
+    struct sc_pool *pool;
+    void (*fn)(void *, size_t, size_t);
+    void *arg;
+    size_t begin;
+    size_t end;
+    size_t grain;
+};
+
+static void sc_pool_range_run(void *arg)
+{
+    struct sc_pool_range *r = arg;
+    struct sc_pool_range left, right;
+    struct sc_pool_task task;
+    struct sc_pool_wait wait;
+    size_t mid;
+
+    if (r->end - r->begin <= r->grain || sc_pool_wait_init(&wait) != 0) {
+        r->fn(r->arg, r->begin, r->end);
+        return;
+    }
+
+    // Submit the right half, so it can be stolen, and run the left half.
+    mid = r->begin + (r->end - r->begin) / 2;
+    left = *r;
+    left.end = mid;
+    right = *r;
+    right.begin = mid;
+
+    sc_pool_task_init(&task, sc_pool_range_run, &right);
+    sc_pool_submit(r->pool, &task, &wait);
+
+    sc_pool_range_run(&left);
+
+    sc_pool_wait(r->pool, &wait);
+    sc_pool_wait_term(&wait);
+}
+
+void sc_pool_for(struct sc_pool *p, size_t n, size_t grain,
+                 void (*fn)(void *arg, size_t begin, size_t end), void *arg)
+{
+    size_t min;
+    struct sc_pool_range r = {
+            .pool = p,
+            .fn = fn,
+            .arg = arg,
+            .begin = 0,
+            .end = n,
+            .grain = grain,
+    };
+
+    if (n == 0) {
+        return;
+    }
+
+    // Bound the task count, waiting threads run other tasks, so the stack
+    // depth may grow with the task count.
+    min = n / ((size_t) p->count * (grain == 0 ? 8 : 64));
+    r.grain = grain > min ? grain : min;
+    r.grain = r.grain == 0 ? 1 : r.grain;
+
+    sc_pool_range_run(&r);
+}
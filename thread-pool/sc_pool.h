@@ -0,0 +1,222 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_POOL_H
+#define SC_POOL_H
+
+#include "sc_cond.h"
+#include "sc_mutex.h"
+#include "sc_thread.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#else
+    #define sc_pool_malloc malloc
+    #define sc_pool_free   free
+#endif
+
+// Per worker deque capacity, must be a power of two. When a worker's deque
+// is full, tasks go to the global queue.
+#ifndef SC_POOL_DEQUE_SIZE
+    #define SC_POOL_DEQUE_SIZE 4096
+#endif
+
+#ifndef SC_POOL_CACHE_LINE
+    #define SC_POOL_CACHE_LINE 64
+#endif
+
+struct sc_pool_wait;
+
+/**
+ * Task, memory is owned by the caller and must stay valid until the task
+ * runs. Initialize with sc_pool_task_init(), submit with sc_pool_submit().
+ */
+struct sc_pool_task
+{
+    void (*fn)(void *arg);
+    void *arg;
+    struct sc_pool_wait *wait;
+    struct sc_pool_task *next;
+};
+
+/**
+ * Wait group, counts submitted tasks which are not completed yet.
+ */
+struct sc_pool_wait
+{
+    uint64_t count;
+    struct sc_mutex mtx;
+    struct sc_cond cond;
+};
+
+// Internals
+struct sc_pool_deque
+{
+    int64_t top;
+    char pad0[SC_POOL_CACHE_LINE - sizeof(int64_t)];
+    int64_t bottom;
+    char pad1[SC_POOL_CACHE_LINE - sizeof(int64_t)];
+    struct sc_pool_task **tasks;
+};
+
+struct sc_pool_worker
+{
+    struct sc_pool_deque deque;
+    struct sc_pool *pool;
+    struct sc_thread thread;
+    struct sc_cond cond;
+    uint32_t id;
+    bool parked;
+};
+
+struct sc_pool
+{
+    struct sc_pool_worker *workers;
+    uint32_t count;
+
+    struct sc_mutex mtx;
+    struct sc_pool_task *head;
+    struct sc_pool_task *tail;
+    uint32_t *idle;
+    uint32_t idle_count;
+    bool stop;
+
+    uint64_t pending;
+    uint64_t sleepers;
+    uint64_t steal;
+
+    char err[128];
+};
+
+/**
+ * Create thread pool. Each worker has a Chase-Lev work-stealing deque, tasks
+ * submitted from a worker go to its own deque, tasks submitted from other
+ * threads go to the global queue. Idle workers steal from each other and
+ * park on a sc_cond when there is no work.
+ *
+ * @param p       pool
+ * @param threads worker thread count, '0' for online cpu count.
+ * @param pin     'true' to pin worker 'i' to cpu 'i % cpu count', see
+ *                sc_thread_set_cpus(). Workers are named "pool-<i>".
+ * @return        '0' on success, '-1' on error, call sc_pool_err() for error
+ *                string.
+ */
+int sc_pool_init(struct sc_pool *p, uint32_t threads, bool pin);
+
+/**
+ * Stop and join worker threads. Tasks in the queues are executed before the
+ * workers exit. No task may be submitted after this call.
+ *
+ * @param p pool
+ * @return  '0' on success, '-1' on error, call sc_pool_err() for error
+ *          string.
+ */
+int sc_pool_term(struct sc_pool *p);
+
+/**
+ * @param p pool
+ * @return  last error message
+ */
+const char *sc_pool_err(struct sc_pool *p);
+
+/**
+ * @param p pool
+ * @return  worker thread count
+ */
+uint32_t sc_pool_threads(struct sc_pool *p);
+
+/**
+ * @param t   task
+ * @param fn  function to run on a worker thread
+ * @param arg argument to pass 'fn'
+ */
+void sc_pool_task_init(struct sc_pool_task *t, void (*fn)(void *), void *arg);
+
+/**
+ * Submit task, it never blocks and never allocates memory. If 'wait' is not
+ * NULL, task is added to the wait group and sc_pool_wait() returns after
+ * the task is completed.
+ *
+ * @param p    pool
+ * @param t    task, must not be submitted again until it runs.
+ * @param wait wait group, can be NULL.
+ */
+void sc_pool_submit(struct sc_pool *p, struct sc_pool_task *t,
+                    struct sc_pool_wait *wait);
+
+/**
+ * Wait until all tasks in the wait group are completed. Calling thread runs
+ * pending tasks while waiting, so tasks can wait for the tasks they submit
+ * without blocking a worker. Only one thread may wait on a wait group at a
+ * time.
+ *
+ * @param p    pool
+ * @param wait wait group
+ */
+void sc_pool_wait(struct sc_pool *p, struct sc_pool_wait *wait);
+
+/**
+ * @param wait wait group
+ * @return     '0' on success, '-1' on error.
+ */
+int sc_pool_wait_init(struct sc_pool_wait *wait);
+
+/**
+ * @param wait wait group, must have no pending tasks.
+ * @return     '0' on success, '-1' on error.
+ */
+int sc_pool_wait_term(struct sc_pool_wait *wait);
+
+/**
+ * Parallel for, calls 'fn' for ranges of [0, n) on the pool and returns after
+ * all ranges are done. The range is split in halves recursively until it is
+ * not larger than 'grain', so idle workers steal large ranges first. Calling
+ * thread runs ranges as well, it can be a worker, e.g. nested parallel for.
+ *
+ * static void add(void *arg, size_t begin, size_t end)
+ * {
+ *     int *arr = arg;
+ *
+ *     for (size_t i = begin; i < end; i++) {
+ *         arr[i]++;
+ *     }
+ * }
+ *
+ * sc_pool_for(&pool, 1000000, 4096, add, arr);
+ *
+ * @param p     pool
+ * @param n     range end
+ * @param grain ranges are not split further once they are not larger than
+ *              'grain', '0' to split into ~8 ranges per worker. Ranges are
+ *              never split into more than ~64 ranges per worker.
+ * @param fn    function to run
+ * @param arg   argument to pass 'fn'
+ */
+void sc_pool_for(struct sc_pool *p, size_t n, size_t grain,
+                 void (*fn)(void *arg, size_t begin, size_t end), void *arg);
+
+#endif
@@ -22,13 +22,70 @@
  * SOFTWARE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
 #include "sc_thread.h"
 
+#include <stdio.h>
 #include <string.h>
 
+#ifdef SC_THREAD_HAVE_LOG
+    #include "sc_log.h"
+#endif
+
 void sc_thread_init(struct sc_thread *thread)
 {
     thread->id = 0;
+    thread->attr = (struct sc_thread_attr){.numa = -1};
+}
+
+void sc_thread_set_name(struct sc_thread *thread, const char *name)
+{
+    snprintf(thread->attr.name, sizeof(thread->attr.name), "%s", name);
+}
+
+int sc_thread_set_cpus(struct sc_thread *thread, const uint32_t *cpus,
+                       uint32_t count)
+{
+    struct sc_thread_attr *attr = &thread->attr;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (cpus[i] >= SC_THREAD_CPU_MAX) {
+            strncpy(thread->err, "Invalid cpu id.", sizeof(thread->err) - 1);
+            return -1;
+        }
+    }
+
+    memset(attr->cpus, 0, sizeof(attr->cpus));
+    for (uint32_t i = 0; i < count; i++) {
+        attr->cpus[cpus[i] / 64] |= (uint64_t) 1 << (cpus[i] % 64);
+    }
+
+    attr->has_cpus = count > 0;
+
+    return 0;
+}
+
+void sc_thread_set_numa(struct sc_thread *thread, int node)
+{
+    thread->attr.numa = node;
+}
+
+void sc_thread_set_stack_size(struct sc_thread *thread, size_t size)
+{
+    thread->attr.stack_size = size;
+}
+
+void sc_thread_set_priority(struct sc_thread *thread, int priority)
+{
+    thread->attr.priority = priority;
+}
+
+static bool sc_thread_has_cpu(struct sc_thread_attr *attr, uint32_t cpu)
+{
+    return (attr->cpus[cpu / 64] >> (cpu % 64)) & 1u;
 }
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -55,25 +112,92 @@ unsigned int __stdcall sc_thread_fn(void *arg)
 {
     struct sc_thread *thread = arg;
 
+#ifdef SC_THREAD_HAVE_LOG
+    if (thread->attr.name[0] != '\0') {
+        sc_log_set_thread_name(thread->attr.name);
+    }
+#endif
+
     thread->ret = thread->fn(thread->arg);
     return 0;
 }
 
+// SetThreadDescription() is available on Windows 10 1607 and later.
+static void sc_thread_set_desc(HANDLE id, const char *name)
+{
+    typedef HRESULT(WINAPI * desc_fn)(HANDLE, PCWSTR);
+    wchar_t wname[sizeof(((struct sc_thread_attr *) 0)->name)];
+    desc_fn fn;
+
+    fn = (desc_fn) GetProcAddress(GetModuleHandleA("kernel32.dll"),
+                                  "SetThreadDescription");
+    if (fn == NULL) {
+        return;
+    }
+
+    if (MultiByteToWideChar(CP_UTF8, 0, name, -1, wname, 16) != 0) {
+        fn(id, wname);
+    }
+}
+
 int sc_thread_start(struct sc_thread *thread, void *(*fn)(void *), void *arg)
 {
-    int rc = 0;
+    int priority;
+    DWORD_PTR mask = 0;
+    ULONGLONG node_mask;
+    struct sc_thread_attr *attr = &thread->attr;
 
     thread->fn = fn;
     thread->arg = arg;
 
-    thread->id =
-            (HANDLE) _beginthreadex(NULL, 0, sc_thread_fn, thread, 0, NULL);
+    // Start suspended, so attributes are applied before 'fn' runs.
+    thread->id = (HANDLE) _beginthreadex(NULL, (unsigned) attr->stack_size,
+                                         sc_thread_fn, thread,
+                                         CREATE_SUSPENDED, NULL);
     if (thread->id == 0) {
         sc_thread_errstr(thread);
-        rc = -1;
+        return -1;
     }
 
-    return rc;
+    if (attr->has_cpus) {
+        mask = (DWORD_PTR) attr->cpus[0];
+    } else if (attr->numa >= 0) {
+        if (!GetNumaNodeProcessorMask((UCHAR) attr->numa, &node_mask)) {
+            goto error;
+        }
+        mask = (DWORD_PTR) node_mask;
+    }
+
+    if (mask != 0 && SetThreadAffinityMask(thread->id, mask) == 0) {
+        goto error;
+    }
+
+    if (attr->priority != 0) {
+        priority = attr->priority;
+        priority = priority < THREAD_PRIORITY_LOWEST ? THREAD_PRIORITY_LOWEST :
+                                                        priority;
+        priority = priority > THREAD_PRIORITY_HIGHEST ?
+                           THREAD_PRIORITY_HIGHEST :
+                           priority;
+        SetThreadPriority(thread->id, priority);
+    }
+
+    if (attr->name[0] != '\0') {
+        sc_thread_set_desc(thread->id, attr->name);
+    }
+
+    ResumeThread(thread->id);
+
+    return 0;
+
+error:
+    sc_thread_errstr(thread);
+    // Thread has not run any code yet.
+    TerminateThread(thread->id, 0);
+    CloseHandle(thread->id);
+    thread->id = 0;
+
+    return -1;
 }
 
 int sc_thread_join(struct sc_thread *thread, void **ret)
@@ -108,25 +232,183 @@ int sc_thread_join(struct sc_thread *thread, void **ret)
 }
 #else
 
+#if defined(__linux__)
+    #include <sched.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+    #define SC_THREAD_MPOL_PREFERRED 1
+
+// Reads cpus of a NUMA node from sysfs, e.g "0-7,16-23".
+static int sc_thread_numa_cpus(int node, cpu_set_t *set, size_t size)
+{
+    int n, first, last;
+    char path[128];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             node);
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    while ((n = fscanf(fp, "%d-%d", &first, &last)) >= 1) {
+        last = n == 1 ? first : last;
+        for (int i = first; i <= last && i < SC_THREAD_CPU_MAX; i++) {
+            CPU_SET_S((size_t) i, size, set);
+        }
+
+        if (fgetc(fp) != ',') {
+            break;
+        }
+    }
+
+    fclose(fp);
+
+    return CPU_COUNT_S(size, set) > 0 ? 0 : -1;
+}
+
+static int sc_thread_affinity(struct sc_thread *thread, pthread_attr_t *attr)
+{
+    int rc = 0;
+    size_t size = CPU_ALLOC_SIZE(SC_THREAD_CPU_MAX);
+    cpu_set_t *set;
+
+    if (!thread->attr.has_cpus && thread->attr.numa < 0) {
+        return 0;
+    }
+
+    set = CPU_ALLOC(SC_THREAD_CPU_MAX);
+    if (set == NULL) {
+        strncpy(thread->err, "Out of memory.", sizeof(thread->err) - 1);
+        return -1;
+    }
+
+    CPU_ZERO_S(size, set);
+
+    if (thread->attr.has_cpus) {
+        for (uint32_t i = 0; i < SC_THREAD_CPU_MAX; i++) {
+            if (sc_thread_has_cpu(&thread->attr, i)) {
+                CPU_SET_S(i, size, set);
+            }
+        }
+    } else if (sc_thread_numa_cpus(thread->attr.numa, set, size) != 0) {
+        strncpy(thread->err, "Invalid NUMA node.", sizeof(thread->err) - 1);
+        rc = -1;
+    }
+
+    if (rc == 0) {
+        rc = pthread_attr_setaffinity_np(attr, size, set);
+        if (rc != 0) {
+            strncpy(thread->err, strerror(rc), sizeof(thread->err) - 1);
+            rc = -1;
+        }
+    }
+
+    CPU_FREE(set);
+
+    return rc;
+}
+
+// Runs on the new thread, before 'fn'. Failures are ignored.
+static void sc_thread_apply(struct sc_thread *thread)
+{
+    unsigned long mask;
+    struct sc_thread_attr *attr = &thread->attr;
+
+    if (attr->name[0] != '\0') {
+        pthread_setname_np(pthread_self(), attr->name);
+    }
+
+    if (attr->priority != 0) {
+        setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), -attr->priority);
+    }
+
+    if (attr->numa >= 0 && attr->numa < (int) sizeof(mask) * 8) {
+        mask = 1ul << (unsigned) attr->numa;
+        syscall(SYS_set_mempolicy, SC_THREAD_MPOL_PREFERRED, &mask,
+                sizeof(mask) * 8);
+    }
+}
+
+#else
+
+static int sc_thread_affinity(struct sc_thread *thread, pthread_attr_t *attr)
+{
+    (void) thread;
+    (void) attr;
+    (void) sc_thread_has_cpu;
+
+    return 0;
+}
+
+static void sc_thread_apply(struct sc_thread *thread)
+{
+    #if defined(__APPLE__)
+    if (thread->attr.name[0] != '\0') {
+        pthread_setname_np(thread->attr.name);
+    }
+    #else
+    (void) thread;
+    #endif
+}
+
+#endif
+
+static void *sc_thread_fn(void *arg)
+{
+    struct sc_thread *thread = arg;
+
+    sc_thread_apply(thread);
+
+#ifdef SC_THREAD_HAVE_LOG
+    if (thread->attr.name[0] != '\0') {
+        sc_log_set_thread_name(thread->attr.name);
+    }
+#endif
+
+    return thread->fn(thread->arg);
+}
+
 int sc_thread_start(struct sc_thread *thread, void *(*fn)(void *), void *arg)
 {
     int rc;
     pthread_attr_t attr;
 
+    thread->fn = fn;
+    thread->arg = arg;
+
     rc = pthread_attr_init(&attr);
     if (rc != 0) {
-        strncpy(thread->err, strerror(rc), sizeof(thread->err));
+        strncpy(thread->err, strerror(rc), sizeof(thread->err) - 1);
         return -1;
     }
 
     // This may only fail with EINVAL.
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
 
-    rc = pthread_create(&thread->id, &attr, fn, arg);
+    if (thread->attr.stack_size != 0) {
+        rc = pthread_attr_setstacksize(&attr, thread->attr.stack_size);
+        if (rc != 0) {
+            strncpy(thread->err, strerror(rc), sizeof(thread->err) - 1);
+            goto out;
+        }
+    }
+
+    rc = sc_thread_affinity(thread, &attr);
+    if (rc != 0) {
+        goto out;
+    }
+
+    rc = pthread_create(&thread->id, &attr, sc_thread_fn, thread);
     if (rc != 0) {
-        strncpy(thread->err, strerror(rc), sizeof(thread->err));
+        strncpy(thread->err, strerror(rc), sizeof(thread->err) - 1);
     }
 
+out:
     // This may only fail with EINVAL.
     pthread_attr_destroy(&attr);
 
@@ -144,7 +426,7 @@ int sc_thread_join(struct sc_thread *thread, void **ret)
 
     rc = pthread_join(thread->id, &val);
     if (rc != 0) {
-        strncpy(thread->err, strerror(rc), sizeof(thread->err));
+        strncpy(thread->err, strerror(rc), sizeof(thread->err) - 1);
     }
 
     thread->id = 0;
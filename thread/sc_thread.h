@@ -24,6 +24,26 @@
 #ifndef SC_THREAD_H
 #define SC_THREAD_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Max cpu id + 1 for sc_thread_set_cpus().
+#ifndef SC_THREAD_CPU_MAX
+    #define SC_THREAD_CPU_MAX 1024
+#endif
+
+// Start attributes, set by sc_thread_set_*() before sc_thread_start().
+struct sc_thread_attr
+{
+    char name[16];
+    uint64_t cpus[SC_THREAD_CPU_MAX / 64];
+    bool has_cpus;
+    int numa;
+    size_t stack_size;
+    int priority;
+};
+
 #if defined(_WIN32) || defined(_WIN64)
 
 #include <windows.h>
@@ -34,6 +54,7 @@ struct sc_thread
     void* (*fn)(void*);
     void* arg;
     void* ret;
+    struct sc_thread_attr attr;
     char err[64];
 };
 
@@ -44,6 +65,9 @@ struct sc_thread
 struct sc_thread
 {
     pthread_t id;
+    void *(*fn)(void *);
+    void *arg;
+    struct sc_thread_attr attr;
     char err[128];
 };
 
@@ -67,6 +91,57 @@ int sc_thread_term(struct sc_thread* thread);
  */
 const char* sc_thread_err(struct sc_thread * thread);
 
+/**
+ * Set OS visible thread name, truncated to 15 characters. If compiled with
+ * SC_THREAD_HAVE_LOG, it is passed to sc_log_set_thread_name() as well.
+ * Best effort, silently ignored if the platform does not support it.
+ *
+ * @param thread thread
+ * @param name   name
+ */
+void sc_thread_set_name(struct sc_thread *thread, const char *name);
+
+/**
+ * Set cpus the thread may run on. Affinity is applied when the thread is
+ * created, before it runs 'fn'. Linux and Windows only, ignored on other
+ * platforms. Windows uses the first 64 cpus.
+ *
+ * @param thread thread
+ * @param cpus   cpu ids
+ * @param count  cpu count, '0' clears the cpu set.
+ * @return       '0' on success, '-1' if a cpu id is not less than
+ *               SC_THREAD_CPU_MAX.
+ */
+int sc_thread_set_cpus(struct sc_thread *thread, const uint32_t *cpus,
+                       uint32_t count);
+
+/**
+ * Run the thread on the cpus of a NUMA node and prefer memory allocations
+ * from that node. Linux and Windows only, ignored on other platforms.
+ * If cpus are set with sc_thread_set_cpus() as well, cpus are used.
+ *
+ * @param thread thread
+ * @param node   NUMA node, '-1' to clear.
+ */
+void sc_thread_set_numa(struct sc_thread *thread, int node);
+
+/**
+ * @param thread thread
+ * @param size   stack size in bytes, '0' for default.
+ */
+void sc_thread_set_stack_size(struct sc_thread *thread, size_t size);
+
+/**
+ * Scheduling priority, '0' is the default, higher runs first. On Linux, it
+ * is applied as "nice = -priority", negative nice values need privileges.
+ * On Windows, clamped to THREAD_PRIORITY_LOWEST..THREAD_PRIORITY_HIGHEST.
+ * Best effort, failure is silently ignored.
+ *
+ * @param thread   thread
+ * @param priority priority
+ */
+void sc_thread_set_priority(struct sc_thread *thread, int priority);
+
 /**
  * @param thread thread
  * @return       '0' on success,
@@ -1,3 +1,7 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE
+#endif
+
 #include "sc_thread.h"
 
 #include <assert.h>
@@ -102,9 +106,92 @@ void fail_test()
 }
 #endif
 
+#if defined(__linux__)
+    #include <sched.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+void *attr_fn(void *arg)
+{
+    char name[16];
+    cpu_set_t set;
+    size_t stack;
+    pthread_attr_t attr;
+    struct sc_thread *thread = arg;
+
+    assert(pthread_getname_np(pthread_self(), name, sizeof(name)) == 0);
+    assert(strcmp(name, "worker-name-is-") == 0);
+
+    assert(pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0);
+    assert(CPU_COUNT(&set) == 1 && CPU_ISSET(0, &set));
+
+    assert(pthread_getattr_np(pthread_self(), &attr) == 0);
+    assert(pthread_attr_getstacksize(&attr, &stack) == 0);
+    assert(stack >= 1024 * 1024);
+    pthread_attr_destroy(&attr);
+
+    // priority '-1' is nice '1', allowed without privileges.
+    assert(getpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid)) == 1);
+
+    return thread;
+}
+
+void *numa_fn(void *arg)
+{
+    cpu_set_t set;
+
+    assert(pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0);
+    assert(CPU_COUNT(&set) > 0);
+
+    return arg;
+}
+
+void test_attr()
+{
+    void *ret;
+    uint32_t cpu = 0, invalid = SC_THREAD_CPU_MAX;
+    struct sc_thread thread;
+
+    sc_thread_init(&thread);
+    sc_thread_set_name(&thread, "worker-name-is-too-long");
+    assert(sc_thread_set_cpus(&thread, &invalid, 1) == -1);
+    assert(sc_thread_set_cpus(&thread, &cpu, 1) == 0);
+    sc_thread_set_stack_size(&thread, 1024 * 1024);
+    sc_thread_set_priority(&thread, -1);
+    assert(sc_thread_start(&thread, attr_fn, &thread) == 0);
+    assert(sc_thread_join(&thread, &ret) == 0);
+    assert(ret == &thread);
+
+    // Too small stack
+    sc_thread_init(&thread);
+    sc_thread_set_stack_size(&thread, 1);
+    assert(sc_thread_start(&thread, fn, "first") != 0);
+    sc_thread_set_stack_size(&thread, 0);
+    assert(sc_thread_start(&thread, fn, "first") == 0);
+    assert(sc_thread_term(&thread) == 0);
+
+    sc_thread_init(&thread);
+    sc_thread_set_numa(&thread, 100000);
+    assert(sc_thread_start(&thread, numa_fn, NULL) != 0);
+    assert(strcmp(sc_thread_err(&thread), "Invalid NUMA node.") == 0);
+
+    if (access("/sys/devices/system/node/node0", F_OK) == 0) {
+        sc_thread_set_numa(&thread, 0);
+        assert(sc_thread_start(&thread, numa_fn, NULL) == 0);
+        assert(sc_thread_term(&thread) == 0);
+    }
+}
+#else
+void test_attr()
+{
+}
+#endif
+
 int main()
 {
     test1();
+    test_attr();
     fail_test();
     return 0;
 }
@@ -37,6 +37,32 @@
     #include <time.h>
 #endif
 
+#if defined(_WIN32) || defined(_WIN64)
+
+// System frequency does not change at run-time, cache it.
+static uint64_t sc_time_qpc_freq(void)
+{
+    static uint64_t frequency = 0;
+
+    if (frequency == 0) {
+        LARGE_INTEGER freq;
+
+        QueryPerformanceFrequency(&freq);
+        assert(freq.QuadPart != 0);
+        frequency = (uint64_t) freq.QuadPart;
+    }
+
+    return frequency;
+}
+
+// count * unit / freq, without overflowing the multiplication.
+static uint64_t sc_time_scale(uint64_t count, uint64_t freq, uint64_t unit)
+{
+    return (count / freq) * unit + (count % freq) * unit / freq;
+}
+
+#endif
+
 uint64_t sc_time_ms()
 {
 #if defined(_WIN32) || defined(_WIN64)
@@ -55,7 +81,7 @@ uint64_t sc_time_ms()
     rc = clock_gettime(CLOCK_REALTIME, &ts);
     assert(rc == 0);
 
-    return ts.tv_sec * 1000 + (uint64_t)(ts.tv_nsec / 10e6);
+    return ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
 #endif
 }
 
@@ -84,17 +110,11 @@ uint64_t sc_time_ns()
 uint64_t sc_time_mono_ms()
 {
 #if defined(_WIN32) || defined(_WIN64)
-    //  System frequency does not change at run-time, cache it
-    static int64_t frequency = 0;
-    if (frequency == 0) {
-        LARGE_INTEGER freq;
-        QueryPerformanceFrequency(&freq);
-        assert(freq.QuadPart != 0);
-        frequency = freq.QuadPart;
-    }
+    uint64_t freq = sc_time_qpc_freq();
     LARGE_INTEGER count;
+
     QueryPerformanceCounter(&count);
-    return (int64_t)(count.QuadPart * 1000) / frequency;
+    return sc_time_scale((uint64_t) count.QuadPart, freq, 1000);
 #else
     int rc;
     struct timespec ts;
@@ -110,16 +130,11 @@ uint64_t sc_time_mono_ms()
 uint64_t sc_time_mono_ns()
 {
 #if defined(_WIN32) || defined(_WIN64)
-    static int64_t frequency = 0;
-    if (frequency == 0) {
-        LARGE_INTEGER freq;
-        QueryPerformanceFrequency(&freq);
-        assert(freq.QuadPart != 0);
-        frequency = freq.QuadPart;
-    }
+    uint64_t freq = sc_time_qpc_freq();
     LARGE_INTEGER count;
+
     QueryPerformanceCounter(&count);
-    return (uint64_t)(count.QuadPart * 1000000000) / frequency;
+    return sc_time_scale((uint64_t) count.QuadPart, freq, 1000000000);
 #else
     int rc;
     struct timespec ts;
@@ -151,3 +166,87 @@ int sc_time_sleep(uint64_t millis)
     return rc;
 #endif
 }
+
+uint64_t sc_time_coarse_ms(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return GetTickCount64();
+#else
+    return sc_time_coarse_ns() / 1000000;
+#endif
+}
+
+uint64_t sc_time_coarse_ns(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return GetTickCount64() * 1000000;
+#else
+    int rc;
+    struct timespec ts;
+
+    #if defined(CLOCK_MONOTONIC_COARSE)
+    rc = clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    #elif defined(CLOCK_MONOTONIC_FAST)
+    rc = clock_gettime(CLOCK_MONOTONIC_FAST, &ts);
+    #elif defined(CLOCK_MONOTONIC_RAW_APPROX)
+    rc = clock_gettime(CLOCK_MONOTONIC_RAW_APPROX, &ts);
+    #else
+    rc = clock_gettime(CLOCK_MONOTONIC, &ts);
+    #endif
+    assert(rc == 0);
+
+    return ((uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec);
+#endif
+}
+
+// Nanoseconds per sc_time_cycles() tick, zero until calibrated.
+static double sc_time_ns_per_cycle;
+
+uint64_t sc_time_calibrate(uint64_t millis)
+{
+#if defined(__aarch64__)
+    uint64_t freq;
+
+    (void) millis;
+
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(freq));
+    sc_time_ns_per_cycle = 1e9 / (double) freq;
+#elif defined(__x86_64__) || defined(__i386__) ||                             \
+        (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+    uint64_t t1, t2, c1, c2;
+
+    t1 = sc_time_mono_ns();
+    c1 = sc_time_cycles();
+
+    do {
+        t2 = sc_time_mono_ns();
+        c2 = sc_time_cycles();
+    } while (t2 - t1 < millis * 1000000 || c2 == c1);
+
+    sc_time_ns_per_cycle = (double) (t2 - t1) / (double) (c2 - c1);
+#else
+    // sc_time_cycles() is sc_time_mono_ns().
+    (void) millis;
+    sc_time_ns_per_cycle = 1.0;
+#endif
+
+    return (uint64_t) (1e9 / sc_time_ns_per_cycle);
+}
+
+uint64_t sc_time_cycles_hz(void)
+{
+    if (sc_time_ns_per_cycle == 0) {
+        return sc_time_calibrate(10);
+    }
+
+    return (uint64_t) (1e9 / sc_time_ns_per_cycle);
+}
+
+uint64_t sc_time_cycles_to_ns(uint64_t cycles)
+{
+    if (sc_time_ns_per_cycle == 0) {
+        sc_time_calibrate(10);
+    }
+
+    return (uint64_t) ((double) cycles * sc_time_ns_per_cycle);
+}
@@ -26,6 +26,10 @@
 
 #include <stdint.h>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+#endif
+
 /**
  * Wall clock time. Gets CLOCK_REALTIME on Posix.
  * @return current timestamp in milliseconds.
@@ -56,4 +60,82 @@ uint64_t sc_time_mono_ns();
  */
 int sc_time_sleep(uint64_t millis);
 
+/**
+ * Coarse monotonic timer, returns the time of the last timer tick. Resolution
+ * is the tick length (1-4 ms on Linux, ~15 ms on Windows) but it costs a few
+ * nanoseconds as it doesn't read the hardware clock. Good for timeouts and
+ * timestamps on hot paths that need millisecond precision at most.
+ *
+ * Gets CLOCK_MONOTONIC_COARSE on Linux, CLOCK_MONOTONIC_FAST on FreeBSD,
+ * CLOCK_MONOTONIC_RAW_APPROX on macOS, GetTickCount64() on Windows, falls back
+ * to CLOCK_MONOTONIC elsewhere. Don't compare with sc_time_mono_ms() values,
+ * the clocks may have a different origin on some platforms.
+ *
+ * @return current timestamp in milliseconds.
+ */
+uint64_t sc_time_coarse_ms(void);
+
+/**
+ * Coarse monotonic timer, see sc_time_coarse_ms().
+ * @return current timestamp in nanoseconds.
+ */
+uint64_t sc_time_coarse_ns(void);
+
+/**
+ * CPU timestamp counter, reads TSC on x86 and CNTVCT_EL0 on arm64. Costs a few
+ * nanoseconds, doesn't go through the kernel or the vDSO. Falls back to
+ * sc_time_mono_ns() on other architectures. Convert differences to time with
+ * sc_time_cycles_to_ns().
+ *
+ * Assumes an invariant TSC, constant rate and synchronized across cores, which
+ * is true for x86 CPUs of the last decade. It is not a serializing
+ * instruction, the CPU may execute it out of order with nearby instructions.
+ *
+ * @return counter value.
+ */
+static inline uint64_t sc_time_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return sc_time_mono_ns();
+#endif
+}
+
+/**
+ * Measures the counter frequency of sc_time_cycles(). On x86, it spins for
+ * 'millis' milliseconds comparing TSC against CLOCK_MONOTONIC, longer is more
+ * accurate, 10 ms gives an error below 0.1%. On arm64, frequency is read from
+ * CNTFRQ_EL0 and 'millis' is ignored.
+ *
+ * Called on first use of sc_time_cycles_to_ns()/sc_time_cycles_hz() with
+ * 10 ms if not called before. Not thread-safe, call it once on startup if those
+ * are going to be used by multiple threads.
+ *
+ * @param millis calibration duration.
+ * @return       counter frequency in hertz.
+ */
+uint64_t sc_time_calibrate(uint64_t millis);
+
+/**
+ * @return counter frequency of sc_time_cycles() in hertz.
+ */
+uint64_t sc_time_cycles_hz(void);
+
+/**
+ * @param cycles difference of two sc_time_cycles() values.
+ * @return       nanoseconds.
+ */
+uint64_t sc_time_cycles_to_ns(uint64_t cycles);
+
 #endif
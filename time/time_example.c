@@ -8,5 +8,10 @@ int main()
     sc_time_sleep(1000);
     printf("%lu \n", (unsigned long) (sc_time_ms() - t));
 
+    uint64_t c = sc_time_cycles();
+    sc_time_sleep(10);
+    printf("%lu ns \n", (unsigned long) sc_time_cycles_to_ns(sc_time_cycles() - c));
+    printf("%lu ms \n", (unsigned long) sc_time_coarse_ms());
+
     return 0;
 }
@@ -44,6 +44,61 @@ void test2(void)
     assert(t2 > t1);
 }
 
+void test_coarse(void)
+{
+    uint64_t t1, t2;
+
+    for (int i = 0; i < 100000; i++) {
+        t1 = sc_time_coarse_ns();
+        t2 = sc_time_coarse_ns();
+        assert(t2 >= t1);
+    }
+
+    t1 = sc_time_coarse_ms();
+    sc_time_sleep(100);
+    t2 = sc_time_coarse_ms();
+    assert(t2 - t1 >= 50);
+
+#if defined(__linux__)
+    // Same origin as CLOCK_MONOTONIC, behind it by at most a tick.
+    t1 = sc_time_coarse_ms();
+    t2 = sc_time_mono_ms();
+    assert(t2 >= t1 && t2 - t1 < 100);
+#endif
+
+    // Wall clock in ms and ns agree.
+    t1 = sc_time_ms();
+    t2 = sc_time_ns() / 1000000;
+    assert(t2 >= t1 && t2 - t1 < 1000);
+}
+
+void test_cycles(void)
+{
+    uint64_t c1, c2, t1, t2, ns, hz;
+
+    for (int i = 0; i < 100000; i++) {
+        c1 = sc_time_cycles();
+        c2 = sc_time_cycles();
+        assert(c2 >= c1);
+    }
+
+    hz = sc_time_cycles_hz();
+    assert(hz > 0);
+    assert(sc_time_calibrate(20) > 0);
+    assert(sc_time_cycles_to_ns(0) == 0);
+
+    t1 = sc_time_mono_ns();
+    c1 = sc_time_cycles();
+    sc_time_sleep(200);
+    c2 = sc_time_cycles();
+    t2 = sc_time_mono_ns();
+
+    // Within 10% of the monotonic clock.
+    ns = sc_time_cycles_to_ns(c2 - c1);
+    assert(ns > (t2 - t1) - (t2 - t1) / 10);
+    assert(ns < (t2 - t1) + (t2 - t1) / 10);
+}
+
 #ifdef SC_HAVE_WRAP
 
     #include <signal.h>
@@ -114,6 +169,8 @@ int main()
 {
     test1();
     test2();
+    test_coarse();
+    test_cycles();
     test3();
     test4();
 
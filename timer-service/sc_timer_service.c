@@ -0,0 +1,392 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sc_timer_service.h"
+#include "sc_time.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#endif
+
+#ifndef thread_local
+    #if __STDC_VERSION__ >= 201112 && !defined __STDC_NO_THREADS__
+        #define thread_local _Thread_local
+    #elif defined _WIN32 && (defined _MSC_VER || defined __ICL ||              \
+                             defined __DMC__ || defined __BORLANDC__)
+        #define thread_local __declspec(thread)
+    #elif defined __GNUC__ || defined __SUNPRO_C || defined __xlC__
+        #define thread_local __thread
+    #else
+        #error "Cannot define  thread_local"
+    #endif
+#endif
+
+#if defined(_MSC_VER)
+    #define sc_ts_load(p)     InterlockedOr8((char *) (p), 0)
+    #define sc_ts_store(p, v) InterlockedExchange8((char *) (p), (char) (v))
+    #define sc_ts_inc(p)      ((uint64_t) InterlockedIncrement64((LONG64 *) (p)))
+    #define sc_ts_load_ptr(p) (*(void *volatile *) (p))
+    #define sc_ts_xchg_ptr(p, v)                                               \
+        InterlockedExchangePointer((PVOID volatile *) (p), (v))
+    #define sc_ts_cas_ptr(p, old, v)                                           \
+        (InterlockedCompareExchangePointer((PVOID volatile *) (p), (v),        \
+                                           (old)) == (old))
+#else
+    #define sc_ts_load(p)        __atomic_load_n(p, __ATOMIC_ACQUIRE)
+    #define sc_ts_store(p, v)    __atomic_store_n(p, v, __ATOMIC_RELEASE)
+    #define sc_ts_inc(p)         __atomic_add_fetch(p, 1, __ATOMIC_RELAXED)
+    #define sc_ts_load_ptr(p)    __atomic_load_n(p, __ATOMIC_RELAXED)
+    #define sc_ts_xchg_ptr(p, v) __atomic_exchange_n(p, v, __ATOMIC_ACQUIRE)
+    #define sc_ts_cas_ptr(p, old, v)                                           \
+        __atomic_compare_exchange_n(p, &(struct sc_timer_service_op *){old},  \
+                                    v, true, __ATOMIC_RELEASE,                 \
+                                    __ATOMIC_RELAXED)
+#endif
+
+enum sc_timer_service_type
+{
+    SC_TIMER_SERVICE_ADD,
+    SC_TIMER_SERVICE_CANCEL,
+};
+
+struct sc_timer_service_op
+{
+    struct sc_timer_service_op *next;
+    enum sc_timer_service_type type;
+    uint64_t id;
+    uint64_t timer_id;
+    uint64_t deadline;
+    struct sc_pool_task task;
+    void (*fn)(void *arg);
+    void *arg;
+};
+
+// Set on the dispatcher thread.
+static thread_local struct sc_timer_service *sc_timer_service_current;
+
+static void sc_timer_service_errstr(struct sc_timer_service *s,
+                                    const char *str)
+{
+    snprintf(s->err, sizeof(s->err), "%s", str);
+}
+
+// Lock-free multi-producer stack. Dispatcher takes the whole stack at once,
+// so there is no ABA problem. Dispatcher is woken up only if the stack was
+// empty, otherwise a wake-up is already pending.
+static void sc_timer_service_push(struct sc_timer_service *s,
+                                  struct sc_timer_service_op *op)
+{
+    struct sc_timer_service_op *head;
+
+    do {
+        head = sc_ts_load_ptr(&s->head);
+        op->next = head;
+    } while (!sc_ts_cas_ptr(&s->head, head, op));
+
+    if (head == NULL) {
+        sc_sem_post(&s->sem, 1);
+    }
+}
+
+static void sc_timer_service_run(void *arg)
+{
+    struct sc_timer_service_op *op = arg;
+
+    op->fn(op->arg);
+    sc_timer_service_free(op);
+}
+
+static void sc_timer_service_on_timeout(void *arg, uint64_t timeout,
+                                        uint64_t type, void *data)
+{
+    struct sc_timer_service *s = arg;
+    struct sc_timer_service_op *op = data;
+
+    (void) timeout;
+
+    sc_map_del_64v(&s->ops, type, NULL);
+
+    if (s->pool != NULL) {
+        sc_pool_task_init(&op->task, sc_timer_service_run, op);
+        sc_pool_submit(s->pool, &op->task, NULL);
+    } else {
+        sc_timer_service_run(op);
+    }
+}
+
+static void sc_timer_service_add_op(struct sc_timer_service *s,
+                                    struct sc_timer_service_op *op)
+{
+    uint64_t now = s->timer.timestamp;
+    uint64_t timeout = op->deadline > now ? op->deadline - now : 0;
+
+    if (!sc_map_put_64v(&s->ops, op->id, op)) {
+        goto oom;
+    }
+
+    op->timer_id = sc_timer_add(&s->timer, timeout, op->id, op);
+    if (op->timer_id == SC_TIMER_INVALID) {
+        sc_map_del_64v(&s->ops, op->id, NULL);
+        goto oom;
+    }
+
+    return;
+
+oom:
+    // Out of memory, retry on the next iteration of the dispatcher loop.
+    op->next = s->retry;
+    s->retry = op;
+}
+
+static void sc_timer_service_cancel_id(struct sc_timer_service *s,
+                                       uint64_t id)
+{
+    void *val;
+    struct sc_timer_service_op *op;
+
+    if (sc_map_del_64v(&s->ops, id, &val)) {
+        op = val;
+        sc_timer_cancel(&s->timer, &op->timer_id);
+        sc_timer_service_free(op);
+        return;
+    }
+
+    for (struct sc_timer_service_op **it = &s->retry; *it; it = &(*it)->next) {
+        if ((*it)->id == id) {
+            op = *it;
+            *it = op->next;
+            sc_timer_service_free(op);
+            return;
+        }
+    }
+}
+
+// Takes requests from the queue, reverses the stack to process requests in
+// submission order.
+static void sc_timer_service_drain(struct sc_timer_service *s)
+{
+    struct sc_timer_service_op *op, *next, *list = NULL;
+
+    op = s->retry;
+    s->retry = NULL;
+
+    while (op != NULL) {
+        next = op->next;
+        sc_timer_service_add_op(s, op);
+        op = next;
+    }
+
+    op = sc_ts_xchg_ptr(&s->head, NULL);
+    while (op != NULL) {
+        next = op->next;
+        op->next = list;
+        list = op;
+        op = next;
+    }
+
+    while (list != NULL) {
+        op = list;
+        list = list->next;
+
+        if (op->type == SC_TIMER_SERVICE_ADD) {
+            sc_timer_service_add_op(s, op);
+        } else {
+            sc_timer_service_cancel_id(s, op->id);
+            sc_timer_service_free(op);
+        }
+    }
+}
+
+static void *sc_timer_service_loop(void *arg)
+{
+    uint64_t timeout;
+    struct sc_timer_service *s = arg;
+
+    sc_timer_service_current = s;
+
+    while (!sc_ts_load(&s->stop)) {
+        sc_timer_service_drain(s);
+        timeout = sc_timer_timeout(&s->timer, sc_time_mono_ms(), s,
+                                   sc_timer_service_on_timeout);
+
+        // Timers which failed to be added are retried on the next tick.
+        if (s->retry != NULL && timeout > SC_TIMER_TICK) {
+            timeout = SC_TIMER_TICK;
+        }
+
+        if (timeout == SC_TIMER_INVALID) {
+            sc_sem_wait(&s->sem);
+        } else {
+            timeout = timeout < UINT32_MAX ? timeout : UINT32_MAX;
+            sc_sem_wait_timeout(&s->sem, (uint32_t) timeout);
+        }
+    }
+
+    return NULL;
+}
+
+int sc_timer_service_init(struct sc_timer_service *s, struct sc_pool *pool)
+{
+    uint64_t now;
+
+    *s = (struct sc_timer_service){.pool = pool};
+
+    if (sc_sem_init(&s->sem, 0) != 0) {
+        sc_timer_service_errstr(s, "Failed to create semaphore.");
+        return -1;
+    }
+
+    if (!sc_map_init_64v(&s->ops, 0, 0)) {
+        sc_timer_service_errstr(s, "Out of memory.");
+        goto err_map;
+    }
+
+    now = sc_time_mono_ms();
+
+    if (!sc_timer_init_tick(&s->timer, now, SC_TIMER_PRECISE)) {
+        sc_timer_service_errstr(s, "Out of memory.");
+        goto err_timer;
+    }
+
+    sc_thread_init(&s->thread);
+    sc_thread_set_name(&s->thread, "timer-service");
+
+    if (sc_thread_start(&s->thread, sc_timer_service_loop, s) != 0) {
+        sc_timer_service_errstr(s, sc_thread_err(&s->thread));
+        goto err_thread;
+    }
+
+    return 0;
+
+err_thread:
+    sc_thread_term(&s->thread);
+    sc_timer_term(&s->timer);
+err_timer:
+    sc_map_term_64v(&s->ops);
+err_map:
+    sc_sem_term(&s->sem);
+    return -1;
+}
+
+int sc_timer_service_term(struct sc_timer_service *s)
+{
+    int rc = 0;
+    void *val;
+    struct sc_timer_service_op *op;
+
+    sc_ts_store(&s->stop, true);
+    sc_sem_post(&s->sem, 1);
+
+    if (sc_thread_term(&s->thread) != 0) {
+        sc_timer_service_errstr(s, sc_thread_err(&s->thread));
+        rc = -1;
+    }
+
+    // Take requests which arrived after the dispatcher had stopped, timers
+    // are dropped, so adding them to the timer only to free them is fine.
+    sc_timer_service_drain(s);
+
+    sc_map_foreach_value (&s->ops, val) {
+        sc_timer_service_free(val);
+    }
+
+    while (s->retry != NULL) {
+        op = s->retry;
+        s->retry = op->next;
+        sc_timer_service_free(op);
+    }
+
+    sc_map_term_64v(&s->ops);
+    sc_timer_term(&s->timer);
+    sc_sem_term(&s->sem);
+
+    return rc;
+}
+
+const char *sc_timer_service_err(struct sc_timer_service *s)
+{
+    return s->err;
+}
+
+uint64_t sc_timer_service_add(struct sc_timer_service *s, uint64_t timeout,
+                              void (*fn)(void *arg), void *arg)
+{
+    uint64_t id;
+    struct sc_timer_service_op *op;
+
+    op = sc_timer_service_malloc(sizeof(*op));
+    if (op == NULL) {
+        return SC_TIMER_INVALID;
+    }
+
+    *op = (struct sc_timer_service_op){
+            .type = SC_TIMER_SERVICE_ADD,
+            .id = sc_ts_inc(&s->id),
+            .deadline = sc_time_mono_ms() + timeout,
+            .fn = fn,
+            .arg = arg,
+    };
+
+    // Dispatcher may run and free the op as soon as it is pushed.
+    id = op->id;
+
+    if (sc_timer_service_current == s) {
+        sc_timer_service_add_op(s, op);
+    } else {
+        sc_timer_service_push(s, op);
+    }
+
+    return id;
+}
+
+bool sc_timer_service_cancel(struct sc_timer_service *s, uint64_t id)
+{
+    struct sc_timer_service_op *op;
+
+    if (id == SC_TIMER_INVALID) {
+        return true;
+    }
+
+    if (sc_timer_service_current == s) {
+        sc_timer_service_cancel_id(s, id);
+        return true;
+    }
+
+    op = sc_timer_service_malloc(sizeof(*op));
+    if (op == NULL) {
+        return false;
+    }
+
+    *op = (struct sc_timer_service_op){
+            .type = SC_TIMER_SERVICE_CANCEL,
+            .id = id,
+    };
+
+    sc_timer_service_push(s, op);
+
+    return true;
+}
@@ -0,0 +1,117 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_TIMER_SERVICE_H
+#define SC_TIMER_SERVICE_H
+
+#include "sc_cond.h"
+#include "sc_map.h"
+#include "sc_pool.h"
+#include "sc_thread.h"
+#include "sc_timer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef SC_HAVE_CONFIG_H
+    #include "config.h"
+#else
+    #define sc_timer_service_malloc malloc
+    #define sc_timer_service_free   free
+#endif
+
+struct sc_timer_service_op;
+
+struct sc_timer_service
+{
+    struct sc_timer timer;
+    struct sc_map_64v ops;
+    struct sc_thread thread;
+    struct sc_sem sem;
+    struct sc_pool *pool;
+
+    struct sc_timer_service_op *head;
+    struct sc_timer_service_op *retry;
+    uint64_t id;
+    bool stop;
+
+    char err[128];
+};
+
+/**
+ * Create timer service and start its dispatcher thread. Timers can be added
+ * and cancelled from any thread, requests are passed to the dispatcher thread
+ * through a lock-free queue.
+ *
+ * @param s    timer service
+ * @param pool if not NULL, callbacks are submitted to the pool. Otherwise,
+ *             callbacks run on the dispatcher thread, blocking callbacks
+ *             delay other timers.
+ * @return     '0' on success, '-1' on error, call sc_timer_service_err() for
+ *             error string.
+ */
+int sc_timer_service_init(struct sc_timer_service *s, struct sc_pool *pool);
+
+/**
+ * Stop and join dispatcher thread. Pending timers are dropped without calling
+ * their callbacks. If a pool is used, callbacks which are already submitted
+ * to the pool still run, pool must be terminated after the timer service.
+ *
+ * @param s timer service
+ * @return  '0' on success, '-1' on error, call sc_timer_service_err() for
+ *          error string.
+ */
+int sc_timer_service_term(struct sc_timer_service *s);
+
+/**
+ * @param s timer service
+ * @return  last error string
+ */
+const char *sc_timer_service_err(struct sc_timer_service *s);
+
+/**
+ * Add timer, thread-safe.
+ *
+ * @param s       timer service
+ * @param timeout timeout in milliseconds, relative to this call.
+ * @param fn      callback
+ * @param arg     callback arg
+ * @return        timer id, SC_TIMER_INVALID on out of memory.
+ */
+uint64_t sc_timer_service_add(struct sc_timer_service *s, uint64_t timeout,
+                              void (*fn)(void *arg), void *arg);
+
+/**
+ * Cancel timer, thread-safe. Cancel is asynchronous, callback is not called
+ * if cancel reaches the dispatcher thread before the timer expires. Called
+ * from a callback running on the dispatcher thread, cancel takes effect
+ * immediately. Cancelling an expired timer is a no-op.
+ *
+ * @param s  timer service
+ * @param id timer id
+ * @return   'false' on out of memory.
+ */
+bool sc_timer_service_cancel(struct sc_timer_service *s, uint64_t id);
+
+#endif
@@ -0,0 +1,28 @@
+#include "sc_time.h"
+#include "sc_timer_service.h"
+
+#include <stdio.h>
+
+static void hello(void *arg)
+{
+    printf("%s \n", (char *) arg);
+}
+
+int main()
+{
+    uint64_t id;
+    struct sc_timer_service service;
+
+    sc_timer_service_init(&service, NULL);
+
+    sc_timer_service_add(&service, 100, hello, "timer-100");
+    sc_timer_service_add(&service, 200, hello, "timer-200");
+
+    id = sc_timer_service_add(&service, 300, hello, "never");
+    sc_timer_service_cancel(&service, id);
+
+    sc_time_sleep(500);
+    sc_timer_service_term(&service);
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include "sc_time.h"
+#include "sc_timer_service.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define THREADS 4
+#define COUNT   1000
+
+#ifdef SC_HAVE_WRAP
+
+int fail_malloc = -1;
+void *__real_malloc(size_t n);
+void *__wrap_malloc(size_t n)
+{
+    if (fail_malloc == 0) {
+        return NULL;
+    }
+
+    if (fail_malloc > 0) {
+        fail_malloc--;
+    }
+
+    return __real_malloc(n);
+}
+
+int fail_pthread_create = -1;
+int __real_pthread_create(pthread_t *newthread, const pthread_attr_t *attr,
+                          void *(*start_routine)(void *), void *arg);
+int __wrap_pthread_create(pthread_t *newthread, const pthread_attr_t *attr,
+                          void *(*start_routine)(void *), void *arg)
+{
+    if (fail_pthread_create == 0) {
+        return -1;
+    }
+
+    if (fail_pthread_create > 0) {
+        fail_pthread_create--;
+    }
+
+    return __real_pthread_create(newthread, attr, start_routine, arg);
+}
+
+static void nop(void *arg)
+{
+    (void) arg;
+}
+
+void fail_test(void)
+{
+    struct sc_timer_service s;
+
+    fail_malloc = 0;
+    assert(sc_timer_service_init(&s, NULL) == -1);
+    assert(strcmp(sc_timer_service_err(&s), "Out of memory.") == 0);
+    fail_malloc = -1;
+
+    fail_pthread_create = 0;
+    assert(sc_timer_service_init(&s, NULL) == -1);
+    fail_pthread_create = -1;
+
+    assert(sc_timer_service_init(&s, NULL) == 0);
+
+    fail_malloc = 0;
+    assert(sc_timer_service_add(&s, 100, nop, NULL) == SC_TIMER_INVALID);
+    assert(!sc_timer_service_cancel(&s, 1));
+    fail_malloc = -1;
+
+    // Pending timer is dropped.
+    assert(sc_timer_service_add(&s, 100000, nop, NULL) != SC_TIMER_INVALID);
+    assert(sc_timer_service_term(&s) == 0);
+}
+
+#else
+void fail_test(void)
+{
+}
+#endif
+
+struct worker
+{
+    struct sc_timer_service *s;
+    struct sc_thread thread;
+    int begin;
+};
+
+static uint64_t fired[COUNT];
+static uint64_t total;
+
+static void on_timeout(void *arg)
+{
+    uintptr_t i = (uintptr_t) arg;
+
+    __atomic_add_fetch(&fired[i], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&total, 1, __ATOMIC_RELEASE);
+}
+
+// Even timers are cancelled. They have a long timeout, so cancel reaches the
+// dispatcher thread before they expire.
+static void *adder(void *arg)
+{
+    uint64_t id;
+    struct worker *w = arg;
+
+    for (int i = w->begin; i < w->begin + COUNT / THREADS; i++) {
+        void *data = (void *) (uintptr_t) i;
+
+        if (i % 2 == 0) {
+            id = sc_timer_service_add(w->s, 100000, on_timeout, data);
+            assert(id != SC_TIMER_INVALID);
+            assert(sc_timer_service_cancel(w->s, id));
+        } else {
+            id = sc_timer_service_add(w->s, i % 50, on_timeout, data);
+            assert(id != SC_TIMER_INVALID);
+        }
+    }
+
+    return NULL;
+}
+
+static void wait_total(uint64_t n)
+{
+    uint64_t deadline = sc_time_mono_ms() + 10000;
+
+    while (__atomic_load_n(&total, __ATOMIC_ACQUIRE) < n) {
+        assert(sc_time_mono_ms() < deadline);
+        sc_time_sleep(1);
+    }
+}
+
+void test_threads(struct sc_pool *pool)
+{
+    struct sc_timer_service s;
+    struct worker workers[THREADS];
+
+    memset(fired, 0, sizeof(fired));
+    total = 0;
+
+    assert(sc_timer_service_init(&s, pool) == 0);
+
+    for (int i = 0; i < THREADS; i++) {
+        workers[i].s = &s;
+        workers[i].begin = i * (COUNT / THREADS);
+        sc_thread_init(&workers[i].thread);
+        assert(sc_thread_start(&workers[i].thread, adder, &workers[i]) == 0);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&workers[i].thread) == 0);
+    }
+
+    wait_total(COUNT / 2);
+    sc_time_sleep(100);
+
+    for (int i = 0; i < COUNT; i++) {
+        assert(fired[i] == (i % 2 == 0 ? 0 : 1));
+    }
+
+    assert(sc_timer_service_term(&s) == 0);
+}
+
+struct chain
+{
+    struct sc_timer_service *s;
+    uint64_t victim;
+    int count;
+};
+
+// Runs on the dispatcher thread, re-adds itself and cancels another timer.
+static void on_chain(void *arg)
+{
+    struct chain *c = arg;
+
+    if (c->victim != SC_TIMER_INVALID) {
+        assert(sc_timer_service_cancel(c->s, c->victim));
+        c->victim = SC_TIMER_INVALID;
+    }
+
+    if (++c->count < 10) {
+        assert(sc_timer_service_add(c->s, 1, on_chain, c) != SC_TIMER_INVALID);
+        return;
+    }
+
+    __atomic_add_fetch(&total, 1, __ATOMIC_RELEASE);
+}
+
+void test_chain(void)
+{
+    struct sc_timer_service s;
+    struct chain c = {.s = &s};
+
+    memset(fired, 0, sizeof(fired));
+    total = 0;
+
+    assert(sc_timer_service_init(&s, NULL) == 0);
+
+    c.victim = sc_timer_service_add(&s, 200, on_timeout, (void *) 0);
+    assert(c.victim != SC_TIMER_INVALID);
+    assert(sc_timer_service_add(&s, 0, on_chain, &c) != SC_TIMER_INVALID);
+
+    wait_total(1);
+    sc_time_sleep(300);
+
+    assert(c.count == 10);
+    assert(fired[0] == 0);
+    assert(__atomic_load_n(&total, __ATOMIC_ACQUIRE) == 1);
+
+    // Cancel of an expired timer is a no-op.
+    assert(sc_timer_service_cancel(&s, 1));
+    assert(sc_timer_service_cancel(&s, SC_TIMER_INVALID));
+    assert(sc_timer_service_term(&s) == 0);
+}
+
+int main()
+{
+    struct sc_pool pool;
+
+    fail_test();
+    test_threads(NULL);
+    test_chain();
+
+    assert(sc_pool_init(&pool, 2, false) == 0);
+    test_threads(&pool);
+    assert(sc_pool_term(&pool) == 0);
+
+    return 0;
+}
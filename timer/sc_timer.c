@@ -27,65 +27,167 @@
 #include <assert.h>
 #include <memory.h>
 
-#define TICK        16u
-#define WHEEL_COUNT 16u
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
 
 #ifndef SC_SIZE_MAX
     #define SC_SIZE_MAX UINT32_MAX
 #endif
 
-#define SC_CAP_MAX (SC_SIZE_MAX / sizeof(struct sc_timer_data)) / WHEEL_COUNT
+#ifdef SC_STATS
+    #include "sc_stats.h"
+#elif !defined(SC_STATS_ADD)
+    #define SC_STATS_ADD(name, n) ((void) (n))
+    #define SC_STATS_MAX(name, v) ((void) (v))
+#endif
 
-bool sc_timer_init(struct sc_timer *timer, uint64_t timestamp)
+#define SC_TIMER_CAP_MAX (SC_SIZE_MAX / sizeof(struct sc_timer_data))
+#define SC_INIT_BITS     6u
+#define SC_INIT_CAP      (1u << SC_INIT_BITS)
+
+// List terminator and marker for the first item of a slot. First item's 'prev'
+// holds the slot number with this bit set, so unlinking needs no lookup.
+#define SC_NIL  UINT32_MAX
+#define SC_HEAD 0x80000000u
+
+#define SC_LEVEL_SHIFT(l) ((l) * SC_TIMER_SLOT_BITS)
+#define SC_LEVEL_MASK     (SC_TIMER_SLOTS - 1)
+#define SC_WHEEL_SPAN     ((uint64_t) 1 << SC_LEVEL_SHIFT(SC_TIMER_LEVELS))
+
+static inline uint32_t sc_timer_ctz(uint64_t mask)
 {
-    const uint32_t wheel_cap = 4;
-    const uint32_t cap = WHEEL_COUNT * wheel_cap;
-    const size_t size = cap * sizeof(struct sc_timer_data);
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t) __builtin_ctzll(mask);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (uint32_t) index;
+#else
+    uint32_t n = 0;
+
+    while ((mask & 1u) == 0) {
+        mask >>= 1u;
+        n++;
+    }
 
-    timer->count = 0;
-    timer->head = 0;
-    timer->wheel = wheel_cap;
-    timer->timestamp = timestamp;
+    return n;
+#endif
+}
 
-    timer->list = sc_timer_malloc(size);
-    if (timer->list == NULL) {
-        return false;
+static inline uint32_t sc_timer_msb(uint32_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 31u - (uint32_t) __builtin_clz(val);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, val);
+    return (uint32_t) index;
+#else
+    uint32_t n = 0;
+
+    while (val >>= 1u) {
+        n++;
+    }
+
+    return n;
+#endif
+}
+
+// Chunk 0 holds [0, 64), chunk 'n' holds [32 << n, 64 << n).
+static inline uint32_t sc_timer_chunk_base(uint32_t chunk)
+{
+    return chunk == 0 ? 0 : (SC_INIT_CAP / 2) << chunk;
+}
+
+static inline struct sc_timer_data *sc_timer_item(struct sc_timer *timer,
+                                                  uint32_t index)
+{
+    uint32_t msb = sc_timer_msb(index | (SC_INIT_CAP - 1));
+    uint32_t chunk = msb - (SC_INIT_BITS - 1);
+
+    return &timer->chunks[chunk][index - sc_timer_chunk_base(chunk)];
+}
+
+// Puts timers of a chunk into the free list. Generations of a new chunk start
+// from zero, existing ones are bumped, so ids given out before are stale.
+static void sc_timer_reset(struct sc_timer *timer, uint32_t chunk, bool fresh)
+{
+    struct sc_timer_data *list = timer->chunks[chunk];
+    uint32_t base = sc_timer_chunk_base(chunk);
+    uint32_t size = chunk == 0 ? SC_INIT_CAP : base;
+
+    for (uint32_t i = 0; i < size; i++) {
+        list[i].timeout = UINT64_MAX;
+        list[i].data = NULL;
+        list[i].gen = fresh ? 0 : list[i].gen + 1;
+        list[i].next = i + 1 < size ? base + i + 1 : timer->free;
     }
 
-    for (uint32_t i = 0; i < cap; i++) {
-        timer->list[i].timeout = UINT64_MAX;
-        timer->list[i].data = NULL;
+    timer->free = base;
+}
+
+bool sc_timer_init_tick(struct sc_timer *timer, uint64_t timestamp,
+                        uint64_t tick)
+{
+    const size_t size = SC_INIT_CAP * sizeof(struct sc_timer_data);
+
+    assert(tick != 0);
+
+    timer->chunks[0] = sc_timer_malloc(size);
+    if (timer->chunks[0] == NULL) {
+        return false;
     }
 
+    timer->tick = tick;
+    timer->timestamp = timestamp;
+    timer->now = timestamp / tick;
+    timer->cap = SC_INIT_CAP;
+    timer->chunk = 1;
+    timer->free = SC_NIL;
+
+    sc_timer_reset(timer, 0, true);
+    sc_timer_clear(timer);
+
     return true;
 }
 
+bool sc_timer_init(struct sc_timer *timer, uint64_t timestamp)
+{
+    return sc_timer_init_tick(timer, timestamp, SC_TIMER_TICK);
+}
+
 void sc_timer_term(struct sc_timer *timer)
 {
-    sc_timer_free(timer->list);
+    for (uint32_t i = 0; i < timer->chunk; i++) {
+        sc_timer_free(timer->chunks[i]);
+    }
 }
 
 void sc_timer_clear(struct sc_timer *timer)
 {
-    const uint32_t cap = timer->wheel * WHEEL_COUNT;
-
     timer->count = 0;
-    timer->head = 0;
+    timer->free = SC_NIL;
 
-    for (uint32_t i = 0; i < cap; i++) {
-        timer->list[i].timeout = UINT64_MAX;
-        timer->list[i].data = NULL;
+    for (uint32_t i = timer->chunk; i > 0; i--) {
+        sc_timer_reset(timer, i - 1, false);
+    }
+
+    for (uint32_t i = 0; i < SC_TIMER_LEVELS; i++) {
+        timer->bitmap[i] = 0;
+        for (uint32_t j = 0; j < SC_TIMER_SLOTS; j++) {
+            timer->slots[i][j] = SC_NIL;
+        }
     }
 }
 
 static bool expand(struct sc_timer *timer)
 {
-    uint32_t cap = timer->wheel * WHEEL_COUNT * 2;
-    size_t size = cap * sizeof(struct sc_timer_data);
+    size_t size = timer->cap * sizeof(struct sc_timer_data);
     struct sc_timer_data *alloc;
 
     // Check overflow
-    if (timer->wheel > SC_CAP_MAX / 2) {
+    if (timer->cap > SC_TIMER_CAP_MAX / 2 || timer->chunk == SC_TIMER_CHUNKS) {
         return false;
     }
 
@@ -94,122 +196,314 @@ static bool expand(struct sc_timer *timer)
         return false;
     }
 
-    for (uint32_t i = 0; i < cap; i++) {
-        alloc[i].timeout = UINT64_MAX;
-        alloc[i].data = NULL;
+    SC_STATS_ADD("timer.expand", 1);
+    timer->chunks[timer->chunk] = alloc;
+    timer->cap *= 2;
+    sc_timer_reset(timer, timer->chunk++, true);
+
+    return true;
+}
+
+static void sc_timer_unlink(struct sc_timer *timer, uint32_t index)
+{
+    struct sc_timer_data *item = sc_timer_item(timer, index);
+    uint32_t slot, level;
+
+    if (item->next != SC_NIL) {
+        sc_timer_item(timer, item->next)->prev = item->prev;
+    }
+
+    if (!(item->prev & SC_HEAD)) {
+        sc_timer_item(timer, item->prev)->next = item->next;
+        return;
     }
 
-    // Copy from old list to new list
-    for (uint32_t i = 0; i < WHEEL_COUNT; i++) {
-        void *dest = &alloc[(i * timer->wheel * 2)];
-        void *src = &timer->list[(i * timer->wheel)];
-        size_t copy = sizeof(struct sc_timer_data) * timer->wheel;
+    slot = item->prev & ~SC_HEAD;
+    level = slot / SC_TIMER_SLOTS;
+    slot &= SC_LEVEL_MASK;
 
-        memcpy(dest, src, copy);
+    timer->slots[level][slot] = item->next;
+    if (item->next == SC_NIL) {
+        timer->bitmap[level] &= ~((uint64_t) 1 << slot);
     }
+}
 
-    sc_timer_free(timer->list);
+// Returns the first tick at or after 'timeout', so timers never fire early.
+static uint64_t sc_timer_expiry(struct sc_timer *timer, uint64_t timeout)
+{
+    return timeout / timer->tick + (timeout % timer->tick != 0);
+}
 
-    timer->list = alloc;
-    timer->wheel *= 2;
+// Places the item into the level whose slot width fits the distance between
+// 'base', the first tick that is not processed yet, and its expiry tick.
+static void sc_timer_link(struct sc_timer *timer, uint32_t index, uint64_t base)
+{
+    struct sc_timer_data *item = sc_timer_item(timer, index);
+    uint64_t expiry = sc_timer_expiry(timer, item->timeout);
+    uint32_t level = 0, slot;
 
-    return true;
+    if (expiry < base) {
+        expiry = base;
+    }
+
+    if (expiry - base >= SC_WHEEL_SPAN) {
+        expiry = base + SC_WHEEL_SPAN - 1;
+    }
+
+    while ((expiry - base) >> SC_LEVEL_SHIFT(level + 1)) {
+        level++;
+    }
+
+    slot = (uint32_t) (expiry >> SC_LEVEL_SHIFT(level)) & SC_LEVEL_MASK;
+
+    item->prev = SC_HEAD | (level * SC_TIMER_SLOTS + slot);
+    item->next = timer->slots[level][slot];
+    if (item->next != SC_NIL) {
+        sc_timer_item(timer, item->next)->prev = index;
+    }
+
+    timer->slots[level][slot] = index;
+    timer->bitmap[level] |= ((uint64_t) 1 << slot);
 }
 
-uint64_t sc_timer_add(struct sc_timer *timer, uint64_t timeout, uint64_t type,
-                      void *data)
+static uint64_t sc_timer_deadline(struct sc_timer *timer, uint64_t timeout)
 {
-    const uint32_t offset = (uint32_t)(timeout / TICK + timer->head);
-    const uint32_t pos = offset & (WHEEL_COUNT - 1);
-    uint64_t id;
-    uint32_t seq, index, wheel_pos;
+    uint64_t deadline = timeout + timer->timestamp;
 
     assert(timeout < UINT64_MAX);
 
-    timer->count++;
+    if (deadline < timeout || deadline == UINT64_MAX) {
+        deadline = UINT64_MAX - 1;
+    }
 
-    wheel_pos = (pos * timer->wheel);
-    for (seq = 0; seq < timer->wheel; seq++) {
-        index = wheel_pos + seq;
-        if (timer->list[index].timeout == UINT64_MAX) {
-            goto out;
-        }
+    return deadline;
+}
+
+// Returns the item if 'id' refers to a pending timer, NULL if it has expired
+// or cancelled, even if its entry is reused by a newer timer since then.
+static struct sc_timer_data *sc_timer_lookup(struct sc_timer *timer,
+                                             uint64_t id)
+{
+    uint32_t index = (uint32_t) id;
+    struct sc_timer_data *item;
+
+    if (id == SC_TIMER_INVALID || index >= timer->cap) {
+        return NULL;
     }
 
-    if (!expand(timer)) {
+    item = sc_timer_item(timer, index);
+    if (item->timeout == UINT64_MAX || item->gen != (uint32_t) (id >> 32u)) {
+        return NULL;
+    }
+
+    return item;
+}
+
+static void sc_timer_release(struct sc_timer *timer, uint32_t index,
+                             struct sc_timer_data *item)
+{
+    item->timeout = UINT64_MAX;
+    item->data = NULL;
+    item->gen++;
+    item->next = timer->free;
+    timer->free = index;
+    timer->count--;
+}
+
+uint64_t sc_timer_add(struct sc_timer *timer, uint64_t timeout, uint64_t type,
+                      void *data)
+{
+    uint32_t index;
+    struct sc_timer_data *item;
+
+    if (timer->free == SC_NIL && !expand(timer)) {
         return SC_TIMER_INVALID;
     }
 
-    index = (pos * timer->wheel) + (seq);
-    assert(timer->list[index].timeout == UINT64_MAX);
+    index = timer->free;
+    item = sc_timer_item(timer, index);
+    timer->free = item->next;
+    timer->count++;
+
+    item->timeout = sc_timer_deadline(timer, timeout);
+    item->type = type;
+    item->data = data;
+    sc_timer_link(timer, index, timer->now + 1);
 
-out:
-    timer->list[index].timeout = timeout + timer->timestamp;
-    timer->list[index].type = type;
-    timer->list[index].data = data;
+    return ((uint64_t) item->gen << 32u) | index;
+}
 
-    id = (((uint64_t) seq) << 32u) | pos;
-    assert(id != SC_TIMER_INVALID);
+bool sc_timer_reschedule(struct sc_timer *timer, uint64_t *id,
+                         uint64_t timeout)
+{
+    uint64_t deadline;
+    struct sc_timer_data *item;
 
-    return id;
+    item = sc_timer_lookup(timer, *id);
+    if (item == NULL) {
+        *id = SC_TIMER_INVALID;
+        return false;
+    }
+
+    deadline = sc_timer_deadline(timer, timeout);
+
+    // Postponing is the common case, e.g. refreshing an idle timeout. The
+    // item stays where it is, it is moved when the wheel visits its slot.
+    // An earlier deadline might be behind that slot, so it is moved now.
+    if (deadline < item->timeout) {
+        sc_timer_unlink(timer, (uint32_t) *id);
+        item->timeout = deadline;
+        sc_timer_link(timer, (uint32_t) *id, timer->now + 1);
+    } else {
+        item->timeout = deadline;
+    }
+
+    return true;
 }
 
 void sc_timer_cancel(struct sc_timer *timer, uint64_t *id)
 {
-    uint64_t pos;
+    struct sc_timer_data *item;
 
-    if (*id == SC_TIMER_INVALID) {
-        return;
+    item = sc_timer_lookup(timer, *id);
+    if (item != NULL) {
+        sc_timer_unlink(timer, (uint32_t) *id);
+        sc_timer_release(timer, (uint32_t) *id, item);
     }
 
-    timer->count--;
-    pos = (((uint32_t) *id) * timer->wheel) + (*id >> 32u);
-
-    assert(timer->list[pos].timeout != UINT64_MAX);
-    timer->list[pos].timeout = UINT64_MAX;
     *id = SC_TIMER_INVALID;
 }
 
-#define sc_timer_min(a, b) (a) < (b) ? (a) : (b)
+// Moves timers of a slot one or more levels down, they are closer to expiry
+// now that the lower levels have completed a revolution.
+static void sc_timer_cascade(struct sc_timer *timer, uint32_t level,
+                             uint32_t slot)
+{
+    uint32_t index = timer->slots[level][slot];
+    uint32_t next;
+
+    timer->slots[level][slot] = SC_NIL;
+    timer->bitmap[level] &= ~((uint64_t) 1 << slot);
+
+    while (index != SC_NIL) {
+        next = sc_timer_item(timer, index)->next;
+        sc_timer_link(timer, index, timer->now);
+        index = next;
+    }
+}
+
+static void sc_timer_tick(struct sc_timer *timer, void *arg,
+                          void (*callback)(void *, uint64_t, uint64_t, void *))
+{
+    uint32_t index, slot = (uint32_t) (timer->now & SC_LEVEL_MASK);
+    uint32_t level = 0;
+    struct sc_timer_data *item;
+
+    while (slot == 0 && ++level < SC_TIMER_LEVELS) {
+        slot = (uint32_t) (timer->now >> SC_LEVEL_SHIFT(level));
+        slot &= SC_LEVEL_MASK;
+
+        if (timer->bitmap[level] & ((uint64_t) 1 << slot)) {
+            sc_timer_cascade(timer, level, slot);
+        }
+    }
+
+    slot = (uint32_t) (timer->now & SC_LEVEL_MASK);
+
+    // Items in the slot expire at this tick unless they are rescheduled to a
+    // later time. Callback may add or cancel timers, new or rescheduled timers
+    // always go to a later tick, so the loop terminates.
+    while ((index = timer->slots[0][slot]) != SC_NIL) {
+        uint64_t timeout, type;
+        void *data;
+
+        sc_timer_unlink(timer, index);
+
+        item = sc_timer_item(timer, index);
+        timeout = item->timeout;
+
+        if (sc_timer_expiry(timer, timeout) > timer->now) {
+            sc_timer_link(timer, index, timer->now + 1);
+            continue;
+        }
+
+        type = item->type;
+        data = item->data;
+
+        sc_timer_release(timer, index, item);
+        callback(arg, timeout, type, data);
+    }
+}
+
+// Returns the first tick after 'now' that has work, either a level 0 slot to
+// expire or a higher level slot to cascade. Ticks in between can be skipped.
+static uint64_t sc_timer_next_tick(struct sc_timer *timer)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (uint32_t level = 0; level < SC_TIMER_LEVELS; level++) {
+        uint64_t cur = timer->now >> SC_LEVEL_SHIFT(level);
+        uint64_t map = timer->bitmap[level];
+        uint32_t rot = (uint32_t) (cur + 1) & SC_LEVEL_MASK;
+        uint64_t tick;
+
+        if (map == 0) {
+            continue;
+        }
+
+        // Rotate, so bit 0 is the slot right after the current one.
+        if (rot != 0) {
+            map = (map >> rot) | (map << (SC_TIMER_SLOTS - rot));
+        }
+
+        tick = (cur + sc_timer_ctz(map) + 1) << SC_LEVEL_SHIFT(level);
+        next = tick < next ? tick : next;
+    }
+
+    return next;
+}
 
 uint64_t sc_timer_timeout(struct sc_timer *timer, uint64_t timestamp, void *arg,
                           void (*callback)(void *, uint64_t, uint64_t, void *))
 {
-    const uint64_t time = timestamp - timer->timestamp;
-    uint32_t wheel, base;
-    uint32_t head = timer->head;
-    uint32_t wheels = (uint32_t) (sc_timer_min(time / TICK, WHEEL_COUNT));
+    uint64_t now, next;
 
-    if (wheels == 0) {
-        return sc_timer_min(TICK - time, TICK);
+    if (timestamp < timer->timestamp) {
+        timestamp = timer->timestamp;
     }
 
     timer->timestamp = timestamp;
-    timer->head = (timer->head + wheels) & (WHEEL_COUNT - 1);
+    now = timestamp / timer->tick;
 
-    while (wheels-- > 0) {
-        wheel = timer->wheel;
-        base = wheel * head;
+    while (timer->now < now) {
+        next = sc_timer_next_tick(timer);
+        if (next > now) {
+            timer->now = now;
+            break;
+        }
 
-        for (uint32_t i = 0; i < wheel; i++) {
-            struct sc_timer_data *item = &timer->list[base + i];
+        timer->now = next;
+        sc_timer_tick(timer, arg, callback);
+    }
 
-            if (item->timeout <= timer->timestamp) {
-                uint64_t timeout = item->timeout;
-                item->timeout = UINT64_MAX;
+    return sc_timer_next(timer);
+}
 
-                timer->count--;
-                callback(arg, timeout, item->type, item->data);
+uint64_t sc_timer_next(struct sc_timer *timer)
+{
+    uint64_t deadline, tick = sc_timer_next_tick(timer);
 
-                // Recalculates position each time because there might be newly
-                // added timers in the callback and it might require expansion
-                // of the list.
-                base = timer->wheel * head;
-            }
-        }
+    // Next tick might be a cascade of a higher level slot, it is a lower bound
+    // for its timers, which are at finer levels after the cascade.
+    if (tick == UINT64_MAX) {
+        return SC_TIMER_INVALID;
+    }
 
-        head = (head + 1) & (WHEEL_COUNT - 1);
+    if (tick > (UINT64_MAX - 1) / timer->tick) {
+        return UINT64_MAX - 1 - timer->timestamp;
     }
 
-    return sc_timer_min(TICK - time, TICK);
+    deadline = tick * timer->tick;
+
+    return deadline > timer->timestamp ? deadline - timer->timestamp : 0;
 }
@@ -39,20 +39,51 @@
 
 #define SC_TIMER_INVALID UINT64_MAX
 
+// Default tick, timers are kept at this granularity.
+#ifndef SC_TIMER_TICK
+    #define SC_TIMER_TICK 16
+#endif
+
+// Precision modes for millisecond timestamps, pass as 'tick' to
+// sc_timer_init_tick(). Idle cost does not depend on tick, empty ticks are
+// skipped. For sub-millisecond precision, use microsecond timestamps with a
+// tick of e.g 100.
+#define SC_TIMER_COARSE SC_TIMER_TICK
+#define SC_TIMER_PRECISE 1
+
+// Hierarchical wheel, each level has 64 slots and each slot of a level spans
+// a whole revolution of the level below it. 6 levels cover 2^36 ticks, timers
+// beyond that are parked at the last level and re-slotted when it cascades.
+#define SC_TIMER_LEVELS     6
+#define SC_TIMER_SLOT_BITS  6
+#define SC_TIMER_SLOTS      (1u << SC_TIMER_SLOT_BITS)
+
+// Timers are stored in chunks, each chunk doubles the capacity, so growing
+// never copies or moves existing timers.
+#define SC_TIMER_CHUNKS 26
+
 struct sc_timer_data
 {
     uint64_t timeout;
     uint64_t type;
     void *data;
+    uint32_t next;
+    uint32_t prev;
+    uint32_t gen;
 };
 
 struct sc_timer
 {
     uint64_t timestamp;
-    uint32_t head;
-    uint32_t wheel;
+    uint64_t tick;
+    uint64_t now;
     uint32_t count;
-    struct sc_timer_data *list;
+    uint32_t cap;
+    uint32_t free;
+    uint32_t chunk;
+    struct sc_timer_data *chunks[SC_TIMER_CHUNKS];
+    uint64_t bitmap[SC_TIMER_LEVELS];
+    uint32_t slots[SC_TIMER_LEVELS][SC_TIMER_SLOTS];
 };
 
 /**
@@ -64,6 +95,18 @@ struct sc_timer
  */
 bool sc_timer_init(struct sc_timer *timer, uint64_t timestamp);
 
+/**
+ * Init timer with a custom tick. Timers expire at 'tick' granularity, at most
+ * one tick late and never early. 'sc_timer_init()' uses SC_TIMER_TICK.
+ *
+ * @param timer     timer
+ * @param timestamp current timestamp. Use monotonic timer source.
+ * @param tick      tick length, same unit as 'timestamp', must be non-zero.
+ * @return          'false' on out of memory.
+ */
+bool sc_timer_init_tick(struct sc_timer *timer, uint64_t timestamp,
+                        uint64_t tick);
+
 /**
  * Destroy timer.
  * @param timer timer
@@ -102,11 +145,35 @@ uint64_t sc_timer_add(struct sc_timer *timer, uint64_t timeout, uint64_t type,
  * uint64_t id = sc_timer_add(&timer, arg, 10);
  * sc_timer_cancel(&timer, &id);
  *
+ * Ids carry a generation, so cancelling with an id of a timer which has
+ * already expired or cancelled is a no-op even if its entry is reused.
+ *
  * @param timer timer
- * @param id    timer id
+ * @param id    timer id, set to SC_TIMER_INVALID.
  */
 void sc_timer_cancel(struct sc_timer *timer, uint64_t *id);
 
+/**
+ * Changes timeout of a pending timer, 'timeout' is relative to latest
+ * 'timestamp' value given to the 'timer', same as 'sc_timer_add()'.
+ *
+ * Postponing a timer, e.g refreshing an idle timeout on each packet, is O(1)
+ * and does not touch the wheel. Timer is moved lazily when the wheel visits
+ * its old slot.
+ *
+ * e.g  if (!sc_timer_reschedule(&timer, &id, 30000)) {
+ *          id = sc_timer_add(&timer, 30000, type, data);
+ *      }
+ *
+ * @param timer   timer
+ * @param id      timer id
+ * @param timeout new timeout
+ * @return        'false' if timer has already expired or cancelled, 'id' is
+ *                set to SC_TIMER_INVALID.
+ */
+bool sc_timer_reschedule(struct sc_timer *timer, uint64_t *id,
+                         uint64_t timeout);
+
 /**
  * Checks timeouts and calls 'callback' function for each timeout.
  *
@@ -119,6 +186,7 @@ void sc_timer_cancel(struct sc_timer *timer, uint64_t *id);
  *
  * while (true) {
  *      uint64_t timeout = sc_timer_timeout(&timer, time_ms(), arg, callback);
+ *      // SC_TIMER_INVALID if there is no timer, wait forever.
  *      sleep(timeout); // or select(timeout), epoll_wait(timeout) etc..
  * }
  *
@@ -130,9 +198,21 @@ void sc_timer_cancel(struct sc_timer *timer, uint64_t *id);
  *                  'timeout' is scheduled timeout for that timer.
  *                  'type' is what user passed on 'sc_timer_add'.
  *                  'data' is what user passed on 'sc_timer_add'.
- * @return          next timeout.
+ * @return          next timeout, see sc_timer_next().
  */
 uint64_t sc_timer_timeout(struct sc_timer *timer, uint64_t timestamp, void *arg,
                           void (*callback)(void *arg, uint64_t timeout,
                                            uint64_t type, void *data));
+
+/**
+ * Time until sc_timer_timeout() should be called next, relative to latest
+ * 'timestamp' value given to the 'timer'. Rounded up to the tick, so waiting
+ * this long never wakes up before a timer is due. For timers far in the
+ * future, it may return earlier than their timeout, at most once per wheel
+ * level, as far timers are kept at coarse granularity.
+ *
+ * @param timer timer
+ * @return      time until next timeout, SC_TIMER_INVALID if there is no timer.
+ */
+uint64_t sc_timer_next(struct sc_timer *timer);
 #endif
@@ -236,6 +236,276 @@ void test4(void)
     sc_timer_term(&timer);
 }
 
+
+struct far_arg
+{
+    struct sc_timer *timer;
+    uint64_t last;
+    uint64_t fired;
+};
+
+uint64_t deadlines[1000];
+
+void far_callback(void *arg, uint64_t timeout, uint64_t type, void *data)
+{
+    struct far_arg *a = arg;
+    uint64_t id = (uintptr_t) data;
+
+    assert(timeout == deadlines[id]);
+    assert(type == id);
+    assert(timeout <= a->timer->timestamp);
+    // Fired in deadline order, timers in the same tick are not ordered.
+    assert(timeout / a->timer->tick + 1 >= a->last / a->timer->tick);
+
+    a->last = timeout;
+    a->fired++;
+    ids[id] = SC_TIMER_INVALID;
+}
+
+void test5(void)
+{
+    uint64_t ts = 1000000;
+    uint64_t spans[] = {10, 1000, 100000, 10000000, 10000000000ull};
+    struct sc_timer timer;
+    struct far_arg arg = {.timer = &timer};
+
+    for (size_t s = 0; s < sizeof(spans) / sizeof(spans[0]); s++) {
+        assert(sc_timer_init_tick(&timer, ts, s + 1));
+        arg.last = 0;
+        arg.fired = 0;
+
+        for (int i = 0; i < 1000; i++) {
+            uint64_t timeout = ((uint64_t) rand() * rand()) % spans[s];
+
+            deadlines[i] = ts + timeout;
+            ids[i] = sc_timer_add(&timer, timeout, i, (void *) (uintptr_t) i);
+            assert(ids[i] != SC_TIMER_INVALID);
+        }
+
+        for (int i = 0; i < 1000; i += 3) {
+            sc_timer_cancel(&timer, &ids[i]);
+        }
+        assert(timer.count == 666);
+
+        while (timer.count > 0) {
+            ts += 1 + (spans[s] / 1000) * (rand() % 3);
+            sc_timer_timeout(&timer, ts, &arg, far_callback);
+
+            // Pending timers must not be due yet, at most one tick late.
+            for (int i = 0; i < 1000; i++) {
+                if (ids[i] != SC_TIMER_INVALID) {
+                    assert(deadlines[i] + timer.tick > ts);
+                }
+            }
+        }
+
+        assert(arg.fired == 666);
+        for (int i = 0; i < 1000; i++) {
+            assert(ids[i] == SC_TIMER_INVALID);
+        }
+
+        sc_timer_term(&timer);
+    }
+}
+
+uint64_t big[30000];
+
+void big_callback(void *arg, uint64_t timeout, uint64_t type, void *data)
+{
+    (void) arg;
+    (void) timeout;
+    (void) data;
+
+    assert(big[type] != SC_TIMER_INVALID);
+    big[type] = SC_TIMER_INVALID;
+}
+
+void test6(void)
+{
+    const uint32_t n = sizeof(big) / sizeof(big[0]);
+    struct sc_timer timer;
+    uint64_t ts = 0;
+
+    assert(sc_timer_init(&timer, ts));
+
+    // Ids stay valid while the timer grows.
+    for (uint32_t i = 0; i < n; i++) {
+        big[i] = sc_timer_add(&timer, 60000 + i, i, NULL);
+        assert(big[i] != SC_TIMER_INVALID);
+        if (i > 0 && (i & (i - 1)) == 0) {
+            sc_timer_cancel(&timer, &big[i / 2]);
+            big[i / 2] = sc_timer_add(&timer, 60000 + i / 2, i / 2, NULL);
+        }
+    }
+
+    assert(timer.count == n);
+
+    // Free entries are reused, no growth after cancel + add.
+    for (uint32_t i = 0; i < n; i += 2) {
+        sc_timer_cancel(&timer, &big[i]);
+    }
+
+    uint32_t cap = timer.cap;
+    for (uint32_t i = 0; i < n; i += 2) {
+        big[i] = sc_timer_add(&timer, rand() % 120000, i, NULL);
+        assert(big[i] != SC_TIMER_INVALID);
+    }
+    assert(timer.cap == cap);
+
+    while (timer.count > 0) {
+        ts += rand() % 1000;
+        sc_timer_timeout(&timer, ts, NULL, big_callback);
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        assert(big[i] == SC_TIMER_INVALID);
+    }
+
+    sc_timer_term(&timer);
+}
+
+uint64_t fired[4];
+
+void resched_callback(void *arg, uint64_t timeout, uint64_t type, void *data)
+{
+    struct sc_timer *timer = arg;
+
+    (void) data;
+
+    assert(timeout <= timer->timestamp);
+    fired[type] = timer->timestamp;
+}
+
+void test7(void)
+{
+    uint64_t a, b, c, stale;
+    struct sc_timer timer;
+
+    assert(sc_timer_init_tick(&timer, 0, 1));
+    memset(fired, 0, sizeof(fired));
+
+    a = sc_timer_add(&timer, 100, 1, NULL);
+    b = sc_timer_add(&timer, 100, 2, NULL);
+    c = sc_timer_add(&timer, 100000, 3, NULL);
+
+    // Postpone 'a' many times, earlier 'c'.
+    for (int i = 0; i < 1000; i++) {
+        sc_timer_timeout(&timer, i, &timer, resched_callback);
+        assert(sc_timer_reschedule(&timer, &a, 100));
+    }
+    assert(sc_timer_reschedule(&timer, &c, 10));
+
+    sc_timer_timeout(&timer, 1000, &timer, resched_callback);
+    assert(fired[1] == 0);
+    assert(fired[2] == 100);
+    assert(fired[3] == 0);
+    assert(timer.count == 2);
+
+    sc_timer_timeout(&timer, 1009, &timer, resched_callback);
+    assert(fired[3] == 1009);
+    assert(timer.count == 1);
+
+    // Expired timer can't be rescheduled or cancelled.
+    stale = b;
+    assert(!sc_timer_reschedule(&timer, &b, 10));
+    assert(b == SC_TIMER_INVALID);
+
+    // Entry of 'b' is reused, stale id must not cancel the new timer. Free
+    // entries are reused in LIFO order, first one is the entry of 'c'.
+    c = sc_timer_add(&timer, 10, 0, NULL);
+    b = sc_timer_add(&timer, 10, 2, NULL);
+    assert((uint32_t) b == (uint32_t) stale);
+    assert(b != stale);
+    sc_timer_cancel(&timer, &stale);
+    assert(stale == SC_TIMER_INVALID);
+    assert(timer.count == 3);
+
+    sc_timer_timeout(&timer, 1098, &timer, resched_callback);
+    assert(fired[0] == 1098);
+    assert(fired[1] == 0);
+    assert(fired[2] == 1098);
+
+    sc_timer_timeout(&timer, 1099, &timer, resched_callback);
+    assert(fired[1] == 1099);
+    assert(timer.count == 0);
+
+    sc_timer_cancel(&timer, &a);
+    assert(a == SC_TIMER_INVALID);
+
+    a = sc_timer_add(&timer, 10, 1, NULL);
+    sc_timer_clear(&timer);
+    assert(!sc_timer_reschedule(&timer, &a, 10));
+
+    sc_timer_term(&timer);
+}
+
+uint64_t next_fired;
+
+void next_callback(void *arg, uint64_t timeout, uint64_t type, void *data)
+{
+    struct sc_timer *timer = arg;
+
+    (void) timeout;
+    (void) type;
+    (void) data;
+
+    next_fired = timer->timestamp;
+}
+
+void test8(void)
+{
+    int wakeups;
+    uint64_t ts, n;
+    uint64_t timeouts[] = {0, 1, 7, 63, 64, 1000, 60000, 3600000, 86400000};
+    struct sc_timer timer;
+
+    // Precise mode, wake-ups are exact.
+    for (size_t i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); i++) {
+        assert(sc_timer_init_tick(&timer, 12345, SC_TIMER_PRECISE));
+        assert(sc_timer_next(&timer) == SC_TIMER_INVALID);
+        assert(sc_timer_timeout(&timer, 12345, &timer, next_callback) ==
+               SC_TIMER_INVALID);
+
+        sc_timer_add(&timer, timeouts[i], 0, NULL);
+        next_fired = 0;
+        ts = 12345;
+        wakeups = 0;
+
+        // Sleep exactly as long as returned, at most one wake-up per level.
+        while (next_fired == 0) {
+            n = sc_timer_next(&timer);
+            assert(n != SC_TIMER_INVALID && n > 0);
+            ts += n;
+            sc_timer_timeout(&timer, ts, &timer, next_callback);
+            wakeups++;
+        }
+
+        assert(next_fired == 12345 + (timeouts[i] == 0 ? 1 : timeouts[i]));
+        assert(wakeups <= SC_TIMER_LEVELS);
+        assert(sc_timer_next(&timer) == SC_TIMER_INVALID);
+        sc_timer_term(&timer);
+    }
+
+    // Coarse mode, rounded up to the tick.
+    assert(sc_timer_init(&timer, 0));
+    sc_timer_add(&timer, 20, 0, NULL);
+    assert(sc_timer_next(&timer) == 32);
+    assert(sc_timer_timeout(&timer, 10, &timer, next_callback) == 22);
+    sc_timer_term(&timer);
+
+    // Microsecond timestamps, 100us tick.
+    assert(sc_timer_init_tick(&timer, 1000000, 100));
+    sc_timer_add(&timer, 250, 0, NULL);
+    next_fired = 0;
+    assert(sc_timer_next(&timer) == 300);
+    sc_timer_timeout(&timer, 1000299, &timer, next_callback);
+    assert(next_fired == 0);
+    assert(sc_timer_next(&timer) == 1);
+    sc_timer_timeout(&timer, 1000300, &timer, next_callback);
+    assert(next_fired == 1000300);
+    sc_timer_term(&timer);
+}
+
 #ifdef SC_HAVE_WRAP
 
 bool fail_malloc = false;
@@ -299,6 +569,10 @@ int main()
     test2();
     test3();
     test4();
+    test5();
+    test6();
+    test7();
+    test8();
 
     return 0;
 }
@@ -24,160 +24,323 @@
 
 #include "sc_uri.h"
 
-#include <assert.h>
-#include <errno.h>
-#include <stdio.h>
 #include <string.h>
 
-#if defined(_WIN32) || defined(_WIN64)
-    #pragma warning(disable : 4996)
+#ifdef SC_URI_HAVE_SCAN
+    #include "sc_scan.h"
+
+// First byte of 'delim' in [i, len), 'len' if there is none.
+static size_t sc_uri_find(const char *s, size_t i, size_t len,
+                          const char *delim)
+{
+    struct sc_scan_set set;
+
+    sc_scan_set_init(&set, delim, strlen(delim));
+
+    return i + sc_scan_find(&set, s + i, len - i);
+}
 #endif
 
+static bool sc_uri_is_alpha(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
 
-struct sc_uri *sc_uri_create(const char *str)
+static bool sc_uri_is_digit(char c)
 {
-    const char *s1 = "%.*s%.*s%.*s%.*s%.*s%.*s%.*s%.*s";
-    const char *s2 = "%.*s%c%.*s%c%.*s%c%.*s%c%.*s%c%.*s%c%.*s%c";
-    const char *authority = "//";
-
-    int diff, ret;
-    unsigned long val;
-    size_t full_len, parts_len;
-    size_t scheme_len, authority_len = 0, userinfo_len = 0;
-    size_t host_len = 0, port_len = 0, path_len;
-    size_t query_len = 0, fragment_len = 0;
-
-    char *scheme, *userinfo = "", *host = "", *port = "";
-    char *path, *query = "", *fragment = "";
-    char *ptr, *dest, *parse_end;
-    char *pos = (char *) str;
-    struct sc_uri *uri;
+    return c >= '0' && c <= '9';
+}
 
-    if (str == NULL || (ptr = strstr(pos, ":")) == NULL) {
-        return NULL;
+static bool sc_uri_is_scheme(char c)
+{
+    return sc_uri_is_alpha(c) || sc_uri_is_digit(c) || c == '+' || c == '-' ||
+           c == '.';
+}
+
+static struct sc_uri_part sc_uri_part(size_t start, size_t end)
+{
+    return (struct sc_uri_part){.off = (uint32_t) start,
+                                .len = (uint32_t) (end - start)};
+}
+
+// Parses "userinfo@host:port" in [i, end).
+static int sc_uri_parse_authority(struct sc_uri_view *v, size_t i, size_t end)
+{
+    uint32_t port = 0;
+    size_t h, p;
+    const char *s = v->str;
+    const char *at = memchr(s + i, '@', end - i);
+
+    h = i;
+    if (at != NULL) {
+        h = (size_t) (at - s);
+        v->userinfo = sc_uri_part(i, h);
+        h++;
+    }
+
+    if (h < end && s[h] == '[') {
+        const char *rb = memchr(s + h, ']', end - h);
+        if (rb == NULL) {
+            return -1;
+        }
+        p = (size_t) (rb - s) + 1;
+    } else {
+        const char *c = memchr(s + h, ':', end - h);
+        p = c != NULL ? (size_t) (c - s) : end;
+    }
+
+    v->host = sc_uri_part(h, p);
+
+    if (p == end) {
+        return 0;
+    }
+
+    // Port may be empty, RFC 3986 'port = *DIGIT', e.g "http://a.com:/x".
+    // Trailing ':' at the end of the input is rejected, e.g "http://a.com:".
+    if (s[p] != ':' || p + 1 == v->len) {
+        return -1;
     }
 
-    scheme = pos;
-    scheme_len = ptr - str + 1;
-    pos = ptr + 1;
+    for (size_t j = p + 1; j < end; j++) {
+        if (!sc_uri_is_digit(s[j])) {
+            return -1;
+        }
+
+        port = port * 10 + (uint32_t) (s[j] - '0');
+        if (port > 65535) {
+            return -1;
+        }
+    }
 
-    if (*pos == '/' && *(pos + 1) == '/') {
-        authority_len = 2;
-        pos += authority_len;
+    v->port = sc_uri_part(p + 1, end);
+    v->port_num = port;
 
-        ptr = strchr(pos, '@');
-        if (ptr != NULL) {
-            userinfo = pos;
-            userinfo_len = ptr - pos + strlen("@");
-            pos = ptr + 1;
+    return 0;
+}
+
+int sc_uri_parse(struct sc_uri_view *v, const char *str, size_t len)
+{
+    size_t i = 0, end;
+
+    *v = (struct sc_uri_view){.str = str, .len = len};
+
+    if (str == NULL || len == 0 || len >= UINT32_MAX) {
+        return -1;
+    }
+
+    if (str[0] != '/') {
+        if (!sc_uri_is_alpha(str[0])) {
+            return -1;
         }
 
-        ptr = pos + strcspn(pos, *pos == '[' ? "]" : ":/?#");
-        host = pos;
-        host_len = ptr - pos + (*host == '[');
-        pos = host + host_len;
+        while (i < len && sc_uri_is_scheme(str[i])) {
+            i++;
+        }
 
-        if (*host == '[' && *(host + host_len - 1) != ']') {
-            return NULL;
+        if (i == len || str[i] != ':') {
+            return -1;
         }
 
-        ptr = strchr(pos, ':');
-        if (ptr != NULL) {
-            if (*(ptr + 1) == '\0') {
-                return NULL;
-            }
+        v->scheme = sc_uri_part(0, i);
+        i++;
+    }
 
-            errno = 0;
-            val = strtoul(ptr + 1, &parse_end, 10);
-            if (errno != 0 || val > 65536) {
-                return NULL;
-            }
+    if (i + 1 < len && str[i] == '/' && str[i + 1] == '/') {
+        i += 2;
+#ifdef SC_URI_HAVE_SCAN
+        end = sc_uri_find(str, i, len, "/?#");
+#else
+        end = i;
+        while (end < len && str[end] != '/' && str[end] != '?' &&
+               str[end] != '#') {
+            end++;
+        }
+#endif
 
-            port = ptr;
-            port_len = parse_end - ptr;
-            pos = port + port_len;
+        if (sc_uri_parse_authority(v, i, end) != 0) {
+            return -1;
         }
+        i = end;
     }
 
-    path = pos;
-    path_len = strcspn(path, "?#");
-    pos = path + path_len;
+#ifdef SC_URI_HAVE_SCAN
+    end = sc_uri_find(str, i, len, "?#");
+#else
+    end = i;
+    while (end < len && str[end] != '?' && str[end] != '#') {
+        end++;
+    }
+#endif
+    v->path = sc_uri_part(i, end);
+    i = end;
+
+    if (i < len && str[i] == '?') {
+        i++;
+#ifdef SC_URI_HAVE_SCAN
+        end = sc_uri_find(str, i, len, "#");
+#else
+        end = i;
+        while (end < len && str[end] != '#') {
+            end++;
+        }
+#endif
+        v->query = sc_uri_part(i, end);
+        i = end;
+    }
 
-    ptr = strchr(pos, '?');
-    if (ptr != NULL) {
-        query = ptr;
-        query_len = strcspn(query, "#");
-        pos = query + query_len;
+    if (i < len && str[i] == '#') {
+        v->fragment = sc_uri_part(i + 1, len);
     }
 
-    if (*pos == '#') {
-        fragment = pos;
-        fragment_len = strlen(pos);
+    return 0;
+}
+
+bool sc_uri_query_next(const struct sc_uri_view *v, uint32_t *pos,
+                       struct sc_uri_part *key, struct sc_uri_part *val)
+{
+    size_t i, end, eq;
+    const size_t q = v->query.off + (size_t) v->query.len;
+    const char *s = v->str;
+
+    i = v->query.off + (size_t) *pos;
+
+    // Skip empty parameters, e.g "a=1&&b=2"
+    while (i < q && s[i] == '&') {
+        i++;
     }
 
-    full_len = scheme_len + authority_len + userinfo_len + host_len + port_len +
-               path_len + query_len + fragment_len + 1;
+    if (i >= q) {
+        *pos = v->query.len;
+        return false;
+    }
 
-    parts_len = full_len - authority_len;
-    parts_len += 7; // NULL characters for each part.
-    parts_len -= (scheme_len != 0);
-    parts_len -= (userinfo_len != 0);
-    parts_len -= (port_len != 0);
-    parts_len -= (query_len != 0);
-    parts_len -= (fragment_len != 0);
+    eq = end = i;
+    while (end < q && s[end] != '&') {
+        end++;
+    }
 
-    uri = sc_uri_malloc(sizeof(*uri) + parts_len + full_len);
-    if (uri == NULL) {
-        return NULL;
+    while (eq < end && s[eq] != '=') {
+        eq++;
+    }
+
+    *key = sc_uri_part(i, eq);
+    *val = sc_uri_part(eq < end ? eq + 1 : end, end);
+    *pos = (uint32_t) (end - v->query.off);
+
+    return true;
+}
+
+static int sc_uri_hex(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
     }
 
-    ret = snprintf(uri->buf, full_len, s1, scheme_len, scheme, authority_len,
-                   authority, userinfo_len, userinfo, host_len, host, port_len,
-                   port, path_len, path, query_len, query, fragment_len,
-                   fragment);
-    if (ret < 0) {
-        goto error;
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
     }
 
-    assert((size_t) ret == full_len - 1);
+    return -1;
+}
+
+int sc_uri_decode(char *dst, size_t cap, const char *src, size_t len,
+                  bool plus)
+{
+    int hi, lo;
+    size_t n = 0;
 
-    dest = uri->buf + strlen(uri->buf) + 1;
+    if (len >= INT32_MAX) {
+        return -1;
+    }
 
-    scheme_len -= (scheme_len != 0);     // Skip ":"
-    userinfo_len -= (userinfo_len != 0); // Skip "@"
-    diff = port_len != 0;
-    port_len -= diff; // Skip ":"
-    port += diff;     // Skip ":"
-    diff = (query_len != 0);
-    query_len -= diff; // Skip "?"
-    query += diff;     // Skip "?"
-    diff = (fragment_len != 0);
-    fragment_len -= diff; // Skip "#"
-    fragment += diff;     // Skip "#"
+    for (size_t i = 0; i < len; i++, n++) {
+        char c = src[i];
 
-    ret = sprintf(dest, s2, scheme_len, scheme, 0, userinfo_len, userinfo, 0,
-                  host_len, host, 0, port_len, port, 0, path_len, path, 0,
-                  query_len, query, 0, fragment_len, fragment, 0);
-    if (ret < 0) {
-        goto error;
+        if (n == cap) {
+            return -1;
+        }
+
+        if (c == '%') {
+            if (len - i < 3) {
+                return -1;
+            }
+
+            hi = sc_uri_hex(src[i + 1]);
+            lo = sc_uri_hex(src[i + 2]);
+            if (hi < 0 || lo < 0) {
+                return -1;
+            }
+
+            c = (char) ((hi << 4) | lo);
+            i += 2;
+        } else if (plus && c == '+') {
+            c = ' ';
+        }
+
+        dst[n] = c;
     }
 
-    assert((size_t) ret == parts_len - 1);
+    if (n < cap) {
+        dst[n] = '\0';
+    }
+
+    return (int) n;
+}
+
+static const char *sc_uri_copy(char **dest, const char *str,
+                               struct sc_uri_part part)
+{
+    char *p = *dest;
+
+    memcpy(p, str + part.off, part.len);
+    p[part.len] = '\0';
+    *dest += part.len + 1;
+
+    return p;
+}
+
+struct sc_uri *sc_uri_create(const char *str)
+{
+    size_t len, parts;
+    char *dest;
+    struct sc_uri *uri;
+    struct sc_uri_view v;
+
+    if (str == NULL) {
+        return NULL;
+    }
+
+    len = strlen(str);
+    if (sc_uri_parse(&v, str, len) != 0 || v.scheme.len == 0) {
+        return NULL;
+    }
+
+    // Full string followed by each part, all null terminated.
+    parts = (size_t) v.scheme.len + v.userinfo.len + v.host.len + v.port.len +
+            v.path.len + v.query.len + v.fragment.len + 7;
+
+    uri = sc_uri_malloc(sizeof(*uri) + len + 1 + parts);
+    if (uri == NULL) {
+        return NULL;
+    }
+
+    memcpy(uri->buf, str, len + 1);
+    dest = uri->buf + len + 1;
 
     uri->str = uri->buf;
-    uri->scheme = dest;
-    uri->userinfo = dest + scheme_len + 1;
-    uri->host = uri->userinfo + userinfo_len + 1;
-    uri->port = uri->host + host_len + 1;
-    uri->path = uri->port + port_len + 1;
-    uri->query = uri->path + path_len + 1;
-    uri->fragment = uri->query + query_len + 1;
+    uri->scheme = sc_uri_copy(&dest, str, v.scheme);
+    uri->userinfo = sc_uri_copy(&dest, str, v.userinfo);
+    uri->host = sc_uri_copy(&dest, str, v.host);
+    uri->port = sc_uri_copy(&dest, str, v.port);
+    uri->path = sc_uri_copy(&dest, str, v.path);
+    uri->query = sc_uri_copy(&dest, str, v.query);
+    uri->fragment = sc_uri_copy(&dest, str, v.fragment);
 
     return uri;
-
-error:
-    sc_uri_free(uri);
-    return NULL;
 }
 
 void sc_uri_destroy(struct sc_uri *uri)
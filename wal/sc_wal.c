@@ -0,0 +1,656 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef _XOPEN_SOURCE
+    #define _XOPEN_SOURCE 700
+#endif
+
+#include "sc_wal.h"
+#include "sc_crc32.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <direct.h>
+    #include <windows.h>
+
+    #pragma warning(disable : 4996)
+#else
+    #include <dirent.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#define SC_WAL_MAGIC   0x4c574353u // "SCWL"
+#define SC_WAL_VERSION 1u
+
+static void sc_wal_errstr(struct sc_wal *w, const char *str)
+{
+    strncpy(w->err, str, sizeof(w->err) - 1);
+}
+
+static void sc_wal_path(struct sc_wal *w, uint64_t seq, char *path, size_t len)
+{
+    snprintf(path, len, "%s/%020" PRIu64 ".wal", w->dir, seq);
+}
+
+static bool sc_wal_name(const char *name, uint64_t *seq)
+{
+    uint64_t val = 0;
+
+    if (strlen(name) != 24 || strcmp(name + 20, ".wal") != 0) {
+        return false;
+    }
+
+    for (int i = 0; i < 20; i++) {
+        if (name[i] < '0' || name[i] > '9') {
+            return false;
+        }
+        val = (val * 10) + (uint64_t) (name[i] - '0');
+    }
+
+    *seq = val;
+    return true;
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+
+static int sc_wal_mkdir(const char *dir)
+{
+    return (_mkdir(dir) == 0 || errno == EEXIST) ? 0 : -1;
+}
+
+static int sc_wal_list(struct sc_wal *w, uint64_t *first, uint64_t *last)
+{
+    int count = 0;
+    uint64_t seq;
+    char path[SC_WAL_PATH_MAX + 32];
+    HANDLE h;
+    WIN32_FIND_DATAA data;
+
+    snprintf(path, sizeof(path), "%s/*.wal", w->dir);
+
+    h = FindFirstFileA(path, &data);
+    if (h == INVALID_HANDLE_VALUE) {
+        return GetLastError() == ERROR_FILE_NOT_FOUND ? 0 : -1;
+    }
+
+    do {
+        if (sc_wal_name(data.cFileName, &seq)) {
+            *first = (count == 0 || seq < *first) ? seq : *first;
+            *last = (count == 0 || seq > *last) ? seq : *last;
+            count++;
+        }
+    } while (FindNextFileA(h, &data));
+
+    FindClose(h);
+
+    return count;
+}
+
+static int sc_wal_sync_dir(struct sc_wal *w)
+{
+    (void) w;
+    return 0;
+}
+
+static size_t sc_wal_page(void)
+{
+    return 1;
+}
+
+#else
+
+static int sc_wal_mkdir(const char *dir)
+{
+    return (mkdir(dir, 0755) == 0 || errno == EEXIST) ? 0 : -1;
+}
+
+static int sc_wal_list(struct sc_wal *w, uint64_t *first, uint64_t *last)
+{
+    int count = 0;
+    uint64_t seq;
+    DIR *d;
+    struct dirent *e;
+
+    d = opendir(w->dir);
+    if (d == NULL) {
+        return -1;
+    }
+
+    while ((e = readdir(d)) != NULL) {
+        if (sc_wal_name(e->d_name, &seq)) {
+            *first = (count == 0 || seq < *first) ? seq : *first;
+            *last = (count == 0 || seq > *last) ? seq : *last;
+            count++;
+        }
+    }
+
+    closedir(d);
+
+    return count;
+}
+
+// New segment file must survive a crash, sync directory entry.
+static int sc_wal_sync_dir(struct sc_wal *w)
+{
+    int fd, rc;
+
+    fd = open(w->dir, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+
+    rc = fsync(fd);
+    close(fd);
+
+    return rc;
+}
+
+static size_t sc_wal_page(void)
+{
+    return (size_t) sysconf(_SC_PAGESIZE);
+}
+
+#endif
+
+// Returns 'false' if there is no valid record at the read position.
+static bool sc_wal_read(struct sc_buf *b, const void **data, uint32_t *len)
+{
+    uint32_t n;
+    struct sc_buf_crc crc;
+
+    if (sc_buf_size(b) < SC_WAL_RECORD_OVERHEAD) {
+        return false;
+    }
+
+    sc_buf_crc_rbegin(b, &crc);
+
+    n = sc_buf_get_32(b);
+    if (n == 0 || n > sc_buf_size(b) - sizeof(uint32_t)) {
+        sc_buf_crc_end(b);
+        return false;
+    }
+
+    *data = sc_buf_get_blob(b, n);
+    *len = n;
+
+    return sc_buf_get_crc(b);
+}
+
+static bool sc_wal_header_valid(struct sc_mmap *m, uint64_t seq)
+{
+    struct sc_buf b = sc_buf_wrap(m->ptr, SC_WAL_HEADER, SC_BUF_READ);
+
+    return sc_buf_get_32(&b) == SC_WAL_MAGIC &&
+           sc_buf_get_32(&b) == SC_WAL_VERSION && sc_buf_get_64(&b) == seq;
+}
+
+static void sc_wal_header_put(struct sc_mmap *m, uint64_t seq)
+{
+    struct sc_buf b = sc_buf_wrap(m->ptr, SC_WAL_HEADER, SC_BUF_REF);
+
+    sc_buf_put_32(&b, SC_WAL_MAGIC);
+    sc_buf_put_32(&b, SC_WAL_VERSION);
+    sc_buf_put_64(&b, seq);
+}
+
+static bool sc_wal_zero(const unsigned char *p, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int sc_wal_map(struct sc_wal *w, struct sc_mmap *m, uint64_t seq,
+                      uint64_t len)
+{
+    int rc;
+    char path[SC_WAL_PATH_MAX + 32];
+
+    sc_wal_path(w, seq, path, sizeof(path));
+
+    rc = sc_mmap_init(m, path, O_RDWR | O_CREAT, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, 0, (size_t) len);
+    if (rc != 0) {
+        sc_wal_errstr(w, sc_mmap_err(m));
+        return -1;
+    }
+
+    if (m->len < SC_WAL_HEADER + SC_WAL_RECORD_OVERHEAD ||
+        m->len > UINT32_MAX) {
+        sc_wal_errstr(w, "Invalid segment size");
+        sc_mmap_term(m);
+        return -1;
+    }
+
+    // Segment was created but header was not written before a crash.
+    if (sc_wal_zero(m->ptr, SC_WAL_HEADER)) {
+        sc_wal_header_put(m, seq);
+    }
+
+    if (!sc_wal_header_valid(m, seq)) {
+        sc_wal_errstr(w, "Corrupt segment header");
+        sc_mmap_term(m);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Flushes [from, to) of the current segment.
+static int sc_wal_flush(struct sc_wal *w, uint64_t from, uint64_t to)
+{
+    uint64_t start = from - (from % sc_wal_page());
+
+    if (from >= to) {
+        return 0;
+    }
+
+    return sc_mmap_msync(&w->map, (size_t) start, (size_t) (to - start));
+}
+
+int sc_wal_open(struct sc_wal *w, const char *dir, uint64_t segment_size)
+{
+    int count;
+    uint32_t len, pos;
+    uint64_t first = 0, last = 0;
+    const void *data;
+    struct sc_buf b;
+
+    *w = (struct sc_wal){0};
+
+    sc_crc32_init();
+
+    if (strlen(dir) >= SC_WAL_PATH_MAX) {
+        sc_wal_errstr(w, "Path is too long");
+        return -1;
+    }
+    strcpy(w->dir, dir);
+
+    segment_size = segment_size == 0 ? SC_WAL_SEGMENT : segment_size;
+    if (segment_size < SC_WAL_HEADER + SC_WAL_RECORD_OVERHEAD + 1 ||
+        segment_size > UINT32_MAX) {
+        sc_wal_errstr(w, "Invalid segment size");
+        return -1;
+    }
+
+    if (sc_wal_mkdir(dir) != 0) {
+        goto error_errno;
+    }
+
+    count = sc_wal_list(w, &first, &last);
+    if (count < 0) {
+        goto error_errno;
+    }
+
+    // Existing segments, size is the file size.
+    if (sc_wal_map(w, &w->map, last, count == 0 ? segment_size : 0) != 0) {
+        return -1;
+    }
+
+    if (count == 0 && sc_wal_sync_dir(w) != 0) {
+        sc_mmap_term(&w->map);
+        goto error_errno;
+    }
+
+    if (sc_mutex_init(&w->mtx) != 0) {
+        sc_mmap_term(&w->map);
+        goto error_errno;
+    }
+
+    if (sc_mutex_cond_init(&w->cond) != 0) {
+        sc_mutex_term(&w->mtx);
+        sc_mmap_term(&w->map);
+        goto error_errno;
+    }
+
+    w->segment_size = w->map.len;
+    w->first = first;
+    w->seq = last;
+
+    // Find the end of the log, first invalid record.
+    b = sc_buf_wrap(w->map.ptr, (uint32_t) w->map.len, SC_BUF_READ);
+    sc_buf_set_rpos(&b, SC_WAL_HEADER);
+
+    do {
+        pos = sc_buf_rpos(&b);
+    } while (sc_wal_read(&b, &data, &len));
+
+    // Torn write, clear the rest so a shorter record written later is not
+    // followed by stale bytes that look like a valid record.
+    len = (uint32_t) w->map.len - pos;
+    if (!sc_wal_zero(w->map.ptr + pos,
+                     len < SC_WAL_RECORD_OVERHEAD ? len :
+                                                    SC_WAL_RECORD_OVERHEAD)) {
+        memset(w->map.ptr + pos, 0, len);
+        sc_wal_flush(w, pos, w->map.len);
+    }
+
+    w->buf = sc_buf_wrap(w->map.ptr, (uint32_t) w->map.len, SC_BUF_REF);
+    sc_buf_set_wpos(&w->buf, pos);
+
+    w->written = (w->seq * w->segment_size) + pos;
+    w->synced = w->written;
+
+    return 0;
+
+error_errno:
+    sc_wal_errstr(w, strerror(errno));
+    return -1;
+}
+
+int sc_wal_close(struct sc_wal *w)
+{
+    int rc;
+
+    rc = sc_wal_sync(w, UINT64_MAX);
+    if (sc_mmap_term(&w->map) != 0) {
+        sc_wal_errstr(w, sc_mmap_err(&w->map));
+        rc = -1;
+    }
+
+    sc_mutex_cond_term(&w->cond);
+    sc_mutex_term(&w->mtx);
+
+    return rc;
+}
+
+// Waits for the flush in progress. Called with the lock held, the lock is
+// released and the thread is blocked atomically, so a broadcast can't be
+// missed.
+static void sc_wal_wait(struct sc_wal *w)
+{
+    sc_mutex_cond_wait(&w->cond, &w->mtx);
+}
+
+// Syncs the current segment and moves to the next one. Called with the lock
+// held, while there is no flush in progress.
+static int sc_wal_roll(struct sc_wal *w)
+{
+    int rc;
+    struct sc_mmap next;
+    const uint64_t base = w->seq * w->segment_size;
+
+    rc = sc_wal_flush(w, w->synced - base, sc_buf_wpos(&w->buf));
+    if (rc != 0) {
+        sc_wal_errstr(w, sc_mmap_err(&w->map));
+        return -1;
+    }
+
+    rc = sc_wal_map(w, &next, w->seq + 1, w->segment_size);
+    if (rc != 0) {
+        return -1;
+    }
+
+    if (sc_wal_sync_dir(w) != 0) {
+        sc_wal_errstr(w, strerror(errno));
+        sc_mmap_term(&next);
+        return -1;
+    }
+
+    sc_mmap_term(&w->map);
+
+    w->map = next;
+    w->seq++;
+    w->buf = sc_buf_wrap(w->map.ptr, (uint32_t) w->map.len, SC_BUF_REF);
+    sc_buf_set_wpos(&w->buf, SC_WAL_HEADER);
+
+    // Header is flushed with the first sync of the segment.
+    w->written = (w->seq * w->segment_size) + SC_WAL_HEADER;
+    w->synced = w->written;
+
+    return 0;
+}
+
+int sc_wal_append(struct sc_wal *w, const void *data, uint32_t len,
+                  uint64_t *lsn)
+{
+    uint32_t pos;
+    struct sc_buf_crc crc;
+    const uint64_t need = (uint64_t) len + SC_WAL_RECORD_OVERHEAD;
+
+    sc_mutex_lock(&w->mtx);
+
+    if (len == 0 || need > w->segment_size - SC_WAL_HEADER) {
+        sc_wal_errstr(w, "Invalid record size");
+        goto error;
+    }
+
+    while (sc_buf_quota(&w->buf) < need) {
+        if (w->flushing) {
+            sc_wal_wait(w);
+            continue;
+        }
+
+        if (sc_wal_roll(w) != 0) {
+            goto error;
+        }
+    }
+
+    pos = sc_buf_wpos(&w->buf);
+
+    sc_buf_crc_wbegin(&w->buf, &crc);
+    sc_buf_put_32(&w->buf, len);
+    sc_buf_put_raw(&w->buf, data, len);
+    sc_buf_put_crc(&w->buf);
+
+    w->written = (w->seq * w->segment_size) + sc_buf_wpos(&w->buf);
+    if (lsn != NULL) {
+        *lsn = (w->seq * w->segment_size) + pos;
+    }
+
+    sc_mutex_unlock(&w->mtx);
+
+    return 0;
+
+error:
+    sc_mutex_unlock(&w->mtx);
+    return -1;
+}
+
+int sc_wal_sync(struct sc_wal *w, uint64_t lsn)
+{
+    int rc = 0;
+    uint64_t base, from, to;
+
+    sc_mutex_lock(&w->mtx);
+
+    if (lsn >= w->written) {
+        lsn = w->written - 1;
+    }
+
+    while (w->synced <= lsn) {
+        // Another thread is flushing, its flush or the next one covers us.
+        if (w->flushing) {
+            sc_wal_wait(w);
+            continue;
+        }
+
+        w->flushing = true;
+        base = w->seq * w->segment_size;
+        from = w->synced - base;
+        to = w->written - base;
+        sc_mutex_unlock(&w->mtx);
+
+        rc = sc_wal_flush(w, from, to);
+
+        sc_mutex_lock(&w->mtx);
+        w->flushing = false;
+        if (rc == 0) {
+            w->synced = base + to;
+        } else {
+            sc_wal_errstr(w, sc_mmap_err(&w->map));
+        }
+        sc_mutex_cond_broadcast(&w->cond);
+
+        if (rc != 0) {
+            break;
+        }
+    }
+
+    sc_mutex_unlock(&w->mtx);
+
+    return rc;
+}
+
+int sc_wal_truncate(struct sc_wal *w, uint64_t lsn)
+{
+    int rc = 0;
+    uint64_t end;
+    char path[SC_WAL_PATH_MAX + 32];
+
+    sc_mutex_lock(&w->mtx);
+
+    end = lsn / w->segment_size;
+    end = end > w->seq ? w->seq : end;
+
+    for (; w->first < end; w->first++) {
+        sc_wal_path(w, w->first, path, sizeof(path));
+        rc = remove(path);
+        if (rc != 0 && errno != ENOENT) {
+            sc_wal_errstr(w, strerror(errno));
+            rc = -1;
+            break;
+        }
+        rc = 0;
+    }
+
+    sc_mutex_unlock(&w->mtx);
+
+    return rc;
+}
+
+uint64_t sc_wal_end(struct sc_wal *w)
+{
+    uint64_t end;
+
+    sc_mutex_lock(&w->mtx);
+    end = w->written;
+    sc_mutex_unlock(&w->mtx);
+
+    return end;
+}
+
+const char *sc_wal_err(struct sc_wal *w)
+{
+    return w->err;
+}
+
+void sc_wal_iter_init(struct sc_wal_iter *it, struct sc_wal *w, uint64_t lsn)
+{
+    uint64_t first;
+
+    *it = (struct sc_wal_iter){.wal = w};
+
+    sc_mutex_lock(&w->mtx);
+    first = w->first * w->segment_size;
+    sc_mutex_unlock(&w->mtx);
+
+    lsn = lsn < first ? first : lsn;
+    it->seq = lsn / w->segment_size;
+    it->lsn = lsn % w->segment_size < SC_WAL_HEADER ?
+                      (it->seq * w->segment_size) + SC_WAL_HEADER :
+                      lsn;
+}
+
+void sc_wal_iter_term(struct sc_wal_iter *it)
+{
+    if (it->mapped) {
+        sc_mmap_term(&it->map);
+        it->mapped = false;
+    }
+}
+
+static bool sc_wal_iter_map(struct sc_wal_iter *it)
+{
+    int rc;
+    char path[SC_WAL_PATH_MAX + 32];
+    const uint64_t size = it->wal->segment_size;
+
+    sc_wal_path(it->wal, it->seq, path, sizeof(path));
+
+    rc = sc_mmap_init(&it->map, path, O_RDONLY, PROT_READ, MAP_SHARED, 0, 0);
+    if (rc != 0) {
+        return false;
+    }
+
+    if (it->map.len != size || !sc_wal_header_valid(&it->map, it->seq)) {
+        sc_mmap_term(&it->map);
+        return false;
+    }
+
+    it->buf = sc_buf_wrap(it->map.ptr, (uint32_t) size, SC_BUF_READ);
+    sc_buf_set_rpos(&it->buf, (uint32_t) (it->lsn % size));
+    it->mapped = true;
+
+    return true;
+}
+
+bool sc_wal_iter_next(struct sc_wal_iter *it, const void **data,
+                      uint32_t *len, uint64_t *lsn)
+{
+    uint32_t pos;
+    uint64_t seq;
+    const uint64_t size = it->wal->segment_size;
+
+    while (true) {
+        if (!it->mapped && !sc_wal_iter_map(it)) {
+            return false;
+        }
+
+        pos = sc_buf_rpos(&it->buf);
+
+        if (sc_wal_read(&it->buf, data, len)) {
+            if (lsn != NULL) {
+                *lsn = (it->seq * size) + pos;
+            }
+            it->lsn = (it->seq * size) + sc_buf_rpos(&it->buf);
+            return true;
+        }
+
+        sc_mutex_lock(&it->wal->mtx);
+        seq = it->wal->seq;
+        sc_mutex_unlock(&it->wal->mtx);
+
+        // End of the log, next call retries from the same position.
+        if (it->seq >= seq) {
+            it->buf = sc_buf_wrap(it->map.ptr, (uint32_t) size, SC_BUF_READ);
+            sc_buf_set_rpos(&it->buf, pos);
+            return false;
+        }
+
+        sc_wal_iter_term(it);
+        it->seq++;
+        it->lsn = (it->seq * size) + SC_WAL_HEADER;
+    }
+}
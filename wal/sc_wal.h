@@ -0,0 +1,205 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2021 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef SC_WAL_H
+#define SC_WAL_H
+
+#include "sc_buf.h"
+#include "sc_mmap.h"
+#include "sc_mutex.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef SC_BUF_HAVE_CRC32
+    #error "sc_wal requires sc_buf with crc32, compile with -DSC_BUF_HAVE_CRC32"
+#endif
+
+// Default segment size, must be less than 4 GB.
+#ifndef SC_WAL_SEGMENT
+    #define SC_WAL_SEGMENT (64 * 1024 * 1024)
+#endif
+
+#ifndef SC_WAL_PATH_MAX
+    #define SC_WAL_PATH_MAX 512
+#endif
+
+// Segment header : magic, version, segment sequence.
+#define SC_WAL_HEADER 16
+
+// Record header and trailer : length and crc32c.
+#define SC_WAL_RECORD_OVERHEAD 8
+
+/**
+ * Append-only log, stored as fixed size, memory mapped segment files in a
+ * directory, "<dir>/00000000000000000000.wal", "<dir>/...001.wal".
+ *
+ * Each record is [length][data][crc32c], encoded with sc_buf, checksum covers
+ * length and data. A record is written with a memcpy into the mapping, it is
+ * durable after sc_wal_sync(). Concurrent sync calls are batched: while one
+ * thread flushes, others wait and the next flush covers all of them, a
+ * single msync() per batch (group commit).
+ *
+ * On open, the last segment is scanned, the log ends at the first record
+ * with a zero length or a checksum mismatch, e.g a torn write of a crash.
+ *
+ * Records are addressed by LSN, 'segment sequence * segment size + offset'.
+ *
+ * Thread-safe, except sc_wal_open()/sc_wal_close().
+ */
+struct sc_wal
+{
+    char dir[SC_WAL_PATH_MAX];
+    struct sc_mmap map;
+    struct sc_buf buf;
+    struct sc_mutex mtx;
+    struct sc_mutex_cond cond;
+
+    uint64_t segment_size;
+    uint64_t first;
+    uint64_t seq;
+    uint64_t written;
+    uint64_t synced;
+    bool flushing;
+
+    char err[128];
+};
+
+/**
+ * Open or create log. Directory is created if it does not exist.
+ *
+ * @param w            wal
+ * @param dir          directory
+ * @param segment_size segment size, '0' for SC_WAL_SEGMENT. Ignored if the
+ *                     log exists, the size of the existing segments is used.
+ * @return             '0' on success, '-1' on error, call sc_wal_err() for
+ *                     error string.
+ */
+int sc_wal_open(struct sc_wal *w, const char *dir, uint64_t segment_size);
+
+/**
+ * Sync and close log.
+ *
+ * @param w wal
+ * @return  '0' on success, '-1' on error, call sc_wal_err() for error
+ *          string.
+ */
+int sc_wal_close(struct sc_wal *w);
+
+/**
+ * Append record. If the record does not fit into the current segment, the
+ * segment is synced and the next segment is created.
+ *
+ * @param w    wal
+ * @param data data
+ * @param len  data length, must be greater than zero and fit into a segment.
+ * @param lsn  out param, LSN of the record, can be NULL.
+ * @return     '0' on success, '-1' on error, call sc_wal_err() for error
+ *             string.
+ */
+int sc_wal_append(struct sc_wal *w, const void *data, uint32_t len,
+                  uint64_t *lsn);
+
+/**
+ * Make the record at 'lsn' and all records before it durable. Returns
+ * immediately if they are already synced. Pass UINT64_MAX to sync all
+ * records appended before this call.
+ *
+ * @param w   wal
+ * @param lsn lsn
+ * @return    '0' on success, '-1' on error, call sc_wal_err() for error
+ *            string.
+ */
+int sc_wal_sync(struct sc_wal *w, uint64_t lsn);
+
+/**
+ * Delete segments which contain only records before 'lsn', e.g after a
+ * checkpoint. Current segment is never deleted.
+ *
+ * @param w   wal
+ * @param lsn lsn
+ * @return    '0' on success, '-1' on error, call sc_wal_err() for error
+ *            string.
+ */
+int sc_wal_truncate(struct sc_wal *w, uint64_t lsn);
+
+/**
+ * @param w wal
+ * @return  LSN of the first record that will be appended.
+ */
+uint64_t sc_wal_end(struct sc_wal *w);
+
+/**
+ * @param w wal
+ * @return  last error string.
+ */
+const char *sc_wal_err(struct sc_wal *w);
+
+/**
+ * Iterator, reads records from the mapped segments, data pointers are valid
+ * until the next call. Records appended concurrently may or may not be seen.
+ *
+ * struct sc_wal_iter it;
+ *
+ * sc_wal_iter_init(&it, &wal, 0);
+ * while (sc_wal_iter_next(&it, &data, &len, &lsn)) {
+ *     // Replay record
+ * }
+ * sc_wal_iter_term(&it);
+ */
+struct sc_wal_iter
+{
+    struct sc_wal *wal;
+    struct sc_mmap map;
+    struct sc_buf buf;
+    uint64_t seq;
+    uint64_t lsn;
+    bool mapped;
+};
+
+/**
+ * @param it  iterator
+ * @param w   wal
+ * @param lsn LSN of the first record to read, '0' to start from the first
+ *            record of the log.
+ */
+void sc_wal_iter_init(struct sc_wal_iter *it, struct sc_wal *w, uint64_t lsn);
+
+/**
+ * @param it iterator
+ */
+void sc_wal_iter_term(struct sc_wal_iter *it);
+
+/**
+ * @param it   iterator
+ * @param data out param, record data
+ * @param len  out param, record length
+ * @param lsn  out param, record LSN, can be NULL.
+ * @return     'true' if there is a record, 'false' at the end of the log.
+ */
+bool sc_wal_iter_next(struct sc_wal_iter *it, const void **data,
+                      uint32_t *len, uint64_t *lsn);
+
+#endif
@@ -0,0 +1,36 @@
+#include "sc_wal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+int main()
+{
+    const void *data;
+    uint32_t len;
+    uint64_t lsn;
+    struct sc_wal wal;
+    struct sc_wal_iter it;
+
+    if (sc_wal_open(&wal, "wal_example", 0) != 0) {
+        printf("open : %s \n", sc_wal_err(&wal));
+        return 1;
+    }
+
+    // Replay
+    sc_wal_iter_init(&it, &wal, 0);
+    while (sc_wal_iter_next(&it, &data, &len, &lsn)) {
+        printf("lsn : %llu, record : %.*s \n", (unsigned long long) lsn,
+               (int) len, (const char *) data);
+    }
+    sc_wal_iter_term(&it);
+
+    sc_wal_append(&wal, "hello", 5, NULL);
+    sc_wal_append(&wal, "world", 5, &lsn);
+
+    // Durable after this call
+    sc_wal_sync(&wal, lsn);
+
+    sc_wal_close(&wal);
+
+    return 0;
+}
@@ -0,0 +1,380 @@
+#include "sc_wal.h"
+#include "sc_thread.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DIR "wal_test_dir"
+
+static void clean(void)
+{
+    char path[256];
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(path, sizeof(path), "%s/%020d.wal", DIR, i);
+        remove(path);
+    }
+    remove(DIR);
+}
+
+static void fill(char *buf, uint32_t len, uint32_t id)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        buf[i] = (char) ('a' + (id + i) % 26);
+    }
+}
+
+static bool check(const void *data, uint32_t len, uint32_t id)
+{
+    char buf[4096];
+
+    fill(buf, len, id);
+    return memcmp(buf, data, len) == 0;
+}
+
+void test_basic(void)
+{
+    char buf[4096];
+    const void *data;
+    uint32_t len, count;
+    uint64_t lsn, prev = 0, lsns[100];
+    struct sc_wal w;
+    struct sc_wal_iter it;
+
+    clean();
+
+    assert(sc_wal_open(&w, DIR, 0) == 0);
+    assert(w.segment_size == SC_WAL_SEGMENT);
+    assert(sc_wal_end(&w) == SC_WAL_HEADER);
+
+    assert(sc_wal_append(&w, buf, 0, NULL) == -1);
+    assert(strlen(sc_wal_err(&w)) > 0);
+    assert(sc_wal_sync(&w, UINT64_MAX) == 0);
+
+    for (uint32_t i = 0; i < 100; i++) {
+        fill(buf, i + 1, i);
+        assert(sc_wal_append(&w, buf, i + 1, &lsns[i]) == 0);
+        assert(i == 0 || lsns[i] > prev);
+        prev = lsns[i];
+    }
+
+    assert(sc_wal_sync(&w, lsns[50]) == 0);
+    assert(w.synced > lsns[50]);
+    assert(sc_wal_sync(&w, lsns[10]) == 0);
+    assert(sc_wal_close(&w) == 0);
+
+    // Reopen, records are there, new records go after them.
+    assert(sc_wal_open(&w, DIR, 0) == 0);
+    assert(sc_wal_end(&w) > lsns[99]);
+
+    fill(buf, 5, 100);
+    assert(sc_wal_append(&w, buf, 5, &lsn) == 0);
+    assert(lsn > lsns[99]);
+
+    count = 0;
+    sc_wal_iter_init(&it, &w, 0);
+    while (sc_wal_iter_next(&it, &data, &len, &lsn)) {
+        assert(len == (count < 100 ? count + 1 : 5));
+        assert(check(data, len, count));
+        assert(count == 100 || lsn == lsns[count]);
+        count++;
+    }
+    assert(count == 101);
+
+    // Iterator sees records appended later.
+    fill(buf, 7, 101);
+    assert(sc_wal_append(&w, buf, 7, NULL) == 0);
+    assert(sc_wal_iter_next(&it, &data, &len, NULL));
+    assert(len == 7 && check(data, 7, 101));
+    assert(!sc_wal_iter_next(&it, &data, &len, NULL));
+    sc_wal_iter_term(&it);
+
+    // Start from an lsn.
+    sc_wal_iter_init(&it, &w, lsns[98]);
+    assert(sc_wal_iter_next(&it, &data, &len, &lsn));
+    assert(lsn == lsns[98] && len == 99);
+    sc_wal_iter_term(&it);
+
+    assert(sc_wal_close(&w) == 0);
+    clean();
+}
+
+void test_segments(void)
+{
+    char buf[4096];
+    const void *data;
+    uint32_t len, count;
+    uint64_t lsn, lsns[1000];
+    struct sc_wal w;
+    struct sc_wal_iter it;
+
+    clean();
+
+    assert(sc_wal_open(&w, DIR, 10) == -1);
+    assert(sc_wal_open(&w, DIR, 4096) == 0);
+    assert(sc_wal_append(&w, buf, 4096 - SC_WAL_HEADER, NULL) == -1);
+
+    // Largest record fits into an empty segment.
+    fill(buf, 4096 - SC_WAL_HEADER - SC_WAL_RECORD_OVERHEAD, 0);
+    assert(sc_wal_append(&w, buf, 4096 - SC_WAL_HEADER - SC_WAL_RECORD_OVERHEAD,
+                         &lsns[0]) == 0);
+    assert(w.seq == 0);
+
+    for (uint32_t i = 1; i < 1000; i++) {
+        len = (i * 37) % 1000 + 1;
+        fill(buf, len, i);
+        assert(sc_wal_append(&w, buf, len, &lsns[i]) == 0);
+        if (i % 100 == 0) {
+            assert(sc_wal_sync(&w, lsns[i]) == 0);
+        }
+    }
+    assert(w.seq > 100);
+    assert(sc_wal_close(&w) == 0);
+
+    // Segment size is taken from the existing files.
+    assert(sc_wal_open(&w, DIR, 0) == 0);
+    assert(w.segment_size == 4096);
+
+    count = 0;
+    sc_wal_iter_init(&it, &w, 0);
+    while (sc_wal_iter_next(&it, &data, &len, &lsn)) {
+        assert(lsn == lsns[count]);
+        assert(check(data, len, count));
+        count++;
+    }
+    sc_wal_iter_term(&it);
+    assert(count == 1000);
+
+    count = 0;
+    sc_wal_iter_init(&it, &w, lsns[500]);
+    while (sc_wal_iter_next(&it, &data, &len, &lsn)) {
+        assert(lsn == lsns[500 + count]);
+        count++;
+    }
+    sc_wal_iter_term(&it);
+    assert(count == 500);
+
+    // Delete old segments, iteration starts at the first segment left.
+    assert(sc_wal_truncate(&w, lsns[500]) == 0);
+    assert(w.first == lsns[500] / 4096);
+    sc_wal_iter_init(&it, &w, 0);
+    assert(sc_wal_iter_next(&it, &data, &len, &lsn));
+    assert(lsn <= lsns[500] && lsn / 4096 == w.first);
+    sc_wal_iter_term(&it);
+    assert(sc_wal_truncate(&w, UINT64_MAX) == 0);
+    assert(w.first == w.seq);
+
+    assert(sc_wal_close(&w) == 0);
+    clean();
+}
+
+void test_recovery(void)
+{
+    char buf[4096], path[256];
+    const void *data;
+    uint32_t len, count;
+    uint64_t lsns[10];
+    FILE *fp;
+    struct sc_wal w;
+    struct sc_wal_iter it;
+
+    clean();
+
+    assert(sc_wal_open(&w, DIR, 8192) == 0);
+    for (uint32_t i = 0; i < 10; i++) {
+        fill(buf, 100, i);
+        assert(sc_wal_append(&w, buf, 100, &lsns[i]) == 0);
+    }
+    assert(sc_wal_close(&w) == 0);
+
+    // Corrupt record 7, log ends at record 6.
+    snprintf(path, sizeof(path), "%s/%020d.wal", DIR, 0);
+    fp = fopen(path, "r+b");
+    assert(fp != NULL);
+    assert(fseek(fp, (long) lsns[7] + 50, SEEK_SET) == 0);
+    assert(fputc('!', fp) != EOF);
+    fclose(fp);
+
+    assert(sc_wal_open(&w, DIR, 0) == 0);
+    assert(sc_wal_end(&w) == lsns[7]);
+
+    // Shorter record, stale bytes after it must not be read as records.
+    fill(buf, 10, 7);
+    assert(sc_wal_append(&w, buf, 10, NULL) == 0);
+    assert(sc_wal_close(&w) == 0);
+
+    assert(sc_wal_open(&w, DIR, 0) == 0);
+    count = 0;
+    sc_wal_iter_init(&it, &w, 0);
+    while (sc_wal_iter_next(&it, &data, &len, NULL)) {
+        assert(len == (count < 7 ? 100 : 10));
+        assert(check(data, len, count));
+        count++;
+    }
+    sc_wal_iter_term(&it);
+    assert(count == 8);
+    assert(sc_wal_close(&w) == 0);
+
+    // Corrupt header.
+    fp = fopen(path, "r+b");
+    assert(fp != NULL);
+    assert(fputc('!', fp) != EOF);
+    fclose(fp);
+    assert(sc_wal_open(&w, DIR, 0) == -1);
+    assert(strlen(sc_wal_err(&w)) > 0);
+
+    clean();
+}
+
+#define THREADS 4
+#define RECORDS 2000
+
+static void *writer(void *arg)
+{
+    char buf[64];
+    uint64_t lsn;
+    struct sc_wal *w = arg;
+
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        fill(buf, 64, i);
+        assert(sc_wal_append(w, buf, 64, &lsn) == 0);
+        assert(sc_wal_sync(w, lsn) == 0);
+    }
+
+    return NULL;
+}
+
+void test_threads(void)
+{
+    const void *data;
+    uint32_t len, count = 0;
+    struct sc_wal w;
+    struct sc_wal_iter it;
+    struct sc_thread threads[THREADS];
+
+    clean();
+
+    assert(sc_wal_open(&w, DIR, 64 * 1024) == 0);
+
+    for (int i = 0; i < THREADS; i++) {
+        sc_thread_init(&threads[i]);
+        assert(sc_thread_start(&threads[i], writer, &w) == 0);
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        assert(sc_thread_term(&threads[i]) == 0);
+    }
+
+    sc_wal_iter_init(&it, &w, 0);
+    while (sc_wal_iter_next(&it, &data, &len, NULL)) {
+        assert(len == 64);
+        count++;
+    }
+    sc_wal_iter_term(&it);
+    assert(count == THREADS * RECORDS);
+
+    assert(sc_wal_close(&w) == 0);
+    clean();
+}
+
+void test_err(void)
+{
+    char dir[SC_WAL_PATH_MAX + 1];
+    struct sc_wal w;
+
+    memset(dir, 'a', sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+    assert(sc_wal_open(&w, dir, 0) == -1);
+    assert(strlen(sc_wal_err(&w)) > 0);
+
+    assert(sc_wal_open(&w, DIR, (uint64_t) UINT32_MAX + 1) == -1);
+    assert(sc_wal_open(&w, "/nonexistent/wal/dir", 0) == -1);
+}
+
+#ifdef SC_HAVE_WRAP
+    #include <sys/mman.h>
+
+bool fail_mmap;
+extern void *__real_mmap(void *addr, size_t length, int prot, int flags,
+                         int fd, off_t offset);
+void *__wrap_mmap(void *addr, size_t length, int prot, int flags, int fd,
+                  off_t offset)
+{
+    if (fail_mmap) {
+        return MAP_FAILED;
+    }
+
+    return __real_mmap(addr, length, prot, flags, fd, offset);
+}
+
+bool fail_msync;
+extern int __real_msync(void *addr, size_t len, int flags);
+int __wrap_msync(void *addr, size_t len, int flags)
+{
+    if (fail_msync) {
+        return -1;
+    }
+
+    return __real_msync(addr, len, flags);
+}
+
+void fail_test(void)
+{
+    char buf[100] = {0};
+    uint64_t lsn;
+    struct sc_wal w;
+
+    clean();
+
+    fail_mmap = true;
+    assert(sc_wal_open(&w, DIR, 4096) == -1);
+    fail_mmap = false;
+
+    assert(sc_wal_open(&w, DIR, 4096) == 0);
+    assert(sc_wal_append(&w, buf, sizeof(buf), &lsn) == 0);
+
+    fail_msync = true;
+    assert(sc_wal_sync(&w, lsn) == -1);
+    assert(strlen(sc_wal_err(&w)) > 0);
+    fail_msync = false;
+    assert(sc_wal_sync(&w, lsn) == 0);
+
+    // Rollover syncs the current segment and maps the next one.
+    while (sc_buf_quota(&w.buf) >= sizeof(buf) + SC_WAL_RECORD_OVERHEAD) {
+        assert(sc_wal_append(&w, buf, sizeof(buf), NULL) == 0);
+    }
+
+    fail_msync = true;
+    assert(sc_wal_append(&w, buf, sizeof(buf), NULL) == -1);
+    fail_msync = false;
+    assert(w.seq == 0);
+
+    fail_mmap = true;
+    assert(sc_wal_append(&w, buf, sizeof(buf), NULL) == -1);
+    fail_mmap = false;
+    assert(w.seq == 0);
+
+    assert(sc_wal_append(&w, buf, sizeof(buf), NULL) == 0);
+    assert(w.seq == 1);
+
+    assert(sc_wal_close(&w) == 0);
+    clean();
+}
+#else
+void fail_test(void)
+{
+}
+#endif
+
+int main(void)
+{
+    test_basic();
+    test_segments();
+    test_recovery();
+    test_threads();
+    test_err();
+    fail_test();
+
+    return 0;
+}